@@ -0,0 +1,506 @@
+/**
+ * $Id$
+ *
+ * Copyright 2026 Quantcast Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * This C++ client drives sequential or random read, write, or append data
+ * workloads against QFS, and writes throughput and latency histograms, in
+ * total and per chunk server, into a result file that can be merged with the
+ * results of other clients and compared with previous runs by
+ * dstress_report.py.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/time.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <sstream>
+#include <algorithm>
+
+using namespace std;
+
+#include "libclient/KfsClient.h"
+#include "qcdio/QCThread.h"
+#include "qcdio/QCMutex.h"
+#include "qcdio/qcstutils.h"
+
+FILE* logFile = stdout;
+
+#define TEST_BASE_DIR "/dstress"
+
+/*
+  This program is invoked with the following arguments:
+    - qfs server/port
+    - test name ('write', 'read', or 'append')
+    - access pattern ('seq' or 'rand')
+    - keys to construct the test directory (hostname and process name)
+    - workload parameters, see Usage()
+
+  The files are created under /dstress/<host>_<process>/file_<N>, therefore
+  'read' should be run with the same host, process name, and file count as a
+  preceding 'write' run.
+*/
+
+static int64_t Now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (int64_t)tv.tv_sec * 1000 * 1000 + tv.tv_usec;
+}
+
+// Log linear latency histogram with 16 sub-buckets per power of two, i.e.
+// with less than 7% error, in microseconds. The histograms are written as is
+// into the result file, in order to compute percentiles over merged results.
+struct Histogram {
+  static const int kSubBits = 4;
+  static const int kBuckets = 64 << kSubBits;
+
+  Histogram() : count_(0), sum_(0), bytes_(0), errors_(0), buckets_(kBuckets, 0) {}
+
+  static int Bucket(int64_t us) {
+    if (us < (1 << kSubBits)) {
+      return (int)(us < 0 ? 0 : us);
+    }
+    int msb = 63 - __builtin_clzll((unsigned long long)us);
+    int sub = (int)((us >> (msb - kSubBits)) & ((1 << kSubBits) - 1));
+    return ((msb - kSubBits + 1) << kSubBits) + sub;
+  }
+
+  void Add(int64_t us, int64_t bytes) {
+    count_++;
+    sum_ += us;
+    bytes_ += bytes;
+    buckets_[Bucket(us)]++;
+  }
+
+  void Merge(const Histogram& other) {
+    count_ += other.count_;
+    sum_ += other.sum_;
+    bytes_ += other.bytes_;
+    errors_ += other.errors_;
+    for (int i = 0; i < kBuckets; i++) {
+      buckets_[i] += other.buckets_[i];
+    }
+  }
+
+  int64_t count_;
+  int64_t sum_;
+  int64_t bytes_;
+  int64_t errors_;
+  vector<int64_t> buckets_;
+};
+
+typedef map<string, Histogram> ServerStats;
+
+//Global datastructure to hold various options.
+struct Client {
+  Client()
+    : dfsPort_(-1), files_(1), threads_(1), fileSize_((int64_t)64 << 20),
+      ioSize_(1 << 20), ioCount_(0), duration_(0), replicas_(3), stripes_(0),
+      recoveryStripes_(0), stripeSize_(64 << 10), syncFlag_(false),
+      serverStatsFlag_(true), kfsClient_(NULL) {}
+
+  //from commadline
+  string dfsServer_;
+  int dfsPort_;
+  string testName_;
+  string pattern_;
+  string hostName_;
+  string processName_;
+  string resultFile_;
+  string label_;
+  int files_;
+  int threads_;
+  int64_t fileSize_;
+  int ioSize_;
+  int64_t ioCount_;
+  int duration_;
+  int replicas_;
+  int stripes_;
+  int recoveryStripes_;
+  int stripeSize_;
+  bool syncFlag_;
+  bool serverStatsFlag_;
+
+  KFS::KfsClient* kfsClient_;
+  string testDir_;
+
+  QCMutex mutex_;
+  Histogram total_;
+  ServerStats servers_;
+  int status_;
+};
+
+void Usage(const char* argv0)
+{
+  fprintf(logFile, "Usage: %s -s dfs-server -p dfs-port -t [write|read|append] -c host -n process-name\n"
+    "   [-m seq|rand] [-f files] [-T threads] [-z file-size] [-b io-size] [-i io-count] [-d duration-sec]\n"
+    "   [-r replicas] [-S stripes -R recovery-stripes [-Z stripe-size]] [-y] [-N] [-l label] [-o result-file]\n",
+    argv0);
+  fprintf(logFile, "   -m: access pattern, the default is seq; rand does io-size reads or writes at random,\n"
+    "       io-size aligned positions.\n");
+  fprintf(logFile, "   -f: number of files, the default is 1; each thread processes every T-th file.\n");
+  fprintf(logFile, "   -z: file size in bytes, the default is 64MB.\n");
+  fprintf(logFile, "   -b: bytes per read or write, the default is 1MB.\n");
+  fprintf(logFile, "   -i: with rand, number of ios per file, the default is file-size / io-size.\n");
+  fprintf(logFile, "   -d: stop after the specified number of seconds; 0, the default, means no limit.\n");
+  fprintf(logFile, "   -S: create Reed-Solomon files with the specified number of data stripes; -R and -Z set\n"
+    "       the number of recovery stripes, and stripe size.\n");
+  fprintf(logFile, "   -y: sync after each write, in order to include the chunk servers' time, and attribute\n"
+    "       the write latency to the chunk servers; otherwise the write latency is the buffering time.\n");
+  fprintf(logFile, "   -N: do not collect per chunk server statistics.\n");
+  fprintf(logFile, "   -o: result file, the default is stdout.\n");
+  fprintf(logFile, "eg:\n%s -s <metaserver-host> -p <metaserver-port> -t write -c localhost -n Proc_00 -f 8 -T 4 -o w.res\n", argv0);
+  exit(0);
+}
+
+void parse_options(int argc, char* argv[], Client* client)
+{
+  int c = 0;
+  while ((c = getopt(argc, argv, "s:p:t:m:c:n:f:T:z:b:i:d:r:S:R:Z:yNl:o:h")) != -1) {
+    switch (c) {
+      case 's': client->dfsServer_ = optarg; break;
+      case 'p': client->dfsPort_ = atoi(optarg); break;
+      case 't': client->testName_ = optarg; break;
+      case 'm': client->pattern_ = optarg; break;
+      case 'c': client->hostName_ = optarg; break;
+      case 'n': client->processName_ = optarg; break;
+      case 'f': client->files_ = atoi(optarg); break;
+      case 'T': client->threads_ = atoi(optarg); break;
+      case 'z': client->fileSize_ = strtoll(optarg, NULL, 0); break;
+      case 'b': client->ioSize_ = atoi(optarg); break;
+      case 'i': client->ioCount_ = strtoll(optarg, NULL, 0); break;
+      case 'd': client->duration_ = atoi(optarg); break;
+      case 'r': client->replicas_ = atoi(optarg); break;
+      case 'S': client->stripes_ = atoi(optarg); break;
+      case 'R': client->recoveryStripes_ = atoi(optarg); break;
+      case 'Z': client->stripeSize_ = atoi(optarg); break;
+      case 'y': client->syncFlag_ = true; break;
+      case 'N': client->serverStatsFlag_ = false; break;
+      case 'l': client->label_ = optarg; break;
+      case 'o': client->resultFile_ = optarg; break;
+      case 'h':
+      case '?':
+        Usage(argv[0]);
+        break;
+      default:
+        fprintf (logFile, "?? getopt returned character code 0%o ??\n", c);
+        Usage(argv[0]);
+        break;
+    }
+  }
+  if (client->pattern_.empty()) {
+    client->pattern_ = "seq";
+  }
+  if (client->dfsServer_.empty() || client->dfsPort_ <= 0 ||
+      client->hostName_.empty() || client->processName_.empty() ||
+      (client->testName_ != "write" && client->testName_ != "read" &&
+        client->testName_ != "append") ||
+      (client->pattern_ != "seq" && client->pattern_ != "rand") ||
+      client->files_ <= 0 || client->threads_ <= 0 || client->fileSize_ <= 0 ||
+      client->ioSize_ <= 0 || client->replicas_ <= 0 ||
+      (0 < client->stripes_ && (client->recoveryStripes_ < 0 || client->stripeSize_ <= 0))) {
+    Usage(argv[0]);
+  }
+  if (client->testName_ == "append" && client->pattern_ == "rand") {
+    fprintf(logFile, "Error: append supports only seq pattern\n");
+    exit(-1);
+  }
+  if (client->label_.empty()) {
+    client->label_ = client->testName_ + "_" + client->pattern_;
+  }
+  ostringstream os;
+  os << TEST_BASE_DIR << "/" << client->hostName_ << "_" << client->processName_;
+  client->testDir_ = os.str();
+}
+
+// Attributes the request latency to the chunk servers that host the chunks
+// of the requested range. For replicated files the first listed replica is
+// used.
+static void AddServerStats(Client* client, int fd, int64_t pos, int64_t len,
+  int64_t us, ServerStats& stats)
+{
+  vector< vector<string> > locations;
+  set<string> hosts;
+  if (client->kfsClient_->GetDataLocation(fd, pos, len, locations) >= 0) {
+    for (size_t i = 0; i < locations.size(); i++) {
+      if (!locations[i].empty()) {
+        hosts.insert(locations[i].front());
+      }
+    }
+  }
+  if (hosts.empty()) {
+    hosts.insert("unknown");
+  }
+  for (set<string>::const_iterator it = hosts.begin(); it != hosts.end(); ++it) {
+    stats[*it].Add(us, len);
+  }
+}
+
+static int OpenFile(Client* client, const string& path)
+{
+  KFS::KfsClient* const kfsClient = client->kfsClient_;
+  int fd;
+  if (client->testName_ == "read") {
+    fd = kfsClient->Open(path.c_str(), O_RDONLY);
+  } else if (client->testName_ == "append") {
+    fd = kfsClient->Open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT,
+      client->replicas_);
+  } else if (0 < client->stripes_) {
+    fd = kfsClient->Open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+      client->replicas_, client->stripes_, client->recoveryStripes_,
+      client->stripeSize_, KFS::KFS_STRIPED_FILE_TYPE_RS);
+  } else {
+    fd = kfsClient->Open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+      client->replicas_);
+  }
+  if (fd < 0) {
+    fprintf(logFile, "Open(%s) failed with rc=%d %s\n", path.c_str(), fd,
+      KFS::ErrorCodeToStr(fd).c_str());
+  }
+  return fd;
+}
+
+// Runs the workload on the files with index idx + k * threads.
+static int RunFiles(Client* client, int idx, Histogram& total, ServerStats& servers)
+{
+  KFS::KfsClient* const kfsClient = client->kfsClient_;
+  const bool writeFlag = client->testName_ != "read";
+  const bool randFlag = client->pattern_ == "rand";
+  const int64_t deadline = 0 < client->duration_ ?
+    Now() + (int64_t)client->duration_ * 1000 * 1000 : int64_t(-1);
+  const int64_t slots = max(int64_t(1), client->fileSize_ / client->ioSize_);
+  const int64_t ioCount = randFlag ?
+    (0 < client->ioCount_ ? client->ioCount_ : slots) :
+    (client->fileSize_ + client->ioSize_ - 1) / client->ioSize_;
+  vector<char> buf(client->ioSize_);
+  unsigned int seed = (unsigned int)(Now() ^ (idx * 7919));
+  for (size_t i = 0; i < buf.size(); i++) {
+    buf[i] = (char)rand_r(&seed);
+  }
+
+  for (int f = idx; f < client->files_; f += client->threads_) {
+    ostringstream os;
+    os << client->testDir_ << "/file_" << f;
+    const string path = os.str();
+    const int fd = OpenFile(client, path);
+    if (fd < 0) {
+      return fd;
+    }
+    if (!randFlag) {
+      kfsClient->SetIoBufferSize(fd, client->ioSize_);
+    }
+    int ret = 0;
+    int64_t pos = 0;
+    for (int64_t n = 0; n < ioCount; n++) {
+      if (0 <= deadline && deadline <= Now()) {
+        break;
+      }
+      size_t len = (size_t)client->ioSize_;
+      if (randFlag) {
+        pos = (int64_t)(((uint64_t)rand_r(&seed) << 31 | rand_r(&seed)) % slots) *
+          client->ioSize_;
+      } else {
+        len = (size_t)min((int64_t)len, client->fileSize_ - pos);
+      }
+      const int64_t start = Now();
+      ssize_t res;
+      if (writeFlag) {
+        res = randFlag ?
+          kfsClient->PWrite(fd, pos, &buf[0], len) :
+          kfsClient->Write(fd, &buf[0], len);
+        if (0 <= res && client->syncFlag_) {
+          const int err = kfsClient->Sync(fd);
+          if (err < 0) {
+            res = err;
+          }
+        }
+      } else {
+        res = randFlag ?
+          kfsClient->PRead(fd, pos, &buf[0], len) :
+          kfsClient->Read(fd, &buf[0], len);
+      }
+      const int64_t us = Now() - start;
+      if (res < 0) {
+        fprintf(logFile, "%s(%s, %lld, %lld) failed with rc=%d %s\n",
+          writeFlag ? "write" : "read", path.c_str(), (long long)pos,
+          (long long)len, (int)res, KFS::ErrorCodeToStr((int)res).c_str());
+        total.errors_++;
+        ret = (int)res;
+        break;
+      }
+      if (res == 0) {
+        break; // EOF
+      }
+      total.Add(us, res);
+      if (client->serverStatsFlag_ && (!writeFlag || client->syncFlag_)) {
+        AddServerStats(client, fd, pos, res, us, servers);
+      }
+      pos += res;
+    }
+    const int64_t start = Now();
+    const int err = kfsClient->Close(fd);
+    if (writeFlag && err == 0) {
+      // Account the final flush with no bytes.
+      total.Add(Now() - start, 0);
+    }
+    if (ret == 0 && err < 0) {
+      fprintf(logFile, "Close(%s) failed with rc=%d\n", path.c_str(), err);
+      ret = err;
+    }
+    if (ret != 0) {
+      return ret;
+    }
+    if (0 <= deadline && deadline <= Now()) {
+      break;
+    }
+  }
+  return 0;
+}
+
+class Worker : public QCRunnable
+{
+public:
+  Worker(Client* client, int idx)
+    : client_(client), idx_(idx), thread_() {}
+  int Start() {
+    return thread_.TryToStart(this, -1, "dstress");
+  }
+  void Join() {
+    thread_.Join();
+  }
+  virtual void Run() {
+    Histogram total;
+    ServerStats servers;
+    const int status = RunFiles(client_, idx_, total, servers);
+    QCStMutexLocker lock(client_->mutex_);
+    client_->total_.Merge(total);
+    for (ServerStats::const_iterator it = servers.begin(); it != servers.end(); ++it) {
+      client_->servers_[it->first].Merge(it->second);
+    }
+    if (status != 0 && client_->status_ == 0) {
+      client_->status_ = status;
+    }
+  }
+private:
+  Client* const client_;
+  const int idx_;
+  QCThread thread_;
+};
+
+static void WriteHistogram(FILE* out, const char* name,
+  const string& server, const Histogram& hist)
+{
+  fprintf(out, "%s %s count=%lld bytes=%lld sum_us=%lld errors=%lld",
+    name, server.c_str(), (long long)hist.count_, (long long)hist.bytes_,
+    (long long)hist.sum_, (long long)hist.errors_);
+  for (int i = 0; i < Histogram::kBuckets; i++) {
+    if (hist.buckets_[i] != 0) {
+      fprintf(out, " %d:%lld", i, (long long)hist.buckets_[i]);
+    }
+  }
+  fprintf(out, "\n");
+}
+
+static int WriteResult(Client* client, int64_t elapsedUs)
+{
+  FILE* out = stdout;
+  if (!client->resultFile_.empty() &&
+      !(out = fopen(client->resultFile_.c_str(), "w"))) {
+    const int err = errno;
+    fprintf(logFile, "Error: %s: %s\n", client->resultFile_.c_str(), strerror(err));
+    return (err > 0 ? -err : -EIO);
+  }
+  fprintf(out, "# dstress result 1\n");
+  fprintf(out, "label %s\n", client->label_.c_str());
+  fprintf(out, "test %s %s files=%d threads=%d file_size=%lld io_size=%d"
+    " replicas=%d stripes=%d recovery_stripes=%d stripe_size=%d sync=%d\n",
+    client->testName_.c_str(), client->pattern_.c_str(), client->files_,
+    client->threads_, (long long)client->fileSize_, client->ioSize_,
+    client->replicas_, client->stripes_, client->recoveryStripes_,
+    client->stripeSize_, client->syncFlag_ ? 1 : 0);
+  fprintf(out, "client %s_%s elapsed_us=%lld status=%d\n",
+    client->hostName_.c_str(), client->processName_.c_str(),
+    (long long)elapsedUs, client->status_);
+  WriteHistogram(out, "total", "-", client->total_);
+  for (ServerStats::const_iterator it = client->servers_.begin();
+      it != client->servers_.end(); ++it) {
+    WriteHistogram(out, "server", it->first, it->second);
+  }
+  const bool ok = fflush(out) == 0 && !ferror(out);
+  if (out != stdout) {
+    fclose(out);
+  }
+  return (ok ? 0 : -EIO);
+}
+
+int main(int argc, char* argv[])
+{
+  Client client;
+
+  parse_options(argc, argv, &client);
+
+  client.kfsClient_ = KFS::Connect(client.dfsServer_, client.dfsPort_);
+  if (!client.kfsClient_) {
+    fprintf(logFile, "kfs client failed to initialize. exiting.\n");
+    exit(-1);
+  }
+  if (client.testName_ != "read") {
+    const int err = client.kfsClient_->Mkdirs(client.testDir_.c_str());
+    if (err && err != -EEXIST) {
+      fprintf(logFile, "Error: mkdir %s failed: %d\n", client.testDir_.c_str(), err);
+      exit(-1);
+    }
+  }
+
+  client.status_ = 0;
+  const int64_t start = Now();
+  vector<Worker*> workers;
+  for (int i = 1; i < client.threads_; i++) {
+    Worker* const worker = new Worker(&client, i);
+    const int err = worker->Start();
+    if (err != 0) {
+      fprintf(logFile, "Error: failed to start thread: %s\n",
+        QCThread::GetErrorMsg(err).c_str());
+      delete worker;
+      exit(-1);
+    }
+    workers.push_back(worker);
+  }
+  Worker(&client, 0).Run();
+  for (size_t i = 0; i < workers.size(); i++) {
+    workers[i]->Join();
+    delete workers[i];
+  }
+  const int64_t elapsed = Now() - start;
+
+  const double sec = (double)max(int64_t(1), elapsed) * 1e-6;
+  fprintf(logFile, "Client: %s %s: %lld ops %lld bytes in %.3f sec, %.2f MB/sec, status: %d\n",
+    client.testName_.c_str(), client.pattern_.c_str(),
+    (long long)client.total_.count_, (long long)client.total_.bytes_, sec,
+    (double)client.total_.bytes_ / (sec * (1 << 20)), client.status_);
+
+  const int err = WriteResult(&client, elapsed);
+  delete client.kfsClient_;
+  return ((client.status_ != 0 || err != 0) ? 1 : 0);
+}
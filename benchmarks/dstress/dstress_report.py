@@ -0,0 +1,219 @@
+#!/usr/bin/env python
+
+#
+# $Id$
+#
+# Copyright 2026 Quantcast Corp.
+#
+# Licensed under the Apache License, Version 2.0 (the "License"); you may not
+# use this file except in compliance with the License. You may obtain a copy
+# of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+# License for the specific language governing permissions and limitations
+# under the License.
+#
+# Merges dstress_client result files of one run, possibly from many client
+# hosts, and reports the aggregate throughput and latency percentiles, in
+# total and per chunk server. With --baseline, compares the run with the
+# merged results of the baseline run, and exits with status 2 if the
+# throughput or any of the latency percentiles regressed by more than the
+# threshold.
+#
+
+import optparse
+import sys
+
+SUB_BITS = 4
+PERCENTILES = (50, 90, 99, 99.9)
+
+
+class Histogram:
+  def __init__(self):
+    self.count = 0
+    self.bytes = 0
+    self.sum_us = 0
+    self.errors = 0
+    self.buckets = {}
+
+  def merge(self, fields):
+    for f in fields:
+      if '=' in f:
+        k, v = f.split('=', 1)
+        if k == 'count':
+          self.count += int(v)
+        elif k == 'bytes':
+          self.bytes += int(v)
+        elif k == 'sum_us':
+          self.sum_us += int(v)
+        elif k == 'errors':
+          self.errors += int(v)
+      elif ':' in f:
+        b, c = f.split(':', 1)
+        self.buckets[int(b)] = self.buckets.get(int(b), 0) + int(c)
+
+  # Returns the bucket's upper bound in microseconds.
+  @staticmethod
+  def bucket_value(b):
+    if b < (1 << SUB_BITS):
+      return b
+    msb = (b >> SUB_BITS) + SUB_BITS - 1
+    sub = b & ((1 << SUB_BITS) - 1)
+    return ((1 << SUB_BITS) + sub + 1) << (msb - SUB_BITS)
+
+  def percentile(self, p):
+    total = sum(self.buckets.values())
+    if total <= 0:
+      return 0
+    limit = total * p / 100.0
+    acc = 0
+    for b in sorted(self.buckets.keys()):
+      acc += self.buckets[b]
+      if acc >= limit:
+        return self.bucket_value(b)
+    return self.bucket_value(max(self.buckets.keys()))
+
+
+class Run:
+  def __init__(self):
+    self.label = None
+    self.test = None
+    self.clients = 0
+    self.elapsed_us = 0
+    self.failed = 0
+    self.total = Histogram()
+    self.servers = {}
+
+  def load(self, name):
+    f = open(name, 'r')
+    try:
+      for line in f:
+        fields = line.split()
+        if not fields or fields[0].startswith('#'):
+          continue
+        if fields[0] == 'label':
+          self.label = ' '.join(fields[1:])
+        elif fields[0] == 'test':
+          test = ' '.join(fields[1:])
+          if self.test is not None and self.test != test:
+            sys.stderr.write('%s: test parameters differ: %s\n' % (name, test))
+          self.test = test
+        elif fields[0] == 'client':
+          self.clients += 1
+          for fld in fields[2:]:
+            k, v = fld.split('=', 1)
+            if k == 'elapsed_us':
+              # The clients run concurrently, use the longest run time.
+              self.elapsed_us = max(self.elapsed_us, int(v))
+            elif k == 'status' and int(v) != 0:
+              self.failed += 1
+        elif fields[0] == 'total':
+          self.total.merge(fields[2:])
+        elif fields[0] == 'server':
+          self.servers.setdefault(fields[1], Histogram()).merge(fields[2:])
+    finally:
+      f.close()
+
+  def throughput(self, hist=None):
+    if hist is None:
+      hist = self.total
+    return hist.bytes / (max(1, self.elapsed_us) * 1e-6) / (1 << 20)
+
+
+def stats(run, hist):
+  r = {'MB/s': run.throughput(hist), 'ops': hist.count}
+  if hist.count > 0:
+    r['avg_us'] = hist.sum_us / float(hist.count)
+  for p in PERCENTILES:
+    r['p%s_us' % p] = hist.percentile(p)
+  return r
+
+
+def format_stats(name, s, base=None):
+  keys = ['MB/s', 'ops', 'avg_us'] + ['p%s_us' % p for p in PERCENTILES]
+  out = '%-24s' % name
+  for k in keys:
+    if k not in s:
+      continue
+    out += ' %s=%.1f' % (k, s[k])
+    if base is not None and k in base and base[k] > 0:
+      out += '(%+.1f%%)' % ((s[k] - base[k]) * 100.0 / base[k])
+  return out
+
+
+def regressions(s, base, threshold):
+  res = []
+  if not base:
+    return res
+  if base.get('MB/s', 0) > 0 and s['MB/s'] < base['MB/s'] * (1 - threshold):
+    res.append('MB/s')
+  for p in PERCENTILES:
+    k = 'p%s_us' % p
+    if base.get(k, 0) > 0 and s.get(k, 0) > base[k] * (1 + threshold):
+      res.append(k)
+  return res
+
+
+def load_run(files):
+  run = Run()
+  for name in files:
+    run.load(name)
+  return run
+
+
+def main():
+  parser = optparse.OptionParser(
+    usage='%prog [options] result-file...',
+    description='Merge and compare dstress_client results.')
+  parser.add_option('-b', '--baseline', action='append', default=[],
+    help='baseline run result file, can be specified more than once')
+  parser.add_option('-t', '--threshold', type='float', default=10.0,
+    help='regression threshold in percent, the default is %default')
+  parser.add_option('-S', '--no-servers', action='store_true', default=False,
+    help='do not report per chunk server statistics')
+  opts, args = parser.parse_args()
+  if not args:
+    parser.error('no result files')
+
+  run = load_run(args)
+  base = load_run(opts.baseline) if opts.baseline else None
+  threshold = opts.threshold / 100.0
+
+  sys.stdout.write('run: %s clients: %d failed: %d elapsed: %.3f sec\n' % (
+    run.label, run.clients, run.failed, run.elapsed_us * 1e-6))
+  sys.stdout.write('test: %s\n' % run.test)
+  if base is not None:
+    sys.stdout.write('baseline: %s clients: %d\n' % (base.label, base.clients))
+    if base.test != run.test:
+      sys.stdout.write('warning: baseline test parameters differ: %s\n' %
+        base.test)
+
+  regressed = []
+  s = stats(run, run.total)
+  b = stats(base, base.total) if base is not None else None
+  sys.stdout.write(format_stats('total', s, b) + '\n')
+  regressed += ['total ' + r for r in regressions(s, b, threshold)]
+  if not opts.no_servers:
+    for name in sorted(run.servers.keys()):
+      s = stats(run, run.servers[name])
+      b = None
+      if base is not None and name in base.servers:
+        b = stats(base, base.servers[name])
+      sys.stdout.write(format_stats(name, s, b) + '\n')
+      regressed += [name + ' ' + r for r in regressions(s, b, threshold)]
+
+  if run.failed:
+    sys.stdout.write('FAILED: %d clients reported errors\n' % run.failed)
+    return 1
+  if regressed:
+    sys.stdout.write('REGRESSED: %s\n' % ', '.join(regressed))
+    return 2
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main())
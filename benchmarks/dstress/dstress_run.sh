@@ -0,0 +1,84 @@
+#!/bin/sh
+#
+# $Id$
+#
+# Copyright 2026 Quantcast Corp.
+#
+# Licensed under the Apache License, Version 2.0 (the "License"); you may not
+# use this file except in compliance with the License. You may obtain a copy
+# of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+# License for the specific language governing permissions and limitations
+# under the License.
+#
+# Runs dstress_client concurrently on the client hosts via ssh, collects the
+# result files into the output directory, and reports the merged results.
+# The dstress_client binary is expected to be at the same path on all hosts.
+#
+
+usage() {
+    echo "Usage: $0 -s metaserver-host -p metaserver-port -H host1,host2,... -o output-dir"
+    echo "   [-P processes-per-host] [-C dstress_client-path] [-b baseline-dir] -- dstress_client options"
+    echo "eg: $0 -s meta -p 20000 -H c1,c2 -o /tmp/w1 -- -t write -f 8 -T 4 -S 6 -R 3"
+    exit 1
+}
+
+client=dstress_client
+procs=1
+server=
+port=
+hosts=
+outdir=
+baseline=
+while getopts "s:p:H:o:P:C:b:h" opt; do
+    case $opt in
+        s) server=$OPTARG ;;
+        p) port=$OPTARG ;;
+        H) hosts=$OPTARG ;;
+        o) outdir=$OPTARG ;;
+        P) procs=$OPTARG ;;
+        C) client=$OPTARG ;;
+        b) baseline=$OPTARG ;;
+        *) usage ;;
+    esac
+done
+shift $(($OPTIND - 1))
+[ -n "$server" -a -n "$port" -a -n "$hosts" -a -n "$outdir" ] || usage
+
+mkdir -p "$outdir" || exit
+pids=
+for host in $(echo "$hosts" | tr ',' ' '); do
+    i=0
+    while [ $i -lt $procs ]; do
+        name=proc_$i
+        ssh -n "$host" "$client" -s "$server" -p "$port" -c "$host" -n "$name" \
+            -o "/tmp/dstress_${name}.res" "$@" \
+            > "$outdir/$host.$name.log" 2>&1 &
+        pids="$pids $!"
+        i=$(($i + 1))
+    done
+done
+status=0
+for pid in $pids; do
+    wait $pid || status=1
+done
+for host in $(echo "$hosts" | tr ',' ' '); do
+    i=0
+    while [ $i -lt $procs ]; do
+        scp -q "$host:/tmp/dstress_proc_$i.res" "$outdir/$host.proc_$i.res" || status=1
+        i=$(($i + 1))
+    done
+done
+[ $status -eq 0 ] || echo "Some clients failed, see $outdir/*.log"
+
+report=$(dirname "$0")/dstress_report.py
+if [ -n "$baseline" ]; then
+    python "$report" $(for f in "$baseline"/*.res; do echo -b "$f"; done) "$outdir"/*.res
+else
+    python "$report" "$outdir"/*.res
+fi
@@ -44,6 +44,7 @@ class Globals:
   KFS_SERVER_KEYWORD = "metaserver"
   HDFS_SERVER_CMD = "java"
   HDFS_SERVER_KEYWORD = "NameNode"
+  PLAN_MIX = None
 
 
 def ParseCommandline():
@@ -134,7 +135,7 @@ def PrintMemoryUsage(opts):
 
 def RunMStressMaster(opts, hostsList):
   """ Called when run in master mode. Calls master funcions for 'create',
-       'stat', and 'readdir'.
+       'stat', 'readdir', 'mixed' if the plan has op mix, and 'delete'.
 
   Args:
     opts: options object, from parsed commandine options.
@@ -168,6 +169,15 @@ def RunMStressMaster(opts, hostsList):
   print '\nMaster: Readdir test took %d.%d sec' % (deltaTime.seconds, deltaTime.microseconds/1000000)
   print '=========================================='
 
+  if Globals.PLAN_MIX and opts.filesystem == 'qfs':
+    startTime = datetime.datetime.now()
+    if RunMStressMasterTest(opts, hostsList, 'mixed') == False:
+      return False
+    deltaTime = datetime.datetime.now() - startTime
+    print '\nMaster: Mixed test took %d.%d sec' % (deltaTime.seconds, deltaTime.microseconds/1000000)
+    PrintMemoryUsage(opts)
+    print '=========================================='
+
   if opts.leave_files:
     print "\nNot deleting files because of -l option"
     return False
@@ -356,6 +366,9 @@ def ReadPlanFile(opts):
   numLevels = None
   numToStat = None
   nodesPerLevel = None
+  mixRate = 0
+  mixOps = 0
+  mixDuration = 0
 
   planfile = open(opts.plan, 'r')
   for line in planfile:
@@ -373,6 +386,14 @@ def ReadPlanFile(opts):
       numToStat = int(line[len('nstat='):].strip())
     elif line.startswith('inodes='):
       nodesPerLevel = int(line[len('inodes='):].strip())
+    elif line.startswith('mix='):
+      Globals.PLAN_MIX = line[len('mix='):].strip()
+    elif line.startswith('rate='):
+      mixRate = float(line[len('rate='):].strip())
+    elif line.startswith('nops='):
+      mixOps = int(line[len('nops='):].strip())
+    elif line.startswith('duration='):
+      mixDuration = int(line[len('duration='):].strip())
   planfile.close()
   if None in (hostsList, clientsPerHost, leafType, numLevels, numToStat, nodesPerLevel):
     sys.exit('Failed to read plan file')
@@ -395,6 +416,13 @@ def ReadPlanFile(opts):
         '   o Overall, %d leaf %ss will be created, %d intermediate directories will be created.\n' % (overallLeafs, leafType, intermediateNodes) +
         '   o Stat will be done on a random subset of %d leaf %ss by each client process, totalling %d stats.\n' % (numToStat, leafType, totalNumToStat) +
         '   o Readdir (non-overlapping) will be done on the full file tree by all client processes.\n')
+  if Globals.PLAN_MIX:
+    print ('   o Mixed ops %s will be done by each client process, %s ops, %s sec, at %s.\n' % (
+        Globals.PLAN_MIX,
+        mixOps > 0 and str(mixOps) or 'unlimited',
+        mixDuration > 0 and str(mixDuration) or 'unlimited',
+        mixRate > 0 and '%g ops/sec' % mixRate or 'closed loop') +
+        (opts.filesystem != 'qfs' and '     Mixed test is only supported with qfs, and will be skipped.\n' or ''))
   return hostsList, clientsPerHost
 
 
@@ -35,6 +35,7 @@
 #include <string>
 #include <vector>
 #include <queue>
+#include <map>
 #include <algorithm>
 
 using namespace std;
@@ -49,7 +50,7 @@ FILE* logFile = stdout;
 /*
   This program is invoked with the following arguments:
     - qfs server/port
-    - test name ('create', 'stat', or 'readdir')
+    - test name ('create', 'stat', 'readdir', 'mixed', or 'delete')
     - a planfile
     - keys to read the planfile (hostname and process name)
 
@@ -75,8 +76,79 @@ FILE* logFile = stdout;
   /mstress/127.0.0.1_proc_00/PPP_2/PPP_0
   /mstress/127.0.0.1_proc_00/PPP_2/PPP_1
   /mstress/127.0.0.1_proc_00/PPP_2/PPP_2
+
+  The 'mixed' test runs on the tree created by 'create', and uses the
+  following plan file keys:
+  ---------------------------------------------
+  #Op percentages, of stat, readdir, create, mkdir, rename, and remove
+  mix=stat:70,create:10,readdir:10,rename:10
+  #Target ops per second, per client, or 0 to issue ops back to back
+  rate=500
+  #Number of ops per client, 0 for no limit
+  nops=100000
+  #Run time limit in seconds, 0 for no limit
+  duration=60
+  ---------------------------------------------
+  stat picks a random leaf, readdir a random leaf's parent directory. create
+  and mkdir add a new entry to a random leaf's parent directory, rename moves
+  and remove deletes one of the files that the client created. The entries
+  are removed by the 'delete' test.
+  With non 0 rate the ops are scheduled at fixed intervals, and the latency is
+  measured from the scheduled time, not from the time the op was issued, in
+  order to account for the queuing delay once the server falls behind.
 */
 
+// Log linear latency histogram in microseconds, with 16 sub-buckets per power
+// of two, i.e. with less than 7% value error.
+struct Histogram {
+  enum { kSubBits = 4, kBuckets = 60 << kSubBits };
+
+  Histogram() : count_(0), sum_(0), max_(0), buckets_(kBuckets, 0) {}
+
+  static int Bucket(long long us) {
+    if (us < (1 << kSubBits)) {
+      return (int)(us < 0 ? 0 : us);
+    }
+    const int msb = 63 - __builtin_clzll((unsigned long long)us);
+    const int sub = (int)((us >> (msb - kSubBits)) & ((1 << kSubBits) - 1));
+    return min((int)kBuckets - 1, ((msb - kSubBits + 1) << kSubBits) + sub);
+  }
+
+  // Returns the bucket's upper bound.
+  static long long Value(int bucket) {
+    if (bucket < (1 << kSubBits)) {
+      return bucket;
+    }
+    const int msb = (bucket >> kSubBits) + kSubBits - 1;
+    const int sub = bucket & ((1 << kSubBits) - 1);
+    return ((long long)((1 << kSubBits) + sub + 1)) << (msb - kSubBits);
+  }
+
+  void Add(long long us) {
+    count_++;
+    sum_ += us;
+    max_ = max(max_, us);
+    buckets_[Bucket(us)]++;
+  }
+
+  long long Percentile(double pct) const {
+    const double limit = count_ * pct / 100.;
+    long long acc = 0;
+    for (int i = 0; i < kBuckets; i++) {
+      acc += buckets_[i];
+      if (0 < acc && limit <= acc) {
+        return min(Value(i), max_);
+      }
+    }
+    return max_;
+  }
+
+  long long count_;
+  long long sum_;
+  long long max_;
+  vector<long long> buckets_;
+};
+
 
 //Global datastructure to hold various options.
 struct Client {
@@ -134,6 +206,13 @@ struct Client {
   int levels_;
   int inodesPerLevel_;
   int pathsToStat_;
+  vector<pair<string, int> > mix_;
+  double rate_;
+  long long nops_;
+  int duration_;
+
+  //latency per op type
+  map<string, Histogram> latency_;
 };
 const size_t Client::INITIAL_SIZE = 1 << 12;
 
@@ -162,7 +241,7 @@ private:
 
 void Usage(const char* argv0)
 {
-  fprintf(logFile, "Usage: %s -s dfs-server -p dfs-port [-t [create|stat|readdir|delete] -a planfile-path -c host -n process-name -P path-prefix]\n", argv0);
+  fprintf(logFile, "Usage: %s -s dfs-server -p dfs-port [-t [create|stat|readdir|mixed|delete] -a planfile-path -c host -n process-name -P path-prefix]\n", argv0);
   fprintf(logFile, "   -t: this option requires -a, -c, and -n options.\n");
   fprintf(logFile, "   -P: the default value is PATH_.\n");
   fprintf(logFile, "eg:\n%s -s <metaserver-host> -p <metaserver-port> -t create -a <planfile> -c localhost -n Proc_00\n", argv0);
@@ -278,12 +357,17 @@ void parse_options(int argc, char* argv[], Client* client)
 }
 
 //Reads the plan file and add the level information to distribution_ vector.
-//Also set type_, prefix_, levels_, pathsToStat_ class variables.
+//Also set type_, prefix_, levels_, pathsToStat_ class variables, and the
+//'mixed' test mix_, rate_, nops_, and duration_.
 void ParsePlanFile(Client* client)
 {
   string line;
   ifstream ifs(client->planfilePath_.c_str(), ifstream::in);
 
+  client->rate_ = 0;
+  client->nops_ = 0;
+  client->duration_ = 0;
+
   while (ifs.good()) {
     getline(ifs, line);
     if (line.empty() || line[0] == '#') {
@@ -305,6 +389,34 @@ void ParsePlanFile(Client* client)
       client->pathsToStat_ = atoi(line.substr(6).c_str());
       continue;
     }
+    if (line.substr(0, 4) == "mix=") {
+      istringstream is(line.substr(4));
+      string item;
+      while (getline(is, item, ',')) {
+        const size_t pos = item.find(':');
+        const int pct = pos == string::npos ? 0 : atoi(item.substr(pos + 1).c_str());
+        const string op = item.substr(0, pos);
+        if (pct <= 0 || (op != "stat" && op != "readdir" && op != "create" &&
+            op != "mkdir" && op != "rename" && op != "remove")) {
+          fprintf(logFile, "Error parsing plan file mix: %s\n", item.c_str());
+          exit(-1);
+        }
+        client->mix_.push_back(make_pair(op, pct));
+      }
+      continue;
+    }
+    if (line.substr(0, 5) == "rate=") {
+      client->rate_ = atof(line.substr(5).c_str());
+      continue;
+    }
+    if (line.substr(0, 5) == "nops=") {
+      client->nops_ = atoll(line.substr(5).c_str());
+      continue;
+    }
+    if (line.substr(0, 9) == "duration=") {
+      client->duration_ = atoi(line.substr(9).c_str());
+      continue;
+    }
   }
   ifs.close();
   if (client->levels_ <= 0 || client->inodesPerLevel_ <= 0 || client->type_.empty()) {
@@ -321,6 +433,29 @@ long TimeDiffMilliSec(struct timeval* alpha, struct timeval* zigma)
   return diff < 0 ? 0 : diff;
 }
 
+long long NowMicroSec()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (long long)tv.tv_sec * 1000 * 1000 + tv.tv_usec;
+}
+
+void PrintLatency(Client* client)
+{
+  for (map<string, Histogram>::const_iterator it = client->latency_.begin();
+      it != client->latency_.end(); ++it) {
+    const Histogram& h = it->second;
+    if (h.count_ <= 0) {
+      continue;
+    }
+    fprintf(logFile, "Client: %s latency usec: count=%lld avg=%lld p50=%lld"
+      " p90=%lld p99=%lld p99.9=%lld p99.99=%lld max=%lld\n",
+      it->first.c_str(), h.count_, h.sum_ / h.count_,
+      h.Percentile(50), h.Percentile(90), h.Percentile(99),
+      h.Percentile(99.9), h.Percentile(99.99), h.max_);
+  }
+}
+
 
 int CreateDFSPaths(Client* client, AutoCleanupKfsClient* kfs, int level, int* createdCount)
 {
@@ -338,7 +473,9 @@ int CreateDFSPaths(Client* client, AutoCleanupKfsClient* kfs, int level, int* cr
 
     if (isDir) {
       //fprintf(logFile, "Creating DIR [%s]\n", client->path_.actualPath_);
+      const long long start = NowMicroSec();
       rc = kfsClient->Mkdir(client->path_.String());
+      client->latency_["mkdir"].Add(NowMicroSec() - start);
       if (rc < 0) {
         fprintf(logFile, "Mkdir(%s) failed with rc=%d\n", client->path_.String(), rc);
         return rc;
@@ -356,7 +493,9 @@ int CreateDFSPaths(Client* client, AutoCleanupKfsClient* kfs, int level, int* cr
       }
     } else {
       //fprintf(logFile, "Creating file [%s]\n", client->path_.actualPath_);
+      const long long start = NowMicroSec();
       rc = kfsClient->Create(client->path_.String());
+      client->latency_["create"].Add(NowMicroSec() - start);
       if (rc < 0) {
         fprintf(logFile, "Create(%s) failed with rc=%d\n", client->path_.String(), rc);
         return rc;
@@ -426,9 +565,11 @@ int StatDFSPaths(Client* client, AutoCleanupKfsClient* kfs) {
     //fprintf(logFile, "Stat: doing stat on [%s]\n", client->path_.actualPath_);
 
     KFS::KfsFileAttr attr;
-    int err = kfsClient->Stat(os.str().c_str(), attr);
+    const long long start = NowMicroSec();
+    int err = kfsClient->Stat(client->path_.String(), attr);
+    client->latency_["stat"].Add(NowMicroSec() - start);
     if (err) {
-      fprintf(logFile, "error doing stat on %s\n", os.str().c_str());
+      fprintf(logFile, "error doing stat on %s\n", client->path_.String());
       return err;
     }
 
@@ -462,7 +603,9 @@ int ListDFSPaths(Client* client, AutoCleanupKfsClient* kfs) {
     pending.pop();
     //fprintf(logFile, "readdir on parent [%s]\n", parent.c_str());
     vector<KFS::KfsFileAttr> children;
+    const long long start = NowMicroSec();
     int err = kfsClient->ReaddirPlus(parent.c_str(), children);
+    client->latency_["readdir"].Add(NowMicroSec() - start);
     if (err) {
       fprintf(logFile, "Error [err=%d] reading directory %s\n", err, parent.c_str());
       return err;
@@ -544,14 +687,17 @@ int RemoveDFSPaths(Client* client, AutoCleanupKfsClient* kfs) {
 
     pathToDel = os.str() + "/" + pathSoFar;
     //fprintf(logFile, "Client: Deleting %s ...\n", pathToDel.c_str());
+    const long long start = NowMicroSec();
     if (isLeafDir) {
       err = kfsClient->Rmdir(pathToDel.c_str());
+      client->latency_["rmdir"].Add(NowMicroSec() - start);
       if (err) {
         fprintf(logFile, "Error [err=%d] deleting directory %s\n", err, pathToDel.c_str());
         return err;
       }
     } else {
       err = kfsClient->Remove(pathToDel.c_str());
+      client->latency_["remove"].Add(NowMicroSec() - start);
       if (err) {
         fprintf(logFile, "Error [err=%d] deleting file %s\n", err, pathToDel.c_str());
         return err;
@@ -572,6 +718,134 @@ int RemoveDFSPaths(Client* client, AutoCleanupKfsClient* kfs) {
   return 0;
 }
 
+//Sets path to a random path of the given depth in the client's tree.
+void RandomTreePath(Client* client, const string& base, int depth, string& path)
+{
+  char sfx[32];
+  path = base;
+  for (int d = 0; d < depth; d++) {
+    myitoa(rand() % client->inodesPerLevel_, sfx);
+    path += "/" + client->prefix_ + sfx;
+  }
+}
+
+int MixedDFSOps(Client* client, AutoCleanupKfsClient* kfs) {
+  KFS::KfsClient* kfsClient = kfs->GetClient();
+
+  if (client->mix_.empty() || (client->nops_ <= 0 && client->duration_ <= 0)) {
+    fprintf(logFile, "Error: mixed test requires mix, and nops or duration in plan file\n");
+    return -1;
+  }
+  int total = 0;
+  for (size_t i = 0; i < client->mix_.size(); i++) {
+    total += client->mix_[i].second;
+  }
+
+  ostringstream os;
+  os << TEST_BASE_DIR << "/" << client->hostName_ + "_" << client->processName_;
+  const string base = os.str();
+
+  srand(time(NULL) ^ getpid());
+  struct timeval tvAlpha;
+  gettimeofday(&tvAlpha, NULL);
+  const long long startUs = NowMicroSec();
+  const long long endUs = client->duration_ > 0 ?
+    startUs + (long long)client->duration_ * 1000 * 1000 : 0;
+
+  vector<string> created;
+  string path;
+  string dir;
+  long long seq = 0;
+  long long count = 0;
+  long long lateCount = 0;
+  for (; client->nops_ <= 0 || count < client->nops_; count++) {
+    long long scheduled = NowMicroSec();
+    if (client->rate_ > 0) {
+      const long long next = startUs + (long long)(count * 1e6 / client->rate_);
+      if (scheduled < next) {
+        usleep(next - scheduled);
+      } else if (next < scheduled) {
+        lateCount++;
+      }
+      scheduled = next;
+    }
+    if (endUs > 0 && endUs <= NowMicroSec()) {
+      break;
+    }
+
+    int pick = rand() % total;
+    size_t k = 0;
+    while (client->mix_[k].second <= pick) {
+      pick -= client->mix_[k++].second;
+    }
+    string op = client->mix_[k].first;
+    if ((op == "rename" || op == "remove") && created.empty()) {
+      op = "create";
+    }
+
+    int err = 0;
+    if (op == "stat") {
+      RandomTreePath(client, base, client->levels_, path);
+      KFS::KfsFileAttr attr;
+      err = kfsClient->Stat(path.c_str(), attr);
+    } else if (op == "readdir") {
+      RandomTreePath(client, base, client->levels_ - 1, path);
+      vector<KFS::KfsFileAttr> children;
+      err = kfsClient->ReaddirPlus(path.c_str(), children);
+    } else if (op == "create" || op == "mkdir") {
+      RandomTreePath(client, base, client->levels_ - 1, dir);
+      ostringstream name;
+      name << dir << "/mix_" << seq++;
+      path = name.str();
+      if (op == "mkdir") {
+        err = kfsClient->Mkdir(path.c_str());
+      } else {
+        const int fd = kfsClient->Create(path.c_str());
+        if (fd < 0) {
+          err = fd;
+        } else {
+          kfsClient->Close(fd);
+          created.push_back(path);
+        }
+      }
+    } else if (op == "rename") {
+      const size_t idx = rand() % created.size();
+      RandomTreePath(client, base, client->levels_ - 1, dir);
+      ostringstream name;
+      name << dir << "/mix_" << seq++;
+      path = created[idx];
+      err = kfsClient->Rename(path.c_str(), name.str().c_str());
+      if (!err) {
+        created[idx] = name.str();
+      }
+    } else {
+      const size_t idx = rand() % created.size();
+      path = created[idx];
+      err = kfsClient->Remove(path.c_str());
+      if (!err) {
+        created[idx] = created.back();
+        created.pop_back();
+      }
+    }
+    client->latency_[op].Add(NowMicroSec() - scheduled);
+    if (err) {
+      fprintf(logFile, "Error [err=%d] %s %s\n", err, op.c_str(), path.c_str());
+      return err;
+    }
+
+    if (count > 0 && count % COUNT_INCR == 0) {
+      fprintf(logFile, "Mixed ops so far: %lld\n", count);
+    }
+  }
+
+  struct timeval tvZigma;
+  gettimeofday(&tvZigma, NULL);
+  const long msec = TimeDiffMilliSec(&tvAlpha, &tvZigma);
+  fprintf(logFile, "Client: %lld mixed ops done in %ld msec, %.1f ops/sec, %lld ops"
+    " issued behind schedule\n", count, msec, count * 1e3 / max(1L, msec), lateCount);
+  return 0;
+}
+
 
 int main(int argc, char* argv[])
 {
@@ -594,12 +868,15 @@ int main(int argc, char* argv[])
     result = StatDFSPaths(&client, &kfs);
   } else if (client.testName_ == "readdir") {
     result = ListDFSPaths(&client, &kfs);
+  } else if (client.testName_ == "mixed") {
+    result = MixedDFSOps(&client, &kfs);
   } else if (client.testName_ == "delete") {
     result = RemoveDFSPaths(&client, &kfs);
   } else {
     fprintf(logFile, "Error: unrecognized test '%s'", client.testName_.c_str());
     return -1;
   }
+  PrintLatency(&client);
   return result;
 }
 
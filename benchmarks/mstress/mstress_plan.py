@@ -53,7 +53,10 @@ def ParseCommandline():
          '(3+9+27+81=120) per client process. Since there are 3 ' +
          'processes on 2 hosts, we create 120x6=720 inodes. We will attempt ' +
          'to stat 100 random leaf paths using all client processes. We will do a readdir ' +
-         'all through the directory tree.')
+         'all through the directory tree. ' +
+         'Use "-l 1 -i 1000000" for a huge directory, and "-l 64 -i 1" for a deep ' +
+         'tree. With "-m stat:70,create:10,readdir:10,rename:10 -r 200 -d 60" ' +
+         'each client process would also run 200 mixed ops per second for 60 seconds.')
 
   parser = optparse.OptionParser(epilog=epi)
 
@@ -87,6 +90,27 @@ def ParseCommandline():
                     default=100,
                     type='int',
                     help='Number of inodes to stat (<=total leaf inodes).')
+  parser.add_option('-m', '--mix',
+                    action='store',
+                    default=None,
+                    type='string',
+                    help='Mixed test op percentages, e.g. stat:70,create:10,readdir:10,rename:10. ' +
+                    'The ops are stat, readdir, create, mkdir, rename, and remove.')
+  parser.add_option('-r', '--rate',
+                    action='store',
+                    default=0,
+                    type='float',
+                    help='Mixed test target ops per second per client process, 0 for closed loop.')
+  parser.add_option('-x', '--num-ops',
+                    action='store',
+                    default=0,
+                    type='int',
+                    help='Mixed test ops per client process, 0 for no limit.')
+  parser.add_option('-d', '--duration',
+                    action='store',
+                    default=0,
+                    type='int',
+                    help='Mixed test run time in seconds, 0 for no limit.')
   parser.add_option('-o', '--output-file',
                     action='store',
                     default=None,
@@ -97,6 +121,9 @@ def ParseCommandline():
   if args:
     sys.exit('Unexpected arguments: %s.' % str(args))
 
+  if opts.mix is not None and opts.num_ops <= 0 and opts.duration <= 0:
+    sys.exit('Mixed test requires --num-ops or --duration.')
+
   if opts.output_file is None:
     opts.output_file = '/tmp/mstress_%s_%s.plan' % (getpass.getuser(), time.strftime("%F-%H-%M-%S", time.gmtime()))
 
@@ -123,6 +150,11 @@ def main():
   outfile.write('#Number of levels in created tree\nlevels=%d\n' % opts.levels)
   outfile.write('#Number of inodes per level\ninodes=%d\n' % opts.inodes_per_level)
   outfile.write('#Number of random paths to stat, per client\nnstat=%d\n' % statPerClient)
+  if opts.mix is not None:
+    outfile.write('#Mixed test op percentages\nmix=%s\n' % opts.mix)
+    outfile.write('#Mixed test target ops per second, per client\nrate=%g\n' % opts.rate)
+    outfile.write('#Mixed test ops per client\nnops=%d\n' % opts.num_ops)
+    outfile.write('#Mixed test run time in seconds\nduration=%d\n' % opts.duration)
   
   """ old code
   begin_tree_delta = 0
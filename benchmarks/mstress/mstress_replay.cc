@@ -0,0 +1,719 @@
+/**
+ * $Id$
+ *
+ * Copyright 2026 Quantcast Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy
+ * of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * Replays the meta server audit log against a test meta server, and reports
+ * per op latency percentiles.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <netdb.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+using namespace std;
+
+#include "qcdio/QCThread.h"
+#include "qcdio/QCMutex.h"
+#include "qcdio/qcstutils.h"
+
+FILE* logFile = stdout;
+
+/*
+  The audit log records are the request headers, as received by the meta
+  server, followed by the client ip, the authenticated user id, and the op
+  status, for example:
+
+  10-14-2026 12:00:00.123 INFO - LOOKUP\r\n
+  Cseq: 10\r\n
+  Version: KFS/1.0\r\n
+  Client-Protocol-Version: 114\r\n
+  Parent File-handle: 2\r\n
+  Filename: foo\r\n
+  \r\n
+  Client-ip: 10.0.0.1\r\n
+  Status: 0\0\n
+
+  The time stamp is the time the meta server logged the completion of the op,
+  with millisecond resolution.
+
+  Each distinct client ip is replayed by its own session, with the specified
+  number of connections, and therefore threads. The ops are queued to their
+  session at the original time offset from the first record divided by the
+  speedup, and each session connection sends the queued ops in order, one at a
+  time. The latency is measured from the time the op was sent, and the lag from
+  the time the op was scheduled to the time it was sent, i.e. the lag shows
+  how far the replay falls behind the original op stream.
+
+  The requests are sent as is, except Cseq, therefore the replay is only
+  meaningful against a meta server restored from a checkpoint and transaction
+  logs that match the start of the audit log. The op status is compared with
+  the original status, in order to detect where the replay diverges.
+*/
+
+static int64_t Now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (int64_t)tv.tv_sec * 1000 * 1000 + tv.tv_usec;
+}
+
+// Log linear latency histogram in microseconds, with 16 sub-buckets per power
+// of two, i.e. with less than 7% value error.
+struct Histogram {
+  enum { kSubBits = 4, kBuckets = 60 << kSubBits };
+
+  Histogram() : count_(0), sum_(0), max_(0), buckets_(kBuckets, 0) {}
+
+  static int Bucket(int64_t us) {
+    if (us < (1 << kSubBits)) {
+      return (int)(us < 0 ? 0 : us);
+    }
+    const int msb = 63 - __builtin_clzll((unsigned long long)us);
+    const int sub = (int)((us >> (msb - kSubBits)) & ((1 << kSubBits) - 1));
+    return min((int)kBuckets - 1, ((msb - kSubBits + 1) << kSubBits) + sub);
+  }
+
+  // Returns the bucket's upper bound.
+  static int64_t Value(int bucket) {
+    if (bucket < (1 << kSubBits)) {
+      return bucket;
+    }
+    const int msb = (bucket >> kSubBits) + kSubBits - 1;
+    const int sub = bucket & ((1 << kSubBits) - 1);
+    return ((int64_t)((1 << kSubBits) + sub + 1)) << (msb - kSubBits);
+  }
+
+  void Add(int64_t us) {
+    count_++;
+    sum_ += us;
+    max_ = max(max_, us);
+    buckets_[Bucket(us)]++;
+  }
+
+  void Merge(const Histogram& other) {
+    count_ += other.count_;
+    sum_ += other.sum_;
+    max_ = max(max_, other.max_);
+    for (int i = 0; i < kBuckets; i++) {
+      buckets_[i] += other.buckets_[i];
+    }
+  }
+
+  int64_t Percentile(double pct) const {
+    const double limit = count_ * pct / 100.;
+    int64_t acc = 0;
+    for (int i = 0; i < kBuckets; i++) {
+      acc += buckets_[i];
+      if (0 < acc && limit <= acc) {
+        return min(Value(i), max_);
+      }
+    }
+    return max_;
+  }
+
+  int64_t count_;
+  int64_t sum_;
+  int64_t max_;
+  vector<int64_t> buckets_;
+};
+
+struct OpStats {
+  OpStats() : latency_(), lag_(), errors_(0), mismatches_(0) {}
+
+  void Merge(const OpStats& other) {
+    latency_.Merge(other.latency_);
+    lag_.Merge(other.lag_);
+    errors_ += other.errors_;
+    mismatches_ += other.mismatches_;
+  }
+
+  Histogram latency_;
+  Histogram lag_;
+  int64_t errors_;     // Communication errors, or malformed responses.
+  int64_t mismatches_; // Status differs from the original status.
+};
+
+typedef map<string, OpStats> Stats;
+
+struct Op {
+  string name_;
+  string headers_; // Without Cseq, and without the terminating empty line.
+  int status_;
+  int64_t due_;    // Scheduled replay time.
+};
+
+struct Session;
+
+//Global datastructure to hold various options.
+struct Replay {
+  Replay()
+    : dfsPort_(-1), speedup_(1), connections_(1), maxOps_(-1),
+      verboseFlag_(false), skipped_(0), malformed_(0), failed_(0) {}
+
+  //from commadline
+  string dfsServer_;
+  int dfsPort_;
+  double speedup_;
+  int connections_;
+  int64_t maxOps_;
+  bool verboseFlag_;
+  set<string> include_;
+  set<string> exclude_;
+  vector<string> logFiles_;
+
+  map<string, Session*> sessions_;
+
+  QCMutex mutex_;
+  Stats stats_;
+  int64_t skipped_;
+  int64_t malformed_;
+  int failed_;
+};
+
+void Usage(const char* argv0)
+{
+  fprintf(logFile, "Usage: %s -s dfs-server -p dfs-port [-x speedup] [-c connections]\n"
+    "   [-i op[,op...]] [-e op[,op...]] [-n max-ops] [-v] audit-log-file...\n",
+    argv0);
+  fprintf(logFile, "   -x: replay speedup, the default is 1, i.e. the original op rate; 0 replays\n"
+    "       the ops as fast as the sessions can send them.\n");
+  fprintf(logFile, "   -c: number of connections per original client ip, the default is 1.\n");
+  fprintf(logFile, "   -i: replay only the specified ops, for example LOOKUP,GETATTR,READDIRPLUS.\n");
+  fprintf(logFile, "   -e: do not replay the specified ops.\n");
+  fprintf(logFile, "   -n: stop after the specified number of ops.\n");
+  fprintf(logFile, "   -v: log every op with the status that differs from the original status.\n");
+  fprintf(logFile, "   The audit log files must be listed in chronological order.\n");
+  fprintf(logFile, "eg:\n%s -s <metaserver-host> -p <metaserver-port> -x 4 audit.log.1 audit.log\n", argv0);
+  exit(0);
+}
+
+static void ParseOpList(const char* list, set<string>& ops)
+{
+  istringstream is(list);
+  string op;
+  while (getline(is, op, ',')) {
+    if (!op.empty()) {
+      ops.insert(op);
+    }
+  }
+}
+
+void parse_options(int argc, char* argv[], Replay* replay)
+{
+  int c = 0;
+  while ((c = getopt(argc, argv, "s:p:x:c:i:e:n:vh")) != -1) {
+    switch (c) {
+      case 's': replay->dfsServer_ = optarg; break;
+      case 'p': replay->dfsPort_ = atoi(optarg); break;
+      case 'x': replay->speedup_ = atof(optarg); break;
+      case 'c': replay->connections_ = atoi(optarg); break;
+      case 'i': ParseOpList(optarg, replay->include_); break;
+      case 'e': ParseOpList(optarg, replay->exclude_); break;
+      case 'n': replay->maxOps_ = strtoll(optarg, NULL, 0); break;
+      case 'v': replay->verboseFlag_ = true; break;
+      case 'h':
+      case '?':
+        Usage(argv[0]);
+        break;
+      default:
+        fprintf (logFile, "?? getopt returned character code 0%o ??\n", c);
+        Usage(argv[0]);
+        break;
+    }
+  }
+  for (int i = optind; i < argc; i++) {
+    replay->logFiles_.push_back(argv[i]);
+  }
+  if (replay->dfsServer_.empty() || replay->dfsPort_ <= 0 ||
+      replay->speedup_ < 0 || replay->connections_ <= 0 ||
+      replay->logFiles_.empty()) {
+    Usage(argv[0]);
+  }
+}
+
+static int Connect(const Replay* replay)
+{
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  ostringstream port;
+  port << replay->dfsPort_;
+  struct addrinfo* res = 0;
+  int err = getaddrinfo(replay->dfsServer_.c_str(), port.str().c_str(),
+    &hints, &res);
+  if (err != 0) {
+    fprintf(logFile, "Error: %s: %s\n", replay->dfsServer_.c_str(),
+      gai_strerror(err));
+    return -EHOSTUNREACH;
+  }
+  int fd = -1;
+  err = -EHOSTUNREACH;
+  for (struct addrinfo* ai = res; ai && fd < 0; ai = ai->ai_next) {
+    fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (fd < 0) {
+      err = -errno;
+      continue;
+    }
+    if (connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+      err = -errno;
+      close(fd);
+      fd = -1;
+    }
+  }
+  freeaddrinfo(res);
+  if (fd < 0) {
+    fprintf(logFile, "Error: connect %s:%d: %s\n", replay->dfsServer_.c_str(),
+      replay->dfsPort_, strerror(-err));
+    return err;
+  }
+  const int on = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+  return fd;
+}
+
+// Meta server connection. Sends one request at a time, and waits for the
+// response.
+class Connection
+{
+public:
+  Connection(const Replay* replay)
+    : replay_(replay), fd_(-1), seq_(0), buf_() {}
+  ~Connection() {
+    Close();
+  }
+  // Returns the op status, or 1 in the case of communication error.
+  int Execute(const Op& op) {
+    if (fd_ < 0 && (fd_ = Connect(replay_)) < 0) {
+      return 1;
+    }
+    ostringstream os;
+    os << op.name_ << "\r\n"
+      "Cseq: " << ++seq_ << "\r\n" <<
+      op.headers_ << "\r\n";
+    const string req = os.str();
+    if (!Send(req.data(), req.size())) {
+      Close();
+      return 1;
+    }
+    int status = 0;
+    if (!Receive(status)) {
+      Close();
+      return 1;
+    }
+    return status;
+  }
+private:
+  const Replay* const replay_;
+  int fd_;
+  int64_t seq_;
+  string buf_;
+
+  void Close() {
+    if (0 <= fd_) {
+      close(fd_);
+      fd_ = -1;
+    }
+    buf_.clear();
+  }
+  bool Send(const char* ptr, size_t len) {
+    while (0 < len) {
+      const ssize_t n = send(fd_, ptr, len, MSG_NOSIGNAL);
+      if (n < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return false;
+      }
+      ptr += n;
+      len -= n;
+    }
+    return true;
+  }
+  bool Fill() {
+    char tmp[64 << 10];
+    for (; ;) {
+      const ssize_t n = recv(fd_, tmp, sizeof(tmp), 0);
+      if (0 < n) {
+        buf_.append(tmp, n);
+        return true;
+      }
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+  }
+  static int64_t HeaderValue(const string& hdrs, const char* name,
+      int64_t def) {
+    const size_t len = strlen(name);
+    size_t pos = 0;
+    while ((pos = hdrs.find(name, pos)) != string::npos) {
+      if (pos == 0 || hdrs[pos - 1] == '\n') {
+        return strtoll(hdrs.c_str() + pos + len, NULL, 10);
+      }
+      pos += len;
+    }
+    return def;
+  }
+  bool Receive(int& status) {
+    size_t end;
+    while ((end = buf_.find("\r\n\r\n")) == string::npos) {
+      if (!Fill()) {
+        return false;
+      }
+    }
+    end += 4;
+    const string hdrs = buf_.substr(0, end);
+    if (hdrs.compare(0, 2, "OK") != 0) {
+      return false;
+    }
+    const int64_t seq = HeaderValue(hdrs, "Cseq: ", -1);
+    const int64_t len = HeaderValue(hdrs, "Content-length: ", 0);
+    if (seq != seq_ || len < 0) {
+      return false;
+    }
+    status = (int)HeaderValue(hdrs, "Status: ", 0);
+    buf_.erase(0, end);
+    while (buf_.size() < (size_t)len) {
+      if (!Fill()) {
+        return false;
+      }
+    }
+    buf_.erase(0, (size_t)len);
+    return true;
+  }
+private:
+  Connection(const Connection&);
+  Connection& operator=(const Connection&);
+};
+
+// Replays the ops of one original client ip.
+struct Session {
+  Session(Replay* replay, const string& clientIp)
+    : replay_(replay), clientIp_(clientIp), doneFlag_(false) {}
+
+  Replay* const replay_;
+  const string clientIp_;
+  QCMutex mutex_;
+  QCCondVar cond_;
+  deque<Op*> queue_;
+  bool doneFlag_;
+
+  void Enqueue(Op* op) {
+    QCStMutexLocker lock(mutex_);
+    queue_.push_back(op);
+    cond_.Notify();
+  }
+  void Done() {
+    QCStMutexLocker lock(mutex_);
+    doneFlag_ = true;
+    cond_.NotifyAll();
+  }
+  Op* Dequeue() {
+    QCStMutexLocker lock(mutex_);
+    while (queue_.empty() && !doneFlag_) {
+      cond_.Wait(mutex_);
+    }
+    if (queue_.empty()) {
+      return 0;
+    }
+    Op* const op = queue_.front();
+    queue_.pop_front();
+    return op;
+  }
+};
+
+class Worker : public QCRunnable
+{
+public:
+  Worker(Session* session)
+    : session_(session), thread_() {}
+  int Start() {
+    return thread_.TryToStart(this, -1, "mreplay");
+  }
+  void Join() {
+    thread_.Join();
+  }
+  virtual void Run() {
+    Replay* const replay = session_->replay_;
+    Connection conn(replay);
+    Stats stats;
+    Op* op;
+    while ((op = session_->Dequeue())) {
+      const int64_t start = Now();
+      const int status = conn.Execute(*op);
+      const int64_t end = Now();
+      OpStats& st = stats[op->name_];
+      if (0 < status) {
+        st.errors_++;
+      } else {
+        st.latency_.Add(end - start);
+        st.lag_.Add(start - op->due_);
+        if (status != op->status_) {
+          st.mismatches_++;
+          if (replay->verboseFlag_) {
+            fprintf(logFile, "%s %s status: %d original: %d\n%s\n",
+              session_->clientIp_.c_str(), op->name_.c_str(), status,
+              op->status_, op->headers_.c_str());
+          }
+        }
+      }
+      delete op;
+    }
+    QCStMutexLocker lock(replay->mutex_);
+    for (Stats::const_iterator it = stats.begin(); it != stats.end(); ++it) {
+      replay->stats_[it->first].Merge(it->second);
+    }
+  }
+private:
+  Session* const session_;
+  QCThread thread_;
+};
+
+// Parses the log record time stamp with the default "%m-%d-%Y %H:%M:%S"
+// format, or in seconds since the epoch, followed by milliseconds. Only the
+// differences between the time stamps are used, therefore the time zone is
+// irrelevant.
+static bool ParseTime(const char* ptr, int64_t& us)
+{
+  struct tm tm;
+  memset(&tm, 0, sizeof(tm));
+  int ms = 0;
+  long long sec = 0;
+  if (sscanf(ptr, "%d-%d-%d %d:%d:%d.%d", &tm.tm_mon, &tm.tm_mday,
+      &tm.tm_year, &tm.tm_hour, &tm.tm_min, &tm.tm_sec, &ms) == 7) {
+    tm.tm_mon -= 1;
+    tm.tm_year -= 1900;
+    sec = (long long)timegm(&tm);
+  } else if (sscanf(ptr, "%lld.%d", &sec, &ms) != 2) {
+    return false;
+  }
+  us = ((int64_t)sec * 1000 + ms) * 1000;
+  return true;
+}
+
+// Splits an audit log record into the time stamp, the op, and the client ip.
+// Returns false if the record is malformed, or truncated.
+static bool ParseRecord(const string& rec, int64_t& time, Op& op,
+  string& clientIp)
+{
+  size_t pos = rec.find_first_not_of("\r\n");
+  if (pos == string::npos || !ParseTime(rec.c_str() + pos, time)) {
+    return false;
+  }
+  if ((pos = rec.find(" - ", pos)) == string::npos) {
+    return false;
+  }
+  pos += 3;
+  size_t end = rec.find("\r\n", pos);
+  const size_t hdrsEnd = rec.find("\r\n\r\n", pos);
+  if (end == string::npos || hdrsEnd == string::npos) {
+    return false;
+  }
+  op.name_.assign(rec, pos, end - pos);
+  op.headers_.clear();
+  // Drop Cseq, the connection sets its own.
+  while (end < hdrsEnd) {
+    pos = end + 2;
+    end = rec.find("\r\n", pos);
+    if (rec.compare(pos, 5, "Cseq:") != 0) {
+      op.headers_.append(rec, pos, end + 2 - pos);
+    }
+  }
+  op.status_ = 0;
+  clientIp.clear();
+  pos = hdrsEnd + 4;
+  while (pos < rec.size()) {
+    end = rec.find("\r\n", pos);
+    if (end == string::npos) {
+      end = rec.size();
+    }
+    if (rec.compare(pos, 11, "Client-ip: ") == 0) {
+      clientIp.assign(rec, pos + 11, end - pos - 11);
+    } else if (rec.compare(pos, 8, "Status: ") == 0) {
+      op.status_ = atoi(rec.c_str() + pos + 8);
+    }
+    pos = end + 2;
+  }
+  return !op.name_.empty();
+}
+
+static bool IsReplayed(const Replay* replay, const Op& op)
+{
+  if (op.name_ == "AUTHENTICATE" ||
+      // The request content is not in the audit log.
+      op.headers_.find("Content-length:") != string::npos) {
+    return false;
+  }
+  if (!replay->include_.empty() &&
+      replay->include_.find(op.name_) == replay->include_.end()) {
+    return false;
+  }
+  return (replay->exclude_.find(op.name_) == replay->exclude_.end());
+}
+
+static Session* GetSession(Replay* replay, const string& clientIp,
+  vector<Worker*>& workers)
+{
+  map<string, Session*>::iterator it = replay->sessions_.find(clientIp);
+  if (it != replay->sessions_.end()) {
+    return it->second;
+  }
+  Session* const session = new Session(replay, clientIp);
+  replay->sessions_[clientIp] = session;
+  for (int i = 0; i < replay->connections_; i++) {
+    Worker* const worker = new Worker(session);
+    const int err = worker->Start();
+    if (err != 0) {
+      fprintf(logFile, "Error: failed to start thread: %s\n",
+        QCThread::GetErrorMsg(err).c_str());
+      delete worker;
+      session->Done();
+      break;
+    }
+    workers.push_back(worker);
+  }
+  return session;
+}
+
+// Reads the log records, and queues each op to its session at the scheduled
+// time.
+static int64_t Dispatch(Replay* replay, vector<Worker*>& workers)
+{
+  const int64_t start = Now();
+  int64_t firstTime = -1;
+  int64_t count = 0;
+  string rec;
+  string clientIp;
+  for (size_t i = 0; i < replay->logFiles_.size(); i++) {
+    ifstream in(replay->logFiles_[i].c_str(), ios::binary);
+    if (!in) {
+      fprintf(logFile, "Error: %s: %s\n", replay->logFiles_[i].c_str(),
+        strerror(errno));
+      replay->failed_++;
+      continue;
+    }
+    while (getline(in, rec, '\0')) {
+      if (0 <= replay->maxOps_ && replay->maxOps_ <= count) {
+        return count;
+      }
+      int64_t time = 0;
+      Op* op = new Op();
+      if (!ParseRecord(rec, time, *op, clientIp)) {
+        if (rec.find_first_not_of("\r\n") != string::npos) {
+          replay->malformed_++;
+        }
+        delete op;
+        continue;
+      }
+      if (!IsReplayed(replay, *op)) {
+        replay->skipped_++;
+        delete op;
+        continue;
+      }
+      if (firstTime < 0) {
+        firstTime = time;
+      }
+      // The time stamps from concurrent log writers are not necessarily
+      // ordered, never move the schedule backwards.
+      op->due_ = start;
+      if (0 < replay->speedup_) {
+        const int64_t offset =
+          (int64_t)((double)max(int64_t(0), time - firstTime) / replay->speedup_);
+        op->due_ = max(op->due_, start + offset);
+        int64_t now;
+        while ((now = Now()) < op->due_) {
+          usleep((useconds_t)min(op->due_ - now, int64_t(1000) * 1000));
+        }
+      }
+      GetSession(replay, clientIp, workers)->Enqueue(op);
+      count++;
+    }
+  }
+  return count;
+}
+
+static void PrintStats(const char* name, const OpStats& st)
+{
+  const Histogram& h = st.latency_;
+  fprintf(logFile, "Replay: %s latency usec: count=%lld avg=%lld p50=%lld"
+    " p90=%lld p99=%lld p99.9=%lld max=%lld lag p99=%lld max=%lld"
+    " errors=%lld mismatches=%lld\n",
+    name, (long long)h.count_,
+    (long long)(0 < h.count_ ? h.sum_ / h.count_ : 0),
+    (long long)h.Percentile(50), (long long)h.Percentile(90),
+    (long long)h.Percentile(99), (long long)h.Percentile(99.9),
+    (long long)h.max_, (long long)st.lag_.Percentile(99),
+    (long long)st.lag_.max_, (long long)st.errors_,
+    (long long)st.mismatches_);
+}
+
+int main(int argc, char* argv[])
+{
+  Replay replay;
+
+  parse_options(argc, argv, &replay);
+
+  const int64_t start = Now();
+  vector<Worker*> workers;
+  const int64_t count = Dispatch(&replay, workers);
+  for (map<string, Session*>::const_iterator it = replay.sessions_.begin();
+      it != replay.sessions_.end(); ++it) {
+    it->second->Done();
+  }
+  for (size_t i = 0; i < workers.size(); i++) {
+    workers[i]->Join();
+    delete workers[i];
+  }
+  const int64_t elapsed = Now() - start;
+  for (map<string, Session*>::const_iterator it = replay.sessions_.begin();
+      it != replay.sessions_.end(); ++it) {
+    delete it->second;
+  }
+
+  OpStats total;
+  for (Stats::const_iterator it = replay.stats_.begin();
+      it != replay.stats_.end(); ++it) {
+    PrintStats(it->first.c_str(), it->second);
+    total.Merge(it->second);
+  }
+  PrintStats("total", total);
+  const double sec = (double)max(int64_t(1), elapsed) * 1e-6;
+  fprintf(logFile, "Replay: %lld ops from %d clients in %.3f sec, %.1f ops/sec,"
+    " skipped: %lld malformed: %lld\n",
+    (long long)count, (int)replay.sessions_.size(), sec, count / sec,
+    (long long)replay.skipped_, (long long)replay.malformed_);
+  return ((replay.failed_ != 0 || total.errors_ != 0) ? 1 : 0);
+}
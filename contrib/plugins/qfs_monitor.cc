@@ -17,6 +17,8 @@ using KFS::ChunkServerErrorMap;
 using KFS::ClientCounters;
 using KFS::Counter;
 using KFS::ErrorCounters;
+using KFS::LatencyHistogram;
+using KFS::ChunkServerLatencyMap;
 using KFS::ServerLocation;
 
 using std::cout;
@@ -125,21 +127,85 @@ void WriteToStream(
             "error_total_count", counters.mTotalErrorCount);
 }
 
-extern "C" void reportStatus(
-        string metaserverHost,
+// Only non empty histogram buckets are emitted, in order to keep the log
+// compact. Bucket "lt_<n>ms" counts ops with latency less than n ms, and the
+// last bucket "ge_<n>ms" counts ops with latency n ms or greater.
+void WriteToStream(
+        ofstream& out,
+        const string& prefix,
+        const LatencyHistogram& histogram)
+{
+    EmitCounter(out, prefix, "latency_count", histogram.mCount);
+    EmitCounter(out, prefix, "latency_total_usec", histogram.mTotalUsec);
+    EmitCounter(out, prefix, "retry_count", histogram.mRetryCount);
+    for (int i = 0; i < LatencyHistogram::kBucketCount; i++) {
+        if (histogram.mBuckets[i] <= 0) {
+            continue;
+        }
+        string name = "latency_";
+        const Counter bound = LatencyHistogram::GetBucketBoundMs(i);
+        if (bound < 0) {
+            name += "ge_";
+            AppendDecIntToString(name,
+                LatencyHistogram::GetBucketBoundMs(i - 1));
+        }
+        else {
+            name += "lt_";
+            AppendDecIntToString(name, bound);
+        }
+        name += "ms";
+        EmitCounter(out, prefix, name, histogram.mBuckets[i]);
+    }
+}
+
+string getLogFilePath(
+        const string& metaserverHost,
         int metaserverPort,
-        ClientCounters& clientCounters,
-        ChunkServerErrorMap& errorCounters)
+        const char* suffix)
 {
-    int pid = getpid();
     string logFilePath = getLogPath();
     logFilePath += "/";
     logFilePath += metaserverHost;
     logFilePath += "_";
     AppendDecIntToString(logFilePath, metaserverPort);
     logFilePath += "_";
-    AppendDecIntToString(logFilePath, pid);
-    logFilePath += ".log";
+    AppendDecIntToString(logFilePath, getpid());
+    logFilePath += suffix;
+    return logFilePath;
+}
+
+bool commitLogFile(
+        ofstream& fileStream,
+        const string& tmpLogFilePath,
+        const string& logFilePath)
+{
+    fileStream.close();
+    int lastError = errno;
+
+    if (!fileStream) {
+        string errMsg = "Monitor plugin can't write the log file to "
+                + tmpLogFilePath + ": ";
+        if(lastError == 0) {
+            lastError = EIO;
+        }
+        cout << QCUtils::SysError(lastError, errMsg.c_str()) << endl;
+        remove(tmpLogFilePath.c_str());
+        return false;
+    }
+
+    chmod(tmpLogFilePath.c_str(), S_IRWXU | S_IRWXG | S_IRWXO);
+    rename(tmpLogFilePath.c_str(), logFilePath.c_str());
+    return true;
+}
+
+extern "C" void reportStatus(
+        string metaserverHost,
+        int metaserverPort,
+        ClientCounters& clientCounters,
+        ChunkServerErrorMap& errorCounters)
+{
+    string logFilePath = getLogFilePath(
+            metaserverHost, metaserverPort, ".log");
     string tmpLogFilePath = logFilePath + ".tmp";
 
     ofstream fileStream(tmpLogFilePath.c_str(), std::ios::out);
@@ -169,21 +235,40 @@ extern "C" void reportStatus(
         WriteToStream(fileStream, chunkserverName + "_write_", writeErrors);
     }
 
-    fileStream.close();
-    int lastError = errno;
+    commitLogFile(fileStream, tmpLogFilePath, logFilePath);
+}
 
+extern "C" void reportLatency(
+        string metaserverHost,
+        int metaserverPort,
+        LatencyHistogram& metaLatency,
+        ChunkServerLatencyMap& chunkServerLatency)
+{
+    string logFilePath = getLogFilePath(
+            metaserverHost, metaserverPort, "_latency.log");
+    string tmpLogFilePath = logFilePath + ".tmp";
+
+    ofstream fileStream(tmpLogFilePath.c_str(), std::ios::out);
     if (!fileStream) {
-        string errMsg = "Monitor plugin can't write the log file to "
-                + tmpLogFilePath + ": ";
-        if(lastError == 0) {
-            lastError = EIO;
-        }
-        cout << QCUtils::SysError(lastError, errMsg.c_str()) << endl;
-        remove(tmpLogFilePath.c_str());
+        string errMsg = "Monitor plugin can't open the log file " +
+                tmpLogFilePath + " for writing: ";
+        perror(errMsg.c_str());
         return;
     }
 
-    chmod(tmpLogFilePath.c_str(), S_IRWXU | S_IRWXG | S_IRWXO);
-    rename(tmpLogFilePath.c_str(), logFilePath.c_str());
+    WriteToStream(fileStream, "meta_", metaLatency);
+    for (ChunkServerLatencyMap::const_iterator it = chunkServerLatency.begin();
+            it != chunkServerLatency.end() && fileStream; ++it) {
+        const ServerLocation& chunkserverLoc = it->first;
+        string chunkserverName = chunkserverLoc.hostname;
+        chunkserverName += ":";
+        AppendDecIntToString(chunkserverName, chunkserverLoc.port);
+        WriteToStream(fileStream, chunkserverName + "_read_",
+                it->second.readLatency);
+        WriteToStream(fileStream, chunkserverName + "_write_",
+                it->second.writeLatency);
+    }
+
+    commitLogFile(fileStream, tmpLogFilePath, logFilePath);
 }
 
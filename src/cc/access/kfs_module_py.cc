@@ -69,6 +69,7 @@ static PyObject *qfs_rmdir(PyObject *pself, PyObject *args);
 static PyObject *qfs_rmdirs(PyObject *pself, PyObject *args);
 static PyObject *qfs_readdir(PyObject *pself, PyObject *args);
 static PyObject *qfs_readdirplus(PyObject *pself, PyObject *args);
+static PyObject *qfs_iter_readdirplus(PyObject *pself, PyObject *args);
 static PyObject *qfs_create(PyObject *pself, PyObject *args);
 static PyObject *qfs_stat(PyObject *pself, PyObject *args);
 static PyObject *qfs_fullstat(PyObject *pself, PyObject *args);
@@ -102,6 +103,7 @@ static PyMethodDef Client_methods[] = {
     { "rmdirs",           qfs_rmdirs,         METH_VARARGS, "Remove directory tree."},
     { "readdir",          qfs_readdir,        METH_VARARGS, "Read directory." },
     { "readdirplus",      qfs_readdirplus,    METH_VARARGS, "Read directory with attributes." },
+    { "iter_readdirplus", qfs_iter_readdirplus, METH_VARARGS, "Iterate over directory entries with attributes." },
     { "stat",             qfs_stat,           METH_VARARGS, "Stat file." },
     { "fullstat",         qfs_fullstat,       METH_VARARGS, "Stat file for QFS attributes." },
     { "getNumChunks",     qfs_getNumChunks,   METH_VARARGS, "Get # of chunks in a file." },
@@ -132,6 +134,8 @@ PyDoc_STRVAR(Client_doc,
 "\trmdirs(path) -- remove a directory tree\n"
 "\treaddir(path) -- return a tuple of directory contents\n"
 "\treaddirplus(path) -- directory entries plus attributes\n"
+"\titer_readdirplus(path[, batch]) -- iterator over directory entries plus\n"
+"\t\tattributes, fetched from the server in batches\n"
 "\tisdir(path) -- return TRUE if path is a directory\n"
 "\tisfile(path) -- return TRUE if path is a file\n"
 "\tstat(path)   --  file attributes, compatible with os.stat\n"
@@ -265,8 +269,11 @@ set_file_members(
         return -1;
 
     // open the file if necessary
-    if (fd < 0)
+    if (fd < 0) {
+        Py_BEGIN_ALLOW_THREADS
         fd = client->client->Open(path, mode);
+        Py_END_ALLOW_THREADS
+    }
 
     if (fd < 0) {
         SetPyIoError(fd);
@@ -357,8 +364,11 @@ qfs_close(PyObject *pself, PyObject *args)
     qfs_File *self = (qfs_File *)pself;
     qfs_Client *cl = (qfs_Client *)self->pclient;
     if (self->fd != -1) {
-        cl->client->Close(self->fd);
+        int fd = self->fd;
         self->fd = -1;
+        Py_BEGIN_ALLOW_THREADS
+        cl->client->Close(fd);
+        Py_END_ALLOW_THREADS
     }
     Py_RETURN_NONE;
 }
@@ -383,7 +393,10 @@ qfs_read(PyObject *pself, PyObject *args)
         return NULL;
 
     char *buf = PyString_AsString(v);
-    ssize_t nr = cl->client->Read(self->fd, buf, rsize);
+    ssize_t nr;
+    Py_BEGIN_ALLOW_THREADS
+    nr = cl->client->Read(self->fd, buf, rsize);
+    Py_END_ALLOW_THREADS
     if (nr < 0) {
         Py_DECREF(v);
         SetPyIoError(nr);
@@ -394,6 +407,48 @@ qfs_read(PyObject *pself, PyObject *args)
     return v;
 }
 
+/*!
+ * \brief read into a writable buffer
+ *
+ * Reads directly into any object that supports the writable buffer
+ * protocol, such as bytearray, memoryview, or numpy array, with no
+ * intermediate copy. If the file position is specified the read does not
+ * change the current file position. Returns the number of bytes read.
+ */
+static PyObject *
+qfs_readinto(PyObject *pself, PyObject *args)
+{
+    qfs_File *self = (qfs_File *)pself;
+    qfs_Client *cl = (qfs_Client *)self->pclient;
+    Py_buffer view;
+    PY_LONG_LONG pos = -1;
+
+    if (!PyArg_ParseTuple(args, "w*|L", &view, &pos))
+        return NULL;
+
+    if (self->fd == -1) {
+        PyBuffer_Release(&view);
+        SetPyIoError(-EBADF);
+        return NULL;
+    }
+
+    char *buf = (char *)view.buf;
+    size_t len = (size_t)view.len;
+    int fd = self->fd;
+    ssize_t nr;
+    Py_BEGIN_ALLOW_THREADS
+    nr = pos < 0 ?
+        cl->client->Read(fd, buf, len) :
+        cl->client->PRead(fd, (chunkOff_t)pos, buf, len);
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&view);
+    if (nr < 0) {
+        SetPyIoError(nr);
+        return NULL;
+    }
+    return PyInt_FromSsize_t(nr);
+}
+
 static PyObject *
 qfs_write(PyObject *pself, PyObject *args)
 {
@@ -410,7 +465,10 @@ qfs_write(PyObject *pself, PyObject *args)
         return NULL;
     }
 
-    ssize_t nw = cl->client->Write(self->fd, buf, (ssize_t)wsize);
+    ssize_t nw;
+    Py_BEGIN_ALLOW_THREADS
+    nw = cl->client->Write(self->fd, buf, (ssize_t)wsize);
+    Py_END_ALLOW_THREADS
     if (nw < 0) {
         SetPyIoError(nw);
         return NULL;
@@ -495,7 +553,10 @@ qfs_truncate(PyObject *pself, PyObject *args)
         return NULL;
     }
 
-    int s = cl->client->Truncate(self->fd, off);
+    int s;
+    Py_BEGIN_ALLOW_THREADS
+    s = cl->client->Truncate(self->fd, off);
+    Py_END_ALLOW_THREADS
     if (s < 0) {
         SetPyIoError(s);
         return NULL;
@@ -509,7 +570,10 @@ qfs_sync(PyObject *pself, PyObject *args)
 {
     qfs_File *self = (qfs_File *)pself;
     qfs_Client *cl = (qfs_Client *)self->pclient;
-    int s = cl->client->Sync(self->fd);
+    int s;
+    Py_BEGIN_ALLOW_THREADS
+    s = cl->client->Sync(self->fd);
+    Py_END_ALLOW_THREADS
     if (s < 0) {
         SetPyIoError(s);
         return NULL;
@@ -564,6 +628,7 @@ static PyMethodDef File_methods[] = {
     { "open",             qfs_reopen,         METH_VARARGS, "Open a closed file." },
     { "close",            qfs_close,          METH_NOARGS,  "Close file." },
     { "read",             qfs_read,           METH_VARARGS, "Read from file." },
+    { "readinto",         qfs_readinto,       METH_VARARGS, "Read from file into buffer." },
     { "write",            qfs_write,          METH_VARARGS, "Write to file." },
     { "truncate",         qfs_truncate,       METH_VARARGS, "Truncate a file." },
     { "chunk_locations",  qfs_chunkLocations, METH_VARARGS, "Get location(s) of a chunk." },
@@ -591,6 +656,9 @@ PyDoc_STRVAR(File_doc,
 "\topen([mode]) -- reopen closed file\n"
 "\tclose()     -- close file\n"
 "\tread(len)   -- read len bytes, return as string\n"
+"\treadinto(buf[, pos]) -- read into writable buffer, such as bytearray,\n"
+"\t\tmemoryview or numpy array, at the current or specified file position,\n"
+"\t\treturn the number of bytes read\n"
 "\twrite(str)  -- write string to file\n"
 "\ttruncate(off) -- truncate file at specified offset\n"
 "\tseek(off)   -- seek to specified offset\n"
@@ -932,7 +1000,10 @@ qfs_readdir(PyObject *pself, PyObject *args)
 
     string path = build_path(self->cwd, patharg);
     vector <string> result;
-    int status = self->client->Readdir(path.c_str(), result);
+    int status;
+    Py_BEGIN_ALLOW_THREADS
+    status = self->client->Readdir(path.c_str(), result);
+    Py_END_ALLOW_THREADS
     if (status < 0) {
         SetPyIoError(status);
         return NULL;
@@ -984,7 +1055,10 @@ qfs_readdirplus(PyObject *pself, PyObject *args)
     string path = build_path(self->cwd, patharg);
 
     vector <KfsFileAttr> result;
-    int status = self->client->ReaddirPlus(path.c_str(), result);
+    int status;
+    Py_BEGIN_ALLOW_THREADS
+    status = self->client->ReaddirPlus(path.c_str(), result);
+    Py_END_ALLOW_THREADS
     if (status < 0) {
         SetPyIoError(status);
         return NULL;
@@ -998,6 +1072,114 @@ qfs_readdirplus(PyObject *pself, PyObject *args)
     return outer;
 }
 
+/*!
+ * \brief streaming read directory with attributes
+ *
+ * The directory is listed in batches, and the next batch is fetched from
+ * the meta server when the previous one is exhausted. The iterator returns
+ * the same tuples as readdirplus.
+ */
+struct qfs_DirIter {
+    PyObject_HEAD
+    PyObject *pclient;                // Python object for QFS client
+    string *path;                     // Directory path
+    string *cursor;                   // Next batch restart point
+    vector <KfsFileAttr> *entries;    // Current batch
+    size_t next;                      // Next entry in the current batch
+    int batch;                        // Max. entries per batch
+    bool more;                        // Set if the listing isn't complete
+};
+
+static void
+DirIter_dealloc(PyObject *pself)
+{
+    qfs_DirIter *self = (qfs_DirIter *)pself;
+    delete self->path;
+    delete self->cursor;
+    delete self->entries;
+    Py_XDECREF(self->pclient);
+    self->ob_type->tp_free(pself);
+}
+
+static PyObject *
+DirIter_next(PyObject *pself)
+{
+    qfs_DirIter *self = (qfs_DirIter *)pself;
+    while (self->next >= self->entries->size()) {
+        if (!self->more)
+            return NULL;
+        qfs_Client *cl = (qfs_Client *)self->pclient;
+        int status;
+        self->entries->clear();
+        self->next = 0;
+        Py_BEGIN_ALLOW_THREADS
+        status = cl->client->ReaddirPlus(self->path->c_str(),
+            *self->cursor, *self->entries, self->more, self->batch, true);
+        Py_END_ALLOW_THREADS
+        if (status < 0) {
+            self->more = false;
+            SetPyIoError(status);
+            return NULL;
+        }
+    }
+    return package_fattr((*self->entries)[self->next++]);
+}
+
+static PyTypeObject qfs_DirIterType = {
+    PyObject_HEAD_INIT(NULL)
+    0,                      // ob_size
+    "qfs.diriter",          // tp_name
+    sizeof (qfs_DirIter),   // tp_basicsize
+    0,                      // tp_itemsize
+    DirIter_dealloc,        // tp_dealloc
+    0,                      // tp_print
+    0,                      // tp_getattr
+    0,                      // tp_setattr
+    0,                      // tp_compare
+    0,                      // tp_repr
+    0,                      // tp_as_number
+    0,                      // tp_as_sequence
+    0,                      // tp_as_mapping
+    0,                      // tp_hash
+    0,                      // tp_call
+    0,                      // tp_str
+    0,                      // tp_getattro
+    0,                      // tp_setattro
+    0,                      // tp_as_buffer
+    Py_TPFLAGS_DEFAULT,     // tp_flags
+    "QFS directory iterator", // tp_doc
+    0,                      // tp_traverse
+    0,                      // tp_clear
+    0,                      // tp_richcompare
+    0,                      // tp_weaklistoffest
+    PyObject_SelfIter,      // tp_iter
+    DirIter_next,           // tp_iternext
+};
+
+static PyObject *
+qfs_iter_readdirplus(PyObject *pself, PyObject *args)
+{
+    qfs_Client *self = (qfs_Client *)pself;
+    char *patharg;
+    int batch = -1;
+
+    if (!PyArg_ParseTuple(args, "s|i", &patharg, &batch))
+        return NULL;
+
+    qfs_DirIter *it = PyObject_New(qfs_DirIter, &qfs_DirIterType);
+    if (it == NULL)
+        return NULL;
+    Py_INCREF(pself);
+    it->pclient = pself;
+    it->path = new string(build_path(self->cwd, patharg));
+    it->cursor = new string();
+    it->entries = new vector <KfsFileAttr>();
+    it->next = 0;
+    it->batch = batch;
+    it->more = true;
+    return (PyObject *)it;
+}
+
 static PyObject *
 qfs_stat(PyObject *pself, PyObject *args)
 {
@@ -1009,7 +1191,10 @@ qfs_stat(PyObject *pself, PyObject *args)
 
     string path = build_path(self->cwd, patharg);
     KfsFileAttr attr;
-    int status = self->client->Stat(path.c_str(), attr, true);
+    int status;
+    Py_BEGIN_ALLOW_THREADS
+    status = self->client->Stat(path.c_str(), attr, true);
+    Py_END_ALLOW_THREADS
     if (status < 0) {
         SetPyIoError(status);
         return NULL;
@@ -1045,7 +1230,10 @@ qfs_fullstat(PyObject *pself, PyObject *args)
 
     string path = build_path(self->cwd, patharg);
     KfsFileAttr attr;
-    int status = self->client->Stat(path.c_str(), attr, true);
+    int status;
+    Py_BEGIN_ALLOW_THREADS
+    status = self->client->Stat(path.c_str(), attr, true);
+    Py_END_ALLOW_THREADS
     if (status < 0) {
         SetPyIoError(status);
         return NULL;
@@ -1223,7 +1411,8 @@ PyMODINIT_FUNC
 initqfs()
 {
     if (PyType_Ready(&qfs_ClientType) < 0 ||
-        PyType_Ready(&qfs_FileType) < 0)
+        PyType_Ready(&qfs_FileType) < 0 ||
+        PyType_Ready(&qfs_DirIterType) < 0)
         return;
 
     PyObject *m = Py_InitModule3("qfs", NULL, module_doc);
@@ -30,6 +30,7 @@
 #include <cstddef>
 #include <iostream>
 #include <vector>
+#include <map>
 #include <netinet/in.h>
 #include <sstream>
 #include <errno.h>
@@ -39,9 +40,13 @@ using std::string;
 using std::cout;
 using std::endl;
 using std::ostringstream;
+using std::map;
 
 #include <fcntl.h>
 #include "libclient/KfsClient.h"
+#include "qcdio/QCMutex.h"
+#include "qcdio/qcstutils.h"
+#include "qcdio/qcdebug.h"
 using namespace KFS;
 
 extern "C" {
@@ -103,6 +108,10 @@ extern "C" {
     jobjectArray Java_com_quantcast_qfs_access_KfsAccess_getBlocksLocation(
         JNIEnv *jenv, jclass jcls, jlong jptr, jstring jpath, jlong jstart, jlong jlen);
 
+    jlong Java_com_quantcast_qfs_access_KfsAccess_getBlocksLocationPacked(
+        JNIEnv *jenv, jclass jcls, jlong jptr, jstring jpath, jlong jstart, jlong jlen,
+        jobject result);
+
     jshort Java_com_quantcast_qfs_access_KfsAccess_getReplication(
         JNIEnv *jenv, jclass jcls, jlong jptr, jstring jpath);
 
@@ -234,6 +243,14 @@ extern "C" {
     jint Java_com_quantcast_qfs_access_KfsInputChannel_close(
         JNIEnv *jenv, jclass jcls, jlong jptr, jint jfd);
 
+    jlong Java_com_quantcast_qfs_access_KfsInputChannel_readv(
+        JNIEnv *jenv, jclass jcls, jlong jptr, jint jfd, jobject buf,
+        jlongArray jpositions, jintArray jbegins, jintArray jends, jintArray jresults);
+
+    jint Java_com_quantcast_qfs_access_KfsInputChannel_pread(
+        JNIEnv *jenv, jclass jcls, jlong jptr, jint jfd, jlong jpos,
+        jobject buf, jint begin, jint end);
+
     /* Output channel methods */
     jint Java_com_quantcast_qfs_access_KfsOutputChannel_write(
         JNIEnv *jenv, jclass jcls, jlong jptr, jint jfd, jobject buf, jint begin, jint end);
@@ -246,6 +263,23 @@ extern "C" {
 
     jint Java_com_quantcast_qfs_access_KfsOutputChannel_close(
         JNIEnv *jenv, jclass jcls, jlong jptr, jint jfd);
+
+    /* Async io queue methods */
+    jlong Java_com_quantcast_qfs_access_KfsAsyncIoQueue_create(
+        JNIEnv *jenv, jclass jcls);
+
+    void Java_com_quantcast_qfs_access_KfsAsyncIoQueue_destroy(
+        JNIEnv *jenv, jclass jcls, jlong jqptr);
+
+    jint Java_com_quantcast_qfs_access_KfsAsyncIoQueue_submit(
+        JNIEnv *jenv, jclass jcls, jlong jptr, jlong jqptr, jboolean jwrite,
+        jintArray jfds, jlongArray jpositions, jobjectArray jbufs,
+        jintArray jbegins, jintArray jends, jlongArray jtags, jint jcount,
+        jintArray jresults);
+
+    jint Java_com_quantcast_qfs_access_KfsAsyncIoQueue_poll(
+        JNIEnv *jenv, jclass jcls, jlong jqptr, jlongArray jtags,
+        jlongArray jstatuses, jint jwaitMs);
 }
 
 namespace
@@ -1031,6 +1065,110 @@ jobjectArray Java_com_quantcast_qfs_access_KfsAccess_getBlocksLocation(
     return CreateLocations(jenv, entries, ptr);
 }
 
+// Returns the "chunk block" size, or -errno, and sets the result object's
+// host name table, with the port numbers stripped and duplicates removed, and
+// the per block host indexes, in order to avoid per block java array and
+// string construction.
+jlong Java_com_quantcast_qfs_access_KfsAccess_getBlocksLocationPacked(
+    JNIEnv *jenv, jclass jcls, jlong jptr, jstring jpath, jlong jstart, jlong jlen,
+    jobject result)
+{
+    if (! jptr) {
+        return -EFAULT;
+    }
+    if (! jpath || ! result) {
+        return -EINVAL;
+    }
+    jclass const rcls = jenv->GetObjectClass(result);
+    if (! rcls) {
+        return -EINVAL;
+    }
+    KfsClient* const clnt = (KfsClient*)jptr;
+
+    string path;
+    setStr(path, jenv, jpath);
+    vector< vector<string> > entries;
+    chunkOff_t               blockSize = 0;
+    const int64_t            res       = clnt->GetDataLocation(
+        path.c_str(), jstart, jlen, entries, &blockSize);
+    if (res < 0) {
+        return (jlong)res;
+    }
+    typedef map<string, jint> HostIndexes;
+    HostIndexes    hostIndexes;
+    vector<string> hosts;
+    vector<jint>   blockStarts;
+    vector<jint>   locations;
+    blockStarts.reserve(entries.size() + 1);
+    for (size_t i = 0; i < entries.size(); i++) {
+        blockStarts.push_back((jint)locations.size());
+        const size_t start = locations.size();
+        for (size_t k = 0; k < entries[i].size(); k++) {
+            const string& loc  = entries[i][k];
+            const size_t  pos  = loc.rfind(':');
+            const string  host = (pos != string::npos && 0 < pos) ?
+                loc.substr(0, pos) : loc;
+            const jint    idx  = hostIndexes.insert(
+                make_pair(host, (jint)hosts.size())).first->second;
+            if ((size_t)idx == hosts.size()) {
+                hosts.push_back(host);
+            }
+            size_t j;
+            for (j = start; j < locations.size() && locations[j] != idx; j++)
+                {}
+            if (j == locations.size()) {
+                locations.push_back(idx);
+            }
+        }
+    }
+    blockStarts.push_back((jint)locations.size());
+
+    jclass const jstrClass = jenv->FindClass("java/lang/String");
+    if (! jstrClass) {
+        jclass excl = jenv->FindClass("java/lang/ClassNotFoundException");
+        if (excl) {
+            jenv->ThrowNew(excl, 0);
+        }
+        return -EFAULT;
+    }
+    jobjectArray const jhosts = jenv->NewObjectArray(
+        (jsize)hosts.size(), jstrClass, 0);
+    if (! jhosts) {
+        return -ENOMEM;
+    }
+    for (size_t i = 0; i < hosts.size(); i++) {
+        jstring const s = jenv->NewStringUTF(hosts[i].c_str());
+        if (! s) {
+            return -ENOMEM;
+        }
+        jenv->SetObjectArrayElement(jhosts, (jsize)i, s);
+        jenv->DeleteLocalRef(s);
+    }
+    jintArray const jblockStarts = jenv->NewIntArray((jsize)blockStarts.size());
+    jintArray const jlocations   = jenv->NewIntArray((jsize)locations.size());
+    if (! jblockStarts || ! jlocations) {
+        return -ENOMEM;
+    }
+    jenv->SetIntArrayRegion(jblockStarts, 0, (jsize)blockStarts.size(),
+        &blockStarts[0]);
+    if (! locations.empty()) {
+        jenv->SetIntArrayRegion(jlocations, 0, (jsize)locations.size(),
+            &locations[0]);
+    }
+    const char* const fieldNames[] = {"hosts", "blockStarts", "locations"};
+    const char* const fieldTypes[] = {"[Ljava/lang/String;", "[I", "[I"};
+    jobject const     fieldValues[] = {jhosts, jblockStarts, jlocations};
+    for (int i = 0; i < 3; i++) {
+        jfieldID const fid = jenv->GetFieldID(
+            rcls, fieldNames[i], fieldTypes[i]);
+        if (! fid) {
+            return -EFAULT;
+        }
+        jenv->SetObjectField(result, fid, fieldValues[i]);
+    }
+    return (jlong)(blockSize <= 0 ? (chunkOff_t)CHUNKSIZE : blockSize);
+}
+
 jshort Java_com_quantcast_qfs_access_KfsAccess_getReplication(
     JNIEnv *jenv, jclass jcls, jlong jptr, jstring jpath)
 {
@@ -1550,6 +1688,90 @@ jint Java_com_quantcast_qfs_access_KfsInputChannel_read(
     return (jint)sz;
 }
 
+// Reads a list of file ranges into the direct buffer with one call, the ranges
+// are read in parallel. Returns the total bytes read, or -errno, and sets the
+// per range number of bytes read or -errno.
+jlong Java_com_quantcast_qfs_access_KfsInputChannel_readv(
+    JNIEnv *jenv, jclass jcls, jlong jptr, jint jfd, jobject buf,
+    jlongArray jpositions, jintArray jbegins, jintArray jends, jintArray jresults)
+{
+    if (! jptr) {
+        return -EFAULT;
+    }
+    KfsClient* const clnt = (KfsClient*)jptr;
+
+    if (! buf || ! jpositions || ! jbegins || ! jends || ! jresults) {
+        return -EINVAL;
+    }
+    char* const addr = (char*)jenv->GetDirectBufferAddress(buf);
+    const jlong cap  = jenv->GetDirectBufferCapacity(buf);
+    if (! addr || cap < 0) {
+        return -EINVAL;
+    }
+    const jsize cnt = jenv->GetArrayLength(jpositions);
+    if (jenv->GetArrayLength(jbegins) != cnt ||
+            jenv->GetArrayLength(jends) != cnt ||
+            jenv->GetArrayLength(jresults) < cnt) {
+        return -EINVAL;
+    }
+    if (cnt <= 0) {
+        return 0;
+    }
+    vector<jlong> positions(cnt);
+    vector<jint>  begins(cnt);
+    vector<jint>  ends(cnt);
+    jenv->GetLongArrayRegion(jpositions, 0, cnt, &positions[0]);
+    jenv->GetIntArrayRegion(jbegins, 0, cnt, &begins[0]);
+    jenv->GetIntArrayRegion(jends, 0, cnt, &ends[0]);
+    vector<KfsClient::ReadRange> ranges(cnt);
+    for (jsize i = 0; i < cnt; i++) {
+        if (positions[i] < 0 || begins[i] < 0 || ends[i] > cap ||
+                begins[i] > ends[i]) {
+            return -EINVAL;
+        }
+        ranges[i].pos    = (chunkOff_t)positions[i];
+        ranges[i].size   = (size_t)(ends[i] - begins[i]);
+        ranges[i].buf    = addr + begins[i];
+        ranges[i].status = 0;
+    }
+    const ssize_t ret = clnt->ReadV((int)jfd, &ranges[0], (int)cnt);
+    for (jsize i = 0; i < cnt; i++) {
+        begins[i] = (jint)ranges[i].status;
+    }
+    jenv->SetIntArrayRegion(jresults, 0, cnt, &begins[0]);
+    return (jlong)ret;
+}
+
+// Positional read into the direct buffer. The read is issued as a single
+// range ReadV(), therefore, unlike PRead(), it neither changes the file
+// position nor the sequential read ahead state, and doesn't discard the read
+// ahead buffer. Returns the number of bytes read, or -errno.
+jint Java_com_quantcast_qfs_access_KfsInputChannel_pread(
+    JNIEnv *jenv, jclass jcls, jlong jptr, jint jfd, jlong jpos,
+    jobject buf, jint begin, jint end)
+{
+    if (! jptr) {
+        return -EFAULT;
+    }
+    KfsClient* const clnt = (KfsClient*)jptr;
+
+    if (! buf || jpos < 0) {
+        return -EINVAL;
+    }
+    char* const addr = (char*)jenv->GetDirectBufferAddress(buf);
+    const jlong cap  = jenv->GetDirectBufferCapacity(buf);
+    if (! addr || cap < 0 || begin < 0 || end > cap || begin > end) {
+        return -EINVAL;
+    }
+    KfsClient::ReadRange range;
+    range.pos    = (chunkOff_t)jpos;
+    range.size   = (size_t)(end - begin);
+    range.buf    = addr + begin;
+    range.status = 0;
+    const ssize_t ret = clnt->ReadV((int)jfd, &range, 1);
+    return (jint)(ret < 0 ? ret : range.status);
+}
+
 jint Java_com_quantcast_qfs_access_KfsOutputChannel_write(
     JNIEnv *jenv, jclass jcls, jlong jptr, jint jfd, jobject buf, jint begin, jint end)
 {
@@ -1601,3 +1823,291 @@ jint Java_com_quantcast_qfs_access_KfsOutputChannel_atomicRecordAppend(
     ssize_t sz = clnt->AtomicRecordAppend((int) jfd, (const char *) addr, (int) (end - begin));
     return (jint)sz;
 }
+
+namespace
+{
+// Async reads and writes completion queue, polled from java. The queue holds a
+// global reference to each request's buffer until the completion is polled,
+// in order to keep the buffer memory valid while the request is in flight.
+class AsyncIoQueue
+{
+public:
+    class Request :
+        public KfsClient::ReadCompletion,
+        public KfsClient::WriteCompletion
+    {
+    public:
+        Request(
+            AsyncIoQueue& queue,
+            jobject       bufRef,
+            jlong         tag)
+            : KfsClient::ReadCompletion(),
+              KfsClient::WriteCompletion(),
+              mQueue(queue),
+              mBufRef(bufRef),
+              mTag(tag),
+              mStatus(0),
+              mNextPtr(0)
+            {}
+        virtual void Done(int64_t status)
+            { mQueue.Done(*this, status); }
+    private:
+        AsyncIoQueue& mQueue;
+        jobject const mBufRef;
+        jlong const   mTag;
+        int64_t       mStatus;
+        Request*      mNextPtr;
+
+        friend class AsyncIoQueue;
+    };
+
+    AsyncIoQueue()
+        : mMutex(),
+          mCond(),
+          mInFlightCount(0),
+          mDoneHeadPtr(0),
+          mDoneTailPtr(0)
+        {}
+    ~AsyncIoQueue()
+    {
+        QCASSERT(mInFlightCount == 0 && ! mDoneHeadPtr);
+    }
+    Request* Create(
+        jobject bufRef,
+        jlong   tag)
+    {
+        QCStMutexLocker lock(mMutex);
+        mInFlightCount++;
+        return new Request(*this, bufRef, tag);
+    }
+    // The request was not queued, and its completion will not be invoked.
+    void Cancel(
+        JNIEnv*  jenv,
+        Request* req)
+    {
+        {
+            QCStMutexLocker lock(mMutex);
+            mInFlightCount--;
+        }
+        jenv->DeleteGlobalRef(req->mBufRef);
+        delete req;
+    }
+    int Poll(
+        JNIEnv* jenv,
+        jlong*  tags,
+        jlong*  statuses,
+        int     maxCount,
+        int     waitMs)
+    {
+        Request* head = 0;
+        int      cnt  = 0;
+        {
+            QCStMutexLocker lock(mMutex);
+            if (! mDoneHeadPtr && 0 < mInFlightCount && waitMs != 0) {
+                if (waitMs < 0) {
+                    while (! mDoneHeadPtr && 0 < mInFlightCount) {
+                        mCond.Wait(mMutex);
+                    }
+                } else {
+                    mCond.Wait(mMutex, QCMutex::Time(waitMs) * 1000 * 1000);
+                }
+            }
+            Request* tail = 0;
+            while (cnt < maxCount && mDoneHeadPtr) {
+                Request* const req = mDoneHeadPtr;
+                mDoneHeadPtr = req->mNextPtr;
+                req->mNextPtr = 0;
+                if (tail) {
+                    tail->mNextPtr = req;
+                } else {
+                    head = req;
+                }
+                tail = req;
+                tags[cnt]     = req->mTag;
+                statuses[cnt] = (jlong)req->mStatus;
+                cnt++;
+            }
+            if (! mDoneHeadPtr) {
+                mDoneTailPtr = 0;
+            }
+        }
+        while (head) {
+            Request* const req = head;
+            head = req->mNextPtr;
+            jenv->DeleteGlobalRef(req->mBufRef);
+            delete req;
+        }
+        return cnt;
+    }
+    // Waits for all in flight requests, and discards the completions.
+    void Shutdown(
+        JNIEnv* jenv)
+    {
+        const int kMaxCount = 64;
+        jlong     tags[kMaxCount];
+        jlong     statuses[kMaxCount];
+        for (; ;) {
+            {
+                QCStMutexLocker lock(mMutex);
+                if (mInFlightCount <= 0 && ! mDoneHeadPtr) {
+                    break;
+                }
+            }
+            Poll(jenv, tags, statuses, kMaxCount, -1);
+        }
+    }
+private:
+    QCMutex   mMutex;
+    QCCondVar mCond;
+    int       mInFlightCount;
+    Request*  mDoneHeadPtr;
+    Request*  mDoneTailPtr;
+
+    void Done(
+        Request& req,
+        int64_t  status)
+    {
+        QCStMutexLocker lock(mMutex);
+        req.mStatus = status;
+        if (mDoneTailPtr) {
+            mDoneTailPtr->mNextPtr = &req;
+        } else {
+            mDoneHeadPtr = &req;
+        }
+        mDoneTailPtr = &req;
+        mInFlightCount--;
+        mCond.Notify();
+    }
+private:
+    AsyncIoQueue(
+        const AsyncIoQueue&);
+    AsyncIoQueue& operator=(
+        const AsyncIoQueue&);
+};
+}
+
+jlong Java_com_quantcast_qfs_access_KfsAsyncIoQueue_create(
+    JNIEnv *jenv, jclass jcls)
+{
+    return (jlong)new AsyncIoQueue();
+}
+
+void Java_com_quantcast_qfs_access_KfsAsyncIoQueue_destroy(
+    JNIEnv *jenv, jclass jcls, jlong jqptr)
+{
+    if (! jqptr) {
+        return;
+    }
+    AsyncIoQueue* const queue = (AsyncIoQueue*)jqptr;
+    queue->Shutdown(jenv);
+    delete queue;
+}
+
+// Queues up to count reads or writes with one call. Returns the number of
+// requests queued, and sets the per request number of bytes queued, possibly
+// less than requested, or -errno. The completion of each request with positive
+// number of bytes queued is returned by poll(), with the request's tag.
+jint Java_com_quantcast_qfs_access_KfsAsyncIoQueue_submit(
+    JNIEnv *jenv, jclass jcls, jlong jptr, jlong jqptr, jboolean jwrite,
+    jintArray jfds, jlongArray jpositions, jobjectArray jbufs,
+    jintArray jbegins, jintArray jends, jlongArray jtags, jint jcount,
+    jintArray jresults)
+{
+    if (! jptr || ! jqptr) {
+        return -EFAULT;
+    }
+    if (! jfds || ! jpositions || ! jbufs || ! jbegins || ! jends ||
+            ! jtags || ! jresults || jcount < 0 ||
+            jenv->GetArrayLength(jfds) < jcount ||
+            jenv->GetArrayLength(jpositions) < jcount ||
+            jenv->GetArrayLength(jbufs) < jcount ||
+            jenv->GetArrayLength(jbegins) < jcount ||
+            jenv->GetArrayLength(jends) < jcount ||
+            jenv->GetArrayLength(jtags) < jcount ||
+            jenv->GetArrayLength(jresults) < jcount) {
+        return -EINVAL;
+    }
+    if (jcount <= 0) {
+        return 0;
+    }
+    KfsClient* const    clnt  = (KfsClient*)jptr;
+    AsyncIoQueue* const queue = (AsyncIoQueue*)jqptr;
+    vector<jint>  fds(jcount);
+    vector<jlong> positions(jcount);
+    vector<jint>  begins(jcount);
+    vector<jint>  ends(jcount);
+    vector<jlong> tags(jcount);
+    vector<jint>  results(jcount, 0);
+    jenv->GetIntArrayRegion(jfds, 0, jcount, &fds[0]);
+    jenv->GetLongArrayRegion(jpositions, 0, jcount, &positions[0]);
+    jenv->GetIntArrayRegion(jbegins, 0, jcount, &begins[0]);
+    jenv->GetIntArrayRegion(jends, 0, jcount, &ends[0]);
+    jenv->GetLongArrayRegion(jtags, 0, jcount, &tags[0]);
+    jint queued = 0;
+    for (jint i = 0; i < jcount; i++) {
+        jobject const buf  = jenv->GetObjectArrayElement(jbufs, i);
+        char* const   addr = buf ?
+            (char*)jenv->GetDirectBufferAddress(buf) : 0;
+        const jlong   cap  = buf ? jenv->GetDirectBufferCapacity(buf) : -1;
+        if (! addr || cap < 0 || positions[i] < 0 || begins[i] < 0 ||
+                ends[i] > cap || begins[i] > ends[i]) {
+            if (buf) {
+                jenv->DeleteLocalRef(buf);
+            }
+            results[i] = -EINVAL;
+            continue;
+        }
+        jobject const bufRef = jenv->NewGlobalRef(buf);
+        jenv->DeleteLocalRef(buf);
+        if (! bufRef) {
+            results[i] = -ENOMEM;
+            continue;
+        }
+        AsyncIoQueue::Request* const req = queue->Create(bufRef, tags[i]);
+        const size_t                 len = (size_t)(ends[i] - begins[i]);
+        const ssize_t                res = jwrite ?
+            clnt->WriteAsync((int)fds[i], (chunkOff_t)positions[i],
+                addr + begins[i], len, *req) :
+            clnt->ReadAsync((int)fds[i], (chunkOff_t)positions[i],
+                addr + begins[i], len, *req);
+        if (res <= 0) {
+            queue->Cancel(jenv, req);
+        } else {
+            queued++;
+        }
+        results[i] = (jint)res;
+    }
+    jenv->SetIntArrayRegion(jresults, 0, jcount, &results[0]);
+    return queued;
+}
+
+// Returns up to the tags array length of completed requests, waiting up to
+// waitMs for at least one completion, indefinitely if negative.
+jint Java_com_quantcast_qfs_access_KfsAsyncIoQueue_poll(
+    JNIEnv *jenv, jclass jcls, jlong jqptr, jlongArray jtags,
+    jlongArray jstatuses, jint jwaitMs)
+{
+    if (! jqptr) {
+        return -EFAULT;
+    }
+    if (! jtags || ! jstatuses) {
+        return -EINVAL;
+    }
+    const jsize cnt = jenv->GetArrayLength(jtags);
+    if (jenv->GetArrayLength(jstatuses) < cnt) {
+        return -EINVAL;
+    }
+    if (cnt <= 0) {
+        return 0;
+    }
+    AsyncIoQueue* const queue = (AsyncIoQueue*)jqptr;
+    vector<jlong>       tags(cnt);
+    vector<jlong>       statuses(cnt);
+    const int           ret   = queue->Poll(
+        jenv, &tags[0], &statuses[0], (int)cnt, (int)jwaitMs);
+    if (0 < ret) {
+        jenv->SetLongArrayRegion(jtags, 0, ret, &tags[0]);
+        jenv->SetLongArrayRegion(jstatuses, 0, ret, &statuses[0]);
+    }
+    return ret;
+}
@@ -435,6 +435,11 @@ private:
     const uint64_t          mInstanceNum;
     int                     mConsecutiveOutOfSpaceCount;
     int                     mWritableWidCount;
+    // Per chunk flush statistics, reported when the appender is deleted.
+    const int64_t           mStartTime;
+    int64_t                 mFlushCount;
+    int64_t                 mFlushByteCount;
+    int64_t                 mFlushWriteMicroSecs;
     WriteIdState            mWriteIdState;
     vector<uint32_t>        mTmpChecksums;
     Timer                   mTimer;
@@ -763,6 +768,10 @@ AtomicRecordAppender::AtomicRecordAppender(
       mInstanceNum(++sInstanceNum),
       mConsecutiveOutOfSpaceCount(0),
       mWritableWidCount(0),
+      mStartTime(microseconds()),
+      mFlushCount(0),
+      mFlushByteCount(0),
+      mFlushWriteMicroSecs(0),
       mWriteIdState(),
       mTmpChecksums(),
       mTimer(
@@ -817,6 +826,18 @@ AtomicRecordAppender::~AtomicRecordAppender()
         " chunk: "  << mChunkId <<
         " offset: " << mNextOffset <<
     KFS_LOG_EOM;
+    if (0 < mFlushCount) {
+        const int64_t elapsed = max(int64_t(1), microseconds() - mStartTime);
+        WAPPEND_LOG_STREAM_INFO <<
+            "append stats:"
+            " chunk: "         << mChunkId <<
+            " flushes: "       << mFlushCount <<
+            " bytes: "         << mFlushByteCount <<
+            " avg. flush: "    << mFlushByteCount / mFlushCount <<
+            " avg. write us: " << mFlushWriteMicroSecs / mFlushCount <<
+            " bytes/sec: "     << mFlushByteCount * 1000 * 1000 / elapsed <<
+        KFS_LOG_EOM;
+    }
     if (mPeer) {
         mPeer->Finish();
     }
@@ -2908,6 +2929,10 @@ AtomicRecordAppender::FlushSelf(bool flushFullChecksumBlocks)
             }
         }
         mIoOpsInFlight++;
+        mFlushCount++;
+        mFlushByteCount += bytesToFlush;
+        Cntrs().mFlushCount++;
+        Cntrs().mFlushByteCount += bytesToFlush;
         int res = gChunkManager.WriteChunk(wop);
         if (res < 0) {
             // Failed to start write, call error handler and return immediately.
@@ -2930,6 +2955,9 @@ AtomicRecordAppender::OpDone(WriteOp *op)
     mIoOpsInFlight--;
     const bool failedFlag =
         op->status < 0 || size_t(op->status) < op->numBytes;
+    const int64_t writeTime = microseconds() - op->startTime;
+    mFlushWriteMicroSecs += writeTime;
+    Cntrs().mFlushWriteMicroSecs += writeTime;
     WAPPEND_LOG_STREAM(failedFlag ?
             MsgLogger::kLogLevelERROR : MsgLogger::kLogLevelDEBUG) <<
         "write " << (failedFlag ? "FAILED" : "done") <<
@@ -3099,6 +3127,8 @@ AtomicRecordAppendManager::AtomicRecordAppendManager()
       mMinMetaUptimeSec(8 * 60),
       mFlushLimit(1 << 20),
       mMaxAppenderBytes(0),
+      mSweepFlushLimit(0),
+      mAdaptiveFlushLimitFlag(true),
       mTotalBuffersBytes(0),
       mTotalPendingBytes(0),
       mActiveAppendersCount(0),
@@ -3113,6 +3143,7 @@ AtomicRecordAppendManager::AtomicRecordAppendManager()
       mCloseMinChunkSize(
         (chunkOff_t)CHUNKSIZE - (chunkOff_t)CHECKSUM_BLOCKSIZE),
       mMutexesCount(-1),
+      mMaxMutexesCount(1 << 8),
       mCurMutexIdx(0),
       mMutexes(0),
       mCurUpdateFlush(0),
@@ -3151,6 +3182,9 @@ AtomicRecordAppendManager::SetParameters(const Properties& props)
         mMinMetaUptimeSec);
     mFlushLimit              = props.getValue(
         "chunkServer.recAppender.flushLimit",          mFlushLimit),
+    mAdaptiveFlushLimitFlag  = props.getValue(
+        "chunkServer.recAppender.adaptiveFlushLimit",
+        mAdaptiveFlushLimitFlag ? 1 : 0) != 0;
     mBufferLimitRatio        = props.getValue(
         "chunkServer.recAppender.bufferLimitRatio",    mBufferLimitRatio),
     mMaxWriteIdsPerChunk     = props.getValue(
@@ -3162,6 +3196,10 @@ AtomicRecordAppendManager::SetParameters(const Properties& props)
         "chunkServer.recAppender.closeOutOfSpaceSec", mCloseOutOfSpaceSec);
     mAppendDropLockMinSize  = max(0, props.getValue(
         "chunkServer.recAppender.dropLockMinSize",    mAppendDropLockMinSize));
+    // Mutexes array is allocated on the first appender creation, and the
+    // number of mutexes can not be changed after that.
+    mMaxMutexesCount        = max(1, props.getValue(
+        "chunkServer.recAppender.mutexCount",         mMaxMutexesCount));
     mCloseMinChunkSize  = max((chunkOff_t)CHECKSUM_BLOCKSIZE, props.getValue(
         "chunkServer.recAppender.closeMinChunkSize",  mCloseMinChunkSize));
     mTotalBuffersBytes       = 0;
@@ -3209,13 +3247,25 @@ AtomicRecordAppendManager::UpdateAppenderFlushLimit(
             mActiveAppendersCount++;
         }
     }
-    const int64_t prevLimit = mMaxAppenderBytes;
-    mMaxAppenderBytes = min(
-        int64_t(mFlushLimit),
-        mTotalBuffersBytes / max(int64_t(1), mActiveAppendersCount)
-    );
+    int64_t limit = mTotalBuffersBytes / max(int64_t(1), mActiveAppendersCount);
+    if (mAdaptiveFlushLimitFlag && limit < mFlushLimit) {
+        // With large number of open appenders most of which are idle, the
+        // even share of the buffers results in small disk writes. Let the
+        // appenders that are appending use half of the buffer space that is
+        // presently not used. As the pending bytes grow, the limit
+        // converges to the even share.
+        limit = max(limit,
+            (mTotalBuffersBytes - mTotalPendingBytes) / 2);
+    }
+    mMaxAppenderBytes = (int)min(int64_t(mFlushLimit), limit);
+    if (mSweepFlushLimit < mMaxAppenderBytes) {
+        mSweepFlushLimit = mMaxAppenderBytes;
+    }
+    // Compare with the limit at the last sweep, instead of the previous
+    // limit, in order to catch gradual limit decrease.
     if (mRecursionCount <= 1 && ! mCurUpdateFlush &&
-            mMaxAppenderBytes < prevLimit * 15 / 16) {
+            mMaxAppenderBytes < mSweepFlushLimit * 15 / 16) {
+        mSweepFlushLimit = mMaxAppenderBytes;
         mRecursionCount++;
         mCurUpdateFlush = PendingFlushList::Front(mPendingFlushList);
         while (mCurUpdateFlush) {
@@ -3314,7 +3364,7 @@ AtomicRecordAppendManager::AllocateChunk(
                 QCMutex* mutex = 0;
                 if (mMutexesCount < 0) {
                     if (gClientManager.GetMutexPtr()) {
-                        mMutexesCount = 1 << 8;
+                        mMutexesCount = mMaxMutexesCount;
                         mMutexes = new QCMutex[mMutexesCount];
                     } else {
                         mMutexesCount = 0;
@@ -79,6 +79,9 @@ public:
         Counter mLostChunkCount;
         Counter mPendingByteCount;
         Counter mLowOnBuffersFlushCount;
+        Counter mFlushCount;
+        Counter mFlushByteCount;
+        Counter mFlushWriteMicroSecs;
 
         void Clear()
         {
@@ -114,6 +117,9 @@ public:
             mLostChunkCount = 0;
             mPendingByteCount = 0;
             mLowOnBuffersFlushCount = 0;
+            mFlushCount = 0;
+            mFlushByteCount = 0;
+            mFlushWriteMicroSecs = 0;
         }
     };
     AtomicRecordAppendManager();
@@ -221,6 +227,8 @@ private:
     int                   mMinMetaUptimeSec;
     int                   mFlushLimit;
     int                   mMaxAppenderBytes;
+    int                   mSweepFlushLimit;
+    bool                  mAdaptiveFlushLimitFlag;
     int64_t               mTotalBuffersBytes;
     int64_t               mTotalPendingBytes;
     int64_t               mActiveAppendersCount;
@@ -234,6 +242,7 @@ private:
     int                   mAppendDropLockMinSize;
     chunkOff_t            mCloseMinChunkSize;
     int                   mMutexesCount;
+    int                   mMaxMutexesCount;
     int                   mCurMutexIdx;
     QCMutex*              mMutexes;
     AtomicRecordAppender* mPendingFlushList[1];
@@ -830,6 +830,7 @@ public:
           chunkInfo(),
           dataFH(),
           lastIOTime(0),
+          lastScrubTime(0),
           readChunkMetaOp(0),
           mBeingReplicatedFlag(false),
           mDeleteFlag(false),
@@ -903,6 +904,13 @@ public:
         ChunkDirList::PushBack(mChunkDir.chunkLists[mChunkDirList], *this);
         return true;
     }
+    void MoveToChunkDirListBack() {
+        // Round robin the directory list for the scrubber.
+        if (mChunkDirList == ChunkDirInfo::kChunkDirList) {
+            ChunkDirList::Remove(mChunkDir.chunkLists[mChunkDirList], *this);
+            ChunkDirList::PushBack(mChunkDir.chunkLists[mChunkDirList], *this);
+        }
+    }
 
     ChunkInfo_t      chunkInfo;
     /// Chunks are stored as files in he underlying filesystem; each
@@ -912,10 +920,12 @@ public:
     DiskIo::FilePtr  dataFH;
     // when was the last I/O done on this chunk
     time_t           lastIOTime;
+    // when was the chunk last verified by the scrubber
+    time_t           lastScrubTime;
     /// keep track of the op that is doing the read
     ReadChunkMetaOp* readChunkMetaOp;
 
-    void Release(ChunkLists* chunkInfoLists);
+    void Release(ChunkLists* chunkInfoLists, bool keepChecksumsFlag = false);
     bool IsFileOpen() const {
         return (dataFH && dataFH->IsOpen());
     }
@@ -1370,14 +1380,22 @@ ChunkManager::LruUpdate(ChunkInfoHandle& cih)
 }
 
 inline void
-ChunkManager::Release(ChunkInfoHandle& cih)
+ChunkManager::Release(ChunkInfoHandle& cih, bool keepChecksumsFlag)
 {
-    cih.Release(mChunkInfoLists);
+    InvalidateWriteTailBlock(cih.chunkInfo.chunkId);
+    cih.Release(mChunkInfoLists, keepChecksumsFlag);
 }
 
 inline void
 ChunkManager::DeleteSelf(ChunkInfoHandle& cih)
 {
+    // Object store block table entries are removed when the blocks are not
+    // used, while the block content remains the same. Object store blocks
+    // are invalidated when re-written or deleted.
+    if (0 < mReadCache.GetSize() && 0 <= cih.chunkInfo.chunkVersion) {
+        mReadCache.Invalidate(cih.chunkInfo.chunkId);
+    }
+    InvalidateWriteTailBlock(cih.chunkInfo.chunkId);
     cih.Delete(mChunkInfoLists);
 }
 
@@ -1441,9 +1459,12 @@ ChunkManager::MakeStale(ChunkInfoHandle& cih,
 }
 
 void
-ChunkInfoHandle::Release(ChunkInfoHandle::ChunkLists* chunkInfoLists)
+ChunkInfoHandle::Release(ChunkInfoHandle::ChunkLists* chunkInfoLists,
+    bool keepChecksumsFlag)
 {
-    chunkInfo.UnloadChecksums();
+    if (! keepChecksumsFlag) {
+        chunkInfo.UnloadChecksums();
+    }
     if (! IsFileOpen()) {
         if (dataFH) {
             dataFH.reset();
@@ -1792,6 +1813,9 @@ ChunkManager::ChunkManager()
       mNextInactiveFdCleanupTime(globalNetManager().Now() - 365 * 24 * 60 * 60),
       mInactiveFdFullScanIntervalSecs(2),
       mNextInactiveFdFullScanTime(globalNetManager().Now() - 365 * 24 * 60 * 60),
+      mClosedChunksChecksums(),
+      mMaxClosedChunksChecksumsCount(0),
+      mMaxIdleOpenChunkFiles(0),
       mReadChecksumMismatchMaxRetryCount(0),
       mAbortOnChecksumMismatchFlag(false),
       mRequireChunkHeaderChecksumFlag(false),
@@ -1800,12 +1824,34 @@ ChunkManager::ChunkManager()
       mStaleChunkCompletion(*this),
       mStaleChunkOpsInFlight(0),
       mMaxStaleChunkOpsInFlight(4),
+      mStaleChunkDeleteBytesPerSec(0),
+      mStaleChunkDeleteCredit(0),
+      mStaleChunkDeleteCreditTime(0),
+      mScrubCompletion(*this),
+      mScrubOp(0),
+      mScrubNextTime(0),
+      mScrubDirIdx(0),
+      mScrubBytesPerSec(0),
+      mScrubMinIntervalSec(7 * 24 * 60 * 60),
+      mReadCache(),
+      mReadCacheCompletion(*this),
+      mReadCacheHits(),
+      mReadCacheHitsTmp(),
+      mReadCacheBufferDataRatio(0),
+      mReadCacheMaxSize(-1),
+      mReadCacheObjStoreFlag(true),
+      mCoalescingReads(),
+      mCoalescedReadRetries(),
+      mReadCoalescingFlag(true),
+      mWriteTailBlocks(),
+      mWriteTailBlocksMaxCount(256),
       mMaxDirCheckDiskTimeouts(4),
       mChunkPlacementPendingReadWeight(0),
       mChunkPlacementPendingWriteWeight(0),
       mMaxPlacementSpaceRatio(0.2),
       mMinPendingIoThreshold(8 << 20),
       mPlacementMaxWaitingAvgUsecsThreshold(5 * 60 * 1000 * 1000),
+      mSaturatedDeviceWaitingAvgUsecsThreshold(10 * 1000 * 1000),
       mAllowSparseChunksFlag(true),
       mBufferedIoFlag(false),
       mSyncChunkHeaderFlag(false),
@@ -1821,6 +1867,7 @@ ChunkManager::ChunkManager()
       mEvacuateFileName("evacuate"),
       mEvacuateDoneFileName(mEvacuateFileName + ".done"),
       mChunkDirLockName("lock"),
+      mChunkInventoryFileName(),
       mEvacuationInactivityTimeout(300),
       mMetaHeartbeatTime(globalNetManager().Now() - 365 * 24 * 60 * 60),
       mMetaEvacuateCount(-1),
@@ -1838,6 +1885,7 @@ ChunkManager::ChunkManager()
       mForceVerifyDiskReadChecksumFlag(false),
       mWritePrepareReplyFlag(true),
       mCryptoKeys(globalNetManager(), 0 /* inMutexPtr */),
+      mChunkAccessTokenCache(4 << 10),
       mFileSystemId(-1),
       mFileSystemIdSuffix(),
       mFsIdFileNamePrefix("0-fsid-"),
@@ -1850,6 +1898,7 @@ ChunkManager::ChunkManager()
       mObjStoreIoRequestAffinityFlag(true),
       mObjStoreIoSerializeMetaRequestsFlag(false),
       mObjStoreBlockWriteBufferSize(5 << 20), // Min S3 multi part upload.
+      mObjStoreBlockWriteBufferCount(2),
       mObjStoreBufferDataIgnoreOverwriteFlag(true),
       mObjStoreMaxWritableBlocks(-1),
       mObjStoreBufferDataRatio(0.3),
@@ -1872,6 +1921,7 @@ ChunkManager::~ChunkManager()
 {
     assert(mChunkTable.IsEmpty());
     assert(mObjTable.IsEmpty());
+    ClearWriteTailBlocks();
     globalNetManager().UnRegisterTimeoutHandler(this);
 }
 
@@ -1939,11 +1989,13 @@ ChunkManager::Shutdown()
     gMetaServerSM.Shutdown();
     mDirChecker.Stop();
     gClientManager.Shutdown();
+    RunReadCacheHits();
     // Run delete queue before removing chunk table entries.
+    mStaleChunkDeleteBytesPerSec = 0;
     RunStaleChunksQueue();
     for (int i = 0; ;) {
         const bool completionFlag = DiskIo::RunIoCompletion();
-        if (mStaleChunkOpsInFlight <= 0) {
+        if (mStaleChunkOpsInFlight <= 0 && ! mScrubOp) {
             break;
         }
         if (completionFlag) {
@@ -1963,8 +2015,11 @@ ChunkManager::Shutdown()
         usleep(10000);
     }
     ScavengePendingWrites(time(0) + 2 * mMaxPendingWriteLruSecs);
+    WriteChunkInventory();
     ClearTable(mObjTable);
     ClearTable(mChunkTable);
+    mReadCache.Clear();
+    ClearWriteTailBlocks();
     gAtomicRecordAppendManager.Shutdown();
     RunIoCompletion(mObjTable);
     RunIoCompletion(mChunkTable);
@@ -1986,6 +2041,53 @@ ChunkManager::Shutdown()
     }
 }
 
+void
+ChunkManager::WriteChunkInventory()
+{
+    if (mChunkInventoryFileName.empty()) {
+        return;
+    }
+    // Write the list of stable chunks of each directory in use, in order to
+    // skip directory scan on restart. The directory checker validates the
+    // inventory against directory attributes before using it.
+    DirChecker::ChunkInfos infos;
+    for (ChunkDirs::iterator it = mChunkDirs.begin();
+            it != mChunkDirs.end();
+            ++it) {
+        if (it->availableSpace < 0) {
+            continue;
+        }
+        infos.Clear();
+        bool okFlag = true;
+        for (int i = 0; okFlag && i < ChunkDirInfo::kChunkDirListCount; i++) {
+            ChunkDirList::Iterator cit(it->chunkLists[i]);
+            ChunkInfoHandle* cih;
+            while ((cih = cit.Next())) {
+                if (cih->IsRenameInFlight() || cih->HasWritesInFlight()) {
+                    okFlag = false;
+                    break;
+                }
+                if (! cih->IsStable() || cih->IsStale() ||
+                        cih->chunkInfo.chunkVersion < 0) {
+                    continue;
+                }
+                DirChecker::ChunkInfo ci;
+                ci.mFileId       = cih->chunkInfo.fileId;
+                ci.mChunkId      = cih->chunkInfo.chunkId;
+                ci.mChunkVersion = cih->chunkInfo.chunkVersion;
+                ci.mChunkSize    = cih->chunkInfo.chunkSize;
+                infos.PushBack(ci);
+            }
+        }
+        if (okFlag) {
+            DirChecker::WriteInventory(
+                it->dirname, mChunkInventoryFileName, mFileSystemId, infos);
+        } else {
+            unlink((it->dirname + mChunkInventoryFileName).c_str());
+        }
+    }
+}
+
 bool
 ChunkManager::IsWriteAppenderOwns(
     kfsChunkId_t chunkId, int64_t chunkVersion) const
@@ -2022,6 +2124,14 @@ ChunkManager::SetParameters(const Properties& prop)
     mInactiveFdsCleanupIntervalSecs = max(0, (int)prop.getValue(
         "chunkServer.inactiveFdsCleanupIntervalSecs",
         (double)mInactiveFdsCleanupIntervalSecs));
+    mMaxClosedChunksChecksumsCount = (size_t)max(int64_t(0), prop.getValue(
+        "chunkServer.closedChunksChecksumsCacheBytes",
+        int64_t(mMaxClosedChunksChecksumsCount *
+            MAX_CHUNK_CHECKSUM_BLOCKS * sizeof(uint32_t)))) /
+        (MAX_CHUNK_CHECKSUM_BLOCKS * sizeof(uint32_t));
+    mMaxIdleOpenChunkFiles = max(0, prop.getValue(
+        "chunkServer.maxIdleOpenChunkFiles",
+        mMaxIdleOpenChunkFiles));
     mInactiveFdFullScanIntervalSecs = max(0, (int)prop.getValue(
         "chunkServer.inactiveFdFullScanIntervalSecs",
         (double)mInactiveFdFullScanIntervalSecs));
@@ -2064,6 +2174,35 @@ ChunkManager::SetParameters(const Properties& prop)
     mMaxStaleChunkOpsInFlight = prop.getValue(
         "chunkServer.maxStaleChunkOpsInFlight",
         mMaxStaleChunkOpsInFlight);
+    mStaleChunkDeleteBytesPerSec = prop.getValue(
+        "chunkServer.staleChunkDeleteBytesPerSec",
+        mStaleChunkDeleteBytesPerSec);
+    mScrubBytesPerSec = prop.getValue(
+        "chunkServer.scrubber.bytesPerSec",
+        mScrubBytesPerSec);
+    mScrubMinIntervalSec = prop.getValue(
+        "chunkServer.scrubber.minIntervalSec",
+        mScrubMinIntervalSec);
+    const double prevReadCacheBufferDataRatio = mReadCacheBufferDataRatio;
+    mReadCacheBufferDataRatio = max(double(0.0), min(double(0.995),
+        prop.getValue(
+        "chunkServer.readCache.bufferDataRatio",
+        mReadCacheBufferDataRatio)));
+    if (prevReadCacheBufferDataRatio != mReadCacheBufferDataRatio) {
+        mReadCacheMaxSize = -1;
+    }
+    mReadCacheObjStoreFlag = prop.getValue(
+        "chunkServer.readCache.objStoreBlocks",
+        mReadCacheObjStoreFlag ? 1 : 0) != 0;
+    mReadCoalescingFlag = prop.getValue(
+        "chunkServer.readCoalescing",
+        mReadCoalescingFlag ? 1 : 0) != 0;
+    mWriteTailBlocksMaxCount = (size_t)max(0, prop.getValue(
+        "chunkServer.writeTailBlocksMaxCount",
+        (int)mWriteTailBlocksMaxCount));
+    if (mWriteTailBlocksMaxCount <= 0) {
+        ClearWriteTailBlocks();
+    }
     mMaxDirCheckDiskTimeouts = prop.getValue(
         "chunkServer.maxDirCheckDiskTimeouts",
         mMaxDirCheckDiskTimeouts);
@@ -2089,6 +2228,9 @@ ChunkManager::SetParameters(const Properties& prop)
     mPlacementMaxWaitingAvgUsecsThreshold = (int64_t)(1e6 * prop.getValue(
         "chunkServer.placementMaxWaitingAvgSecsThreshold",
         (double)mPlacementMaxWaitingAvgUsecsThreshold * 1e-6));
+    mSaturatedDeviceWaitingAvgUsecsThreshold = (int64_t)(1e6 * prop.getValue(
+        "chunkServer.saturatedDeviceWaitingAvgSecsThreshold",
+        (double)mSaturatedDeviceWaitingAvgUsecsThreshold * 1e-6));
     mMaxPlacementSpaceRatio = prop.getValue(
         "chunkServer.maxPlacementSpaceRatio",
         mMaxPlacementSpaceRatio);
@@ -2128,6 +2270,12 @@ ChunkManager::SetParameters(const Properties& prop)
     mDirChecker.SetMaxChunkFilesSampled(prop.getValue(
         "chunkServer.dirCheckMaxChunkFilesSampled",
         mDirChecker.GetMaxChunkFilesSampled()));
+    mDirChecker.SetMaxThreadCount(prop.getValue(
+        "chunkServer.dirCheckMaxThreads",
+        mDirChecker.GetMaxThreadCount()));
+    mDirChecker.SetExtentSizeHint(prop.getValue(
+        "chunkServer.dirExtentSizeHint",
+        mDirChecker.GetExtentSizeHint()));
     mCleanupChunkDirsFlag = prop.getValue(
         "chunkServer.cleanupChunkDirs",
         mCleanupChunkDirsFlag);
@@ -2139,10 +2287,18 @@ ChunkManager::SetParameters(const Properties& prop)
     TcpSocket::SetDefaultSendBufSize(prop.getValue(
         "chunkServer.tcpSocket.sendBufSize",
         TcpSocket::GetDefaultSendBufSize()));
+    TcpSocket::SetDefaultBusyPollUsec(prop.getValue(
+        "chunkServer.tcpSocket.busyPollUsec",
+        TcpSocket::GetDefaultBusyPollUsec()));
+    NetManager::SetBusyPollUsec(prop.getValue(
+        "chunkServer.netManager.busyPollUsec",
+        NetManager::GetBusyPollUsec()));
 
     globalNetManager().SetMaxAcceptsPerRead(prop.getValue(
         "chunkServer.net.maxAcceptsPerRead",
         globalNetManager().GetMaxAcceptsPerRead()));
+    globalNetManager().SetProfileParameters(
+        prop, "chunkServer.netManager.profile.");
 
     DiskIo::SetParameters(prop);
     Replicator::SetParameters(prop);
@@ -2175,9 +2331,13 @@ ChunkManager::SetParameters(const Properties& prop)
     if (! mCheckDirWritableTmpFileName.empty()) {
         names.insert(mCheckDirWritableTmpFileName);
     }
+    if (! mChunkInventoryFileName.empty()) {
+        names.insert(mChunkInventoryFileName);
+    }
     mDirChecker.SetIgnoreFileNames(names);
 
     gAtomicRecordAppendManager.SetParameters(prop);
+    gLeaseClerk.SetParameters(prop);
 
     const time_t now = globalNetManager().Now();
     mNextGetFsSpaceAvailableTime = min(mNextGetFsSpaceAvailableTime,
@@ -2229,6 +2389,9 @@ ChunkManager::SetParameters(const Properties& prop)
     mObjStoreBlockWriteBufferSize = prop.getValue(
         "chunkServer.objStoreBlockWriteBufferSize",
         mObjStoreBlockWriteBufferSize);
+    mObjStoreBlockWriteBufferCount = max(1, prop.getValue(
+        "chunkServer.objStoreBlockWriteBufferCount",
+        mObjStoreBlockWriteBufferCount));
     mObjStoreIoThreadCount = prop.getValue(
         "chunkServer.objStoreIoThreadCount",
         mObjStoreIoThreadCount);
@@ -2266,6 +2429,9 @@ ChunkManager::SetParameters(const Properties& prop)
             " " << errMsg <<
         KFS_LOG_EOM;
     }
+    mChunkAccessTokenCache.SetSize(prop.getValue(
+        "chunkServer.chunkAccessTokenCacheSize",
+        mChunkAccessTokenCache.GetSize()));
     if (! mCryptoKeys.IsCurrentKeyValid()) {
         KFS_LOG_STREAM_ERROR <<
             "no valid current crypto key" <<
@@ -2512,6 +2678,15 @@ ChunkManager::Init(const vector<string>& chunkDirs, const Properties& prop)
     mChunkDirLockName = prop.getValue(
         "chunkServer.dirLockFileName",
         mChunkDirLockName);
+    mChunkInventoryFileName = prop.getValue(
+        "chunkServer.chunkInventoryFileName",
+        mChunkInventoryFileName);
+    if (mChunkInventoryFileName.find('/') != string::npos) {
+        KFS_LOG_STREAM_ERROR <<
+            "invalid chunk inventory file name: " << mChunkInventoryFileName <<
+        KFS_LOG_EOM;
+        return false;
+    }
     if (mStaleChunksDir.empty() || mStaleChunksDir.find('/') != string::npos) {
         KFS_LOG_STREAM_ERROR <<
             "invalid stale chunks dir name: " << mStaleChunksDir <<
@@ -2703,6 +2878,9 @@ ChunkManager::AllocChunk(
     // on a chunkserver restart.  This provides a very simple failure
     // handling model.
 
+    if (chunkVersion < 0 && 0 < mReadCache.GetSize()) {
+        mReadCache.Invalidate(chunkId, chunkVersion);
+    }
     const bool stableFlag = false;
     ChunkInfoHandle* const cih = new ChunkInfoHandle(*chunkdir, stableFlag);
     cih->chunkInfo.Init(fileId, chunkId, chunkVersion);
@@ -2939,6 +3117,9 @@ ChunkManager::DeleteChunk(kfsChunkId_t chunkId, int64_t chunkVersion, KfsOp* op)
         " readble: " << cih->IsChunkReadable() <<
     KFS_LOG_EOM;
     cih->SetForceDeleteObjectStoreBlock(chunkVersion < 0);
+    if (chunkVersion < 0 && 0 < mReadCache.GetSize()) {
+        mReadCache.Invalidate(chunkId, chunkVersion);
+    }
     const bool forceDeleteFlag = true;
     const bool evacuatedFlag   = false;
     return StaleChunk(cih, forceDeleteFlag, evacuatedFlag, op);
@@ -3445,6 +3626,9 @@ ChunkManager::ChangeChunkVers(
     bool             stableFlag,
     KfsCallbackObj*  cb)
 {
+    if (0 < mReadCache.GetSize()) {
+        mReadCache.Invalidate(cih->chunkInfo.chunkId);
+    }
     if (! cih->chunkInfo.AreChecksumsLoaded()) {
         KFS_LOG_STREAM_ERROR <<
             "attempt to change version on chunk: " <<
@@ -3620,8 +3804,9 @@ ChunkManager::GetDirForChunkT(T start, T end)
         }
         BufferManager* const bufMgr =
             DiskIo::GetDiskBufferManager(di.diskQueue);
-        if (bufMgr && bufMgr->GetWaitingAvgUsecs() >
-                mPlacementMaxWaitingAvgUsecsThreshold) {
+        if (bufMgr && (bufMgr->GetWaitingAvgUsecs() >
+                    mPlacementMaxWaitingAvgUsecsThreshold ||
+                IsDeviceSaturated(bufMgr))) {
             continue;
         }
         dirCount++;
@@ -3948,6 +4133,11 @@ ChunkManager::OpenChunk(ChunkInfoHandle* cih, int openFlags)
         return (tempFailureFlag ? -EAGAIN : -EBADF);
     }
     globals().ctrOpenDiskFds.Update(1);
+    if (openFlag) {
+        mCounters.mChunkOpenCount++;
+    } else {
+        mCounters.mChunkCreateCount++;
+    }
     LruUpdate(*cih);
     if (! cih->IsStable()) {
         cih->UpdateDirStableCount();
@@ -4145,6 +4335,8 @@ ChunkManager::ReadChunk(ReadOp* op)
     if (! d) {
         return -ESERVERBUSY;
     }
+    // Scrub and batch qos class reads should not delay client io.
+    d->SetLowPriority(op->scrubOp != 0 || op->lowPriorityFlag);
 
     op->diskIo.reset(d);
 
@@ -4172,9 +4364,28 @@ ChunkManager::ReadChunk(ReadOp* op)
         numBytesIO = cih->chunkInfo.chunkSize - offset;
     }
     op->diskIOTime = microseconds();
+    if (IsReadCacheable(cih, op)) {
+        if (mReadCache.Get(cih->chunkInfo.chunkId, cih->chunkInfo.chunkVersion,
+                offset, (int)numBytesIO, op->dataBuf)) {
+            if (mReadCacheHits.empty() && mCoalescedReadRetries.empty()) {
+                globalNetManager().RegisterTimeoutHandler(
+                    &mReadCacheCompletion);
+            }
+            mReadCacheHits.push_back(op);
+            globalNetManager().Wakeup();
+            return 0;
+        }
+        // Verify checksums of all blocks, in order to be able to put the
+        // data into the cache.
+        op->skipVerifyDiskChecksumFlag = false;
+    }
+    if (CoalesceRead(cih, op, offset, numBytesIO)) {
+        return 0;
+    }
     const int ret = op->diskIo->Read(
         offset + cih->chunkInfo.GetHeaderSize(), numBytesIO);
     if (ret < 0) {
+        ReadCoalescingDone(op);
         cih->ReadStats(ret, (int64_t)numBytesIO, 0);
         ReportIOFailure(cih, ret);
         return ret;
@@ -4229,14 +4440,17 @@ ChunkManager::WriteChunk(WriteOp* op, const DiskIo::FilePtr* filePtr /* = 0 */)
         return -ENOSPC;
     }
 
-    int64_t offset     = op->offset;
-    ssize_t numBytesIO = op->numBytesIO;
+    int64_t  offset     = op->offset;
+    ssize_t  numBytesIO = op->numBytesIO;
+    IOBuffer tail;
+    int64_t  tailOffset = -1;
     if ((OffsetToChecksumBlockStart(offset) == offset) &&
             ((size_t)numBytesIO >= (size_t)CHECKSUM_BLOCKSIZE)) {
         if (numBytesIO % CHECKSUM_BLOCKSIZE != 0) {
             op->statusMsg = "invalid request size";
             return -EINVAL;
         }
+        InvalidateWriteTailBlock(cih->chunkInfo.chunkId);
         if (op->wpop && ! op->isFromReReplication &&
                 op->checksums.size() ==
                     (size_t)(numBytesIO / CHECKSUM_BLOCKSIZE)) {
@@ -4272,6 +4486,14 @@ ChunkManager::WriteChunk(WriteOp* op, const DiskIo::FilePtr* filePtr /* = 0 */)
             data.ReplaceKeepBuffersFull(&op->dataBuf, off, numBytesIO);
             data.ZeroFill(blkSize - (off + numBytesIO));
             op->dataBuf.Move(&data);
+        } else if (! op->rop &&
+                GetWriteTailBlock(cih, offset - off, tail)) {
+            // The block was written by the previous small write, no need to
+            // read it back.
+            tail.ReplaceKeepBuffersFull(&op->dataBuf, off, numBytesIO);
+            op->dataBuf.Clear();
+            op->dataBuf.Move(&tail);
+            ZeroPad(&op->dataBuf);
         } else {
             // Need to read the data block over which the checksum is
             // computed.
@@ -4313,6 +4535,19 @@ ChunkManager::WriteChunk(WriteOp* op, const DiskIo::FilePtr* filePtr /* = 0 */)
 
         assert(op->dataBuf.BytesConsumable() == (int) blkSize);
         op->checksums = ComputeChecksums(&op->dataBuf, blkSize);
+        if (0 < mWriteTailBlocksMaxCount) {
+            // Retain the partial checksum block at the new end of chunk for
+            // the next small sequential write.
+            const int64_t end = offset + numBytesIO;
+            if (cih->chunkInfo.chunkSize <= end &&
+                    end % CHECKSUM_BLOCKSIZE != 0) {
+                tailOffset = OffsetToChecksumBlockStart(end);
+                const int skip = (int)(tailOffset - (offset - off));
+                tail.Clear();
+                tail.Copy(&op->dataBuf, (int)(end - (offset - off)));
+                tail.Consume(skip);
+            }
+        }
 
         // Trim data at the buffer boundary from the beginning, to make write
         // offset close to where we were asked from.
@@ -4327,6 +4562,9 @@ ChunkManager::WriteChunk(WriteOp* op, const DiskIo::FilePtr* filePtr /* = 0 */)
     if (! d) {
         return -ESERVERBUSY;
     }
+    // Re-replication, recovery, and batch qos class writes should not delay
+    // client io.
+    d->SetLowPriority(op->isFromReReplication || op->lowPriorityFlag);
     op->diskIo.reset(d);
 
     /*
@@ -4345,7 +4583,15 @@ ChunkManager::WriteChunk(WriteOp* op, const DiskIo::FilePtr* filePtr /* = 0 */)
         res = min(res, int(op->numBytesIO));
         op->numBytesIO = numBytesIO;
         cih->StartWrite(op);
+        if (0 <= tailOffset) {
+            PutWriteTailBlock(cih, tailOffset, cih->chunkInfo.chunkSize,
+                cih->chunkInfo.chunkBlockChecksum[
+                    OffsetToChecksumBlockNum(tailOffset)], tail);
+        } else {
+            InvalidateWriteTailBlock(cih->chunkInfo.chunkId);
+        }
     } else {
+        InvalidateWriteTailBlock(cih->chunkInfo.chunkId);
         op->diskIo.reset();
         cih->WriteStats(res, numBytesIO, 0);
         ReportIOFailure(cih, res);
@@ -4353,6 +4599,61 @@ ChunkManager::WriteChunk(WriteOp* op, const DiskIo::FilePtr* filePtr /* = 0 */)
     return res;
 }
 
+bool
+ChunkManager::GetWriteTailBlock(const ChunkInfoHandle* cih, int64_t offset,
+    IOBuffer& buf)
+{
+    if (mWriteTailBlocks.empty()) {
+        return false;
+    }
+    WriteTailBlocks::iterator const it =
+        mWriteTailBlocks.find(cih->chunkInfo.chunkId);
+    if (it == mWriteTailBlocks.end()) {
+        return false;
+    }
+    // The chunk size and block checksum must still match, in order to detect
+    // truncation or other changes since the block was retained.
+    WriteTailBlock& tb = *it->second;
+    if (tb.mChunkVersion != cih->chunkInfo.chunkVersion ||
+            tb.mOffset != offset ||
+            tb.mChunkSize != cih->chunkInfo.chunkSize ||
+            tb.mChecksum != cih->chunkInfo.chunkBlockChecksum[
+                OffsetToChecksumBlockNum(offset)]) {
+        EraseWriteTailBlock(it);
+        mCounters.mWriteTailMissCount++;
+        return false;
+    }
+    buf.Clear();
+    buf.Move(&tb.mBuf);
+    EraseWriteTailBlock(it);
+    mCounters.mWriteTailHitCount++;
+    return true;
+}
+
+void
+ChunkManager::PutWriteTailBlock(const ChunkInfoHandle* cih, int64_t offset,
+    int64_t chunkSize, uint32_t checksum, IOBuffer& buf)
+{
+    WriteTailBlocks::iterator it =
+        mWriteTailBlocks.find(cih->chunkInfo.chunkId);
+    if (it == mWriteTailBlocks.end()) {
+        // Entries are removed when chunks are released or deleted, the limit
+        // only bounds the buffers held with many chunks written concurrently.
+        if (mWriteTailBlocksMaxCount <= mWriteTailBlocks.size()) {
+            return;
+        }
+        it = mWriteTailBlocks.insert(
+            make_pair(cih->chunkInfo.chunkId, new WriteTailBlock())).first;
+    }
+    WriteTailBlock& tb = *it->second;
+    tb.mChunkVersion = cih->chunkInfo.chunkVersion;
+    tb.mOffset       = offset;
+    tb.mChunkSize    = chunkSize;
+    tb.mChecksum     = checksum;
+    tb.mBuf.Clear();
+    tb.mBuf.Move(&buf);
+}
+
 void
 ChunkManager::UpdateChecksums(ChunkInfoHandle *cih, WriteOp *op)
 {
@@ -4403,6 +4704,10 @@ ChunkManager::WriteDone(WriteOp* op)
 bool
 ChunkManager::ReadChunkDone(ReadOp* op)
 {
+    if (op->coalescingFlag) {
+        // Prevent more reads from joining, including while re-try in flight.
+        UnregisterCoalescingRead(op);
+    }
     const bool kAddObjectBlockMappingFlag = false;
     ChunkInfoHandle* const cih = GetChunkInfoHandle(
         op->chunkId, op->chunkVersion, kAddObjectBlockMappingFlag);
@@ -4707,6 +5012,13 @@ ChunkManager::ReadChunkDone(ReadOp* op)
         }
     }
     if (! mismatchFlag) {
+        if (! op->skipVerifyDiskChecksumFlag && IsReadCacheable(cih, op)) {
+            mReadCache.Put(cih->chunkInfo.chunkId, cih->chunkInfo.chunkVersion,
+                OffsetToChecksumBlockStart(op->offset), op->dataBuf);
+        }
+        if (op->coalescedReads) {
+            FanOutCoalescedReads(op);
+        }
         // for checksums to verify, we did reads in multiples of
         // checksum block sizes.  so, get rid of the extra
         cih->ReadStats(op->status, readLen, op->diskIOTime);
@@ -5467,9 +5779,27 @@ ChunkManager::RunStaleChunksQueue(bool completionFlag)
         assert(mStaleChunkOpsInFlight > 0);
         mStaleChunkOpsInFlight--;
     }
+    // Bound the rate of chunk file deletes, in order to prevent deletes from
+    // stalling disk io after deletion of large number of chunks. The byte
+    // budget is replenished every second, and allowed to go negative by at
+    // most one chunk.
+    const time_t now = globalNetManager().Now();
+    if (0 < mStaleChunkDeleteBytesPerSec) {
+        if (mStaleChunkDeleteCreditTime < now) {
+            mStaleChunkDeleteCredit = min(mStaleChunkDeleteBytesPerSec,
+                mStaleChunkDeleteCredit + mStaleChunkDeleteBytesPerSec *
+                (int64_t)(now - mStaleChunkDeleteCreditTime));
+            mStaleChunkDeleteCreditTime = now;
+        }
+    } else {
+        mStaleChunkDeleteCredit     = 0;
+        mStaleChunkDeleteCreditTime = now;
+    }
     ChunkList::Iterator it(mChunkInfoLists[kChunkStaleList]);
     ChunkInfoHandle* cih;
     while (mStaleChunkOpsInFlight < mMaxStaleChunkOpsInFlight &&
+            (mStaleChunkDeleteBytesPerSec <= 0 ||
+                0 < mStaleChunkDeleteCredit) &&
             (cih = it.Next())) {
         // If disk queue has been already stopped, then the queue directory
         // prefix has already been removed, and it will not be possible to
@@ -5508,6 +5838,10 @@ ChunkManager::RunStaleChunksQueue(bool completionFlag)
                         (ok ? " ok" : " error: ") << err <<
                         " in flight: " << mStaleChunkOpsInFlight <<
                     KFS_LOG_EOM;
+                    if (ok && 0 <= cih->chunkInfo.chunkVersion) {
+                        mStaleChunkDeleteCredit -= cih->chunkInfo.chunkSize +
+                            (int64_t)cih->chunkInfo.GetHeaderSize();
+                    }
                 }
                 if (ok) {
                     mStaleChunkOpsInFlight++;
@@ -5551,10 +5885,258 @@ ChunkManager::Timeout()
         SendChunkDirInfo();
         mNextSendChunDirInfoTime = now + mSendChunDirInfoIntervalSecs;
     }
+    if (0 < mStaleChunkDeleteBytesPerSec) {
+        RunStaleChunksQueue();
+    }
+    ScrubChunks(now);
     gLeaseClerk.Timeout();
     gAtomicRecordAppendManager.Timeout();
 }
 
+void
+ChunkManager::ScrubChunks(time_t now)
+{
+    if (mScrubBytesPerSec <= 0 || mScrubOp || now < mScrubNextTime ||
+            mChunkDirs.empty()) {
+        return;
+    }
+    // Scan a bounded number of entries at the front of each directory
+    // chunk list, and move each scanned entry to the back of the list, in
+    // order to visit all chunks in round robin order over time.
+    const int    kMaxScanPerDir = 64;
+    const size_t dirCount       = mChunkDirs.size();
+    for (size_t i = 0; i < dirCount; i++) {
+        if (dirCount <= ++mScrubDirIdx) {
+            mScrubDirIdx = 0;
+        }
+        ChunkDirInfo& dir = mChunkDirs[mScrubDirIdx];
+        if (dir.availableSpace < 0) {
+            continue;
+        }
+        for (int k = 0; k < kMaxScanPerDir; k++) {
+            ChunkInfoHandle* const cih = ChunkDirList::Front(
+                dir.chunkLists[ChunkDirInfo::kChunkDirList]);
+            if (! cih) {
+                break;
+            }
+            cih->MoveToChunkDirListBack();
+            if (! cih->IsChunkReadable() ||
+                    cih->IsStale() ||
+                    cih->IsBeingReplicated() ||
+                    cih->IsWriteAppenderOwns() ||
+                    cih->chunkInfo.chunkVersion < 0 ||
+                    cih->chunkInfo.chunkSize <= 0 ||
+                    now < cih->lastScrubTime + mScrubMinIntervalSec) {
+                continue;
+            }
+            cih->lastScrubTime = now;
+            GetChunkMetadataOp* const op = new GetChunkMetadataOp();
+            op->chunkId        = cih->chunkInfo.chunkId;
+            op->chunkVersion   = cih->chunkInfo.chunkVersion;
+            op->readVerifyFlag = true;
+            op->clnt           = &mScrubCompletion;
+            KFS_LOG_STREAM_DEBUG << "scrub start:"
+                " chunk: "   << op->chunkId <<
+                " version: " << op->chunkVersion <<
+                " size: "    << cih->chunkInfo.chunkSize <<
+                " dir: "     << dir.dirname <<
+            KFS_LOG_EOM;
+            // Completion might be invoked prior to Execute() return.
+            mScrubOp = op;
+            op->Execute();
+            return;
+        }
+    }
+}
+
+void
+ChunkManager::ScrubDone(GetChunkMetadataOp* op)
+{
+    assert(op && op == mScrubOp);
+    mScrubOp = 0;
+    mCounters.mScrubChunkCount++;
+    mCounters.mScrubByteCount += max(int64_t(0), op->numBytesScrubbed);
+    if (op->status < 0) {
+        mCounters.mScrubErrorCount++;
+        KFS_LOG_STREAM_ERROR << "scrub failed:"
+            " chunk: "    << op->chunkId <<
+            " version: "  << op->chunkVersion <<
+            " scrubbed: " << op->numBytesScrubbed <<
+            " status: "   << op->status <<
+            " "           << op->statusMsg <<
+        KFS_LOG_EOM;
+    }
+    // Space the next scrub start according to the configured bandwidth.
+    mScrubNextTime = globalNetManager().Now() + (time_t)(
+        max(int64_t(0), op->numBytesScrubbed) /
+        max(int64_t(1), mScrubBytesPerSec));
+    delete op;
+}
+
+bool
+ChunkManager::IsReadCacheable(const ChunkInfoHandle* cih, const ReadOp* op)
+{
+    if (mReadCacheMaxSize < 0) {
+        const BufferManager& bufMgr = DiskIo::GetBufferManager();
+        mReadCacheMaxSize = (int64_t)(
+            (bufMgr.GetBufferPoolTotalBytes() - bufMgr.GetTotalCount()) *
+            mReadCacheBufferDataRatio);
+        mReadCache.SetMaxSize(mReadCacheMaxSize);
+        KFS_LOG_STREAM_INFO <<
+            "read cache size: " << mReadCache.GetMaxSize() <<
+            " ratio: "          << mReadCacheBufferDataRatio <<
+        KFS_LOG_EOM;
+    }
+    // Only stable chunks and object store blocks content is cached, as it
+    // never changes. Scrub and re-try reads always go to disk.
+    return (mReadCache.IsEnabled() &&
+        ! op->scrubOp && ! op->wop && op->retryCnt <= 0 &&
+        (0 <= cih->chunkInfo.chunkVersion || mReadCacheObjStoreFlag) &&
+        cih->IsStable() && ! cih->IsStale() &&
+        ! cih->IsWriteAppenderOwns()
+    );
+}
+
+void
+ChunkManager::RunReadCacheHits()
+{
+    globalNetManager().UnRegisterTimeoutHandler(&mReadCacheCompletion);
+    mReadCacheHitsTmp.swap(mReadCacheHits);
+    while (! mReadCacheHitsTmp.empty()) {
+        ReadOp* const op = mReadCacheHitsTmp.front();
+        mReadCacheHitsTmp.pop_front();
+        // The data is already in the op buffer.
+        IOBuffer buf;
+        op->HandleEvent(EVENT_DISK_READ, &buf);
+    }
+    mReadCacheHitsTmp.swap(mCoalescedReadRetries);
+    while (! mReadCacheHitsTmp.empty()) {
+        ReadOp* const op = mReadCacheHitsTmp.front();
+        mReadCacheHitsTmp.pop_front();
+        op->dataBuf.Clear();
+        const int res = ReadChunk(op);
+        if (res < 0) {
+            op->status = res;
+            gLogger.Submit(op);
+        }
+    }
+}
+
+bool
+ChunkManager::IsReadCoalescable(
+    const ChunkInfoHandle* cih, const ReadOp* op) const
+{
+    // Stable chunks and object store blocks content never changes, therefore
+    // the data read by one op can be handed to others. Scrub and re-try reads
+    // always go to disk.
+    return (mReadCoalescingFlag &&
+        ! op->scrubOp && ! op->wop && op->retryCnt <= 0 &&
+        cih->IsStable() && ! cih->IsStale() &&
+        ! cih->IsWriteAppenderOwns()
+    );
+}
+
+bool
+ChunkManager::CoalesceRead(const ChunkInfoHandle* cih, ReadOp* op,
+    int64_t offset, size_t numBytesIO)
+{
+    if (! IsReadCoalescable(cih, op)) {
+        return false;
+    }
+    // Attach to the disk read in flight that already covers the checksum
+    // blocks range, if any, instead of issuing another disk read.
+    const int64_t end = offset + (int64_t)numBytesIO;
+    pair<CoalescingReads::iterator, CoalescingReads::iterator> const range =
+        mCoalescingReads.equal_range(cih->chunkInfo.chunkId);
+    for (CoalescingReads::iterator it = range.first;
+            it != range.second;
+            ++it) {
+        ReadOp& lop = *it->second;
+        if (lop.chunkVersion != op->chunkVersion ||
+                offset < OffsetToChecksumBlockStart(lop.offset) ||
+                min(cih->chunkInfo.chunkSize, (int64_t)OffsetToChecksumBlockEnd(
+                    lop.offset + lop.numBytesIO - 1)) < end) {
+            continue;
+        }
+        op->coalescedNext  = lop.coalescedReads;
+        lop.coalescedReads = op;
+        mCounters.mReadCoalescedCount++;
+        mCounters.mReadCoalescedByteCount += numBytesIO;
+        return true;
+    }
+    op->coalescingFlag = true;
+    mCoalescingReads.insert(make_pair(cih->chunkInfo.chunkId, op));
+    return false;
+}
+
+void
+ChunkManager::UnregisterCoalescingRead(ReadOp* op)
+{
+    pair<CoalescingReads::iterator, CoalescingReads::iterator> const range =
+        mCoalescingReads.equal_range(op->chunkId);
+    for (CoalescingReads::iterator it = range.first;
+            it != range.second;
+            ++it) {
+        if (it->second == op) {
+            mCoalescingReads.erase(it);
+            break;
+        }
+    }
+    op->coalescingFlag = false;
+}
+
+void
+ChunkManager::FanOutCoalescedReads(ReadOp* op)
+{
+    // The op buffer starts at checksum block boundary, and is zero padded to
+    // the checksum block boundary. Give each coalesced read its checksum
+    // blocks, the coalesced read completion verifies the checksums, the same
+    // way as with the read cache hit.
+    const int64_t start = OffsetToChecksumBlockStart(op->offset);
+    while (op->coalescedReads) {
+        ReadOp* const cop     = op->coalescedReads;
+        op->coalescedReads    = cop->coalescedNext;
+        cop->coalescedNext    = 0;
+        const int64_t  offset = OffsetToChecksumBlockStart(cop->offset);
+        const int      skip   = (int)(offset - start);
+        const int      len    = (int)(OffsetToChecksumBlockEnd(
+            cop->offset + cop->numBytesIO - 1) - offset);
+        IOBuffer buf;
+        buf.Copy(&op->dataBuf, skip + len);
+        buf.Consume(skip);
+        cop->dataBuf.Clear();
+        cop->dataBuf.Move(&buf);
+        if (mReadCacheHits.empty() && mCoalescedReadRetries.empty()) {
+            globalNetManager().RegisterTimeoutHandler(&mReadCacheCompletion);
+        }
+        mReadCacheHits.push_back(cop);
+    }
+    globalNetManager().Wakeup();
+}
+
+void
+ChunkManager::CoalescedReadsDone(ReadOp* op)
+{
+    if (op->coalescingFlag) {
+        UnregisterCoalescingRead(op);
+    }
+    // The op read failed, or did not verify the checksums, re-schedule the
+    // coalesced reads, if any.
+    if (! op->coalescedReads) {
+        return;
+    }
+    while (op->coalescedReads) {
+        ReadOp* const cop  = op->coalescedReads;
+        op->coalescedReads = cop->coalescedNext;
+        cop->coalescedNext = 0;
+        if (mReadCacheHits.empty() && mCoalescedReadRetries.empty()) {
+            globalNetManager().RegisterTimeoutHandler(&mReadCacheCompletion);
+        }
+        mCoalescedReadRetries.push_back(cop);
+    }
+    globalNetManager().Wakeup();
+}
+
 template<typename TT, typename WT> void
 ChunkManager::ScavengePendingWrites(
     time_t now, TT& table, WT& pendingWrites)
@@ -5655,6 +6237,19 @@ ChunkManager::CleanupInactiveFds(time_t now, const ChunkInfoHandle* cur)
         if (expireTime <= cih->lastIOTime) {
             break;
         }
+        if (releaseCnt <= 0 && 0 < mMaxIdleOpenChunkFiles &&
+                0 <= cih->chunkInfo.chunkVersion && cih->IsStable() &&
+                globals().ctrOpenDiskFds.GetValue() <=
+                    (int64_t)mMaxIdleOpenChunkFiles) {
+            // Keep the most recently used inactive stable chunk files open,
+            // in order not to re-open the files with random reads. The files
+            // are closed in lru order while the number of open files exceeds
+            // the limit. Do not scan the rest of the list on open.
+            if (cur) {
+                break;
+            }
+            continue;
+        }
         bool   hasLeaseFlag         = false;
         bool   writePendingFlag     = false;
         bool   objBlockMetaDownFlag = false;
@@ -5708,7 +6303,10 @@ ChunkManager::CleanupInactiveFds(time_t now, const ChunkInfoHandle* cur)
             " last io: "      << (now - cih->lastIOTime) << " sec. ago" <<
         KFS_LOG_EOM;
         const bool openFlag = releaseCnt > 0 && cih->IsFileOpen();
-        Release(*cih);
+        if (cih->IsFileOpen()) {
+            mCounters.mChunkInactiveCloseCount++;
+        }
+        ReleaseInactive(*cih);
         if (releaseCnt > 0 && openFlag && ! cih->IsFileOpen()) {
             if (--releaseCnt <= 0) {
                 break;
@@ -5727,6 +6325,38 @@ ChunkManager::CleanupInactiveFds(time_t now, const ChunkInfoHandle* cur)
     return fdsAvailableFlag;
 }
 
+void
+ChunkManager::ReleaseInactive(ChunkInfoHandle& cih)
+{
+    const bool keepChecksumsFlag = 0 < mMaxClosedChunksChecksumsCount &&
+        0 <= cih.chunkInfo.chunkVersion && cih.IsStable() &&
+        cih.chunkInfo.AreChecksumsLoaded();
+    Release(cih, keepChecksumsFlag);
+    if (! keepChecksumsFlag) {
+        return;
+    }
+    if (cih.IsFileOpen()) {
+        cih.chunkInfo.UnloadChecksums();
+        return;
+    }
+    mClosedChunksChecksums.push_back(ClosedChunkChecksums(
+        cih.chunkInfo.chunkId, cih.chunkInfo.chunkVersion, cih.lastIOTime));
+    // The queue might have entries for chunks that were re-opened, and closed
+    // again, or deleted; these are only discarded here. I/O time is used to
+    // determine if the entry corresponds to the most recent close.
+    while (mMaxClosedChunksChecksumsCount < mClosedChunksChecksums.size()) {
+        const ClosedChunkChecksums& entry = mClosedChunksChecksums.front();
+        ChunkInfoHandle** const ci = mChunkTable.Find(entry.chunkId);
+        if (ci && (*ci)->chunkInfo.chunkVersion == entry.chunkVersion &&
+                (*ci)->lastIOTime == entry.lastIOTime &&
+                ! (*ci)->IsFileOpen() && ! (*ci)->IsStale() &&
+                (*ci)->chunkInfo.AreChecksumsLoaded()) {
+            (*ci)->chunkInfo.UnloadChecksums();
+        }
+        mClosedChunksChecksums.pop_front();
+    }
+}
+
 typedef map<int64_t, int> FileSystemIdsCount;
 
 bool
@@ -5741,6 +6371,7 @@ ChunkManager::StartDiskIo()
         return false;
     }
     mDirChecker.SetLockFileName(mChunkDirLockName);
+    mDirChecker.SetInventoryFileName(mChunkInventoryFileName);
     // Ignore host fs errors and do not remove files / dirs on the initial load.
     mDirChecker.SetRemoveFilesFlag(false);
     mDirChecker.SetIgnoreErrorsFlag(true);
@@ -5872,10 +6503,11 @@ ChunkManager::StartDiskIo()
         tier.push_back(&(*it));
     }
     const int64_t kMaxFileSize         = KFS_CHUNK_HEADER_SIZE + CHUNKSIZE;
-    mObjStoreBufferDataMaxSizePerBlock = min(
-        (int)kMaxFileSize,
-        2 * mObjStoreBlockWriteBufferSize +
-            (int)(KFS_CHUNK_HEADER_SIZE + CHECKSUM_BLOCKSIZE)
+    mObjStoreBufferDataMaxSizePerBlock = (int)min(
+        kMaxFileSize,
+        (int64_t)mObjStoreBlockWriteBufferCount *
+            mObjStoreBlockWriteBufferSize +
+            (int64_t)(KFS_CHUNK_HEADER_SIZE + CHECKSUM_BLOCKSIZE)
     );
     // Ensure that device id for obj store will not collide with normal the host
     // file system ids issued by the directory checker, in order to detect
@@ -6023,6 +6655,14 @@ ChunkManager::SetFileSystemId(int64_t fileSystemId, bool deleteAllChunksFlag)
     return ret;
 }
 
+bool
+ChunkManager::IsDeviceSaturated(const BufferManager* devBufMgr) const
+{
+    return (devBufMgr && 0 < mSaturatedDeviceWaitingAvgUsecsThreshold &&
+        mSaturatedDeviceWaitingAvgUsecsThreshold <
+            devBufMgr->GetWaitingAvgUsecs());
+}
+
 int64_t
 ChunkManager::GetTotalSpace(
     int64_t&                        totalFsSpace,
@@ -6035,7 +6675,8 @@ ChunkManager::GetTotalSpace(
     int64_t*                        evacuateDoneByteCount,
     HelloMetaOp::LostChunkDirs*     lostChunkDirs,
     ChunkManager::StorageTiersInfo* tiersInfo,
-    int64_t*                        devWaitAvgUsec)
+    int64_t*                        devWaitAvgUsec,
+    int*                            saturatedDirs)
 {
     totalFsSpace           = 0;
     chunkDirs              = 0;
@@ -6053,6 +6694,9 @@ ChunkManager::GetTotalSpace(
     if (tiersInfo) {
         tiersInfo->clear();
     }
+    if (saturatedDirs) {
+        *saturatedDirs = 0;
+    }
     for (ChunkDirs::const_iterator it = mChunkDirs.begin();
             it < mChunkDirs.end(); ++it) {
         if (it->availableSpace < 0) {
@@ -6076,22 +6720,28 @@ ChunkManager::GetTotalSpace(
             if (it->availableSpace > mMinFsAvailableSpace &&
                     it->availableSpace >
                         it->totalSpace * mMaxSpaceUtilizationThreshold) {
-                writableDirs++;
                 const BufferManager* const bufMgr =
                     DiskIo::GetDiskBufferManager(it->diskQueue);
                 if (bufMgr) {
                     waitAvgUsec += bufMgr->GetWaitingAvgUsecs();
                     waitAvgCnt++;
                 }
-                if (tiersInfo) {
-                    StorageTierInfo& ti = (*tiersInfo)[it->storageTier];
-                    ti.mNotStableOpenCount += it->notStableOpenCount;
-                    ti.mChunkCount         += it->chunkCount;
-                    if (it->IsCountFsSpaceAvailable()) {
-                        tierSpaceAvailableCnt++;
-                        ti.mDeviceCount++;
-                        ti.mSpaceAvailable += it->availableSpace;
-                        ti.mTotalSpace     += it->totalSpace;
+                if (saturatedDirs && IsDeviceSaturated(bufMgr)) {
+                    // Report saturated directory as not writable, in order
+                    // to make meta server stop placing new chunks on it.
+                    (*saturatedDirs)++;
+                } else {
+                    writableDirs++;
+                    if (tiersInfo) {
+                        StorageTierInfo& ti = (*tiersInfo)[it->storageTier];
+                        ti.mNotStableOpenCount += it->notStableOpenCount;
+                        ti.mChunkCount         += it->chunkCount;
+                        if (it->IsCountFsSpaceAvailable()) {
+                            tierSpaceAvailableCnt++;
+                            ti.mDeviceCount++;
+                            ti.mSpaceAvailable += it->availableSpace;
+                            ti.mTotalSpace     += it->totalSpace;
+                        }
                     }
                 }
             }
@@ -33,9 +33,11 @@
 #include "KfsOps.h"
 #include "DiskIo.h"
 #include "DirChecker.h"
+#include "ChunkReadCache.h"
 
 #include "kfsio/ITimeout.h"
 #include "kfsio/CryptoKeys.h"
+#include "kfsio/ChunkAccessToken.h"
 #include "kfsio/PrngIsaac64.h"
 #include "common/LinearHash.h"
 #include "common/StdAllocator.h"
@@ -44,6 +46,7 @@
 #include <string>
 #include <set>
 #include <map>
+#include <deque>
 #include <boost/static_assert.hpp>
 
 namespace KFS
@@ -91,6 +94,16 @@ public:
         Counter mReadSkipDiskVerifyErrorCount;
         Counter mReadSkipDiskVerifyByteCount;
         Counter mReadSkipDiskVerifyChecksumByteCount;
+        Counter mScrubChunkCount;
+        Counter mScrubByteCount;
+        Counter mScrubErrorCount;
+        Counter mReadCoalescedCount;
+        Counter mReadCoalescedByteCount;
+        Counter mWriteTailHitCount;
+        Counter mWriteTailMissCount;
+        Counter mChunkOpenCount;
+        Counter mChunkCreateCount;
+        Counter mChunkInactiveCloseCount;
 
         void Clear()
         {
@@ -109,6 +122,16 @@ public:
             mReadSkipDiskVerifyErrorCount        = 0;
             mReadSkipDiskVerifyByteCount         = 0;
             mReadSkipDiskVerifyChecksumByteCount = 0;
+            mScrubChunkCount                     = 0;
+            mScrubByteCount                      = 0;
+            mScrubErrorCount                     = 0;
+            mReadCoalescedCount                  = 0;
+            mReadCoalescedByteCount              = 0;
+            mWriteTailHitCount                   = 0;
+            mWriteTailMissCount                  = 0;
+            mChunkOpenCount                      = 0;
+            mChunkCreateCount                    = 0;
+            mChunkInactiveCloseCount             = 0;
         }
     };
 
@@ -243,6 +266,14 @@ public:
     /// @param[in] op  The write op that just finished
     ///
     bool ReadChunkDone(ReadOp *op);
+    /// Read op completion: re-schedules the reads coalesced with the op, if
+    /// any, that have not received the data from the op's disk read.
+    void ReadCoalescingDone(ReadOp* op)
+    {
+        if (op->coalescingFlag || op->coalescedReads) {
+            CoalescedReadsDone(op);
+        }
+    }
     void ReplicationDone(kfsChunkId_t chunkId, int status,
         const DiskIo::FilePtr& filePtr);
     /// Determine the size of a chunk.
@@ -278,7 +309,8 @@ public:
         int* evacuateDoneChunkCount = 0, int64_t* evacuateDoneByteCount = 0,
         HelloMetaOp::LostChunkDirs* lostChunkDirs = 0,
         StorageTiersInfo* tiersInfo = 0,
-        int64_t* devWaitAvgUsec = 0);
+        int64_t* devWaitAvgUsec = 0,
+        int* saturatedDirs = 0);
     int64_t GetUsedSpace() const { return mUsedSpace; };
     long GetNumChunks() const { return mChunkTable.GetSize(); };
     long GetNumWritableChunks() const;
@@ -339,6 +371,9 @@ public:
     size_t GetMaxIORequestSize() const {
         return mMaxIORequestSize;
     }
+    /// Returns true if the device io buffers average wait time exceeds the
+    /// "saturated" threshold, i.e. the device io queue is backed up.
+    bool IsDeviceSaturated(const BufferManager* devBufMgr) const;
     void Shutdown();
     bool IsWriteAppenderOwns(kfsChunkId_t chunkId, int64_t chunkVersion) const;
 
@@ -348,6 +383,13 @@ public:
 
     void GetCounters(Counters& counters)
         { counters = mCounters; }
+    void GetReadCacheCounters(ChunkReadCache::Counters& counters,
+            int64_t& size, int64_t& maxSize) const
+    {
+        mReadCache.GetCounters(counters);
+        size    = mReadCache.GetSize();
+        maxSize = mReadCache.GetMaxSize();
+    }
 
     /// Utility function that sets up a disk connection for an
     /// I/O operation on a chunk.
@@ -409,6 +451,8 @@ public:
         kfsChunkId_t chunkId, int64_t chunkVersion);
     const CryptoKeys& GetCryptoKeys() const
         { return mCryptoKeys; }
+    ChunkAccessToken::Cache& GetChunkAccessTokenCache()
+        { return mChunkAccessTokenCache; }
     int64_t GetFileSystemId() const
         { return mFileSystemId; }
     bool SetFileSystemId(int64_t fileSystemId, bool deleteAllChunksFlag);
@@ -794,6 +838,55 @@ private:
         ChunkManager& mMgr;
     };
 
+    struct ScrubCompletion : public KfsCallbackObj
+    {
+        ScrubCompletion(
+            ChunkManager& m)
+            : KfsCallbackObj(),
+              mMgr(m)
+            { SET_HANDLER(this, &ScrubCompletion::Done); }
+        int Done(int /* code */, void* data) {
+            mMgr.ScrubDone(reinterpret_cast<GetChunkMetadataOp*>(data));
+            return 0;
+        }
+        ChunkManager& mMgr;
+    };
+
+    // Delivers read cache hits completion from the net manager loop, as the
+    // read op might not expect its completion to be invoked from ReadChunk().
+    struct ReadCacheCompletion : public ITimeout
+    {
+        ReadCacheCompletion(
+            ChunkManager& m)
+            : ITimeout(),
+              mMgr(m)
+            {}
+        virtual void Timeout()
+            { mMgr.RunReadCacheHits(); }
+        ChunkManager& mMgr;
+    };
+    typedef std::deque<ReadOp*> ReadCacheHits;
+    typedef std::multimap<kfsChunkId_t, ReadOp*> CoalescingReads;
+    // The last partial checksum block of a chunk written with a small write,
+    // used instead of reading the block back from disk by the next small
+    // write.
+    struct WriteTailBlock
+    {
+        WriteTailBlock()
+            : mChunkVersion(-1),
+              mOffset(-1),
+              mChunkSize(-1),
+              mChecksum(0),
+              mBuf()
+            {}
+        int64_t  mChunkVersion;
+        int64_t  mOffset;
+        int64_t  mChunkSize;
+        uint32_t mChecksum;
+        IOBuffer mBuf;
+    };
+    typedef map<kfsChunkId_t, WriteTailBlock*> WriteTailBlocks;
+
     bool StartDiskIo();
 
     /// Map from a chunk id to a chunk handle
@@ -877,6 +970,26 @@ private:
     int    mInactiveFdFullScanIntervalSecs;
     time_t mNextInactiveFdFullScanTime;
 
+    // Stable chunks with checksums kept loaded after the file close.
+    struct ClosedChunkChecksums
+    {
+        ClosedChunkChecksums(
+            kfsChunkId_t id      = -1,
+            int64_t      version = -1,
+            time_t       ioTime  = 0)
+            : chunkId(id),
+              chunkVersion(version),
+              lastIOTime(ioTime)
+            {}
+        kfsChunkId_t chunkId;
+        int64_t      chunkVersion;
+        time_t       lastIOTime;
+    };
+    typedef std::deque<ClosedChunkChecksums> ClosedChunksChecksums;
+    ClosedChunksChecksums mClosedChunksChecksums;
+    size_t                mMaxClosedChunksChecksumsCount;
+    int                   mMaxIdleOpenChunkFiles;
+
     int mReadChecksumMismatchMaxRetryCount;
     bool mAbortOnChecksumMismatchFlag; // For debugging
     bool mRequireChunkHeaderChecksumFlag;
@@ -885,12 +998,34 @@ private:
     StaleChunkCompletion mStaleChunkCompletion;
     int mStaleChunkOpsInFlight;
     int mMaxStaleChunkOpsInFlight;
+    int64_t mStaleChunkDeleteBytesPerSec;
+    int64_t mStaleChunkDeleteCredit;
+    time_t  mStaleChunkDeleteCreditTime;
+    ScrubCompletion     mScrubCompletion;
+    GetChunkMetadataOp* mScrubOp;
+    time_t              mScrubNextTime;
+    size_t              mScrubDirIdx;
+    int64_t             mScrubBytesPerSec;
+    int                 mScrubMinIntervalSec;
+    ChunkReadCache      mReadCache;
+    ReadCacheCompletion mReadCacheCompletion;
+    ReadCacheHits       mReadCacheHits;
+    ReadCacheHits       mReadCacheHitsTmp;
+    double              mReadCacheBufferDataRatio;
+    int64_t             mReadCacheMaxSize;
+    bool                mReadCacheObjStoreFlag;
+    CoalescingReads     mCoalescingReads;
+    ReadCacheHits       mCoalescedReadRetries;
+    bool                mReadCoalescingFlag;
+    WriteTailBlocks     mWriteTailBlocks;
+    size_t              mWriteTailBlocksMaxCount;
     int mMaxDirCheckDiskTimeouts;
     double mChunkPlacementPendingReadWeight;
     double mChunkPlacementPendingWriteWeight;
     double mMaxPlacementSpaceRatio;
     int64_t mMinPendingIoThreshold;
     int64_t mPlacementMaxWaitingAvgUsecsThreshold;
+    int64_t mSaturatedDeviceWaitingAvgUsecsThreshold;
     bool mAllowSparseChunksFlag;
     bool mBufferedIoFlag;
     bool mSyncChunkHeaderFlag;
@@ -908,6 +1043,7 @@ private:
     string     mEvacuateFileName;
     string     mEvacuateDoneFileName;
     string     mChunkDirLockName;
+    string     mChunkInventoryFileName;
     int        mEvacuationInactivityTimeout;
     time_t     mMetaHeartbeatTime;
     int64_t    mMetaEvacuateCount;
@@ -925,6 +1061,7 @@ private:
     bool       mForceVerifyDiskReadChecksumFlag;
     bool       mWritePrepareReplyFlag;
     CryptoKeys mCryptoKeys;
+    ChunkAccessToken::Cache mChunkAccessTokenCache;
     int64_t    mFileSystemId;
     string     mFileSystemIdSuffix;
     string     mFsIdFileNamePrefix;
@@ -937,6 +1074,7 @@ private:
     bool       mObjStoreIoRequestAffinityFlag;
     bool       mObjStoreIoSerializeMetaRequestsFlag;
     int        mObjStoreBlockWriteBufferSize;
+    int        mObjStoreBlockWriteBufferCount;
     bool       mObjStoreBufferDataIgnoreOverwriteFlag;
     int        mObjStoreMaxWritableBlocks;
     double     mObjStoreBufferDataRatio;
@@ -949,7 +1087,8 @@ private:
     ChunkHeaderBuffer mChunkHeaderBuffer;
 
     inline void Delete(ChunkInfoHandle& cih);
-    inline void Release(ChunkInfoHandle& cih);
+    inline void Release(ChunkInfoHandle& cih, bool keepChecksumsFlag = false);
+    void ReleaseInactive(ChunkInfoHandle& cih);
 
     /// When a checkpoint file is read, update the mChunkTable[] to
     /// include a mapping for cih->chunkInfo.chunkId.
@@ -1023,6 +1162,47 @@ private:
     void UpdateChecksums(ChunkInfoHandle *cih, WriteOp *op);
     bool IsChunkStable(const ChunkInfoHandle* cih) const;
     void RunStaleChunksQueue(bool completionFlag = false);
+    /// Background scrubber: verify one chunk at a time, rate limited by
+    /// mScrubBytesPerSec, re-scrub chunks no more often than
+    /// mScrubMinIntervalSec.
+    void ScrubChunks(time_t now);
+    void ScrubDone(GetChunkMetadataOp* op);
+    /// Returns true if the chunk data can be cached in the read cache.
+    bool IsReadCacheable(const ChunkInfoHandle* cih, const ReadOp* op);
+    void RunReadCacheHits();
+    /// Returns true if the read can share the disk read of another read of
+    /// the same chunk, or can be shared.
+    bool IsReadCoalescable(const ChunkInfoHandle* cih, const ReadOp* op) const;
+    bool CoalesceRead(const ChunkInfoHandle* cih, ReadOp* op,
+        int64_t offset, size_t numBytesIO);
+    void UnregisterCoalescingRead(ReadOp* op);
+    void FanOutCoalescedReads(ReadOp* op);
+    void CoalescedReadsDone(ReadOp* op);
+    bool GetWriteTailBlock(const ChunkInfoHandle* cih, int64_t offset,
+        IOBuffer& buf);
+    void PutWriteTailBlock(const ChunkInfoHandle* cih, int64_t offset,
+        int64_t chunkSize, uint32_t checksum, IOBuffer& buf);
+    void InvalidateWriteTailBlock(kfsChunkId_t chunkId)
+    {
+        if (! mWriteTailBlocks.empty()) {
+            EraseWriteTailBlock(mWriteTailBlocks.find(chunkId));
+        }
+    }
+    void EraseWriteTailBlock(WriteTailBlocks::iterator it)
+    {
+        if (it != mWriteTailBlocks.end()) {
+            delete it->second;
+            mWriteTailBlocks.erase(it);
+        }
+    }
+    void ClearWriteTailBlocks()
+    {
+        while (! mWriteTailBlocks.empty()) {
+            EraseWriteTailBlock(mWriteTailBlocks.begin());
+        }
+    }
+    /// Write per directory stable chunk inventory on shutdown.
+    void WriteChunkInventory();
     int OpenChunk(ChunkInfoHandle* cih, int openFlags);
     void SendChunkDirInfo();
     void SetStorageTiers(const Properties& props);
@@ -0,0 +1,278 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Chunk server in memory chunk data read cache.
+//
+//----------------------------------------------------------------------------
+
+#include "ChunkReadCache.h"
+
+#include "kfsio/checksum.h"
+#include "qcdio/qcdebug.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace KFS
+{
+
+using std::max;
+using std::min;
+using std::numeric_limits;
+
+// Frequency counters saturate at this value, and are all halved after the
+// number of increments exceeds the number of cache entries times the reset
+// ratio, in order to "forget" past accesses.
+const int kMaxFrequency        = 15;
+const int kFrequencyResetRatio = 10;
+const int kFrequenciesPerEntry = 4;
+const int kMinFrequenciesCount = 1 << 10;
+
+    static inline uint64_t
+HashKey(
+    kfsChunkId_t inChunkId,
+    int64_t      inVersion,
+    int64_t      inBlockIdx)
+{
+    uint64_t theHash = (uint64_t)inChunkId * 0x9E3779B97F4A7C15ULL;
+    theHash ^= (uint64_t)inVersion + 0x7F4A7C159E3779B9ULL +
+        (theHash << 6) + (theHash >> 2);
+    theHash ^= (uint64_t)inBlockIdx + 0x9E3779B97F4A7C15ULL +
+        (theHash << 6) + (theHash >> 2);
+    theHash ^= theHash >> 33;
+    theHash *= 0xFF51AFD7ED558CCDULL;
+    theHash ^= theHash >> 33;
+    return theHash;
+}
+
+ChunkReadCache::ChunkReadCache()
+    : mEntries(),
+      mMaxSize(0),
+      mSize(0),
+      mFrequencies(),
+      mFrequenciesMask(0),
+      mFrequencyIncrements(0),
+      mFrequencyResetThreshold(0),
+      mCounters()
+{
+    Lru::Init(mLruPtr);
+}
+
+ChunkReadCache::~ChunkReadCache()
+{
+    ChunkReadCache::Clear();
+}
+
+    void
+ChunkReadCache::SetMaxSize(
+    int64_t inMaxSize)
+{
+    mMaxSize = max(int64_t(0), inMaxSize);
+    while (mMaxSize < mSize && ! mEntries.empty()) {
+        Evict(mEntries.find(Lru::Back(mLruPtr)->mKey));
+    }
+    const int64_t theMaxEntries = mMaxSize / CHECKSUM_BLOCKSIZE;
+    size_t        theCount      = 0;
+    if (0 < theMaxEntries) {
+        theCount = kMinFrequenciesCount;
+        while ((int64_t)theCount < theMaxEntries * kFrequenciesPerEntry) {
+            theCount <<= 1;
+        }
+    }
+    if (theCount != mFrequencies.size()) {
+        Frequencies theTmp(theCount, uint8_t(0));
+        mFrequencies.swap(theTmp);
+        mFrequenciesMask     = 0 < theCount ? theCount - 1 : 0;
+        mFrequencyIncrements = 0;
+    }
+    mFrequencyResetThreshold = theMaxEntries * kFrequencyResetRatio;
+}
+
+    int
+ChunkReadCache::GetFrequency(
+    const Key& inKey) const
+{
+    if (mFrequencies.empty()) {
+        return 0;
+    }
+    const uint64_t theHash = HashKey(
+        inKey.mChunkId, inKey.mVersion, inKey.mBlockIdx);
+    return min(mFrequencies[(size_t)theHash & mFrequenciesMask],
+        mFrequencies[(size_t)(theHash >> 32) & mFrequenciesMask]);
+}
+
+    void
+ChunkReadCache::IncrementFrequency(
+    const Key& inKey)
+{
+    if (mFrequencies.empty()) {
+        return;
+    }
+    const uint64_t theHash = HashKey(
+        inKey.mChunkId, inKey.mVersion, inKey.mBlockIdx);
+    uint8_t& theFirst  = mFrequencies[(size_t)theHash & mFrequenciesMask];
+    uint8_t& theSecond =
+        mFrequencies[(size_t)(theHash >> 32) & mFrequenciesMask];
+    if (theFirst < kMaxFrequency) {
+        theFirst++;
+    }
+    if (theSecond < kMaxFrequency) {
+        theSecond++;
+    }
+    if (mFrequencyResetThreshold < ++mFrequencyIncrements) {
+        for (Frequencies::iterator theIt = mFrequencies.begin();
+                theIt != mFrequencies.end();
+                ++theIt) {
+            *theIt >>= 1;
+        }
+        mFrequencyIncrements = 0;
+    }
+}
+
+    bool
+ChunkReadCache::Get(
+    kfsChunkId_t inChunkId,
+    int64_t      inVersion,
+    int64_t      inOffset,
+    int          inSize,
+    IOBuffer&    outBuf)
+{
+    if (mMaxSize <= 0 || inSize <= 0 || inOffset < 0 ||
+            inOffset % CHECKSUM_BLOCKSIZE != 0) {
+        return false;
+    }
+    const int64_t theStart = inOffset / CHECKSUM_BLOCKSIZE;
+    const int64_t theEnd   =
+        (inOffset + inSize + CHECKSUM_BLOCKSIZE - 1) / CHECKSUM_BLOCKSIZE;
+    bool theHitFlag = true;
+    for (int64_t i = theStart; i < theEnd; i++) {
+        const Key theKey(inChunkId, inVersion, i);
+        IncrementFrequency(theKey);
+        if (theHitFlag && mEntries.find(theKey) == mEntries.end()) {
+            theHitFlag = false;
+        }
+    }
+    if (! theHitFlag) {
+        mCounters.mMissCount++;
+        return false;
+    }
+    Entries::iterator theIt =
+        mEntries.find(Key(inChunkId, inVersion, theStart));
+    for (int64_t i = theStart; i < theEnd; i++, ++theIt) {
+        QCASSERT(theIt != mEntries.end() && theIt->first.mBlockIdx == i);
+        Entry& theEntry = *theIt->second;
+        outBuf.Copy(&theEntry.mBuf, theEntry.mBuf.BytesConsumable());
+        Lru::PushFront(mLruPtr, theEntry);
+    }
+    mCounters.mHitCount++;
+    mCounters.mHitByteCount += inSize;
+    return true;
+}
+
+    void
+ChunkReadCache::Put(
+    kfsChunkId_t    inChunkId,
+    int64_t         inVersion,
+    int64_t         inOffset,
+    const IOBuffer& inBuf)
+{
+    const int theSize = inBuf.BytesConsumable();
+    if (mMaxSize < (int64_t)CHECKSUM_BLOCKSIZE || inOffset < 0 ||
+            inOffset % CHECKSUM_BLOCKSIZE != 0 ||
+            theSize % CHECKSUM_BLOCKSIZE != 0) {
+        return;
+    }
+    IOBuffer theBuf;
+    theBuf.Copy(&inBuf, theSize);
+    for (int64_t i = inOffset / CHECKSUM_BLOCKSIZE;
+            ! theBuf.IsEmpty();
+            i++) {
+        const Key               theKey(inChunkId, inVersion, i);
+        Entries::iterator const theIt = mEntries.find(theKey);
+        if (theIt != mEntries.end()) {
+            theBuf.Consume(CHECKSUM_BLOCKSIZE);
+            continue;
+        }
+        if (mMaxSize < mSize + (int64_t)CHECKSUM_BLOCKSIZE) {
+            Entry& theVictim = *Lru::Back(mLruPtr);
+            if (GetFrequency(theKey) <= GetFrequency(theVictim.mKey)) {
+                mCounters.mAdmitRejectCount++;
+                theBuf.Consume(CHECKSUM_BLOCKSIZE);
+                continue;
+            }
+            Evict(mEntries.find(theVictim.mKey));
+            mCounters.mEvictCount++;
+        }
+        Entry& theEntry = *(new Entry(theKey));
+        theEntry.mBuf.Move(&theBuf, CHECKSUM_BLOCKSIZE);
+        mEntries.insert(std::make_pair(theKey, &theEntry));
+        Lru::PushFront(mLruPtr, theEntry);
+        mSize += CHECKSUM_BLOCKSIZE;
+        mCounters.mInsertCount++;
+    }
+}
+
+    void
+ChunkReadCache::Invalidate(
+    kfsChunkId_t inChunkId)
+{
+    Entries::iterator theIt = mEntries.lower_bound(Key(inChunkId,
+        numeric_limits<int64_t>::min(), numeric_limits<int64_t>::min()));
+    while (theIt != mEntries.end() && theIt->first.mChunkId == inChunkId) {
+        Evict(theIt++);
+        mCounters.mInvalidateCount++;
+    }
+}
+
+    void
+ChunkReadCache::Invalidate(
+    kfsChunkId_t inChunkId,
+    int64_t      inVersion)
+{
+    Entries::iterator theIt = mEntries.lower_bound(
+        Key(inChunkId, inVersion, numeric_limits<int64_t>::min()));
+    while (theIt != mEntries.end() && theIt->first.mChunkId == inChunkId &&
+            theIt->first.mVersion == inVersion) {
+        Evict(theIt++);
+        mCounters.mInvalidateCount++;
+    }
+}
+
+    void
+ChunkReadCache::Evict(
+    ChunkReadCache::Entries::iterator inIt)
+{
+    QCASSERT(inIt != mEntries.end());
+    Entry* const theEntryPtr = inIt->second;
+    mEntries.erase(inIt);
+    Lru::Remove(mLruPtr, *theEntryPtr);
+    mSize -= CHECKSUM_BLOCKSIZE;
+    delete theEntryPtr;
+}
+
+    void
+ChunkReadCache::Clear()
+{
+    while (! mEntries.empty()) {
+        Evict(mEntries.begin());
+    }
+    QCASSERT(mSize == 0);
+}
+
+} // namespace KFS
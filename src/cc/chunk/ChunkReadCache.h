@@ -0,0 +1,190 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Chunk server in memory chunk data read cache.
+//
+//----------------------------------------------------------------------------
+
+#ifndef CHUNK_READ_CACHE_H
+#define CHUNK_READ_CACHE_H
+
+#include "common/kfstypes.h"
+#include "common/StdAllocator.h"
+#include "kfsio/IOBuffer.h"
+#include "qcdio/QCDLList.h"
+
+#include <stdint.h>
+
+#include <map>
+#include <vector>
+
+namespace KFS
+{
+
+// Cache of checksum verified, checksum block size and aligned stable chunk
+// data blocks. Stable chunk content never changes, and the chunk version is
+// part of the key, therefore invalidation is not required for consistency.
+// Invalidate() is used to release the memory used by deleted, stale, and
+// re-versioned chunks, and by re-written or deleted object store blocks.
+// Blocks are evicted in LRU order. The block admission is based on access
+// frequency estimated with a small counting sketch (TinyLFU): when the cache
+// is full, a new block replaces the least recently used block only if the
+// new block was accessed more frequently.
+class ChunkReadCache
+{
+public:
+    struct Counters
+    {
+        typedef int64_t Counter;
+
+        Counter mHitCount;
+        Counter mHitByteCount;
+        Counter mMissCount;
+        Counter mInsertCount;
+        Counter mEvictCount;
+        Counter mAdmitRejectCount;
+        Counter mInvalidateCount;
+
+        Counters()
+            : mHitCount(0),
+              mHitByteCount(0),
+              mMissCount(0),
+              mInsertCount(0),
+              mEvictCount(0),
+              mAdmitRejectCount(0),
+              mInvalidateCount(0)
+            {}
+        void Clear()
+            { *this = Counters(); }
+    };
+
+    ChunkReadCache();
+    ~ChunkReadCache();
+    void SetMaxSize(
+        int64_t inMaxSize);
+    int64_t GetMaxSize() const
+        { return mMaxSize; }
+    int64_t GetSize() const
+        { return mSize; }
+    bool IsEnabled() const
+        { return (0 < mMaxSize); }
+    // Appends the blocks covering [inOffset, inOffset + inSize) to outBuf,
+    // if all blocks are in the cache. The offset must be checksum block
+    // aligned. The last block is always returned zero padded to the checksum
+    // block size.
+    bool Get(
+        kfsChunkId_t inChunkId,
+        int64_t      inVersion,
+        int64_t      inOffset,
+        int          inSize,
+        IOBuffer&    outBuf);
+    // Adds the checksum block aligned, verified and zero padded data read at
+    // inOffset. The buffers are shared, not copied.
+    void Put(
+        kfsChunkId_t    inChunkId,
+        int64_t         inVersion,
+        int64_t         inOffset,
+        const IOBuffer& inBuf);
+    void Invalidate(
+        kfsChunkId_t inChunkId);
+    void Invalidate(
+        kfsChunkId_t inChunkId,
+        int64_t      inVersion);
+    void Clear();
+    void GetCounters(
+        Counters& outCounters) const
+        { outCounters = mCounters; }
+private:
+    struct Key
+    {
+        Key(
+            kfsChunkId_t inChunkId = -1,
+            int64_t      inVersion = -1,
+            int64_t      inBlockIdx = -1)
+            : mChunkId(inChunkId),
+              mVersion(inVersion),
+              mBlockIdx(inBlockIdx)
+            {}
+        bool operator<(
+            const Key& inRhs) const
+        {
+            return (mChunkId < inRhs.mChunkId || (mChunkId == inRhs.mChunkId &&
+                (mVersion < inRhs.mVersion || (mVersion == inRhs.mVersion &&
+                mBlockIdx < inRhs.mBlockIdx))));
+        }
+        kfsChunkId_t mChunkId;
+        int64_t      mVersion;
+        int64_t      mBlockIdx;
+    };
+    class Entry
+    {
+    public:
+        Entry(
+            const Key& inKey)
+            : mKey(inKey),
+              mBuf()
+            { List::Init(*this); }
+        const Key mKey;
+        IOBuffer  mBuf;
+    private:
+        Entry* mPrevPtr[1];
+        Entry* mNextPtr[1];
+        friend class QCDLListOp<Entry>;
+        typedef QCDLListOp<Entry> List;
+    private:
+        Entry(
+            const Entry& inEntry);
+        Entry& operator=(
+            const Entry& inEntry);
+    };
+    typedef QCDLList<Entry> Lru;
+    typedef std::map<
+        Key,
+        Entry*,
+        std::less<Key>,
+        StdFastAllocator<std::pair<const Key, Entry*> >
+    > Entries;
+    typedef std::vector<uint8_t> Frequencies;
+
+    Entries     mEntries;
+    Entry*      mLruPtr[1];
+    int64_t     mMaxSize;
+    int64_t     mSize;
+    Frequencies mFrequencies;
+    size_t      mFrequenciesMask;
+    int64_t     mFrequencyIncrements;
+    int64_t     mFrequencyResetThreshold;
+    Counters    mCounters;
+
+    int  GetFrequency(
+        const Key& inKey) const;
+    void IncrementFrequency(
+        const Key& inKey);
+    void Evict(
+        Entries::iterator inIt);
+private:
+    ChunkReadCache(
+        const ChunkReadCache& inCache);
+    ChunkReadCache& operator=(
+        const ChunkReadCache& inCache);
+};
+
+} // namespace KFS
+
+#endif /* CHUNK_READ_CACHE_H */
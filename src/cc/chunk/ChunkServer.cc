@@ -31,16 +31,23 @@
 #include "ChunkManager.h"
 #include "MetaServerSM.h"
 #include "Logger.h"
+#include "KfsOps.h"
 #include "utils.h"
 
 #include "common/MsgLogger.h"
 #include "kfsio/Globals.h"
+#include "kfsio/MetricsServer.h"
 #include "qcdio/qcstutils.h"
+#include "qcdio/QCUtils.h"
+
+#include <sstream>
 
 namespace KFS {
 
 using std::string;
+using std::ostringstream;
 using libkfsio::globalNetManager;
+using libkfsio::globals;
 
 
 ChunkServer gChunkServer;
@@ -51,7 +58,8 @@ ChunkServer::Init(
     bool                  ipV6OnlyFlag,
     const string&         serverIp,
     int                   threadCount,
-    int                   firstCpuIdx)
+    int                   firstCpuIdx,
+    int                   inheritedListenerFd)
 {
     if (clientListener.port < 0) {
         KFS_LOG_STREAM_FATAL <<
@@ -90,7 +98,8 @@ ChunkServer::Init(
                 ipV6OnlyFlag,
                 threadCount,
                 firstCpuIdx,
-                mMutex) ||
+                mMutex,
+                inheritedListenerFd) ||
             gClientManager.GetPort() <= 0) {
         KFS_LOG_STREAM_FATAL <<
             "failed to bind acceptor to: " << clientListener <<
@@ -135,6 +144,59 @@ private:
         const ClientThreadVerifier&);
 };
 
+// Exports the heartbeat counters, and the counter manager counters.
+class ChunkServerMetrics : public MetricsServer::Source
+{
+public:
+    ChunkServerMetrics()
+        : MetricsServer::Source(),
+          mServer(*this),
+          mStr(),
+          mStream()
+        {}
+    virtual ~ChunkServerMetrics()
+        { mServer.Shutdown(); }
+    void SetParameters(
+        const Properties& props)
+    {
+        const int err = mServer.SetParameters(
+            props, "chunkServer.metrics.", globalNetManager());
+        if (err) {
+            KFS_LOG_STREAM_ERROR <<
+                "failed to start metrics server: " <<
+                    QCUtils::SysError(-err) <<
+            KFS_LOG_EOM;
+        }
+    }
+    void Shutdown()
+        { mServer.Shutdown(); }
+    virtual void GetMetrics(
+        MetricsServer::Writer& writer)
+    {
+        const char* const kPrefix = "qfs_chunkserver_";
+        mStream.str(string());
+        ostream* os[2] = { &mStream, 0 };
+        HeartbeatOp::AppendCounters(os);
+        globals().counterManager.Show(mStream);
+        const bool kTraceFlag = false;
+        globalNetManager().ShowProfile(mStream, kTraceFlag);
+        mStr = mStream.str();
+        mStream.str(string());
+        writer.Records(kPrefix, mStr.data(), mStr.data() + mStr.size(),
+            ':', "\r\n");
+        mStr.clear();
+    }
+private:
+    MetricsServer mServer;
+    string        mStr;
+    ostringstream mStream;
+private:
+    ChunkServerMetrics(
+        const ChunkServerMetrics&);
+    ChunkServerMetrics& operator=(
+        const ChunkServerMetrics&);
+};
+
 bool
 ChunkServer::MainLoop(
     const vector<string>& chunkDirs,
@@ -163,6 +225,8 @@ ChunkServer::MainLoop(
         return false;
     }
     gMetaServerSM.Init();
+    ChunkServerMetrics metrics;
+    metrics.SetParameters(props);
     {
         ClientThreadVerifier verifier(mMutex);
         QCStMutexUnlocker    unlocker(mMutex);
@@ -173,6 +237,7 @@ ChunkServer::MainLoop(
             mMutex ? &verifier : 0
         );
     }
+    metrics.Shutdown();
     Replicator::CancelAll();
     gClientManager.Stop();
     mRemoteSyncers.ReleaseAllServers();
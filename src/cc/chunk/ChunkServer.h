@@ -59,7 +59,8 @@ public:
         bool                  ipV6OnlyFlag,
         const string&         serverIp,
         int                   threadCount,
-        int                   firstCpuIdx);
+        int                   firstCpuIdx,
+        int                   inheritedListenerFd = -1);
     bool MainLoop(
         const vector<string>& chunkDirs,
         const Properties&     props,
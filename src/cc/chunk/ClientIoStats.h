@@ -0,0 +1,169 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/14
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Bounded per client io counters for "noisy neighbor" detection.
+//
+//----------------------------------------------------------------------------
+
+#ifndef CHUNK_CLIENT_IO_STATS_H
+#define CHUNK_CLIENT_IO_STATS_H
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <utility>
+
+namespace KFS
+{
+using std::string;
+using std::vector;
+using std::map;
+using std::make_pair;
+
+// Tracks the heaviest clients, keyed by authenticated user id or client host,
+// with the "space saving" top-k algorithm: at most max count entries are
+// kept, and a new client replaces the entry with the smallest weight. The
+// replacement inherits the replaced entry weight, which is the upper bound
+// of the weight over-estimate, reported as the entry error. Any client with
+// the weight greater than the total weight divided by max count is
+// guaranteed to be present.
+// The weight of each request is the number of bytes read or written plus
+// the per op weight, in order to account for the io cost of the small
+// requests.
+// The methods are not thread safe.
+class ClientIoStats
+{
+public:
+    struct Entry
+    {
+        Entry(
+            const string& inKey = string())
+            : mKey(inKey),
+              mWeight(0),
+              mError(0),
+              mReadBytes(0),
+              mWriteBytes(0),
+              mOpCount(0),
+              mErrorCount(0)
+            {}
+        bool operator<(
+            const Entry& inRhs) const
+            { return (inRhs.mWeight < mWeight); } // Heaviest first.
+        string  mKey;
+        int64_t mWeight;
+        int64_t mError;
+        int64_t mReadBytes;
+        int64_t mWriteBytes;
+        int64_t mOpCount;
+        int64_t mErrorCount;
+    };
+    typedef vector<Entry> Entries;
+
+    ClientIoStats()
+        : mEntries(),
+          mIndex(),
+          mMaxCount(32),
+          mOpWeight(64 << 10)
+        {}
+    void SetParameters(
+        int     inMaxCount,
+        int64_t inOpWeight)
+    {
+        mOpWeight = std::max(int64_t(0), inOpWeight);
+        const size_t theMaxCount = (size_t)std::max(0, inMaxCount);
+        if (theMaxCount == mMaxCount) {
+            return;
+        }
+        mMaxCount = theMaxCount;
+        if (mMaxCount < mEntries.size()) {
+            Clear();
+        }
+    }
+    void Update(
+        const string& inKey,
+        int64_t       inReadBytes,
+        int64_t       inWriteBytes,
+        bool          inErrorFlag)
+    {
+        if (mMaxCount <= 0 || inKey.empty()) {
+            return;
+        }
+        size_t                theIdx;
+        Index::iterator const theIt = mIndex.find(inKey);
+        if (theIt != mIndex.end()) {
+            theIdx = theIt->second;
+        } else if (mEntries.size() < mMaxCount) {
+            theIdx = mEntries.size();
+            mEntries.push_back(Entry(inKey));
+            mIndex.insert(make_pair(inKey, theIdx));
+        } else {
+            theIdx = 0;
+            for (size_t i = 1; i < mEntries.size(); i++) {
+                if (mEntries[i].mWeight < mEntries[theIdx].mWeight) {
+                    theIdx = i;
+                }
+            }
+            Entry& theEntry = mEntries[theIdx];
+            mIndex.erase(theEntry.mKey);
+            const int64_t theWeight = theEntry.mWeight;
+            theEntry = Entry(inKey);
+            theEntry.mWeight = theWeight;
+            theEntry.mError  = theWeight;
+            mIndex.insert(make_pair(inKey, theIdx));
+        }
+        Entry& theEntry = mEntries[theIdx];
+        const int64_t theRead  = std::max(int64_t(0), inReadBytes);
+        const int64_t theWrite = std::max(int64_t(0), inWriteBytes);
+        theEntry.mWeight     += theRead + theWrite + mOpWeight;
+        theEntry.mReadBytes  += theRead;
+        theEntry.mWriteBytes += theWrite;
+        theEntry.mOpCount++;
+        if (inErrorFlag) {
+            theEntry.mErrorCount++;
+        }
+    }
+    // Returns entries sorted by weight, heaviest first.
+    void Get(
+        Entries& outEntries) const
+    {
+        outEntries = mEntries;
+        std::sort(outEntries.begin(), outEntries.end());
+    }
+    void Clear()
+    {
+        mEntries.clear();
+        mIndex.clear();
+    }
+private:
+    typedef map<string, size_t> Index;
+
+    Entries mEntries;
+    Index   mIndex;
+    size_t  mMaxCount;
+    int64_t mOpWeight;
+};
+
+}
+
+#endif /* CHUNK_CLIENT_IO_STATS_H */
@@ -44,6 +44,7 @@
 namespace KFS
 {
 using std::max;
+using std::min;
 
 using libkfsio::globalNetManager;
 
@@ -53,6 +54,7 @@ public:
     Auth()
         : mSslCtxPtr(),
           mParams(),
+          mClearTextMacMode(0),
           mEnabledFlag(false)
         {}
     ~Auth()
@@ -108,6 +110,9 @@ public:
         if (thePskSslChangedFlag) {
             mSslCtxPtr = theSslCtxPtr;
         }
+        mClearTextMacMode = max(0, min(2, theParams.getValue(
+            theParamName.Truncate(thePrefLen).Append(
+            "clearTextMac"), mClearTextMacMode)));
         mParams.swap(theParams);
         mEnabledFlag = mSslCtxPtr && theEnabledFlag;
         return true;
@@ -158,15 +163,19 @@ public:
     {
         mSslCtxPtr.reset();
         mParams.clear();
-        mEnabledFlag = false;
+        mClearTextMacMode = 0;
+        mEnabledFlag      = false;
     }
     bool IsEnabled() const
         { return mEnabledFlag; }
+    int GetClearTextMacMode() const
+        { return mClearTextMacMode; }
 private:
     typedef SslFilter::CtxPtr SslCtxPtr;
 
     SslCtxPtr  mSslCtxPtr;
     Properties mParams;
+    int        mClearTextMacMode;
     bool       mEnabledFlag;
 private:
     Auth(
@@ -183,6 +192,8 @@ ClientManager::ClientManager()
       mIdleTimeoutSec(10 * 60),
       mMaxClientCount(64 << 10),
       mCounters(),
+      mIoStats(),
+      mThrottle(),
       mAuth(*(new Auth)),
       mCurThreadIdx(0),
       mFirstClientThreadIndex(0),
@@ -206,7 +217,8 @@ ClientManager::BindAcceptor(
     bool                  ipV6OnlyFlag,
     int                   inThreadCount,
     int                   inFirstCpuIdx,
-    QCMutex*&             outMutexPtr)
+    QCMutex*&             outMutexPtr,
+    int                   inInheritedListenerFd)
 {
     Stop();
     delete mAcceptorPtr;
@@ -216,7 +228,8 @@ ClientManager::BindAcceptor(
     mThreadCount = 0;
     const bool kBindOnlyFlag = true;
     mAcceptorPtr = new Acceptor(
-        globalNetManager(), clientListener, ipV6OnlyFlag, this, kBindOnlyFlag);
+        globalNetManager(), clientListener, ipV6OnlyFlag, this, kBindOnlyFlag,
+        inInheritedListenerFd);
     const bool theOkFlag = mAcceptorPtr->IsAcceptorStarted();
     if (theOkFlag && 0 < inThreadCount) {
         static QCMutex sOpsMutex;
@@ -298,6 +311,16 @@ ClientManager::SetParameters(
     mFirstClientThreadIndex =
         inProps.getValue(theParamName.Truncate(thePrefLen).Append(
         "firstClientThreadIndex"), mFirstClientThreadIndex);
+    mIoStats.SetParameters(
+        inProps.getValue(theParamName.Truncate(thePrefLen).Append(
+            "ioStatsMaxCount"), 32),
+        inProps.getValue(theParamName.Truncate(thePrefLen).Append(
+            "ioStatsOpWeight"), int64_t(64 << 10))
+    );
+    mThrottle.SetParameters(
+        theParamName.Truncate(thePrefLen).Append("throttle.").GetPtr(),
+        inProps
+    );
     mMaxClientCount = inMaxClientCount;
     return mAuth.SetParameters(
         theParamName.Truncate(thePrefLen).Append("auth.").GetPtr(),
@@ -325,6 +348,12 @@ ClientManager::IsAuthEnabled() const
     return mAuth.IsEnabled();
 }
 
+    int
+ClientManager::GetClearTextMacMode() const
+{
+    return mAuth.GetClearTextMacMode();
+}
+
     void
 ClientManager::Shutdown()
 {
@@ -333,6 +362,7 @@ ClientManager::Shutdown()
     delete mAcceptorPtr;
     mAcceptorPtr = 0;
     mAuth.Clear();
+    mThrottle.Shutdown();
 }
 
     ClientThread*
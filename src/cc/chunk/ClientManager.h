@@ -31,6 +31,8 @@
 #include <inttypes.h>
 #include "kfsio/Acceptor.h"
 #include "KfsOps.h"
+#include "ClientIoStats.h"
+#include "ClientThrottle.h"
 
 class QCMutex;
 
@@ -70,6 +72,7 @@ public:
         Counter mAppendRequestBytes;
         Counter mAppendRequestErrors;
         Counter mWaitTimeExceededCount;
+        Counter mDeviceSaturatedCount;
         Counter mDiscardedBytesCount;
         Counter mOverClientLimitCount;
 
@@ -97,6 +100,7 @@ public:
             mAppendRequestBytes         = 0;
             mAppendRequestErrors        = 0;
             mWaitTimeExceededCount      = 0;
+            mDeviceSaturatedCount       = 0;
             mDiscardedBytesCount        = 0;
             mOverClientLimitCount       = 0;
         }
@@ -108,12 +112,28 @@ public:
         bool                  ipV6OnlyFlag,
         int                   inThreadCount,
         int                   inFirstCpuIdx,
-        QCMutex*&             outMutexPtr);
+        QCMutex*&             outMutexPtr,
+        int                   inInheritedListenerFd = -1);
     bool StartListening();
     virtual KfsCallbackObj* CreateKfsCallbackObj(
         NetConnectionPtr& inConnPtr);
     void GetCounters(
         Counters& outCounters) const;
+    void GetIoStats(
+        ClientIoStats::Entries& outEntries) const
+        { mIoStats.Get(outEntries); }
+    bool Throttle(
+        ClientThrottle::Client&   inClient,
+        const string&             inKey,
+        int64_t                   inByteCount,
+        ClientThrottle::QosClass& outQosClass)
+        { return mThrottle.Admit(inClient, inKey, inByteCount, outQosClass); }
+    void CancelThrottle(
+        ClientThrottle::Client& inClient)
+        { mThrottle.Cancel(inClient); }
+    void GetThrottleCounters(
+        ClientThrottle::Counters& outCounters) const
+        { mThrottle.GetCounters(outCounters); }
     bool SetParameters(
         const char*       inParamsPrefixPtr,
         const Properties& inProps,
@@ -124,6 +144,8 @@ public:
         { return mIoTimeoutSec; }
     int GetPort() const
         { return (mAcceptorPtr ? mAcceptorPtr->GetPort() : -1); }
+    int DupListener() const
+        { return (mAcceptorPtr ? mAcceptorPtr->DupListener() : -ENOTCONN); }
     void Stop();
     void Remove(
         ClientSM* /* inClientPtr */)
@@ -141,9 +163,12 @@ public:
         { mCounters.mIdleTimeoutCount++; }
     void WaitTimeExceeded()
         { mCounters.mWaitTimeExceededCount++; }
+    void DeviceSaturated()
+        { mCounters.mDeviceSaturatedCount++; }
     void RequestDone(
-        int64_t      inRequestTimeMicroSecs,
-        const KfsOp& inOp)
+        int64_t       inRequestTimeMicroSecs,
+        const KfsOp&  inOp,
+        const string& inClientKey)
     {
         const int64_t theTime =
             inRequestTimeMicroSecs > 0 ? inRequestTimeMicroSecs : 0;
@@ -157,8 +182,10 @@ public:
                     if (theLen > 0) {
                         mCounters.mReadRequestBytes += theLen;
                     }
+                    mIoStats.Update(inClientKey, theLen, 0, false);
                 } else {
                     mCounters.mReadRequestErrors++;
+                    mIoStats.Update(inClientKey, 0, 0, true);
                 }
             break;
             case CMD_WRITE_PREPARE:
@@ -170,8 +197,10 @@ public:
                     if (theLen > 0) {
                         mCounters.mWriteRequestBytes += theLen;
                     }
+                    mIoStats.Update(inClientKey, 0, theLen, false);
                 } else {
                     mCounters.mWriteRequestErrors++;
+                    mIoStats.Update(inClientKey, 0, 0, true);
                 }
             break;
             case CMD_RECORD_APPEND:
@@ -183,8 +212,10 @@ public:
                     if (theLen > 0) {
                         mCounters.mAppendRequestBytes += theLen;
                     }
+                    mIoStats.Update(inClientKey, 0, theLen, false);
                 } else {
                     mCounters.mAppendRequestErrors++;
+                    mIoStats.Update(inClientKey, 0, 0, true);
                 }
             break;
             default:
@@ -211,6 +242,9 @@ public:
     ClientThread* GetClientThread(
         int inIdx);
     bool IsAuthEnabled() const;
+    // Message authentication mode of the "clear text" communication after
+    // ssl shutdown: 0 -- off, 1 -- use if requested by the client, 2 -- require.
+    int GetClearTextMacMode() const;
     bool SetParameters(
         const char*       inParamsPrefixPtr,
         const Properties& inProps,
@@ -222,16 +256,18 @@ public:
 private:
     class Auth;
 
-    Acceptor*     mAcceptorPtr;
-    int           mIoTimeoutSec;
-    int           mIdleTimeoutSec;
-    int           mMaxClientCount;
-    Counters      mCounters;
-    Auth&         mAuth;
-    int           mCurThreadIdx;
-    int           mFirstClientThreadIndex;
-    int           mThreadCount;
-    ClientThread* mThreadsPtr;
+    Acceptor*      mAcceptorPtr;
+    int            mIoTimeoutSec;
+    int            mIdleTimeoutSec;
+    int            mMaxClientCount;
+    Counters       mCounters;
+    ClientIoStats  mIoStats;
+    ClientThrottle mThrottle;
+    Auth&          mAuth;
+    int            mCurThreadIdx;
+    int            mFirstClientThreadIndex;
+    int            mThreadCount;
+    ClientThread*  mThreadsPtr;
 
 private:
     // No copy.
@@ -38,6 +38,7 @@
 #include "common/time.h"
 #include "kfsio/Globals.h"
 #include "kfsio/ChunkAccessToken.h"
+#include "kfsio/MacFilter.h"
 #include "qcdio/QCUtils.h"
 #include "qcdio/qcdebug.h"
 
@@ -66,6 +67,7 @@ using std::string;
 using std::max;
 using std::make_pair;
 using std::list;
+using std::ostringstream;
 
 // KFS client protocol state machine implementation.
 
@@ -74,6 +76,8 @@ bool     ClientSM::sTraceRequestResponseFlag = false;
 bool     ClientSM::sEnforceMaxWaitFlag       = true;
 int      ClientSM::sMaxReqSizeDiscard        = 256 << 10;
 size_t   ClientSM::sMaxAppendRequestSize     = CHUNKSIZE;
+int64_t  ClientSM::sSlowOpLogThresholdUsec   = 5 * 1000 * 1000;
+int64_t  ClientSM::sSlowOpLogSampleInterval  = 1;
 uint64_t ClientSM::sInstanceNum              = 10000;
 
 inline time_t
@@ -177,6 +181,12 @@ ClientSM::SetParameters(const Properties& prop)
     sMaxCmdHeaderReadAhead = prop.getValue(
         "chunkServer.clientSM.maxCmdHeaderReadAhead",
         sMaxCmdHeaderReadAhead);
+    sSlowOpLogThresholdUsec = prop.getValue(
+        "chunkServer.clientSM.slowOpLogThresholdUsec",
+        sSlowOpLogThresholdUsec);
+    sSlowOpLogSampleInterval = max(int64_t(1), prop.getValue(
+        "chunkServer.clientSM.slowOpLogSampleInterval",
+        sSlowOpLogSampleInterval));
 }
 
 ClientSM::ClientSM(
@@ -208,7 +218,11 @@ ClientSM::ClientSM(
       mContentReceivedFlag(false),
       mDelegationToken(),
       mSessionKey(),
-      mHandleTerminateFlag(false)
+      mHandleTerminateFlag(false),
+      mSlowOpCount(0),
+      mIoStatsKey(),
+      mThrottleClient(*this),
+      mThrottledFlag(false)
 {
     if (! mNetConnection) {
         die("ClientSM: null connection");
@@ -241,6 +255,7 @@ ClientSM::~ClientSM()
         die("~ClientSM: ops queue(s) are not empty");
         return;
     }
+    gClientManager.CancelThrottle(mThrottleClient);
     delete mCurOp;
     mCurOp = 0;
     mDevBufMgrClients.First();
@@ -268,7 +283,11 @@ ClientSM::SendResponseSelf(KfsOp& op)
 
     const int64_t timespent = max(int64_t(0),
         (int64_t)TimeNow() * 1000000 - op.startTime);
-    const bool    tooLong   = timespent > 5 * 1000000;
+    // Log only every sample interval slow op, in order to keep the log
+    // volume under control when the disks or network are overloaded.
+    const bool    tooLong   = 0 <= sSlowOpLogThresholdUsec &&
+        sSlowOpLogThresholdUsec < timespent &&
+        mSlowOpCount++ % sSlowOpLogSampleInterval == 0;
     CLIENT_SM_LOG_STREAM(
             (op.status >= 0 ||
                 (op.op == CMD_SPC_RESERVE && op.status == -ENOSPC)) ?
@@ -282,6 +301,17 @@ ClientSM::SendResponseSelf(KfsOp& op)
         (tooLong ? " RPC too long " : " took: ") <<
             timespent << " usec." <<
     KFS_LOG_EOM;
+    if (tooLong) {
+        CLIENT_SM_LOG_STREAM_INFO <<
+            "-seq: "         << op.seq <<
+            " slow op:"
+            " buffer wait: " << op.bufferWaitTime <<
+            " disk io: "     << op.GetDiskIoTime() <<
+            " total: "       << timespent <<
+            " usec."
+            " trace: "       << op.traceId <<
+        KFS_LOG_EOM;
+    }
 
     op.Response(mWOStream.Set(mNetConnection->GetOutBuffer()));
     mWOStream.Reset();
@@ -290,7 +320,30 @@ ClientSM::SendResponseSelf(KfsOp& op)
     int       len   = 0;
     op.ResponseContent(iobuf, len);
     mNetConnection->Write(iobuf, len);
-    gClientManager.RequestDone(timespent, op);
+    gClientManager.RequestDone(timespent, op, GetIoStatsKey());
+}
+
+///
+/// Per client io counters key: the authenticated user id, or the client host
+/// if authentication is not used.
+///
+const string&
+ClientSM::GetIoStatsKey()
+{
+    if (mIoStatsKey.empty()) {
+        ostringstream os;
+        if (IsAccessEnforced()) {
+            os << "uid " << mDelegationToken.GetUid();
+        } else {
+            ServerLocation loc;
+            if (mNetConnection->GetPeerLocation(loc) != 0) {
+                return mIoStatsKey;
+            }
+            os << "host " << loc.hostname;
+        }
+        mIoStatsKey = os.str();
+    }
+    return mIoStatsKey;
 }
 
 ///
@@ -318,16 +371,18 @@ ClientSM::HandleRequest(int code, void* data)
     case EVENT_NET_READ: {
         if (! mDataReceivedFlag && ! mNetConnection->GetInBuffer().IsEmpty()) {
             mDataReceivedFlag = true;
-            if (mNetConnection->GetFilter()) {
+            if (mNetConnection->IsEncrypted()) {
                 mSessionKey.clear(); // Not needed with encrypted connection.
             }
         }
-        if (IsWaiting() || (mDevBufMgr && ! mGrantedFlag)) {
+        if (IsWaiting() || (mDevBufMgr && ! mGrantedFlag) ||
+                mThrottleClient.IsThrottled()) {
             CLIENT_SM_LOG_STREAM_DEBUG <<
                 "spurious read:"
                 " cur op: "     << KfsOp::ShowOp(mCurOp) <<
                 " buffers: "    << GetByteCount() <<
-                " waiting for " << (mDevBufMgr ? "dev. " : "") <<
+                " waiting for " << (mThrottleClient.IsThrottled() ?
+                    "throttle" : (mDevBufMgr ? "dev. " : "")) <<
                 " io buffers "  <<
             KFS_LOG_EOM;
             break;
@@ -485,6 +540,8 @@ ClientSM::HandleRequest(int code, void* data)
             mPrevNumToWrite = 0;
         }
         if (mCurOp) {
+            gClientManager.CancelThrottle(mThrottleClient);
+            mThrottledFlag = false;
             if (mDevBufMgr) {
                 GetDevBufMgrClient(mDevBufMgr)->CancelRequest();
             } else {
@@ -513,7 +570,7 @@ ClientSM::HandleRequest(int code, void* data)
                     mNetConnection->IsWriteReady()) ?
                 gClientManager.GetIoTimeoutSec() :
                 gClientManager.GetIdleTimeoutSec());
-            if (IsWaiting() || mDevBufMgr) {
+            if (IsWaiting() || mDevBufMgr || mThrottleClient.IsThrottled()) {
                 mNetConnection->SetMaxReadAhead(0);
                 ReceiveClear();
             } else if (! mCurOp || ! mNetConnection->IsReadReady()) {
@@ -707,7 +764,8 @@ ClientSM::GetWriteOp(KfsOp& op, int align, int numBytes,
             const BufferManager& mgr      = mDevBufMgr ? *mDevBufMgr : bufMgr;
             const bool           failFlag =
                 numBytes <= sMaxReqSizeDiscard + nAvail &&
-                FailIfExceedsWait(bufMgr, 0);
+                (FailIfDeviceSaturated(mgrCli) ||
+                    FailIfExceedsWait(bufMgr, 0));
             CLIENT_SM_LOG_STREAM_DEBUG <<
                 " request for: " << bufferBytes << " bytes denied" <<
                 (&mgr == &bufMgr ? "" : " by dev.") <<
@@ -793,6 +851,30 @@ ClientSM::FailIfExceedsWait(
     return true;
 }
 
+bool
+ClientSM::FailIfDeviceSaturated(
+    BufferManager::Client* mgrCli)
+{
+    if (! mCurOp || ! mDevBufMgr || ! mgrCli ||
+            ! gChunkManager.IsDeviceSaturated(mDevBufMgr)) {
+        return false;
+    }
+    // Reject the request right away instead of waiting for the device queue
+    // to drain, in order to let the client retry, possibly with different
+    // chunk servers.
+    CLIENT_SM_LOG_STREAM_DEBUG <<
+        " device saturated:"
+        " wait avg: " << mDevBufMgr->GetWaitingAvgUsecs() <<
+        " op: "       << mCurOp->Show() <<
+    KFS_LOG_EOM;
+    mCurOp->status    = -ESERVERBUSY;
+    mCurOp->statusMsg = "device saturated";
+    mgrCli->CancelRequest();
+    mDevBufMgr = 0;
+    gClientManager.DeviceSaturated();
+    return true;
+}
+
 ///
 /// We have a command in a buffer.  It is possible that we don't have
 /// everything we need to execute it (for example, for a write we may
@@ -856,6 +938,17 @@ ClientSM::HandleClientCmd(IOBuffer& iobuf, int inCmdLen)
         op->CheckAccess(*this);
     }
     iobuf.Consume(cmdLen);
+    if (mThrottledFlag) {
+        // Throttle wait is over, the op is admitted. Proceed as with the
+        // newly received op.
+        assert(mCurOp == op && ! mThrottleClient.IsThrottled());
+        mThrottledFlag = false;
+        mCurOp         = 0;
+    } else if (! mCurOp && 0 <= op->status && ! Throttle(*op)) {
+        mThrottledFlag = true;
+        mCurOp         = op;
+        return false;
+    }
 
     // Content length here might be just an initial part of the payload length,
     // the part that could be too large to fit into the normal rpc "header".
@@ -1176,7 +1269,7 @@ ClientSM::FindServer(
         writeMasterFlag,
         writeMasterFlag ?
             shutdownSslFlag :
-            mNetConnection && ! mNetConnection->GetFilter(),
+            mNetConnection && ! mNetConnection->IsEncrypted(),
         err,
         errMsg
     );
@@ -1193,6 +1286,10 @@ ClientSM::GrantedSelf(ClientSM::ByteCount byteCount, bool devBufManagerFlag)
         " dev. mgr: " << (const void*)mDevBufMgr <<
     KFS_LOG_EOM;
     assert(devBufManagerFlag == (mDevBufMgr != 0));
+    if (mCurOp) {
+        mCurOp->bufferWaitTime =
+            max(int64_t(0), microseconds() - mCurOp->startTime);
+    }
     if (IsClientThread()) {
         DispatchGranted(*this);
     } else {
@@ -1200,6 +1297,55 @@ ClientSM::GrantedSelf(ClientSM::ByteCount byteCount, bool devBufManagerFlag)
     }
 }
 
+void
+ClientSM::ThrottledSelf()
+{
+    CLIENT_SM_LOG_STREAM_DEBUG <<
+        "throttle wait done:"
+        " seq: " << (mCurOp ? mCurOp->seq : -1) <<
+        " op: "  << KfsOp::ShowOp(mCurOp) <<
+    KFS_LOG_EOM;
+    if (IsClientThread()) {
+        DispatchGranted(*this);
+    } else {
+        HandleGranted();
+    }
+}
+
+///
+/// Apply the per tenant throttle and qos class to the chunk data io
+/// requests.
+/// @retval True if the op is admitted; false if the op has to wait, in which
+/// case ThrottledSelf() is invoked once the op is admitted.
+///
+bool
+ClientSM::Throttle(KfsOp& op)
+{
+    int64_t      byteCount = 0;
+    kfsChunkId_t chunkId   = -1;
+    if (op.op == CMD_WRITE_PREPARE) {
+        byteCount = static_cast<const WritePrepareOp&>(op).numBytes;
+    } else if (op.op == CMD_RECORD_APPEND) {
+        byteCount = static_cast<const RecordAppendOp&>(op).numBytes;
+    } else if (! op.IsChunkReadOp(byteCount, chunkId)) {
+        return true;
+    }
+    ClientThrottle::QosClass qosClass =
+        ClientThrottle::kQosClassInteractive;
+    const bool admittedFlag = gClientManager.Throttle(
+        mThrottleClient, GetIoStatsKey(), byteCount, qosClass);
+    op.lowPriorityFlag = qosClass == ClientThrottle::kQosClassBatch;
+    if (! admittedFlag) {
+        CLIENT_SM_LOG_STREAM_DEBUG <<
+            "throttled:"
+            " tenant: " << GetIoStatsKey() <<
+            " bytes: "  << byteCount <<
+            " op: "     << op.Show() <<
+        KFS_LOG_EOM;
+    }
+    return admittedFlag;
+}
+
 int
 ClientSM::HandleGranted()
 {
@@ -1235,6 +1381,17 @@ ClientSM::GetPsk(
         KFS_LOG_EOM;
         mSessionKey.assign(
             reinterpret_cast<const char*>(inPskBufferPtr), theKeyLen);
+        mIoStatsKey.clear();
+        const int macMode = gClientManager.GetClearTextMacMode();
+        if (0 < macMode && mNetConnection && mNetConnection->GetFilter()) {
+            // Invoked by the ssl filter. Protect the "clear text"
+            // communication that follows ssl shutdown, if any.
+            const bool kServerFlag = true;
+            static_cast<SslFilter*>(mNetConnection->GetFilter()
+                )->SetShutdownFilter(new MacFilter(
+                    mSessionKey.data(), (int)mSessionKey.size(),
+                    kServerFlag, 1 < macMode));
+        }
         return theKeyLen;
     }
     CLIENT_SM_LOG_STREAM_ERROR <<
@@ -1266,7 +1423,7 @@ ClientSM::CheckAccess(KfsOp& op)
         op.status    = -EPERM;
         return false;
     }
-    if (! mNetConnection || ! mNetConnection->GetFilter()) {
+    if (! mNetConnection || ! mNetConnection->IsEncrypted()) {
         op.statusMsg = "connection is not secure";
         op.status    = -EPERM;
         return false;
@@ -1319,7 +1476,7 @@ ClientSM::CheckAccess(KfsClientChunkOp& op)
         return false;
     }
     if ((op.chunkAccessFlags & ChunkAccessToken::kAllowClearTextFlag) == 0 &&
-            (! mNetConnection || ! mNetConnection->GetFilter())) {
+            (! mNetConnection || ! mNetConnection->IsEncrypted())) {
         op.statusMsg = "chunk access: no clear text connection allowed";
         op.status    = -EPERM;
         return false;
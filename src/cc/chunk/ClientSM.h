@@ -31,6 +31,7 @@
 #include "RemoteSyncSM.h"
 #include "KfsOps.h"
 #include "BufferManager.h"
+#include "ClientThrottle.h"
 
 #include "qcdio/QCDLList.h"
 
@@ -272,6 +273,23 @@ private:
         StdFastAllocator<OpPair>
     > PendingOpsList;
 
+    class ThrottleClient : public ClientThrottle::Client
+    {
+    public:
+        ThrottleClient(ClientSM& client)
+            : ClientThrottle::Client(),
+              mClient(client)
+            {}
+        virtual ~ThrottleClient()
+            {}
+        virtual void Throttled()
+            { mClient.ThrottledSelf(); }
+    private:
+        ClientSM& mClient;
+    private:
+        ThrottleClient(const ThrottleClient&);
+        ThrottleClient& operator=(const ThrottleClient&);
+    };
     class DevBufferManagerClient : public BufferManager::Client
     {
     public:
@@ -335,6 +353,7 @@ private:
         StdFastAllocator<SpaceResEntry>
     > ChunkSpaceResMap;
     friend class DevBufferManagerClient;
+    friend class ThrottleClient;
     typedef KVPair<
         const BufferManager*,
         DevBufferManagerClient*
@@ -381,6 +400,10 @@ private:
     DelegationToken            mDelegationToken;
     string                     mSessionKey;
     bool                       mHandleTerminateFlag;
+    int64_t                    mSlowOpCount;
+    string                     mIoStatsKey;
+    ThrottleClient             mThrottleClient;
+    bool                       mThrottledFlag;
 
     static int                 sMaxCmdHeaderReadAhead;
     static bool                sTraceRequestResponseFlag;
@@ -388,6 +411,8 @@ private:
     static bool                sSslPskEnabledFlag;
     static int                 sMaxReqSizeDiscard;
     static size_t              sMaxAppendRequestSize;
+    static int64_t             sSlowOpLogThresholdUsec;
+    static int64_t             sSlowOpLogSampleInterval;
     static uint64_t            sInstanceNum;
 
     int HandleRequest(int code, void *data);
@@ -410,8 +435,11 @@ private:
     bool GetWriteOp(KfsOp& op, int align, int numBytes, IOBuffer& iobuf,
         IOBuffer& ioOpBuf, bool forwardFlag);
     string GetPeerName();
+    const string& GetIoStatsKey();
     int HandleRequestSelf(int code, void* data);
     int HandleGranted();
+    void ThrottledSelf();
+    bool Throttle(KfsOp& op);
     inline time_t TimeNow() const;
     inline void SendResponse(KfsOp& op);
     inline static BufferManager& GetBufferManager();
@@ -422,6 +450,8 @@ private:
     bool FailIfExceedsWait(
         BufferManager&         bufMgr,
         BufferManager::Client* mgrCli);
+    bool FailIfDeviceSaturated(
+        BufferManager::Client* mgrCli);
     void GrantedSelf(ByteCount byteCount, bool devBufManagerFlag);
     virtual unsigned long GetPsk(
         const char*    inIdentityPtr,
@@ -0,0 +1,450 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/14
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Per tenant client io throttle and qos classes implementation.
+//
+//----------------------------------------------------------------------------
+
+#include "ClientThrottle.h"
+
+#include "common/MsgLogger.h"
+#include "common/Properties.h"
+#include "common/time.h"
+#include "qcdio/QCUtils.h"
+#include "qcdio/qcdebug.h"
+#include "kfsio/NetManager.h"
+#include "kfsio/Globals.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace KFS
+{
+
+using libkfsio::globalNetManager;
+using std::min;
+using std::max;
+using std::make_pair;
+
+static const int64_t kMicroTokens       = 1000 * 1000;
+// Limit the rate and burst to keep the bucket "micro token" arithmetic
+// within 64 bits.
+static const int64_t kMaxRate           = int64_t(1) << 38;
+static const int64_t kMaxBurstUsecs     = int64_t(10) * 1000 * 1000;
+static const int64_t kCleanupIntervalUs = int64_t(60) * 1000 * 1000;
+
+    static inline void
+RefillBucket(
+    int64_t& ioTokens,
+    int64_t  inRate,
+    int64_t  inCapacity,
+    int64_t  inElapsedUsecs)
+{
+    if (inRate <= 0 || inCapacity <= ioTokens) {
+        return;
+    }
+    const int64_t theNeed = inCapacity - ioTokens;
+    ioTokens = theNeed / inRate < inElapsedUsecs ?
+        inCapacity : ioTokens + inRate * inElapsedUsecs;
+}
+
+    static inline int64_t
+BucketWaitUsecs(
+    int64_t inTokens,
+    int64_t inRate)
+{
+    return ((inRate <= 0 || 0 <= inTokens) ? int64_t(0) :
+        (inRate - 1 - inTokens) / inRate);
+}
+
+    static inline string
+Trim(
+    const string& inStr)
+{
+    const char* const kSpaces = " \t\r\n";
+    const size_t theStart = inStr.find_first_not_of(kSpaces);
+    if (theStart == string::npos) {
+        return string();
+    }
+    return inStr.substr(
+        theStart, inStr.find_last_not_of(kSpaces) - theStart + 1);
+}
+
+ClientThrottle::ClientThrottle()
+    : ITimeout(),
+      mTenants(),
+      mWaitQueue(),
+      mDefaultBytesPerSec(0),
+      mDefaultOpsPerSec(0),
+      mBurstUsecs(kMicroTokens),
+      mDefaultQosClass(kQosClassInteractive),
+      mTenantsConfig(),
+      mNextCleanupUsecs(0),
+      mRegisteredFlag(false),
+      mCounters()
+{
+    mCounters.Clear();
+}
+
+ClientThrottle::~ClientThrottle()
+{
+    ClientThrottle::Shutdown();
+}
+
+    void
+ClientThrottle::Shutdown()
+{
+    while (! mWaitQueue.empty()) {
+        Cancel(*mWaitQueue.begin()->second);
+    }
+    mTenants.clear();
+    if (mRegisteredFlag) {
+        mRegisteredFlag = false;
+        globalNetManager().UnRegisterTimeoutHandler(this);
+    }
+}
+
+    bool
+ClientThrottle::ParseQosClass(
+    const string& inName,
+    QosClass&     outClass)
+{
+    if (inName == "interactive") {
+        outClass = kQosClassInteractive;
+    } else if (inName == "batch") {
+        outClass = kQosClassBatch;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+    void
+ClientThrottle::SetParameters(
+    const char*       inParamsPrefixPtr,
+    const Properties& inProps)
+{
+    Properties::String theParamName;
+    if (inParamsPrefixPtr) {
+        theParamName.Append(inParamsPrefixPtr);
+    }
+    const size_t thePrefLen = theParamName.GetSize();
+    mDefaultBytesPerSec = min(kMaxRate, max(int64_t(0), inProps.getValue(
+        theParamName.Truncate(thePrefLen).Append(
+        "defaultBytesPerSec"), mDefaultBytesPerSec)));
+    mDefaultOpsPerSec   = min(kMaxRate, max(int64_t(0), inProps.getValue(
+        theParamName.Truncate(thePrefLen).Append(
+        "defaultOpsPerSec"), mDefaultOpsPerSec)));
+    mBurstUsecs = min(kMaxBurstUsecs, max(int64_t(1000), (int64_t)(
+        inProps.getValue(theParamName.Truncate(thePrefLen).Append(
+        "burstSec"), (double)mBurstUsecs / kMicroTokens) * kMicroTokens)));
+    const string theClassName = inProps.getValue(
+        theParamName.Truncate(thePrefLen).Append("defaultQosClass"),
+        string(mDefaultQosClass == kQosClassBatch ? "batch" : "interactive"));
+    if (! ParseQosClass(theClassName, mDefaultQosClass)) {
+        KFS_LOG_STREAM_ERROR <<
+            theParamName << ": invalid qos class: " << theClassName <<
+        KFS_LOG_EOM;
+    }
+    mTenantsConfig = inProps.getValue(
+        theParamName.Truncate(thePrefLen).Append("tenants"), mTenantsConfig);
+    ParseTenants(mTenantsConfig);
+}
+
+    void
+ClientThrottle::SetDefaults(
+    ClientThrottle::Tenant& inTenant) const
+{
+    inTenant.mBytesPerSec    = mDefaultBytesPerSec;
+    inTenant.mOpsPerSec      = mDefaultOpsPerSec;
+    inTenant.mQosClass       = mDefaultQosClass;
+    inTenant.mConfiguredFlag = false;
+}
+
+// The tenants configuration is semicolon separated list of tenant entries.
+// Each entry is comma separated tenant key, bytes per second, requests per
+// second, and qos class, for example:
+// uid 1001, 104857600, 1000, batch; host 10.6.1.2, 0, 0, interactive
+    void
+ClientThrottle::ParseTenants(
+    const string& inConfig)
+{
+    for (Tenants::iterator theIt = mTenants.begin();
+            theIt != mTenants.end();
+            ++theIt) {
+        SetDefaults(theIt->second);
+    }
+    size_t thePos = 0;
+    while (thePos < inConfig.size()) {
+        size_t theEnd = inConfig.find(';', thePos);
+        if (theEnd == string::npos) {
+            theEnd = inConfig.size();
+        }
+        const string theEntry = inConfig.substr(thePos, theEnd - thePos);
+        thePos = theEnd + 1;
+        string theFields[4];
+        size_t theCount = 0;
+        size_t theStart = 0;
+        while (theCount < 4) {
+            const size_t theNext = theEntry.find(',', theStart);
+            theFields[theCount++] = Trim(theEntry.substr(theStart,
+                theNext == string::npos ? string::npos : theNext - theStart));
+            if (theNext == string::npos) {
+                theStart = theEntry.size() + 1;
+                break;
+            }
+            theStart = theNext + 1;
+        }
+        if (theCount == 1 && theFields[0].empty()) {
+            continue;
+        }
+        char*         thePtr        = 0;
+        const int64_t theBytesRate  = theCount < 2 ? int64_t(-1) :
+            (int64_t)strtoll(theFields[1].c_str(), &thePtr, 10);
+        const bool    theBytesOk    = thePtr && ! *thePtr;
+        thePtr = 0;
+        const int64_t theOpsRate    = theCount < 3 ? int64_t(-1) :
+            (int64_t)strtoll(theFields[2].c_str(), &thePtr, 10);
+        const bool    theOpsOk      = thePtr && ! *thePtr;
+        QosClass      theClass      = mDefaultQosClass;
+        if (theFields[0].empty() || theStart <= theEntry.size() ||
+                ! theBytesOk || theBytesRate < 0 ||
+                ! theOpsOk || theOpsRate < 0 ||
+                (theCount == 4 && ! theFields[3].empty() &&
+                    ! ParseQosClass(theFields[3], theClass))) {
+            KFS_LOG_STREAM_ERROR <<
+                "invalid client throttle tenant entry: " << theEntry <<
+            KFS_LOG_EOM;
+            continue;
+        }
+        Tenant& theTenant = mTenants[theFields[0]];
+        theTenant.mBytesPerSec    = min(kMaxRate, theBytesRate);
+        theTenant.mOpsPerSec      = min(kMaxRate, theOpsRate);
+        theTenant.mQosClass       = theClass;
+        theTenant.mConfiguredFlag = true;
+    }
+    // Trim the buckets to the new capacity.
+    for (Tenants::iterator theIt = mTenants.begin();
+            theIt != mTenants.end();
+            ++theIt) {
+        Tenant& theTenant = theIt->second;
+        theTenant.mByteTokens = min(theTenant.mByteTokens,
+            theTenant.mBytesPerSec * mBurstUsecs);
+        theTenant.mOpTokens   = min(theTenant.mOpTokens,
+            max(kMicroTokens, theTenant.mOpsPerSec * mBurstUsecs));
+    }
+}
+
+    ClientThrottle::Tenant*
+ClientThrottle::GetTenant(
+    const string& inKey,
+    int64_t       inNowUsecs)
+{
+    Tenants::iterator theIt = mTenants.find(inKey);
+    if (theIt == mTenants.end()) {
+        if (inKey.empty() ||
+                (mDefaultBytesPerSec <= 0 && mDefaultOpsPerSec <= 0)) {
+            return 0;
+        }
+        theIt = mTenants.insert(make_pair(inKey, Tenant())).first;
+        Tenant& theTenant = theIt->second;
+        SetDefaults(theTenant);
+        theTenant.mByteTokens  = theTenant.mBytesPerSec * mBurstUsecs;
+        theTenant.mOpTokens    =
+            max(kMicroTokens, theTenant.mOpsPerSec * mBurstUsecs);
+        theTenant.mUpdateUsecs = inNowUsecs;
+        if (! mRegisteredFlag) {
+            mRegisteredFlag = true;
+            globalNetManager().RegisterTimeoutHandler(this);
+        }
+        if (mNextCleanupUsecs <= 0) {
+            mNextCleanupUsecs = inNowUsecs + kCleanupIntervalUs;
+        }
+    }
+    return &theIt->second;
+}
+
+    void
+ClientThrottle::Refill(
+    ClientThrottle::Tenant& inTenant,
+    int64_t                 inNowUsecs) const
+{
+    const int64_t theElapsed = inNowUsecs - inTenant.mUpdateUsecs;
+    if (theElapsed <= 0) {
+        return;
+    }
+    inTenant.mUpdateUsecs = inNowUsecs;
+    RefillBucket(inTenant.mByteTokens, inTenant.mBytesPerSec,
+        inTenant.mBytesPerSec * mBurstUsecs, theElapsed);
+    RefillBucket(inTenant.mOpTokens, inTenant.mOpsPerSec,
+        max(kMicroTokens, inTenant.mOpsPerSec * mBurstUsecs), theElapsed);
+}
+
+    int64_t
+ClientThrottle::GetWaitUsecs(
+    const ClientThrottle::Tenant& inTenant) const
+{
+    return max(
+        BucketWaitUsecs(inTenant.mByteTokens, inTenant.mBytesPerSec),
+        BucketWaitUsecs(inTenant.mOpTokens,   inTenant.mOpsPerSec)
+    );
+}
+
+    void
+ClientThrottle::Charge(
+    ClientThrottle::Tenant& inTenant,
+    int64_t                 inByteCount) const
+{
+    if (0 < inTenant.mBytesPerSec) {
+        inTenant.mByteTokens -= max(int64_t(0), inByteCount) * kMicroTokens;
+    }
+    if (0 < inTenant.mOpsPerSec) {
+        inTenant.mOpTokens -= kMicroTokens;
+    }
+}
+
+    bool
+ClientThrottle::Admit(
+    ClientThrottle::Client&    inClient,
+    const string&              inKey,
+    int64_t                    inByteCount,
+    ClientThrottle::QosClass&  outQosClass)
+{
+    QCRTASSERT(! inClient.mThrottlePtr);
+    const int64_t theNowUsecs = microseconds();
+    Tenant* const theTenantPtr = GetTenant(inKey, theNowUsecs);
+    if (! theTenantPtr) {
+        outQosClass = mDefaultQosClass;
+        return true;
+    }
+    Tenant& theTenant = *theTenantPtr;
+    outQosClass = theTenant.mQosClass;
+    if (theTenant.mBytesPerSec <= 0 && theTenant.mOpsPerSec <= 0) {
+        return true;
+    }
+    Refill(theTenant, theNowUsecs);
+    // Do not let the new request to get ahead of the ones already waiting.
+    if (theTenant.mWaitingCount <= 0 && GetWaitUsecs(theTenant) <= 0) {
+        Charge(theTenant, inByteCount);
+        return true;
+    }
+    mCounters.mThrottledCount++;
+    mCounters.mThrottledByteCount += max(int64_t(0), inByteCount);
+    theTenant.mWaitingCount++;
+    inClient.mThrottlePtr = this;
+    inClient.mTenantPtr   = &theTenant;
+    inClient.mByteCount   = inByteCount;
+    inClient.mWaitStart   = theNowUsecs;
+    Wait(inClient, theNowUsecs);
+    return false;
+}
+
+    void
+ClientThrottle::Wait(
+    ClientThrottle::Client& inClient,
+    int64_t                 inNowUsecs)
+{
+    QCASSERT(inClient.mThrottlePtr == this && inClient.mTenantPtr);
+    inClient.mWaitIt = mWaitQueue.insert(make_pair(
+        inNowUsecs + max(int64_t(1), GetWaitUsecs(*inClient.mTenantPtr)),
+        &inClient
+    ));
+}
+
+    void
+ClientThrottle::Cancel(
+    ClientThrottle::Client& inClient)
+{
+    if (! inClient.mThrottlePtr) {
+        return;
+    }
+    QCRTASSERT(inClient.mThrottlePtr == this && inClient.mTenantPtr &&
+        0 < inClient.mTenantPtr->mWaitingCount);
+    mWaitQueue.erase(inClient.mWaitIt);
+    inClient.mTenantPtr->mWaitingCount--;
+    inClient.mThrottlePtr = 0;
+    inClient.mTenantPtr   = 0;
+    inClient.mByteCount   = 0;
+}
+
+    void
+ClientThrottle::Cleanup(
+    int64_t inNowUsecs)
+{
+    mNextCleanupUsecs = inNowUsecs + kCleanupIntervalUs;
+    // Remove idle not configured tenants with full buckets.
+    Tenants::iterator theIt = mTenants.begin();
+    while (theIt != mTenants.end()) {
+        Tenant& theTenant = theIt->second;
+        Refill(theTenant, inNowUsecs);
+        if (! theTenant.mConfiguredFlag &&
+                theTenant.mWaitingCount <= 0 &&
+                (theTenant.mBytesPerSec <= 0 ||
+                    theTenant.mBytesPerSec * mBurstUsecs <=
+                    theTenant.mByteTokens) &&
+                (theTenant.mOpsPerSec <= 0 ||
+                    theTenant.mOpsPerSec * mBurstUsecs <=
+                    theTenant.mOpTokens)) {
+            mTenants.erase(theIt++);
+        } else {
+            ++theIt;
+        }
+    }
+}
+
+    /* virtual */ void
+ClientThrottle::Timeout()
+{
+    if (mWaitQueue.empty() && mTenants.empty()) {
+        return;
+    }
+    const int64_t theNowUsecs = microseconds();
+    while (! mWaitQueue.empty()) {
+        WaitQueue::iterator const theIt = mWaitQueue.begin();
+        if (theNowUsecs < theIt->first) {
+            break;
+        }
+        Client& theClient = *theIt->second;
+        mWaitQueue.erase(theIt);
+        Tenant& theTenant = *theClient.mTenantPtr;
+        Refill(theTenant, theNowUsecs);
+        if (0 < GetWaitUsecs(theTenant)) {
+            // Another waiting request of the same tenant got the tokens.
+            Wait(theClient, theNowUsecs);
+            continue;
+        }
+        Charge(theTenant, theClient.mByteCount);
+        theTenant.mWaitingCount--;
+        mCounters.mWaitUsecs += theNowUsecs - theClient.mWaitStart;
+        theClient.mThrottlePtr = 0;
+        theClient.mTenantPtr   = 0;
+        theClient.mByteCount   = 0;
+        // The client might issue the next request, and re-enter Admit().
+        theClient.Throttled();
+    }
+    if (mNextCleanupUsecs <= theNowUsecs) {
+        Cleanup(theNowUsecs);
+    }
+}
+
+} /* namespace KFS */
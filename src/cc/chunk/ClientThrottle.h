@@ -0,0 +1,214 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/14
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Per tenant client io throttle and qos classes.
+//
+//----------------------------------------------------------------------------
+
+#ifndef CHUNK_CLIENT_THROTTLE_H
+#define CHUNK_CLIENT_THROTTLE_H
+
+#include "kfsio/ITimeout.h"
+
+#include <stdint.h>
+
+#include <string>
+#include <map>
+
+namespace KFS
+{
+using std::string;
+using std::map;
+using std::multimap;
+
+class Properties;
+
+// Token bucket bandwidth and request rate limits per tenant. The tenant key
+// is the same as the client io stats key: authenticated user id, or client
+// host with no authentication.
+// The buckets are allowed to go into "debt", in order to admit requests
+// larger than the bucket size: the request is admitted if both buckets are
+// not empty, and the request cost is subtracted. Once the bucket is in debt
+// the following requests wait until the debt is paid off. The waiting
+// client is expected to stop reading from the network, thus the throttle
+// propagates to the client through the tcp flow control.
+// The tenant qos class is passed down to the disk io queue, batch class
+// requests are queued as low priority disk io.
+// The methods are not thread safe, and must be invoked with the client
+// threads global mutex held, similarly to the buffer manager.
+class ClientThrottle : private ITimeout
+{
+public:
+    enum QosClass
+    {
+        kQosClassInteractive = 0,
+        kQosClassBatch       = 1
+    };
+    struct Counters
+    {
+        typedef int64_t Counter;
+
+        Counter mThrottledCount;
+        Counter mThrottledByteCount;
+        Counter mWaitUsecs;
+        Counter mTenantCount;
+
+        void Clear()
+        {
+            mThrottledCount     = 0;
+            mThrottledByteCount = 0;
+            mWaitUsecs          = 0;
+            mTenantCount        = 0;
+        }
+    };
+    class Client;
+
+    ClientThrottle();
+    virtual ~ClientThrottle();
+    void SetParameters(
+        const char*       inParamsPrefixPtr,
+        const Properties& inProps);
+    // Returns true if the request is admitted, otherwise the client is
+    // queued, and Client::Throttled() is invoked once the tenant buckets
+    // refill, and the request is admitted.
+    bool Admit(
+        Client&       inClient,
+        const string& inKey,
+        int64_t       inByteCount,
+        QosClass&     outQosClass);
+    void Cancel(
+        Client& inClient);
+    // Cancels all waits, and unregisters the timer.
+    void Shutdown();
+    void GetCounters(
+        Counters& outCounters) const
+    {
+        outCounters = mCounters;
+        outCounters.mTenantCount = (Counters::Counter)mTenants.size();
+    }
+private:
+    struct Tenant
+    {
+        Tenant()
+            : mBytesPerSec(0),
+              mOpsPerSec(0),
+              mByteTokens(0),
+              mOpTokens(0),
+              mUpdateUsecs(0),
+              mWaitingCount(0),
+              mQosClass(kQosClassInteractive),
+              mConfiguredFlag(false)
+            {}
+        int64_t  mBytesPerSec;
+        int64_t  mOpsPerSec;
+        // Tokens are in "micro" units: token count multiplied by 10^6, in
+        // order to refill the bucket without rounding errors.
+        int64_t  mByteTokens;
+        int64_t  mOpTokens;
+        int64_t  mUpdateUsecs;
+        int      mWaitingCount;
+        QosClass mQosClass;
+        bool     mConfiguredFlag;
+    };
+    typedef map<string, Tenant>        Tenants;
+    typedef multimap<int64_t, Client*> WaitQueue;
+
+    Tenants   mTenants;
+    WaitQueue mWaitQueue;
+    int64_t   mDefaultBytesPerSec;
+    int64_t   mDefaultOpsPerSec;
+    int64_t   mBurstUsecs;
+    QosClass  mDefaultQosClass;
+    string    mTenantsConfig;
+    int64_t   mNextCleanupUsecs;
+    bool      mRegisteredFlag;
+    Counters  mCounters;
+
+    virtual void Timeout();
+    Tenant* GetTenant(
+        const string& inKey,
+        int64_t       inNowUsecs);
+    void Refill(
+        Tenant& inTenant,
+        int64_t inNowUsecs) const;
+    int64_t GetWaitUsecs(
+        const Tenant& inTenant) const;
+    void Charge(
+        Tenant& inTenant,
+        int64_t inByteCount) const;
+    void Wait(
+        Client& inClient,
+        int64_t inNowUsecs);
+    void ParseTenants(
+        const string& inConfig);
+    void SetDefaults(
+        Tenant& inTenant) const;
+    void Cleanup(
+        int64_t inNowUsecs);
+    static bool ParseQosClass(
+        const string& inName,
+        QosClass&     outClass);
+private:
+    ClientThrottle(
+        const ClientThrottle& inThrottle);
+    ClientThrottle& operator=(
+        const ClientThrottle& inThrottle);
+};
+
+class ClientThrottle::Client
+{
+public:
+    Client()
+        : mThrottlePtr(0),
+          mTenantPtr(0),
+          mByteCount(0),
+          mWaitStart(0),
+          mWaitIt()
+        {}
+    bool IsThrottled() const
+        { return (mThrottlePtr != 0); }
+    // Invoked when throttle wait ends, and the request is admitted.
+    virtual void Throttled() = 0;
+protected:
+    virtual ~Client()
+    {
+        if (mThrottlePtr) {
+            mThrottlePtr->Cancel(*this);
+        }
+    }
+private:
+    ClientThrottle*     mThrottlePtr;
+    Tenant*             mTenantPtr;
+    int64_t             mByteCount;
+    int64_t             mWaitStart;
+    WaitQueue::iterator mWaitIt;
+
+    friend class ClientThrottle;
+private:
+    Client(
+        const Client& inClient);
+    Client& operator=(
+        const Client& inClient);
+};
+
+}
+
+#endif /* CHUNK_CLIENT_THROTTLE_H */
@@ -50,16 +50,24 @@
 #include <dirent.h>
 #include <fcntl.h>
 #include <sys/file.h>
+#ifdef KFS_OS_NAME_LINUX
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
 
 #include <utility>
 #include <map>
 #include <deque>
+#include <vector>
+#include <algorithm>
 
 namespace KFS
 {
 
 using std::pair;
 using std::make_pair;
+using std::vector;
+using std::max;
 
 class DirChecker::Impl : public QCRunnable
 {
@@ -90,6 +98,7 @@ public:
           mCheckIntervalMicroSec(int64_t(60) * 1000 * 1000),
           mIoTimeoutSec(-1),
           mLockFileName(),
+          mInventoryFileName(),
           mFsIdPrefix(),
           mDirLocks(),
           mFileSystemId(-1),
@@ -102,6 +111,8 @@ public:
           mIgnoreErrorsFlag(false),
           mDeleteAllChaunksOnFsMismatchFlag(false),
           mMaxChunkFilesSampled(16),
+          mMaxThreadCount(32),
+          mExtentSizeHint(0),
           mRandom(),
           mChunkHeaderBuffer(),
           mTestIoBufferAllocPtr(new char[kTestIoBufferAlign + kTestIoSize]),
@@ -125,6 +136,7 @@ public:
         FileNames       theDontUseIfExistFileNames = mDontUseIfExistFileNames;
         FileNames       theIgnoreFileNames         = mIgnoreFileNames;
         string          theLockFileName;
+        string          theInventoryFileName;
         string          theFsIdPrefix;
         DirLocks        theDirLocks;
         mUpdateDirInfosFlag = false;
@@ -161,7 +173,12 @@ public:
             const int     theIoTimeoutSec                     = mIoTimeoutSec;
             const size_t  theMaxChunkFilesSampled             =
                 mMaxChunkFilesSampled;
-            theLockFileName = mLockFileName;
+            const int     theMaxThreadCount                   =
+                mMaxThreadCount;
+            const int64_t theExtentSizeHint                   =
+                mExtentSizeHint;
+            theLockFileName      = mLockFileName;
+            theInventoryFileName = mInventoryFileName;
             theFsIdPrefix   = mFsIdPrefix;
             DirsAvailable theAvailableDirs;
             theDirLocks.swap(mDirLocks);
@@ -185,6 +202,7 @@ public:
                         theRemoveFilesFlag,
                         theIgnoreErrorsFlag,
                         theLockFileName,
+                        theInventoryFileName,
                         theRequireChunkHeaderChecksumFlag,
                         mChunkHeaderBuffer,
                         theFsIdPrefix,
@@ -193,7 +211,9 @@ public:
                         theIoTimeoutSec,
                         mTestIoBufferPtr,
                         theMaxChunkFilesSampled,
+                        theExtentSizeHint,
                         mRandom,
+                        theMaxThreadCount,
                         theAvailableDirs
                     );
                 }
@@ -451,6 +471,109 @@ public:
         QCStMutexLocker theLocker(mMutex);
         return (int)mMaxChunkFilesSampled;
     }
+    void SetExtentSizeHint(
+        int64_t inValue)
+    {
+        QCStMutexLocker theLocker(mMutex);
+        mExtentSizeHint = inValue < 0 ? int64_t(0) : inValue;
+    }
+    int64_t GetExtentSizeHint()
+    {
+        QCStMutexLocker theLocker(mMutex);
+        return mExtentSizeHint;
+    }
+    void SetMaxThreadCount(
+        int inValue)
+    {
+        QCStMutexLocker theLocker(mMutex);
+        mMaxThreadCount = inValue;
+    }
+    int GetMaxThreadCount()
+    {
+        QCStMutexLocker theLocker(mMutex);
+        return mMaxThreadCount;
+    }
+    void SetInventoryFileName(
+        const string& inName)
+    {
+        QCStMutexLocker theLocker(mMutex);
+        mInventoryFileName = inName;
+    }
+    static int WriteInventory(
+        const string&     inDirName,
+        const string&     inFileName,
+        int64_t           inFileSystemId,
+        const ChunkInfos& inChunkInfos)
+    {
+        QCASSERT(! inDirName.empty() && *(inDirName.rbegin()) == '/');
+        if (inFileName.empty()) {
+            return -EINVAL;
+        }
+        const string theName = inDirName + inFileName;
+        // Truncate existing file in place, in order not to modify directory.
+        // Create the file, if needed, prior to getting directory attributes.
+        const int    theFd   = open(theName.c_str(),
+            O_CREAT | O_WRONLY | O_TRUNC, 0644);
+        if (theFd < 0) {
+            const int theErr = errno;
+            KFS_LOG_STREAM_ERROR <<
+                theName << ": " << QCUtils::SysError(theErr) <<
+            KFS_LOG_EOM;
+            return (0 < theErr ? -theErr : -EIO);
+        }
+        struct stat theStat = {0};
+        int         theErr  = 0;
+        if (stat(inDirName.c_str(), &theStat) != 0) {
+            theErr = errno;
+        } else {
+            string theBuf;
+            theBuf.reserve(1 << 20);
+            theBuf += kInventoryHeader;
+            theBuf += "\n";
+            AppendInventoryField(theBuf, (int64_t)theStat.st_dev);
+            AppendInventoryField(theBuf, (int64_t)theStat.st_ino);
+            AppendInventoryField(theBuf, (int64_t)theStat.st_mtime);
+            AppendInventoryField(theBuf, (int64_t)theStat.st_ctime);
+            AppendInventoryField(theBuf, inFileSystemId);
+            AppendInventoryField(theBuf, (int64_t)inChunkInfos.GetSize());
+            *(theBuf.rbegin()) = '\n';
+            ChunkInfos::ConstIterator theIt(inChunkInfos);
+            const ChunkInfo*          thePtr;
+            while ((thePtr = theIt.Next()) && theErr == 0) {
+                AppendInventoryField(theBuf, thePtr->mFileId);
+                AppendInventoryField(theBuf, thePtr->mChunkId);
+                AppendInventoryField(theBuf, thePtr->mChunkVersion);
+                AppendInventoryField(theBuf, thePtr->mChunkSize);
+                *(theBuf.rbegin()) = '\n';
+                if (theBuf.size() < (1 << 20) - 128) {
+                    continue;
+                }
+                theErr = WriteInventoryBuf(theFd, theBuf);
+            }
+            if (theErr == 0) {
+                theBuf += kInventoryTrailer;
+                theBuf += "\n";
+                theErr = WriteInventoryBuf(theFd, theBuf);
+            }
+            if (theErr == 0 && fsync(theFd)) {
+                theErr = errno;
+            }
+        }
+        if (close(theFd) && theErr == 0) {
+            theErr = errno;
+        }
+        if (theErr != 0) {
+            KFS_LOG_STREAM_ERROR <<
+                theName << ": " << QCUtils::SysError(theErr) <<
+            KFS_LOG_EOM;
+            unlink(theName.c_str());
+            return (0 < theErr ? -theErr : -EIO);
+        }
+        KFS_LOG_STREAM_INFO <<
+            theName << ": chunks: " << inChunkInfos.GetSize() <<
+        KFS_LOG_EOM;
+        return 0;
+    }
     void Wakeup()
     {
         QCStMutexLocker theLocker(mMutex);
@@ -477,6 +600,7 @@ private:
     int64_t           mCheckIntervalMicroSec;
     int               mIoTimeoutSec;
     string            mLockFileName;
+    string            mInventoryFileName;
     string            mFsIdPrefix;
     DirLocks          mDirLocks;
     int64_t           mFileSystemId;
@@ -489,11 +613,160 @@ private:
     bool              mIgnoreErrorsFlag;
     bool              mDeleteAllChaunksOnFsMismatchFlag;
     size_t            mMaxChunkFilesSampled;
+    int               mMaxThreadCount;
+    int64_t           mExtentSizeHint;
     PrngIsaac64       mRandom;
     ChunkHeaderBuffer mChunkHeaderBuffer;
     char* const       mTestIoBufferAllocPtr;
     char* const       mTestIoBufferPtr;
 
+    class DirsCheck
+    {
+    public:
+        DirsCheck(
+            const DirInfos&    inDirInfos,
+            const SubDirNames& inSubDirNames,
+            const FileNames&   inDontUseIfExistFileNames,
+            const FileNames&   inIgnoreFileNames,
+            DeviceIds&         inDeviceIds,
+            DeviceId&          ioNextDevId,
+            bool               inRemoveFilesFlag,
+            bool               inIgnoreErrorsFlag,
+            const string&      inLockName,
+            const string&      inInventoryName,
+            bool               inRequireChunkHeaderChecksumFlag,
+            const string&      inFsIdPrefix,
+            int64_t            inFileSystemId,
+            bool               inDeleteAllChaunksOnFsMismatchFlag,
+            int                inIoTimeout,
+            char*              inTestBufferPtr,
+            size_t             inMaxChunkFilesSampled,
+            int64_t            inExtentSizeHint,
+            DirsAvailable&     outDirsAvailable)
+            : mDirInfos(inDirInfos),
+              mSubDirNames(inSubDirNames),
+              mDontUseIfExistFileNames(inDontUseIfExistFileNames),
+              mIgnoreFileNames(inIgnoreFileNames),
+              mDeviceIds(inDeviceIds),
+              mNextDevId(ioNextDevId),
+              mRemoveFilesFlag(inRemoveFilesFlag),
+              mIgnoreErrorsFlag(inIgnoreErrorsFlag),
+              mLockName(inLockName),
+              mInventoryName(inInventoryName),
+              mRequireChunkHeaderChecksumFlag(inRequireChunkHeaderChecksumFlag),
+              mFsIdPrefix(inFsIdPrefix),
+              mFileSystemId(inFileSystemId),
+              mDeleteAllChaunksOnFsMismatchFlag(
+                inDeleteAllChaunksOnFsMismatchFlag),
+              mIoTimeout(inIoTimeout),
+              mTestBufferPtr(inTestBufferPtr),
+              mMaxChunkFilesSampled(inMaxChunkFilesSampled),
+              mExtentSizeHint(inExtentSizeHint),
+              mDirsAvailable(outDirsAvailable),
+              mNextIt(inDirInfos.begin()),
+              mMutex()
+            {}
+        void Run(
+            ChunkHeaderBuffer& inChunkHeaderBuffer,
+            PrngIsaac64&       inRandom,
+            QCMutex*           inMutexPtr)
+        {
+            for (; ;) {
+                QCStMutexLocker theLocker(inMutexPtr);
+                if (mNextIt == mDirInfos.end()) {
+                    break;
+                }
+                const DirInfos::value_type& theDir = *mNextIt;
+                ++mNextIt;
+                theLocker.Unlock();
+                CheckDir(
+                    theDir,
+                    mSubDirNames,
+                    mDontUseIfExistFileNames,
+                    mIgnoreFileNames,
+                    mDeviceIds,
+                    mNextDevId,
+                    mRemoveFilesFlag,
+                    mIgnoreErrorsFlag,
+                    mLockName,
+                    mInventoryName,
+                    mRequireChunkHeaderChecksumFlag,
+                    inChunkHeaderBuffer,
+                    mFsIdPrefix,
+                    mFileSystemId,
+                    mDeleteAllChaunksOnFsMismatchFlag,
+                    mIoTimeout,
+                    mTestBufferPtr,
+                    mMaxChunkFilesSampled,
+                    mExtentSizeHint,
+                    inRandom,
+                    mDirsAvailable,
+                    inMutexPtr
+                );
+            }
+        }
+        QCMutex& GetMutex()
+            { return mMutex; }
+    private:
+        const DirInfos&          mDirInfos;
+        const SubDirNames&       mSubDirNames;
+        const FileNames&         mDontUseIfExistFileNames;
+        const FileNames&         mIgnoreFileNames;
+        DeviceIds&               mDeviceIds;
+        DeviceId&                mNextDevId;
+        bool const               mRemoveFilesFlag;
+        bool const               mIgnoreErrorsFlag;
+        const string&            mLockName;
+        const string&            mInventoryName;
+        bool const               mRequireChunkHeaderChecksumFlag;
+        const string&            mFsIdPrefix;
+        int64_t const            mFileSystemId;
+        bool const               mDeleteAllChaunksOnFsMismatchFlag;
+        int const                mIoTimeout;
+        char* const              mTestBufferPtr;
+        size_t const             mMaxChunkFilesSampled;
+        int64_t const            mExtentSizeHint;
+        DirsAvailable&           mDirsAvailable;
+        DirInfos::const_iterator mNextIt;
+        QCMutex                  mMutex;
+    private:
+        DirsCheck(
+            const DirsCheck& inCheck);
+        DirsCheck& operator=(
+            const DirsCheck& inCheck);
+    };
+    class DirsCheckWorker : public QCRunnable
+    {
+    public:
+        DirsCheckWorker(
+            DirsCheck& inCheck)
+            : QCRunnable(),
+              mCheck(inCheck),
+              mChunkHeaderBuffer(),
+              mRandom(),
+              mThread()
+            {}
+        virtual void Run()
+            { mCheck.Run(mChunkHeaderBuffer, mRandom, &mCheck.GetMutex()); }
+        void Start()
+        {
+            const int kStackSize = 32 << 10;
+            mThread.Start(this, kStackSize, "DirCheckScan");
+        }
+        void Join()
+            { mThread.Join(); }
+    private:
+        DirsCheck&        mCheck;
+        ChunkHeaderBuffer mChunkHeaderBuffer;
+        PrngIsaac64       mRandom;
+        QCThread          mThread;
+    private:
+        DirsCheckWorker(
+            const DirsCheckWorker& inWorker);
+        DirsCheckWorker& operator=(
+            const DirsCheckWorker& inWorker);
+    };
+
     static void CheckDirs(
         const DirInfos&    inDirInfos,
         const SubDirNames& inSubDirNames,
@@ -504,6 +777,7 @@ private:
         bool               inRemoveFilesFlag,
         bool               inIgnoreErrorsFlag,
         const string&      inLockName,
+        const string&      inInventoryName,
         bool               inRequireChunkHeaderChecksumFlag,
         ChunkHeaderBuffer& inChunkHeaderBuffer,
         const string       inFsIdPrefix,
@@ -512,221 +786,453 @@ private:
         int                inIoTimeout,
         char*              inTestBufferPtr,
         size_t             inMaxChunkFilesSampled,
+        int64_t            inExtentSizeHint,
         PrngIsaac64&       inRandom,
+        int                inMaxThreadCount,
         DirsAvailable&     outDirsAvailable)
     {
-        for (DirInfos::const_iterator theIt = inDirInfos.begin();
-                theIt != inDirInfos.end();
-                ++theIt) {
-            struct stat theStat = {0};
-            if (stat(theIt->first.c_str(), &theStat) != 0 ||
-                   ! S_ISDIR(theStat.st_mode)) {
-                continue;
+        DirsCheck theCheck(
+            inDirInfos,
+            inSubDirNames,
+            inDontUseIfExistFileNames,
+            inIgnoreFileNames,
+            inDeviceIds,
+            ioNextDevId,
+            inRemoveFilesFlag,
+            inIgnoreErrorsFlag,
+            inLockName,
+            inInventoryName,
+            inRequireChunkHeaderChecksumFlag,
+            inFsIdPrefix,
+            inFileSystemId,
+            inDeleteAllChaunksOnFsMismatchFlag,
+            inIoTimeout,
+            inTestBufferPtr,
+            inMaxChunkFilesSampled,
+            inExtentSizeHint,
+            outDirsAvailable
+        );
+        // Scan directories concurrently, as with many chunk directories and
+        // chunks the directory scan dominates the chunk server start up time.
+        // The calling thread scans directories as well.
+        const int theThreadCount = (int)min(
+            inDirInfos.size(), (size_t)max(1, inMaxThreadCount)) - 1;
+        if (theThreadCount <= 0) {
+            theCheck.Run(inChunkHeaderBuffer, inRandom, 0);
+            return;
+        }
+        vector<DirsCheckWorker*> theWorkers;
+        theWorkers.reserve(theThreadCount);
+        for (int i = 0; i < theThreadCount; i++) {
+            theWorkers.push_back(new DirsCheckWorker(theCheck));
+            theWorkers.back()->Start();
+        }
+        theCheck.Run(inChunkHeaderBuffer, inRandom, &theCheck.GetMutex());
+        for (int i = 0; i < theThreadCount; i++) {
+            theWorkers[i]->Join();
+            delete theWorkers[i];
+        }
+    }
+    static void CheckDir(
+        const DirInfos::value_type& inDir,
+        const SubDirNames& inSubDirNames,
+        const FileNames&   inDontUseIfExistFileNames,
+        const FileNames&   inIgnoreFileNames,
+        DeviceIds&         inDeviceIds,
+        DeviceId&          ioNextDevId,
+        bool               inRemoveFilesFlag,
+        bool               inIgnoreErrorsFlag,
+        const string&      inLockName,
+        const string&      inInventoryName,
+        bool               inRequireChunkHeaderChecksumFlag,
+        ChunkHeaderBuffer& inChunkHeaderBuffer,
+        const string       inFsIdPrefix,
+        int64_t            inFileSystemId,
+        bool               inDeleteAllChaunksOnFsMismatchFlag,
+        int                inIoTimeout,
+        char*              inTestBufferPtr,
+        size_t             inMaxChunkFilesSampled,
+        int64_t            inExtentSizeHint,
+        PrngIsaac64&       inRandom,
+        DirsAvailable&     outDirsAvailable,
+        QCMutex*           inMutexPtr)
+    {
+        struct stat theStat = {0};
+        if (stat(inDir.first.c_str(), &theStat) != 0 ||
+               ! S_ISDIR(theStat.st_mode)) {
+            return;
+        }
+        FileNames::const_iterator theEit =
+            inDontUseIfExistFileNames.begin();
+        for (theEit = inDontUseIfExistFileNames.begin();
+                theEit != inDontUseIfExistFileNames.end();
+                ++theEit) {
+            string theFileName = inDir.first + *theEit;
+            if (stat(theFileName.c_str(), &theStat) == 0) {
+                break;
             }
-            FileNames::const_iterator theEit =
-                inDontUseIfExistFileNames.begin();
-            for (theEit = inDontUseIfExistFileNames.begin();
-                    theEit != inDontUseIfExistFileNames.end();
-                    ++theEit) {
-                string theFileName = theIt->first + *theEit;
-                if (stat(theFileName.c_str(), &theStat) == 0) {
-                    break;
-                }
-                const int theSysErr = errno;
-                if (theSysErr != ENOENT) {
+            const int theSysErr = errno;
+            if (theSysErr != ENOENT) {
+                KFS_LOG_STREAM_ERROR <<
+                    "stat " << theFileName << ": " <<
+                    QCUtils::SysError(errno) <<
+                KFS_LOG_EOM;
+                break;
+            }
+        }
+        if (theEit != inDontUseIfExistFileNames.end()) {
+            return;
+        }
+        LockFdPtr theLockFdPtr;
+        bool      theSupportsSpaceReservatonFlag = false;
+        int       theIoTimeSec                   = -1;
+        if (! inLockName.empty()) {
+            const string theLockName = inDir.first + inLockName;
+            const int    theLockFd   = TryLock(
+                theLockName,
+                inDir.second,
+                inTestBufferPtr,
+                theSupportsSpaceReservatonFlag,
+                theIoTimeSec);
+            if (theLockFd < 0) {
+                KFS_LOG_STREAM_ERROR <<
+                    theLockName << ": " <<
+                    QCUtils::SysError(-theLockFd) <<
+                KFS_LOG_EOM;
+                return;
+            }
+            theLockFdPtr.reset(new LockFd(theLockFd));
+            if (0 < inIoTimeout && inIoTimeout < theIoTimeSec) {
+                KFS_LOG_STREAM_ERROR <<
+                    theLockName << ": " <<
+                    "test io time: "         << theIoTimeSec <<
+                    " exceeded time limit: " << inIoTimeout  <<
+                KFS_LOG_EOM;
+                theLockFdPtr.reset();
+                return;
+            }
+        }
+        SubDirNames::const_iterator theSit;
+        for (theSit = inSubDirNames.begin();
+                theSit != inSubDirNames.end();
+                ++theSit) {
+            string theDirName = inDir.first + theSit->first;
+            if (mkdir(theDirName.c_str(), 0755)) {
+                if (errno != EEXIST) {
                     KFS_LOG_STREAM_ERROR <<
-                        "stat " << theFileName << ": " <<
+                        "mkdir " << theDirName << ": " <<
                         QCUtils::SysError(errno) <<
                     KFS_LOG_EOM;
                     break;
                 }
-            }
-            if (theEit != inDontUseIfExistFileNames.end()) {
-                continue;
-            }
-            LockFdPtr theLockFdPtr;
-            bool      theSupportsSpaceReservatonFlag = false;
-            int       theIoTimeSec                   = -1;
-            if (! inLockName.empty()) {
-                const string theLockName = theIt->first + inLockName;
-                const int    theLockFd   = TryLock(
-                    theLockName,
-                    theIt->second,
-                    inTestBufferPtr,
-                    theSupportsSpaceReservatonFlag,
-                    theIoTimeSec);
-                if (theLockFd < 0) {
+                if (stat(theDirName.c_str(), &theStat) != 0) {
                     KFS_LOG_STREAM_ERROR <<
-                        theLockName << ": " <<
-                        QCUtils::SysError(-theLockFd) <<
+                        theDirName << ": " <<
+                        QCUtils::SysError(errno) <<
                     KFS_LOG_EOM;
-                    continue;
+                    break;
                 }
-                theLockFdPtr.reset(new LockFd(theLockFd));
-                if (0 < inIoTimeout && inIoTimeout < theIoTimeSec) {
+                if (! S_ISDIR(theStat.st_mode)) {
                     KFS_LOG_STREAM_ERROR <<
-                        theLockName << ": " <<
-                        "test io time: "         << theIoTimeSec <<
-                        " exceeded time limit: " << inIoTimeout  <<
+                        theDirName << ": " <<
+                        " not a directory" <<
                     KFS_LOG_EOM;
-                    theLockFdPtr.reset();
-                    continue;
+                    break;
                 }
-            }
-            SubDirNames::const_iterator theSit;
-            for (theSit = inSubDirNames.begin();
-                    theSit != inSubDirNames.end();
-                    ++theSit) {
-                string theDirName = theIt->first + theSit->first;
-                if (mkdir(theDirName.c_str(), 0755)) {
-                    if (errno != EEXIST) {
-                        KFS_LOG_STREAM_ERROR <<
-                            "mkdir " << theDirName << ": " <<
-                            QCUtils::SysError(errno) <<
-                        KFS_LOG_EOM;
-                        break;
-                    }
-                    if (stat(theDirName.c_str(), &theStat) != 0) {
-                        KFS_LOG_STREAM_ERROR <<
-                            theDirName << ": " <<
-                            QCUtils::SysError(errno) <<
-                        KFS_LOG_EOM;
-                        break;
-                    }
-                    if (! S_ISDIR(theStat.st_mode)) {
-                        KFS_LOG_STREAM_ERROR <<
-                            theDirName << ": " <<
-                            " not a directory" <<
-                        KFS_LOG_EOM;
-                        break;
-                    }
-                    if (inRemoveFilesFlag && theSit->second &&
-                            Remove(theDirName, true) != 0) {
-                        break;
-                    }
+                if (inRemoveFilesFlag && theSit->second &&
+                        Remove(theDirName, true) != 0) {
+                    break;
                 }
             }
-            if (theSit != inSubDirNames.end()) {
-                continue;
-            }
-            int64_t    theFsId = -1;
-            ChunkInfos theChunkInfos;
-            string     theFsIdPathName;
-            if (GetChunkFiles(
-                    theIt->first,
-                    inLockName,
-                    inIgnoreFileNames,
-                    inRequireChunkHeaderChecksumFlag,
-                    inRemoveFilesFlag,
-                    inIgnoreErrorsFlag,
+        }
+        if (theSit != inSubDirNames.end()) {
+            return;
+        }
+        if (theSupportsSpaceReservatonFlag && 0 < inExtentSizeHint) {
+            SetExtentSizeHint(inDir.first, inExtentSizeHint);
+        }
+        int64_t    theFsId = -1;
+        ChunkInfos theChunkInfos;
+        string     theFsIdPathName;
+        if (! ReadInventory(
+                    inDir.first,
+                    inInventoryName,
                     inFsIdPrefix,
-                    inChunkHeaderBuffer,
-                    inIoTimeout,
-                    inMaxChunkFilesSampled,
-                    inRandom,
                     theFsId,
                     theFsIdPathName,
-                    theChunkInfos) != 0) {
-                continue;
+                    theChunkInfos) &&
+                GetChunkFiles(
+                inDir.first,
+                inLockName,
+                inIgnoreFileNames,
+                inRequireChunkHeaderChecksumFlag,
+                inRemoveFilesFlag,
+                inIgnoreErrorsFlag,
+                inFsIdPrefix,
+                inChunkHeaderBuffer,
+                inIoTimeout,
+                inMaxChunkFilesSampled,
+                inRandom,
+                theFsId,
+                theFsIdPathName,
+                theChunkInfos) != 0) {
+            return;
+        }
+        if (0 < inFileSystemId && 0 < theFsId &&
+                inFileSystemId != theFsId) {
+            const int theCleanupFlag =
+                inDeleteAllChaunksOnFsMismatchFlag || theChunkInfos.IsEmpty();
+            KFS_LOG_STREAM(theCleanupFlag ?
+                MsgLogger::kLogLevelINFO : MsgLogger::kLogLevelERROR) <<
+                inDir.first <<
+                " file system id: "             << theFsId <<
+                " does not match expected id: " << inFileSystemId <<
+                (theCleanupFlag ? " deleting all chunks" : "") <<
+            KFS_LOG_EOM;
+            if (! theCleanupFlag) {
+                return;
             }
-            if (0 < inFileSystemId && 0 < theFsId &&
-                    inFileSystemId != theFsId) {
-                const int theCleanupFlag =
-                    inDeleteAllChaunksOnFsMismatchFlag || theChunkInfos.IsEmpty();
-                KFS_LOG_STREAM(theCleanupFlag ?
-                    MsgLogger::kLogLevelINFO : MsgLogger::kLogLevelERROR) <<
-                    theIt->first <<
-                    " file system id: "             << theFsId <<
-                    " does not match expected id: " << inFileSystemId <<
-                    (theCleanupFlag ? " deleting all chunks" : "") <<
-                KFS_LOG_EOM;
-                if (! theCleanupFlag) {
-                    continue;
-                }
-                string                    theName = theIt->first;
-                const size_t              theSize = theName.size();
-                ChunkInfos::ConstIterator theCIt(theChunkInfos);
-                const ChunkInfo*          thePtr;
-                char                      theBuf[32];
-                char* const               theBufEndPtr =
-                    theBuf + sizeof(theBuf) / sizeof(theBuf[0]) - 1;
-                *theBufEndPtr = 0;
-                while ((thePtr = theCIt.Next())) {
-                    theName.resize(theSize);
-                    theName += IntToDecString(thePtr->mFileId, theBufEndPtr);
-                    theName += ".";
-                    theName += IntToDecString(thePtr->mChunkId, theBufEndPtr);
-                    theName += ".";
-                    theName += IntToDecString(
-                        thePtr->mChunkVersion, theBufEndPtr);
-                    if (unlink(theName.c_str())) {
-                        const int theErr = errno;
-                        KFS_LOG_STREAM_ERROR <<
-                            theName <<
-                            " error: " << QCUtils::SysError(theErr) <<
-                        KFS_LOG_EOM;
-                        break;
-                    }
-                }
-                if (thePtr) {
-                    // Cleanup error.
-                    continue;
-                }
-                if (! theFsIdPathName.empty() &&
-                        unlink(theFsIdPathName.c_str())) {
+            string                    theName = inDir.first;
+            const size_t              theSize = theName.size();
+            ChunkInfos::ConstIterator theCIt(theChunkInfos);
+            const ChunkInfo*          thePtr;
+            char                      theBuf[32];
+            char* const               theBufEndPtr =
+                theBuf + sizeof(theBuf) / sizeof(theBuf[0]) - 1;
+            *theBufEndPtr = 0;
+            while ((thePtr = theCIt.Next())) {
+                theName.resize(theSize);
+                theName += IntToDecString(thePtr->mFileId, theBufEndPtr);
+                theName += ".";
+                theName += IntToDecString(thePtr->mChunkId, theBufEndPtr);
+                theName += ".";
+                theName += IntToDecString(
+                    thePtr->mChunkVersion, theBufEndPtr);
+                if (unlink(theName.c_str())) {
                     const int theErr = errno;
                     KFS_LOG_STREAM_ERROR <<
-                        theFsIdPathName <<
+                        theName <<
                         " error: " << QCUtils::SysError(theErr) <<
                     KFS_LOG_EOM;
+                    break;
+                }
+            }
+            if (thePtr) {
+                // Cleanup error.
+                return;
+            }
+            if (! theFsIdPathName.empty() &&
+                    unlink(theFsIdPathName.c_str())) {
+                const int theErr = errno;
+                KFS_LOG_STREAM_ERROR <<
+                    theFsIdPathName <<
+                    " error: " << QCUtils::SysError(theErr) <<
+                KFS_LOG_EOM;
+                return;
+            }
+            theFsIdPathName.clear();
+            theChunkInfos.Clear();
+            theFsId = inFileSystemId;
+        }
+        if ((0 < inFileSystemId || 0 < theFsId) &&
+                theFsIdPathName.empty() &&
+                ! inFsIdPrefix.empty()) {
+            string theName = inDir.first;
+            theName += inFsIdPrefix;
+            char        theBuf[32];
+            char* const theBufEndPtr =
+                theBuf + sizeof(theBuf) / sizeof(theBuf[0]) - 1;
+            *theBufEndPtr = 0;
+            theName += IntToDecString(
+                0 < inFileSystemId ? inFileSystemId : theFsId,
+                theBufEndPtr
+            );
+            const int theFd = open(theName.c_str(),
+                O_CREAT|O_RDWR|O_TRUNC, 0644);
+            if (theFd < 0 || close(theFd)) {
+                const int theErr = errno;
+                KFS_LOG_STREAM_ERROR <<
+                    theName <<
+                    " error: " << QCUtils::SysError(theErr) <<
+                KFS_LOG_EOM;
+                return;
+            }
+        }
+        QCStMutexLocker theLocker(inMutexPtr);
+        pair<DeviceIds::iterator, bool> const theDevRes =
+            inDeviceIds.insert(make_pair(theStat.st_dev, ioNextDevId));
+        if (theDevRes.second) {
+            ioNextDevId++;
+        }
+        pair<DirsAvailable::iterator, bool> const theDirRes =
+            outDirsAvailable.insert(make_pair(inDir.first,
+                DirInfo(
+                    theDevRes.first->second,
+                    theLockFdPtr,
+                    inDir.second,
+                    theSupportsSpaceReservatonFlag,
+                    theFsId
+                )));
+        if (! theChunkInfos.IsEmpty() && theDirRes.second) {
+            theChunkInfos.Swap(theDirRes.first->second.mChunkInfos);
+        }
+    }
+    static const char* const kInventoryHeader;
+    static const char* const kInventoryTrailer;
+
+    static void AppendInventoryField(
+        string& inBuf,
+        int64_t inValue)
+    {
+        char        theBuf[32];
+        char* const theBufEndPtr =
+            theBuf + sizeof(theBuf) / sizeof(theBuf[0]) - 1;
+        *theBufEndPtr = 0;
+        inBuf += IntToDecString(inValue, theBufEndPtr);
+        inBuf += " ";
+    }
+    static int WriteInventoryBuf(
+        int     inFd,
+        string& inBuf)
+    {
+        const char*       thePtr    = inBuf.data();
+        const char* const theEndPtr = thePtr + inBuf.size();
+        while (thePtr < theEndPtr) {
+            const ssize_t theNWr = write(inFd, thePtr, theEndPtr - thePtr);
+            if (theNWr < 0) {
+                if (errno == EINTR) {
                     continue;
                 }
-                theFsIdPathName.clear();
-                theChunkInfos.Clear();
-                theFsId = inFileSystemId;
+                return errno;
             }
-            if ((0 < inFileSystemId || 0 < theFsId) &&
-                    theFsIdPathName.empty() &&
-                    ! inFsIdPrefix.empty()) {
-                string theName = theIt->first;
-                theName += inFsIdPrefix;
-                char        theBuf[32];
-                char* const theBufEndPtr =
-                    theBuf + sizeof(theBuf) / sizeof(theBuf[0]) - 1;
-                *theBufEndPtr = 0;
-                theName += IntToDecString(
-                    0 < inFileSystemId ? inFileSystemId : theFsId,
-                    theBufEndPtr
-                );
-                const int theFd = open(theName.c_str(),
-                    O_CREAT|O_RDWR|O_TRUNC, 0644);
-                if (theFd < 0 || close(theFd)) {
-                    const int theErr = errno;
-                    KFS_LOG_STREAM_ERROR <<
-                        theName <<
-                        " error: " << QCUtils::SysError(theErr) <<
-                    KFS_LOG_EOM;
+            thePtr += theNWr;
+        }
+        inBuf.clear();
+        return 0;
+    }
+    // Load chunk inventory written by the chunk server on clean shutdown. The
+    // inventory is valid only if the directory was not modified since the
+    // inventory was written. The inventory is removed after successful load,
+    // as the chunk server modifies the directory once it starts.
+    static bool ReadInventory(
+        const string& inDirName,
+        const string& inFileName,
+        const string& inFsIdPrefix,
+        int64_t&      outFileSystemId,
+        string&       outFsIdPathName,
+        ChunkInfos&   outChunkInfos)
+    {
+        if (inFileName.empty()) {
+            return false;
+        }
+        const string theName = inDirName + inFileName;
+        const int    theFd   = open(theName.c_str(), O_RDONLY);
+        if (theFd < 0) {
+            return false;
+        }
+        struct stat theStat = {0};
+        string      theBuf;
+        bool        theOkFlag = fstat(theFd, &theStat) == 0 &&
+            0 < theStat.st_size;
+        if (theOkFlag) {
+            theBuf.resize((size_t)theStat.st_size);
+            size_t theLen = 0;
+            while (theLen < theBuf.size()) {
+                const ssize_t theNRd = read(
+                    theFd, &theBuf[theLen], theBuf.size() - theLen);
+                if (theNRd < 0 && errno == EINTR) {
                     continue;
                 }
+                if (theNRd <= 0) {
+                    break;
+                }
+                theLen += theNRd;
             }
-            pair<DeviceIds::iterator, bool> const theDevRes =
-                inDeviceIds.insert(make_pair(theStat.st_dev, ioNextDevId));
-            if (theDevRes.second) {
-                ioNextDevId++;
+            theOkFlag = theLen == theBuf.size();
+        }
+        close(theFd);
+        theOkFlag = theOkFlag && stat(inDirName.c_str(), &theStat) == 0;
+        const size_t theHeaderLen  = strlen(kInventoryHeader);
+        const size_t theTrailerLen = strlen(kInventoryTrailer);
+        theOkFlag = theOkFlag &&
+            theHeaderLen + theTrailerLen + 2 < theBuf.size() &&
+            theBuf.compare(0, theHeaderLen, kInventoryHeader) == 0 &&
+            theBuf.compare(theBuf.size() - theTrailerLen - 1, theTrailerLen,
+                kInventoryTrailer) == 0;
+        const char*       thePtr    = theBuf.data() + theHeaderLen;
+        const char* const theEndPtr =
+            theBuf.data() + theBuf.size() - theTrailerLen - 1;
+        int64_t theDev   = -1;
+        int64_t theIno   = -1;
+        int64_t theMTime = -1;
+        int64_t theCTime = -1;
+        int64_t theFsId  = -1;
+        int64_t theCount = -1;
+        theOkFlag = theOkFlag &&
+            DecIntParser::Parse(thePtr, theEndPtr - thePtr, theDev) &&
+            DecIntParser::Parse(thePtr, theEndPtr - thePtr, theIno) &&
+            DecIntParser::Parse(thePtr, theEndPtr - thePtr, theMTime) &&
+            DecIntParser::Parse(thePtr, theEndPtr - thePtr, theCTime) &&
+            DecIntParser::Parse(thePtr, theEndPtr - thePtr, theFsId) &&
+            DecIntParser::Parse(thePtr, theEndPtr - thePtr, theCount) &&
+            theDev   == (int64_t)theStat.st_dev &&
+            theIno   == (int64_t)theStat.st_ino &&
+            theMTime == (int64_t)theStat.st_mtime &&
+            theCTime == (int64_t)theStat.st_ctime &&
+            0 <= theCount;
+        if (theOkFlag && 0 < theFsId && ! inFsIdPrefix.empty()) {
+            string theFsIdName = inDirName;
+            theFsIdName += inFsIdPrefix;
+            char        theIntBuf[32];
+            char* const theBufEndPtr =
+                theIntBuf + sizeof(theIntBuf) / sizeof(theIntBuf[0]) - 1;
+            *theBufEndPtr = 0;
+            theFsIdName += IntToDecString(theFsId, theBufEndPtr);
+            theOkFlag = stat(theFsIdName.c_str(), &theStat) == 0;
+            if (theOkFlag) {
+                outFsIdPathName = theFsIdName;
             }
-            pair<DirsAvailable::iterator, bool> const theDirRes =
-                outDirsAvailable.insert(make_pair(theIt->first,
-                    DirInfo(
-                        theDevRes.first->second,
-                        theLockFdPtr,
-                        theIt->second,
-                        theSupportsSpaceReservatonFlag,
-                        theFsId
-                    )));
-            if (! theChunkInfos.IsEmpty() && theDirRes.second) {
-                theChunkInfos.Swap(theDirRes.first->second.mChunkInfos);
+        }
+        ChunkInfo theChunkInfo;
+        for (int64_t i = 0; theOkFlag && i < theCount; i++) {
+            theOkFlag =
+                DecIntParser::Parse(
+                    thePtr, theEndPtr - thePtr, theChunkInfo.mFileId) &&
+                DecIntParser::Parse(
+                    thePtr, theEndPtr - thePtr, theChunkInfo.mChunkId) &&
+                DecIntParser::Parse(
+                    thePtr, theEndPtr - thePtr, theChunkInfo.mChunkVersion) &&
+                DecIntParser::Parse(
+                    thePtr, theEndPtr - thePtr, theChunkInfo.mChunkSize) &&
+                0 <= theChunkInfo.mChunkVersion &&
+                0 <= theChunkInfo.mChunkSize;
+            if (theOkFlag) {
+                outChunkInfos.PushBack(theChunkInfo);
             }
         }
+        while (theOkFlag && thePtr < theEndPtr) {
+            theOkFlag = (*thePtr++ & 0xFF) <= ' ';
+        }
+        if (unlink(theName.c_str())) {
+            const int theErr = errno;
+            KFS_LOG_STREAM_ERROR <<
+                theName << ": " << QCUtils::SysError(theErr) <<
+            KFS_LOG_EOM;
+            theOkFlag = false;
+        }
+        if (! theOkFlag) {
+            KFS_LOG_STREAM_INFO <<
+                theName << ": invalid or stale chunk inventory" <<
+            KFS_LOG_EOM;
+            outChunkInfos.Clear();
+            outFsIdPathName.clear();
+            return false;
+        }
+        outFileSystemId = theFsId;
+        KFS_LOG_STREAM_INFO <<
+            theName << ": loaded chunk inventory: chunks: " << theCount <<
+        KFS_LOG_EOM;
+        return true;
     }
     static int GetChunkFiles(
         const string&      inDirName,
@@ -1076,6 +1582,54 @@ private:
         closedir(theDirStream);
         return theErr;
     }
+    static void SetExtentSizeHint(
+        const string& inDirName,
+        int64_t       inSize)
+    {
+#if defined(KFS_OS_NAME_LINUX) && defined(FS_IOC_FSSETXATTR)
+        // Set the directory extent size hint, and make newly created chunk
+        // files inherit it, in order to reduce chunk file fragmentation with
+        // many concurrent writers. The existing files are not affected.
+        const int theFd = open(inDirName.c_str(), O_RDONLY);
+        if (theFd < 0) {
+            const int theErr = errno;
+            KFS_LOG_STREAM_ERROR <<
+                inDirName << ": " << QCUtils::SysError(theErr) <<
+            KFS_LOG_EOM;
+            return;
+        }
+        struct fsxattr theAttr;
+        memset(&theAttr, 0, sizeof(theAttr));
+        int theErr = 0;
+        if (ioctl(theFd, FS_IOC_FSGETXATTR, &theAttr)) {
+            theErr = errno;
+        } else if (theAttr.fsx_extsize != (uint32_t)inSize ||
+                (theAttr.fsx_xflags & FS_XFLAG_EXTSZINHERIT) == 0) {
+            theAttr.fsx_extsize = (uint32_t)inSize;
+            theAttr.fsx_xflags |= FS_XFLAG_EXTSZINHERIT;
+            if (ioctl(theFd, FS_IOC_FSSETXATTR, &theAttr)) {
+                theErr = errno;
+            } else {
+                KFS_LOG_STREAM_INFO <<
+                    inDirName << ": extent size hint: " << inSize <<
+                KFS_LOG_EOM;
+            }
+        }
+        close(theFd);
+        if (theErr != 0) {
+            KFS_LOG_STREAM_NOTICE <<
+                inDirName <<
+                ": " << QCUtils::SysError(theErr) <<
+                " will not use extent size hint" <<
+            KFS_LOG_EOM;
+        }
+#else
+        KFS_LOG_STREAM_DEBUG <<
+            inDirName << ": extent size hint is not supported"
+            " size: " << inSize <<
+        KFS_LOG_EOM;
+#endif
+    }
     static int CheckSpaceReservationSupport(
         const string& inFileName,
         int           inFd,
@@ -1273,6 +1827,9 @@ private:
         const Impl& inImpl);
 };
 
+const char* const DirChecker::Impl::kInventoryHeader  = "QFS-chunk-inventory/1";
+const char* const DirChecker::Impl::kInventoryTrailer = "end";
+
 DirChecker::LockFd::~LockFd()
 {
     if (mFd >= 0) {
@@ -1390,6 +1947,24 @@ DirChecker::SetLockFileName(
     mImpl.SetLockFileName(inName);
 }
 
+    void
+DirChecker::SetInventoryFileName(
+    const string& inName)
+{
+    mImpl.SetInventoryFileName(inName);
+}
+
+    /* static */ int
+DirChecker::WriteInventory(
+    const string&     inDirName,
+    const string&     inFileName,
+    int64_t           inFileSystemId,
+    const ChunkInfos& inChunkInfos)
+{
+    return Impl::WriteInventory(
+        inDirName, inFileName, inFileSystemId, inChunkInfos);
+}
+
     void
 DirChecker::SetRemoveFilesFlag(
     bool inFlag)
@@ -1446,6 +2021,32 @@ DirChecker::GetMaxChunkFilesSampled()
     return mImpl.GetMaxChunkFilesSampled();
 }
 
+    void
+DirChecker::SetExtentSizeHint(
+    int64_t inValue)
+{
+    mImpl.SetExtentSizeHint(inValue);
+}
+
+    int64_t
+DirChecker::GetExtentSizeHint()
+{
+    return mImpl.GetExtentSizeHint();
+}
+
+    void
+DirChecker::SetMaxThreadCount(
+    int inValue)
+{
+    mImpl.SetMaxThreadCount(inValue);
+}
+
+    int
+DirChecker::GetMaxThreadCount()
+{
+    return mImpl.GetMaxThreadCount();
+}
+
     void
 DirChecker::Wakeup()
 {
@@ -146,6 +146,8 @@ public:
         const FileNames& inFileNames);
     void SetLockFileName(
         const string& inName);
+    void SetInventoryFileName(
+        const string& inName);
     void SetRemoveFilesFlag(
         bool inFlag);
     void SetRequireChunkHeaderChecksumFlag(
@@ -162,7 +164,18 @@ public:
     void SetMaxChunkFilesSampled(
         int inValue);
     int GetMaxChunkFilesSampled();
+    void SetExtentSizeHint(
+        int64_t inValue);
+    int64_t GetExtentSizeHint();
+    void SetMaxThreadCount(
+        int inValue);
+    int GetMaxThreadCount();
     void Wakeup();
+    static int WriteInventory(
+        const string&     inDirName,
+        const string&     inFileName,
+        int64_t           inFileSystemId,
+        const ChunkInfos& inChunkInfos);
 private:
     class Impl;
     Impl& mImpl;
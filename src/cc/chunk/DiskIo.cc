@@ -33,6 +33,7 @@
 #include "common/Properties.h"
 #include "common/MsgLogger.h"
 #include "common/kfstypes.h"
+#include "common/kfsatomic.h"
 
 #include "qcdio/QCDLList.h"
 #include "qcdio/QCMutex.h"
@@ -323,6 +324,7 @@ public:
     void SetParameters(
         const Properties& inProperties)
     {
+        SetIoPriority(inProperties);
         if (! mIoMethodsPtr) {
             return;
         }
@@ -333,6 +335,12 @@ public:
             );
         }
     }
+    void SetIoPriority(
+        const Properties& inProperties)
+    {
+        QCDiskQueue::SetLowPriorityWeight(inProperties.getValue(
+            "chunkServer.diskQueue.lowPriorityWeight", 0));
+    }
     void Delete(
         DiskQueue** inListPtr)
     {
@@ -577,6 +585,8 @@ public:
             "chunkServer.ioBufferPool.bufferSize", 4 << 10)),
           mBufferPoolLockMemoryFlag(inConfig.getValue(
             "chunkServer.ioBufferPool.lockMemory", false)),
+          mBufferPoolHugePageSize(inConfig.getValue(
+            "chunkServer.ioBufferPool.hugePageSize", int64_t(0))),
           mDiskOverloadedPendingRequestCount(inConfig.getValue(
             "chunkServer.diskIo.overloadedPendingRequestCount",
                 mDiskQueueMaxQueueDepth * 3 / 4)),
@@ -619,7 +629,8 @@ public:
           mWriteReqCount(0),
           mMutex(),
           mPutCond(),
-          mBufferAllocator(),
+          mBufferAllocator(inConfig.getValue(
+            "chunkServer.ioBufferPool.threadCacheSize", 0)),
           mBufferManager(inConfig.getValue(
             "chunkServer.bufferManager.enabled", true)),
           mNullCallback(),
@@ -656,7 +667,8 @@ public:
             mBufferPoolPartitionCount,
             mBufferPoolPartitionBufferCount,
             mBufferPoolBufferSize,
-            mBufferPoolLockMemoryFlag
+            mBufferPoolLockMemoryFlag,
+            mBufferPoolHugePageSize
         );
         if (theSysError) {
             if (inErrMessagePtr) {
@@ -979,6 +991,7 @@ public:
             }
             return false;
         }
+        theQueuePtr->SetIoPriority(mParameters);
         return true;
     }
     DiskQueue::Time GetMaxEnqueueWaitTimeNanoSec() const
@@ -1107,7 +1120,27 @@ public:
         { return mDiskQueueThreadCount; }
     void GetCounters(
         Counters& outCounters)
-        { outCounters = mCounters; }
+    {
+        outCounters = mCounters;
+        outCounters.mBufferCacheRefillCount =
+            mBufferAllocator.GetCacheRefillCount();
+        outCounters.mBufferCacheFlushCount  =
+            mBufferAllocator.GetCacheFlushCount();
+        QCMutex::Counters theMutexCounters;
+        QCMutex::Counters theQueueMutexCounters;
+        DiskQueueList::Iterator theIt(mDiskQueuesPtr);
+        DiskQueue* thePtr;
+        while ((thePtr = theIt.Next())) {
+            thePtr->GetMutexCounters(theQueueMutexCounters);
+            theMutexCounters.Add(theQueueMutexCounters);
+        }
+        outCounters.mQueueMutexContendedCount    =
+            theMutexCounters.mContendedCount;
+        outCounters.mQueueMutexSpinAcquiredCount =
+            theMutexCounters.mSpinAcquiredCount;
+        outCounters.mQueueMutexWaitNanoSec       =
+            theMutexCounters.mWaitNanoSec;
+    }
     void SetInFlight(
         DiskIo* inIoPtr)
     {
@@ -1197,17 +1230,32 @@ private:
         }
         IoBuffers mIoBuffers;
     };
+    // Io buffer allocator with optional per thread buffer caches. Network and
+    // client threads allocate and free io buffers one at a time, and the
+    // buffers read from disk by the io threads are freed by the network
+    // threads. With the cache enabled each thread moves the buffers between
+    // its cache and the pool in batches of half of the cache size, thus
+    // amortizing the pool mutex acquisition. The buffers in the thread
+    // caches are not included into the pool free buffer count.
     class BufferAllocator : public IOBufferAllocator
     {
     public:
-        BufferAllocator()
-            : mBufferPool()
+        enum { kMaxThreadCacheSize = 256 };
+        BufferAllocator(
+            int inThreadCacheSize)
+            : mBufferPool(),
+              mThreadCacheSize(
+                min((int)kMaxThreadCacheSize, max(0, inThreadCacheSize))),
+              mGeneration(SyncAddAndFetch(sGeneration, uint64_t(1))),
+              mCacheRefillCount(0),
+              mCacheFlushCount(0)
             {}
         virtual size_t GetBufferSize() const
             { return mBufferPool.GetBufferSize(); }
         virtual char* Allocate()
         {
-            char* const theBufPtr = mBufferPool.Get();
+            char* const theBufPtr = 1 < mThreadCacheSize ?
+                CacheGet() : mBufferPool.Get();
             if (! theBufPtr) {
                 QCUtils::FatalError("out of io buffers", 0);
             }
@@ -1215,11 +1263,79 @@ private:
         }
         virtual void Deallocate(
             char* inBufferPtr)
-            { mBufferPool.Put(inBufferPtr); }
+        {
+            if (1 < mThreadCacheSize) {
+                CachePut(inBufferPtr);
+            } else {
+                mBufferPool.Put(inBufferPtr);
+            }
+        }
         QCIoBufferPool& GetBufferPool()
             { return mBufferPool; }
+        int64_t GetCacheRefillCount() const
+            { return mCacheRefillCount; }
+        int64_t GetCacheFlushCount() const
+            { return mCacheFlushCount; }
     private:
-        QCIoBufferPool mBufferPool;
+        class CacheOutputIterator : public QCIoBufferPool::OutputIterator
+        {
+        public:
+            virtual void Put(
+                char* inBufPtr)
+                { sCache[sCacheCount++] = inBufPtr; }
+        };
+        class CacheInputIterator : public QCIoBufferPool::InputIterator
+        {
+        public:
+            virtual char* Get()
+                { return sCache[--sCacheCount]; }
+        };
+        QCIoBufferPool   mBufferPool;
+        const int        mThreadCacheSize;
+        const uint64_t   mGeneration;
+        volatile int64_t mCacheRefillCount;
+        volatile int64_t mCacheFlushCount;
+
+        static volatile uint64_t sGeneration;
+        static __thread  uint64_t sCacheGeneration;
+        static __thread  int      sCacheCount;
+        static __thread  char*    sCache[kMaxThreadCacheSize];
+
+        void ValidateCache()
+        {
+            if (sCacheGeneration != mGeneration) {
+                // Discard buffers that belong to a different allocator
+                // instance.
+                sCacheGeneration = mGeneration;
+                sCacheCount      = 0;
+            }
+        }
+        char* CacheGet()
+        {
+            ValidateCache();
+            if (sCacheCount <= 0) {
+                CacheOutputIterator theIt;
+                if (! mBufferPool.Get(theIt, mThreadCacheSize / 2)) {
+                    return mBufferPool.Get();
+                }
+                SyncAddAndFetch(mCacheRefillCount, int64_t(1));
+            }
+            return sCache[--sCacheCount];
+        }
+        void CachePut(
+            char* inBufferPtr)
+        {
+            if (! inBufferPtr) {
+                return;
+            }
+            ValidateCache();
+            if (mThreadCacheSize <= sCacheCount) {
+                CacheInputIterator theIt;
+                mBufferPool.Put(theIt, mThreadCacheSize / 2);
+                SyncAddAndFetch(mCacheFlushCount, int64_t(1));
+            }
+            sCache[sCacheCount++] = inBufferPtr;
+        }
 
     private:
         BufferAllocator(
@@ -1245,6 +1361,7 @@ private:
     const int                      mBufferPoolPartitionBufferCount;
     const int                      mBufferPoolBufferSize;
     const int                      mBufferPoolLockMemoryFlag;
+    const int64_t                  mBufferPoolHugePageSize;
     const int                      mDiskOverloadedPendingRequestCount;
     const int                      mDiskClearOverloadedPendingRequestCount;
     const int                      mDiskOverloadedMinFreeBufferCount;
@@ -1378,6 +1495,12 @@ private:
     }
 };
 
+volatile uint64_t DiskIoQueues::BufferAllocator::sGeneration      = 0;
+__thread uint64_t DiskIoQueues::BufferAllocator::sCacheGeneration = 0;
+__thread int      DiskIoQueues::BufferAllocator::sCacheCount      = 0;
+__thread char*    DiskIoQueues::BufferAllocator::sCache[
+    DiskIoQueues::BufferAllocator::kMaxThreadCacheSize];
+
 static DiskIoQueues* sDiskIoQueuesPtr;
 
     /* static */ bool
@@ -2002,6 +2125,7 @@ DiskIo::DiskIo(
       mEnqueueTime(),
       mWriteSyncFlag(false),
       mCachedFlag(false),
+      mLowPriorityFlag(false),
       mCompletionRequestId(QCDiskQueue::kRequestIdNone),
       mCompletionCode(QCDiskQueue::kErrorNone),
       mChainedPtr(0)
@@ -2153,7 +2277,8 @@ DiskIo::Read(
         0, // inBufferIteratorPtr // allocate buffers just beofre read
         theBufferCnt,
         this,
-        sDiskIoQueuesPtr->GetMaxEnqueueWaitTimeNanoSec()
+        sDiskIoQueuesPtr->GetMaxEnqueueWaitTimeNanoSec(),
+        mLowPriorityFlag
     );
     if (theStatus.IsGood()) {
         sDiskIoQueuesPtr->ReadPending(inNumBytes);
@@ -2519,7 +2644,8 @@ DiskIo::SubmitWrite(
         this,
         sDiskIoQueuesPtr->GetMaxEnqueueWaitTimeNanoSec(),
         inSyncFlag,
-        inEofHint
+        inEofHint,
+        mLowPriorityFlag
     );
     if (theStatus.IsGood()) {
         sDiskIoQueuesPtr->WritePending(inNumBytes);
@@ -81,6 +81,11 @@ public:
         Counter mTimedOutErrorReadByteCount;
         Counter mTimedOutErrorWriteByteCount;
         Counter mOpenFilesCount;
+        Counter mBufferCacheRefillCount;
+        Counter mBufferCacheFlushCount;
+        Counter mQueueMutexContendedCount;
+        Counter mQueueMutexSpinAcquiredCount;
+        Counter mQueueMutexWaitNanoSec;
         void Clear()
         {
             mReadCount                     = 0;
@@ -106,6 +111,11 @@ public:
             mTimedOutErrorReadByteCount    = 0;
             mTimedOutErrorWriteByteCount   = 0;
             mOpenFilesCount                = 0;
+            mBufferCacheRefillCount        = 0;
+            mBufferCacheFlushCount         = 0;
+            mQueueMutexContendedCount      = 0;
+            mQueueMutexSpinAcquiredCount   = 0;
+            mQueueMutexWaitNanoSec         = 0;
         }
     };
     typedef int64_t Offset;
@@ -286,6 +296,10 @@ public:
 
     FilePtr GetFilePtr() const
         { return mFilePtr; }
+    /// Queue subsequent reads and writes as low priority, background io,
+    /// such as replication, recovery, and scrub.
+    void SetLowPriority(bool inFlag)
+        { mLowPriorityFlag = inFlag; }
 private:
     /// Owning KfsCallbackObj.
     KfsCallbackObj* const  mCallbackObjPtr;
@@ -299,6 +313,7 @@ private:
     time_t                 mEnqueueTime;
     bool                   mWriteSyncFlag;
     bool                   mCachedFlag;
+    bool                   mLowPriorityFlag;
     QCDiskQueue::RequestId mCompletionRequestId;
     QCDiskQueue::Error     mCompletionCode;
     DiskIo*                mChainedPtr;
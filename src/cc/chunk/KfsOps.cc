@@ -51,6 +51,7 @@
 #include "kfsio/checksum.h"
 #include "kfsio/CryptoKeys.h"
 #include "kfsio/ChunkAccessToken.h"
+#include "kfsio/IOBufferWriter.h"
 
 #include "qcdio/qcstutils.h"
 #include "qcdio/QCUtils.h"
@@ -94,8 +95,14 @@ struct OpCounters : private map<KfsOp_t, Counter *>
         if (! c) {
             return;
         }
+        const int64_t timeSpent = microseconds() - startTime;
         c->Update(1);
-        c->UpdateTime(microseconds() - startTime);
+        c->UpdateTime(timeSpent);
+        LatencyHistograms::const_iterator const it =
+            sInstance->mLatencyHistograms.find(opName);
+        if (it != sInstance->mLatencyHistograms.end()) {
+            it->second->Update(timeSpent);
+        }
     }
     static void WriteMaster()
     {
@@ -113,14 +120,67 @@ struct OpCounters : private map<KfsOp_t, Counter *>
         sInstance->mWriteDuration.UpdateTime(time);
     }
 private:
-    Counter mWriteMaster;
-    Counter mWriteDuration;
+    // Op latency histogram with exponential buckets. Each bucket is a
+    // counter with the bucket upper bound in the name, in order to make the
+    // bucket counts available with the rest of the op counters in the chunk
+    // server stats.
+    class LatencyHistogram
+    {
+    public:
+        enum { kBucketCount = 8 };
+        LatencyHistogram(const char* name)
+        {
+            int64_t maxMs = 1;
+            for (int i = 0; i < kBucketCount; i++) {
+                string bucketName = name;
+                if (i < kBucketCount - 1) {
+                    bucketName += " Latency Under ";
+                    AppendDecIntToString(bucketName, maxMs);
+                } else {
+                    bucketName += " Latency Over ";
+                    AppendDecIntToString(bucketName, maxMs >> 2);
+                }
+                bucketName += "ms";
+                mBuckets[i].SetName(bucketName.c_str());
+                mMaxTime[i] = maxMs * 1000;
+                maxMs <<= 2;
+                globals().counterManager.AddCounter(mBuckets + i);
+            }
+        }
+        ~LatencyHistogram()
+        {
+            for (int i = 0; i < kBucketCount; i++) {
+                globals().counterManager.RemoveCounter(mBuckets + i);
+            }
+        }
+        void Update(int64_t timeSpent)
+        {
+            int i = 0;
+            while (i < kBucketCount - 1 && mMaxTime[i] < timeSpent) {
+                i++;
+            }
+            mBuckets[i].Update(1);
+            mBuckets[i].UpdateTime(timeSpent);
+        }
+    private:
+        Counter mBuckets[kBucketCount];
+        int64_t mMaxTime[kBucketCount];
+    private:
+        LatencyHistogram(const LatencyHistogram&);
+        LatencyHistogram& operator=(const LatencyHistogram&);
+    };
+    typedef map<KfsOp_t, LatencyHistogram*> LatencyHistograms;
+
+    Counter           mWriteMaster;
+    Counter           mWriteDuration;
+    LatencyHistograms mLatencyHistograms;
     static OpCounters* sInstance;
 
     OpCounters()
         : map<KfsOp_t, Counter *>(),
           mWriteMaster("Write Master"),
-          mWriteDuration("Write Duration")
+          mWriteDuration("Write Duration"),
+          mLatencyHistograms()
       {}
     ~OpCounters()
     {
@@ -130,6 +190,11 @@ private:
             }
             delete i->second;
         }
+        for (LatencyHistograms::iterator i = mLatencyHistograms.begin();
+                i != mLatencyHistograms.end();
+                ++i) {
+            delete i->second;
+        }
         if (sInstance == this) {
             globals().counterManager.RemoveCounter(&mWriteMaster);
             globals().counterManager.RemoveCounter(&mWriteDuration);
@@ -145,6 +210,14 @@ private:
         }
         globals().counterManager.AddCounter(c);
     }
+    void AddLatencyHistogram(const char *name, KfsOp_t opName)
+    {
+        if (mLatencyHistograms.find(opName) != mLatencyHistograms.end()) {
+            return;
+        }
+        mLatencyHistograms.insert(
+            make_pair(opName, new LatencyHistogram(name)));
+    }
     static Counter* GetCounter(KfsOp_t opName)
     {
         if (! sInstance) {
@@ -177,6 +250,10 @@ private:
         instance.AddCounter("Heartbeat", CMD_HEARTBEAT);
         instance.AddCounter("Change Chunk Vers", CMD_CHANGE_CHUNK_VERS);
         instance.AddCounter("Make Chunk Stable", CMD_MAKE_CHUNK_STABLE);
+        instance.AddLatencyHistogram("Read", CMD_READ);
+        instance.AddLatencyHistogram("Write Prepare", CMD_WRITE_PREPARE);
+        instance.AddLatencyHistogram("Record append", CMD_RECORD_APPEND);
+        instance.AddLatencyHistogram("Replicate", CMD_REPLICATE_CHUNK);
         globals().counterManager.AddCounter(&instance.mWriteMaster);
         globals().counterManager.AddCounter(&instance.mWriteDuration);
         return &instance;
@@ -314,6 +391,14 @@ WriteSyncReplicationAccess(
     }
 }
 
+inline static void
+PutTraceId(ostream& os, int64_t traceId)
+{
+    if (traceId != 0) {
+        os << "Trace-id: " << traceId << "\r\n";
+    }
+}
+
 template<typename T>
 class FwdAccessParser
 {
@@ -424,10 +509,13 @@ KfsOp::KfsOp(KfsOp_t o, kfsSeq_t s, KfsCallbackObj* c)
       noReply(false),
       noRetry(false),
       clientSMFlag(false),
+      lowPriorityFlag(false),
       maxWaitMillisec(-1),
+      traceId(0),
       statusMsg(),
       clnt(c),
       startTime(microseconds()),
+      bufferWaitTime(0),
       bufferBytes(),
       next(0),
       nextOp()
@@ -500,7 +588,9 @@ KfsClientChunkOp::Validate()
     }
     if ((hasChunkAccessTokenFlag = ! chunkAccessVal.empty())) {
         ChunkAccessToken token;
-        if ((chunkAccessTokenValidFlag = token.Process(
+        if ((chunkAccessTokenValidFlag =
+                gChunkManager.GetChunkAccessTokenCache().Process(
+                token,
                 chunkId,
                 chunkAccessVal.mPtr,
                 chunkAccessVal.mLen,
@@ -528,6 +618,21 @@ ChunkAccessRequestOp::CheckAccess(ClientSM& sm)
     return sm.CheckAccess(*this);
 }
 
+void
+ChunkAccessRequestOp::WriteBuffersWaitResponse(ostream& os)
+{
+    if (status < 0) {
+        return;
+    }
+    BufferManager* const devBufMgr =
+        FindDeviceBufferManager(chunkId, chunkVersion);
+    const int64_t waitUsecs = DiskIo::GetBufferManager().GetWaitingAvgUsecs() +
+        (devBufMgr ? devBufMgr->GetWaitingAvgUsecs() : int64_t(0));
+    if (0 < waitUsecs) {
+        os << "Buffers-wait-usec: " << waitUsecs << "\r\n";
+    }
+}
+
 void
 ChunkAccessRequestOp::WriteChunkAccessResponse(
     ostream& os, int64_t subjectId, int accessTokenFlags)
@@ -873,6 +978,7 @@ ReadOp::HandleDone(int code, void *data)
                 CHECKSUM_BLOCKSIZE) == checksum.size());
         }
     }
+    gChunkManager.ReadCoalescingDone(this);
 
     if (wop) {
         // if the read was triggered by a write, then resume execution of write
@@ -1590,16 +1696,15 @@ AppendStorageTiersInfo(ostream& os, const ChunkManager::StorageTiersInfo& tiersI
     os << "\r\n";
 }
 
-// This is the heartbeat sent by the meta server
-void
-HeartbeatOp::Execute()
+// Appends chunk server counters: the "Key: value\r\n" heartbeat response
+// lines to os[0], and, if os[1] is not null, the short form to os[1].
+/* static */ void
+HeartbeatOp::AppendCounters(ostream** os)
 {
     double loadavg[3] = {-1, -1, -1};
 #ifndef KFS_OS_NAME_CYGWIN
     getloadavg(loadavg, 3);
 #endif
-    gChunkManager.MetaHeartbeat(*this);
-
     const int64_t writeCount       = gChunkManager.GetNumWritableChunks();
     const int64_t writeAppendCount =
         gAtomicRecordAppendManager.GetOpenAppendersCount();
@@ -1618,33 +1723,20 @@ HeartbeatOp::Execute()
     int     evacuateDoneChunkCount = 0;
     int64_t evacuateDoneByteCount  = 0;
     int64_t devWaitAvgUsec         = 0;
+    int     saturatedDirs          = 0;
     ChunkManager::StorageTiersInfo tiersInfo;
 
-    static IOBuffer::WOStream sWOs;
-    static ostringstream      sOs;
-    ostream* os[2];
-    os[0] = &sWOs.Set(response);
-    if (MsgLogger::GetLogger() &&
-            MsgLogger::GetLogger()->IsLogLevelEnabled(
-                MsgLogger::kLogLevelDEBUG)) {
-        cmdShow.clear();
-        cmdShow.reserve(2 << 10);
-        sOs.str(cmdShow);
-        cmdShow = string(); // De-reference.
-        os[1] = &sOs;
-    } else {
-        os[1] = 0;
-    }
     HBAppend(os, 0, "space", "");
     HBAppend(os, "Total-space",    "total",  gChunkManager.GetTotalSpace(
         totalFsSpace, chunkDirs, evacuateInFlightCount, writableDirs,
         evacuateChunks, evacuateByteCount,
         &evacuateDoneChunkCount, &evacuateDoneByteCount, 0, &tiersInfo,
-        &devWaitAvgUsec));
+        &devWaitAvgUsec, &saturatedDirs));
     HBAppend(os, "Total-fs-space", "tfs",      totalFsSpace);
     HBAppend(os, "Used-space",     "used",     gChunkManager.GetUsedSpace());
     HBAppend(os, "Num-drives",     "drives",   chunkDirs);
     HBAppend(os, "Num-wr-drives",  "wr-drv",   writableDirs);
+    HBAppend(os, "Num-sat-drives", "sat-drv",  saturatedDirs);
     HBAppend(os, "Num-chunks",     "chunks",   gChunkManager.GetNumChunks());
     HBAppend(os, "Num-writable-chunks", "wrchunks",
         writeCount + writeAppendCount + replicationCount
@@ -1683,6 +1775,10 @@ HeartbeatOp::Execute()
     HBAppend(os, "Chunk-open-errors",   "open", cm.mOpenErrorCount);
     HBAppend(os, "Dir-chunk-lost",      "dce",  cm.mDirLostChunkCount);
     HBAppend(os, "Chunk-dir-lost",      "cdl",  cm.mChunkDirLostCount);
+    HBAppend(os, 0, "fds", "");
+    HBAppend(os, "Chunk-opens",           "opn", cm.mChunkOpenCount);
+    HBAppend(os, "Chunk-creates",         "cre", cm.mChunkCreateCount);
+    HBAppend(os, "Chunk-inactive-closes", "icl", cm.mChunkInactiveCloseCount);
     HBAppend(os, 0, "rdchksum", "");
     HBAppend(os, "Read-chksum",               "rcs", cm.mReadChecksumCount);
     HBAppend(os, "Read-chksum-bytes",         "rcb", cm.mReadChecksumByteCount);
@@ -1694,6 +1790,29 @@ HeartbeatOp::Execute()
         cm.mReadSkipDiskVerifyByteCount);
     HBAppend(os, "Read-chksum-skip-cs-bytes", "rsc",
         cm.mReadSkipDiskVerifyChecksumByteCount);
+    HBAppend(os, 0, "scrub", "");
+    HBAppend(os, "Scrub-chunks",      "scc", cm.mScrubChunkCount);
+    HBAppend(os, "Scrub-bytes",       "scb", cm.mScrubByteCount);
+    HBAppend(os, "Scrub-errors",      "sce", cm.mScrubErrorCount);
+    ChunkReadCache::Counters rc;
+    int64_t                  rcSize    = 0;
+    int64_t                  rcMaxSize = 0;
+    gChunkManager.GetReadCacheCounters(rc, rcSize, rcMaxSize);
+    HBAppend(os, 0, "rcache", "");
+    HBAppend(os, "Read-cache-size",       "rcs",  rcSize);
+    HBAppend(os, "Read-cache-max-size",   "rcms", rcMaxSize);
+    HBAppend(os, "Read-cache-hits",       "rch",  rc.mHitCount);
+    HBAppend(os, "Read-cache-hit-bytes",  "rchb", rc.mHitByteCount);
+    HBAppend(os, "Read-cache-misses",     "rcm",  rc.mMissCount);
+    HBAppend(os, "Read-cache-inserts",    "rci",  rc.mInsertCount);
+    HBAppend(os, "Read-cache-evictions",  "rce",  rc.mEvictCount);
+    HBAppend(os, "Read-cache-rejects",    "rcr",  rc.mAdmitRejectCount);
+    HBAppend(os, "Read-cache-invalidate", "rcin", rc.mInvalidateCount);
+    HBAppend(os, "Read-coalesced",        "rco",  cm.mReadCoalescedCount);
+    HBAppend(os, "Read-coalesced-bytes",  "rcob", cm.mReadCoalescedByteCount);
+    HBAppend(os, 0, "wrtail", "");
+    HBAppend(os, "Write-tail-hits",   "wth", cm.mWriteTailHitCount);
+    HBAppend(os, "Write-tail-misses", "wtm", cm.mWriteTailMissCount);
 
     MetaServerSM::Counters mc;
     gMetaServerSM.GetCounters(mc);
@@ -1719,6 +1838,7 @@ HeartbeatOp::Execute()
         cli.mRequestLengthExceededCount);
     HBAppend(os, "Client-discarded-bytes", "bdcd", cli.mDiscardedBytesCount);
     HBAppend(os, "Client-wait-exceed",     "wex",  cli.mWaitTimeExceededCount);
+    HBAppend(os, "Client-dev-saturated",   "dsat", cli.mDeviceSaturatedCount);
     HBAppend(os, 0, "read", "");
     HBAppend(os, "Client-read-count",     "cnt",   cli.mReadRequestCount);
     HBAppend(os, "Client-read-bytes",     "bytes", cli.mReadRequestBytes);
@@ -1751,6 +1871,22 @@ HeartbeatOp::Execute()
         globalNetManager().GetTimerOverrunCount());
     HBAppend(os, "Timer-overrun-sec",   "sec",
         globalNetManager().GetTimerOverrunSec());
+    HBAppend(os, "Timer-scan-count",    "scan",
+        globalNetManager().GetTimerScanCount());
+    HBAppend(os, "Timer-move-count",    "mov",
+        globalNetManager().GetTimerMoveCount());
+    HBAppend(os, "Timer-lazy-count",    "lazy",
+        globalNetManager().GetTimerLazyUpdateCount());
+
+    ChunkAccessToken::Cache::Counters tc;
+    gChunkManager.GetChunkAccessTokenCache().GetCounters(tc);
+    HBAppend(os, 0, "ctoken", "");
+    HBAppend(os, "Chunk-access-cache-hits",      "hit",  tc.mHitCount);
+    HBAppend(os, "Chunk-access-cache-misses",    "miss", tc.mMissCount);
+    HBAppend(os, "Chunk-access-cache-evictions", "evct", tc.mEvictionCount);
+    HBAppend(os, "Chunk-access-miss-micro-sec",  "tm",   tc.mMissMicroSec);
+    HBAppend(os, "Chunk-access-saved-micro-sec", "svd",
+        tc.GetSavedMicroSec());
 
     HBAppend(os, 0, "wappend", "");
     HBAppend(os, "Write-appenders", "cur",
@@ -1811,6 +1947,10 @@ HeartbeatOp::Execute()
     HBAppend(os, "WAppend-lost-chunks",   "csum", wa.mLostChunkCount);
     HBAppend(os, "WAppend-pending-bytes", "pbt",  wa.mPendingByteCount);
     HBAppend(os, "WAppend-low-buf-flush", "lobf", wa.mLowOnBuffersFlushCount);
+    HBAppend(os, "WAppend-flushes",       "flc",  wa.mFlushCount);
+    HBAppend(os, "WAppend-flush-bytes",   "flb",  wa.mFlushByteCount);
+    HBAppend(os, "WAppend-flush-write-micro-sec", "flwt",
+        wa.mFlushWriteMicroSecs);
 
     const BufferManager&  bufMgr = DiskIo::GetBufferManager();
     HBAppend(os, 0, "buffers: bytes", "");
@@ -1899,6 +2039,30 @@ HeartbeatOp::Execute()
         dio.mTimedOutErrorWriteByteCount);
     HBAppend(os, "Disk-open-files",          "fopen",
         dio.mOpenFilesCount);
+    HBAppend(os, 0, "bufcache", "");
+    HBAppend(os, "Buffer-cache-refills", "refill",
+        dio.mBufferCacheRefillCount);
+    HBAppend(os, "Buffer-cache-flushes", "flush",
+        dio.mBufferCacheFlushCount);
+
+    HBAppend(os, 0, "mutex", "");
+    QCMutex::Counters    cliMutexCntrs;
+    const QCMutex* const cliMutex = gClientManager.GetMutexPtr();
+    if (cliMutex) {
+        cliMutex->GetCounters(cliMutexCntrs);
+    }
+    HBAppend(os, "Mutex-client-contended",      "ccnt",
+        cliMutexCntrs.mContendedCount);
+    HBAppend(os, "Mutex-client-spin-acquired",  "cspin",
+        cliMutexCntrs.mSpinAcquiredCount);
+    HBAppend(os, "Mutex-client-wait-usec",      "cwait",
+        cliMutexCntrs.mWaitNanoSec / 1000);
+    HBAppend(os, "Mutex-dqueue-contended",      "dcnt",
+        dio.mQueueMutexContendedCount);
+    HBAppend(os, "Mutex-dqueue-spin-acquired",  "dspin",
+        dio.mQueueMutexSpinAcquiredCount);
+    HBAppend(os, "Mutex-dqueue-wait-usec",      "dwait",
+        dio.mQueueMutexWaitNanoSec / 1000);
 
     HBAppend(os, 0, "msglog", "");
     MsgLogger::Counters msgLogCntrs;
@@ -1925,6 +2089,8 @@ HeartbeatOp::Execute()
     HBAppend(os, "Replication-cancel", "cancel",
         replCntrs.mReplicationCanceledCount);
     HBAppend(os, "Replicator-count",   "obj",    replCntrs.mReplicatorCount);
+    HBAppend(os, "Replication-throttle", "thr",
+        replCntrs.mReplicationThrottleCount);
     HBAppend(os, 0, "recov", "");
     HBAppend(os, "Recovery-count",  "cnt",    replCntrs.mRecoveryCount);
     HBAppend(os, "Recovery-errors", "err",    replCntrs.mRecoveryErrorCount);
@@ -1954,6 +2120,30 @@ HeartbeatOp::Execute()
         gClientManager.IsAuthEnabled() ? 1 : 0);
     HBAppend(os, "Auth-rsync", "authrs", RemoteSyncSM::IsAuthEnabled() ? 1 : 0);
     HBAppend(os, "Auth-meta",  "authms", gMetaServerSM.IsAuthEnabled() ? 1 : 0);
+}
+
+// This is the heartbeat sent by the meta server
+void
+HeartbeatOp::Execute()
+{
+    gChunkManager.MetaHeartbeat(*this);
+
+    static IOBuffer::WOStream sWOs;
+    static ostringstream      sOs;
+    ostream* os[2];
+    os[0] = &sWOs.Set(response);
+    if (MsgLogger::GetLogger() &&
+            MsgLogger::GetLogger()->IsLogLevelEnabled(
+                MsgLogger::kLogLevelDEBUG)) {
+        cmdShow.clear();
+        cmdShow.reserve(2 << 10);
+        sOs.str(cmdShow);
+        cmdShow = string(); // De-reference.
+        os[1] = &sOs;
+    } else {
+        os[1] = 0;
+    }
+    AppendCounters(os);
     *os[0] << "\r\n";
     os[0]->flush();
     sWOs.Reset();
@@ -2368,21 +2558,7 @@ WritePrepareOp::Execute()
         gLeaseClerk.DoingWrite(chunkId, chunkVersion);
     }
 
-    if (blocksChecksums.empty()) {
-        blocksChecksums = ComputeChecksums(&dataBuf, numBytes, &receivedChecksum);
-    }
-    if (receivedChecksum != checksum) {
-        statusMsg = "checksum mismatch";
-        KFS_LOG_STREAM_ERROR <<
-            "checksum mismatch: sent: " << checksum <<
-            ", computed: " << receivedChecksum << " for " << Show() <<
-        KFS_LOG_EOM;
-        status = -EBADCKSUM;
-        Done(EVENT_CMD_DONE, this);
-        return;
-    }
-
-    // will clone only when the op is good
+    // will clone only when the write has not failed
     writeOp = gChunkManager.CloneWriteOp(writeId);
 
     if (! writeOp) {
@@ -2396,6 +2572,10 @@ WritePrepareOp::Execute()
     }
 
     if (needToForward) {
+        // Forward before verifying the checksum and queueing the disk write,
+        // in order to put the data on the wire to the next server in the
+        // chain as early as possible. The downstream verifies the checksum
+        // independently.
         ForwardToPeer(peerLoc, writeMaster, allowCSClearTextFlag);
         if (status < 0) {
             // can't forward to peer...so fail the write
@@ -2404,11 +2584,26 @@ WritePrepareOp::Execute()
         }
     }
 
+    if (blocksChecksums.empty()) {
+        blocksChecksums = ComputeChecksums(&dataBuf, numBytes, &receivedChecksum);
+    }
+    if (receivedChecksum != checksum) {
+        statusMsg = "checksum mismatch";
+        KFS_LOG_STREAM_ERROR <<
+            "checksum mismatch: sent: " << checksum <<
+            ", computed: " << receivedChecksum << " for " << Show() <<
+        KFS_LOG_EOM;
+        status = -EBADCKSUM;
+        Done(EVENT_CMD_DONE, this);
+        return;
+    }
+
     writeOp->offset = offset;
     writeOp->numBytes = numBytes;
     writeOp->dataBuf.Move(&dataBuf);
     writeOp->wpop = this;
     writeOp->checksums.swap(blocksChecksums);
+    writeOp->lowPriorityFlag = lowPriorityFlag;
 
     writeOp->enqueueTime = globalNetManager().Now();
 
@@ -2448,6 +2643,12 @@ WritePrepareOp::ForwardToPeer(
     peer->Enqueue(writeFwdOp);
 }
 
+int64_t
+WritePrepareOp::GetDiskIoTime() const
+{
+    return (writeOp ? writeOp->diskIOTime : int64_t(-1));
+}
+
 int
 WritePrepareOp::Done(int code, void *data)
 {
@@ -2674,6 +2875,7 @@ WriteSyncOp::ForwardToPeer(
     fwdedOp->servers               = servers;
     fwdedOp->clnt                  = this;
     fwdedOp->syncReplicationAccess = syncReplicationAccess;
+    fwdedOp->traceId               = traceId;
     SET_HANDLER(fwdedOp, &KfsOp::HandleDone);
 
     if (writeMaster) {
@@ -3045,6 +3247,30 @@ StatsOp::Execute()
     os << "Num aios: " << 0 << "\r\n";
     os << "Num ops: " << gChunkServer.GetNumOps() << "\r\n";
     globals().counterManager.Show(os);
+    globalNetManager().ShowProfile(os);
+    // Heaviest clients first: key, weight, weight error, read bytes, write
+    // bytes, ops, errors.
+    ClientIoStats::Entries ioStats;
+    gClientManager.GetIoStats(ioStats);
+    for (ClientIoStats::Entries::const_iterator it = ioStats.begin();
+            it != ioStats.end();
+            ++it) {
+        os << "Client-io-" << (it - ioStats.begin()) << ": " <<
+            it->mKey        << "\t" <<
+            it->mWeight     << "\t" <<
+            it->mError      << "\t" <<
+            it->mReadBytes  << "\t" <<
+            it->mWriteBytes << "\t" <<
+            it->mOpCount    << "\t" <<
+            it->mErrorCount << "\r\n";
+    }
+    ClientThrottle::Counters throttle;
+    gClientManager.GetThrottleCounters(throttle);
+    os <<
+        "Client-throttled: "          << throttle.mThrottledCount     << "\r\n"
+        "Client-throttled-bytes: "    << throttle.mThrottledByteCount << "\r\n"
+        "Client-throttle-wait-usec: " << throttle.mWaitUsecs          << "\r\n"
+        "Client-throttle-tenants: "   << throttle.mTenantCount        << "\r\n";
     stats = os.str();
     status = 0;
     // clnt->HandleEvent(EVENT_CMD_DONE, this);
@@ -3054,19 +3280,23 @@ StatsOp::Execute()
 inline static bool
 OkHeader(const KfsOp* op, ostream &os, bool checkStatus = true)
 {
-    os << "OK\r\n";
-    os << "Cseq: "   << op->seq << "\r\n";
-    os << "Status: " << (op->status >= 0 ? op->status :
-        -SysToKfsErrno(-op->status)) << "\r\n";
+    IOBufferHeaderWriter writer(os);
+    writer.Write("OK\r\nCseq: ");
+    writer.WriteInt(op->seq);
+    writer.Write("\r\nStatus: ");
+    writer.WriteInt(op->status >= 0 ? op->status :
+        -SysToKfsErrno(-op->status));
+    writer.Write("\r\n");
     if (! op->statusMsg.empty()) {
         const size_t p = op->statusMsg.find('\r');
         assert(string::npos == p && op->statusMsg.find('\n') == string::npos);
-        os << "Status-message: " <<
-            (p == string::npos ? op->statusMsg : op->statusMsg.substr(0, p)) <<
-        "\r\n";
+        writer.Write("Status-message: ");
+        writer.Write(op->statusMsg.data(),
+            p == string::npos ? op->statusMsg.size() : p);
+        writer.Write("\r\n");
     }
     if (checkStatus && op->status < 0) {
-        os << "\r\n";
+        writer.Write("\r\n");
     }
     return (op->status >= 0);
 }
@@ -3130,19 +3360,26 @@ ReadOp::Response(ostream &os)
     }
 
     os << "DiskIOtime: " << (diskIOTime * 1e-6) << "\r\n";
-    os << "Checksum-entries: " << checksum.size() << "\r\n";
+    IOBufferHeaderWriter writer(os);
+    writer.Write("Checksum-entries: ");
+    writer.WriteInt(checksum.size());
+    writer.Write("\r\n");
     if (skipVerifyDiskChecksumFlag) {
-        os << "Skip-Disk-Chksum: 1\r\n";
+        writer.Write("Skip-Disk-Chksum: 1\r\n");
     }
-    if (checksum.size() == 0) {
-        os << "Checksums: " << 0 << "\r\n";
+    if (checksum.empty()) {
+        writer.Write("Checksums: 0\r\n");
     } else {
-        os << "Checksums: ";
-        for (uint32_t i = 0; i < checksum.size(); i++)
-            os << checksum[i] << ' ';
-        os << "\r\n";
+        writer.Write("Checksums: ");
+        for (size_t i = 0; i < checksum.size(); i++) {
+            writer.WriteInt(checksum[i]);
+            writer.Write(" ");
+        }
+        writer.Write("\r\n");
     }
-    os << "Content-length: " << numBytesIO << "\r\n\r\n";
+    writer.Write("Content-length: ");
+    writer.WriteInt(numBytesIO);
+    writer.Write("\r\n\r\n");
 }
 
 void
@@ -3166,7 +3403,23 @@ WritePrepareOp::Response(ostream &os)
         // no reply for a prepare...the reply is covered by sync
         return;
     }
-    ChunkAccessRequestOp::Response(os);
+    if (! OkHeader(this, os)) {
+        return;
+    }
+    WriteChunkAccessResponse(os, writeId, ChunkAccessToken::kUsesWriteIdFlag);
+    WriteBuffersWaitResponse(os);
+    os << "\r\n";
+}
+
+void
+WriteSyncOp::Response(ostream &os)
+{
+    if (! OkHeader(this, os)) {
+        return;
+    }
+    WriteChunkAccessResponse(os, writeId, ChunkAccessToken::kUsesWriteIdFlag);
+    WriteBuffersWaitResponse(os);
+    os << "\r\n";
 }
 
 void
@@ -3176,6 +3429,7 @@ RecordAppendOp::Response(ostream &os)
         return;
     }
     WriteChunkAccessResponse(os, writeId, ChunkAccessToken::kUsesWriteIdFlag);
+    WriteBuffersWaitResponse(os);
     os << "File-offset: " << fileOffset << "\r\n\r\n";
 }
 
@@ -3197,6 +3451,7 @@ RecordAppendOp::Request(ostream& os)
         "Servers: "          << servers               << "\r\n"
         "Master-committed: " << masterCommittedOffset << "\r\n"
     ;
+    PutTraceId(os, traceId);
     WriteSyncReplicationAccess(
         syncReplicationAccess, os, "Access-fwd-length: ");
 }
@@ -3262,6 +3517,7 @@ CloseOp::Request(ostream& os)
     if (masterCommitted >= 0) {
         os  << "Master-committed: " << masterCommitted << "\r\n";
     }
+    PutTraceId(os, traceId);
     WriteSyncReplicationAccess(syncReplicationAccess, os);
 }
 
@@ -3290,6 +3546,7 @@ GetChunkMetadataOp::Request(ostream& os)
     if (requestChunkAccess) {
         os << "C-access: " << requestChunkAccess << "\r\n";
     }
+    PutTraceId(os, traceId);
     os << "\r\n";
 }
 
@@ -3311,6 +3568,7 @@ ReadOp::Request(ostream& os)
     if (requestChunkAccess) {
         os << "C-access: " << requestChunkAccess << "\r\n";
     }
+    PutTraceId(os, traceId);
     os << "\r\n";
 }
 
@@ -3330,6 +3588,7 @@ WriteIdAllocOp::Request(ostream& os)
         "Num-servers: "       << numServers                  << "\r\n"
         "Servers: "           << servers                     << "\r\n"
     ;
+    PutTraceId(os, traceId);
     WriteSyncReplicationAccess(syncReplicationAccess, os);
 }
 
@@ -3349,6 +3608,7 @@ WritePrepareFwdOp::Request(ostream& os)
     "Reply: "         << (owner.replyRequestedFlag ? 1 : 0) << "\r\n"
     "Servers: "       << owner.servers << "\r\n"
     ;
+    PutTraceId(os, owner.traceId);
     WriteSyncReplicationAccess(
         owner.syncReplicationAccess, os, "Access-fwd-length: ");
 }
@@ -3374,6 +3634,7 @@ WriteSyncOp::Request(ostream& os)
     }
     os << "Num-servers: " << numServers << "\r\n";
     os << "Servers: " << servers << "\r\n";
+    PutTraceId(os, traceId);
     WriteSyncReplicationAccess(syncReplicationAccess, os);
 }
 
@@ -3575,6 +3836,15 @@ LeaseRenewOp::Request(ostream& os)
     if (chunkVersion < 0) {
         os << "Chunk-pos: " << (-(int64_t)chunkVersion - 1) << "\r\n";
     }
+    if (! chunkLeases.empty()) {
+        os << "Chunk-leases:";
+        for (ChunkLeases::const_iterator it = chunkLeases.begin();
+                it != chunkLeases.end();
+                ++it) {
+            os << " " << it->first << " " << it->second;
+        }
+        os << "\r\n";
+    }
     os << "\r\n";
 }
 
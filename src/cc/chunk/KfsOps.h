@@ -278,11 +278,14 @@ struct KfsOp : public KfsCallbackObj
     bool            noReply:1;
     bool            noRetry:1;
     bool            clientSMFlag:1;
+    bool            lowPriorityFlag:1; // Batch qos class, low priority disk io.
     int64_t         maxWaitMillisec;
+    int64_t         traceId; // optional client request trace id
     string          statusMsg; // output, optional, mostly for debugging
     KfsCallbackObj* clnt;
     // keep statistics
     int64_t         startTime;
+    int64_t         bufferWaitTime; // io buffers wait time, microseconds
     BufferBytes     bufferBytes;
     KfsOp*          next;
     NextOp          nextOp;
@@ -322,6 +325,8 @@ struct KfsOp : public KfsCallbackObj
         int64_t& /* numBytes */, kfsChunkId_t& /* chunkId */) { return false; }
     virtual BufferManager* GetDeviceBufferManager(
         bool /* findFlag */, bool /* resetFlag */) { return 0; }
+    // Time spent in disk io queue and io, microseconds, or -1 if n/a.
+    virtual int64_t GetDiskIoTime() const { return -1; }
     static int64_t GetOpsCount() { return sOpsCount; }
     bool ValidateRequestHeader(
         const char* name,
@@ -350,6 +355,7 @@ struct KfsOp : public KfsCallbackObj
         return parser
         .Def("Cseq",        &KfsOp::seq,            kfsSeq_t(-1))
         .Def("Max-wait-ms", &KfsOp::maxWaitMillisec, int64_t(-1))
+        .Def("Trace-id",    &KfsOp::traceId,         int64_t(0))
         ;
     }
     static inline BufferManager* GetDeviceBufferMangerSelf(
@@ -456,6 +462,9 @@ struct ChunkAccessRequestOp : public KfsClientChunkOp
           {}
     void WriteChunkAccessResponse(
         ostream& os, int64_t subjectId, int accessTokenFlags);
+    // Back pressure hint: average buffer wait time, for the client to
+    // reduce number of writes in flight.
+    void WriteBuffersWaitResponse(ostream& os);
     template<typename T> static T& ParserDef(T& parser)
     {
         return KfsClientChunkOp::ParserDef(parser)
@@ -869,6 +878,7 @@ struct HeartbeatOp : public KfsOp {
         {}
     void Execute();
     void Response(ostream &os);
+    static void AppendCounters(ostream** os);
     virtual ostream& ShowSelf(ostream& os) const {
         if (cmdShow.empty()) {
             return os << "heartbeat";
@@ -982,6 +992,7 @@ struct CloseOp : public KfsClientChunkOp {
     {
         chunkId      = op.chunkId;
         chunkVersion = op.chunkVersion;
+        traceId      = op.traceId;
     }
     virtual int GetContentLength() const { return contentLength; }
     virtual bool ParseContent(istream& is)
@@ -1217,6 +1228,7 @@ struct WriteIdAllocOp : public ChunkAccessRequestOp {
     {
         chunkId      = other.chunkId;
         chunkVersion = other.chunkVersion;
+        traceId      = other.traceId;
     }
     ~WriteIdAllocOp();
 
@@ -1341,6 +1353,7 @@ struct WritePrepareOp : public ChunkAccessRequestOp {
         return GetDeviceBufferMangerSelf(
             findFlag, resetFlag, chunkId, chunkVersion, devBufMgr);
     }
+    virtual int64_t GetDiskIoTime() const;
     virtual ostream& ShowSelf(ostream& os) const
     {
         return os <<
@@ -1543,6 +1556,7 @@ struct WriteSyncOp : public ChunkAccessRequestOp {
             is, chunkAccessLength, contentLength);
     }
     void Request(ostream &os);
+    void Response(ostream &os);
     void Execute();
     void ForwardToPeer(
         const ServerLocation& loc,
@@ -1633,6 +1647,11 @@ struct ReadOp : public KfsClientChunkOp {
     // for getting chunk metadata, we do a data scrub.
     GetChunkMetadataOp* scrubOp;
     BufferManager*      devBufMgr;
+    // Reads of the same stable chunk range waiting for this read's disk io
+    // completion, see ChunkManager::ReadChunk().
+    ReadOp*             coalescedReads;
+    ReadOp*             coalescedNext;
+    bool                coalescingFlag;
 
     ReadOp(kfsSeq_t s = 0)
         : KfsClientChunkOp(CMD_READ, s),
@@ -1648,7 +1667,10 @@ struct ReadOp : public KfsClientChunkOp {
           requestChunkAccess(0),
           wop(0),
           scrubOp(0),
-          devBufMgr(0)
+          devBufMgr(0),
+          coalescedReads(0),
+          coalescedNext(0),
+          coalescingFlag(false)
         { SET_HANDLER(this, &ReadOp::HandleDone); }
     ReadOp(WriteOp* w, int64_t o, size_t n)
         : KfsClientChunkOp(CMD_READ, w->seq),
@@ -1664,7 +1686,10 @@ struct ReadOp : public KfsClientChunkOp {
           requestChunkAccess(0),
           wop(w),
           scrubOp(0),
-          devBufMgr(0)
+          devBufMgr(0),
+          coalescedReads(0),
+          coalescedNext(0),
+          coalescingFlag(false)
     {
         clnt         = w;
         chunkId      = w->chunkId;
@@ -1672,7 +1697,7 @@ struct ReadOp : public KfsClientChunkOp {
         SET_HANDLER(this, &ReadOp::HandleDone);
     }
     ~ReadOp() {
-        assert(! wop);
+        assert(! wop && ! coalescedReads && ! coalescingFlag);
     }
 
     void SetScrubOp(GetChunkMetadataOp *sop) {
@@ -1711,6 +1736,7 @@ struct ReadOp : public KfsClientChunkOp {
         return GetDeviceBufferMangerSelf(
             findFlag, resetFlag, chunkId, chunkVersion, devBufMgr);
     }
+    virtual int64_t GetDiskIoTime() const { return diskIOTime; }
     virtual bool ParseResponse(const Properties& props, IOBuffer& iobuf);
     virtual bool GetResponseContent(IOBuffer& iobuf, int len)
     {
@@ -2016,6 +2042,8 @@ struct StatsOp : public KfsOp {
 };
 
 struct LeaseRenewOp : public KfsOp {
+    typedef vector<pair<kfsChunkId_t, int64_t> > ChunkLeases;
+
     kfsChunkId_t          chunkId;
     int64_t               leaseId;
     int64_t               chunkVersion;
@@ -2026,6 +2054,8 @@ struct LeaseRenewOp : public KfsOp {
     int64_t               chunkServerAccessIssuedTime;
     int                   chunkAccessLength;
     SyncReplicationAccess syncReplicationAccess;
+    ChunkLeases           chunkLeases;  // Additional write leases to renew.
+    string                failedLeases; // "chunk status" pairs.
 
     LeaseRenewOp(
         kfsSeq_t      s,
@@ -2044,7 +2074,9 @@ struct LeaseRenewOp : public KfsOp {
           chunkServerAccessValidForTime(0),
           chunkServerAccessIssuedTime(0),
           chunkAccessLength(0),
-          syncReplicationAccess()
+          syncReplicationAccess(),
+          chunkLeases(),
+          failedLeases()
         { SET_HANDLER(this, &LeaseRenewOp::HandleDone); }
     virtual bool ParseResponse(const Properties& props, IOBuffer& /* iobuf */)
     {
@@ -2052,6 +2084,8 @@ struct LeaseRenewOp : public KfsOp {
         chunkServerAccessValidForTime = props.getValue("CS-acess-time",   0);
         chunkServerAccessIssuedTime   = props.getValue("CS-acess-issued", 0);
         allowCSClearTextFlag          = props.getValue("CS-clear-text", 0) != 0;
+        failedLeases                  =
+            props.getValue("Failed-leases", string());
         return true;
     }
     virtual bool ParseResponseContent(istream& is, int len)
@@ -2071,7 +2105,8 @@ struct LeaseRenewOp : public KfsOp {
             " chunk: "   << chunkId <<
             " version: " << chunkVersion <<
             " leaseId: " << leaseId <<
-            " type: "    << leaseType
+            " type: "    << leaseType <<
+            " batch: "   << chunkLeases.size()
         ;
     }
 };
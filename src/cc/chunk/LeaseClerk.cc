@@ -36,6 +36,7 @@
 namespace KFS
 {
 using std::make_pair;
+using std::max;
 using KFS::libkfsio::globalNetManager;
 
 LeaseClerk gLeaseClerk;
@@ -52,12 +53,20 @@ LeaseClerk::Now()
 LeaseClerk::LeaseClerk()
     : mLeases(),
       mLastLeaseCheckTime(Now() - LEASE_INTERVAL_SECS * 2),
-      mTmpExpireQueue()
+      mTmpExpireQueue(),
+      mMaxRenewBatchSize(256)
 {
     SET_HANDLER(this, &LeaseClerk::HandleEvent);
     mTmpExpireQueue.reserve(4 << 10);
 }
 
+void
+LeaseClerk::SetParameters(const Properties& props)
+{
+    mMaxRenewBatchSize = (size_t)max(0, props.getValue(
+        "chunkServer.leaseClerk.maxRenewBatchSize", (int)mMaxRenewBatchSize));
+}
+
 inline LeaseClerk::LeaseMapEntry::Key
 LeaseClerk::MakeKey(chunkId_t chunkId, int64_t chunkVersion)
 {
@@ -81,6 +90,7 @@ LeaseClerk::RegisterLease(const AllocChunkOp& op)
     lease.leaseRenewSent                = false;
     lease.invalidFlag                   = false;
     lease.allowCSClearTextFlag          = op.allowCSClearTextFlag;
+    lease.noBatchRenewFlag              = false;
     lease.appendFlag                    = op.appendFlag;
     lease.syncReplicationExpirationTime = -LEASE_INTERVAL_SECS;
     lease.syncReplicationAccess         = op.syncReplicationAccess;
@@ -231,6 +241,86 @@ LeaseClerk::LeaseRenewed(LeaseRenewOp& op)
         " chunk: " << op.chunkId <<
         " lease: " << lease.leaseId <<
     KFS_LOG_EOM;
+    if (! op.chunkLeases.empty()) {
+        BatchLeasesRenewed(op);
+    }
+}
+
+void
+LeaseClerk::BatchLeasesRenewed(LeaseRenewOp& op)
+{
+    // Meta server reports the leases that it failed to renew, the remaining
+    // leases are renewed.
+    const char*       ptr = op.failedLeases.c_str();
+    const char* const end = ptr + op.failedLeases.size();
+    kfsChunkId_t      chunkId;
+    int               status;
+    while (DecIntParser::Parse(ptr, end - ptr, chunkId) &&
+            DecIntParser::Parse(ptr, end - ptr, status)) {
+        for (LeaseRenewOp::ChunkLeases::const_iterator
+                it = op.chunkLeases.begin();
+                it != op.chunkLeases.end();
+                ++it) {
+            if (it->first != chunkId) {
+                continue;
+            }
+            const LeaseInfo_t* const lease =
+                mLeases.Find(MakeKey(chunkId, kNullVersion));
+            if (lease && lease->leaseId == it->second) {
+                KFS_LOG_STREAM_ERROR <<
+                    "lease renew failed:"
+                    " chunk: "  << chunkId <<
+                    " lease: "  << it->second <<
+                    " status: " << status <<
+                KFS_LOG_EOM;
+                UnRegisterLease(chunkId, kNullVersion);
+            }
+            break;
+        }
+    }
+    const time_t now   = Now();
+    int          count = 0;
+    for (LeaseRenewOp::ChunkLeases::const_iterator it = op.chunkLeases.begin();
+            it != op.chunkLeases.end();
+            ++it) {
+        LeaseInfo_t* const lease =
+            mLeases.Find(MakeKey(it->first, kNullVersion));
+        if (! lease || lease->leaseId != it->second ||
+                ! lease->leaseRenewSent) {
+            continue; // Ignore stale renew reply.
+        }
+        lease->expires              = now + LEASE_INTERVAL_SECS;
+        lease->leaseRenewSent       = false;
+        lease->allowCSClearTextFlag = op.allowCSClearTextFlag;
+        count++;
+    }
+    KFS_LOG_STREAM_INFO <<
+        "batch lease renewed:"
+        " leases: " << count <<
+        " of: "     << op.chunkLeases.size() <<
+    KFS_LOG_EOM;
+}
+
+void
+LeaseClerk::BatchLeasesRenewFailed(LeaseRenewOp& op)
+{
+    // The failure might be due to the meta server not supporting batch write
+    // lease renew. Renew all leases in the batch individually, in order to
+    // determine which leases are no longer valid.
+    LeaseInfo_t* lease = mLeases.Find(MakeKey(op.chunkId, op.chunkVersion));
+    if (lease && lease->leaseId == op.leaseId) {
+        lease->leaseRenewSent   = false;
+        lease->noBatchRenewFlag = true;
+    }
+    for (LeaseRenewOp::ChunkLeases::const_iterator it = op.chunkLeases.begin();
+            it != op.chunkLeases.end();
+            ++it) {
+        if ((lease = mLeases.Find(MakeKey(it->first, kNullVersion))) &&
+                lease->leaseId == it->second) {
+            lease->leaseRenewSent   = false;
+            lease->noBatchRenewFlag = true;
+        }
+    }
 }
 
 int
@@ -252,7 +342,12 @@ LeaseClerk::HandleEvent(int code, void* data)
                         " status: " << renewOp->status <<
                         " msg: "    << renewOp->statusMsg <<
                     KFS_LOG_EOM;
-                    UnRegisterLease(renewOp->chunkId, renewOp->chunkVersion);
+                    if (renewOp->chunkLeases.empty()) {
+                        UnRegisterLease(
+                            renewOp->chunkId, renewOp->chunkVersion);
+                    } else {
+                        BatchLeasesRenewFailed(*renewOp);
+                    }
                 }
             } else if (op->op != CMD_LEASE_RELINQUISH) {
                 // Relinquish op will get here with its default handler, but
@@ -280,6 +375,7 @@ LeaseClerk::Timeout()
     }
     mLastLeaseCheckTime = now;
     mTmpExpireQueue.clear();
+    LeaseRenewOp* batchOp = 0;
     // once per second, check the state of the leases
     mLeases.First();
     const LeaseMapEntry* entry;
@@ -318,6 +414,35 @@ LeaseClerk::Timeout()
                 )) {
             continue;
         }
+        lease.leaseRenewSent = true;
+        // Renew leases without chunk server access in batches, in order to
+        // reduce the number of meta server requests. Object store blocks
+        // leases and leases with chunk server access are renewed
+        // individually.
+        if (1 < mMaxRenewBatchSize && key.second == kNullVersion &&
+                ! lease.noBatchRenewFlag &&
+                ! lease.syncReplicationAccess.chunkServerAccess &&
+                ! lease.syncReplicationAccess.chunkAccess) {
+            KFS_LOG_STREAM_DEBUG <<
+                "batch lease renew for:"
+                " chunk: "      << key.first <<
+                " lease: "      << lease.leaseId <<
+                " expires in: " << (lease.expires - now) << " sec" <<
+            KFS_LOG_EOM;
+            if (! batchOp) {
+                batchOp = new LeaseRenewOp(
+                    -1, key.first, key.second, lease.leaseId, kWriteLease,
+                    false);
+                continue;
+            }
+            batchOp->chunkLeases.push_back(
+                make_pair(key.first, lease.leaseId));
+            if (mMaxRenewBatchSize <= batchOp->chunkLeases.size() + 1) {
+                SendLeaseRenew(batchOp);
+                batchOp = 0;
+            }
+            continue;
+        }
         // The metaserverSM will fill seq#.
         LeaseRenewOp* const op = new LeaseRenewOp(
             -1, key.first, key.second, lease.leaseId, kWriteLease,
@@ -331,10 +456,10 @@ LeaseClerk::Timeout()
             " lease: "      << lease.leaseId <<
             " expires in: " << (lease.expires - now) << " sec" <<
         KFS_LOG_EOM;
-        op->noRetry = true;
-        op->clnt    = this;
-        lease.leaseRenewSent = true;
-        gMetaServerSM.EnqueueOp(op);
+        SendLeaseRenew(op);
+    }
+    if (batchOp) {
+        SendLeaseRenew(batchOp);
     }
     for (TmpExpireQueue::const_iterator it = mTmpExpireQueue.begin();
             it != mTmpExpireQueue.end();
@@ -344,6 +469,20 @@ LeaseClerk::Timeout()
     mTmpExpireQueue.clear();
 }
 
+void
+LeaseClerk::SendLeaseRenew(LeaseRenewOp* op)
+{
+    if (! op->chunkLeases.empty()) {
+        KFS_LOG_STREAM_INFO <<
+            "sending batch lease renew for:"
+            " leases: " << (op->chunkLeases.size() + 1) <<
+        KFS_LOG_EOM;
+    }
+    op->noRetry = true;
+    op->clnt    = this;
+    gMetaServerSM.EnqueueOp(op);
+}
+
 void
 LeaseClerk::RelinquishLease(kfsChunkId_t chunkId, int64_t chunkVersion,
     int64_t size, bool hasChecksum, uint32_t checksum)
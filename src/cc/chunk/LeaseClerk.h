@@ -90,6 +90,7 @@ public:
 
     time_t GetLeaseExpireTime(kfsChunkId_t chunkId, int64_t chunkVersion) const;
     void UnregisterAllLeases();
+    void SetParameters(const Properties& props);
 
     void Timeout();
 private:
@@ -102,6 +103,7 @@ private:
         bool                  appendFlag:1;
         bool                  invalidFlag:1;
         bool                  allowCSClearTextFlag:1;
+        bool                  noBatchRenewFlag:1;
         time_t                syncReplicationExpirationTime;
         SyncReplicationAccess syncReplicationAccess;
     };
@@ -127,8 +129,12 @@ private:
     LeaseMap          mLeases;
     time_t            mLastLeaseCheckTime;
     TmpExpireQueue    mTmpExpireQueue;
+    size_t            mMaxRenewBatchSize;
 
     void LeaseRenewed(LeaseRenewOp& op);
+    void BatchLeasesRenewed(LeaseRenewOp& op);
+    void BatchLeasesRenewFailed(LeaseRenewOp& op);
+    void SendLeaseRenew(LeaseRenewOp* op);
     inline static LeaseMapEntry::Key MakeKey(
         chunkId_t chunkId, int64_t chunkVersion);
 
@@ -73,6 +73,8 @@ MetaServerSM::MetaServerSM()
       mNetConnection(),
       mInactivityTimeout(65),
       mMaxReadAhead(4 << 10),
+      mMaxPendingOps(1 << 10),
+      mMaxWriteBehind(4 << 20),
       mLastRecvCmdTime(0),
       mLastConnectTime(0),
       mConnectedTime(0),
@@ -163,6 +165,10 @@ MetaServerSM::SetParameters(const Properties& prop)
         "chunkServer.meta.maxReadAhead",      mMaxReadAhead);
     mNoFidsFlag        = prop.getValue(
         "chunkServer.meta.noFids",            mNoFidsFlag ? 1 : 0) != 0;
+    mMaxPendingOps     = prop.getValue(
+        "chunkServer.meta.maxPendingOps",     mMaxPendingOps);
+    mMaxWriteBehind    = prop.getValue(
+        "chunkServer.meta.maxWriteBehind",    mMaxWriteBehind);
     const bool kVerifyFlag = true;
     int ret = mAuthContext.SetParameters(
         "chunkserver.meta.auth.", prop, 0, 0, kVerifyFlag);
@@ -908,7 +914,8 @@ void
 MetaServerSM::EnqueueOp(KfsOp* op)
 {
     op->seq = nextSeq();
-    if (! mAuthOp && mPendingOps.empty() && IsUp()) {
+    if (! mAuthOp && mPendingOps.empty() && IsUp() &&
+            IsDispatchWindowOpen()) {
         if (! op->noReply &&
                 ! mDispatchedOps.insert(make_pair(op->seq, op)).second) {
             die("duplicate seq. number");
@@ -990,6 +997,11 @@ MetaServerSM::DispatchOps()
             KFS_LOG_EOM;
             return;
         }
+        if (! IsDispatchWindowOpen()) {
+            // Dispatch the remaining ops when replies arrive, or the
+            // pending data is written.
+            break;
+        }
         KfsOp* const op = mPendingOps.front();
         mPendingOps.pop_front();
         assert(op->op != CMD_META_HELLO);
@@ -210,6 +210,8 @@ private:
     /// messages to the server.
     int                           mInactivityTimeout;
     int                           mMaxReadAhead;
+    int                           mMaxPendingOps;
+    int                           mMaxWriteBehind;
     time_t                        mLastRecvCmdTime;
     time_t                        mLastConnectTime;
     time_t                        mConnectedTime;
@@ -247,6 +249,16 @@ private:
 
     /// Submit all the enqueued ops
     void DispatchOps();
+    /// Returns true if the number of ops waiting for reply and the number
+    /// of bytes queued for write are within the limits.
+    bool IsDispatchWindowOpen() const {
+        return (
+            (mMaxPendingOps <= 0 ||
+                mDispatchedOps.size() < (size_t)mMaxPendingOps) &&
+            (mMaxWriteBehind <= 0 ||
+                mNetConnection->GetNumBytesToWrite() < mMaxWriteBehind)
+        );
+    }
 
     /// We reconnected to the metaserver; so, resend all the pending ops.
     void ResubmitOps();
@@ -36,6 +36,7 @@
 
 #include "kfsio/NetManager.h"
 #include "kfsio/SslFilter.h"
+#include "kfsio/MacFilter.h"
 #include "kfsio/Globals.h"
 #include "kfsio/DelegationToken.h"
 
@@ -102,6 +103,7 @@ public:
     Auth()
         : mSslCtxPtr(),
           mParams(),
+          mClearTextMacFlag(false),
           mEnabledFlag(false)
         {}
     ~Auth()
@@ -155,6 +157,9 @@ public:
             mSslCtxPtr = theSslCtxPtr;
         }
         mParams.swap(theParams);
+        mClearTextMacFlag = mParams.getValue(
+            theParamName.Truncate(thePrefLen).Append(
+            "clearTextMac"), 0) != 0;
         mEnabledFlag = mSslCtxPtr && mParams.getValue(
             theParamName.Truncate(thePrefLen).Append(
             "enabled"), inAuthEnabledFlag ? 1 : 0) != 0;
@@ -190,6 +195,14 @@ public:
             delete theFilterPtr;
             return false;
         }
+        if (mClearTextMacFlag) {
+            const bool kServerFlag = false;
+            theFilterPtr->SetShutdownFilter(new MacFilter(
+                inSessionKey.GetPtr(),
+                (int)inSessionKey.GetSize(),
+                kServerFlag
+            ));
+        }
         string theErrMsg;
         const int theStatus = inConn.SetFilter(theFilterPtr, &theErrMsg);
         if (theStatus == 0) {
@@ -205,7 +218,8 @@ public:
     {
         mSslCtxPtr.reset();
         mParams.clear();
-        mEnabledFlag = false;
+        mClearTextMacFlag = false;
+        mEnabledFlag      = false;
     }
     bool IsEnabled() const
         { return mEnabledFlag; }
@@ -214,6 +228,7 @@ private:
 
     SslCtxPtr  mSslCtxPtr;
     Properties mParams;
+    bool       mClearTextMacFlag;
     bool       mEnabledFlag;
 private:
     Auth(
@@ -585,7 +600,7 @@ RemoteSyncSM::HandleEvent(int code, void *data)
     case EVENT_NET_ERROR:
         if (mSslShutdownInProgressFlag &&
                 mNetConnection && mNetConnection->IsGood()) {
-            KFS_LOG_STREAM(mNetConnection->GetFilter() ?
+            KFS_LOG_STREAM(mNetConnection->IsEncrypted() ?
                     MsgLogger::kLogLevelERROR :
                     MsgLogger::kLogLevelDEBUG) << mLocation <<
                 " ssl shutdown completion:"
@@ -593,7 +608,7 @@ RemoteSyncSM::HandleEvent(int code, void *data)
                     mNetConnection->GetFilter()) <<
             KFS_LOG_EOM;
             mSslShutdownInProgressFlag = false;
-            if (! mNetConnection->GetFilter()) {
+            if (! mNetConnection->IsEncrypted()) {
                 break;
             }
         }
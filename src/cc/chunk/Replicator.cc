@@ -55,6 +55,7 @@
 #include "kfsio/Globals.h"
 #include "kfsio/ClientAuthContext.h"
 #include "kfsio/checksum.h"
+#include "kfsio/ITimeout.h"
 
 #include "qcdio/qcstutils.h"
 
@@ -64,6 +65,8 @@
 
 #include <string>
 #include <sstream>
+#include <deque>
+#include <algorithm>
 
 namespace KFS
 {
@@ -74,6 +77,8 @@ using std::pair;
 using std::make_pair;
 using std::max;
 using std::min;
+using std::deque;
+using std::find;
 using KFS::libkfsio::globalNetManager;
 using KFS::client::Reader;
 using KFS::client::KfsNetClient;
@@ -111,6 +116,14 @@ public:
             "chunkServer.replicator.readSkipDiskVerify",
             sReadSkipDiskVerifyFlag ? 1 : 0
         ) != 0;
+        sMaxBytesPerSec = max(int64_t(0), props.getValue(
+            "chunkServer.replicator.maxBytesPerSec",
+            sMaxBytesPerSec
+        ));
+        if (sMaxBytesPerSec <= 0 && ! sThrottleQueue.empty()) {
+            // Throttling turned off, let all waiting replications run.
+            RunThrottleQueue();
+        }
     }
 
     ReplicatorImpl(ReplicateChunkOp *op, const RemoteSyncSMPtr &peer);
@@ -142,6 +155,8 @@ protected:
     // Are we done yet?
     bool                  mDone;
     bool                  mCancelFlag;
+    bool                  mThrottledFlag;
+    bool                  mThrottleGrantedFlag;
     DiskIo::FilePtr       mFileHandle;
 
     // Handle the callback for a size request
@@ -165,6 +180,11 @@ protected:
     virtual void Cancel()
     {
         mCancelFlag = true;
+        if (mThrottledFlag) {
+            RemoveFromThrottleQueue();
+            Terminate(ECANCELED);
+            return;
+        }
         if (mFileHandle) {
             DiskIo::FilePtr fileH;
             fileH.swap(mFileHandle);
@@ -179,8 +199,18 @@ protected:
     virtual ByteCount GetBufferBytesRequired() const;
     virtual void ReplicationDone()
         { delete this; }
+    // Replication network read bandwidth limit. Returns false if the read
+    // has to wait in the throttle queue.
+    bool Throttle();
 
 private:
+    class ThrottleTimer : public ITimeout
+    {
+    public:
+        virtual void Timeout()
+            { ReplicatorImpl::RunThrottleQueue(); }
+    };
+    typedef deque<ReplicatorImpl*> ThrottleQueue;
     typedef std::map<
         kfsChunkId_t, ReplicatorImpl*,
         std::less<kfsChunkId_t>,
@@ -193,6 +223,15 @@ private:
     static Counters             sCounters;
     static bool                 sUseConnectionPoolFlag;
     static bool                 sReadSkipDiskVerifyFlag;
+    static int64_t              sMaxBytesPerSec;
+    static int64_t              sThrottleTokens;
+    static int64_t              sThrottleRefillTimeMs;
+    static ThrottleQueue        sThrottleQueue;
+    static ThrottleTimer        sThrottleTimer;
+
+    static void RefillThrottleTokens();
+    static void RunThrottleQueue();
+    void RemoveFromThrottleQueue();
 private:
     // No copy.
     ReplicatorImpl(const ReplicatorImpl&);
@@ -206,6 +245,11 @@ ReplicatorImpl::InFlightReplications ReplicatorImpl::sInFlightReplications;
 ReplicatorImpl::Counters             ReplicatorImpl::sCounters;
 bool ReplicatorImpl::sUseConnectionPoolFlag  = false;
 bool ReplicatorImpl::sReadSkipDiskVerifyFlag = true;
+int64_t ReplicatorImpl::sMaxBytesPerSec        = 0;
+int64_t ReplicatorImpl::sThrottleTokens        = 0;
+int64_t ReplicatorImpl::sThrottleRefillTimeMs  = 0;
+ReplicatorImpl::ThrottleQueue ReplicatorImpl::sThrottleQueue;
+ReplicatorImpl::ThrottleTimer ReplicatorImpl::sThrottleTimer;
 
 int
 ReplicatorImpl::GetNumReplications()
@@ -268,10 +312,14 @@ ReplicatorImpl::ReplicatorImpl(ReplicateChunkOp *op, const RemoteSyncSMPtr &peer
     mWriteOp(op->chunkId, op->chunkVersion),
     mDone(false),
     mCancelFlag(false),
+    mThrottledFlag(false),
+    mThrottleGrantedFlag(false),
     mFileHandle()
 {
     mReadOp.chunkId = op->chunkId;
     mReadOp.chunkVersion = op->chunkVersion;
+    mReadOp.traceId = op->traceId;
+    mChunkMetadataOp.traceId = op->traceId;
     if (! op->chunkAccess.empty()) {
         mReadOp.requestChunkAccess          = mOwner->chunkAccess.c_str();
         mChunkMetadataOp.requestChunkAccess = mReadOp.requestChunkAccess;
@@ -287,7 +335,7 @@ ReplicatorImpl::ReplicatorImpl(ReplicateChunkOp *op, const RemoteSyncSMPtr &peer
 
 ReplicatorImpl::~ReplicatorImpl()
 {
-    if (GetByteCount() != 0 || IsWaiting() || mOwner) {
+    if (GetByteCount() != 0 || IsWaiting() || mOwner || mThrottledFlag) {
         ostringstream os;
         os << "replication: invalid destructor invocation"
             " "        << (const void*)this <<
@@ -484,6 +532,9 @@ ReplicatorImpl::Read()
     if (mOffset % (int)CHECKSUM_BLOCKSIZE != 0) {
         mReadOp.skipVerifyDiskChecksumFlag = false;
     }
+    if (! Throttle()) {
+        return;
+    }
     assert(mPeer);
     SET_HANDLER(this, &ReplicatorImpl::HandleReadDone);
     mReadOp.checksum.clear();
@@ -496,6 +547,90 @@ ReplicatorImpl::Read()
     mPeer->Enqueue(&mReadOp);
 }
 
+void
+ReplicatorImpl::RefillThrottleTokens()
+{
+    const int64_t nowMs = ITimeout::NowMs();
+    if (sThrottleRefillTimeMs < nowMs) {
+        // Allow at most 1 second worth of burst.
+        sThrottleTokens = min(sMaxBytesPerSec, sThrottleTokens +
+            sMaxBytesPerSec * (nowMs - sThrottleRefillTimeMs) / 1000);
+        sThrottleRefillTimeMs = nowMs;
+    }
+}
+
+bool
+ReplicatorImpl::Throttle()
+{
+    if (mThrottleGrantedFlag) {
+        mThrottleGrantedFlag = false;
+        return true;
+    }
+    if (sMaxBytesPerSec <= 0) {
+        return true;
+    }
+    RefillThrottleTokens();
+    if (sThrottleQueue.empty() && 0 < sThrottleTokens) {
+        // The tokens might go negative in order to handle limits smaller
+        // than the read size.
+        sThrottleTokens -= kDefaultReplicationReadSize;
+        return true;
+    }
+    KFS_LOG_STREAM_DEBUG << "replication:"
+        " chunk: "    << mChunkId <<
+        " peer: "     << GetPeerName() <<
+        " position: " << mOffset <<
+        " throttled:"
+        " tokens: "   << sThrottleTokens <<
+        " queue: "    << sThrottleQueue.size() <<
+    KFS_LOG_EOM;
+    if (sThrottleQueue.empty()) {
+        sThrottleTimer.SetTimeoutInterval(50);
+        globalNetManager().RegisterTimeoutHandler(&sThrottleTimer);
+    }
+    sThrottleQueue.push_back(this);
+    mThrottledFlag = true;
+    sCounters.mReplicationThrottleCount++;
+    return false;
+}
+
+void
+ReplicatorImpl::RunThrottleQueue()
+{
+    RefillThrottleTokens();
+    while (! sThrottleQueue.empty() &&
+            (sMaxBytesPerSec <= 0 || 0 < sThrottleTokens)) {
+        ReplicatorImpl& cur = *sThrottleQueue.front();
+        sThrottleQueue.pop_front();
+        if (0 < sMaxBytesPerSec) {
+            sThrottleTokens -= kDefaultReplicationReadSize;
+        }
+        cur.mThrottledFlag       = false;
+        cur.mThrottleGrantedFlag = true;
+        cur.Read();
+    }
+    if (sThrottleQueue.empty()) {
+        globalNetManager().UnRegisterTimeoutHandler(&sThrottleTimer);
+    }
+}
+
+void
+ReplicatorImpl::RemoveFromThrottleQueue()
+{
+    if (! mThrottledFlag) {
+        return;
+    }
+    ThrottleQueue::iterator const it =
+        find(sThrottleQueue.begin(), sThrottleQueue.end(), this);
+    if (it != sThrottleQueue.end()) {
+        sThrottleQueue.erase(it);
+    }
+    mThrottledFlag = false;
+    if (sThrottleQueue.empty()) {
+        globalNetManager().UnRegisterTimeoutHandler(&sThrottleTimer);
+    }
+}
+
 int
 ReplicatorImpl::HandleReadDone(int code, void* data)
 {
@@ -810,6 +945,9 @@ public:
             "chunkServer.rsReader.maxRecoveryThreads",
             sMaxRecoveryThreads
         );
+        sRSReaderReadAheadFlag = props.getValue(
+            "chunkServer.rsReader.readAhead",
+            sRSReaderReadAheadFlag ? 1 : 0) != 0;
         if (0 < props.copyWithPrefix(kRsReadMetaAuthPrefix, sAuthParams)) {
             sAuthUpdateCount++;
         }
@@ -896,8 +1034,16 @@ private:
     Reader               mReader;
     IOBuffer             mReadTail;
     const ServerLocation mLocation;
+    const bool           mReadAheadFlag;
     const int            mReadSize;
     bool                 mReadInFlightFlag;
+    bool                 mReadAheadInFlightFlag;
+    bool                 mReadAheadDoneFlag;
+    bool                 mReadAheadBufFlag;
+    int                  mReadAheadStatus;
+    Reader::Offset       mReadAheadPos;
+    Reader::Offset       mReadAheadDoneOffset;
+    IOBuffer             mReadAheadBuf;
     bool                 mPendingCloseFlag;
     bool                 mPendingCancelFlag;
     bool                 mReplicationDoneFlag;
@@ -933,8 +1079,16 @@ private:
           ),
           mReadTail(),
           mLocation(gMetaServerSM.GetLocation().hostname, op->location.port),
-          mReadSize(GetReadSize(*op)),
+          mReadAheadFlag(sRSReaderReadAheadFlag),
+          mReadSize(GetReadSize(*op, mReadAheadFlag)),
           mReadInFlightFlag(false),
+          mReadAheadInFlightFlag(false),
+          mReadAheadDoneFlag(false),
+          mReadAheadBufFlag(false),
+          mReadAheadStatus(0),
+          mReadAheadPos(-1),
+          mReadAheadDoneOffset(-1),
+          mReadAheadBuf(),
           mPendingCloseFlag(false),
           mPendingCancelFlag(false),
           mReplicationDoneFlag(false),
@@ -1020,7 +1174,8 @@ private:
     }
     virtual ByteCount GetBufferBytesRequired() const
     {
-        return (mReadSize * (mOwner ? mOwner->numStripes + 1 : 0));
+        return (mReadSize * (mOwner ? mOwner->numStripes + 1 : 0) *
+            (mReadAheadFlag ? 2 : 1));
     }
     void Enqueue(State inState)
     {
@@ -1115,11 +1270,14 @@ private:
         IOBuffer*         inBufferPtr,
         Reader::RequestId inRequestId)
     {
+        const bool readAheadFlag = inRequestId.mPtr == &mReadAheadBuf;
         if (&inReader != &mReader || (inBufferPtr &&
-                (inRequestId.mPtr != this ||
+                ((inRequestId.mPtr != this && ! readAheadFlag) ||
                     inOffset < 0 ||
-                    inSize > (Reader::Offset)mReadOp.numBytes ||
-                    ! mReadInFlightFlag))) {
+                    inSize > (Reader::Offset)(readAheadFlag ?
+                        mReadSize : mReadOp.numBytes) ||
+                    ! (readAheadFlag ?
+                        mReadAheadInFlightFlag : mReadInFlightFlag)))) {
             FatalError("invalid read completion");
             mReadOp.status = -EINVAL;
         }
@@ -1138,6 +1296,63 @@ private:
             }
             return;
         }
+        if (readAheadFlag) {
+            if (! mReadAheadInFlightFlag) {
+                return;
+            }
+            mReadAheadInFlightFlag = false;
+            mReadAheadDoneFlag     = true;
+            mReadAheadStatus       = inStatusCode;
+            mReadAheadDoneOffset   = inOffset;
+            mReadAheadBufFlag      = inBufferPtr != 0;
+            mReadAheadBuf.Clear();
+            if (inBufferPtr) {
+                mReadAheadBuf.Move(inBufferPtr);
+            }
+            if (mReadInFlightFlag) {
+                // HandleRead() is waiting for the read ahead completion.
+                ReadAheadDone();
+            }
+            return;
+        }
+        ReadDone(inStatusCode, inOffset, inBufferPtr);
+    }
+    void ReadAheadDone()
+    {
+        if (! mReadAheadDoneFlag || ! mReadInFlightFlag) {
+            FatalError("invalid read ahead completion");
+            return;
+        }
+        mReadAheadDoneFlag = false;
+        IOBuffer buf;
+        buf.Move(&mReadAheadBuf);
+        ReadDone(mReadAheadStatus, mReadAheadDoneOffset,
+            mReadAheadBufFlag ? &buf : 0);
+    }
+    void StartReadAhead(Reader::Offset pos)
+    {
+        if (! mReadAheadFlag || mReadAheadInFlightFlag || mReadAheadDoneFlag ||
+                mPendingCloseFlag || mPendingCancelFlag) {
+            return;
+        }
+        // Issue the next read, while the current one is being written, in
+        // order to overlap recovery reads with the chunk writes.
+        Reader::RequestId reqId = Reader::RequestId();
+        reqId.mPtr = &mReadAheadBuf;
+        mReadAheadPos          = pos;
+        mReadAheadInFlightFlag = true;
+        IOBuffer buf;
+        const int status = mReader.Read(buf, mReadSize, pos, reqId);
+        if (status != 0 && mReadAheadInFlightFlag) {
+            // Let the next HandleRead() issue and report read failure.
+            mReadAheadInFlightFlag = false;
+        }
+    }
+    void ReadDone(
+        int            inStatusCode,
+        Reader::Offset inOffset,
+        IOBuffer*      inBufferPtr)
+    {
         if (! mReadInFlightFlag) {
             // Handle possible recursion from Close() by assigning the status.
             if (mReadOp.status >= 0 && inStatusCode < 0) {
@@ -1189,6 +1404,8 @@ private:
                 mReadTail.Move(inBufferPtr);
                 mReadOp.numBytes   = buf.BytesConsumable();
                 mReadOp.numBytesIO = mReadOp.numBytes;
+                StartReadAhead(
+                    mOffset + mReadOp.numBytes + mReadTail.BytesConsumable());
             }
             if (0 < mReadOp.numBytes && ! buf.IsEmpty() &&
                         mReadOp.offset   % (int)CHECKSUM_BLOCKSIZE == 0 &&
@@ -1281,7 +1498,10 @@ private:
         mReader.Unregister(this);
         mReader.Shutdown();
         assert(! mReader.IsActive());
-        mPendingCloseFlag = false;
+        mPendingCloseFlag      = false;
+        mReadAheadInFlightFlag = false;
+        mReadAheadDoneFlag     = false;
+        mReadAheadBuf.Clear();
         // Unregister and shutdown will cancel pending close without
         // invoking completion method Done().
         StMutexLocker lock(mClientThreadPtr);
@@ -1374,6 +1594,7 @@ private:
         if (0 <= mChunkMetadataOp.status) {
             const bool kSkipHolesFlag                 = true;
             const bool kUseDefaultBufferAllocatorFlag = true;
+            mReader.SetTraceId(mOwner->traceId);
             mChunkMetadataOp.status = mReader.Open(
                 mFileId,
                 mOwner->pathName.c_str(),
@@ -1406,9 +1627,20 @@ private:
         mReadOp.numBytesIO = 0;
         mReadOp.offset     = mOffset;
         mReadOp.dataBuf.Clear();
+        mReadInFlightFlag = true;
+        if (mReadAheadInFlightFlag || mReadAheadDoneFlag) {
+            if (mReadAheadPos != mOffset + mReadTail.BytesConsumable()) {
+                FatalError("invalid read ahead position");
+                return;
+            }
+            if (mReadAheadDoneFlag) {
+                ReadAheadDone();
+            }
+            // Otherwise wait for read ahead completion.
+            return;
+        }
         Reader::RequestId reqId = Reader::RequestId();
         reqId.mPtr = this;
-        mReadInFlightFlag = true;
         IOBuffer buf;
         const int status = mReader.Read(
             buf,
@@ -1629,7 +1861,7 @@ private:
         sInitialSeqNum += 100000 + ((uint32_t)(sNextRand / 65536) % 32768);
         return sInitialSeqNum;
     }
-    static int GetReadSize(const ReplicateChunkOp& op)
+    static int GetReadSize(const ReplicateChunkOp& op, bool readAheadFlag)
     {
         // Align read on checksum block boundary, and align on stripe size,
         // if possible.
@@ -1644,7 +1876,7 @@ private:
         const int size = max(kChecksumBlockSize, (int)min(
             int64_t(sRSReaderMaxReadSize),
             (DiskIo::GetBufferManager().GetMaxClientQuota() /
-                max(1, op.numStripes + 1)) /
+                max(1, (op.numStripes + 1) * (readAheadFlag ? 2 : 1))) /
             kChecksumBlockSize * kChecksumBlockSize)
         );
         if (size <= op.stripeSize) {
@@ -1698,6 +1930,7 @@ private:
     static int        sRSReaderMetaIdleTimeoutSec;
     static int        sRSReaderMaxRecoverChunkSize;
     static int        sMaxRecoveryThreads;
+    static bool       sRSReaderReadAheadFlag;
     static bool       sRSReaderMetaResetConnectionOnOpTimeoutFlag;
     static bool       sRSReaderPanicOnInvalidChunkFlag;
     static bool       sDebugSetThreadFlag;
@@ -1724,6 +1957,7 @@ int  RSReplicatorImpl::sRSReaderMetaTimeSecBetweenRetries          = 10;
 int  RSReplicatorImpl::sRSReaderMetaOpTimeoutSec                   = 4 * 60;
 int  RSReplicatorImpl::sRSReaderMetaIdleTimeoutSec                 = 5 * 60;
 int  RSReplicatorImpl::sMaxRecoveryThreads                         = 5;
+bool RSReplicatorImpl::sRSReaderReadAheadFlag                      = true;
 bool RSReplicatorImpl::sRSReaderMetaResetConnectionOnOpTimeoutFlag = true;
 int  RSReplicatorImpl::sRSReaderMaxRecoverChunkSize                =
     (int)CHUNKSIZE;
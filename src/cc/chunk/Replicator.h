@@ -55,6 +55,7 @@ public:
         Counter mWriteCount;
         Counter mReadByteCount;
         Counter mWriteByteCount;
+        Counter mReplicationThrottleCount;
         Counters()
             : mReplicationCount(0),
               mReplicationErrorCount(0),
@@ -66,7 +67,8 @@ public:
               mReadCount(0),
               mWriteCount(0),
               mReadByteCount(0),
-              mWriteByteCount(0)
+              mWriteByteCount(0),
+              mReplicationThrottleCount(0)
             {}
         void Reset()
             { *this = Counters(); }
@@ -30,6 +30,7 @@
 #include "AtomicRecordAppender.h"
 #include "RemoteSyncSM.h"
 #include "MetaServerSM.h"
+#include "ClientManager.h"
 
 #include "common/Properties.h"
 #include "common/MdStream.h"
@@ -39,6 +40,7 @@
 #include "kfsio/SslFilter.h"
 #include "kfsio/NetErrorSimulator.h"
 #include "qcdio/QCUtils.h"
+#include "qcdio/QCMutex.h"
 
 #include <signal.h>
 #include <sys/stat.h>
@@ -49,6 +51,7 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <stdio.h>
 
 #include <string>
 #include <vector>
@@ -76,6 +79,9 @@ using KFS::libkfsio::InitGlobals;
 // with fork is a little bit more involved.
 // The intention here is to do graceful restart, this is not intended as an
 // external "nanny" / monitoring / watchdog.
+// The client listener socket is passed to the new process, in order to queue
+// the client connections while the process restarts, instead of refusing
+// them.
 class Restarter
 {
 public:
@@ -84,7 +90,10 @@ public:
           mArgs(0),
           mEnv(0),
           mMaxGracefulRestartSeconds(60 * 6),
-          mExitOnRestartFlag(false)
+          mExitOnRestartFlag(false),
+          mHandoffClientListenerFlag(true),
+          mInheritedListenerFd(-1),
+          mListenerFd(-1)
         {}
     ~Restarter()
         { Cleanup(); }
@@ -95,6 +104,16 @@ public:
             QCUtils::FatalError("signal(SIGALRM)", errno);
         }
         Cleanup();
+        // Remove the inherited listener from the environment, in order not to
+        // pass it to the next restart.
+        const char* const fdStr = ::getenv(kListenerFdEnvName);
+        if (fdStr) {
+            char* end = 0;
+            const long fd = ::strtol(fdStr, &end, 10);
+            mInheritedListenerFd = (fdStr < end && ! *end && 0 <= fd) ?
+                (int)fd : -1;
+            ::unsetenv(kListenerFdEnvName);
+        }
         if (argc < 1 || ! argv) {
             return false;
         }
@@ -145,7 +164,13 @@ public:
             prefix + "exitOnRestartFlag",
             mExitOnRestartFlag
         );
+        mHandoffClientListenerFlag = props.getValue(
+            prefix + "restartHandoffClientListener",
+            mHandoffClientListenerFlag ? 1 : 0
+        ) != 0;
     }
+    int GetInheritedListenerFd() const
+        { return mInheritedListenerFd; }
     string Restart()
     {
         if (! mCwd || ! mArgs || ! mEnv || ! mArgs[0] || ! mArgs[0][0]) {
@@ -177,6 +202,21 @@ public:
         if (::signal(SIGALRM, &Restarter::SigAlrmHandler) == SIG_ERR) {
             QCUtils::FatalError("signal(SIGALRM)", errno);
         }
+        if (mHandoffClientListenerFlag && ! mExitOnRestartFlag &&
+                mListenerFd < 0) {
+            // The duplicate remains open after the acceptor is closed on
+            // shutdown, and is inherited by the new process, as it has close
+            // on exec flag cleared.
+            const int fd = gClientManager.DupListener();
+            if (fd < 0) {
+                KFS_LOG_STREAM_ERROR <<
+                    "restart: client listener handoff: " <<
+                        QCUtils::SysError(-fd) <<
+                KFS_LOG_EOM;
+            } else {
+                mListenerFd = fd;
+            }
+        }
         if (mMaxGracefulRestartSeconds > 0) {
             if (sInstance) {
                 return string("restart in progress");
@@ -200,8 +240,12 @@ private:
     char** mEnv;
     int    mMaxGracefulRestartSeconds;
     bool   mExitOnRestartFlag;
+    bool   mHandoffClientListenerFlag;
+    int    mInheritedListenerFd;
+    int    mListenerFd;
 
-    static Restarter* sInstance;
+    static Restarter*  sInstance;
+    static const char* const kListenerFdEnvName;
 
     static void FreeArgs(char** args)
     {
@@ -240,6 +284,13 @@ private:
                 }
             }
         }
+        if (0 <= mListenerFd) {
+            char buf[32];
+            ::snprintf(buf, sizeof(buf), "%d", mListenerFd);
+            if (::setenv(kListenerFdEnvName, buf, 1)) {
+                QCUtils::FatalError("setenv", errno);
+            }
+        }
         if (::chdir(mCwd) != 0) {
             QCUtils::FatalError(mCwd, errno);
         }
@@ -262,6 +313,8 @@ private:
     }
 };
 Restarter* Restarter::sInstance = 0;
+const char* const Restarter::kListenerFdEnvName =
+    "QFS_CHUNK_SERVER_CLIENT_LISTENER_FD";
 static Restarter sRestarter;
 
 string RestartChunkServer()
@@ -444,6 +497,11 @@ ChunkServerMain::LoadParams(const char* fileName)
     KFS_LOG_STREAM_INFO << "chunk server client thread count: " <<
         mClientThreadCount <<  " first cpu: " << mFirstCpuIndex <<
     KFS_LOG_EOM;
+    QCMutex::SetSpinCount(mProp.getValue(
+        "chunkServer.mutex.spinCount", QCMutex::GetSpinCount()));
+    QCMutex::SetProfilingEnabled(mProp.getValue(
+        "chunkServer.mutex.contentionProfiling",
+        QCMutex::IsProfilingEnabled() ? 1 : 0) != 0);
 
     mChunkServerHostname = mProp.getValue("chunkServer.hostname",
         mChunkServerHostname);
@@ -602,7 +660,8 @@ ChunkServerMain::Run(int argc, char **argv)
                 mClientListenerIpV6OnlyFlag,
                 mChunkServerHostname,
                 mClientThreadCount,
-                mFirstCpuIndex)) {
+                mFirstCpuIndex,
+                sRestarter.GetInheritedListenerFd())) {
         ret = gChunkServer.MainLoop(mChunkDirs, mProp, mLogDir) ? 0 : 1;
     }
     NetErrorSimulatorConfigure(globalNetManager());
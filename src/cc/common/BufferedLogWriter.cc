@@ -45,6 +45,7 @@
 #include <stdarg.h>
 #include <errno.h>
 #include <string.h>
+#include <pthread.h>
 
 #include <vector>
 #include <string>
@@ -155,7 +156,11 @@ public:
           mRotateLogsDailyFlag(true),
           mMaxMsgStreamCount(256),
           mMsgStreamCount(0),
-          mMsgStreamHeadPtr(0)
+          mMsgStreamHeadPtr(0),
+          mThreadMsgStreamKey(),
+          mThreadMsgStreamKeyFlag(
+            pthread_key_create(&mThreadMsgStreamKey, &DeleteMsgStream) == 0),
+          mUseThreadMsgStreamFlag(mThreadMsgStreamKeyFlag)
     {
         if (! mFileName.empty()) {
             mLogFileNamePrefixes.push_back(mFileName);
@@ -186,6 +191,12 @@ public:
     {
         Impl::Stop();
         delete [] mBuf0Ptr;
+        if (mThreadMsgStreamKeyFlag) {
+            // The other threads' streams are leaked, as the key destructor is
+            // not invoked after the key deletion.
+            DeleteMsgStream(pthread_getspecific(mThreadMsgStreamKey));
+            pthread_key_delete(mThreadMsgStreamKey);
+        }
         while (mMsgStreamHeadPtr) {
             QCASSERT(mMsgStreamCount > 0);
             MsgStream* const thePtr = mMsgStreamHeadPtr;
@@ -229,6 +240,9 @@ public:
         mMaxMsgStreamCount   = inProps.getValue(
             inPropsPrefix + "maxMsgStreamCount",
             mMaxMsgStreamCount);
+        mUseThreadMsgStreamFlag = mThreadMsgStreamKeyFlag && inProps.getValue(
+            inPropsPrefix + "useThreadMsgStream",
+            mUseThreadMsgStreamFlag ? 1 : 0) != 0;
         mRotateLogsDailyFlag = inProps.getValue(
             inPropsPrefix + "rotateLogsDaily",
             mRotateLogsDailyFlag ? 1 : 0) != 0;
@@ -799,6 +813,18 @@ public:
         LogLevel inLogLevel,
         bool     inDiscardFlag)
     {
+        // Each thread keeps its last stream, in order to avoid taking the
+        // mutex on the stream get. The thread has no cached stream while the
+        // stream is in use, the nested log message streams, if any, come from
+        // the shared list.
+        MsgStream* const theThreadStreamPtr = mUseThreadMsgStreamFlag ?
+            static_cast<MsgStream*>(
+                pthread_getspecific(mThreadMsgStreamKey)) : 0;
+        if (theThreadStreamPtr) {
+            pthread_setspecific(mThreadMsgStreamKey, 0);
+            theThreadStreamPtr->Clear(inLogLevel, inDiscardFlag);
+            return *theThreadStreamPtr;
+        }
         QCStMutexLocker theLocker(mMutex);
 
         MsgStream* theRetPtr = mMsgStreamHeadPtr;
@@ -816,14 +842,22 @@ public:
     void PutStream(
         ostream& inStream)
     {
+        MsgStream& theStream = static_cast<MsgStream&>(inStream);
+        const bool theThreadStreamFlag = mUseThreadMsgStreamFlag &&
+            ! pthread_getspecific(mThreadMsgStreamKey);
+        if (theThreadStreamFlag && theStream.IsDiscard()) {
+            SetThreadMsgStream(theStream);
+            return;
+        }
         QCStMutexLocker theLocker(mMutex);
 
-        MsgStream& theStream = static_cast<MsgStream&>(inStream);
         if (! theStream.IsDiscard()) {
             AppendSelf(theStream.GetLogLevel(),
                 theStream.GetMsgPtr(), theStream.GetMsgLength());
         }
-        if (mMsgStreamCount < mMaxMsgStreamCount) {
+        if (theThreadStreamFlag) {
+            SetThreadMsgStream(theStream);
+        } else if (mMsgStreamCount < mMaxMsgStreamCount) {
             theStream.tie(0);
             theStream.Next() = mMsgStreamHeadPtr;
             mMsgStreamHeadPtr = &theStream;
@@ -973,6 +1007,9 @@ private:
     int          mMaxMsgStreamCount;
     int          mMsgStreamCount;
     MsgStream*   mMsgStreamHeadPtr;
+    pthread_key_t mThreadMsgStreamKey;
+    const bool    mThreadMsgStreamKeyFlag;
+    volatile bool mUseThreadMsgStreamFlag;
     char         mLogTimeStampPrefixStr[256];
 
     static inline Time Seconds(
@@ -983,6 +1020,17 @@ private:
         { return (inMicroSec * 1000); }
     bool IsFlushing() const
         { return (mWritePtr != 0); }
+    static void DeleteMsgStream(
+        void* inStreamPtr)
+        { delete static_cast<MsgStream*>(inStreamPtr); }
+    void SetThreadMsgStream(
+        MsgStream& inStream)
+    {
+        inStream.tie(0);
+        if (pthread_setspecific(mThreadMsgStreamKey, &inStream) != 0) {
+            delete &inStream;
+        }
+    }
     bool FlushSelf()
     {
         QCASSERT(mMutex.IsOwned());
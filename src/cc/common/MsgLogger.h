@@ -28,7 +28,9 @@
 #define COMMON_MSG_LOGGER_H
 
 #include "BufferedLogWriter.h"
+#include "kfsatomic.h"
 #include <string.h>
+#include <time.h>
 
 namespace KFS
 {
@@ -68,8 +70,67 @@ namespace KFS
             }
             return ret + 1;
         }
+        // Per log site message rate limiter, used by KFS_LOG_STREAM_SAMPLED.
+        // The limit is approximate: the window reset races with the
+        // concurrent increments, which can let a few extra messages through.
+        class RateLimiter
+        {
+        public:
+            RateLimiter(int maxPerSec)
+                : mMaxPerSec(maxPerSec < 1 ? 1 : maxPerSec),
+                  mSec(0),
+                  mCount(0),
+                  mSuppressedCount(0)
+                {}
+            bool Allow() {
+                const time_t now = time(0);
+                if (mSec != (int64_t)now) {
+                    mSec   = (int64_t)now;
+                    mCount = 0;
+                }
+                if (SyncAddAndFetch(mCount, 1) <= mMaxPerSec) {
+                    return true;
+                }
+                SyncAddAndFetch(mSuppressedCount, int64_t(1));
+                return false;
+            }
+            // Returns and resets the number of suppressed messages.
+            int64_t TakeSuppressedCount() {
+                const int64_t count = mSuppressedCount;
+                if (count != 0) {
+                    SyncAddAndFetch(mSuppressedCount, -count);
+                }
+                return count;
+            }
+        private:
+            const int        mMaxPerSec;
+            volatile int64_t mSec;
+            volatile int     mCount;
+            volatile int64_t mSuppressedCount;
+        };
+        class Suppressed
+        {
+        public:
+            Suppressed(RateLimiter& limiter)
+                : mCount(limiter.TakeSuppressedCount())
+                {}
+            ostream& Display(ostream& os) const {
+                if (mCount <= 0) {
+                    return os;
+                }
+                return (os << "[suppressed: " << mCount << "] ");
+            }
+        private:
+            const int64_t mCount;
+        };
     };
 
+    inline ostream& operator<<(
+        ostream&                     os,
+        const MsgLogger::Suppressed& suppressed) {
+        return suppressed.Display(os);
+    }
+
 // The following if prevents arguments evaluation (and possible side effect).
 // The following supports all
 // std stream manipulators, has lower # of allocations, and free of possible
@@ -94,6 +155,24 @@ namespace KFS
 #   define KFS_LOG_STREAM(logLevel) \
         KFS_LOG_STREAM_START(logLevel, _msgStream_015351104260035312)
 #endif
+
+// Logs at most the specified number of messages per second from the log site,
+// and prefixes the next logged message with the number of messages dropped.
+// Intended for the hot path messages that are useful to keep enabled in
+// production, but would otherwise flood the log under load. The insertion has
+// to be terminated with KFS_LOG_EOM, the same as with KFS_LOG_STREAM.
+#ifndef KFS_LOG_STREAM_SAMPLED
+#   define KFS_LOG_STREAM_SAMPLED(logLevel, maxPerSec) \
+    if (MsgLogger::GetLogger() && \
+            MsgLogger::GetLogger()->IsLogLevelEnabled(logLevel)) {\
+        static MsgLogger::RateLimiter _msgRateLimiter_015351104260035312( \
+            maxPerSec); \
+        if (_msgRateLimiter_015351104260035312.Allow()) \
+            MsgLogger::StStream( \
+                *MsgLogger::GetLogger(), logLevel).GetStream() << "(" << \
+            MsgLogger::SourceFileName(__FILE__) << ":" << __LINE__ << ") " << \
+            MsgLogger::Suppressed(_msgRateLimiter_015351104260035312)
+#endif
 #ifndef KFS_LOG_EOM
 #   define KFS_LOG_EOM \
         std::flush; \
@@ -118,6 +197,14 @@ namespace KFS
 #ifndef KFS_LOG_STREAM_FATAL
 #   define KFS_LOG_STREAM_FATAL KFS_LOG_STREAM(MsgLogger::kLogLevelFATAL)
 #endif
+#ifndef KFS_LOG_STREAM_DEBUG_SAMPLED
+#   define KFS_LOG_STREAM_DEBUG_SAMPLED(maxPerSec) \
+        KFS_LOG_STREAM_SAMPLED(MsgLogger::kLogLevelDEBUG, maxPerSec)
+#endif
+#ifndef KFS_LOG_STREAM_INFO_SAMPLED
+#   define KFS_LOG_STREAM_INFO_SAMPLED(maxPerSec) \
+        KFS_LOG_STREAM_SAMPLED(MsgLogger::kLogLevelINFO, maxPerSec)
+#endif
 
 } // namespace KFS
 
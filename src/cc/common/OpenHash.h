@@ -0,0 +1,414 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/14
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// Open addressing hash table implementation with incremental resize. The items
+// are stored in place in the slot array, with linear probing, and one byte
+// per slot control array, that holds 7 bits of the item's hash. The control
+// array is scanned first, the key comparison is performed only when the hash
+// bits match, thus lookup cost is typically 1 to 2 dram cache misses, and
+// there is no per item memory allocation or pointer overhead.
+// Like with LinearHash, the low hash bits select the slot, therefore a "good"
+// hash is assumed. With IntegerHash the sequential keys, like chunk ids, are
+// placed into adjacent slots.
+//
+// The table doubles in size when the load factor exceeds 3/4. The resize is
+// incremental: the new table is allocated, and each subsequent insert and
+// erase moves a few items from the old table into the new one. Lookups probe
+// both tables while resize is in progress. The resize, therefore, never
+// re-hashes the entire table at once, and does not stall the event loop.
+// The erase uses backward shift, with no "tombstones", except in the old table
+// while resize is in progress. The table does not shrink, except by Clear().
+//
+// Unlike LinearHash, the item addresses are not stable: insert and erase
+// might move items, and invalidate the pointers returned by Find(), Insert(),
+// and Next(), as well as the First() / Next() cursor. The table, thus, is not
+// a substitute for LinearHash where the items are referenced by pointers, for
+// example in intrusive lists, like CSMap entries.
+//
+//----------------------------------------------------------------------------
+
+#ifndef OPEN_HASH_H
+#define OPEN_HASH_H
+
+#include "LinearHash.h"
+
+#include <cstddef>
+#include <memory>
+#include <algorithm>
+
+namespace KFS
+{
+
+template<
+  typename KVPairT,
+  typename KeyIdT = KeyCompare<typename KVPairT::Key>,
+  typename AllocT = std::allocator<KVPairT>
+>
+class OpenHash
+{
+public:
+    typedef typename KVPairT::Key Key;
+    typedef typename KVPairT::Val Val;
+    typedef std::size_t           size_t;
+
+    OpenHash(
+        size_t inMigrateStepCount = 16)
+        : mCur(),
+          mOld(),
+          mMigrateIdx(0),
+          mMigrateStepCount(std::max(size_t(2), inMigrateStepCount)),
+          mNextIdx(0),
+          mNextOldFlag(false),
+          mKeyId(),
+          mAlloc()
+        {}
+    OpenHash(
+        const OpenHash& inHash)
+        : mCur(),
+          mOld(),
+          mMigrateIdx(0),
+          mMigrateStepCount(inHash.mMigrateStepCount),
+          mNextIdx(0),
+          mNextOldFlag(false),
+          mKeyId(),
+          mAlloc()
+        { *this = inHash; }
+    ~OpenHash()
+        { OpenHash::Clear(); }
+    OpenHash& operator=(
+        const OpenHash& inHash)
+    {
+        if (this == &inHash) {
+            return *this;
+        }
+        Clear();
+        const Table* const theTables[] = { &inHash.mOld, &inHash.mCur };
+        for (size_t t = 0; t < sizeof(theTables) / sizeof(theTables[0]); t++) {
+            const Table& theTable = *theTables[t];
+            for (size_t i = 0; i < theTable.mCapacity; i++) {
+                if (IsOccupied(theTable.mCtrlPtr[i])) {
+                    bool theInsertedFlag;
+                    Insert(theTable.mSlotsPtr[i].GetKey(),
+                        theTable.mSlotsPtr[i].GetVal(), theInsertedFlag);
+                }
+            }
+        }
+        return *this;
+    }
+    size_t GetSize() const
+        { return (mCur.mCount + mOld.mCount); }
+    bool IsEmpty() const
+        { return (GetSize() <= 0); }
+    // Returns number of slots allocated, including the old table slots
+    // while resize is in progress.
+    size_t GetCapacity() const
+        { return (mCur.mCapacity + mOld.mCapacity); }
+    bool IsResizeInProgress() const
+        { return (mOld.mCapacity > 0); }
+    void Clear()
+    {
+        Free(mOld);
+        Free(mCur);
+        mMigrateIdx  = 0;
+        mNextIdx     = 0;
+        mNextOldFlag = false;
+    }
+    Val* Find(
+        const Key& inKey) const
+    {
+        KVPairT* const thePtr = FindSelf(inKey);
+        return (thePtr ? &thePtr->GetVal() : 0);
+    }
+    Val* Insert(
+        const Key& inKey,
+        const Val& inVal,
+        bool&      outInsertedFlag)
+    {
+        Migrate(mMigrateStepCount);
+        KVPairT* const thePtr = FindSelf(inKey);
+        if (thePtr) {
+            outInsertedFlag = false;
+            return &thePtr->GetVal();
+        }
+        if ((mCur.mCount + 1) * 4 > mCur.mCapacity * 3) {
+            Grow();
+        }
+        outInsertedFlag = true;
+        return &(InsertNew(mCur, KVPairT(inKey, inVal))->GetVal());
+    }
+    size_t Erase(
+        const Key& inKey)
+    {
+        Migrate(mMigrateStepCount);
+        const size_t   theHash = mKeyId.Hash(inKey);
+        size_t         theIdx  = FindSlot(mCur, inKey, theHash);
+        if (theIdx < mCur.mCapacity) {
+            EraseShift(mCur, theIdx);
+            return 1;
+        }
+        theIdx = FindSlot(mOld, inKey, theHash);
+        if (theIdx < mOld.mCapacity) {
+            EraseOld(theIdx);
+            return 1;
+        }
+        return 0;
+    }
+    void First()
+    {
+        mNextIdx     = 0;
+        mNextOldFlag = true;
+    }
+    const KVPairT* Next()
+    {
+        if (mNextOldFlag) {
+            for (; mNextIdx < mOld.mCapacity; mNextIdx++) {
+                if (IsOccupied(mOld.mCtrlPtr[mNextIdx])) {
+                    return &mOld.mSlotsPtr[mNextIdx++];
+                }
+            }
+            mNextOldFlag = false;
+            mNextIdx     = 0;
+        }
+        for (; mNextIdx < mCur.mCapacity; mNextIdx++) {
+            if (IsOccupied(mCur.mCtrlPtr[mNextIdx])) {
+                return &mCur.mSlotsPtr[mNextIdx++];
+            }
+        }
+        return 0;
+    }
+    void Swap(
+        OpenHash& inHash)
+    {
+        if (this == &inHash) {
+            return;
+        }
+        std::swap(mCur,              inHash.mCur);
+        std::swap(mOld,              inHash.mOld);
+        std::swap(mMigrateIdx,       inHash.mMigrateIdx);
+        std::swap(mMigrateStepCount, inHash.mMigrateStepCount);
+        std::swap(mNextIdx,          inHash.mNextIdx);
+        std::swap(mNextOldFlag,      inHash.mNextOldFlag);
+        std::swap(mKeyId,            inHash.mKeyId);
+        std::swap(mAlloc,            inHash.mAlloc);
+    }
+
+private:
+    typedef unsigned char Ctrl;
+    enum
+    {
+        kCtrlEmpty    = 0,
+        kCtrlDeleted  = 1,   // Used only in the old table.
+        kCtrlUsedBit  = 0x80,
+        kMinCapacity  = 8
+    };
+    struct Table
+    {
+        Table()
+            : mCtrlPtr(0),
+              mSlotsPtr(0),
+              mCapacity(0),
+              mShift(0),
+              mCount(0)
+            {}
+        Ctrl*    mCtrlPtr;
+        KVPairT* mSlotsPtr;
+        size_t   mCapacity; // Power of 2.
+        int      mShift;    // log2(mCapacity)
+        size_t   mCount;
+    };
+
+    Table  mCur;
+    Table  mOld;              // Table being migrated into mCur.
+    size_t mMigrateIdx;       // Next old table slot to migrate.
+    size_t mMigrateStepCount; // Old table slots to migrate per update.
+    size_t mNextIdx;          // Cursor.
+    bool   mNextOldFlag;      // Cursor.
+    KeyIdT mKeyId;
+    AllocT mAlloc;
+
+    static bool IsOccupied(
+        Ctrl inCtrl)
+        { return ((inCtrl & kCtrlUsedBit) != 0); }
+    static size_t Index(
+        const Table& inTable,
+        size_t       inHash)
+        { return (inHash & (inTable.mCapacity - 1)); }
+    static Ctrl HashCtrl(
+        const Table& inTable,
+        size_t       inHash)
+    {
+        // Use the hash bits above the index bits, if any.
+        return (Ctrl)(kCtrlUsedBit |
+            ((inHash >> inTable.mShift) & (kCtrlUsedBit - 1)));
+    }
+    size_t FindSlot(
+        const Table& inTable,
+        const Key&   inKey,
+        size_t       inHash) const
+    {
+        if (inTable.mCount <= 0) {
+            return inTable.mCapacity;
+        }
+        // The table always has at least one empty slot, as the load factor
+        // is less than 1, and the deleted slots are only in the old table.
+        const Ctrl   theCtrl = HashCtrl(inTable, inHash);
+        const size_t theMask = inTable.mCapacity - 1;
+        for (size_t i = Index(inTable, inHash); ; i = (i + 1) & theMask) {
+            const Ctrl theCur = inTable.mCtrlPtr[i];
+            if (theCur == kCtrlEmpty) {
+                break;
+            }
+            if (theCur == theCtrl &&
+                    mKeyId.Equals(inKey, inTable.mSlotsPtr[i].GetKey())) {
+                return i;
+            }
+        }
+        return inTable.mCapacity;
+    }
+    KVPairT* FindSelf(
+        const Key& inKey) const
+    {
+        const size_t   theHash = mKeyId.Hash(inKey);
+        size_t         theIdx  = FindSlot(mCur, inKey, theHash);
+        if (theIdx < mCur.mCapacity) {
+            return (mCur.mSlotsPtr + theIdx);
+        }
+        theIdx = FindSlot(mOld, inKey, theHash);
+        return (theIdx < mOld.mCapacity ? mOld.mSlotsPtr + theIdx : 0);
+    }
+    KVPairT* InsertNew(
+        Table&         inTable,
+        const KVPairT& inKVPair)
+    {
+        const size_t   theHash = mKeyId.Hash(inKVPair.GetKey());
+        const size_t   theMask = inTable.mCapacity - 1;
+        size_t         i       = Index(inTable, theHash);
+        while (IsOccupied(inTable.mCtrlPtr[i])) {
+            i = (i + 1) & theMask;
+        }
+        KVPairT* const thePtr = inTable.mSlotsPtr + i;
+        mAlloc.construct(thePtr, inKVPair);
+        inTable.mCtrlPtr[i] = HashCtrl(inTable, theHash);
+        inTable.mCount++;
+        return thePtr;
+    }
+    void EraseShift(
+        Table& inTable,
+        size_t inIdx)
+    {
+        const size_t theMask = inTable.mCapacity - 1;
+        size_t       theHole = inIdx;
+        mAlloc.destroy(inTable.mSlotsPtr + theHole);
+        // Move back the items that follow in the probe sequence, and whose
+        // "home" slot is not between the hole and the item's slot.
+        for (size_t i = (theHole + 1) & theMask;
+                inTable.mCtrlPtr[i] != kCtrlEmpty;
+                i = (i + 1) & theMask) {
+            KVPairT& theCur  = inTable.mSlotsPtr[i];
+            const size_t theHome = Index(inTable,
+                mKeyId.Hash(theCur.GetKey()));
+            if (((i - theHome) & theMask) < ((i - theHole) & theMask)) {
+                continue;
+            }
+            mAlloc.construct(inTable.mSlotsPtr + theHole, theCur);
+            mAlloc.destroy(&theCur);
+            inTable.mCtrlPtr[theHole] = inTable.mCtrlPtr[i];
+            theHole = i;
+        }
+        inTable.mCtrlPtr[theHole] = kCtrlEmpty;
+        inTable.mCount--;
+    }
+    void EraseOld(
+        size_t inIdx)
+    {
+        // Keep probe sequences of the remaining old table items intact.
+        mAlloc.destroy(mOld.mSlotsPtr + inIdx);
+        mOld.mCtrlPtr[inIdx] = kCtrlDeleted;
+        mOld.mCount--;
+        if (mOld.mCount <= 0) {
+            Free(mOld);
+        }
+    }
+    void Migrate(
+        size_t inSlotCount)
+    {
+        for (size_t i = 0; i < inSlotCount && 0 < mOld.mCount; i++) {
+            if (mOld.mCapacity <= mMigrateIdx) {
+                break;
+            }
+            const size_t theIdx = mMigrateIdx++;
+            if (IsOccupied(mOld.mCtrlPtr[theIdx])) {
+                InsertNew(mCur, mOld.mSlotsPtr[theIdx]);
+                EraseOld(theIdx);
+            }
+        }
+        if (0 < mOld.mCapacity && mOld.mCount <= 0) {
+            Free(mOld);
+        }
+    }
+    void Grow()
+    {
+        if (0 < mOld.mCapacity) {
+            // Should not normally happen, as the new table is twice the
+            // size, and the items are migrated with each insert.
+            Migrate(mOld.mCapacity);
+        }
+        Table        theTable;
+        const size_t theCapacity = mCur.mCapacity <= 0 ?
+            size_t(kMinCapacity) : mCur.mCapacity * 2;
+        theTable.mCapacity = theCapacity;
+        theTable.mShift    = 0;
+        for (size_t i = theCapacity; 1 < i; i >>= 1) {
+            theTable.mShift++;
+        }
+        theTable.mCtrlPtr  = new Ctrl[theCapacity];
+        std::fill(theTable.mCtrlPtr, theTable.mCtrlPtr + theCapacity,
+            Ctrl(kCtrlEmpty));
+        theTable.mSlotsPtr = mAlloc.allocate(theCapacity);
+        if (0 < mCur.mCount) {
+            mOld        = mCur;
+            mMigrateIdx = 0;
+        } else {
+            Free(mCur);
+        }
+        mCur = theTable;
+    }
+    void Free(
+        Table& inTable)
+    {
+        if (inTable.mCapacity <= 0) {
+            return;
+        }
+        for (size_t i = 0; 0 < inTable.mCount && i < inTable.mCapacity; i++) {
+            if (IsOccupied(inTable.mCtrlPtr[i])) {
+                mAlloc.destroy(inTable.mSlotsPtr + i);
+                inTable.mCount--;
+            }
+        }
+        delete [] inTable.mCtrlPtr;
+        mAlloc.deallocate(inTable.mSlotsPtr, inTable.mCapacity);
+        inTable = Table();
+    }
+};
+
+}
+
+#endif /* OPEN_HASH_H */
@@ -116,6 +116,16 @@ public:
         { setValue(String(key), value); }
     void setValue(const String& key, const String& value)
         { propmap[key] = value; }
+    // Constant time insert if the key is greater than all existing keys,
+    // in order to build properties from the sorted key value pairs.
+    void appendValue(const String& key, const String& value)
+    {
+        if (propmap.empty() || propmap.rbegin()->first < key) {
+            propmap.insert(propmap.end(), std::make_pair(key, value));
+        } else {
+            propmap[key] = value;
+        }
+    }
     void getList(string &outBuf, const string& linePrefix,
         const string& lineSuffix = string("\n")) const;
     bool remove(const String& key);
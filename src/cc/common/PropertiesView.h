@@ -0,0 +1,209 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/14
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Read only key: value properties view of the parsed buffer.
+//
+//----------------------------------------------------------------------------
+
+#ifndef COMMON_PROPERTIES_VIEW_H
+#define COMMON_PROPERTIES_VIEW_H
+
+#include "RequestParser.h"
+#include "Properties.h"
+
+#include <stdint.h>
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+namespace KFS
+{
+using std::vector;
+
+// Flat vector of the key value tokens, sorted by key, that reference the
+// parsed buffer, with no per key and value allocation and copy. The integer
+// values are converted on the first access and cached. Intended to be
+// used instead of Properties on the hot rfc822 style header parsing paths,
+// where the header is parsed once and then a number of the fields is
+// looked up.
+// The parsed buffer must remain valid and unchanged while the view is in use.
+// Like with Properties, the last key occurrence wins.
+class PropertiesView
+{
+public:
+    typedef PropertiesTokenizer::Token Token;
+
+    PropertiesView()
+        : mEntries()
+        {}
+    void Load(
+        const char* inPtr,
+        size_t      inLen,
+        int         inSeparator = PropertiesTokenizer::kSeparator)
+    {
+        mEntries.clear();
+        PropertiesTokenizer theTokenizer(inPtr, inLen);
+        while (theTokenizer.Next(inSeparator)) {
+            mEntries.push_back(
+                Entry(theTokenizer.GetKey(), theTokenizer.GetValue()));
+        }
+        std::stable_sort(mEntries.begin(), mEntries.end());
+        // Remove duplicate keys, keep the last value.
+        Entries::iterator theDstIt = mEntries.begin();
+        for (Entries::iterator theIt = mEntries.begin();
+                theIt != mEntries.end();
+                ++theIt) {
+            if (theDstIt != mEntries.begin() &&
+                    theIt->mKey == (theDstIt - 1)->mKey) {
+                *(theDstIt - 1) = *theIt;
+            } else {
+                if (theDstIt != theIt) {
+                    *theDstIt = *theIt;
+                }
+                ++theDstIt;
+            }
+        }
+        mEntries.erase(theDstIt, mEntries.end());
+    }
+    void Clear()
+        { mEntries.clear(); }
+    bool IsEmpty() const
+        { return mEntries.empty(); }
+    size_t GetSize() const
+        { return mEntries.size(); }
+    const Token* GetValue(
+        const Token& inKey) const
+    {
+        const Entry* const theEntryPtr = Find(inKey);
+        return (theEntryPtr ? &theEntryPtr->mValue : 0);
+    }
+    template<typename T>
+    T GetValue(
+        const Token& inKey,
+        const T&     inDefault) const
+    {
+        const Entry* const theEntryPtr = Find(inKey);
+        if (! theEntryPtr) {
+            return inDefault;
+        }
+        T theRet;
+        ValueParser::SetValue(theEntryPtr->mValue.mPtr,
+            theEntryPtr->mValue.mLen, inDefault, theRet);
+        return theRet;
+    }
+    int GetValue(
+        const Token& inKey,
+        int          inDefault) const
+        { return GetIntValue(inKey, inDefault); }
+    long GetValue(
+        const Token& inKey,
+        long         inDefault) const
+        { return GetIntValue(inKey, inDefault); }
+    long long GetValue(
+        const Token& inKey,
+        long long    inDefault) const
+        { return GetIntValue(inKey, inDefault); }
+    // Copy into properties. The keys are inserted in order, therefore the
+    // copy into empty properties is linear.
+    void CopyTo(
+        Properties& outProps) const
+    {
+        for (Entries::const_iterator theIt = mEntries.begin();
+                theIt != mEntries.end();
+                ++theIt) {
+            outProps.appendValue(
+                Properties::String(theIt->mKey.mPtr, theIt->mKey.mLen),
+                Properties::String(theIt->mValue.mPtr, theIt->mValue.mLen)
+            );
+        }
+    }
+private:
+    struct Entry
+    {
+        enum IntState
+        {
+            kIntNone    = 0,
+            kIntValid   = 1,
+            kIntInvalid = 2
+        };
+        Entry(
+            const Token& inKey,
+            const Token& inValue)
+            : mKey(inKey),
+              mValue(inValue),
+              mIntValue(0),
+              mIntState(kIntNone)
+            {}
+        bool operator<(
+            const Entry& inRhs) const
+            { return (mKey < inRhs.mKey); }
+        Token            mKey;
+        Token            mValue;
+        mutable int64_t  mIntValue;
+        mutable IntState mIntState;
+    };
+    typedef vector<Entry> Entries;
+
+    Entries mEntries;
+
+    const Entry* Find(
+        const Token& inKey) const
+    {
+        Entries::const_iterator const theIt = std::lower_bound(
+            mEntries.begin(), mEntries.end(), Entry(inKey, Token()));
+        return ((theIt != mEntries.end() && theIt->mKey == inKey) ?
+            &*theIt : 0);
+    }
+    template<typename T>
+    T GetIntValue(
+        const Token& inKey,
+        T            inDefault) const
+    {
+        const Entry* const theEntryPtr = Find(inKey);
+        if (! theEntryPtr) {
+            return inDefault;
+        }
+        if (theEntryPtr->mIntState == Entry::kIntNone) {
+            const char* thePtr = theEntryPtr->mValue.mPtr;
+            theEntryPtr->mIntState = DecIntParser::Parse(
+                    thePtr, theEntryPtr->mValue.mLen,
+                    theEntryPtr->mIntValue) ?
+                Entry::kIntValid : Entry::kIntInvalid;
+        }
+        if (theEntryPtr->mIntState != Entry::kIntValid) {
+            return inDefault;
+        }
+        // Saturate, the same way as the integer parser does on overflow.
+        const int64_t theVal = theEntryPtr->mIntValue;
+        if (theVal < (int64_t)std::numeric_limits<T>::min()) {
+            return std::numeric_limits<T>::min();
+        }
+        if ((int64_t)std::numeric_limits<T>::max() < theVal) {
+            return std::numeric_limits<T>::max();
+        }
+        return (T)theVal;
+    }
+};
+
+}
+
+#endif // COMMON_PROPERTIES_VIEW_H
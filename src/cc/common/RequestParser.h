@@ -28,6 +28,7 @@
 #define REQUEST_PARSER_H
 
 #include <map>
+#include <vector>
 #include <utility>
 #include <string>
 #include <algorithm>
@@ -50,6 +51,8 @@ using std::min;
 using std::make_pair;
 using std::map;
 using std::less;
+using std::vector;
+using std::pair;
 
 // Multiple inheritance below used only to enforce construction order.
 class BufferInputStream :
@@ -517,6 +520,112 @@ private:
     const bool        mIgnoreMalformedFlag;
 };
 
+// Open addressing hash table with static set of keys. The table is built once
+// when parser definition is complete, and used for header and request name
+// lookups on request parsing path, instead of map, in order to avoid string
+// compares and pointer chasing per level of the tree.
+// As the set of keys is static, the build grows the table, up to about
+// kMaxSizeFactor times the number of keys, until the hash becomes perfect,
+// i.e. every key is at its hash position. The lookup then is a single hash
+// computation and at most one key compare, with no probing.
+template <typename T>
+class TokenLookupTable
+{
+public:
+    typedef PropertiesTokenizer::Token Token;
+
+    TokenLookupTable()
+        : mTable(),
+          mMask(0),
+          mPerfectFlag(false)
+        {}
+    template <typename IT>
+    void Build(
+        IT     inBeginIt,
+        IT     inEndIt,
+        size_t inCount)
+    {
+        size_t theMinSize = 4;
+        while (theMinSize < 2 * inCount) {
+            theMinSize <<= 1;
+        }
+        size_t theSize = theMinSize;
+        while (! (mPerfectFlag = BuildTable(inBeginIt, inEndIt, theSize))) {
+            if (kMaxSizeFactor * theMinSize / 2 <= theSize) {
+                // No perfect hash within the size limit, use the smallest
+                // table with linear probing.
+                BuildTable(inBeginIt, inEndIt, theMinSize);
+                break;
+            }
+            theSize <<= 1;
+        }
+    }
+    T Find(
+        const Token& inKey) const
+    {
+        if (mTable.empty()) {
+            return T();
+        }
+        for (size_t thePos = Hash(inKey) & mMask; ;
+                thePos = (thePos + 1) & mMask) {
+            const Entry& theEntry = mTable[thePos];
+            if (! theEntry.second) {
+                return T();
+            }
+            if (theEntry.first == inKey) {
+                return theEntry.second;
+            }
+            if (mPerfectFlag) {
+                return T();
+            }
+        }
+    }
+private:
+    typedef pair<Token, T> Entry;
+    typedef vector<Entry>  Table;
+    enum { kMaxSizeFactor = 16 };
+
+    Table  mTable;
+    size_t mMask;
+    bool   mPerfectFlag;
+
+    // Returns true if all keys are at their hash positions.
+    template <typename IT>
+    bool BuildTable(
+        IT     inBeginIt,
+        IT     inEndIt,
+        size_t inSize)
+    {
+        mTable.assign(inSize, Entry(Token(), T()));
+        mMask = inSize - 1;
+        bool thePerfectFlag = true;
+        for (IT theIt = inBeginIt; theIt != inEndIt; ++theIt) {
+            size_t thePos = Hash(theIt->first) & mMask;
+            while (mTable[thePos].second) {
+                thePos = (thePos + 1) & mMask;
+                thePerfectFlag = false;
+            }
+            mTable[thePos] = Entry(theIt->first, theIt->second);
+        }
+        return thePerfectFlag;
+    }
+
+    static size_t Hash(
+        const Token& inKey)
+    {
+        // FNV-1a
+        size_t theHash = 2166136261u;
+        for (const char* thePtr = inKey.mPtr, * const theEndPtr =
+                    thePtr + inKey.mLen;
+                thePtr < theEndPtr;
+                ++thePtr) {
+            theHash ^= (size_t)(*thePtr & 0xFF);
+            theHash *= 16777619u;
+        }
+        return (theHash ^ (theHash >> 16));
+    }
+};
+
 // Create parser for object fields, and invoke appropriate parsers based on the
 // request header names.
 template <typename OBJ, typename VALUE_PARSER=ValueParser>
@@ -532,7 +641,8 @@ public:
 
     ObjectParser()
         : mDefDoneFlag(false),
-          mFields()
+          mFields(),
+          mFieldsTable()
         {}
     virtual ~ObjectParser()
     {
@@ -559,6 +669,9 @@ public:
     }
     ObjectParser& DefDone()
     {
+        if (! mDefDoneFlag) {
+            mFieldsTable.Build(mFields.begin(), mFields.end(), mFields.size());
+        }
         mDefDoneFlag = true;
         return *this;
     }
@@ -569,17 +682,17 @@ public:
         OBJ*       inObjPtr) const
     {
         while (inTokenizer.Next()) {
-            const Token& theKey = inTokenizer.GetKey();
-            typename Fields::const_iterator const theIt = mFields.find(theKey);
-            if (theIt == mFields.end()) {
+            const Token&               theKey   = inTokenizer.GetKey();
+            const AbstractField* const theField = mFieldsTable.Find(theKey);
+            if (theField) {
+                theField->Set(inObjPtr, inTokenizer.GetValue());
+            } else {
                 const Token& theValue = inTokenizer.GetValue();
                 if (! inObjPtr->HandleUnknownField(
                         theKey.mPtr,    theKey.mLen,
                         theValue.mPtr, theValue.mLen)) {
                     break;
                 }
-            } else {
-                theIt->second->Set(inObjPtr, inTokenizer.GetValue());
             }
         }
     }
@@ -636,9 +749,11 @@ private:
     };
 
     typedef map<Key, AbstractField*, less<Key> > Fields;
+    typedef TokenLookupTable<const AbstractField*> FieldsTable;
 
-    bool   mDefDoneFlag;
-    Fields mFields;
+    bool        mDefDoneFlag;
+    Fields      mFields;
+    FieldsTable mFieldsTable;
 };
 
 template <typename ABSTRACT_OBJ>
@@ -730,6 +845,8 @@ public:
     typedef typename Parser::Checksum           Checksum;
 
     RequestHandler()
+        : mParsers(),
+          mParsersTable()
         {}
     ~RequestHandler()
         {}
@@ -750,9 +867,9 @@ public:
             thePtr++;
         }
         const size_t theNameLen = thePtr - theNamePtr;
-        typename Parsers::const_iterator const theIt =
-            mParsers.find(Name(theNamePtr, theNameLen));
-        if (theIt == mParsers.end()) {
+        const Parser* const theParserPtr =
+            mParsersTable.Find(Name(theNamePtr, theNameLen));
+        if (! theParserPtr) {
             return 0;
         }
         // Get optional header checksum.
@@ -767,7 +884,7 @@ public:
         while (thePtr < theEndPtr && IsWSpace(*thePtr)) {
             thePtr++;
         }
-        return theIt->second->Parse(
+        return theParserPtr->Parse(
             thePtr,
             theEndPtr - thePtr,
             theNamePtr,
@@ -793,6 +910,7 @@ public:
             // Duplicate name -- definition error.
             abort();
         }
+        mParsersTable.Build(mParsers.begin(), mParsers.end(), mParsers.size());
         return *this;
     }
     template <typename OBJ>
@@ -812,8 +930,10 @@ public:
 private:
     typedef PropertiesTokenizer::Token Name;
     typedef map<Name, const Parser*>   Parsers;
+    typedef TokenLookupTable<const Parser*> ParsersTable;
 
-    Parsers mParsers;
+    Parsers      mParsers;
+    ParsersTable mParsersTable;
 };
 
 }
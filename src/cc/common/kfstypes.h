@@ -110,7 +110,8 @@ const int EINVALCHUNKSIZE = 1007;
 
 #define KFS_FOR_EACH_EC_METHOD(f) \
     f(STRIPED_FILE_TYPE_RS) \
-    f(STRIPED_FILE_TYPE_RS_JERASURE)
+    f(STRIPED_FILE_TYPE_RS_JERASURE) \
+    f(STRIPED_FILE_TYPE_LRC_JERASURE)
 
 enum StripedFileType
 {
@@ -29,6 +29,56 @@
 #include <string.h>
 #include <inttypes.h>
 #include <stdlib.h>
+#include <sys/time.h>
+
+static double
+Now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return (tv.tv_sec + tv.tv_usec * 1e-6);
+}
+
+// Compare with zlib adler32 with random buffers, and report throughput.
+static int
+Benchmark(int count)
+{
+    static char buf[KFS::CHECKSUM_BLOCKSIZE];
+    srandom(1);
+    for (size_t i = 0; i < sizeof(buf); i++) {
+        buf[i] = (char)random();
+    }
+    for (int i = 0; i < 1000; i++) {
+        const size_t   len = random() % sizeof(buf);
+        const size_t   pos = random() % (sizeof(buf) - len + 1);
+        const uint32_t ck  = (uint32_t)random();
+        const uint32_t v1  = KFS::ComputeBlockChecksum(ck, buf + pos, len);
+        const uint32_t v2  = adler32(ck, (const Bytef*)(buf + pos), len);
+        if (v1 != v2) {
+            printf("mismatch: pos: %lu len: %lu %u %u\n",
+                (unsigned long)pos, (unsigned long)len,
+                (unsigned int)v1, (unsigned int)v2);
+            abort();
+        }
+    }
+    uint32_t res   = 0;
+    double   start = Now();
+    for (int i = 0; i < count; i++) {
+        res += KFS::ComputeBlockChecksum(buf, sizeof(buf));
+    }
+    const double kfsTime = Now() - start;
+    start = Now();
+    for (int i = 0; i < count; i++) {
+        res += adler32(KFS::kKfsNullChecksum, (const Bytef*)buf, sizeof(buf));
+    }
+    const double zlibTime = Now() - start;
+    const double mbytes   = (double)count * sizeof(buf) / (1 << 20);
+    printf("checksum: %.0f MB/s zlib adler32: %.0f MB/s %u\n",
+        mbytes / (kfsTime  > 0 ? kfsTime  : 1e-9),
+        mbytes / (zlibTime > 0 ? zlibTime : 1e-9),
+        (unsigned int)res);
+    return 0;
+}
 
 int main(int argc, char** argv)
 {
@@ -38,10 +88,16 @@ int main(int argc, char** argv)
                "       c: test adler32 combine.\n"
                "       n: don't pad with 0.\n"
                "       d: debug.\n"
-               "       The test reads input from STDIN ended by Ctrl+D.\n",
-               argv[0]);
+               "       The test reads input from STDIN ended by Ctrl+D.\n"
+               "       %s b [count]\n"
+               "       b: compare with zlib adler32, and measure"
+               " throughput of count 64KB blocks.\n",
+               argv[0], argv[0]);
         return 0;
     }
+    if (argc > 1 && ! strcmp(argv[1], "b")) {
+        return Benchmark(argc > 2 ? atoi(argv[2]) : 100000);
+    }
 
     static char   buf[KFS::CHECKSUM_BLOCKSIZE * 4];
     char*         p = buf;
@@ -0,0 +1,593 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/14
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Micro benchmarks of the io buffer, checksum, Reed-Solomon codec,
+// linear hash, timer wheel, request parser, response header formatting, and
+// io buffer pool. The results are written in JSON, one benchmark per line, in
+// fixed order, in order to make the output of different builds and releases
+// easy to compare.
+//
+//----------------------------------------------------------------------------
+
+#include "kfsio/IOBuffer.h"
+#include "kfsio/IOBufferWriter.h"
+#include "kfsio/checksum.h"
+#include "common/LinearHash.h"
+#include "common/StdAllocator.h"
+#include "common/TimerWheel.h"
+#include "common/RequestParser.h"
+#include "qcdio/QCDLList.h"
+#include "qcdio/QCIoBufferPool.h"
+#include "qcrs/rs.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace KFS;
+using std::vector;
+using std::ostream;
+
+static volatile uint64_t sSink = 0;
+
+static int64_t
+Nanoseconds()
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts)) {
+        return 0;
+    }
+    return (int64_t(ts.tv_sec) * 1000 * 1000 * 1000 + ts.tv_nsec);
+}
+
+static const int kIoSize = 64 << 10;
+
+static const char*
+IoData()
+{
+    static char* sBufPtr = 0;
+    if (! sBufPtr) {
+        sBufPtr = new char[kIoSize];
+        srandom(1);
+        for (int i = 0; i < kIoSize; i++) {
+            sBufPtr[i] = (char)random();
+        }
+    }
+    return sBufPtr;
+}
+
+static void
+IoBufferCopyIn(
+    int64_t inCount)
+{
+    const char* const theDataPtr = IoData();
+    IOBuffer          theBuf;
+    for (int64_t i = 0; i < inCount; i++) {
+        theBuf.CopyIn(theDataPtr, kIoSize);
+        theBuf.Clear();
+    }
+}
+
+// Copy shares the source buffers, therefore measures the buffer list
+// manipulation, not memory bandwidth.
+static void
+IoBufferCopy(
+    int64_t inCount)
+{
+    IOBuffer theSrc;
+    theSrc.CopyIn(IoData(), kIoSize);
+    IOBuffer theDst;
+    for (int64_t i = 0; i < inCount; i++) {
+        theDst.Copy(&theSrc, kIoSize);
+        theDst.Clear();
+    }
+}
+
+static void
+IoBufferMove(
+    int64_t inCount)
+{
+    IOBuffer theSrc;
+    theSrc.CopyIn(IoData(), kIoSize);
+    IOBuffer theDst;
+    for (int64_t i = 0; i < inCount; i++) {
+        theDst.Move(&theSrc, kIoSize);
+        theSrc.Move(&theDst, kIoSize);
+    }
+}
+
+static void
+IoBufferConsume(
+    int64_t inCount)
+{
+    const int kConsumeSize = 1 << 10;
+    IOBuffer  theSrc;
+    theSrc.CopyIn(IoData(), kIoSize);
+    IOBuffer  theBuf;
+    for (int64_t i = 0; i < inCount; i++) {
+        theBuf.Copy(&theSrc, kIoSize);
+        for (int k = 0; k < kIoSize; k += kConsumeSize) {
+            theBuf.Consume(kConsumeSize);
+        }
+    }
+}
+
+static void
+ChecksumBlock(
+    int64_t inCount)
+{
+    const char* const theDataPtr = IoData();
+    uint32_t          theRes     = 0;
+    for (int64_t i = 0; i < inCount; i++) {
+        theRes += ComputeBlockChecksum(theDataPtr, kIoSize);
+    }
+    sSink += theRes;
+}
+
+static void
+ChecksumIoBuffer(
+    int64_t inCount)
+{
+    IOBuffer theBuf;
+    theBuf.CopyIn(IoData(), kIoSize);
+    uint32_t theRes = 0;
+    for (int64_t i = 0; i < inCount; i++) {
+        theRes += ComputeChecksums(&theBuf, kIoSize).front();
+    }
+    sSink += theRes;
+}
+
+static const int kRsDataStripes     = 6;
+static const int kRsRecoveryStripes = RS_LIB_MAX_RECOVERY_BLOCKS;
+static const int kRsStripes         = kRsDataStripes + kRsRecoveryStripes;
+
+static void**
+RsStripes()
+{
+    static void* sStripes[kRsStripes] = { 0 };
+    if (! sStripes[0]) {
+        const char* const theDataPtr = IoData();
+        for (int i = 0; i < kRsStripes; i++) {
+            if (posix_memalign(sStripes + i, 16, kIoSize)) {
+                abort();
+            }
+            memcpy(sStripes[i], theDataPtr, kIoSize);
+            static_cast<char*>(sStripes[i])[0] = (char)i;
+        }
+        rs_encode(kRsStripes, kIoSize, sStripes);
+    }
+    return sStripes;
+}
+
+static void
+RsEncode(
+    int64_t inCount)
+{
+    void** const theStripesPtr = RsStripes();
+    for (int64_t i = 0; i < inCount; i++) {
+        rs_encode(kRsStripes, kIoSize, theStripesPtr);
+    }
+}
+
+// Worst case: recover 3 data stripes.
+static void
+RsDecode3(
+    int64_t inCount)
+{
+    void** const theStripesPtr = RsStripes();
+    for (int64_t i = 0; i < inCount; i++) {
+        rs_decode3(kRsStripes, kIoSize, 0, 1, 2, theStripesPtr);
+    }
+}
+
+typedef KVPair<int64_t, int64_t> HashEntry;
+typedef LinearHash<
+    HashEntry,
+    KeyCompare<HashEntry::Key>,
+    DynamicArray<SingleLinkedList<HashEntry>*, 22>,
+    StdFastAllocator<HashEntry>
+> Hash;
+static const int64_t kHashSize = int64_t(1) << 16;
+
+static inline int64_t
+HashKey(
+    int64_t inIdx)
+{
+    // Scatter the keys, as chunk and file ids are not assigned consecutively
+    // in the same table.
+    return (int64_t)((uint64_t)inIdx * 0x9E3779B97F4A7C15ULL);
+}
+
+// Each op inserts one entry and removes the oldest, keeping the table size
+// constant.
+static void
+HashInsertErase(
+    int64_t inCount)
+{
+    static Hash    sHash;
+    static int64_t sNext = 0;
+    bool           theInsertedFlag;
+    for (; sNext < kHashSize; sNext++) {
+        sHash.Insert(HashKey(sNext), sNext, theInsertedFlag);
+    }
+    for (int64_t i = 0; i < inCount; i++, sNext++) {
+        sHash.Insert(HashKey(sNext), sNext, theInsertedFlag);
+        sHash.Erase(HashKey(sNext - kHashSize));
+    }
+}
+
+static void
+HashFind(
+    int64_t inCount)
+{
+    static Hash sHash;
+    if (sHash.IsEmpty()) {
+        bool theInsertedFlag;
+        for (int64_t i = 0; i < kHashSize; i++) {
+            sHash.Insert(HashKey(i), i, theInsertedFlag);
+        }
+    }
+    int64_t theRes = 0;
+    for (int64_t i = 0; i < inCount; i++) {
+        const int64_t* const thePtr = sHash.Find(HashKey(i & (kHashSize - 1)));
+        theRes += thePtr ? *thePtr : 0;
+    }
+    sSink += theRes;
+}
+
+class TimerEntry
+{
+public:
+    typedef QCDLListOp<TimerEntry, 0> List;
+    TimerEntry()
+        { List::Init(*this); }
+private:
+    TimerEntry* mPrevPtr[1];
+    TimerEntry* mNextPtr[1];
+    friend class QCDLListOp<TimerEntry, 0>;
+};
+typedef TimerWheel<
+    TimerEntry,
+    TimerEntry::List,
+    int64_t,
+    256,
+    1
+> Timer;
+
+struct TimerExpire
+{
+    void operator()(
+        TimerEntry& inEntry)
+    {
+        TimerEntry::List::Remove(inEntry);
+        sSink++;
+    }
+};
+
+// Each op re-schedules one of the entries, and advances the time by one tick,
+// similarly to the lease timers.
+static void
+TimerWheelScheduleRun(
+    int64_t inCount)
+{
+    static const int64_t kEntries = 1 << 12;
+    static TimerEntry    sEntries[kEntries];
+    static int64_t       sNow = 0;
+    static Timer         sTimer(sNow);
+    TimerExpire          theExpire;
+    for (int64_t i = 0; i < inCount; i++) {
+        sTimer.Schedule(sEntries[i & (kEntries - 1)], sNow + 1 + (i * 7) % 200);
+        sTimer.Run(++sNow, theExpire);
+    }
+}
+
+class BenchRequest
+{
+public:
+    int64_t seq;
+    int     vers;
+    int64_t fid;
+    int64_t offset;
+    bool    append;
+    int64_t reserve;
+    int     maxAppenders;
+    StringBufT<64>  host;
+    StringBufT<256> path;
+
+    BenchRequest()
+        : seq(-1),
+          vers(-1),
+          fid(-1),
+          offset(-1),
+          append(false),
+          reserve(-1),
+          maxAppenders(64),
+          host(),
+          path()
+        {}
+    bool Validate() const
+        { return true; }
+    bool ValidateRequestHeader(
+        const char* /* name */,
+        size_t      /* nameLen */,
+        const char* /* header */,
+        size_t      /* headerLen */,
+        bool        /* hasChecksum */,
+        uint32_t    /* checksum */)
+        { return true; }
+    bool HandleUnknownField(
+        const char* /* key */, size_t /* keyLen */,
+        const char* /* val */, size_t /* valLen */)
+        { return true; }
+    template<typename T> static T& ParserDef(
+        T& inParser)
+    {
+        return inParser
+            .Def("Cseq",                    &BenchRequest::seq,     int64_t(-1))
+            .Def("Client-Protocol-Version", &BenchRequest::vers,    -1         )
+            .Def("Client-host",             &BenchRequest::host                )
+            .Def("Pathname",                &BenchRequest::path                )
+            .Def("File-handle",             &BenchRequest::fid,     int64_t(-1))
+            .Def("Chunk-offset",            &BenchRequest::offset,  int64_t(-1))
+            .Def("Chunk-append",            &BenchRequest::append,  false      )
+            .Def("Space-reserve",           &BenchRequest::reserve, int64_t(-1))
+            .Def("Max-appenders",           &BenchRequest::maxAppenders, 64    )
+        ;
+    }
+};
+
+typedef RequestHandler<BenchRequest> BenchReqHandler;
+static const BenchReqHandler&
+MakeBenchRequestHandler()
+{
+    static BenchReqHandler sHandler;
+    return sHandler
+        .MakeParser<BenchRequest>("ALLOCATE")
+    ;
+}
+
+static void
+RequestParse(
+    int64_t inCount)
+{
+    static const BenchReqHandler& sHandler = MakeBenchRequestHandler();
+    static const char kRequest[] =
+        "ALLOCATE\r\n"
+        "Cseq: 1234567\r\n"
+        "Version: KFS/1.0\r\n"
+        "Client-Protocol-Version: 114\r\n"
+        "Client-host: somehostname\r\n"
+        "Pathname: /sort/job/1/fanout/27/file.27\r\n"
+        "File-handle: 123456789\r\n"
+        "Chunk-offset: 0\r\n"
+        "Chunk-append: 1\r\n"
+        "Space-reserve: 0\r\n"
+        "Max-appenders: 640000000\r\n"
+        "\r\n";
+    int64_t theRes = 0;
+    for (int64_t i = 0; i < inCount; i++) {
+        BenchRequest* const theReqPtr =
+            sHandler.Handle(kRequest, sizeof(kRequest) - 1);
+        if (! theReqPtr) {
+            abort();
+        }
+        theRes += theReqPtr->fid;
+        delete theReqPtr;
+    }
+    sSink += theRes;
+}
+
+// One megabyte chunk server READ response header with 16 checksums, formatted
+// with ostream, and with IOBufferHeaderWriter, into io buffer.
+static const int kRespChecksumCount = 16;
+
+static void
+ResponseOstream(
+    int64_t inCount)
+{
+    IOBuffer           theBuf;
+    IOBuffer::WOStream theStream;
+    for (int64_t i = 0; i < inCount; i++) {
+        ostream& os = theStream.Set(theBuf);
+        os <<
+            "OK\r\n"
+            "Cseq: "             << (int64_t)(i + 1000000) << "\r\n"
+            "Status: "           << 0 << "\r\n"
+            "Checksum-entries: " << kRespChecksumCount << "\r\n"
+            "Checksums: "
+        ;
+        for (int k = 0; k < kRespChecksumCount; k++) {
+            os << (uint32_t)(i * 2654435761u + k) << ' ';
+        }
+        os << "\r\n"
+            "Content-length: " << (1 << 20) << "\r\n\r\n";
+        theStream.Reset();
+        sSink += theBuf.BytesConsumable();
+        theBuf.Clear();
+    }
+}
+
+static void
+ResponseWriter(
+    int64_t inCount)
+{
+    IOBuffer           theBuf;
+    IOBuffer::WOStream theStream;
+    for (int64_t i = 0; i < inCount; i++) {
+        IOBufferHeaderWriter theWriter(theStream.Set(theBuf));
+        theWriter.Write("OK\r\nCseq: ");
+        theWriter.WriteInt((int64_t)(i + 1000000));
+        theWriter.Write("\r\nStatus: ");
+        theWriter.WriteInt(0);
+        theWriter.Write("\r\nChecksum-entries: ");
+        theWriter.WriteInt(kRespChecksumCount);
+        theWriter.Write("\r\nChecksums: ");
+        for (int k = 0; k < kRespChecksumCount; k++) {
+            theWriter.WriteInt((uint32_t)(i * 2654435761u + k));
+            theWriter.Write(" ");
+        }
+        theWriter.Write("\r\nContent-length: ");
+        theWriter.WriteInt(1 << 20);
+        theWriter.Write("\r\n\r\n");
+        theWriter.Flush();
+        theStream.Reset();
+        sSink += theBuf.BytesConsumable();
+        theBuf.Clear();
+    }
+}
+
+// Each op gets and puts back a batch of buffers, similarly to the chunk
+// server disk io.
+static void
+IoBufferPoolGetPut(
+    int64_t inCount)
+{
+    static QCIoBufferPool sPool;
+    static const int      kBatch = 16;
+    if (sPool.GetTotalBufferCount() <= 0 &&
+            sPool.Create(1, 1024, 4 << 10, false) != 0) {
+        abort();
+    }
+    char* theBufs[kBatch];
+    for (int64_t i = 0; i < inCount; i++) {
+        for (int k = 0; k < kBatch; k++) {
+            if (! (theBufs[k] = sPool.Get())) {
+                abort();
+            }
+        }
+        for (int k = kBatch - 1; 0 <= k; k--) {
+            sPool.Put(theBufs[k]);
+        }
+    }
+}
+
+struct Benchmark
+{
+    const char* mName;
+    int64_t     mIterations;
+    int64_t     mBytesPerOp;
+    void      (*mRunPtr)(int64_t inCount);
+};
+
+static const Benchmark kBenchmarks[] = {
+    { "iobuffer.copyin",       20000,   kIoSize, &IoBufferCopyIn        },
+    { "iobuffer.copy",         500000,  0,       &IoBufferCopy          },
+    { "iobuffer.move",         500000,  0,       &IoBufferMove          },
+    { "iobuffer.consume",      200000,  0,       &IoBufferConsume       },
+    { "checksum.block",        20000,   kIoSize, &ChecksumBlock         },
+    { "checksum.iobuffer",     20000,   kIoSize, &ChecksumIoBuffer      },
+    { "rs.encode.6+3",         2000,
+        int64_t(kIoSize) * kRsDataStripes,       &RsEncode              },
+    { "rs.decode3.6+3",        2000,
+        int64_t(kIoSize) * kRsDataStripes,       &RsDecode3             },
+    { "linearhash.insert_erase", 2000000, 0,     &HashInsertErase       },
+    { "linearhash.find",       5000000, 0,       &HashFind              },
+    { "timerwheel.schedule_run", 5000000, 0,     &TimerWheelScheduleRun },
+    { "requestparser.parse",   500000,  0,       &RequestParse          },
+    { "response.ostream",      500000,  0,       &ResponseOstream       },
+    { "response.writer",       500000,  0,       &ResponseWriter        },
+    { "qciobufferpool.get_put", 500000, 0,       &IoBufferPoolGetPut    },
+};
+
+int
+main(int argc, char** argv)
+{
+    const char* theFilterPtr = 0;
+    double      theScale     = 1;
+    int         theRepCount  = 5;
+    bool        theListFlag  = false;
+    int         theOpt;
+    while ((theOpt = getopt(argc, argv, "f:s:r:lh")) != -1) {
+        switch (theOpt) {
+            case 'f': theFilterPtr = optarg;           break;
+            case 's': theScale     = atof(optarg);     break;
+            case 'r': theRepCount  = atoi(optarg);     break;
+            case 'l': theListFlag  = true;             break;
+            default:
+                printf("Usage: %s [-f name-substring] [-s iteration-scale]"
+                    " [-r repetitions] [-l]\n"
+                    " -f: run only benchmarks with names containing the"
+                    " substring\n"
+                    " -s: iteration count multiplier, default 1\n"
+                    " -r: number of timed repetitions, default 5\n"
+                    " -l: list benchmarks\n"
+                    "The median and the minimum time per op of the timed"
+                    " repetitions are reported in JSON.\n",
+                    argv[0]);
+                return (theOpt == 'h' ? 0 : 1);
+        }
+    }
+    if (theScale <= 0 || theRepCount <= 0) {
+        fprintf(stderr, "invalid scale or repetition count\n");
+        return 1;
+    }
+    const size_t theCount = sizeof(kBenchmarks) / sizeof(kBenchmarks[0]);
+    if (theListFlag) {
+        for (size_t i = 0; i < theCount; i++) {
+            printf("%s\n", kBenchmarks[i].mName);
+        }
+        return 0;
+    }
+    printf("{\"version\": 1, \"rs_encode_kernel\": \"%s\","
+        " \"repetitions\": %d, \"benchmarks\": [\n",
+        rs_get_encode_kernel(), theRepCount);
+    const char*     theSepPtr = "";
+    vector<int64_t> theTimes;
+    for (size_t i = 0; i < theCount; i++) {
+        const Benchmark& theBench = kBenchmarks[i];
+        if (theFilterPtr && ! strstr(theBench.mName, theFilterPtr)) {
+            continue;
+        }
+        const int64_t theIters = std::max(int64_t(1),
+            (int64_t)(theBench.mIterations * theScale));
+        // Warm up caches, and initialize the benchmark's state.
+        (*theBench.mRunPtr)(std::max(int64_t(1), theIters / 10));
+        theTimes.clear();
+        for (int k = 0; k < theRepCount; k++) {
+            const int64_t theStart = Nanoseconds();
+            (*theBench.mRunPtr)(theIters);
+            theTimes.push_back(Nanoseconds() - theStart);
+        }
+        std::sort(theTimes.begin(), theTimes.end());
+        const double theMedianNs = (double)theTimes[theTimes.size() / 2] /
+            theIters;
+        const double theMinNs    = (double)theTimes.front() / theIters;
+        printf("%s  {\"name\": \"%s\", \"iterations\": %lld,"
+            " \"ns_per_op\": %.2f, \"min_ns_per_op\": %.2f",
+            theSepPtr, theBench.mName, (long long)theIters,
+            theMedianNs, theMinNs);
+        if (0 < theBench.mBytesPerOp) {
+            printf(", \"mb_per_sec\": %.1f", theMedianNs <= 0 ? 0. :
+                theBench.mBytesPerOp * 1e9 / theMedianNs / (1 << 20));
+        }
+        printf("}");
+        fflush(stdout);
+        theSepPtr = ",\n";
+    }
+    printf("\n]}\n");
+    return 0;
+}
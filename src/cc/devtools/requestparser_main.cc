@@ -29,6 +29,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <unistd.h>
+#include <sys/time.h>
 
 using namespace KFS;
 
@@ -202,8 +203,21 @@ Max-appenders: 640000000\r
 /*
     To benchmark:
     ../src/test-scripts/allocatesend.pl 1e6 | ( time src/cc/devtools/requestparser_test q )
+    With "t" option the parse time, and requests per second are reported,
+    for example, to compare "q" and "qp" (properties parser):
+    ../src/test-scripts/allocatesend.pl 1e6 | src/cc/devtools/requestparser_test qt
 */
 
+static int64_t
+Microseconds()
+{
+    struct timeval tv;
+    if (gettimeofday(&tv, 0) < 0) {
+        return 0;
+    }
+    return (int64_t(tv.tv_sec) * 1000 * 1000 + tv.tv_usec);
+}
+
 typedef RequestHandler<AbstractTest> ReqHandler;
 static const ReqHandler& MakeRequestHandler()
 {
@@ -231,6 +245,9 @@ main(int argc, char** argv)
     const bool  noparse = argc > 1 && strchr(argv[1], 'n');
     const bool  alloc   = argc > 1 && strchr(argv[1], 'a');
     const bool  useprop = argc > 1 && strchr(argv[1], 'p');
+    const bool  timing  = argc > 1 && strchr(argv[1], 't');
+    int64_t     count   = 0;
+    int64_t     parseUs = 0;
 
     while ((nrd = read(0, ptr, end - ptr)) > 0) {
         end = ptr + nrd;
@@ -253,9 +270,14 @@ main(int argc, char** argv)
                 std::cout.write(ptr, re - ptr);
             }
             if (! noparse || alloc) {
+                const int64_t start = timing ? Microseconds() : 0;
                 AbstractTest* const tst = useprop ?
                     Test::Load(myis.Set(ptr, noparse ? 0 : re - ptr)) :
                     sReqHandler.Handle(ptr, noparse ? 0 : re - ptr);
+                if (timing) {
+                    parseUs += Microseconds() - start;
+                    count++;
+                }
                 if (tst) {
                     if (! quiet) {
                         std::cout << "Parsed request:\n";
@@ -273,5 +295,12 @@ main(int argc, char** argv)
         ptr = buf + (end - ptr);
         end = buf + sizeof(buf);
     }
+    if (timing) {
+        std::cerr << "requests: " << count <<
+            " parse time: " << parseUs * 1e-6 << " sec" <<
+            " requests/sec: " <<
+                (parseUs > 0 ? count * 1e6 / parseUs : 0.) <<
+        "\n";
+    }
     return 0;
 }
@@ -20,20 +20,24 @@
 // implied. See the License for the specific language governing
 // permissions and limitations under the License.
 //
-// \brief Sorted linear hash table unit and performance tests.
+// \brief Sorted linear hash table, and open addressing hash table unit and
+// performance tests.
 //
 //----------------------------------------------------------------------------
 
 #include "common/LinearHash.h"
+#include "common/OpenHash.h"
 #include "common/PoolAllocator.h"
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #include <iostream>
 #include <memory>
 #include <set>
+#include <string>
 
 #ifdef _USE_STD_DEQUE
 #include <deque>
@@ -127,6 +131,11 @@ typedef KFS::LinearHash<
     Allocator<MyKVPair>
 > MySLH;
 
+typedef KFS::OpenHash<
+    MyKVPair,
+    KFS::KeyCompare<MyKey>
+> MyOH;
+
 using namespace std;
 typedef set<MyKey> MySet;
 
@@ -136,8 +145,9 @@ TestFailed()
     abort();
 }
 
+template<typename HT>
 static void
-Verify(const MySet& set, MySLH& ht)
+Verify(const MySet& set, HT& ht)
 {
     if (set.size() != ht.GetSize()) {
         TestFailed();
@@ -156,14 +166,11 @@ Verify(const MySet& set, MySLH& ht)
     }
 }
 
-int
-main(int argc, char** argv)
+template<typename HT>
+static void
+Test(HT& ht, const char* name, int nk, bool waitFlag)
 {
-    if (argc <= 1 || (!strcmp(argv[1], "-h") || !strcmp(argv[1], "--help"))) {
-        return 0;
-    }
-
-    MySLH ht;
+    cout << name << "\n";
     bool inserted = false;
     // Unit test.
     if (! ht.Insert(500, 500, inserted) || ! inserted) {
@@ -235,7 +242,6 @@ main(int argc, char** argv)
     clock_t s = clock();
     int k = 0;
     inserted = false;
-    const int nk = argc > 1 ? (int)atof(argv[1]) : (1<<27) - (1<<16);
     for (MyKey i = 1000 * 1000 + 345; k < nk; i += 33, k++) {
         if (! ht.Insert(i, i, inserted) || ! inserted) {
             abort();
@@ -262,9 +268,11 @@ main(int argc, char** argv)
     }
     e = clock();
     cout << k << " " << double(e - s)/CLOCKS_PER_SEC << " " << t << "\n";
-    cout << "press any key and then enter to continue\n";
-    string str;
-    cin >> str;
+    if (waitFlag) {
+        cout << "press any key and then enter to continue\n";
+        string str;
+        cin >> str;
+    }
     s = clock();
     k = 0;
     for (MyKey i = 1000 * 1000 + 345; k < nk; i += 33, k++) {
@@ -277,5 +285,27 @@ main(int argc, char** argv)
     if (! ht.IsEmpty()) {
         abort();
     }
+}
+
+int
+main(int argc, char** argv)
+{
+    if (argc <= 1 || (!strcmp(argv[1], "-h") || !strcmp(argv[1], "--help"))) {
+        cout << "Usage: " << (argc > 0 ? argv[0] : "sortedhash") <<
+            " <count> [linear|open|all] [-n]\n"
+            " -n -- do not wait for input after inserts\n";
+        return 0;
+    }
+    const int    nk       = (int)atof(argv[1]);
+    const string type     = argc > 2 ? argv[2] : "linear";
+    const bool   waitFlag = argc <= 3 || strcmp(argv[3], "-n") != 0;
+    if (type == "linear" || type == "all") {
+        MySLH ht;
+        Test(ht, "linear hash", nk, waitFlag);
+    }
+    if (type == "open" || type == "all") {
+        MyOH ht;
+        Test(ht, "open hash", nk, waitFlag);
+    }
     return 0;
 }
@@ -42,7 +42,10 @@ ChunkServerEmulator::ChunkServerEmulator(
       ChunkServer(NetConnectionPtr(
         new NetConnection(this, this, false, false)), peerName),
       mPendingReqs(),
-      mOut(0)
+      mRemainingBytes(),
+      mOut(0),
+      mReplicationBytesIn(0),
+      mReplicationBytesOut(0)
 {
     SetServerLocation(loc);
     SetRack(rack);
@@ -62,23 +65,42 @@ void
 ChunkServerEmulator::EnqueueSelf(MetaChunkRequest* r)
 {
     mPendingReqs.push_back(r);
+    mRemainingBytes.push_back(r->op == META_CHUNK_REPLICATE ?
+        (double)gLayoutEmulator.GetChunkSize(r->chunkId) : 0.);
 }
 
 size_t
-ChunkServerEmulator::Dispatch()
+ChunkServerEmulator::Dispatch(double timeStep, double nodeBandwidth)
 {
+    const bool steppedFlag = 0 < timeStep && 0 < nodeBandwidth;
     // Use index instead of iterator in order handle correctly Enqueue()
     // while iterating though the queue (though this isn't needed at the
     // time of writing).
     size_t i;
+    size_t k = 0;
     for (i = 0; i < mPendingReqs.size(); i++) {
-        MetaRequest*      const r  = mPendingReqs[i];
+        MetaChunkRequest* const r  = mPendingReqs[i];
         MetaChunkRequest* const op = FindMatchingRequest(r->opSeqno);
         if (op != r) {
             panic("invalid request: not in the queue");
         }
         if (r->op == META_CHUNK_REPLICATE) {
             MetaChunkReplicate* const mcr = static_cast<MetaChunkReplicate*>(r);
+            if (steppedFlag && 0 < mRemainingBytes[i]) {
+                double rate = nodeBandwidth /
+                    max(1, GetNumChunkReplications());
+                if (mcr->srcLocation.IsValid() && mcr->dataServer) {
+                    rate = min(rate, nodeBandwidth /
+                        max(1, mcr->dataServer->GetReplicationReadLoad()));
+                }
+                const double rem = mRemainingBytes[i] - rate * timeStep;
+                if (0 < rem) {
+                    mPendingReqs[k]    = r;
+                    mRemainingBytes[k] = rem;
+                    k++;
+                    continue;
+                }
+            }
             if (gLayoutEmulator.ChunkReplicationDone(mcr)) {
                 KFS_LOG_STREAM_DEBUG <<
                     "moved chunk: " << mcr->chunkId <<
@@ -106,8 +128,9 @@ ChunkServerEmulator::Dispatch()
         }
         delete r;
     }
-    mPendingReqs.clear();
-    return i;
+    mPendingReqs.resize(k);
+    mRemainingBytes.resize(k);
+    return (i - k);
 }
 
 void
@@ -127,6 +150,7 @@ ChunkServerEmulator::FailPendingOps()
         delete r;
     }
     mPendingReqs.clear();
+    mRemainingBytes.clear();
 }
 
 } // namespace KFS
@@ -47,7 +47,23 @@ public:
         const ServerLocation& loc, int rack, const string& peerName);
     virtual ~ChunkServerEmulator();
 
-    size_t Dispatch();
+    // Returns number of completed requests. With positive time step,
+    // replications complete after the chunk data is transferred with the
+    // node bandwidth, shared with the other replications in flight to this
+    // node and from the source node.
+    size_t Dispatch(double timeStep = 0, double nodeBandwidth = 0);
+    size_t GetPendingCount() const
+        { return mPendingReqs.size(); }
+    size_t GetTransferCount() const
+    {
+        size_t count = 0;
+        for (size_t i = 0; i < mRemainingBytes.size(); i++) {
+            if (0 < mRemainingBytes[i]) {
+                count++;
+            }
+        }
+        return count;
+    }
     // when this emulated server goes down, fail the pending ops
     // that were destined to this node
     void FailPendingOps();
@@ -57,6 +73,18 @@ public:
         mUsedSpace += chunksize;
         mAllocSpace = mUsedSpace;
     }
+    void ReplicationDone(int64_t bytes, bool destinationFlag)
+    {
+        if (destinationFlag) {
+            mReplicationBytesIn += bytes;
+        } else {
+            mReplicationBytesOut += bytes;
+        }
+    }
+    int64_t GetReplicationBytesIn() const
+        { return mReplicationBytesIn; }
+    int64_t GetReplicationBytesOut() const
+        { return mReplicationBytesOut; }
     void SetRebalancePlanOutFd(ostream* os)
     {
         mOut = os;
@@ -84,8 +112,13 @@ protected:
 
 private:
     typedef vector<MetaChunkRequest*> PendingReqs;
-    PendingReqs mPendingReqs;
+    typedef vector<double>            RemainingBytes;
+    PendingReqs    mPendingReqs;
+    // Replication bytes remaining to transfer, parallel to mPendingReqs.
+    RemainingBytes mRemainingBytes;
     ostream*    mOut;
+    int64_t     mReplicationBytesIn;
+    int64_t     mReplicationBytesOut;
 private:
     ChunkServerEmulator(const ChunkServerEmulator&);
     ChunkServerEmulator& operator=(const ChunkServerEmulator&);
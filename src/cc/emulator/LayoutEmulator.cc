@@ -34,6 +34,9 @@
 #include "common/StBuffer.h"
 #include "meta/kfstree.h"
 #include "meta/util.h"
+#include "qcdio/QCThread.h"
+#include "qcdio/QCMutex.h"
+#include "qcdio/qcstutils.h"
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -41,6 +44,7 @@
 
 #include <algorithm>
 #include <cerrno>
+#include <cmath>
 #include <fstream>
 #include <boost/bind.hpp>
 
@@ -59,16 +63,243 @@ GetCSEmulator(ChunkServer& server)
     return static_cast<ChunkServerEmulator&>(server);
 }
 
+// Reads the chunk map files, or the chunk map shards, in batches of lines,
+// and parses the batches concurrently. Only adding the replicas to the
+// layout, which is not thread safe, is serialized.
+class LayoutEmulator::ChunkmapLoader
+{
+public:
+    ChunkmapLoader(
+        LayoutEmulator&       emulator,
+        const vector<string>& fileNames,
+        bool                  addChunksToReplicationChecker)
+        : mEmulator(emulator),
+          mFileNames(fileNames),
+          mFile(),
+          mFileIdx(0),
+          mAddChunksToReplicationCheckerFlag(addChunksToReplicationChecker),
+          mReadMutex(),
+          mAddMutex(),
+          mLineNo(1),
+          mStatus(0)
+        {}
+    int Run(int threadCount)
+    {
+        vector<Worker*> workers;
+        for (int i = 1; i < threadCount; i++) {
+            Worker* const worker = new Worker(*this);
+            const int     err    = worker->Start();
+            if (err != 0) {
+                KFS_LOG_STREAM_ERROR <<
+                    "failed to start chunk map load thread: " <<
+                    QCThread::GetErrorMsg(err) <<
+                KFS_LOG_EOM;
+                delete worker;
+                break;
+            }
+            workers.push_back(worker);
+        }
+        Process();
+        for (vector<Worker*>::const_iterator it = workers.begin();
+                it != workers.end();
+                ++it) {
+            (*it)->Join();
+            delete *it;
+        }
+        return mStatus;
+    }
+private:
+    class Worker : public QCRunnable
+    {
+    public:
+        Worker(ChunkmapLoader& loader)
+            : QCRunnable(),
+              mLoader(loader),
+              mThread()
+            {}
+        int Start()
+            { return mThread.TryToStart(this, -1, "ChunkmapLoader"); }
+        void Join()
+            { mThread.Join(); }
+        virtual void Run()
+            { mLoader.Process(); }
+    private:
+        ChunkmapLoader& mLoader;
+        QCThread        mThread;
+    private:
+        Worker(const Worker&);
+        Worker& operator=(const Worker&);
+    };
+    struct Chunk
+    {
+        Chunk()
+            : mChunkId(-1),
+              mServersStart(0),
+              mServersEnd(0)
+            {}
+        kfsChunkId_t mChunkId;
+        size_t       mServersStart;
+        size_t       mServersEnd;
+    };
+    typedef vector<Chunk> Chunks;
+
+    LayoutEmulator&       mEmulator;
+    const vector<string>& mFileNames;
+    ifstream              mFile;
+    size_t                mFileIdx;
+    const bool            mAddChunksToReplicationCheckerFlag;
+    QCMutex               mReadMutex;
+    QCMutex               mAddMutex;
+    size_t                mLineNo;
+    int                   mStatus;
+
+    enum { kMaxLineSize = 256 << 10 };
+
+    bool Read(char* line, vector<char>& lines, vector<size_t>& ends,
+        size_t& lineNo, const string*& fileName)
+    {
+        const size_t kBatchSize = 4 << 20;
+        QCStMutexLocker lock(mReadMutex);
+        lines.clear();
+        ends.clear();
+        if (mStatus != 0 || mFileNames.size() <= mFileIdx) {
+            return false;
+        }
+        if (! mFile.is_open()) {
+            mFile.clear();
+            mFile.open(mFileNames[mFileIdx].c_str());
+            if (! mFile) {
+                const int err = errno;
+                KFS_LOG_STREAM_ERROR << mFileNames[mFileIdx] << ": " <<
+                    strerror(err) <<
+                KFS_LOG_EOM;
+                mStatus = err > 0 ? -err : -1;
+                return false;
+            }
+            mLineNo = 1;
+        }
+        // A batch never spans files, in order to report the file name and
+        // line number of malformed lines.
+        fileName = &mFileNames[mFileIdx];
+        lineNo   = mLineNo;
+        while (mStatus == 0 && lines.size() < kBatchSize) {
+            if (! mFile.getline(line, kMaxLineSize)) {
+                if (mFile.bad() || ! mFile.eof()) {
+                    const int err = mFile.bad() ? errno : EINVAL;
+                    KFS_LOG_STREAM_ERROR << *fileName << ":" << mLineNo <<
+                        " " << strerror(err) <<
+                    KFS_LOG_EOM;
+                    mStatus = err > 0 ? -err : -1;
+                } else {
+                    mFile.close();
+                    mFileIdx++;
+                }
+                break;
+            }
+            const size_t len = mFile.gcount();
+            if ((size_t)kMaxLineSize - 1 <= len) {
+                KFS_LOG_STREAM_ERROR << *fileName << ":" << mLineNo <<
+                    " line too long" <<
+                KFS_LOG_EOM;
+                mStatus = -EINVAL;
+                break;
+            }
+            lines.insert(lines.end(), line, line + len);
+            ends.push_back(lines.size());
+            mLineNo++;
+        }
+        return (mStatus == 0 &&
+            (! ends.empty() || mFileIdx < mFileNames.size()));
+    }
+    void Process()
+    {
+        vector<char>       lines;
+        vector<size_t>     ends;
+        Chunks             chunks;
+        ChunkServerPtrs    servers;
+        ChunkServerPtrs    chunkServers;
+        ServerLocation     loc;
+        size_t             lineNo   = 0;
+        const string*      fileName = 0;
+        StBufferT<char, 1> buf;
+        char* const        line     = buf.Resize(kMaxLineSize);
+        while (Read(line, lines, ends, lineNo, fileName)) {
+            chunks.clear();
+            servers.clear();
+            size_t start = 0;
+            for (vector<size_t>::const_iterator it = ends.begin();
+                    it != ends.end();
+                    start = *it++, lineNo++) {
+                Chunk chunk;
+                chunkServers.clear();
+                if (! mEmulator.ParseLine(&lines[0] + start, *it - start,
+                        chunk.mChunkId, chunkServers, loc)) {
+                    KFS_LOG_STREAM_ERROR << *fileName << ":" << lineNo <<
+                        " malformed: " <<
+                        string(&lines[0] + start, *it - start) <<
+                    KFS_LOG_EOM;
+                    QCStMutexLocker lock(mReadMutex);
+                    mStatus = -EINVAL;
+                    return;
+                }
+                chunk.mServersStart = servers.size();
+                servers.insert(servers.end(),
+                    chunkServers.begin(), chunkServers.end());
+                chunk.mServersEnd = servers.size();
+                chunks.push_back(chunk);
+            }
+            QCStMutexLocker lock(mAddMutex);
+            for (Chunks::const_iterator it = chunks.begin();
+                    it != chunks.end();
+                    ++it) {
+                chunkServers.assign(servers.begin() + it->mServersStart,
+                    servers.begin() + it->mServersEnd);
+                mEmulator.AddChunk(it->mChunkId, chunkServers,
+                    mAddChunksToReplicationCheckerFlag);
+            }
+        }
+    }
+private:
+    ChunkmapLoader(const ChunkmapLoader&);
+    ChunkmapLoader& operator=(const ChunkmapLoader&);
+};
+
 int
 LayoutEmulator::LoadChunkmap(
     const string& chunkLocationFn, bool addChunksToReplicationChecker)
 {
     ifstream file(chunkLocationFn.c_str());
+    vector<string> fileNames;
     if (! file) {
         const int err = errno;
-        KFS_LOG_STREAM_INFO << chunkLocationFn << ": " << strerror(err) <<
+        if (err == ENOENT) {
+            // Chunk map dumped in shards: <name>.0, <name>.1, ...
+            for (int i = 0; ; i++) {
+                const string fn = chunkLocationFn + "." + toString(i);
+                struct stat st;
+                if (stat(fn.c_str(), &st) != 0) {
+                    break;
+                }
+                fileNames.push_back(fn);
+            }
+        }
+        if (fileNames.empty()) {
+            KFS_LOG_STREAM_INFO << chunkLocationFn << ": " <<
+                strerror(err) <<
+            KFS_LOG_EOM;
+            return (err > 0 ? -err : -1);
+        }
+        KFS_LOG_STREAM_INFO << chunkLocationFn << ": " <<
+            fileNames.size() << " shards" <<
         KFS_LOG_EOM;
-        return (err > 0 ? -err : -1);
+    } else if (1 < mLoadThreadCount) {
+        file.close();
+        fileNames.push_back(chunkLocationFn);
+    }
+    if (! fileNames.empty()) {
+        ChunkmapLoader loader(
+            *this, fileNames, addChunksToReplicationChecker);
+        return loader.Run(mLoadThreadCount);
     }
     const size_t       kMaxLineSize = 256 << 10;
     StBufferT<char, 1> buf;
@@ -100,6 +331,26 @@ LayoutEmulator::Parse(
     size_t            size,
     bool              addChunksToReplicationChecker,
     ServerLocation&   loc)
+{
+    ChunkServerPtrs servers;
+    kfsChunkId_t    cid;
+    if (! ParseLine(line, size, cid, servers, loc)) {
+        return false;
+    }
+    AddChunk(cid, servers, addChunksToReplicationChecker);
+    return true;
+}
+
+// Invoked concurrently by the chunk map loader threads, therefore must not
+// access the layout, except the server map that does not change while the
+// chunk map is loaded.
+bool
+LayoutEmulator::ParseLine(
+    const char*       line,
+    size_t            size,
+    kfsChunkId_t&     cid,
+    ChunkServerPtrs&  servers,
+    ServerLocation&   loc) const
 {
     // format of the file:
     // <chunkid> <fileid> <# of servers> [server location]
@@ -107,7 +358,6 @@ LayoutEmulator::Parse(
     // where, <server location>: replica-size name port rack#
     // and we have as many server locations as # of servers
 
-    kfsChunkId_t       cid;
     fid_t              fid;
     int                numServers;
     const char*        p   = line;
@@ -117,11 +367,6 @@ LayoutEmulator::Parse(
             ! DecIntParser::Parse(p, end - p, numServers)) {
         return false;
     }
-    CSMap::Entry* const ci = mChunkToServerMap.Find(cid);
-    if (! ci) {
-        KFS_LOG_STREAM_ERROR << "no such chunk: " << cid << KFS_LOG_EOM;
-        return true;
-    }
     for (int i = 0; i < numServers; i++) {
         while (p < end && (*p & 0xFF) <= ' ') {
             p++;
@@ -158,20 +403,38 @@ LayoutEmulator::Parse(
             KFS_LOG_EOM;
             continue;
         }
-        if (! AddReplica(*ci, it->second)) {
+        servers.push_back(&it->second);
+    }
+    return true;
+}
+
+void
+LayoutEmulator::AddChunk(
+    kfsChunkId_t           cid,
+    const ChunkServerPtrs& servers,
+    bool                   addChunksToReplicationChecker)
+{
+    CSMap::Entry* const ci = mChunkToServerMap.Find(cid);
+    if (! ci) {
+        KFS_LOG_STREAM_ERROR << "no such chunk: " << cid << KFS_LOG_EOM;
+        return;
+    }
+    for (ChunkServerPtrs::const_iterator it = servers.begin();
+            it != servers.end();
+            ++it) {
+        if (! AddReplica(*ci, **it)) {
             KFS_LOG_STREAM_ERROR <<
                 "chunk: "        << cid <<
-                " add server: "  << loc <<
+                " add server: "  << (**it)->GetServerLocation() <<
                 " failed" <<
             KFS_LOG_EOM;
             continue;
         }
-        GetCSEmulator(*(it->second)).HostingChunk(cid, GetChunkSize(*ci));
+        GetCSEmulator(***it).HostingChunk(cid, GetChunkSize(*ci));
     }
     if (addChunksToReplicationChecker) {
         CheckChunkReplication(*ci);
     }
-    return true;
 }
 
 // override what is in the layout manager (only for the emulator code)
@@ -184,8 +447,10 @@ LayoutEmulator::ChunkReplicationDone(MetaChunkReplicate* req)
         mNumOngoingReplications--;
     }
     req->server->ReplicateChunkDone(req->chunkId);
+    ChunkServerPtr srcServer;
     if (req->srcLocation.IsValid() && req->dataServer) {
         req->dataServer->UpdateReplicationReadLoad(-1);
+        srcServer.swap(req->dataServer);
     }
     req->dataServer.reset();
     if (req->status != 0) {
@@ -210,8 +475,16 @@ LayoutEmulator::ChunkReplicationDone(MetaChunkReplicate* req)
     }
     const bool addedFlag = AddReplica(*ci, req->server);
     if (addedFlag) {
-        GetCSEmulator(*(req->server)).HostingChunk(
-            req->chunkId, GetChunkSize(*ci));
+        const size_t size = GetChunkSize(*ci);
+        GetCSEmulator(*(req->server)).HostingChunk(req->chunkId, size);
+        GetCSEmulator(*(req->server)).ReplicationDone(size, true);
+        mBytesRebalanced += size;
+        if (srcServer) {
+            GetCSEmulator(*srcServer).ReplicationDone(size, false);
+            if (srcServer->GetRack() != req->server->GetRack()) {
+                mCrossRackBytesRebalanced += size;
+            }
+        }
     } else {
             KFS_LOG_STREAM_ERROR <<
                 "chunk: "        << req->chunkId <<
@@ -239,6 +512,28 @@ LayoutEmulator::MarkServerDown(const ServerLocation& loc)
     KFS_LOG_EOM;
 }
 
+int
+LayoutEmulator::MarkRackDown(int rack)
+{
+    vector<ServerLocation> locs;
+    for (Loc2Server::const_iterator it = mLoc2Server.begin();
+            it != mLoc2Server.end();
+            ++it) {
+        if (it->second->GetRack() == rack) {
+            locs.push_back(it->first);
+        }
+    }
+    for (vector<ServerLocation>::const_iterator it = locs.begin();
+            it != locs.end();
+            ++it) {
+        MarkServerDown(*it);
+    }
+    KFS_LOG_STREAM_INFO << "rack down: " << rack <<
+        " servers: " << locs.size() <<
+    KFS_LOG_EOM;
+    return (int)locs.size();
+}
+
 seq_t
 LayoutEmulator::GetChunkversion(chunkId_t cid) const
 {
@@ -359,10 +654,17 @@ LayoutEmulator::SetRebalancePlanOutFile(const string &rebalancePlanFn)
 size_t
 LayoutEmulator::RunChunkserverOps()
 {
-    size_t opsCount = 0;
+    const double timeStep = IsTimeStepped() ? mTimeStep : 0.;
+    size_t       opsCount  = 0;
+    size_t       pending   = 0;
+    size_t       transfers = 0;
     for (size_t i = 0; i < mChunkServers.size(); i++) {
         ChunkServer& srv = *mChunkServers[i];
-        opsCount += GetCSEmulator(srv).Dispatch();
+        if (0 < timeStep) {
+            transfers += GetCSEmulator(srv).GetTransferCount();
+        }
+        opsCount += GetCSEmulator(srv).Dispatch(timeStep, mNodeBandwidth);
+        pending  += GetCSEmulator(srv).GetPendingCount();
         // Handle the case where the chunk server might go away as result of
         // executing op.
         if (mChunkServers.size() <= i) {
@@ -372,6 +674,11 @@ LayoutEmulator::RunChunkserverOps()
             UpdateSrvLoadAvg(srv, 0, 0);
         }
     }
+    // Advance the time only if there were data transfers in this step.
+    if (0 < transfers) {
+        mSimulatedTime += timeStep;
+    }
+    mPendingReplicationsCount = pending;
     return opsCount;
 }
 
@@ -454,6 +761,7 @@ LayoutEmulator::BuildRebalancePlan()
             mStopFlag ||
             mChunkServers.empty() ||
             (opsCount <= 0 &&
+            mPendingReplicationsCount <= 0 &&
             ! mCleanupScheduledFlag &&
             mRebalanceCtrs.GetRoundCount() > round &&
             ! mChunkToServerMap.Front(CSMap::Entry::kStateCheckReplication));
@@ -496,6 +804,7 @@ LayoutEmulator::ExecuteRebalancePlan()
             mStopFlag ||
             mChunkServers.empty() ||
             (RunChunkserverOps() <= 0 &&
+            mPendingReplicationsCount <= 0 &&
             ! mChunkToServerMap.Front(CSMap::Entry::kStateCheckReplication) &&
             ! mIsExecutingRebalancePlan &&
             ! mCleanupScheduledFlag);
@@ -534,6 +843,52 @@ public:
     }
 };
 
+void
+LayoutEmulator::ShowRebalanceStats(
+    ostream& os, double nodeReplicationBandwidth) const
+{
+    double  sum      = 0;
+    double  sqSum    = 0;
+    double  minUtil  = 1;
+    double  maxUtil  = 0;
+    int64_t maxBytes = 0;
+    for (Servers::const_iterator it = mChunkServers.begin();
+            it != mChunkServers.end();
+            ++it) {
+        const ChunkServerEmulator& srv   = GetCSEmulator(**it);
+        const double               util  =
+            srv.GetSpaceUtilization(mUseFsTotalSpaceFlag);
+        sum   += util;
+        sqSum += util * util;
+        minUtil = min(minUtil, util);
+        maxUtil = max(maxUtil, util);
+        maxBytes = max(maxBytes, max(
+            srv.GetReplicationBytesIn(), srv.GetReplicationBytesOut()));
+    }
+    const size_t cnt  = mChunkServers.size();
+    const double mean = cnt > 0 ? sum / cnt : 0.;
+    const double var  = cnt > 0 ? max(0., sqSum / cnt - mean * mean) : 0.;
+    os <<
+        "servers: "             << cnt <<
+        " utilization: mean: "  << mean <<
+        " stddev: "             << sqrt(var) <<
+        " min: "                << (cnt > 0 ? minUtil : 0.) <<
+        " max: "                << maxUtil <<
+        " replicated: chunks: " << mNumBlksRebalanced <<
+        " bytes: "              << mBytesRebalanced <<
+        " cross rack bytes: "   << mCrossRackBytesRebalanced <<
+        " max node bytes: "     << maxBytes
+    ;
+    if (0 < nodeReplicationBandwidth) {
+        os << " estimated time: " << maxBytes / nodeReplicationBandwidth <<
+            " sec";
+    }
+    if (IsTimeStepped()) {
+        os << " simulated time: " << mSimulatedTime << " sec";
+    }
+    os << "\n";
+}
+
 void
 LayoutEmulator::PrintChunkserverBlockCount(ostream& os) const
 {
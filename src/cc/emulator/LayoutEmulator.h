@@ -49,7 +49,14 @@ public:
     LayoutEmulator()
         : mVariationFromMean(0),
           mNumBlksRebalanced(0),
+          mBytesRebalanced(0),
+          mCrossRackBytesRebalanced(0),
           mStopFlag(false),
+          mLoadThreadCount(1),
+          mTimeStep(0),
+          mNodeBandwidth(0),
+          mSimulatedTime(0),
+          mPendingReplicationsCount(0),
           mPlanFile(),
           mLoc2Server()
     {
@@ -61,9 +68,34 @@ public:
         mPlanFile.close();
     }
     // Given a chunk->location data in a file, rebuild the chunk->location map.
-    //
+    // With more than one load thread, the chunk map lines are read and parsed
+    // concurrently with adding the replicas to the layout.
     int LoadChunkmap(const string& chunkLocationFn,
         bool addChunksToReplicationChecker = false);
+    void SetLoadThreadCount(int count)
+    {
+        mLoadThreadCount = max(1, count);
+    }
+    // Time stepped mode: instead of completing replications immediately,
+    // advance simulated time in the given step, and complete the
+    // replications once their data is transferred. The node bandwidth in
+    // bytes per second is shared by the node's in flight replications, and
+    // bounds both the replication source and destination. The number of in
+    // flight replications, and therefore the time, is governed by the layout
+    // manager replication and re-balance scheduling and its limits.
+    void SetTimeStepped(double timeStepSec, double nodeBandwidth)
+    {
+        mTimeStep      = max(0., timeStepSec);
+        mNodeBandwidth = max(0., nodeBandwidth);
+    }
+    bool IsTimeStepped() const
+    {
+        return (0 < mTimeStep && 0 < mNodeBandwidth);
+    }
+    double GetSimulatedTime() const
+    {
+        return mSimulatedTime;
+    }
     void AddServer(const ServerLocation& loc,
         int rack, uint64_t totalSpace, uint64_t usedSpace);
     void SetupForRebalancePlanning(
@@ -83,10 +115,25 @@ public:
     seq_t  GetChunkversion(chunkId_t cid) const;
     size_t GetChunkSize(chunkId_t cid) const;
     void MarkServerDown(const ServerLocation& loc);
+    // Returns number of servers marked down.
+    int MarkRackDown(int rack);
     int GetNumBlksRebalanced() const
     {
         return mNumBlksRebalanced;
     }
+    int64_t GetBytesRebalanced() const
+    {
+        return mBytesRebalanced;
+    }
+    int64_t GetCrossRackBytesRebalanced() const
+    {
+        return mCrossRackBytesRebalanced;
+    }
+    // Show space utilization spread, and the replication traffic. With
+    // positive per node replication bandwidth in bytes per second, show
+    // estimated re-balance time, assuming that the time is bounded by the
+    // node with the most replication bytes in or out.
+    void ShowRebalanceStats(ostream& os, double nodeReplicationBandwidth) const;
     void Stop()
     {
         mStopFlag = true;
@@ -94,13 +141,20 @@ public:
     int RunFsck(const string& fileName);
 private:
     typedef map<ServerLocation, ChunkServerPtr> Loc2Server;
+    typedef vector<const ChunkServerPtr*>      ChunkServerPtrs;
     class PlacementVerifier;
+    class ChunkmapLoader;
+    friend class ChunkmapLoader;
 
     size_t RunChunkserverOps();
     void CalculateRebalaceThresholds();
     void PrepareRebalance(bool enableRebalanceFlag);
     bool Parse(const char* line, size_t size,
         bool addChunksToReplicationChecker, ServerLocation& loc);
+    bool ParseLine(const char* line, size_t size, kfsChunkId_t& cid,
+        ChunkServerPtrs& servers, ServerLocation& loc) const;
+    void AddChunk(kfsChunkId_t cid, const ChunkServerPtrs& servers,
+        bool addChunksToReplicationChecker);
     void ShowPlacementError(
         ostream&            os,
         const CSMap::Entry& c,
@@ -125,7 +179,14 @@ private:
     // which nodes are candidates for migration.
     double     mVariationFromMean;
     int        mNumBlksRebalanced;
+    int64_t    mBytesRebalanced;
+    int64_t    mCrossRackBytesRebalanced;
     bool       mStopFlag;
+    int        mLoadThreadCount;
+    double     mTimeStep;
+    double     mNodeBandwidth;
+    double     mSimulatedTime;
+    size_t     mPendingReplicationsCount;
     ofstream   mPlanFile;
     Loc2Server mLoc2Server;
 private:
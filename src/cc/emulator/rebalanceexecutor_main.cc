@@ -54,10 +54,13 @@ main(int argc, char** argv)
     string propsFn;
     string chunkMapDir;
     int    optchar;
-    bool   helpFlag  = false;
-    bool   debugFlag = false;
+    bool   helpFlag      = false;
+    bool   debugFlag     = false;
+    double nodeBandwidth = 0;
+    double timeStep      = 0;
+    int    threadCount   = 1;
 
-    while ((optchar = getopt(argc, argv, "c:l:n:b:r:hdp:o:")) != -1) {
+    while ((optchar = getopt(argc, argv, "c:l:n:b:r:hdp:o:w:s:T:")) != -1) {
         switch (optchar) {
             case 'l':
                 logdir = optarg;
@@ -86,6 +89,15 @@ main(int argc, char** argv)
             case 'o':
                 chunkMapDir = optarg;
                 break;
+            case 'w':
+                nodeBandwidth = atof(optarg) * (1 << 20);
+                break;
+            case 's':
+                timeStep = atof(optarg);
+                break;
+            case 'T':
+                threadCount = atoi(optarg);
+                break;
             default:
                 helpFlag = true;
                 break;
@@ -104,6 +116,14 @@ main(int argc, char** argv)
             "[-p <[meta server] configuration file> (default none)]\n"
             "[-o <new chunk map output directory> (default none)]\n"
             "[-d debug -- print chunk into stdout layout before and after]\n"
+            "[-w <per node replication bandwidth in MB/sec, used to estimate"
+                " re-balance time> (default none)]\n"
+            "[-s <time step in seconds> (default none) -- simulate"
+                " replication data transfers\n"
+                " with -w bandwidth, and the configured replication limits,"
+                " in order to estimate\n"
+                " the plan execution time]\n"
+            "[-T <chunk map load threads> (default " << threadCount << ")]\n"
         ;
         return 1;
     }
@@ -117,6 +137,8 @@ main(int argc, char** argv)
             (status = props.loadProperties(propsFn.c_str(), char('=')))
                 == 0)) {
         gLayoutEmulator.SetParameters(props);
+        gLayoutEmulator.SetLoadThreadCount(threadCount);
+        gLayoutEmulator.SetTimeStepped(timeStep, nodeBandwidth);
         if ((status = EmulatorSetup(logdir, cpdir, networkFn, chunkmapFn))
                 == 0 &&
                 (status = gLayoutEmulator.LoadRebalancePlan(rebalancePlanFn))
@@ -124,7 +146,11 @@ main(int argc, char** argv)
             if (debugFlag) {
                 gLayoutEmulator.PrintChunkserverBlockCount(cout);
             }
+            cout << "before: ";
+            gLayoutEmulator.ShowRebalanceStats(cout, nodeBandwidth);
             gLayoutEmulator.ExecuteRebalancePlan();
+            cout << "after: ";
+            gLayoutEmulator.ShowRebalanceStats(cout, nodeBandwidth);
             if (! chunkMapDir.empty()) {
                 gLayoutEmulator.DumpChunkToServerMap(chunkMapDir);
             }
@@ -41,6 +41,7 @@
 #include <signal.h>
 
 using std::string;
+using std::vector;
 using std::cout;
 using std::cerr;
 
@@ -61,10 +62,15 @@ main(int argc, char** argv)
     int     optchar;
     int16_t minReplication   = -1;
     double  variationFromAvg = 0;
+    double  nodeBandwidth    = 0;
+    double  timeStep         = 0;
+    int     threadCount      = 1;
     bool    helpFlag         = false;
     bool    debugFlag        = false;
+    vector<int> downRacks;
 
-    while ((optchar = getopt(argc, argv, "c:l:n:b:r:hp:o:dm:t:")) != -1) {
+    while ((optchar = getopt(argc, argv,
+            "c:l:n:b:r:hp:o:dm:t:w:s:T:k:")) != -1) {
         switch (optchar) {
             case 'l':
                 logdir = optarg;
@@ -99,6 +105,26 @@ main(int argc, char** argv)
             case 'm':
                 minReplication = atoi(optarg);
                 break;
+            case 'w':
+                nodeBandwidth = atof(optarg) * (1 << 20);
+                break;
+            case 's':
+                timeStep = atof(optarg);
+                break;
+            case 'T':
+                threadCount = atoi(optarg);
+                break;
+            case 'k':
+                for (const char* p = optarg; *p; ) {
+                    char* e = 0;
+                    downRacks.push_back((int)strtol(p, &e, 10));
+                    if (e == p || (*e != ',' && *e != 0)) {
+                        helpFlag = true;
+                        break;
+                    }
+                    p = *e ? e + 1 : e;
+                }
+                break;
             default:
                 cerr << "Unrecognized flag: " << (char)optchar << "\n";
                 helpFlag = true;
@@ -121,6 +147,17 @@ main(int argc, char** argv)
             "[-o <new chunk map output directory> (default none)]\n"
             "[-d debug -- print chunk layout before and after]\n"
             "[-m <min replicas per file> (default -1 -- no change)]\n"
+            "[-w <per node replication bandwidth in MB/sec, used to estimate"
+                " re-balance time> (default none)]\n"
+            "[-s <time step in seconds> (default none) -- simulate"
+                " replication data transfers\n"
+                " with -w bandwidth, and the configured replication limits,"
+                " in order to estimate\n"
+                " the re-balance or recovery time]\n"
+            "[-T <chunk map load threads> (default " << threadCount << ")]\n"
+            "[-k <comma separated list of racks to mark down after load,"
+                " in order to plan\n"
+                " and estimate rack loss recovery> (default none)]\n"
             "To create network defininiton file and chunk map files:\n"
             "telnet to the meta server, and issue DUMP_CHUNKTOSERVERMAP\n"
             "followed by an empty line.\n"
@@ -155,8 +192,19 @@ main(int argc, char** argv)
             == 0) {
         gLayoutEmulator.SetParameters(props);
         gLayoutEmulator.SetupForRebalancePlanning(variationFromAvg);
+        gLayoutEmulator.SetLoadThreadCount(threadCount);
+        gLayoutEmulator.SetTimeStepped(timeStep, nodeBandwidth);
         status = EmulatorSetup(logdir, cpdir, networkFn, chunkmapFn,
             minReplication, minReplication > 1);
+        for (vector<int>::const_iterator it = downRacks.begin();
+                status == 0 && it != downRacks.end();
+                ++it) {
+            if (gLayoutEmulator.MarkRackDown(*it) <= 0) {
+                KFS_LOG_STREAM_ERROR << "no servers in rack: " << *it <<
+                KFS_LOG_EOM;
+                status = -EINVAL;
+            }
+        }
         if (status == 0 &&
                 (status = gLayoutEmulator.SetRebalancePlanOutFile(
                     rebalancePlanFn)) == 0) {
@@ -166,6 +214,8 @@ main(int argc, char** argv)
             KFS_LOG_STREAM_NOTICE << "creating re-balance plan: " <<
                 rebalancePlanFn <<
             KFS_LOG_EOM;
+            cout << "before: ";
+            gLayoutEmulator.ShowRebalanceStats(cout, nodeBandwidth);
             gLayoutEmulator.BuildRebalancePlan();
             if (! chunkMapDir.empty()) {
                 gLayoutEmulator.DumpChunkToServerMap(chunkMapDir);
@@ -176,6 +226,8 @@ main(int argc, char** argv)
             KFS_LOG_STREAM_NOTICE << "replicated chunks: " <<
                 gLayoutEmulator.GetNumBlksRebalanced() <<
             KFS_LOG_EOM;
+            cout << "after: ";
+            gLayoutEmulator.ShowRebalanceStats(cout, nodeBandwidth);
         }
     }
     AuditLog::Stop();
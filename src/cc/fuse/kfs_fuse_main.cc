@@ -32,6 +32,7 @@
 #include "common/Properties.h"
 
 #include <fuse.h>
+#include <algorithm>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <string.h>
@@ -42,6 +43,7 @@
 
 using std::string;
 using std::vector;
+using std::max;
 using KFS::KfsClient;
 using KFS::KfsFileAttr;
 using KFS::kfsMode_t;
@@ -245,6 +247,22 @@ fuse_access(const char *path, int mode)
     return 0;
 }
 
+static void*
+fuse_init(struct fuse_conn_info* conn)
+{
+    // Reads wait for the data with the client mutex released, enable parallel
+    // reads of the same file, and use splice to move the request and response
+    // data to and from the kernel, if supported.
+#ifdef FUSE_CAP_ASYNC_READ
+    conn->want |= conn->capable & FUSE_CAP_ASYNC_READ;
+#endif
+#ifdef FUSE_CAP_SPLICE_READ
+    conn->want |= conn->capable &
+        (FUSE_CAP_SPLICE_READ | FUSE_CAP_SPLICE_WRITE | FUSE_CAP_SPLICE_MOVE);
+#endif
+    return 0;
+}
+
 static int
 fuse_chmod(const char *path, mode_t mode)
 {
@@ -290,7 +308,7 @@ struct fuse_operations ops = {
         fuse_readdir,
         fuse_releasedir,
         NULL,                   /* fsyncdir */
-        NULL,                   /* init */
+        fuse_init,              /* init */
         NULL,                   /* destroy */
         fuse_access,            /* access */
         fuse_create,            /* create */
@@ -328,7 +346,7 @@ struct fuse_operations ops_readonly = {
         fuse_readdir,
         NULL,                   /* releasedir */
         NULL,                   /* fsyncdir */
-        NULL,                   /* init */
+        fuse_init,              /* init */
         NULL,                   /* destroy */
         fuse_access,            /* access */
         NULL,                   /* create */
@@ -388,22 +406,85 @@ initkfs(char* addr, const string& cfg_file, const string& cfg_props)
     }
 }
 
+/*
+ * File system (fuse library) options, as opposed to the mount options, which
+ * are passed to fuse_mount().
+ */
+static bool
+is_fs_option(const string& token)
+{
+    static const char* const fs_options[] = {
+        "attr_timeout=",
+        "entry_timeout=",
+        "negative_timeout=",
+        "ac_attr_timeout=",
+        "direct_io",
+        "kernel_cache",
+        "auto_cache",
+        "noauto_cache",
+        "max_write=",
+        "max_readahead=",
+        "async_read",
+        "sync_read",
+        "splice_",
+        "no_splice_",
+        "use_ino",
+        "readdir_ino",
+        "intr",
+        0
+    };
+    for (const char* const* opt = fs_options; *opt; ++opt) {
+        const size_t len = strlen(*opt);
+        if (token.compare(0, len, *opt) == 0 &&
+                ((*opt)[len - 1] == '=' || (*opt)[len - 1] == '_' ||
+                    token.length() == len)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * The kernel attribute and entry cache timeouts default to the client
+ * attribute cache revalidate time, and kernel read ahead to the client's
+ * read ahead size. The options specified with -o are appended last, and
+ * override the defaults.
+ */
 static struct fuse_args*
-get_fs_args(struct fuse_args* args)
+get_fs_args(struct fuse_args* args, const string& fs_options)
 {
 #ifdef KFS_OS_NAME_DARWIN
-    return NULL;
-#else
+    if (fs_options.empty()) {
+        return NULL;
+    }
+#endif
     if (! args) {
         return 0;
     }
-    args->argc = 2;
-    args->argv = (char**)calloc(sizeof(char*), args->argc + 1);
-    args->argv[0] = strdup("qfs_fuse");
-    args->argv[1] = strdup("-obig_writes");
-    args->allocated = 1;
-    return args;
+    args->argc      = 0;
+    args->argv      = NULL;
+    args->allocated = 0;
+    fuse_opt_add_arg(args, "qfs_fuse");
+#ifndef KFS_OS_NAME_DARWIN
+    fuse_opt_add_arg(args, "-obig_writes");
+    fuse_opt_add_arg(args, "-omax_write=131072");
+    const ssize_t read_ahead = client->GetDefaultReadAheadSize();
+    if (0 < read_ahead) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "-omax_readahead=%ld", (long)read_ahead);
+        fuse_opt_add_arg(args, buf);
+    }
+    const int attr_timeout = max(0, client->GetFileAttributeRevalidateTime());
+    char timeouts[96];
+    snprintf(timeouts, sizeof(timeouts),
+        "-oattr_timeout=%d,entry_timeout=%d,auto_cache",
+        attr_timeout, attr_timeout);
+    fuse_opt_add_arg(args, timeouts);
 #endif
+    if (! fs_options.empty()) {
+        fuse_opt_add_arg(args, ("-o" + fs_options).c_str());
+    }
+    return args;
 }
 
 static struct fuse_args*
@@ -430,7 +511,7 @@ get_mount_args(struct fuse_args* args, const char* options)
 static int
 massage_options(
     char** opt_argv, int opt_argc, string* options, bool* readonly,
-    string& out_cfg_file, string& out_cfg_props)
+    string& out_cfg_file, string& out_cfg_props, string& out_fs_options)
 {
     if (!opt_argv || !readonly || !options) {
         return -1;
@@ -486,6 +567,13 @@ massage_options(
             }
             continue;
         }
+        if (is_fs_option(token)) {
+            if (! out_fs_options.empty()) {
+                out_fs_options.append(",");
+            }
+            out_fs_options.append(token);
+            continue;
+        }
         options->append(",");
         options->append(token);
     }
@@ -499,7 +587,8 @@ massage_options(
 static void
 initfuse(char* kfs_host_address, const char* mountpoint,
          const char* options, bool readonly, bool fork_flag,
-         const string& cfg_file, const string& cfg_props)
+         const string& cfg_file, const string& cfg_props,
+         const string& fs_options)
 {
     int pid = fork_flag ? fork() : 0;
     if (pid < 0) {
@@ -519,7 +608,7 @@ initfuse(char* kfs_host_address, const char* mountpoint,
         }
 
         struct fuse* fuse = NULL;
-        fuse = fuse_new(ch, get_fs_args(&fs_args),
+        fuse = fuse_new(ch, get_fs_args(&fs_args, fs_options),
                         (readonly ? &ops_readonly : &ops),
                         (readonly ? sizeof(ops_readonly) : sizeof(ops)),
                         NULL);
@@ -544,7 +633,10 @@ usage(int e, const char* name)
     fprintf(stderr,
         "usage: %s qfshost mountpoint [-o opt1[,opt2..]]\n"
         "       eg: %s 127.0.0.1:20000 "
-        "/mnt/qfs -o allow_other,ro,cfg=FILE:client_config_file.prp\n",
+        "/mnt/qfs -o allow_other,ro,cfg=FILE:client_config_file.prp\n"
+        "The fuse library options, like attr_timeout, entry_timeout,\n"
+        "max_readahead, or direct_io, are passed to the fuse library,\n"
+        "the remaining options are passed to the fuse mount.\n",
         name, name
     );
     exit(e);
@@ -579,9 +671,10 @@ main(int argc, char **argv)
     bool readonly = true;
     string cfg_file;
     string cfg_props;
+    string fs_options;
     if (argc > 2) {
         if (massage_options(argv + 2, argc - 2, &options, &readonly,
-                cfg_file, cfg_props) < 0) {
+                cfg_file, cfg_props, fs_options) < 0) {
             usage(1, name);
         }
     }
@@ -589,7 +682,7 @@ main(int argc, char **argv)
     //setsid(); // detach from console
 
     initfuse(argv[0], argv[1], options.c_str(), readonly,
-        fork_flag, cfg_file, cfg_props);
+        fork_flag, cfg_file, cfg_props, fs_options);
 
     return 0;
 }
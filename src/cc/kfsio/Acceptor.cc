@@ -41,12 +41,14 @@ Acceptor::Acceptor(
     const ServerLocation& location,
     bool                  ipV6OnlyFlag,
     IAcceptorOwner*       owner,
-    bool                  bindOnlyFlag)
+    bool                  bindOnlyFlag,
+    int                   inheritedFd /* = -1 */)
     : mLocation(location),
       mIpV6OnlyFlag(ipV6OnlyFlag),
       mAcceptorOwner(owner),
       mConn(),
-      mNetManager(netManager)
+      mNetManager(netManager),
+      mInheritedFd(inheritedFd)
 {
     SET_HANDLER(this, &Acceptor::RecvConnection);
     Acceptor::Bind();
@@ -64,7 +66,8 @@ Acceptor::Acceptor(
       mIpV6OnlyFlag(false),
       mAcceptorOwner(owner),
       mConn(),
-      mNetManager(netManager)
+      mNetManager(netManager),
+      mInheritedFd(-1)
 {
     SET_HANDLER(this, &Acceptor::RecvConnection);
     Acceptor::Bind();
@@ -92,12 +95,31 @@ Acceptor::Bind()
         mConn.reset();
     }
     TcpSocket* const sock = new TcpSocket();
-    const int res = sock->Bind(
-        mLocation,
-        (mLocation.hostname.empty() && mIpV6OnlyFlag) ?
-            TcpSocket::kTypeIpV6 : TcpSocket::kTypeIpV4,
-        mIpV6OnlyFlag
-    );
+    int              res  = -1;
+    if (0 <= mInheritedFd) {
+        res = sock->Inherit(mInheritedFd, mLocation);
+        if (res < 0) {
+            KFS_LOG_STREAM_ERROR <<
+                "failed to inherit socket: " << mInheritedFd <<
+                " bound to: " << mLocation <<
+                " error: " << QCUtils::SysError(-res) <<
+            KFS_LOG_EOM;
+        } else {
+            KFS_LOG_STREAM_INFO <<
+                "inherited socket: " << mInheritedFd <<
+                " bound to: " << mLocation <<
+            KFS_LOG_EOM;
+        }
+        mInheritedFd = -1;
+    }
+    if (res < 0) {
+        res = sock->Bind(
+            mLocation,
+            (mLocation.hostname.empty() && mIpV6OnlyFlag) ?
+                TcpSocket::kTypeIpV6 : TcpSocket::kTypeIpV4,
+            mIpV6OnlyFlag
+        );
+    }
     if (res < 0) {
         KFS_LOG_STREAM_ERROR <<
             "failed to bind to: " << mLocation <<
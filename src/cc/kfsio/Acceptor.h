@@ -87,12 +87,16 @@ public:
         int             port,
         IAcceptorOwner* owner,
         bool            bindOnlyFlag = false);
+    /// @param inheritedFd if non negative, the bound socket inherited from
+    /// the parent process, used instead of binding a new socket if it is
+    /// bound to the location port.
     Acceptor(
         NetManager&           netManager,
         const ServerLocation& location,
         bool                  ipV6OnlyFlag,
         IAcceptorOwner*       owner,
-        bool                  bindOnlyFlag);
+        bool                  bindOnlyFlag,
+        int                   inheritedFd = -1);
     ~Acceptor();
     void StartListening();
 
@@ -112,6 +116,10 @@ public:
         { return mLocation.port; }
     const ServerLocation& GetLocation() const
         { return mLocation; }
+    /// Returns the listening socket file descriptor duplicate, for passing
+    /// the socket to the new process on restart, or negative error code.
+    int DupListener() const
+        { return (mConn ? mConn->DupSocket() : -ENOTCONN); }
 private:
     ///
     /// The encapsulated connection object that corresponds to the TCP
@@ -122,6 +130,7 @@ private:
     IAcceptorOwner* const mAcceptorOwner;
     NetConnectionPtr      mConn;
     NetManager&           mNetManager;
+    int                   mInheritedFd;
 
     void Bind();
 };
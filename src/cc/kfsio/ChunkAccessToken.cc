@@ -24,12 +24,23 @@
 //----------------------------------------------------------------------------
 
 #include "ChunkAccessToken.h"
+#include "CryptoKeys.h"
 
 #include "common/MsgLogger.h"
+#include "common/time.h"
+#include "qcdio/QCMutex.h"
+#include "qcdio/qcstutils.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
 
 namespace KFS
 {
 using std::ostream;
+using std::min;
+using std::vector;
 
 class ChunkAccessToken::Subject : public DelegationToken::Subject
 {
@@ -224,4 +235,218 @@ ChunkAccessToken::WriteToken(
     );
 }
 
+class ChunkAccessToken::Cache::Impl
+{
+public:
+    Impl()
+        : mMutex(),
+          mSize(0),
+          mEntries(),
+          mCounters()
+        {}
+    void SetSize(
+        int inSize)
+    {
+        int theSize = 0;
+        if (0 < inSize) {
+            theSize = 1;
+            while (theSize < inSize && theSize < (1 << 24)) {
+                theSize <<= 1;
+            }
+        }
+        QCStMutexLocker theLocker(mMutex);
+        if (theSize != mSize) {
+            mSize = theSize;
+            Entries theEntries;
+            mEntries.swap(theEntries);
+        }
+    }
+    int GetSize() const
+    {
+        QCStMutexLocker theLocker(mMutex);
+        return mSize;
+    }
+    bool Process(
+        ChunkAccessToken& outToken,
+        kfsChunkId_t      inChunkId,
+        const char*       inBufPtr,
+        int               inBufLen,
+        int64_t           inTimeNowSec,
+        const CryptoKeys& inKeys,
+        string*           outErrMsgPtr,
+        int64_t           inId)
+    {
+        if (inBufLen <= 0 || kMaxTokenLength < inBufLen) {
+            return outToken.Process(inChunkId, inBufPtr, inBufLen,
+                inTimeNowSec, inKeys, outErrMsgPtr, inId);
+        }
+        size_t theIdx = Hash(inChunkId, inBufPtr, inBufLen, inId);
+        {
+            QCStMutexLocker theLocker(mMutex);
+            if (mSize <= 0) {
+                theLocker.Unlock();
+                return outToken.Process(inChunkId, inBufPtr, inBufLen,
+                    inTimeNowSec, inKeys, outErrMsgPtr, inId);
+            }
+            theIdx &= (size_t)(mSize - 1);
+            if (mEntries.empty()) {
+                mEntries.resize((size_t)mSize);
+            }
+            Entry& theEntry = mEntries[theIdx];
+            if (theEntry.mLen == inBufLen &&
+                    theEntry.mChunkId == inChunkId &&
+                    theEntry.mId == inId &&
+                    memcmp(theEntry.mBuf, inBufPtr, inBufLen) == 0) {
+                CryptoKeys::Key theKey;
+                if (IsTimeValid(theEntry.mToken, inTimeNowSec) &&
+                        inKeys.Find(theEntry.mToken.GetKeyId(), theKey)) {
+                    mCounters.mHitCount++;
+                    outToken.mChunkId         = inChunkId;
+                    outToken.mDelegationToken = theEntry.mToken;
+                    return true;
+                }
+                // Expired, or the key no longer exists. Let the token
+                // processing produce the corresponding error.
+                theEntry.mLen = 0;
+            }
+        }
+        const int64_t theStart = microseconds();
+        const bool    theOkFlag = outToken.Process(inChunkId, inBufPtr,
+            inBufLen, inTimeNowSec, inKeys, outErrMsgPtr, inId);
+        const int64_t theTime  = microseconds() - theStart;
+        QCStMutexLocker theLocker(mMutex);
+        mCounters.mMissCount++;
+        mCounters.mMissMicroSec += theTime;
+        if (! theOkFlag || mEntries.size() <= theIdx) {
+            return theOkFlag;
+        }
+        Entry& theEntry = mEntries[theIdx];
+        if (0 < theEntry.mLen) {
+            mCounters.mEvictionCount++;
+        }
+        theEntry.mChunkId = inChunkId;
+        theEntry.mId      = inId;
+        theEntry.mToken   = outToken.mDelegationToken;
+        theEntry.mLen     = inBufLen;
+        memcpy(theEntry.mBuf, inBufPtr, inBufLen);
+        return theOkFlag;
+    }
+    void GetCounters(
+        Counters& outCounters) const
+    {
+        QCStMutexLocker theLocker(mMutex);
+        outCounters = mCounters;
+    }
+private:
+    // The base 64 encoded token is 72 bytes.
+    enum { kMaxTokenLength = 128 };
+    class Entry
+    {
+    public:
+        Entry()
+            : mChunkId(-1),
+              mId(-1),
+              mToken(),
+              mLen(0)
+            {}
+        kfsChunkId_t    mChunkId;
+        int64_t         mId;
+        DelegationToken mToken;
+        int             mLen;
+        char            mBuf[kMaxTokenLength];
+    };
+    typedef vector<Entry> Entries;
+
+    mutable QCMutex mMutex;
+    int             mSize;
+    Entries         mEntries;
+    Counters        mCounters;
+
+    static size_t Hash(
+        kfsChunkId_t inChunkId,
+        const char*  inBufPtr,
+        int          inBufLen,
+        int64_t      inId)
+    {
+        // FNV-1a
+        uint64_t theHash = 14695981039346656037ULL;
+        const char* const theEndPtr = inBufPtr + inBufLen;
+        for (const char* thePtr = inBufPtr; thePtr < theEndPtr; ++thePtr) {
+            theHash ^= (unsigned char)*thePtr;
+            theHash *= 1099511628211ULL;
+        }
+        theHash ^= (uint64_t)inChunkId + ((uint64_t)inId << 17);
+        theHash *= 1099511628211ULL;
+        return (size_t)(theHash ^ (theHash >> 32));
+    }
+    // Same validity conditions as DelegationToken::Process() checks.
+    static bool IsTimeValid(
+        const DelegationToken& inToken,
+        int64_t                inTimeNowSec)
+    {
+        const uint32_t theValidForSec = inToken.GetValidForSec();
+        if (theValidForSec <= 0) {
+            return false;
+        }
+        const int64_t theIssuedTime = inToken.GetIssuedTime();
+        return (
+            theIssuedTime <= inTimeNowSec +
+                min(uint32_t(5 * 60), theValidForSec) &&
+            inTimeNowSec <= theIssuedTime + theValidForSec
+        );
+    }
+private:
+    Impl(
+        const Impl& inImpl);
+    Impl& operator=(
+        const Impl& inImpl);
+};
+
+ChunkAccessToken::Cache::Cache(
+    int inSize)
+    : mImpl(*(new Impl()))
+{
+    mImpl.SetSize(inSize);
+}
+
+ChunkAccessToken::Cache::~Cache()
+{
+    delete &mImpl;
+}
+
+    void
+ChunkAccessToken::Cache::SetSize(
+    int inSize)
+{
+    mImpl.SetSize(inSize);
+}
+
+    int
+ChunkAccessToken::Cache::GetSize() const
+{
+    return mImpl.GetSize();
+}
+
+    bool
+ChunkAccessToken::Cache::Process(
+    ChunkAccessToken& outToken,
+    kfsChunkId_t      inChunkId,
+    const char*       inBufPtr,
+    int               inBufLen,
+    int64_t           inTimeNowSec,
+    const CryptoKeys& inKeys,
+    string*           outErrMsgPtr,
+    int64_t           inId)
+{
+    return mImpl.Process(outToken, inChunkId, inBufPtr, inBufLen,
+        inTimeNowSec, inKeys, outErrMsgPtr, inId);
+}
+
+    void
+ChunkAccessToken::Cache::GetCounters(
+    ChunkAccessToken::Cache::Counters& outCounters) const
+{
+    mImpl.GetCounters(outCounters);
+}
+
 }
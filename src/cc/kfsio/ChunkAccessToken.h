@@ -108,6 +108,7 @@ public:
         { return mDelegationToken.Display(inStream); }
     const DelegationToken& Get() const
         { return mDelegationToken; }
+    class Cache;
     static bool WriteToken(
         IOBufferWriter& inWriter,
         kfsChunkId_t    inChunkId,
@@ -144,6 +145,70 @@ private:
         const ChunkAccessToken& inToken);
 };
 
+// Bounded cache of the verified tokens, keyed by the token string, chunk
+// and subject ids. The same chunk access token is typically presented with
+// every request to the chunk, and the cache allows to skip the signature
+// computation for the repeated requests. The expiration time, and the token
+// key presence are checked on every cache hit, therefore the cached tokens
+// become invalid when the key is removed from the key set. Thread safe.
+class ChunkAccessToken::Cache
+{
+public:
+    class Counters
+    {
+    public:
+        typedef int64_t Counter;
+
+        Counters()
+            : mHitCount(0),
+              mMissCount(0),
+              mEvictionCount(0),
+              mMissMicroSec(0)
+            {}
+        void Clear()
+            { *this = Counters(); }
+        // Estimate of the cpu time saved by the cache hits.
+        Counter GetSavedMicroSec() const
+        {
+            return (mMissCount <= 0 ? Counter(0) :
+                mHitCount * mMissMicroSec / mMissCount);
+        }
+        Counter mHitCount;
+        Counter mMissCount;
+        Counter mEvictionCount;
+        Counter mMissMicroSec;
+    };
+
+    Cache(
+        int inSize = 0);
+    ~Cache();
+    // Sets max number of cached tokens, 0 or negative disables caching. The
+    // size is rounded up to the power of two. The cache memory is allocated
+    // on the first use, i.e. not allocated with the security off.
+    void SetSize(
+        int inSize);
+    int GetSize() const;
+    bool Process(
+        ChunkAccessToken& outToken,
+        kfsChunkId_t      inChunkId,
+        const char*       inBufPtr,
+        int               inBufLen,
+        int64_t           inTimeNowSec,
+        const CryptoKeys& inKeys,
+        string*           outErrMsgPtr,
+        int64_t           inId = -1);
+    void GetCounters(
+        Counters& outCounters) const;
+private:
+    class Impl;
+    Impl& mImpl;
+private:
+    Cache(
+        const Cache& inCache);
+    Cache& operator=(
+        const Cache& inCache);
+};
+
 inline static ostream& operator << (
     ostream&                           inStream,
     const ChunkAccessToken::ShowToken& inShowToken)
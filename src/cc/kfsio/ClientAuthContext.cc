@@ -32,20 +32,29 @@
 #include "common/StBuffer.h"
 #include "kfsio/NetConnection.h"
 #include "kfsio/SslFilter.h"
+#include "kfsio/MacFilter.h"
 #include "kfsio/Base64.h"
+#include "kfsio/DelegationToken.h"
 #include "krb/KrbClient.h"
 #include "qcdio/qcdebug.h"
+#include "qcdio/QCUtils.h"
 
 #include <boost/shared_ptr.hpp>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <time.h>
 
 #include <algorithm>
+#include <fstream>
 
 namespace KFS
 {
 
 using std::string;
 using std::max;
+using std::ifstream;
 using boost::shared_ptr;
 
 class ClientAuthContext::RequestCtxImpl
@@ -58,7 +67,8 @@ private:
           mSessionKeyPtr(0),
           mSessionKeyLen(0),
           mAuthType(kAuthenticationTypeUndef),
-          mInvalidFlag(false)
+          mInvalidFlag(false),
+          mDelegationFlag(false)
         {}
     void Reset()
         { *this = RequestCtxImpl(); }
@@ -68,6 +78,7 @@ private:
     int          mSessionKeyLen;
     int          mAuthType;
     bool         mInvalidFlag;
+    bool         mDelegationFlag;
 friend class ClientAuthContext::Impl;
 };
 
@@ -81,13 +92,21 @@ public:
           mKrbAuthRequireSslFlag(false),
           mAuthRequiredFlag(false),
           mAllowCSClearTextFlag(true),
+          mCSClearTextMacFlag(false),
           mMaxAuthRetryCount(3),
           mParams(),
           mKrbClientPtr(),
           mSslCtxPtr(),
           mX509SslCtxPtr(),
           mPskKeyId(),
-          mPskKey()
+          mPskKey(),
+          mX509ExpectedName(),
+          mDelegationCacheFileName(),
+          mDelegationMinValidSec(5 * 60),
+          mDelegationValidForSec(0),
+          mDelegationEndTime(0),
+          mDelegationKeyId(),
+          mDelegationKey()
         {}
     ~Impl()
         { Impl::Clear(); }
@@ -227,23 +246,16 @@ public:
         const Properties::String* const theKeyStrPtr = theParams.getValue(
             theParamName.Truncate(theCurLen).Append("key"));
         string thePskKey;
-        if (theKeyStrPtr) {
-            StBufferT<char, 64> theKeyBuf;
-            char* const thePtr = theKeyBuf.Resize(
-                Base64::GetMaxDecodedLength((int)theKeyStrPtr->GetSize()));
-            const int   theLen = Base64::Decode(
-                theKeyStrPtr->GetPtr(), theKeyStrPtr->GetSize(), thePtr);
-            if (theLen <= 0) {
-                const char* const kMsgPtr = "psk: invalid key encoding";
-                if (outErrMsgPtr) {
-                    *outErrMsgPtr = kMsgPtr;
-                }
-                KFS_LOG_STREAM_ERROR <<
-                    theParamName << ": " << kMsgPtr <<
-                KFS_LOG_EOM;
-                return -EINVAL;
+        if (theKeyStrPtr && ! DecodeKey(
+                theKeyStrPtr->GetPtr(), theKeyStrPtr->GetSize(), thePskKey)) {
+            const char* const kMsgPtr = "psk: invalid key encoding";
+            if (outErrMsgPtr) {
+                *outErrMsgPtr = kMsgPtr;
             }
-            thePskKey.assign(thePtr, theLen);
+            KFS_LOG_STREAM_ERROR <<
+                theParamName << ": " << kMsgPtr <<
+            KFS_LOG_EOM;
+            return -EINVAL;
         }
         const bool theCreatSslPskFlag =
             theParams.getValue(
@@ -320,9 +332,22 @@ public:
             KFS_LOG_EOM;
             return -EINVAL;
         }
+        const bool theCSClearTextMacFlag = theParams.getValue(
+            theParamName.Truncate(thePrefLen).Append(
+                "chunkServerClearTextMac"), 0) != 0;
         mMaxAuthRetryCount = max(1, theParams.getValue(
             theParamName.Truncate(thePrefLen).Append("maxAuthRetries"),
             mMaxAuthRetryCount));
+        theCurLen = theParamName.Truncate(thePrefLen).Append(
+            "delegationCache.").GetSize();
+        const string theDelegationCacheFileName = theParams.getValue(
+            theParamName.Append("file"), string());
+        mDelegationMinValidSec = max(0, theParams.getValue(
+            theParamName.Truncate(theCurLen).Append("minValidSec"),
+            mDelegationMinValidSec));
+        mDelegationValidForSec = max(0, theParams.getValue(
+            theParamName.Truncate(theCurLen).Append("validForSec"),
+            mDelegationValidForSec));
         mParams.swap(theParams);
         if (theKrbChangedFlag) {
             mKrbClientPtr.swap(theKrbClientPtr);
@@ -345,6 +370,12 @@ public:
         mEnabledFlag           = theEnabledFlag;
         mAuthRequiredFlag      = theAuthRequiredFlag;
         mAllowCSClearTextFlag  = theAllowCSClearTextFlag;
+        mCSClearTextMacFlag    = theCSClearTextMacFlag;
+        if (theDelegationCacheFileName != mDelegationCacheFileName) {
+            mDelegationCacheFileName = theDelegationCacheFileName;
+            ClearDelegation();
+            LoadDelegation();
+        }
         return 0;
     }
     int Request(
@@ -378,6 +409,17 @@ public:
                 kAuthenticationTypePSK, inRequestCtx);
             return 0;
         }
+        if ((inAuthType & kAuthenticationTypePSK) != 0 &&
+                IsDelegationValid()) {
+            // Use cached delegation token instead of kerberos, the token
+            // issued by the meta server with the prior kerberos
+            // authentication, in order to avoid kerberos (and kdc) round trips
+            // and kerberos replay cache lookups on the server.
+            outAuthType = RequestInFlight(
+                kAuthenticationTypePSK, inRequestCtx);
+            mCurRequest.mDelegationFlag = true;
+            return 0;
+        }
         if ((inAuthType & kAuthenticationTypeKrb5) != 0 && mKrbClientPtr) {
             const char* const theErrMsgPtr = mKrbClientPtr->Request(
                 outBufPtr,
@@ -502,6 +544,13 @@ public:
             delete &theFilter;
             return -EFAULT;
         }
+        if (mCSClearTextMacFlag) {
+            // Only chunk server connections are shutdown after the
+            // authentication, the shutdown filter has no effect otherwise.
+            const bool kServerFlag = false;
+            theFilter.SetShutdownFilter(new MacFilter(
+                inKeyDataPtr, inKeyDataSize, kServerFlag));
+        }
         return inNetConnection.SetFilter(&theFilter, outErrMsgPtr);
     }
     bool IsChunkServerClearTextAllowed() const
@@ -520,7 +569,8 @@ public:
             return 0;
         }
         outDoAuthFlag = true;
-        if (((inAuthType & kAuthenticationTypePSK) != 0 && ! mPskKey.empty()) ||
+        if (((inAuthType & kAuthenticationTypePSK) != 0 &&
+                    (! mPskKey.empty() || IsDelegationValid())) ||
                 ((inAuthType & kAuthenticationTypeNone) != 0 &&
                     mAuthNoneEnabledFlag) ||
                 ((inAuthType & kAuthenticationTypeKrb5) != 0 &&
@@ -536,7 +586,100 @@ public:
         return -EPERM;
     }
     string GetPskId() const
-        { return mPskKeyId; }
+    {
+        return ((mPskKey.empty() && ! mDelegationKey.empty()) ?
+            mDelegationKeyId : mPskKeyId);
+    }
+    bool IsDelegationCacheUpdateNeeded() const
+    {
+        return (! mDelegationCacheFileName.empty() && mPskKey.empty() &&
+            mKrbClientPtr && ! IsDelegationValid());
+    }
+    int GetDelegationCacheValidForSec() const
+        { return mDelegationValidForSec; }
+    int SetDelegation(
+        const string& inToken,
+        const string& inKey,
+        string*       outErrMsgPtr)
+    {
+        if (mDelegationCacheFileName.empty()) {
+            if (outErrMsgPtr) {
+                *outErrMsgPtr = "delegation cache is not configured";
+            }
+            return -EINVAL;
+        }
+        if (! SetDelegationSelf(inToken, inKey)) {
+            if (outErrMsgPtr) {
+                *outErrMsgPtr = "invalid delegation token or key";
+            }
+            return -EINVAL;
+        }
+        // Write into temporary file, and rename in order to ensure that
+        // readers, possibly other processes, never see partial content.
+        string theTmpName = mDelegationCacheFileName;
+        theTmpName += ".tmp";
+        const int theFd = open(theTmpName.c_str(),
+            O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        if (theFd < 0) {
+            const int theErr = errno;
+            if (outErrMsgPtr) {
+                *outErrMsgPtr = theTmpName + ": " + QCUtils::SysError(theErr);
+            }
+            return (0 < theErr ? -theErr : -EIO);
+        }
+        string theContent = inToken;
+        theContent += " ";
+        theContent += inKey;
+        theContent += "\n";
+        const char*       thePtr = theContent.data();
+        const char* const theEndPtr = thePtr + theContent.size();
+        int               theErr    = 0;
+        while (thePtr < theEndPtr) {
+            const ssize_t theNWr = write(theFd, thePtr, theEndPtr - thePtr);
+            if (theNWr < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                theErr = errno;
+                break;
+            }
+            thePtr += theNWr;
+        }
+        if (close(theFd) && ! theErr) {
+            theErr = errno;
+        }
+        if (! theErr && rename(theTmpName.c_str(),
+                mDelegationCacheFileName.c_str())) {
+            theErr = errno;
+        }
+        if (theErr) {
+            if (outErrMsgPtr) {
+                *outErrMsgPtr = mDelegationCacheFileName + ": " +
+                    QCUtils::SysError(theErr);
+            }
+            unlink(theTmpName.c_str());
+            return (0 < theErr ? -theErr : -EIO);
+        }
+        return 0;
+    }
+    void InvalidateDelegation(
+        const string& inKeyId)
+    {
+        if (mDelegationKey.empty() || inKeyId != mDelegationKeyId) {
+            return;
+        }
+        KFS_LOG_STREAM_INFO <<
+            mDelegationCacheFileName << ": invalidating delegation token" <<
+        KFS_LOG_EOM;
+        ClearDelegation();
+        // Remove the file only if it still has the same token, as other
+        // process might have already updated it.
+        string theKeyId;
+        string theKey;
+        if (ReadDelegation(theKeyId, theKey) && theKeyId == inKeyId) {
+            unlink(mDelegationCacheFileName.c_str());
+        }
+    }
     static void Dispose(
         RequestCtx& inRequestCtx)
     {
@@ -589,7 +732,12 @@ public:
         mKrbAuthRequireSslFlag = false;
         mAuthRequiredFlag      = false;
         mAllowCSClearTextFlag  = true;
+        mCSClearTextMacFlag    = false;
         mMaxAuthRetryCount     = 3;
+        mDelegationCacheFileName.clear();
+        mDelegationMinValidSec = 5 * 60;
+        mDelegationValidForSec = 0;
+        ClearDelegation();
     }
 private:
     typedef RequestCtxImpl::KrbClientPtr KrbClientPtr;
@@ -601,6 +749,7 @@ private:
     bool            mKrbAuthRequireSslFlag;
     bool            mAuthRequiredFlag;
     bool            mAllowCSClearTextFlag;
+    bool            mCSClearTextMacFlag;
     int             mMaxAuthRetryCount;
     Properties      mParams;
     KrbClientPtr    mKrbClientPtr;
@@ -609,6 +758,84 @@ private:
     string          mPskKeyId;
     string          mPskKey;
     string          mX509ExpectedName;
+    string          mDelegationCacheFileName;
+    int             mDelegationMinValidSec;
+    int             mDelegationValidForSec;
+    int64_t         mDelegationEndTime;
+    string          mDelegationKeyId;
+    string          mDelegationKey;
+
+    static bool DecodeKey(
+        const char* inPtr,
+        size_t      inLen,
+        string&     outKey)
+    {
+        StBufferT<char, 64> theKeyBuf;
+        char* const thePtr = theKeyBuf.Resize(
+            Base64::GetMaxDecodedLength((int)inLen));
+        const int   theLen = Base64::Decode(inPtr, inLen, thePtr);
+        if (theLen <= 0) {
+            return false;
+        }
+        outKey.assign(thePtr, theLen);
+        return true;
+    }
+    bool IsDelegationValid() const
+    {
+        return (mSslCtxPtr && ! mDelegationKey.empty() &&
+            (int64_t)time(0) + mDelegationMinValidSec < mDelegationEndTime);
+    }
+    void ClearDelegation()
+    {
+        mDelegationEndTime = 0;
+        mDelegationKeyId.clear();
+        mDelegationKey.clear();
+    }
+    bool SetDelegationSelf(
+        const string& inToken,
+        const string& inKey)
+    {
+        ClearDelegation();
+        DelegationToken theToken;
+        string          theKey;
+        if (inToken.empty() || ! theToken.FromString(inToken, 0, 0) ||
+                ! DecodeKey(inKey.data(), inKey.size(), theKey)) {
+            return false;
+        }
+        mDelegationEndTime =
+            theToken.GetIssuedTime() + theToken.GetValidForSec();
+        mDelegationKeyId   = inToken;
+        mDelegationKey     = theKey;
+        return true;
+    }
+    bool ReadDelegation(
+        string& outToken,
+        string& outKey) const
+    {
+        ifstream theStream(mDelegationCacheFileName.c_str());
+        return (theStream && (theStream >> outToken >> outKey));
+    }
+    void LoadDelegation()
+    {
+        if (mDelegationCacheFileName.empty()) {
+            return;
+        }
+        string theToken;
+        string theKey;
+        if (! ReadDelegation(theToken, theKey)) {
+            return;
+        }
+        if (! SetDelegationSelf(theToken, theKey)) {
+            KFS_LOG_STREAM_ERROR <<
+                mDelegationCacheFileName << ": invalid delegation token" <<
+            KFS_LOG_EOM;
+            return;
+        }
+        KFS_LOG_STREAM_DEBUG <<
+            mDelegationCacheFileName << ": loaded delegation token"
+            " valid: " << IsDelegationValid() <<
+        KFS_LOG_EOM;
+    }
 
     int RequestInFlight(
         int         inAuthType,
@@ -659,6 +886,22 @@ private:
             return -EINVAL;
         }
         if (inAuthType == kAuthenticationTypePSK) {
+            if (mCurRequest.mDelegationFlag) {
+                if (mDelegationKey.empty()) {
+                    if (outErrMsgPtr) {
+                        *outErrMsgPtr =
+                            "delegation token was invalidated, try again";
+                    }
+                    return -EAGAIN;
+                }
+                return StartSsl(
+                    inNetConnection,
+                    mDelegationKeyId.c_str(),
+                    mDelegationKey.data(),
+                    (int)mDelegationKey.size(),
+                    outErrMsgPtr
+                );
+            }
             return StartSsl(
                 inNetConnection,
                 mPskKeyId.c_str(),
@@ -857,6 +1100,34 @@ ClientAuthContext::Dispose(
     Impl::Dispose(inRequestCtxImpl);
 }
 
+    bool
+ClientAuthContext::IsDelegationCacheUpdateNeeded() const
+{
+    return mImpl.IsDelegationCacheUpdateNeeded();
+}
+
+    int
+ClientAuthContext::GetDelegationCacheValidForSec() const
+{
+    return mImpl.GetDelegationCacheValidForSec();
+}
+
+    int
+ClientAuthContext::SetDelegation(
+    const string& inToken,
+    const string& inKey,
+    string*       outErrMsgPtr)
+{
+    return mImpl.SetDelegation(inToken, inKey, outErrMsgPtr);
+}
+
+    void
+ClientAuthContext::InvalidateDelegation(
+    const string& inKeyId)
+{
+    mImpl.InvalidateDelegation(inKeyId);
+}
+
     bool
 ClientAuthContext::GetX509EndTime(
     int64_t& outEndTime) const
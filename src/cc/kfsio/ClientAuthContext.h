@@ -106,6 +106,23 @@ public:
     string GetPskId() const;
     bool GetX509EndTime(
         int64_t& outEndTime) const;
+    // Delegation token cache, configured with <prefix>delegationCache.file.
+    // The cached token is used as tls psk instead of kerberos, and is
+    // shared by all client processes that run with the same configuration.
+    // Returns true if kerberos is configured, and the cached token is
+    // missing or about to expire.
+    bool IsDelegationCacheUpdateNeeded() const;
+    int GetDelegationCacheValidForSec() const;
+    // Sets, and writes into the cache file the token and base64 encoded key
+    // issued by the meta server.
+    int SetDelegation(
+        const string& inToken,
+        const string& inKey,
+        string*       outErrMsgPtr);
+    // Discards, and removes the cache file, if the key id matches the cached
+    // token, to force kerberos authentication with the next attempt.
+    void InvalidateDelegation(
+        const string& inKeyId);
     void Clear();
 private:
     Impl& mImpl;
@@ -40,6 +40,9 @@ Globals_t::Globals_t()
       ctrOpenDiskFds     ("Open disk fds"),
       ctrNetBytesRead    ("Bytes read from network"),
       ctrNetBytesWritten ("Bytes written to network"),
+      ctrNetReadCalls    ("Network read calls"),
+      ctrNetWriteCalls   ("Network write calls"),
+      ctrBufferBytesCopied("Bytes copied between io buffers"),
       ctrDiskBytesRead   ("Bytes read from disk"),
       ctrDiskBytesWritten("Bytes written to disk"),
       ctrDiskIOErrors    ("Disk I/O errors"),
@@ -51,6 +54,9 @@ Globals_t::Globals_t()
     counterManager.AddCounter(&ctrOpenDiskFds);
     counterManager.AddCounter(&ctrNetBytesRead);
     counterManager.AddCounter(&ctrNetBytesWritten);
+    counterManager.AddCounter(&ctrNetReadCalls);
+    counterManager.AddCounter(&ctrNetWriteCalls);
+    counterManager.AddCounter(&ctrBufferBytesCopied);
     counterManager.AddCounter(&ctrDiskBytesRead);
     counterManager.AddCounter(&ctrDiskBytesWritten);
     counterManager.AddCounter(&ctrDiskIOErrors);
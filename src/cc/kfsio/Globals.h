@@ -44,6 +44,12 @@ struct Globals_t
     Counter ctrOpenDiskFds;
     Counter ctrNetBytesRead;
     Counter ctrNetBytesWritten;
+    // network read / write system calls, to track bytes per call
+    Counter ctrNetReadCalls;
+    Counter ctrNetWriteCalls;
+    // payload copies between io buffers, mostly by MakeBuffersFull() and
+    // ReplaceKeepBuffersFull(); buffer sharing methods do not copy
+    Counter ctrBufferBytesCopied;
     Counter ctrDiskBytesRead;
     Counter ctrDiskBytesWritten;
     // track the # of failed read/writes
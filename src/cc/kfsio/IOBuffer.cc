@@ -417,8 +417,12 @@ int
 IOBufferData::CopyIn(const IOBufferData *other, int numBytes)
 {
     const int nbytes = MaxAvailable(min(numBytes, other->BytesConsumable()));
+    if (nbytes <= 0) {
+        return 0;
+    }
     memmove(mProducer, other->mConsumer, nbytes);
     mProducer += nbytes;
+    globals().ctrBufferBytesCopied.Update(nbytes);
     return nbytes;
 }
 
@@ -1179,6 +1183,7 @@ IOBuffer::Read(int fd, int maxReadAhead, IOBuffer::Reader* reader)
             const int nRd = reader ?
                 reader->Read(fd, it->Producer(), maxReadAhead) :
                 it->Read(fd, maxReadAhead);
+            globals().ctrNetReadCalls.Update(1);
             if (nRd > 0) {
                 mByteCount += nRd;
                 if (reader) {
@@ -1235,6 +1240,7 @@ IOBuffer::Read(int fd, int maxReadAhead, IOBuffer::Reader* reader)
         const ssize_t nRd = reader ?
             reader->Read(fd, readVec[0].iov_base, readVec[0].iov_len) :
             readv(fd, readVec, nVec);
+        globals().ctrNetReadCalls.Update(1);
         if (nRd < numRead) {
             maxRead = 0; // short read, eof, or error: we're done
         } else if (maxRead > 0) {
@@ -1292,9 +1298,11 @@ int
 IOBuffer::Write(int fd)
 {
     DebugVerify();
-    const int    kMaxWritevBufs      = 32;
+    // Large enough to write at least 256KB with the default 4KB buffers
+    // with a single write system call, if the socket buffer permits.
+    const int    kMaxWritevBufs      = 72;
     const int    maxWriteBufs        = min(IOV_MAX, kMaxWritevBufs);
-    const int    kPreferredWriteSize = 64 << 10;
+    const int    kPreferredWriteSize = 256 << 10;
     struct iovec writeVec[kMaxWritevBufs];
     ssize_t      totWr = 0;
 
@@ -1323,6 +1331,7 @@ IOBuffer::Write(int fd)
             break;
         }
         const ssize_t nWr = writev(fd, writeVec, nVec);
+        globals().ctrNetWriteCalls.Update(1);
         if (nWr == toWr && it == mBuf.end()) {
             mBuf.clear();
         } else {
@@ -28,8 +28,13 @@
 #define KFSIO_IOBUFFER_WRITER_H
 
 #include "IOBuffer.h"
+#include "common/IntToString.h"
+
 #include <string.h>
 
+#include <ostream>
+#include <string>
+
 namespace KFS
 {
 
@@ -117,6 +122,83 @@ private:
         const IOBufferWriter&);
 };
 
+// Formats request / response header fields into the local buffer, and writes
+// the buffer into the stream with a single write() call, when the buffer is
+// full, and on Flush() or destruction. With IOBuffer::WOStream, the write()
+// copies the buffer directly into the IOBuffer space. This avoids ostream
+// integer formatting, and the stream buffer call per header field and value.
+// The writes into the stream and into the writer must not be interleaved,
+// unless Flush() is invoked prior to writing into the stream.
+class IOBufferHeaderWriter
+{
+public:
+    IOBufferHeaderWriter(
+        std::ostream& inStream)
+        : mStream(inStream),
+          mCurPtr(mBuf)
+        {}
+    ~IOBufferHeaderWriter()
+        { IOBufferHeaderWriter::Flush(); }
+    void Write(
+        const char* inDataPtr,
+        size_t      inLength)
+    {
+        if (mBuf + kBufSize < mCurPtr + inLength) {
+            Flush();
+            if (kBufSize < inLength) {
+                mStream.write(inDataPtr, (std::streamsize)inLength);
+                return;
+            }
+        }
+        memcpy(mCurPtr, inDataPtr, inLength);
+        mCurPtr += inLength;
+    }
+    template<size_t TSize>
+    void Write(
+        const char (&inStr)[TSize])
+        { Write(inStr, TSize - 1); }
+    void Write(
+        const std::string& inStr)
+        { Write(inStr.data(), inStr.size()); }
+    template<typename T>
+    void WriteInt(
+        T inVal)
+    {
+        char        theBuf[kMaxIntLength];
+        char* const theEndPtr = theBuf + kMaxIntLength;
+        const char* thePtr    = IntToDecString(inVal, theEndPtr);
+        Write(thePtr, theEndPtr - thePtr);
+    }
+    template<typename T>
+    void WriteHexInt(
+        T inVal)
+    {
+        char        theBuf[kMaxIntLength];
+        char* const theEndPtr = theBuf + kMaxIntLength;
+        const char* thePtr    = IntToHexString(inVal, theEndPtr);
+        Write(thePtr, theEndPtr - thePtr);
+    }
+    void Flush()
+    {
+        if (mBuf < mCurPtr) {
+            mStream.write(mBuf, (std::streamsize)(mCurPtr - mBuf));
+            mCurPtr = mBuf;
+        }
+    }
+private:
+    enum { kBufSize      = 1 << 10 };
+    enum { kMaxIntLength = 32 };
+
+    std::ostream& mStream;
+    char*         mCurPtr;
+    char          mBuf[kBufSize];
+private:
+    IOBufferHeaderWriter(
+        const IOBufferHeaderWriter&);
+    IOBufferHeaderWriter& operator=(
+        const IOBufferHeaderWriter&);
+};
+
 }
 
 #endif /* KFSIO_IOBUFFER_WRITER_H */
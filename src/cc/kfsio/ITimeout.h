@@ -83,6 +83,10 @@ public:
     /// Whenever a timer expires (viz., a call to select returns),
     /// this method gets invoked.  Depending on the time-interval
     /// specified, the timeout is appropriately invoked.
+    bool IsExpired(int64_t nowMs) const {
+        return (! mDisabled &&
+            (mIntervalMs <= 0 || nowMs >= mLastCall + mIntervalMs));
+    }
     void TimerExpired(int64_t nowMs) {
         if (mDisabled) {
             return;
@@ -0,0 +1,575 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/14
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Clear text, message authentication code protected, network
+// communication filter.
+//
+//----------------------------------------------------------------------------
+
+#include "MacFilter.h"
+
+#include "IOBuffer.h"
+#include "TcpSocket.h"
+#include "CryptoKeys.h"
+#include "common/MsgLogger.h"
+
+#include <openssl/evp.h>
+#include <openssl/crypto.h>
+
+#include <errno.h>
+#include <string.h>
+
+#include <string>
+#include <algorithm>
+
+namespace KFS
+{
+using std::string;
+using std::max;
+using std::min;
+
+class MacFilter::Impl
+{
+public:
+    Impl(
+        const char* inKeyPtr,
+        int         inKeyLen,
+        bool        inServerFlag,
+        bool        inRequiredFlag,
+        bool        inDeleteOnCloseFlag)
+        : mKey(inKeyPtr ? inKeyPtr : "", inKeyPtr ? max(0, inKeyLen) : 0),
+          mRdBuffer(),
+          mWrBuffer(),
+          mRdCtxPtr(0),
+          mWrCtxPtr(0),
+          mRdSeq(0),
+          mWrSeq(0),
+          mError(0),
+          mErrorMsg(),
+          mServerFlag(inServerFlag),
+          mRequiredFlag(inRequiredFlag),
+          mDeleteOnCloseFlag(inDeleteOnCloseFlag),
+          mActiveFlag(false),
+          mPassThroughFlag(false),
+          mAuthFailureFlag(false)
+    {
+        if (mKey.empty()) {
+            SetError(-EINVAL, "empty message authentication key");
+        } else if (! CryptoKeys::PseudoRand(mNonce, kNonceSize)) {
+            SetError(-EFAULT, "failed to generate nonce");
+        }
+    }
+    ~Impl()
+    {
+        Cleanup(mRdCtxPtr);
+        Cleanup(mWrCtxPtr);
+        if (! mKey.empty()) {
+            memset(&mKey[0], 0, mKey.size());
+        }
+    }
+    bool WantRead(
+        const NetConnection& inConnection) const
+    {
+        return (mError == 0 && (inConnection.IsReadReady() ||
+            (! mActiveFlag && ! mPassThroughFlag)));
+    }
+    bool WantWrite(
+        const NetConnection& inConnection) const
+    {
+        return (mError == 0 && (! mWrBuffer.IsEmpty() ||
+            ((mActiveFlag || mPassThroughFlag) && inConnection.IsWriteReady()))
+        );
+    }
+    int Read(
+        NetConnection& inConnection,
+        TcpSocket&     inSocket,
+        IOBuffer&      inIoBuffer,
+        int            inMaxRead)
+    {
+        if (mError) {
+            return mError;
+        }
+        if (mPassThroughFlag) {
+            return inIoBuffer.Read(inSocket.GetFd(), inMaxRead);
+        }
+        const int theRdRet = mRdBuffer.Read(inSocket.GetFd(),
+            inMaxRead < 0 ? inMaxRead :
+                max(int(kHelloSize), inMaxRead) + kFrameOverhead);
+        int theRet = 0;
+        if (! mActiveFlag && (theRet = ReadHello(inIoBuffer)) != 0) {
+            return theRet;
+        }
+        while (mActiveFlag) {
+            const int theAvail = mRdBuffer.BytesConsumable();
+            if (theAvail < kHeaderSize) {
+                break;
+            }
+            unsigned char theHeader[kHeaderSize];
+            mRdBuffer.CopyOut(reinterpret_cast<char*>(theHeader), kHeaderSize);
+            const int theLen = (int)GetUInt32(theHeader);
+            if (theLen <= 0 || kMaxFrameSize < theLen) {
+                return SetError(-EBADMSG, "invalid frame length");
+            }
+            if (theAvail < theLen + kFrameOverhead) {
+                break;
+            }
+            mRdBuffer.Consume(kHeaderSize);
+            IOBuffer      thePayload;
+            unsigned char theTag[kTagSize];
+            unsigned char theExpectedTag[kTagSize];
+            thePayload.Move(&mRdBuffer, theLen);
+            mRdBuffer.CopyOut(reinterpret_cast<char*>(theTag), kTagSize);
+            mRdBuffer.Consume(kTagSize);
+            if (! ComputeTag(mRdCtxPtr, mServerFlag ? kClientToServer :
+                    kServerToClient, mRdSeq++, theHeader, thePayload, theLen,
+                    theExpectedTag)) {
+                return mError;
+            }
+            if (CRYPTO_memcmp(theTag, theExpectedTag, kTagSize) != 0) {
+                mAuthFailureFlag = true;
+                return SetError(-EBADMSG, "message authentication failure");
+            }
+            inIoBuffer.Move(&thePayload);
+            theRet += theLen;
+        }
+        if (0 < theRet) {
+            return theRet;
+        }
+        if (theRdRet == 0 && ! mRdBuffer.IsEmpty()) {
+            return SetError(-EBADMSG, "connection closed with partial frame");
+        }
+        return (theRdRet <= 0 ? theRdRet : -EAGAIN);
+    }
+    int Write(
+        NetConnection& inConnection,
+        TcpSocket&     inSocket,
+        IOBuffer&      inIoBuffer,
+        bool&          outForceInvokeErrHandlerFlag)
+    {
+        outForceInvokeErrHandlerFlag = false;
+        if (mError) {
+            return mError;
+        }
+        if (mPassThroughFlag && mWrBuffer.IsEmpty()) {
+            return inIoBuffer.Write(inSocket.GetFd());
+        }
+        int theRet = 0;
+        for (; ;) {
+            // Limit the amount of the framed data in order to let the
+            // connection owner to see the actual amount of pending data.
+            while (mActiveFlag && ! inIoBuffer.IsEmpty() &&
+                    mWrBuffer.BytesConsumable() < kMaxWriteQueueSize) {
+                const int theLen =
+                    min(int(kMaxFrameSize), inIoBuffer.BytesConsumable());
+                unsigned char theHeader[kHeaderSize];
+                unsigned char theTag[kTagSize];
+                PutUInt32(theHeader, (uint32_t)theLen);
+                if (! ComputeTag(mWrCtxPtr, mServerFlag ? kServerToClient :
+                        kClientToServer, mWrSeq++, theHeader, inIoBuffer,
+                        theLen, theTag)) {
+                    return mError;
+                }
+                mWrBuffer.CopyIn(reinterpret_cast<const char*>(theHeader),
+                    kHeaderSize);
+                mWrBuffer.Move(&inIoBuffer, theLen);
+                mWrBuffer.CopyIn(reinterpret_cast<const char*>(theTag),
+                    kTagSize);
+                theRet += theLen;
+            }
+            if (mWrBuffer.IsEmpty()) {
+                break;
+            }
+            const int theWrRet = mWrBuffer.Write(inSocket.GetFd());
+            if (theWrRet <= 0) {
+                if (theWrRet < 0 && (theRet <= 0 || IsFatalError(-theWrRet))) {
+                    return theWrRet;
+                }
+                break;
+            }
+            if (theRet <= 0) {
+                // Hello or previously framed data.
+                theRet = theWrRet;
+            }
+            if (! mWrBuffer.IsEmpty() || inIoBuffer.IsEmpty()) {
+                break;
+            }
+        }
+        if (mPassThroughFlag && mWrBuffer.IsEmpty() && ! inIoBuffer.IsEmpty()) {
+            const int theWrRet = inIoBuffer.Write(inSocket.GetFd());
+            if (theWrRet < 0 && (theRet <= 0 || IsFatalError(-theWrRet))) {
+                return theWrRet;
+            }
+            theRet += max(0, theWrRet);
+        }
+        return theRet;
+    }
+    void Close(
+        NetConnection& inConnection,
+        MacFilter&     inOuter)
+    {
+        inConnection.SetFilter(0, 0);
+        if (mDeleteOnCloseFlag) {
+            delete &inOuter;
+        }
+        inConnection.Close();
+    }
+    int Shutdown(
+        NetConnection& /* inConnection */,
+        TcpSocket&     inSocket)
+        { return inSocket.Shutdown(); }
+    int Attach(
+        NetConnection& inConnection,
+        TcpSocket*     inSocketPtr,
+        string*        outErrMsgPtr)
+    {
+        if (! inSocketPtr || ! inSocketPtr->IsGood()) {
+            if (outErrMsgPtr) {
+                *outErrMsgPtr = "no tcp socket";
+            }
+            return -EINVAL;
+        }
+        if (mError) {
+            if (outErrMsgPtr) {
+                *outErrMsgPtr = mErrorMsg;
+            }
+            return mError;
+        }
+        if (! mServerFlag && mWrSeq == 0 && mWrBuffer.IsEmpty()) {
+            WriteHello();
+            inConnection.Update();
+        }
+        return 0;
+    }
+    bool IsAuthFailure() const
+        { return mAuthFailureFlag; }
+    string GetErrorMsg() const
+        { return mErrorMsg; }
+    int GetErrorCode() const
+        { return mError; }
+    bool IsActive() const
+        { return mActiveFlag; }
+private:
+    enum
+    {
+        kHeaderSize        = 4,
+        kTagSize           = 16,
+        kNonceSize         = 16,
+        kMagicSize         = 8,
+        kHelloSize         = kMagicSize + kNonceSize,
+        kFrameOverhead     = kHeaderSize + kTagSize,
+        kMaxWriteQueueSize = 4 * kMaxFrameSize
+    };
+    enum Direction
+    {
+        kClientToServer = 1,
+        kServerToClient = 2
+    };
+    static const char* const kMagicPtr;
+
+    string          mKey;
+    IOBuffer        mRdBuffer;
+    IOBuffer        mWrBuffer;
+    EVP_CIPHER_CTX* mRdCtxPtr;
+    EVP_CIPHER_CTX* mWrCtxPtr;
+    uint64_t        mRdSeq;
+    uint64_t        mWrSeq;
+    int             mError;
+    string          mErrorMsg;
+    const bool      mServerFlag;
+    const bool      mRequiredFlag;
+    const bool      mDeleteOnCloseFlag;
+    bool            mActiveFlag;
+    bool            mPassThroughFlag;
+    bool            mAuthFailureFlag;
+    unsigned char   mNonce[kNonceSize];
+
+    static bool IsFatalError(
+        int inErr)
+        { return (inErr != EAGAIN && inErr != EWOULDBLOCK && inErr != EINTR); }
+    static uint32_t GetUInt32(
+        const unsigned char* inPtr)
+    {
+        return (
+            (uint32_t)inPtr[0] << 24 |
+            (uint32_t)inPtr[1] << 16 |
+            (uint32_t)inPtr[2] << 8  |
+            (uint32_t)inPtr[3]
+        );
+    }
+    static void PutUInt32(
+        unsigned char* inPtr,
+        uint32_t       inVal)
+    {
+        inPtr[0] = (unsigned char)(inVal >> 24);
+        inPtr[1] = (unsigned char)(inVal >> 16);
+        inPtr[2] = (unsigned char)(inVal >> 8);
+        inPtr[3] = (unsigned char)inVal;
+    }
+    static void Cleanup(
+        EVP_CIPHER_CTX*& ioCtxPtr)
+    {
+        if (ioCtxPtr) {
+            EVP_CIPHER_CTX_free(ioCtxPtr);
+            ioCtxPtr = 0;
+        }
+    }
+    int SetError(
+        int         inError,
+        const char* inMsgPtr)
+    {
+        mError    = inError;
+        mErrorMsg = inMsgPtr;
+        KFS_LOG_STREAM_ERROR <<
+            "mac filter: " << mErrorMsg <<
+        KFS_LOG_EOM;
+        return mError;
+    }
+    void WriteHello()
+    {
+        mWrBuffer.CopyIn(kMagicPtr, kMagicSize);
+        mWrBuffer.CopyIn(reinterpret_cast<const char*>(mNonce), kNonceSize);
+    }
+    int ReadHello(
+        IOBuffer& inIoBuffer)
+    {
+        char      theHello[kHelloSize];
+        const int theLen = mRdBuffer.CopyOut(theHello, kHelloSize);
+        if (memcmp(theHello, kMagicPtr, min(theLen, int(kMagicSize))) != 0) {
+            if (! mServerFlag || mRequiredFlag) {
+                mAuthFailureFlag = true;
+                return SetError(-EPERM, "no message authentication hello");
+            }
+            // Peer does not support message authentication.
+            mPassThroughFlag = true;
+            const int theRet = mRdBuffer.BytesConsumable();
+            inIoBuffer.Move(&mRdBuffer);
+            return theRet;
+        }
+        if (theLen < kHelloSize) {
+            return 0;
+        }
+        mRdBuffer.Consume(kHelloSize);
+        const unsigned char* const thePeerNoncePtr =
+            reinterpret_cast<const unsigned char*>(theHello + kMagicSize);
+        if (! InitKey(
+                mServerFlag ? thePeerNoncePtr : mNonce,
+                mServerFlag ? mNonce : thePeerNoncePtr)) {
+            return mError;
+        }
+        if (mServerFlag) {
+            WriteHello();
+        }
+        mActiveFlag = true;
+        return 0;
+    }
+    bool InitKey(
+        const unsigned char* inClientNoncePtr,
+        const unsigned char* inServerNoncePtr)
+    {
+        string theData(kMagicPtr, kMagicSize);
+        theData.append(mKey);
+        theData.append(reinterpret_cast<const char*>(inClientNoncePtr),
+            kNonceSize);
+        theData.append(reinterpret_cast<const char*>(inServerNoncePtr),
+            kNonceSize);
+        unsigned char theMd[EVP_MAX_MD_SIZE];
+        unsigned int  theMdLen = 0;
+        const bool    theOkFlag = EVP_Digest(theData.data(), theData.size(),
+            theMd, &theMdLen, EVP_sha256(), 0) && 16 <= theMdLen;
+        memset(&theData[0], 0, theData.size());
+        if (! theOkFlag) {
+            SetError(-EFAULT, "message authentication key derivation failure");
+            return false;
+        }
+        const EVP_CIPHER* const theCipherPtr = EVP_aes_128_gcm();
+        if (! (mRdCtxPtr = EVP_CIPHER_CTX_new()) ||
+                ! (mWrCtxPtr = EVP_CIPHER_CTX_new()) ||
+                ! EVP_EncryptInit_ex(mRdCtxPtr, theCipherPtr, 0, theMd, 0) ||
+                ! EVP_EncryptInit_ex(mWrCtxPtr, theCipherPtr, 0, theMd, 0)) {
+            memset(theMd, 0, sizeof(theMd));
+            SetError(-EFAULT, "message authentication context init failure");
+            return false;
+        }
+        memset(theMd, 0, sizeof(theMd));
+        return true;
+    }
+    bool ComputeTag(
+        EVP_CIPHER_CTX*      inCtxPtr,
+        Direction            inDirection,
+        uint64_t             inSeq,
+        const unsigned char* inHeaderPtr,
+        const IOBuffer&      inBuffer,
+        int                  inLen,
+        unsigned char*       outTagPtr)
+    {
+        unsigned char theIv[12];
+        PutUInt32(theIv, (uint32_t)inDirection);
+        PutUInt32(theIv + 4, (uint32_t)(inSeq >> 32));
+        PutUInt32(theIv + 8, (uint32_t)inSeq);
+        int theOutLen = 0;
+        if (! EVP_EncryptInit_ex(inCtxPtr, 0, 0, 0, theIv) ||
+                ! EVP_EncryptUpdate(
+                    inCtxPtr, 0, &theOutLen, inHeaderPtr, kHeaderSize)) {
+            SetError(-EFAULT, "message authentication failure");
+            return false;
+        }
+        int theRem = inLen;
+        for (IOBuffer::iterator theIt = inBuffer.begin();
+                0 < theRem && theIt != inBuffer.end();
+                ++theIt) {
+            const int theLen = min(theRem, theIt->BytesConsumable());
+            if (theLen <= 0) {
+                continue;
+            }
+            if (! EVP_EncryptUpdate(inCtxPtr, 0, &theOutLen,
+                    reinterpret_cast<const unsigned char*>(theIt->Consumer()),
+                    theLen)) {
+                SetError(-EFAULT, "message authentication failure");
+                return false;
+            }
+            theRem -= theLen;
+        }
+        unsigned char theFinal[16];
+        if (0 < theRem ||
+                ! EVP_EncryptFinal_ex(inCtxPtr, theFinal, &theOutLen) ||
+                ! EVP_CIPHER_CTX_ctrl(inCtxPtr, EVP_CTRL_GCM_GET_TAG,
+                    kTagSize, outTagPtr)) {
+            SetError(-EFAULT, "message authentication failure");
+            return false;
+        }
+        return true;
+    }
+private:
+    Impl(
+        const Impl& inImpl);
+    Impl& operator=(
+        const Impl& inImpl);
+};
+
+const char* const MacFilter::Impl::kMagicPtr = "QFSMAC1\n";
+
+MacFilter::MacFilter(
+    const char* inKeyPtr,
+    int         inKeyLen,
+    bool        inServerFlag,
+    bool        inRequiredFlag,
+    bool        inDeleteOnCloseFlag)
+    : NetConnection::Filter(),
+      mImpl(*(new Impl(
+        inKeyPtr,
+        inKeyLen,
+        inServerFlag,
+        inRequiredFlag,
+        inDeleteOnCloseFlag
+    )))
+    {}
+
+    /* virtual */
+MacFilter::~MacFilter()
+{
+    delete &mImpl;
+}
+
+    /* virtual */ bool
+MacFilter::WantRead(
+    const NetConnection& inConnection) const
+{
+    return mImpl.WantRead(inConnection);
+}
+
+    /* virtual */ bool
+MacFilter::WantWrite(
+    const NetConnection& inConnection) const
+{
+    return mImpl.WantWrite(inConnection);
+}
+
+    /* virtual */ int
+MacFilter::Read(
+    NetConnection& inConnection,
+    TcpSocket&     inSocket,
+    IOBuffer&      inIoBuffer,
+    int            inMaxRead)
+{
+    return mImpl.Read(inConnection, inSocket, inIoBuffer, inMaxRead);
+}
+
+    /* virtual */ int
+MacFilter::Write(
+    NetConnection& inConnection,
+    TcpSocket&     inSocket,
+    IOBuffer&      inIoBuffer,
+    bool&          outForceInvokeErrHandlerFlag)
+{
+    return mImpl.Write(inConnection, inSocket, inIoBuffer,
+        outForceInvokeErrHandlerFlag);
+}
+
+    /* virtual */ void
+MacFilter::Close(
+    NetConnection& inConnection,
+    TcpSocket*     /* inSocketPtr */)
+{
+    mImpl.Close(inConnection, *this);
+}
+
+    /* virtual */ int
+MacFilter::Shutdown(
+    NetConnection& inConnection,
+    TcpSocket&     inSocket)
+{
+    return mImpl.Shutdown(inConnection, inSocket);
+}
+
+    /* virtual */ int
+MacFilter::Attach(
+    NetConnection& inConnection,
+    TcpSocket*     inSocketPtr,
+    string*        outErrMsgPtr)
+{
+    return mImpl.Attach(inConnection, inSocketPtr, outErrMsgPtr);
+}
+
+    /* virtual */ bool
+MacFilter::IsAuthFailure() const
+{
+    return mImpl.IsAuthFailure();
+}
+
+    /* virtual */ string
+MacFilter::GetErrorMsg() const
+{
+    return mImpl.GetErrorMsg();
+}
+
+    /* virtual */ int
+MacFilter::GetErrorCode() const
+{
+    return mImpl.GetErrorCode();
+}
+
+    bool
+MacFilter::IsActive() const
+{
+    return mImpl.IsActive();
+}
+
+}
@@ -0,0 +1,111 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/14
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Clear text, message authentication code protected, network
+// communication filter.
+//
+//----------------------------------------------------------------------------
+
+#ifndef KFS_IO_MAC_FILTER_H
+#define KFS_IO_MAC_FILTER_H
+
+#include "NetConnection.h"
+
+#include <string>
+
+namespace KFS
+{
+using std::string;
+
+// The filter is intended to be installed as ssl filter "shutdown" filter, in
+// order to protect the integrity of the "clear text" communication that
+// follows successful tls authentication with the pre-shared key.
+//
+// The client sends hello with the magic and random nonce, then server responds
+// with its own hello. The message authentication key is derived from the
+// pre-shared key, and both nonces. The data is sent in frames: 4 bytes payload
+// length, payload, and AES-GCM (GMAC) tag computed over the length and payload.
+// The tag nonce is the direction and the frame sequence number, therefore
+// dropped, re-ordered, or replayed frames fail the tag verification.
+//
+// If the server "required" flag is not set, and the data received from
+// the client does not start with the hello, the server filter passes the data
+// through unmodified, in order to allow clients that do not support the
+// message authentication mode.
+class MacFilter : public NetConnection::Filter
+{
+public:
+    enum
+    {
+        kMaxFrameSize = 64 << 10
+    };
+    MacFilter(
+        const char* inKeyPtr,
+        int         inKeyLen,
+        bool        inServerFlag,
+        bool        inRequiredFlag      = true,
+        bool        inDeleteOnCloseFlag = true);
+    virtual ~MacFilter();
+    virtual bool WantRead(
+        const NetConnection& inConnection) const;
+    virtual bool WantWrite(
+        const NetConnection& inConnection) const;
+    virtual int Read(
+        NetConnection& inConnection,
+        TcpSocket&     inSocket,
+        IOBuffer&      inIoBuffer,
+        int            inMaxRead);
+    virtual int Write(
+        NetConnection& inConnection,
+        TcpSocket&     inSocket,
+        IOBuffer&      inIoBuffer,
+        bool&          outForceInvokeErrHandlerFlag);
+    virtual void Close(
+        NetConnection& inConnection,
+        TcpSocket*     inSocketPtr);
+    virtual int Shutdown(
+        NetConnection& inConnection,
+        TcpSocket&     inSocket);
+    virtual int Attach(
+        NetConnection& inConnection,
+        TcpSocket*     inSocketPtr,
+        string*        outErrMsgPtr);
+    virtual bool IsAuthFailure() const;
+    virtual string GetErrorMsg() const;
+    virtual int GetErrorCode() const;
+    virtual bool IsClearText() const
+        { return true; }
+    // Returns true if the message authentication is in effect, i.e. the
+    // peer hello was received, and the data is not passed through.
+    bool IsActive() const;
+private:
+    class Impl;
+    Impl& mImpl;
+private:
+    MacFilter(
+        const MacFilter& inFilter);
+    MacFilter& operator=(
+        const MacFilter& inFilter);
+};
+
+}
+
+#endif /* KFS_IO_MAC_FILTER_H */
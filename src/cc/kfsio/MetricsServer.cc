@@ -0,0 +1,446 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/14
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Http server exporting server counters in OpenMetrics text format.
+//
+//----------------------------------------------------------------------------
+
+#include "MetricsServer.h"
+#include "NetManager.h"
+
+#include "common/Properties.h"
+#include "common/MsgLogger.h"
+#include "qcdio/QCUtils.h"
+#include "qcdio/qcstutils.h"
+
+#include <sstream>
+#include <algorithm>
+
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+
+namespace KFS
+{
+using std::ostringstream;
+using std::max;
+
+    bool
+MetricsServer::Writer::Family(
+    const char* inPrefixPtr,
+    const char* inNamePtr,
+    size_t      inNameLen,
+    const char* inTypePtr)
+{
+    mName = inPrefixPtr ? inPrefixPtr : "";
+    const size_t thePrefixLen = mName.size();
+    const char*  thePtr       = inNamePtr;
+    const char*  theEndPtr    = inNamePtr + inNameLen;
+    while (thePtr < theEndPtr) {
+        const int theSym = *thePtr++ & 0xFF;
+        if (('a' <= theSym && theSym <= 'z') ||
+                ('0' <= theSym && theSym <= '9')) {
+            mName += (char)theSym;
+        } else if ('A' <= theSym && theSym <= 'Z') {
+            mName += (char)(theSym - 'A' + 'a');
+        } else if (thePrefixLen < mName.size() &&
+                mName[mName.size() - 1] != '_') {
+            mName += '_';
+        }
+    }
+    while (thePrefixLen < mName.size() && mName[mName.size() - 1] == '_') {
+        mName.erase(mName.size() - 1);
+    }
+    if (mName.size() <= thePrefixLen ||
+            (mName[0] >= '0' && mName[0] <= '9') ||
+            ! mNames.insert(mName).second) {
+        return false;
+    }
+    mStream << "# TYPE " << mName << " " << inTypePtr << "\n";
+    return true;
+}
+
+    bool
+MetricsServer::Writer::Family(
+    const char* inPrefixPtr,
+    const char* inNamePtr,
+    const char* inTypePtr)
+{
+    return Family(inPrefixPtr, inNamePtr, strlen(inNamePtr), inTypePtr);
+}
+
+    bool
+MetricsServer::Writer::Value(
+    const char* inPrefixPtr,
+    const char* inNamePtr,
+    int64_t     inValue)
+{
+    if (! Family(inPrefixPtr, inNamePtr, "unknown")) {
+        return false;
+    }
+    mStream << mName << " " << inValue << "\n";
+    return true;
+}
+
+    void
+MetricsServer::Writer::Records(
+    const char* inPrefixPtr,
+    const char* inPtr,
+    const char* inEndPtr,
+    char        inNameSeparator,
+    const char* inRecordSeparatorsPtr)
+{
+    string      theValue;
+    const char* thePtr = inPtr;
+    while (thePtr < inEndPtr) {
+        const char* theRecEndPtr = thePtr;
+        while (theRecEndPtr < inEndPtr &&
+                ! strchr(inRecordSeparatorsPtr, *theRecEndPtr)) {
+            ++theRecEndPtr;
+        }
+        const char* const theRecPtr = thePtr;
+        thePtr = theRecEndPtr + 1;
+        const char* theSepPtr = theRecPtr;
+        while (theSepPtr < theRecEndPtr && *theSepPtr != inNameSeparator) {
+            ++theSepPtr;
+        }
+        if (theRecEndPtr <= theSepPtr) {
+            continue;
+        }
+        const char* theValPtr = theSepPtr + 1;
+        while (theValPtr < theRecEndPtr && (*theValPtr & 0xFF) <= ' ') {
+            ++theValPtr;
+        }
+        const char* theValEndPtr = theValPtr;
+        while (theValEndPtr < theRecEndPtr &&
+                ' ' < (*theValEndPtr & 0xFF) && *theValEndPtr != ',') {
+            ++theValEndPtr;
+        }
+        if (theValEndPtr <= theValPtr ||
+                ! (('0' <= *theValPtr && *theValPtr <= '9') ||
+                    *theValPtr == '-' || *theValPtr == '.')) {
+            continue;
+        }
+        // Only trailing white space or comma separated list is allowed.
+        if (theValEndPtr < theRecEndPtr && *theValEndPtr != ',') {
+            const char* theCurPtr = theValEndPtr;
+            while (theCurPtr < theRecEndPtr && (*theCurPtr & 0xFF) <= ' ') {
+                ++theCurPtr;
+            }
+            if (theCurPtr < theRecEndPtr) {
+                continue;
+            }
+        }
+        theValue.assign(theValPtr, theValEndPtr - theValPtr);
+        char* theParseEndPtr = 0;
+        strtod(theValue.c_str(), &theParseEndPtr);
+        if (! theParseEndPtr || *theParseEndPtr != 0) {
+            continue;
+        }
+        if (Family(inPrefixPtr, theRecPtr, theSepPtr - theRecPtr, "unknown")) {
+            mStream << mName << " " << theValue << "\n";
+        }
+    }
+}
+
+MetricsServer::MetricsServer(
+    MetricsServer::Source& inSource)
+    : ITimeout(),
+      QCRunnable(),
+      mSource(inSource),
+      mNetManagerPtr(0),
+      mThread(),
+      mMutex(),
+      mAddress(),
+      mMetrics(),
+      mBuf(),
+      mPort(-1),
+      mUpdateIntervalSec(10),
+      mListenFd(-1),
+      mStopFlag(false)
+{
+}
+
+MetricsServer::~MetricsServer()
+{
+    MetricsServer::Shutdown();
+}
+
+    int
+MetricsServer::SetParameters(
+    const Properties& inProps,
+    const char*       inPrefixPtr,
+    NetManager&       inNetManager)
+{
+    Properties::String theParamName;
+    if (inPrefixPtr) {
+        theParamName.Append(inPrefixPtr);
+    }
+    const size_t theLen = theParamName.GetSize();
+    mUpdateIntervalSec = max(1, inProps.getValue(
+        theParamName.Truncate(theLen).Append("updateIntervalSec"),
+        mUpdateIntervalSec));
+    const int thePort = inProps.getValue(
+        theParamName.Truncate(theLen).Append("port"), mPort);
+    const string theAddress = inProps.getValue(
+        theParamName.Truncate(theLen).Append("address"), mAddress);
+    SetTimeoutInterval(mUpdateIntervalSec * 1000);
+    if (0 <= mListenFd && theAddress == mAddress && thePort == mPort &&
+            &inNetManager == mNetManagerPtr) {
+        return 0;
+    }
+    Shutdown();
+    mAddress = theAddress;
+    mPort    = thePort;
+    if (mPort < 0) {
+        return 0;
+    }
+    const int theStatus = Start(mAddress, mPort);
+    if (theStatus != 0) {
+        return theStatus;
+    }
+    mNetManagerPtr = &inNetManager;
+    Update();
+    mNetManagerPtr->RegisterTimeoutHandler(this);
+    return 0;
+}
+
+    int
+MetricsServer::Start(
+    const string& inAddress,
+    int           inPort)
+{
+    struct addrinfo theHints;
+    memset(&theHints, 0, sizeof(theHints));
+    theHints.ai_family   = AF_UNSPEC;
+    theHints.ai_socktype = SOCK_STREAM;
+    theHints.ai_flags    = AI_PASSIVE | AI_NUMERICSERV;
+    char theService[32];
+    snprintf(theService, sizeof(theService), "%d", inPort);
+    struct addrinfo* theResPtr = 0;
+    const int theErr = getaddrinfo(
+        inAddress.empty() ? 0 : inAddress.c_str(),
+        theService, &theHints, &theResPtr);
+    if (theErr != 0 || ! theResPtr) {
+        KFS_LOG_STREAM_ERROR <<
+            "metrics server: " << inAddress << ":" << inPort <<
+            " " << (theErr ? gai_strerror(theErr) : "no address") <<
+        KFS_LOG_EOM;
+        if (theResPtr) {
+            freeaddrinfo(theResPtr);
+        }
+        return -EINVAL;
+    }
+    int theStatus = 0;
+    for (struct addrinfo* thePtr = theResPtr;
+            thePtr;
+            thePtr = thePtr->ai_next) {
+        const int theFd = socket(
+            thePtr->ai_family, thePtr->ai_socktype, thePtr->ai_protocol);
+        if (theFd < 0) {
+            theStatus = errno;
+            continue;
+        }
+        const int theOpt = 1;
+        if (fcntl(theFd, F_SETFD, FD_CLOEXEC) ||
+                setsockopt(theFd, SOL_SOCKET, SO_REUSEADDR,
+                    &theOpt, sizeof(theOpt)) ||
+                bind(theFd, thePtr->ai_addr, thePtr->ai_addrlen) ||
+                listen(theFd, 16)) {
+            theStatus = errno;
+            close(theFd);
+            continue;
+        }
+        mListenFd = theFd;
+        theStatus = 0;
+        break;
+    }
+    freeaddrinfo(theResPtr);
+    if (mListenFd < 0) {
+        KFS_LOG_STREAM_ERROR <<
+            "metrics server: " << inAddress << ":" << inPort <<
+            " " << QCUtils::SysError(theStatus) <<
+        KFS_LOG_EOM;
+        return (theStatus > 0 ? -theStatus : -EINVAL);
+    }
+    mStopFlag = false;
+    const int kStackSize = 64 << 10;
+    mThread.Start(this, kStackSize, "MetricsServer");
+    KFS_LOG_STREAM_INFO <<
+        "metrics server: " << inAddress << ":" << inPort <<
+        " started" <<
+    KFS_LOG_EOM;
+    return 0;
+}
+
+    void
+MetricsServer::Shutdown()
+{
+    if (mNetManagerPtr) {
+        mNetManagerPtr->UnRegisterTimeoutHandler(this);
+        mNetManagerPtr = 0;
+    }
+    if (mThread.IsStarted()) {
+        mStopFlag = true;
+        mThread.Join();
+    }
+    if (0 <= mListenFd) {
+        close(mListenFd);
+        mListenFd = -1;
+    }
+    QCStMutexLocker theLock(mMutex);
+    mMetrics = string();
+}
+
+    void
+MetricsServer::Timeout()
+{
+    Update();
+}
+
+    void
+MetricsServer::Update()
+{
+    ostringstream theStream;
+    Writer        theWriter(theStream);
+    mSource.GetMetrics(theWriter);
+    theWriter.End();
+    mBuf = theStream.str();
+    QCStMutexLocker theLock(mMutex);
+    mMetrics.swap(mBuf);
+}
+
+    void
+MetricsServer::Run()
+{
+    while (! mStopFlag) {
+        struct pollfd thePoll;
+        thePoll.fd      = mListenFd;
+        thePoll.events  = POLLIN;
+        thePoll.revents = 0;
+        const int kPollTimeoutMs = 500;
+        const int theRet = poll(&thePoll, 1, kPollTimeoutMs);
+        if (theRet <= 0 || (thePoll.revents & POLLIN) == 0) {
+            continue;
+        }
+        const int theFd = accept(mListenFd, 0, 0);
+        if (theFd < 0) {
+            continue;
+        }
+        Serve(theFd);
+        close(theFd);
+    }
+}
+
+    void
+MetricsServer::Serve(
+    int inFd)
+{
+    struct timeval theTimeout;
+    theTimeout.tv_sec  = 5;
+    theTimeout.tv_usec = 0;
+    setsockopt(inFd, SOL_SOCKET, SO_RCVTIMEO, &theTimeout, sizeof(theTimeout));
+    setsockopt(inFd, SOL_SOCKET, SO_SNDTIMEO, &theTimeout, sizeof(theTimeout));
+    const size_t kMaxRequestSize = 8 << 10;
+    string       theRequest;
+    char         theBuf[1024];
+    while (theRequest.find("\r\n\r\n") == string::npos &&
+            theRequest.find("\n\n") == string::npos) {
+        if (kMaxRequestSize <= theRequest.size()) {
+            return;
+        }
+        const ssize_t theNRd = read(inFd, theBuf, sizeof(theBuf));
+        if (theNRd <= 0) {
+            if (theNRd < 0 && errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        theRequest.append(theBuf, (size_t)theNRd);
+    }
+    const bool   theHeadFlag = theRequest.compare(0, 5, "HEAD ") == 0;
+    const size_t thePathPos  = theHeadFlag ? 5 :
+        (theRequest.compare(0, 4, "GET ") == 0 ? 4 : string::npos);
+    string theResponse;
+    if (thePathPos != string::npos) {
+        size_t thePathEnd = theRequest.find_first_of(" ?\r\n", thePathPos);
+        if (thePathEnd == string::npos) {
+            thePathEnd = theRequest.size();
+        }
+        const string thePath =
+            theRequest.substr(thePathPos, thePathEnd - thePathPos);
+        if (thePath == "/metrics" || thePath == "/") {
+            string theMetrics;
+            {
+                QCStMutexLocker theLock(mMutex);
+                theMetrics = mMetrics;
+            }
+            ostringstream theStream;
+            theStream <<
+                "HTTP/1.1 200 OK\r\n"
+                "Content-Type: application/openmetrics-text;"
+                    " version=1.0.0; charset=utf-8\r\n"
+                "Content-Length: " << theMetrics.size() << "\r\n"
+                "Connection: close\r\n"
+                "\r\n";
+            theResponse = theStream.str();
+            if (! theHeadFlag) {
+                theResponse += theMetrics;
+            }
+        }
+    }
+    if (theResponse.empty()) {
+        theResponse =
+            "HTTP/1.1 404 Not Found\r\n"
+            "Content-Length: 0\r\n"
+            "Connection: close\r\n"
+            "\r\n";
+    }
+    const char*       thePtr    = theResponse.data();
+    const char* const theEndPtr = thePtr + theResponse.size();
+    while (thePtr < theEndPtr) {
+        const ssize_t theNWr = send(inFd, thePtr, theEndPtr - thePtr,
+#ifdef MSG_NOSIGNAL
+            MSG_NOSIGNAL
+#else
+            0
+#endif
+        );
+        if (theNWr <= 0) {
+            if (theNWr < 0 && errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        thePtr += theNWr;
+    }
+}
+
+}
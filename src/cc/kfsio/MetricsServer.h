@@ -0,0 +1,168 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/14
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Http server exporting server counters in OpenMetrics text format.
+//
+//----------------------------------------------------------------------------
+
+#ifndef KFSIO_METRICS_SERVER_H
+#define KFSIO_METRICS_SERVER_H
+
+#include "ITimeout.h"
+#include "qcdio/QCThread.h"
+#include "qcdio/QCMutex.h"
+
+#include <inttypes.h>
+
+#include <ostream>
+#include <string>
+#include <set>
+
+namespace KFS
+{
+using std::ostream;
+using std::string;
+using std::set;
+
+class Properties;
+class NetManager;
+
+// The metrics snapshot is periodically re-built by the net manager timer, i.e.
+// by the thread that owns the counters, and is served by the http server
+// thread. Scraping therefore does not interfere with the request processing,
+// and the cost of building the snapshot does not depend on the number and
+// frequency of the scrapes.
+class MetricsServer : public ITimeout, public QCRunnable
+{
+public:
+    // OpenMetrics text format writer.
+    class Writer
+    {
+    public:
+        Writer(
+            ostream& inStream)
+            : mStream(inStream),
+              mNames(),
+              mName()
+            {}
+        // Declares metric family, returns false if the family with the same
+        // name was already declared. The samples should follow immediately.
+        bool Family(
+            const char* inPrefixPtr,
+            const char* inNamePtr,
+            size_t      inNameLen,
+            const char* inTypePtr);
+        bool Family(
+            const char* inPrefixPtr,
+            const char* inNamePtr,
+            const char* inTypePtr);
+        // Name of the last declared family.
+        const string& GetName() const
+            { return mName; }
+        ostream& GetStream()
+            { return mStream; }
+        // Declares metric family of unknown type, and writes its value.
+        bool Value(
+            const char* inPrefixPtr,
+            const char* inNamePtr,
+            int64_t     inValue);
+        // Converts "name<separator> number" records into metrics of unknown
+        // type, as the records do not distinguish counters and gauges. The
+        // records with non numeric values are ignored. The number can be
+        // followed by comma separated list, as with the counter manager
+        // output, in which case only the first number is used.
+        void Records(
+            const char* inPrefixPtr,
+            const char* inPtr,
+            const char* inEndPtr,
+            char        inNameSeparator,
+            const char* inRecordSeparatorsPtr);
+        void End()
+            { mStream << "# EOF\n"; }
+    private:
+        typedef set<string> Names;
+
+        ostream& mStream;
+        Names    mNames;
+        string   mName;
+    private:
+        Writer(
+            const Writer& inWriter);
+        Writer& operator=(
+            const Writer& inWriter);
+    };
+    class Source
+    {
+    public:
+        virtual void GetMetrics(
+            Writer& inWriter) = 0;
+    protected:
+        Source()
+            {}
+        virtual ~Source()
+            {}
+    };
+
+    MetricsServer(
+        Source& inSource);
+    virtual ~MetricsServer();
+    // Parameters:
+    // <prefix>port -- listen port, negative value disables the http server
+    // <prefix>address -- listen address, empty means any
+    // <prefix>updateIntervalSec -- snapshot update interval
+    int SetParameters(
+        const Properties& inProps,
+        const char*       inPrefixPtr,
+        NetManager&       inNetManager);
+    void Shutdown();
+    int GetPort() const
+        { return mPort; }
+    virtual void Timeout();
+    virtual void Run();
+private:
+    Source&     mSource;
+    NetManager* mNetManagerPtr;
+    QCThread    mThread;
+    QCMutex     mMutex;
+    string      mAddress;
+    string      mMetrics;
+    string      mBuf;
+    int         mPort;
+    int         mUpdateIntervalSec;
+    int         mListenFd;
+    volatile bool mStopFlag;
+
+    int Start(
+        const string& inAddress,
+        int           inPort);
+    void Update();
+    void Serve(
+        int inFd);
+private:
+    MetricsServer(
+        const MetricsServer& inServer);
+    MetricsServer& operator=(
+        const MetricsServer& inServer);
+};
+
+}
+
+#endif /* KFSIO_METRICS_SERVER_H */
@@ -110,6 +110,10 @@ public:
             { return false; }
         virtual string GetPeerId() const
             { return string(); }
+        // Returns true if the filter transmits the data unencrypted, for
+        // example protecting only the data integrity.
+        virtual bool IsClearText() const
+            { return false; }
         bool IsReadPending() const
             { return mReadPendingFlag; }
     protected:
@@ -147,6 +151,10 @@ public:
         return mFilter;
     }
 
+    bool IsEncrypted() const {
+        return (mFilter && ! mFilter->IsClearText());
+    }
+
     int SetFilter(Filter* filter, string* outErrMsg) {
         if (mFilter == filter) {
             return 0;
@@ -166,6 +174,10 @@ public:
         mCallbackObj = c;
     }
 
+    KfsCallbackObj* GetOwningKfsCallbackObj() const {
+        return mCallbackObj;
+    }
+
     void EnableReadIfOverloaded() {
         mNetManagerEntry.EnableReadIfOverloaded();
         Update(false);
@@ -259,6 +271,10 @@ public:
         return (IsGood() ? mSock->GetSockLocation(loc) : -ENOTCONN);
     }
 
+    int DupSocket() const {
+        return (IsGood() ? mSock->Dup() : -ENOTCONN);
+    }
+
     /// Enqueue data to be sent out.
     void Write(const IOBufferData &ioBufData, bool resetTimerFlag = true) {
         if (! ioBufData.IsEmpty()) {
@@ -442,6 +458,7 @@ public:
               mFd(-1),
               mWriteByteCount(0),
               mTimerWheelSlot(-1),
+              mTimerWheelTargetSlot(-1),
               mExpirationTime(-1),
               mNetManager(0),
               mListIt()
@@ -471,6 +488,8 @@ public:
         int              mFd;
         int              mWriteByteCount;
         int              mTimerWheelSlot;
+        /// The slot the entry would be in without lazy re-scheduling.
+        int              mTimerWheelTargetSlot;
         time_t           mExpirationTime;
         NetManager*      mNetManager;
         List::iterator   mListIt;
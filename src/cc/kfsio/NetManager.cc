@@ -30,14 +30,24 @@
 
 #include <cerrno>
 #include <limits>
+#include <map>
+#include <string>
+#include <typeinfo>
 #include <unistd.h>
 #include <fcntl.h>
+#include <string.h>
+#include <stdlib.h>
+#if defined(__GNUC__)
+#   include <cxxabi.h>
+#endif
 
 #include "NetManager.h"
 #include "TcpSocket.h"
 #include "ITimeout.h"
 
 #include "common/MsgLogger.h"
+#include "common/Properties.h"
+#include "common/time.h"
 #include "qcdio/QCFdPoll.h"
 #include "qcdio/QCUtils.h"
 #include "qcdio/QCMutex.h"
@@ -48,6 +58,279 @@ namespace KFS
 using std::min;
 using std::max;
 using std::numeric_limits;
+using std::map;
+using std::string;
+
+class NetManager::Profiler
+{
+public:
+    enum Phase
+    {
+        kPhaseOther       = 0,
+        kPhasePoll        = 1,
+        kPhaseTimeouts    = 2,
+        kPhaseEvents      = 3,
+        kPhasePendingRead = 4,
+        kPhaseTimerWheel  = 5,
+        kPhaseCount
+    };
+    enum { kDefaultTraceSize = 64 };
+    Profiler()
+        : mLevel(0),
+          mIterLevel(0),
+          mTraceThresholdUsec(20000),
+          mTraceSampleInterval(0),
+          mIterStart(0),
+          mLast(0),
+          mIterationCount(0),
+          mMaxBusyUsec(0),
+          mEventCount(0),
+          mTraceNext(0),
+          mTraceCount(0),
+          mCur(),
+          mHandlers(),
+          mTrace(kDefaultTraceSize)
+    {
+        for (int i = 0; i < kPhaseCount; i++) {
+            mPhaseUsec[i] = 0;
+        }
+    }
+    void SetParameters(
+        const Properties&   inProps,
+        Properties::String& inName,
+        size_t              inPrefixLen)
+    {
+        mLevel = inProps.getValue(
+            inName.Truncate(inPrefixLen).Append("level"), mLevel);
+        mTraceThresholdUsec = inProps.getValue(
+            inName.Truncate(inPrefixLen).Append("traceThresholdUsec"),
+            mTraceThresholdUsec);
+        mTraceSampleInterval = max(int64_t(0), inProps.getValue(
+            inName.Truncate(inPrefixLen).Append("traceSampleInterval"),
+            mTraceSampleInterval));
+        const size_t theSize = (size_t)max(0, inProps.getValue(
+            inName.Truncate(inPrefixLen).Append("traceSize"),
+            (int)mTrace.size()));
+        if (theSize != mTrace.size()) {
+            mTrace.clear();
+            mTrace.resize(theSize);
+            mTraceNext  = 0;
+            mTraceCount = 0;
+        }
+    }
+    bool Start()
+    {
+        mIterLevel = mLevel;
+        if (mIterLevel <= 0) {
+            return false;
+        }
+        mCur       = Entry();
+        mIterStart = microseconds();
+        mLast      = mIterStart;
+        mCur.mStart = mIterStart;
+        return true;
+    }
+    void End(
+        Phase inPhase)
+    {
+        const int64_t theNow = microseconds();
+        mCur.mPhaseUsec[inPhase] += theNow - mLast;
+        mLast = theNow;
+    }
+    bool IsHandlersEnabled() const
+        { return (1 < mIterLevel); }
+    void Event()
+        { mCur.mEventCount++; }
+    void HandlerDone(
+        const char* inNamePtr,
+        int64_t     inStartUsec)
+    {
+        const int64_t theUsec = microseconds() - inStartUsec;
+        HandlerCounter& theCounter = mHandlers[inNamePtr];
+        theCounter.mCount++;
+        theCounter.mUsec += theUsec;
+        if (mCur.mSlowestUsec < theUsec) {
+            mCur.mSlowestUsec = theUsec;
+            mCur.mSlowestPtr  = inNamePtr;
+        }
+    }
+    void IterationDone()
+    {
+        if (mIterLevel <= 0) {
+            return;
+        }
+        End(kPhaseOther);
+        mIterationCount++;
+        mEventCount += mCur.mEventCount;
+        int64_t theBusyUsec = 0;
+        for (int i = 0; i < kPhaseCount; i++) {
+            mPhaseUsec[i] += mCur.mPhaseUsec[i];
+            if (i != kPhasePoll) {
+                theBusyUsec += mCur.mPhaseUsec[i];
+            }
+        }
+        mMaxBusyUsec = max(mMaxBusyUsec, theBusyUsec);
+        if (mTrace.empty() || ! (mTraceThresholdUsec <= theBusyUsec ||
+                (0 < mTraceSampleInterval &&
+                    mIterationCount % mTraceSampleInterval == 0))) {
+            return;
+        }
+        mTrace[mTraceNext] = mCur;
+        if (mTrace.size() <= ++mTraceNext) {
+            mTraceNext = 0;
+        }
+        mTraceCount++;
+    }
+    void Show(
+        ostream& inStream,
+        bool     inTraceFlag) const
+    {
+        static const char* const kPhaseNames[kPhaseCount] = {
+            "other",
+            "poll",
+            "timeouts",
+            "events",
+            "pending-read",
+            "timer-wheel"
+        };
+        inStream <<
+            "Net-loop-profile-level: " << mLevel          << "\r\n"
+            "Net-loop-iterations: "    << mIterationCount << "\r\n"
+            "Net-loop-events: "        << mEventCount     << "\r\n"
+            "Net-loop-max-busy-usec: " << mMaxBusyUsec    << "\r\n"
+        ;
+        for (int i = 0; i < kPhaseCount; i++) {
+            inStream << "Net-loop-" << kPhaseNames[i] << "-usec: " <<
+                mPhaseUsec[i] << "\r\n";
+        }
+        // Merge by name, as type info names might not be unique.
+        typedef map<string, HandlerCounter> Names;
+        Names theNames;
+        for (Handlers::const_iterator theIt = mHandlers.begin();
+                theIt != mHandlers.end();
+                ++theIt) {
+            HandlerCounter& theCounter = theNames[Demangle(theIt->first)];
+            theCounter.mCount += theIt->second.mCount;
+            theCounter.mUsec  += theIt->second.mUsec;
+        }
+        for (Names::const_iterator theIt = theNames.begin();
+                theIt != theNames.end();
+                ++theIt) {
+            inStream << "Net-handler-" << theIt->first << ": " <<
+                theIt->second.mCount << "," <<
+                (theIt->second.mUsec * 1e-6) << "\r\n";
+        }
+        if (! inTraceFlag || mTrace.empty()) {
+            return;
+        }
+        inStream << "Net-loop-trace-count: " << mTraceCount << "\r\n"
+            "Net-loop-trace-fields: start-usec";
+        for (int i = 0; i < kPhaseCount; i++) {
+            inStream << " " << kPhaseNames[i] << "-usec";
+        }
+        inStream << " events slowest-handler-usec slowest-handler\r\n";
+        const size_t theSize  =
+            (size_t)min(mTraceCount, (int64_t)mTrace.size());
+        size_t       theIdx   =
+            (mTraceNext + mTrace.size() - theSize) % mTrace.size();
+        for (size_t k = 0; k < theSize; k++) {
+            const Entry& theEntry = mTrace[theIdx];
+            inStream << "Net-loop-trace-" << k << ": " << theEntry.mStart;
+            for (int i = 0; i < kPhaseCount; i++) {
+                inStream << " " << theEntry.mPhaseUsec[i];
+            }
+            inStream << " " << theEntry.mEventCount <<
+                " " << theEntry.mSlowestUsec <<
+                " " << (theEntry.mSlowestPtr ?
+                    Demangle(theEntry.mSlowestPtr) : string("-")) <<
+                "\r\n";
+            if (mTrace.size() <= ++theIdx) {
+                theIdx = 0;
+            }
+        }
+    }
+private:
+    struct Entry
+    {
+        Entry()
+            : mStart(0),
+              mEventCount(0),
+              mSlowestUsec(0),
+              mSlowestPtr(0)
+        {
+            for (int i = 0; i < kPhaseCount; i++) {
+                mPhaseUsec[i] = 0;
+            }
+        }
+        int64_t     mStart;
+        int64_t     mPhaseUsec[kPhaseCount];
+        int64_t     mEventCount;
+        int64_t     mSlowestUsec;
+        const char* mSlowestPtr;
+    };
+    struct HandlerCounter
+    {
+        HandlerCounter()
+            : mCount(0),
+              mUsec(0)
+            {}
+        int64_t mCount;
+        int64_t mUsec;
+    };
+    // Keyed by type info name pointer, to avoid string compares.
+    typedef map<const char*, HandlerCounter> Handlers;
+    typedef vector<Entry>                    Trace;
+
+    int      mLevel;
+    int      mIterLevel;
+    int64_t  mTraceThresholdUsec;
+    int64_t  mTraceSampleInterval;
+    int64_t  mIterStart;
+    int64_t  mLast;
+    int64_t  mIterationCount;
+    int64_t  mMaxBusyUsec;
+    int64_t  mEventCount;
+    size_t   mTraceNext;
+    int64_t  mTraceCount;
+    int64_t  mPhaseUsec[kPhaseCount];
+    Entry    mCur;
+    Handlers mHandlers;
+    Trace    mTrace;
+
+    static string Demangle(
+        const char* inNamePtr)
+    {
+#if defined(__GNUC__)
+        int         theStatus = -1;
+        char* const thePtr    =
+            abi::__cxa_demangle(inNamePtr, 0, 0, &theStatus);
+        if (thePtr) {
+            string theRet;
+            if (theStatus == 0) {
+                theRet = thePtr;
+            }
+            free(thePtr);
+            if (! theRet.empty()) {
+                return theRet;
+            }
+        }
+#endif
+        return string(inNamePtr);
+    }
+private:
+    Profiler(
+        const Profiler&);
+    Profiler& operator=(
+        const Profiler&);
+};
+
+template<typename T> inline static const char*
+GetTypeName(const T* obj)
+{
+    return (obj ? typeid(*obj).name() : "none");
+}
+
+volatile int NetManager::sBusyPollUsec = 0;
 
 NetManager::NetManager(int timeoutMs)
     : mRemove(),
@@ -70,9 +353,14 @@ NetManager::NetManager(int timeoutMs)
       mNumBytesToSend(0),
       mTimerOverrunCount(0),
       mTimerOverrunSec(0),
+      mTimerScanCount(0),
+      mTimerMoveCount(0),
+      mTimerLazyUpdateCount(0),
       mMaxAcceptsPerRead(1),
+      mLastPollEventUsec(0),
       mPoll(*(new QCFdPoll(true))), // Wakeable
       mPollEventHook(0),
+      mProfiler(0),
       mPendingReadList(),
       mPendingUpdate(),
       mCurTimeoutHandler(0),
@@ -87,6 +375,7 @@ NetManager::~NetManager()
     NetManager::CleanUp();
     assert(! PendingReadList::IsInList(mPendingReadList));
     delete &mPoll;
+    delete mProfiler;
 }
 
 void
@@ -109,7 +398,8 @@ NetManager::AddConnection(const NetConnectionPtr& conn)
         abort();
     }
     if (! entry->mAdded) {
-        entry->mTimerWheelSlot = kTimerWheelSize;
+        entry->mTimerWheelSlot       = kTimerWheelSize;
+        entry->mTimerWheelTargetSlot = kTimerWheelSize;
         entry->mListIt = mTimerWheel[kTimerWheelSize].insert(
             mTimerWheel[kTimerWheelSize].end(), conn);
         mConnectionsCount++;
@@ -165,18 +455,40 @@ NetManager::UpdateTimer(NetConnection::NetManagerEntry& entry, int timeOut)
             kTimerWheelSize) {
         timerWheelSlot -= kTimerWheelSize;
     }
+    entry.mTimerWheelTargetSlot = timerWheelSlot;
+    if (timerWheelSlot == entry.mTimerWheelSlot) {
+        return;
+    }
+    // Lazy re-schedule: leave the entry in its slot if the slot will be
+    // traversed no later than the target slot, and let the timer move the
+    // entry into the target slot when it traverses the entry's slot. With this
+    // the connection io, which typically extends the timeout, does not need
+    // to move the entry on every timer wheel slot change, and the entry is
+    // moved at most once per timeout interval. The entry in the slot
+    // currently traversed by the timer has to be moved, as the traversal
+    // might have already passed it.
+    if (timeOut >= 0 && entry.mTimerWheelSlot < kTimerWheelSize &&
+            (! mTimerRunningFlag ||
+                entry.mTimerWheelSlot != mCurTimerWheelSlot)) {
+        const int curDist = entry.mTimerWheelSlot - mCurTimerWheelSlot;
+        const int newDist = timerWheelSlot - mCurTimerWheelSlot;
+        if ((curDist < 0 ? curDist + kTimerWheelSize : curDist) <=
+                (newDist < 0 ? newDist + kTimerWheelSize : newDist)) {
+            mTimerLazyUpdateCount++;
+            return;
+        }
+    }
     // This method can be invoked from timeout handler.
     // Make sure  that the entry doesn't get moved to the end of the current
     // list, which can be traversed by the timer.
-    if (timerWheelSlot != entry.mTimerWheelSlot) {
-        if (mTimerWheelBucketItr == entry.mListIt) {
-            ++mTimerWheelBucketItr;
-        }
-        mTimerWheel[timerWheelSlot].splice(
-            mTimerWheel[timerWheelSlot].end(),
-            mTimerWheel[entry.mTimerWheelSlot], entry.mListIt);
-        entry.mTimerWheelSlot = timerWheelSlot;
+    if (mTimerWheelBucketItr == entry.mListIt) {
+        ++mTimerWheelBucketItr;
     }
+    mTimerWheel[timerWheelSlot].splice(
+        mTimerWheel[timerWheelSlot].end(),
+        mTimerWheel[entry.mTimerWheelSlot], entry.mListIt);
+    entry.mTimerWheelSlot = timerWheelSlot;
+    mTimerMoveCount++;
 }
 
 void
@@ -358,6 +670,33 @@ NetManager::Wakeup()
     mPoll.Wakeup();
 }
 
+void
+NetManager::SetProfileParameters(const Properties& props, const char* prefix)
+{
+    Properties::String name;
+    if (prefix) {
+        name.Append(prefix);
+    }
+    const size_t len = name.GetSize();
+    if (! mProfiler) {
+        if (props.getValue(name.Truncate(len).Append("level"), 0) <= 0) {
+            return;
+        }
+        // Once created, the profiler is never deleted while the net manager
+        // exists, as the parameters can be changed from within the main loop.
+        mProfiler = new Profiler();
+    }
+    mProfiler->SetParameters(props, name, len);
+}
+
+void
+NetManager::ShowProfile(ostream& os, bool traceFlag) const
+{
+    if (mProfiler) {
+        mProfiler->Show(os, traceFlag);
+    }
+}
+
 void
 NetManager::MainLoop(
     QCMutex*                mutex                /* = 0 */,
@@ -376,6 +715,8 @@ NetManager::MainLoop(
     }
     const int timerOverrunWarningTime(mTimeoutMs / (1000/2));
     while (mRunFlag) {
+        Profiler* const profiler =
+            (mProfiler && mProfiler->Start()) ? mProfiler : 0;
         const bool wasOverloaded = mIsOverloaded;
         CheckIfOverloaded();
         if (mIsOverloaded != wasOverloaded) {
@@ -404,11 +745,19 @@ NetManager::MainLoop(
         if (dispatcher) {
             dispatcher->DispatchEnd();
         }
-        const int timeout = PendingReadList::IsInList(mPendingReadList) ?
+        const int busyPollUsec = sBusyPollUsec;
+        int       timeout      = PendingReadList::IsInList(mPendingReadList) ?
             0 : mTimeoutMs;
+        if (0 < busyPollUsec && 0 < timeout &&
+                microseconds() < mLastPollEventUsec + busyPollUsec) {
+            timeout = 0;
+        }
         const int fdCount = mConnectionsCount + 1;
         assert(mPendingUpdate.empty());
         mPollFlag = true;
+        if (profiler) {
+            profiler->End(Profiler::kPhaseOther);
+        }
         QCStMutexUnlocker unlocker(mutex);
         const int ret = mPoll.Poll(fdCount, timeout);
         if (ret < 0 && ret != -EINTR && ret != -EAGAIN) {
@@ -416,8 +765,15 @@ NetManager::MainLoop(
                 QCUtils::SysError(-ret, "poll error") <<
             KFS_LOG_EOM;
         }
+        if (0 < busyPollUsec && 0 < ret) {
+            mLastPollEventUsec = microseconds();
+        }
         unlocker.Lock();
         mPollFlag = false;
+        if (profiler) {
+            // Includes the mutex wait, if any.
+            profiler->End(Profiler::kPhasePoll);
+        }
         const int64_t nowMs = ITimeout::NowMs();
         mNow = time_t(nowMs / 1000);
         for (PendingUpdate::const_iterator it = mPendingUpdate.begin();
@@ -430,6 +786,11 @@ NetManager::MainLoop(
         if (dispatcher) {
             dispatcher->DispatchStart();
         }
+        const bool profileHandlersFlag =
+            profiler && profiler->IsHandlersEnabled();
+        if (profiler) {
+            profiler->End(Profiler::kPhaseOther);
+        }
         mCurTimeoutHandler = TimeoutHandlers::Front(mTimeoutHandlers);
         while (mCurTimeoutHandler) {
             ITimeout& cur = *mCurTimeoutHandler;
@@ -437,7 +798,17 @@ NetManager::MainLoop(
             if (mCurTimeoutHandler == TimeoutHandlers::Front(mTimeoutHandlers)) {
                 mCurTimeoutHandler = 0;
             }
-            cur.TimerExpired(nowMs);
+            if (profileHandlersFlag && cur.IsExpired(nowMs)) {
+                const char* const name  = GetTypeName(&cur);
+                const int64_t     start = microseconds();
+                cur.TimerExpired(nowMs);
+                profiler->HandlerDone(name, start);
+            } else {
+                cur.TimerExpired(nowMs);
+            }
+        }
+        if (profiler) {
+            profiler->End(Profiler::kPhaseTimeouts);
         }
         // Move pending read list into temporary list, as the pending read might
         // change as a result of event dispatch.
@@ -461,6 +832,15 @@ NetManager::MainLoop(
             if (mPollEventHook) {
                 mPollEventHook->Event(*this, conn, op);
             }
+            const char* handlerName  = 0;
+            int64_t     handlerStart = 0;
+            if (profiler) {
+                profiler->Event();
+                if (profileHandlersFlag) {
+                    handlerName  = GetTypeName(conn.GetOwningKfsCallbackObj());
+                    handlerStart = microseconds();
+                }
+            }
             const bool hupError = op == QCFdPoll::kOpTypeHup &&
                 ! conn.WantRead() && ! conn.WantWrite();
             if (((op & (QCFdPoll::kOpTypeIn | QCFdPoll::kOpTypeHup)) != 0 ||
@@ -482,13 +862,30 @@ NetManager::MainLoop(
             // Update the connection.
             mCurConnection = 0;
             conn.Update();
+            if (handlerName) {
+                profiler->HandlerDone(handlerName, handlerStart);
+            }
+        }
+        if (profiler) {
+            profiler->End(Profiler::kPhaseEvents);
         }
         // Process connections with pending read (inside filter).
         while (PendingReadList::IsInList(pendingRead)) {
             NetManagerEntry& cur = PendingReadList::GetNext(pendingRead);
             PendingReadList::Remove(cur);
             NetConnection& conn = **cur.mListIt;
-            conn.HandleReadEvent(mMaxAcceptsPerRead);
+            if (profileHandlersFlag) {
+                const char* const name  =
+                    GetTypeName(conn.GetOwningKfsCallbackObj());
+                const int64_t     start = microseconds();
+                conn.HandleReadEvent(mMaxAcceptsPerRead);
+                profiler->HandlerDone(name, start);
+            } else {
+                conn.HandleReadEvent(mMaxAcceptsPerRead);
+            }
+        }
+        if (profiler) {
+            profiler->End(Profiler::kPhasePendingRead);
         }
         while (! mEpollError.empty()) {
             assert(mEpollError.front());
@@ -507,6 +904,9 @@ NetManager::MainLoop(
             mTimerOverrunCount++;
             mTimerOverrunSec += mNow - mLastTimerTime;
         }
+        if (profiler) {
+            profiler->End(Profiler::kPhaseOther);
+        }
         mTimerRunningFlag = true;
         while (slotCnt-- > 0) {
             List& bucket = mTimerWheel[mCurTimerWheelSlot];
@@ -516,12 +916,20 @@ NetManager::MainLoop(
                 NetConnection& conn = **mTimerWheelBucketItr;
                 assert(conn.IsGood());
                 ++mTimerWheelBucketItr;
+                mTimerScanCount++;
                 NetConnection::NetManagerEntry& entry =
                     *conn.GetNetManagerEntry();
                 const int timeOut = conn.GetInactivityTimeout();
                 if (timeOut < 0) {
                     // No timeout, move it to the corresponding list.
                     UpdateTimer(entry, timeOut);
+                } else if (entry.mTimerWheelTargetSlot != mCurTimerWheelSlot) {
+                    // Lazily re-scheduled, move to the target slot.
+                    mTimerWheel[entry.mTimerWheelTargetSlot].splice(
+                        mTimerWheel[entry.mTimerWheelTargetSlot].end(),
+                        bucket, entry.mListIt);
+                    entry.mTimerWheelSlot = entry.mTimerWheelTargetSlot;
+                    mTimerMoveCount++;
                 } else if (entry.mExpirationTime <= mNow) {
                     conn.HandleTimeoutEvent();
                 } else {
@@ -539,6 +947,10 @@ NetManager::MainLoop(
         mTimerRunningFlag = false;
         mLastTimerTime = mNow;
         mTimerWheelBucketItr = mRemove.end();
+        if (profiler) {
+            profiler->End(Profiler::kPhaseTimerWheel);
+            profiler->IterationDone();
+        }
         if (runOnceFlag) {
             break;
         }
@@ -35,6 +35,7 @@
 
 #include <list>
 #include <vector>
+#include <ostream>
 
 class QCFdPoll;
 class QCMutex;
@@ -43,6 +44,9 @@ namespace KFS
 {
 using std::list;
 using std::vector;
+using std::ostream;
+
+class Properties;
 
 ///
 /// \file NetManager.h
@@ -119,10 +123,28 @@ public:
         { return mTimerOverrunCount; }
     int64_t GetTimerOverrunSec() const
         { return mTimerOverrunSec; }
+    /// Number of connection timer entries visited by the timer wheel.
+    int64_t GetTimerScanCount() const
+        { return mTimerScanCount; }
+    /// Number of timer wheel slot changes, and timer updates that did not
+    /// require slot change due to lazy re-scheduling.
+    int64_t GetTimerMoveCount() const
+        { return mTimerMoveCount; }
+    int64_t GetTimerLazyUpdateCount() const
+        { return mTimerLazyUpdateCount; }
     int GetMaxAcceptsPerRead() const
         { return mMaxAcceptsPerRead; }
     void SetMaxAcceptsPerRead(int maxAcceptsPerRead)
         { mMaxAcceptsPerRead = maxAcceptsPerRead <= 0 ? 1 : maxAcceptsPerRead; }
+    /// Busy poll interval, in microseconds: the event loop polls without
+    /// waiting for the specified time after the last poll that returned
+    /// events, in order to avoid wakeup latency, at the cost of spinning cpu
+    /// for up to the specified time after each burst of activity. 0 or
+    /// less disables busy polling. The setting applies to all net managers.
+    static int GetBusyPollUsec()
+        { return sBusyPollUsec; }
+    static void SetBusyPollUsec(int usec)
+        { sBusyPollUsec = usec; }
     void ChildAtFork(bool onlyCloseFdFlag = true);
     void UpdateTimeNow() { mNow = time(0); }
     int GetConnectionCount() const
@@ -146,6 +168,20 @@ public:
         mPollEventHook = hook;
         return prev;
     }
+    /// Main loop profile. With level 1 the time spent in poll, timeout
+    /// handlers, network event dispatch, pending read processing, and timer
+    /// wheel is accumulated; with level 2 the network event and timeout
+    /// handler time is also accumulated per handler type. The iterations
+    /// that took longer than the trace threshold, and every trace sample
+    /// interval iteration, are recorded in the trace ring buffer.
+    /// Parameters:
+    /// <prefix>level -- 0 disables profiling, 1 and 2 are described above
+    /// <prefix>traceSize -- trace ring buffer size, in iterations
+    /// <prefix>traceThresholdUsec -- iteration busy time trace threshold
+    /// <prefix>traceSampleInterval -- trace every N-th iteration, 0 -- off
+    void SetProfileParameters(const Properties& props, const char* prefix);
+    /// Writes the profile counters, and the trace as "Key: value" lines.
+    void ShowProfile(ostream& os, bool traceFlag = true) const;
     // Use net manager's timer wheel, with no fd/socket.
     // Has about 100 bytes overhead.
     class Timer
@@ -205,6 +241,7 @@ public:
         bool resetTimer);
     static inline const NetManager* GetNetManager(const NetConnection& conn);
 private:
+    class Profiler;
     typedef NetManagerEntry::List            List;
     typedef QCDLList<ITimeout>               TimeoutHandlers;
     typedef NetManagerEntry::PendingReadList PendingReadList;
@@ -236,9 +273,14 @@ private:
     int64_t         mNumBytesToSend;
     int64_t         mTimerOverrunCount;
     int64_t         mTimerOverrunSec;
+    int64_t         mTimerScanCount;
+    int64_t         mTimerMoveCount;
+    int64_t         mTimerLazyUpdateCount;
     int             mMaxAcceptsPerRead;
+    int64_t         mLastPollEventUsec;
     QCFdPoll&       mPoll;
     PollEventHook*  mPollEventHook;
+    Profiler*       mProfiler;
     NetManagerEntry mPendingReadList;
     PendingUpdate   mPendingUpdate;
     /// Handlers that are notified whenever a call to select()
@@ -248,6 +290,8 @@ private:
     List            mEpollError;
     List            mTimerWheel[kTimerWheelSize + 1];
 
+    static volatile int sBusyPollUsec;
+
     void CheckIfOverloaded();
     void CleanUp(bool childAtForkFlag = false, bool onlyCloseFdFlag = false);
     inline void UpdateTimer(NetManagerEntry& entry, int timeOut);
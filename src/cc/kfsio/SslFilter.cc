@@ -180,17 +180,30 @@ public:
         const Properties& inParams,
         string*           inErrMsgPtr)
     {
+        Properties::String theParamName;
+        if (inParamsPrefixPtr) {
+            theParamName.Append(inParamsPrefixPtr);
+        }
+        const size_t thePrefLen = theParamName.GetSize();
+#ifdef SSL_OP_ENABLE_KTLS
+        // Kernel TLS offload requires TLS 1.2 or greater. Use version
+        // flexible method in order to negotiate the highest version
+        // supported by both peers, and let openssl install the session keys
+        // into the kernel after handshake, if the negotiated cipher is
+        // supported by the kernel.
+        const bool theKtlsFlag = inParams.getValue(
+            theParamName.Truncate(thePrefLen).Append("ktls"), 0) != 0;
+        SSL_CTX* const theRetPtr = SSL_CTX_new(theKtlsFlag ?
+            (inServerFlag ? TLS_server_method()   : TLS_client_method()) :
+            (inServerFlag ? TLSv1_server_method() : TLSv1_client_method()));
+#else
         SSL_CTX* const theRetPtr = SSL_CTX_new(
             inServerFlag ? TLSv1_server_method() : TLSv1_client_method());
+#endif
         if (! theRetPtr) {
             return 0;
         }
         SSL_CTX_set_mode(theRetPtr, SSL_MODE_ENABLE_PARTIAL_WRITE);
-        Properties::String theParamName;
-        if (inParamsPrefixPtr) {
-            theParamName.Append(inParamsPrefixPtr);
-        }
-        const size_t thePrefLen = theParamName.GetSize();
         if (! SSL_CTX_set_cipher_list(
             theRetPtr,
             inParams.getValue(
@@ -216,6 +229,9 @@ public:
 #endif
 #ifdef SSL_OP_NO_TICKET
                 | (inPskOnlyFlag ? long(SSL_OP_NO_TICKET) : long(0))
+#endif
+#ifdef SSL_OP_ENABLE_KTLS
+                | (theKtlsFlag ? long(SSL_OP_ENABLE_KTLS) : long(0))
 #endif
         ));
         SSL_CTX_set_timeout(
@@ -400,6 +416,7 @@ public:
           mPeerName(),
           mServerPskPtr(inServerPskPtr),
           mVerifyPeerPtr(inVerifyPeerPtr),
+          mShutdownFilterPtr(0),
           mReadPendingFlag(inReadPendingFlag),
           mDeleteOnCloseFlag(inDeleteOnCloseFlag),
           mSessionStoredFlag(false),
@@ -442,6 +459,7 @@ public:
             SSL_set_session(mSslPtr, 0);
             SSL_free(mSslPtr);
         }
+        delete mShutdownFilterPtr;
     }
     Error GetError() const
         { return mError; }
@@ -452,6 +470,14 @@ public:
         mPskData.assign(inPskDataPtr, inPskDataLen);
         SetPskCB();
     }
+    void SetShutdownFilter(
+        NetConnection::Filter* inFilterPtr)
+    {
+        if (inFilterPtr != mShutdownFilterPtr) {
+            delete mShutdownFilterPtr;
+            mShutdownFilterPtr = inFilterPtr;
+        }
+    }
     bool WantRead(
         const NetConnection& inConnection) const
     {
@@ -757,6 +783,7 @@ private:
     string            mPeerName;
     ServerPsk* const  mServerPskPtr;
     VerifyPeer* const mVerifyPeerPtr;
+    NetConnection::Filter* mShutdownFilterPtr;
     bool&             mReadPendingFlag;
     const bool        mDeleteOnCloseFlag:1;
     bool              mSessionStoredFlag:1;
@@ -1197,6 +1224,11 @@ private:
             // Wait for handshake to complete, then issue shutdown.
             return 0;
         }
+        if (IsKtlsActive()) {
+            // With kernel tls the socket remains in tls mode after the ssl
+            // shutdown, therefore clear text communication cannot continue.
+            return -EOPNOTSUPP;
+        }
         int theRet = SSL_shutdown(mSslPtr);
         if (theRet == 0) {
             // Call shutdown again to initiate read state, if the shutdown call
@@ -1208,11 +1240,28 @@ private:
             return SslRetToErr(theRet);
         }
         mShutdownCompleteFlag = true;
-        inConnection.SetFilter(0, 0);
+        // The shutdown filter, if any, takes over the connection, and the ssl
+        // filter is no longer referenced by the connection.
+        NetConnection::Filter* const theFilterPtr = mShutdownFilterPtr;
+        mShutdownFilterPtr = 0;
+        const int theStatus = inConnection.SetFilter(theFilterPtr, 0);
         if (mDeleteOnCloseFlag) {
             delete &inOuter;
         }
-        return 0;
+        return theStatus;
+    }
+    bool IsKtlsActive() const
+    {
+#ifdef SSL_OP_ENABLE_KTLS
+        BIO* const theWBioPtr = SSL_get_wbio(mSslPtr);
+        BIO* const theRBioPtr = SSL_get_rbio(mSslPtr);
+        return (
+            (theWBioPtr && BIO_get_ktls_send(theWBioPtr)) ||
+            (theRBioPtr && BIO_get_ktls_recv(theRBioPtr))
+        );
+#else
+        return false;
+#endif
     }
     static bool ParseUtcTime(
         const unsigned char* inStrPtr,
@@ -1431,6 +1480,13 @@ SslFilter::SetPsk(
     mImpl.SetPsk(inPskDataPtr, inPskDataLen);
 }
 
+    void
+SslFilter::SetShutdownFilter(
+    NetConnection::Filter* inFilterPtr)
+{
+    mImpl.SetShutdownFilter(inFilterPtr);
+}
+
     SslFilter::Error
 SslFilter::GetError() const
 {
@@ -128,6 +128,11 @@ public:
         bool        inDeleteOnCloseFlag = true,
         const char* inServerNamePtr     = 0);
     Error GetError() const;
+    // The filter to install after ssl shutdown completion. The ssl filter
+    // takes the ownership of the shutdown filter, and deletes it if the
+    // shutdown does not complete.
+    void SetShutdownFilter(
+        NetConnection::Filter* inFilterPtr);
     void SetPsk(
         const char* inPskDataPtr,
         size_t      inPskDataLen);
@@ -74,6 +74,7 @@ SetSockOpt(int fd, int level, int name, const T& val)
 int TcpSocket::sRecvBufSize    = 64 << 10;
 int TcpSocket::sSendBufSize    = 64 << 10;
 int TcpSocket::sMaxOpenSockets =  1 << (sizeof(int) * 8 - 2);
+int TcpSocket::sBusyPollUsec   = 0;
 
 struct TcpSocket::Address
 {
@@ -303,6 +304,56 @@ TcpSocket::Bind(const ServerLocation& location, Type type, bool ipV6OnlyFlag)
     return 0;
 }
 
+int
+TcpSocket::Inherit(int fd, const ServerLocation& location)
+{
+    Close();
+    if (fd < 0 || location.port < 0) {
+        return -EINVAL;
+    }
+    int       type = -1;
+    socklen_t len  = sizeof(type);
+    if (getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &len) ||
+            type != SOCK_STREAM) {
+        const int err = type == SOCK_STREAM ? errno : ENOTSOCK;
+        close(fd);
+        return Perror("inherit", err);
+    }
+    // Use the largest address size to find out the socket address family.
+    Address addr(kTypeIpV6);
+    len = addr.Size();
+    if (getsockname(fd, addr.Ptr(), &len)) {
+        const int err = errno;
+        close(fd);
+        return Perror("inherit getsockname", err);
+    }
+    mSockFd = fd;
+    mType   = addr.Ptr()->sa_family == AF_INET ? kTypeIpV4 : kTypeIpV6;
+    UpdateSocketCount(1);
+    if (fcntl(mSockFd, F_SETFD, FD_CLOEXEC)) {
+        Perror("set FD_CLOEXEC");
+    }
+    ServerLocation loc;
+    int            ret = GetSockLocation(loc);
+    if (ret == 0 && location.port != 0 && location.port != loc.port) {
+        ret = -EADDRNOTAVAIL;
+    }
+    if (ret != 0) {
+        Close();
+    }
+    return ret;
+}
+
+int
+TcpSocket::Dup() const
+{
+    if (mSockFd < 0) {
+        return -EBADF;
+    }
+    const int fd = dup(mSockFd);
+    return (fd < 0 ? Perror("dup") : fd);
+}
+
 TcpSocket*
 TcpSocket::Accept(int* status /* = 0 */)
 {
@@ -420,6 +471,13 @@ TcpSocket::SetupSocket()
     if (SetSockOpt(mSockFd, IPPROTO_TCP, TCP_NODELAY, flag)) {
         Perror("setsockopt TCP_NODELAY");
     }
+#ifdef SO_BUSY_POLL
+    const int busyPollUsec = sBusyPollUsec;
+    if (0 < busyPollUsec &&
+            SetSockOpt(mSockFd, SOL_SOCKET, SO_BUSY_POLL, busyPollUsec)) {
+        Perror("setsockopt SO_BUSY_POLL");
+    }
+#endif
 
 }
 
@@ -64,6 +64,18 @@ public:
     /// Setup and bind TCP socket to the port specified.
     int Bind(const ServerLocation& location, Type type, bool ipV6OnlyFlag);
 
+    /// Use the bound TCP socket inherited from the parent process, instead
+    /// of creating and binding a new one. The socket is closed on failure.
+    /// @param[in] fd inherited socket file descriptor.
+    /// @param[in] location the socket must be bound to the location port,
+    /// unless the port is 0.
+    int Inherit(int fd, const ServerLocation& location);
+
+    /// Duplicate the socket file descriptor, for example, to pass the socket
+    /// to another process. The duplicate has close on exec flag cleared.
+    /// @retval file descriptor, or negative error code.
+    int Dup() const;
+
     /// Start listening;
     int StartListening(bool nonBlockingAccept, int maxQueue = 8192);
 
@@ -121,6 +133,11 @@ public:
     static void SetDefaultRecvBufSize(int size) { sRecvBufSize = size; }
     static void SetDefaultSendBufSize(int size) { sSendBufSize = size; }
     static void SetOpenLimit(int limit) { sMaxOpenSockets = limit; }
+    /// SO_BUSY_POLL value, in microseconds, to set on new sockets.
+    /// 0 -- do not set, busy polling is controlled by the system wide
+    /// net.core.busy_read setting.
+    static int GetDefaultBusyPollUsec() { return sBusyPollUsec; }
+    static void SetDefaultBusyPollUsec(int usec) { sBusyPollUsec = usec; }
 
 private:
     int  mSockFd;
@@ -141,6 +158,7 @@ private:
     static int sRecvBufSize;
     static int sSendBufSize;
     static int sMaxOpenSockets;
+    static int sBusyPollUsec;
 };
 
 typedef boost::shared_ptr<TcpSocket> TcpSocketPtr;
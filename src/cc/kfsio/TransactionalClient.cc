@@ -43,12 +43,14 @@
 
 #include <string>
 #include <set>
+#include <deque>
 
 namespace KFS
 {
 
 using std::set;
 using std::string;
+using std::deque;
 
 class TransactionalClient::Impl
 {
@@ -61,12 +63,15 @@ public:
           mSslCtxPtr(0),
           mTimeout(20),
           mIdleTimeout(20),
+          mMaxConnections(0),
+          mConnectionCount(0),
           mHttpsHostNameFlag(true),
           mVerifyServerFlag(true),
           mPeerNames(),
           mSslCtxParameters(),
           mError(0),
-          mErrorMsg()
+          mErrorMsg(),
+          mPendingQueue()
     {
         mLocation.port = 443;
         List::Init(mInUseListPtr);
@@ -83,6 +88,13 @@ public:
         int         inError,
         const char* inMsgPtr)
     {
+        PendingQueue theQueue;
+        theQueue.swap(mPendingQueue);
+        while (! theQueue.empty()) {
+            Transaction& theTransaction = *theQueue.front();
+            theQueue.pop_front();
+            theTransaction.Error(inError, inMsgPtr);
+        }
         ClientSM* theClientPtr;
         while ((theClientPtr = List::PopFront(mIdleListPtr))) {
             theClientPtr->Stop(inError, inMsgPtr);
@@ -141,6 +153,10 @@ public:
             theName.Truncate(thePrefixSize).Append("idleTImeout"),
             mIdleTimeout
         );
+        mMaxConnections = inParameters.getValue(
+            theName.Truncate(thePrefixSize).Append("maxConnections"),
+            mMaxConnections
+        );
         mHttpsHostNameFlag = inParameters.getValue(
             theName.Truncate(thePrefixSize).Append("httpsHostName"),
             mHttpsHostNameFlag ? 1 : 0
@@ -225,19 +241,19 @@ public:
             inTransaction.Error(mError, mErrorMsg.c_str());
             return;
         }
-        ClientSM* theClientPtr = List::PopFront(mIdleListPtr);
+        ClientSM* const theClientPtr = List::PopFront(mIdleListPtr);
         if (theClientPtr) {
             List::PushFront(mInUseListPtr, *theClientPtr);
             theClientPtr->Run(inTransaction);
             return;
         }
-        if (mSslCtxPtr) {
-            theClientPtr = new SslClientSM(*this);
-        } else {
-            theClientPtr = new ClientSM(*this);
+        if (0 < mMaxConnections && mMaxConnections <= mConnectionCount) {
+            // Wait for a connection to become idle, in order to limit the
+            // number of connections to the server.
+            mPendingQueue.push_back(&inTransaction);
+            return;
         }
-        List::PushFront(mInUseListPtr, *theClientPtr);
-        theClientPtr->Connect(inTransaction);
+        Connect(inTransaction);
     }
 private:
     class ClientSM : public KfsCallbackObj
@@ -540,8 +556,9 @@ private:
     };
     friend class SslClientSM;
 
-    typedef ClientSM::List List;
-    typedef set<string>    PeerNames;
+    typedef ClientSM::List       List;
+    typedef set<string>          PeerNames;
+    typedef deque<Transaction*>  PendingQueue;
 
     NetManager&     mNetManager;
     ServerLocation  mLocation;
@@ -549,12 +566,15 @@ private:
     SslFilter::Ctx* mSslCtxPtr;
     int             mTimeout;
     int             mIdleTimeout;
+    int             mMaxConnections;
+    int             mConnectionCount;
     bool            mHttpsHostNameFlag;
     bool            mVerifyServerFlag;
     PeerNames       mPeerNames;
     Properties      mSslCtxParameters;
     int             mError;
     string          mErrorMsg;
+    PendingQueue    mPendingQueue;
     ClientSM*       mInUseListPtr[1];
     ClientSM*       mIdleListPtr[1];
 
@@ -588,12 +608,32 @@ private:
             }
         }
     }
+    void Connect(
+        Transaction& inTransaction)
+    {
+        ClientSM* theClientPtr;
+        if (mSslCtxPtr) {
+            theClientPtr = new SslClientSM(*this);
+        } else {
+            theClientPtr = new ClientSM(*this);
+        }
+        mConnectionCount++;
+        List::PushFront(mInUseListPtr, *theClientPtr);
+        theClientPtr->Connect(inTransaction);
+    }
     void Add(
         ClientSM& inClient)
     {
         QCASSERT(inClient.IsIdle());
         List::Remove(mInUseListPtr, inClient);
-        List::PushFront(mIdleListPtr, inClient);
+        if (mPendingQueue.empty()) {
+            List::PushFront(mIdleListPtr, inClient);
+            return;
+        }
+        Transaction& theTransaction = *mPendingQueue.front();
+        mPendingQueue.pop_front();
+        List::PushFront(mInUseListPtr, inClient);
+        inClient.Run(theTransaction);
     }
     void Remove(
         ClientSM& inClient)
@@ -601,6 +641,14 @@ private:
         List::Remove(inClient.IsIdle() ? mIdleListPtr : mInUseListPtr,
             inClient);
         delete &inClient;
+        mConnectionCount--;
+        QCASSERT(0 <= mConnectionCount);
+        if (! mPendingQueue.empty() &&
+                (mMaxConnections <= 0 || mConnectionCount < mMaxConnections)) {
+            Transaction& theTransaction = *mPendingQueue.front();
+            mPendingQueue.pop_front();
+            Connect(theTransaction);
+        }
     }
 private:
     Impl(
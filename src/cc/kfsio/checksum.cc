@@ -31,6 +31,14 @@
 #include <vector>
 #include <zlib.h>
 
+#if ! defined(_KFS_NO_ADLER32_SIMD) && \
+    (defined(__x86_64__) || defined(__i386__)) && \
+    defined(__GNUC__) && ! defined(__clang__) && \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#   define _KFS_ADLER32_SIMD
+#   include <immintrin.h>
+#endif
+
 namespace KFS {
 
 using std::min;
@@ -38,9 +46,188 @@ using std::max;
 using std::vector;
 using std::list;
 
+#ifdef _KFS_ADLER32_SIMD
+
+// Vectorized adler32, produces the same result as zlib adler32. The 32 bytes
+// blocks are processed with no more than NMAX (5552) bytes between the
+// modulo reductions, as zlib does, in order to prevent the sums overflow.
+__attribute__((target("ssse3"))) static uint32_t
+Adler32Ssse3(uint32_t adler, const unsigned char* buf, size_t len)
+{
+    const uint32_t kBase      = 65521;
+    const uint32_t kNMax      = 5552;
+    const size_t   kBlockSize = 32;
+
+    uint32_t s1     = adler & 0xffff;
+    uint32_t s2     = (adler >> 16) & 0xffff;
+    size_t   blocks = len / kBlockSize;
+    len -= blocks * kBlockSize;
+    const __m128i tap1 = _mm_setr_epi8(
+        32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17);
+    const __m128i tap2 = _mm_setr_epi8(
+        16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+    while (0 < blocks) {
+        size_t n = kNMax / kBlockSize;
+        if (blocks < n) {
+            n = blocks;
+        }
+        blocks -= n;
+        // s1 contribution to s2 for all bytes in n blocks is added at the
+        // end: v_ps accumulates s1 before each block, then multiplied by 32.
+        __m128i v_ps = _mm_set_epi32(0, 0, 0, (int)(s1 * n));
+        __m128i v_s2 = _mm_set_epi32(0, 0, 0, (int)s2);
+        __m128i v_s1 = zero;
+        do {
+            const __m128i bytes1 =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf));
+            const __m128i bytes2 =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 16));
+            v_ps = _mm_add_epi32(v_ps, v_s1);
+            v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(bytes1, zero));
+            v_s2 = _mm_add_epi32(v_s2,
+                _mm_madd_epi16(_mm_maddubs_epi16(bytes1, tap1), ones));
+            v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(bytes2, zero));
+            v_s2 = _mm_add_epi32(v_s2,
+                _mm_madd_epi16(_mm_maddubs_epi16(bytes2, tap2), ones));
+            buf += kBlockSize;
+        } while (--n);
+        v_s2 = _mm_add_epi32(v_s2, _mm_slli_epi32(v_ps, 5));
+        v_s1 = _mm_add_epi32(v_s1,
+            _mm_shuffle_epi32(v_s1, _MM_SHUFFLE(2, 3, 0, 1)));
+        v_s1 = _mm_add_epi32(v_s1,
+            _mm_shuffle_epi32(v_s1, _MM_SHUFFLE(1, 0, 3, 2)));
+        s1 += (uint32_t)_mm_cvtsi128_si32(v_s1);
+        v_s2 = _mm_add_epi32(v_s2,
+            _mm_shuffle_epi32(v_s2, _MM_SHUFFLE(2, 3, 0, 1)));
+        v_s2 = _mm_add_epi32(v_s2,
+            _mm_shuffle_epi32(v_s2, _MM_SHUFFLE(1, 0, 3, 2)));
+        s2 = (uint32_t)_mm_cvtsi128_si32(v_s2);
+        s1 %= kBase;
+        s2 %= kBase;
+    }
+    while (0 < len) {
+        s1 += *buf++;
+        s2 += s1;
+        len--;
+    }
+    s1 %= kBase;
+    s2 %= kBase;
+    return (s1 | (s2 << 16));
+}
+
+// Same as the above, but with 64 bytes blocks and 256 bit registers.
+__attribute__((target("avx2"))) static uint32_t
+Adler32Avx2(uint32_t adler, const unsigned char* buf, size_t len)
+{
+    const uint32_t kBase      = 65521;
+    const uint32_t kNMax      = 5552;
+    const size_t   kBlockSize = 64;
+
+    uint32_t s1     = adler & 0xffff;
+    uint32_t s2     = (adler >> 16) & 0xffff;
+    size_t   blocks = len / kBlockSize;
+    len -= blocks * kBlockSize;
+    const __m256i tap1 = _mm256_setr_epi8(
+        64, 63, 62, 61, 60, 59, 58, 57, 56, 55, 54, 53, 52, 51, 50, 49,
+        48, 47, 46, 45, 44, 43, 42, 41, 40, 39, 38, 37, 36, 35, 34, 33);
+    const __m256i tap2 = _mm256_setr_epi8(
+        32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17,
+        16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi16(1);
+    while (0 < blocks) {
+        size_t n = kNMax / kBlockSize;
+        if (blocks < n) {
+            n = blocks;
+        }
+        blocks -= n;
+        __m256i v_ps = _mm256_setr_epi32((int)(s1 * n), 0, 0, 0, 0, 0, 0, 0);
+        __m256i v_s2 = _mm256_setr_epi32((int)s2, 0, 0, 0, 0, 0, 0, 0);
+        __m256i v_s1 = zero;
+        do {
+            const __m256i bytes1 =
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(buf));
+            const __m256i bytes2 =
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(buf + 32));
+            v_ps = _mm256_add_epi32(v_ps, v_s1);
+            v_s1 = _mm256_add_epi32(v_s1, _mm256_sad_epu8(bytes1, zero));
+            v_s2 = _mm256_add_epi32(v_s2,
+                _mm256_madd_epi16(_mm256_maddubs_epi16(bytes1, tap1), ones));
+            v_s1 = _mm256_add_epi32(v_s1, _mm256_sad_epu8(bytes2, zero));
+            v_s2 = _mm256_add_epi32(v_s2,
+                _mm256_madd_epi16(_mm256_maddubs_epi16(bytes2, tap2), ones));
+            buf += kBlockSize;
+        } while (--n);
+        v_s2 = _mm256_add_epi32(v_s2, _mm256_slli_epi32(v_ps, 6));
+        __m128i v_s1_128 = _mm_add_epi32(
+            _mm256_castsi256_si128(v_s1), _mm256_extracti128_si256(v_s1, 1));
+        __m128i v_s2_128 = _mm_add_epi32(
+            _mm256_castsi256_si128(v_s2), _mm256_extracti128_si256(v_s2, 1));
+        v_s1_128 = _mm_add_epi32(v_s1_128,
+            _mm_shuffle_epi32(v_s1_128, _MM_SHUFFLE(2, 3, 0, 1)));
+        v_s1_128 = _mm_add_epi32(v_s1_128,
+            _mm_shuffle_epi32(v_s1_128, _MM_SHUFFLE(1, 0, 3, 2)));
+        s1 += (uint32_t)_mm_cvtsi128_si32(v_s1_128);
+        v_s2_128 = _mm_add_epi32(v_s2_128,
+            _mm_shuffle_epi32(v_s2_128, _MM_SHUFFLE(2, 3, 0, 1)));
+        v_s2_128 = _mm_add_epi32(v_s2_128,
+            _mm_shuffle_epi32(v_s2_128, _MM_SHUFFLE(1, 0, 3, 2)));
+        s2 = (uint32_t)_mm_cvtsi128_si32(v_s2_128);
+        s1 %= kBase;
+        s2 %= kBase;
+    }
+    while (0 < len) {
+        s1 += *buf++;
+        s2 += s1;
+        len--;
+    }
+    s1 %= kBase;
+    s2 %= kBase;
+    return (s1 | (s2 << 16));
+}
+
+enum Adler32Impl
+{
+    kAdler32Zlib,
+    kAdler32Ssse3,
+    kAdler32Avx2
+};
+
+static Adler32Impl
+GetAdler32Impl()
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return kAdler32Avx2;
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        return kAdler32Ssse3;
+    }
+    return kAdler32Zlib;
+}
+
+static const Adler32Impl sAdler32Impl = GetAdler32Impl();
+
+#endif /* _KFS_ADLER32_SIMD */
+
 static inline uint32_t
 KfsChecksum(uint32_t chksum, const void* buf, size_t len)
 {
+#ifdef _KFS_ADLER32_SIMD
+    // Use zlib for short buffers, where vector unit setup isn't worth it.
+    if (64 <= len) {
+        if (sAdler32Impl == kAdler32Avx2) {
+            return Adler32Avx2(
+                chksum, reinterpret_cast<const unsigned char*>(buf), len);
+        }
+        if (sAdler32Impl == kAdler32Ssse3) {
+            return Adler32Ssse3(
+                chksum, reinterpret_cast<const unsigned char*>(buf), len);
+        }
+    }
+#endif
     return adler32(chksum, reinterpret_cast<const Bytef*>(buf), len);
 }
 
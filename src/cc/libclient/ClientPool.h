@@ -31,8 +31,10 @@
 #include "KfsNetClient.h"
 
 #include <map>
+#include <vector>
 #include <utility>
 #include <sstream>
+#include <algorithm>
 
 namespace KFS
 {
@@ -45,6 +47,9 @@ using std::map;
 using std::less;
 using std::ostringstream;
 using std::string;
+using std::vector;
+using std::stable_sort;
+using std::max;
 
 // Client connection (KfsNetClient) pool. Used to reduce number of chunk
 // server connections. Presently used only with radix sort with write append
@@ -81,7 +86,8 @@ public:
           mMaxContentLength(inMaxContentLength),
           mFailAllOpsOnOpTimeoutFlag(inFailAllOpsOnOpTimeoutFlag),
           mMaxOneOutstandingOpFlag(inMaxOneOutstandingOpFlag),
-          mAuthContextPtr(inAuthContextPtr)
+          mAuthContextPtr(inAuthContextPtr),
+          mServersLatency()
         {}
     ~ClientPool()
     {
@@ -160,6 +166,66 @@ public:
     }
     size_t GetSize() const
         { return mClients.size(); }
+    // Chunk server latency is tracked as exponentially weighted moving
+    // average of the read op completion time. The read op size is bounded by
+    // the max read size, therefore the average reflects both the server
+    // response time and throughput.
+    void UpdateServerLatency(
+        const ServerLocation& inLocation,
+        int64_t               inLatencyMs,
+        int64_t               inNowMs)
+    {
+        ServerLatency& theLatency = mServersLatency[inLocation];
+        if (theLatency.mLatencyMs < 0 ||
+                theLatency.mUpdateTimeMs + kServerLatencyMaxAgeMs < inNowMs) {
+            theLatency.mLatencyMs = (double)inLatencyMs;
+        } else {
+            theLatency.mLatencyMs +=
+                (inLatencyMs - theLatency.mLatencyMs) / kServerLatencyWeight;
+        }
+        theLatency.mUpdateTimeMs = inNowMs;
+    }
+    // Penalize server on read failure, in order to make it less preferable
+    // until either the latency average recovers or the entry expires.
+    void ReportServerError(
+        const ServerLocation& inLocation,
+        int64_t               inNowMs)
+    {
+        ServerLatency& theLatency = mServersLatency[inLocation];
+        theLatency.mLatencyMs = max(double(kServerErrorLatencyMs),
+            2 * max(0., theLatency.mLatencyMs));
+        theLatency.mUpdateTimeMs = inNowMs;
+    }
+    // Order servers by latency class. Servers with no recent latency samples
+    // are put first, in order to get samples. Servers with latency within
+    // the same power of two class are considered equal, and their relative
+    // order is preserved, therefore the caller should randomize the order
+    // prior to the call in order to spread load among the equal servers.
+    void OrderServers(
+        vector<ServerLocation>& ioServers,
+        int64_t                 inNowMs) const
+    {
+        if (ioServers.size() <= 1 || mServersLatency.empty()) {
+            return;
+        }
+        ServersOrder theOrder;
+        theOrder.reserve(ioServers.size());
+        for (vector<ServerLocation>::const_iterator theIt = ioServers.begin();
+                theIt != ioServers.end();
+                ++theIt) {
+            theOrder.push_back(
+                make_pair(GetLatencyClass(*theIt, inNowMs), &*theIt));
+        }
+        stable_sort(theOrder.begin(), theOrder.end(), LatencyClassLess());
+        vector<ServerLocation> theServers;
+        theServers.reserve(ioServers.size());
+        for (ServersOrder::const_iterator theIt = theOrder.begin();
+                theIt != theOrder.end();
+                ++theIt) {
+            theServers.push_back(*theIt->second);
+        }
+        ioServers.swap(theServers);
+    }
 private:
     typedef map<
         ServerLocation,
@@ -181,6 +247,58 @@ private:
     bool               mFailAllOpsOnOpTimeoutFlag;
     bool               mMaxOneOutstandingOpFlag;
     ClientAuthContext* mAuthContextPtr;
+
+    enum
+    {
+        kServerLatencyWeight   = 8,
+        kServerLatencyMaxAgeMs = 5 * 60 * 1000,
+        kServerErrorLatencyMs  = 1000
+    };
+    struct ServerLatency
+    {
+        ServerLatency()
+            : mLatencyMs(-1),
+              mUpdateTimeMs(0)
+            {}
+        double  mLatencyMs;
+        int64_t mUpdateTimeMs;
+    };
+    typedef map<
+        ServerLocation,
+        ServerLatency,
+        less<ServerLocation>,
+        StdFastAllocator<pair<const ServerLocation, ServerLatency> >
+    > ServersLatency;
+    typedef vector<pair<int, const ServerLocation*> > ServersOrder;
+    struct LatencyClassLess
+    {
+        bool operator()(
+            const ServersOrder::value_type& inLhs,
+            const ServersOrder::value_type& inRhs) const
+            { return (inLhs.first < inRhs.first); }
+    };
+
+    ServersLatency mServersLatency;
+
+    int GetLatencyClass(
+        const ServerLocation& inLocation,
+        int64_t               inNowMs) const
+    {
+        ServersLatency::const_iterator const theIt =
+            mServersLatency.find(inLocation);
+        if (theIt == mServersLatency.end() || theIt->second.mLatencyMs < 0 ||
+                theIt->second.mUpdateTimeMs + kServerLatencyMaxAgeMs <
+                    inNowMs) {
+            return 0;
+        }
+        int     theClass = 1;
+        int64_t theMs    = (int64_t)theIt->second.mLatencyMs;
+        while (0 < theMs) {
+            theMs >>= 1;
+            theClass++;
+        }
+        return theClass;
+    }
 private:
     ClientPool(
         const ClientPool& inPool);
@@ -119,12 +119,19 @@ protected:
             }
             return false;
         }
-        if (inStripeCount <= 0 || inRecoveryStripeCount <= 0) {
+        if (inStripeCount <= 0 || KFS_MAX_DATA_STRIPE_COUNT < inStripeCount) {
             if (outErrMsgPtr) {
                 *outErrMsgPtr = "Jerasure: invalid data stripe count";
             }
             return false;
         }
+        if (inRecoveryStripeCount <= 0 ||
+                KFS_MAX_RECOVERY_STRIPE_COUNT < inRecoveryStripeCount) {
+            if (outErrMsgPtr) {
+                *outErrMsgPtr = "Jerasure: invalid recovery stripe count";
+            }
+            return false;
+        }
         return true;
     }
 private:
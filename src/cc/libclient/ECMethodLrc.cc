@@ -0,0 +1,552 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// Locally repairable erasure code method.
+//
+// The data stripes are split into groups of equal or nearly equal size. The
+// first recovery stripes are the group local parities: xor of the group data
+// stripes, the last kGlobalParityCount recovery stripes are the Reed-Solomon
+// (Vandermonde) parities over all data stripes. For example, 12 data and 4
+// recovery stripes form two local groups of 6 data stripes with two global
+// parities. A single lost data stripe, or local parity, is rebuilt from its
+// group only. The erasures that are not repairable locally are solved by
+// selecting linearly independent surviving rows of the generator matrix, and
+// inverting the resulting matrix.
+//
+//----------------------------------------------------------------------------
+
+#include "ECMethodDef.h"
+
+#ifndef QFS_OMIT_JERASURE
+#include "jerasure.h"
+#include "jerasure/reed_sol.h"
+
+#include "common/kfstypes.h"
+#include "common/kfsatomic.h"
+#include "common/StdAllocator.h"
+#include "common/IntToString.h"
+
+#include "qcdio/QCUtils.h"
+#include "qcdio/qcdebug.h"
+
+#include <map>
+#include <vector>
+
+#include <stdlib.h>
+#include <string.h>
+#endif
+
+namespace KFS
+{
+namespace client
+{
+
+#ifdef QFS_OMIT_JERASURE
+KFS_REGISTER_EC_METHOD(STRIPED_FILE_TYPE_LRC_JERASURE, 0);
+#else
+
+using std::map;
+using std::less;
+using std::pair;
+using std::make_pair;
+using std::vector;
+
+class QCECMethodLrc : public ECMethod
+{
+public:
+    static ECMethod* GetMethod()
+    {
+        static QCECMethodLrc sMethod;
+        return &sMethod;
+    }
+protected:
+    enum
+    {
+        kGlobalParityCount = 2,
+        kW                 = 8,
+        kMaxStripeCount    = 1 << kW
+    };
+
+    virtual bool Init(
+        int inMethodType)
+    {
+        QCRTASSERT(inMethodType == KFS_STRIPED_FILE_TYPE_LRC_JERASURE);
+        return (inMethodType == KFS_STRIPED_FILE_TYPE_LRC_JERASURE);
+    }
+    virtual string GetDescription() const
+        { return mDescription; }
+    void Release(
+        int inMethodType)
+    {
+        QCRTASSERT(inMethodType == KFS_STRIPED_FILE_TYPE_LRC_JERASURE);
+        Cleanup();
+    }
+    virtual Encoder* GetEncoder(
+        int     inMethodType,
+        int     inStripeCount,
+        int     inRecoveryStripeCount,
+        string* outErrMsgPtr)
+    {
+        return GetXCoder(
+            inMethodType,
+            inStripeCount,
+            inRecoveryStripeCount,
+            outErrMsgPtr
+        );
+    }
+    virtual Decoder* GetDecoder(
+        int     inMethodType,
+        int     inStripeCount,
+        int     inRecoveryStripeCount,
+        string* outErrMsgPtr)
+    {
+        return GetXCoder(
+            inMethodType,
+            inStripeCount,
+            inRecoveryStripeCount,
+            outErrMsgPtr
+        );
+    }
+    virtual bool Validate(
+        int     inMethodType,
+        int     inStripeCount,
+        int     inRecoveryStripeCount,
+        string* outErrMsgPtr)
+    {
+        if (inMethodType != KFS_STRIPED_FILE_TYPE_LRC_JERASURE) {
+            if (outErrMsgPtr) {
+                *outErrMsgPtr = "LRC: invalid method type";
+            }
+            return false;
+        }
+        if (inRecoveryStripeCount <= kGlobalParityCount ||
+                KFS_MAX_RECOVERY_STRIPE_COUNT < inRecoveryStripeCount) {
+            if (outErrMsgPtr) {
+                *outErrMsgPtr = "LRC: invalid recovery stripe count";
+            }
+            return false;
+        }
+        if (inStripeCount < inRecoveryStripeCount - kGlobalParityCount ||
+                KFS_MAX_DATA_STRIPE_COUNT < inStripeCount ||
+                kMaxStripeCount < inStripeCount + inRecoveryStripeCount) {
+            if (outErrMsgPtr) {
+                *outErrMsgPtr = "LRC: invalid data stripe count";
+            }
+            return false;
+        }
+        return true;
+    }
+private:
+    enum { kMaxCodersCacheCount = 256 };
+    class LrcCoder;
+    typedef map<
+        pair<int, int>,
+        LrcCoder*,
+        less<pair<int, int> >,
+        StdFastAllocator<
+            pair<const pair<int, int>, LrcCoder*> >
+    > LrcCoders;
+
+    class LrcCoder :
+        public ECMethod::Encoder,
+        public ECMethod::Decoder
+    {
+    public:
+        LrcCoder(
+            int  inStripeCount,
+            int  inRecoveryStripeCount,
+            int* inMatrixPtr)
+            : ECMethod::Encoder(),
+              ECMethod::Decoder(),
+              mStripeCount(inStripeCount),
+              mRecoveryStripeCount(inRecoveryStripeCount),
+              mGroupCount(inRecoveryStripeCount - kGlobalParityCount),
+              mMatrixPtr(inMatrixPtr),
+              mRefCount(1)
+            {}
+        static LrcCoder* Create(
+            int inStripeCount,
+            int inRecoveryStripeCount)
+        {
+            // Use Vandermonde kGlobalParityCount + 1 rows, and discard the
+            // first all ones row, as it is the sum of the local parities.
+            int* const theVandPtr = reed_sol_vandermonde_coding_matrix(
+                inStripeCount, kGlobalParityCount + 1, kW);
+            if (! theVandPtr) {
+                return 0;
+            }
+            const int  theGroupCount =
+                inRecoveryStripeCount - kGlobalParityCount;
+            int* const theMatrixPtr  = (int*)malloc(
+                sizeof(int) * inStripeCount * inRecoveryStripeCount);
+            if (! theMatrixPtr) {
+                free(theVandPtr);
+                return 0;
+            }
+            for (int i = 0; i < theGroupCount; i++) {
+                int* const theRowPtr = theMatrixPtr + i * inStripeCount;
+                for (int k = 0; k < inStripeCount; k++) {
+                    theRowPtr[k] =
+                        GetGroup(inStripeCount, theGroupCount, k) == i ? 1 : 0;
+                }
+            }
+            memcpy(theMatrixPtr + theGroupCount * inStripeCount,
+                theVandPtr + inStripeCount,
+                sizeof(int) * inStripeCount * kGlobalParityCount);
+            free(theVandPtr);
+            return new LrcCoder(
+                inStripeCount, inRecoveryStripeCount, theMatrixPtr);
+        }
+        virtual bool SupportsOneRecoveryStripeRebuild() const
+            { return true; }
+        virtual int Encode(
+            int    inStripeCount,
+            int    inRecoveryStripeCount,
+            int    inLength,
+            void** inBuffersPtr)
+        {
+            QCRTASSERT(inStripeCount == mStripeCount &&
+                inRecoveryStripeCount == mRecoveryStripeCount);
+            jerasure_matrix_encode(
+                mStripeCount,
+                mRecoveryStripeCount,
+                kW,
+                mMatrixPtr,
+                reinterpret_cast<char**>(inBuffersPtr),
+                reinterpret_cast<char**>(inBuffersPtr + mStripeCount),
+                inLength
+            );
+            return 0;
+        }
+        virtual int Decode(
+            int        inStripeCount,
+            int        inRecoveryStripeCount,
+            int        inLength,
+            void**     inBuffersPtr,
+            int const* inMissingStripesIdxPtr)
+        {
+            QCRTASSERT(inStripeCount == mStripeCount &&
+                inRecoveryStripeCount == mRecoveryStripeCount);
+            const int    theCount     = mStripeCount + mRecoveryStripeCount;
+            char** const theDataPtr   = reinterpret_cast<char**>(inBuffersPtr);
+            char** const theCodingPtr = theDataPtr + mStripeCount;
+            vector<char> theMissing(theCount, 0);
+            int          theMissingDataCount = 0;
+            for (int const* thePtr = inMissingStripesIdxPtr;
+                    0 <= *thePtr;
+                    ++thePtr) {
+                if (theCount <= *thePtr) {
+                    return -1;
+                }
+                if (! theMissing[*thePtr]) {
+                    theMissing[*thePtr] = 1;
+                    if (*thePtr < mStripeCount) {
+                        theMissingDataCount++;
+                    }
+                }
+            }
+            vector<int> theRow(mStripeCount);
+            vector<int> theSrcIds(mStripeCount);
+            // Repair data stripes with only one erasure in their group from
+            // the local parity.
+            for (int i = 0; i < mStripeCount && 0 < theMissingDataCount; i++) {
+                if (! theMissing[i]) {
+                    continue;
+                }
+                const int theGroup = GetGroup(i);
+                if (theMissing[mStripeCount + theGroup]) {
+                    continue;
+                }
+                int theCnt = 0;
+                for (int k = 0; k < mStripeCount; k++) {
+                    if (GetGroup(k) != theGroup || k == i) {
+                        continue;
+                    }
+                    if (theMissing[k]) {
+                        theCnt = -1;
+                        break;
+                    }
+                    theSrcIds[theCnt] = k;
+                    theRow[theCnt]    = 1;
+                    theCnt++;
+                }
+                if (theCnt < 0) {
+                    continue;
+                }
+                theSrcIds[theCnt] = mStripeCount + theGroup;
+                theRow[theCnt]    = 1;
+                theCnt++;
+                for (int k = theCnt; k < mStripeCount; k++) {
+                    theSrcIds[k] = theSrcIds[0];
+                    theRow[k]    = 0;
+                }
+                jerasure_matrix_dotprod(mStripeCount, kW, &theRow[0],
+                    &theSrcIds[0], i, theDataPtr, theCodingPtr, inLength);
+                theMissing[i] = 0;
+                theMissingDataCount--;
+            }
+            if (0 < theMissingDataCount &&
+                    ! DecodeGlobal(theMissing, inLength, theDataPtr,
+                        theCodingPtr)) {
+                return -1;
+            }
+            // Re-compute missing recovery stripes.
+            for (int i = 0; i < mRecoveryStripeCount; i++) {
+                if (theMissing[mStripeCount + i] && theCodingPtr[i]) {
+                    jerasure_matrix_dotprod(mStripeCount, kW,
+                        mMatrixPtr + i * mStripeCount, 0, mStripeCount + i,
+                        theDataPtr, theCodingPtr, inLength);
+                }
+            }
+            return 0;
+        }
+        virtual void Release()
+        {
+            const int theRef = SyncAddAndFetch(mRefCount, -1);
+            if (0 < theRef) {
+                return;
+            }
+            QCRTASSERT(theRef == 0);
+            delete this;
+        }
+        LrcCoder* Ref()
+        {
+            if (SyncAddAndFetch(mRefCount, 1) <= 1) {
+                QCRTASSERT(! "invalid ref. count");
+            }
+            return this;
+        }
+    private:
+        const int    mStripeCount;
+        const int    mRecoveryStripeCount;
+        const int    mGroupCount;
+        int* const   mMatrixPtr;
+        volatile int mRefCount;
+
+        virtual ~LrcCoder()
+        {
+            free(mMatrixPtr);
+            mRefCount = -1000; // To catch double delete.
+        }
+        static int GetGroup(
+            int inStripeCount,
+            int inGroupCount,
+            int inStripeIdx)
+        {
+            return (int)((int64_t)inStripeIdx * inGroupCount /
+                inStripeCount);
+        }
+        int GetGroup(
+            int inStripeIdx) const
+            { return GetGroup(mStripeCount, mGroupCount, inStripeIdx); }
+        const int* GetGeneratorRow(
+            int  inIdx,
+            int* inUnitRowPtr) const
+        {
+            if (mStripeCount <= inIdx) {
+                return (mMatrixPtr + (inIdx - mStripeCount) * mStripeCount);
+            }
+            for (int i = 0; i < mStripeCount; i++) {
+                inUnitRowPtr[i] = i == inIdx ? 1 : 0;
+            }
+            return inUnitRowPtr;
+        }
+        // Selects mStripeCount linearly independent generator matrix rows of
+        // the surviving stripes, and solves for the missing data stripes.
+        bool DecodeGlobal(
+            const vector<char>& inMissing,
+            int                 inLength,
+            char**              inDataPtr,
+            char**              inCodingPtr) const
+        {
+            const int   theN     = mStripeCount;
+            const int   theCount = theN + mRecoveryStripeCount;
+            vector<int> theBasis(theN * theN, 0);
+            vector<int> thePivots(theN, -1);
+            vector<int> theRows(theN * theN);
+            vector<int> theSrcIds(theN);
+            vector<int> theUnitRow(theN);
+            vector<int> theCur(theN);
+            int         theRank = 0;
+            for (int theIdx = 0;
+                    theIdx < theCount && theRank < theN;
+                    theIdx++) {
+                if (inMissing[theIdx] ||
+                        (theN <= theIdx && ! inCodingPtr[theIdx - theN])) {
+                    continue;
+                }
+                const int* const theGenPtr =
+                    GetGeneratorRow(theIdx, &theUnitRow[0]);
+                theCur.assign(theGenPtr, theGenPtr + theN);
+                // Reduce against the current echelon basis.
+                for (int r = 0; r < theRank; r++) {
+                    const int  thePivot = thePivots[r];
+                    const int  theCoef  = theCur[thePivot];
+                    if (theCoef == 0) {
+                        continue;
+                    }
+                    const int* const theBPtr = &theBasis[r * theN];
+                    for (int c = 0; c < theN; c++) {
+                        if (theBPtr[c] != 0) {
+                            theCur[c] ^= galois_single_multiply(
+                                theCoef, theBPtr[c], kW);
+                        }
+                    }
+                }
+                int thePivot = 0;
+                while (thePivot < theN && theCur[thePivot] == 0) {
+                    thePivot++;
+                }
+                if (theN <= thePivot) {
+                    continue; // Linearly dependent.
+                }
+                const int  theInv  =
+                    galois_single_divide(1, theCur[thePivot], kW);
+                int* const theBPtr = &theBasis[theRank * theN];
+                for (int c = 0; c < theN; c++) {
+                    theBPtr[c] = galois_single_multiply(theCur[c], theInv, kW);
+                }
+                thePivots[theRank] = thePivot;
+                memcpy(&theRows[theRank * theN], theGenPtr,
+                    sizeof(int) * theN);
+                theSrcIds[theRank] = theIdx;
+                theRank++;
+            }
+            if (theRank < theN) {
+                return false;
+            }
+            vector<int> theDecoding(theN * theN);
+            if (jerasure_invert_matrix(
+                    &theRows[0], &theDecoding[0], theN, kW) != 0) {
+                return false;
+            }
+            for (int i = 0; i < theN; i++) {
+                if (inMissing[i]) {
+                    jerasure_matrix_dotprod(theN, kW, &theDecoding[i * theN],
+                        &theSrcIds[0], i, inDataPtr, inCodingPtr, inLength);
+                }
+            }
+            return true;
+        }
+    };
+
+    const string mDescription;
+    LrcCoders    mLrcCoders;
+    bool         mInitDoneFlag;
+
+    LrcCoder* GetXCoder(
+        int     inMethodType,
+        int     inStripeCount,
+        int     inRecoveryStripeCount,
+        string* outErrMsgPtr)
+    {
+        QCRTASSERT(inMethodType == KFS_STRIPED_FILE_TYPE_LRC_JERASURE);
+        if (! Validate(inMethodType, inStripeCount, inRecoveryStripeCount,
+                outErrMsgPtr)) {
+            return 0;
+        }
+        // See the comment in QCECMethodJerasure::GetXCoder() about galois
+        // field one time initialization.
+        if (! mInitDoneFlag) {
+            const int theRet = galois_init_default_field(kW);
+            if (theRet != 0) {
+                if (outErrMsgPtr) {
+                    *outErrMsgPtr = "galios init default ";
+                    AppendDecIntToString(*outErrMsgPtr, int(kW)) +=
+                        " error: ";
+                    *outErrMsgPtr += QCUtils::SysError(theRet);
+                }
+                return 0;
+            }
+            mInitDoneFlag = true;
+        }
+        const pair<int, int> theKey(inStripeCount, inRecoveryStripeCount);
+        LrcCoders::iterator const theIt = mLrcCoders.find(theKey);
+        if (theIt != mLrcCoders.end()) {
+            return theIt->second->Ref();
+        }
+        LrcCoder* const theCoderPtr =
+            LrcCoder::Create(inStripeCount, inRecoveryStripeCount);
+        if (! theCoderPtr) {
+            if (outErrMsgPtr) {
+                *outErrMsgPtr = "failed to create encoding matrix";
+            }
+            return 0;
+        }
+        if ((size_t)kMaxCodersCacheCount <= mLrcCoders.size()) {
+            LrcCoders::iterator const theFrontIt = mLrcCoders.begin();
+            theFrontIt->second->Release();
+            mLrcCoders.erase(theFrontIt);
+        }
+        mLrcCoders.insert(make_pair(theKey, theCoderPtr));
+        return theCoderPtr->Ref();
+    }
+protected:
+    QCECMethodLrc()
+        : ECMethod(),
+          mDescription(Describe()),
+          mLrcCoders(),
+          mInitDoneFlag(false)
+        {}
+    virtual ~QCECMethodLrc()
+    {
+        QCECMethodLrc::Unregister(KFS_STRIPED_FILE_TYPE_LRC_JERASURE);
+        Cleanup();
+    }
+    void Cleanup()
+    {
+        for (LrcCoders::iterator theIt = mLrcCoders.begin();
+                theIt != mLrcCoders.end();
+                ++theIt) {
+            theIt->second->Release();
+        }
+        mLrcCoders.clear();
+    }
+    static string Describe()
+    {
+        string theRet;
+        theRet += "id: ";
+        AppendDecIntToString(theRet,
+                int(KFS_STRIPED_FILE_TYPE_LRC_JERASURE)) +=
+            "; locally repairable code"
+            "; local groups: recovery stripes - ";
+        AppendDecIntToString(theRet, int(kGlobalParityCount)) +=
+            "; global parities: ";
+        AppendDecIntToString(theRet, int(kGlobalParityCount)) +=
+            "; data stripes range: [local groups, ";
+        AppendDecIntToString(theRet, int(kMaxStripeCount) -
+                (int)(kGlobalParityCount + 1)) +=
+            "]"
+            "; recovery stripes range: [";
+        AppendDecIntToString(theRet, int(kGlobalParityCount) + 1) +=
+            ", ";
+        AppendDecIntToString(theRet, KFS_MAX_RECOVERY_STRIPE_COUNT) +=
+            "]"
+            "; data + recovery stripes <= ";
+        AppendDecIntToString(theRet, int(kMaxStripeCount));
+        return theRet;
+    }
+};
+
+KFS_REGISTER_EC_METHOD(STRIPED_FILE_TYPE_LRC_JERASURE,
+    QCECMethodLrc::GetMethod()
+);
+
+#endif /* QFS_OMIT_JERASURE */
+}} /* namespace client KFS */
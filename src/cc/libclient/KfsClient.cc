@@ -287,10 +287,20 @@ KfsClient::Readdir(const char *pathname, vector<string> &result)
 
 int
 KfsClient::ReaddirPlus(const char *pathname, vector<KfsFileAttr> &result,
-    bool computeFilesize, bool updateClientCache, bool fileIdAndTypeOnly)
+    bool computeFilesize, bool updateClientCache, bool fileIdAndTypeOnly,
+    const char* fnamePattern)
 {
     return mImpl->ReaddirPlus(pathname, result,
-        computeFilesize, updateClientCache, fileIdAndTypeOnly);
+        computeFilesize, updateClientCache, fileIdAndTypeOnly, fnamePattern);
+}
+
+int
+KfsClient::ReaddirPlus(const char* pathname, string& cursor,
+    vector<KfsFileAttr>& result, bool& hasMoreEntries, int maxEntries,
+    bool computeFilesize, bool fileIdAndTypeOnly)
+{
+    return mImpl->ReaddirPlus(pathname, cursor, result, hasMoreEntries,
+        maxEntries, computeFilesize, fileIdAndTypeOnly);
 }
 
 int
@@ -560,6 +570,15 @@ KfsClient::Create(const char *pathname, bool exclusive, const char *params)
         0666, maxSTier, minSTier);
 }
 
+int
+KfsClient::CreateFiles(const char* dirname, const vector<string>& names,
+    vector<int>& outStatus, int numReplicas, kfsMode_t mode,
+    kfsSTier_t minSTier, kfsSTier_t maxSTier)
+{
+    return mImpl->CreateFiles(dirname, names, outStatus, numReplicas, mode,
+        minSTier, maxSTier);
+}
+
 int
 KfsClient::Remove(const char *pathname)
 {
@@ -650,6 +669,19 @@ KfsClient::ReadPrefetch(int fd, char *buf, size_t numBytes)
     return mImpl->ReadPrefetch(fd, buf, numBytes);
 }
 
+ssize_t
+KfsClient::ReadAsync(int fd, chunkOff_t pos, char *buf, size_t numBytes,
+    KfsClient::ReadCompletion& completion)
+{
+    return mImpl->ReadAsync(fd, pos, buf, numBytes, completion);
+}
+
+ssize_t
+KfsClient::ReadV(int fd, KfsClient::ReadRange* ranges, int count)
+{
+    return mImpl->ReadV(fd, ranges, count);
+}
+
 ssize_t
 KfsClient::PRead(int fd, chunkOff_t pos, char *buf, size_t numBytes)
 {
@@ -682,6 +714,13 @@ KfsClient::WriteAsync(int fd, const char *buf, size_t numBytes)
     return mImpl->WriteAsync(fd, buf, numBytes);
 }
 
+ssize_t
+KfsClient::WriteAsync(int fd, chunkOff_t pos, const char *buf,
+    size_t numBytes, KfsClient::WriteCompletion& completion)
+{
+    return mImpl->WriteAsync(fd, pos, buf, numBytes, completion);
+}
+
 int
 KfsClient::WriteAsyncCompletionHandler(int fd)
 {
@@ -700,6 +739,12 @@ KfsClient::Sync(int fd)
     return mImpl->Sync(fd);
 }
 
+int
+KfsClient::Sync(const int* fds, int count)
+{
+    return mImpl->Sync(fds, count);
+}
+
 chunkOff_t
 KfsClient::Seek(int fd, chunkOff_t offset, int whence)
 {
@@ -764,6 +809,14 @@ KfsClient::GetDataLocation(int fd, chunkOff_t start, chunkOff_t len,
     return mImpl->GetDataLocation(fd, start, len, locations, outBlkSize);
 }
 
+int
+KfsClient::GetDirDataLocation(const char* pathname, string& cursor,
+    KfsClient::DirDataLocation& result, bool& hasMoreEntries, int maxEntries)
+{
+    return mImpl->GetDirDataLocation(
+        pathname, cursor, result, hasMoreEntries, maxEntries);
+}
+
 int
 KfsClient::GetReplicationFactor(const char *pathname)
 {
@@ -821,6 +874,18 @@ KfsClient::GetDefaultMetaOpTimeout() const
     return mImpl->GetDefaultMetaOpTimeout();
 }
 
+void
+KfsClient::SetTraceId(int64_t traceId)
+{
+    client::KfsOp::SetCurrentTraceId(traceId);
+}
+
+int64_t
+KfsClient::GetTraceId() const
+{
+    return client::KfsOp::GetCurrentTraceId();
+}
+
 void
 KfsClient::SetRetryDelay(int nsecs)
 {
@@ -926,6 +991,12 @@ KfsClient::SetFileAttributeRevalidateTime(int secs)
     mImpl->SetFileAttributeRevalidateTime(secs);
 }
 
+int
+KfsClient::GetFileAttributeRevalidateTime() const
+{
+    return mImpl->GetFileAttributeRevalidateTime();
+}
+
 int
 KfsClient::Chmod(int fd, kfsMode_t mode)
 {
@@ -1539,6 +1610,7 @@ KfsClientImpl::KfsClientImpl(
       mFileAttributeRevalidateTime(30),
       mFileAttributeRevalidateScan(64),
       mFAttrCacheGeneration(1),
+      mFileAttributeCacheSize(16 << 10),
       mTmpPath(),
       mTmpAbsPathStr(),
       mTmpAbsPath(),
@@ -1547,9 +1619,13 @@ KfsClientImpl::KfsClientImpl(
       mSlash("/"),
       mDefaultIoBufferSize(min(CHUNKSIZE, size_t(1) << 20)),
       mDefaultReadAheadSize(min(mDefaultIoBufferSize, size_t(1) << 20)),
+      mMaxAdaptiveReadAheadSize(0),
+      mWriteParallelChunks(1),
       mFailShortReadsFlag(true),
+      mServerRmdirsFlag(false),
       mFileInstance(0),
       mProtocolWorker(0),
+      mProtocolWorkers(),
       mMaxNumRetriesPerOp(DEFAULT_NUM_RETRIES_PER_OP),
       mRetryDelaySec(RETRY_DELAY_SECS),
       mDefaultOpTimeout(30),
@@ -1623,7 +1699,12 @@ KfsClientImpl::~KfsClientImpl()
     while ((p = FAttrLru::Front(mFAttrLru))) {
         Delete(p);
     }
-    delete mProtocolWorker;
+    for (ProtocolWorkers::const_iterator it = mProtocolWorkers.begin();
+            it != mProtocolWorkers.end();
+            ++it) {
+        delete *it;
+    }
+    mProtocolWorker = 0;
     KfsClientImpl::CleanupPendingRead();
     vector <FileTableEntry *>::iterator it = mFileTable.begin();
     while (it != mFileTable.end()) {
@@ -1651,7 +1732,11 @@ KfsClientImpl::ShutdownSelf()
     assert(mMutex.IsOwned());
     if (mProtocolWorker) {
         QCStMutexUnlocker unlock(mMutex);
-        mProtocolWorker->Stop();
+        for (ProtocolWorkers::const_iterator it = mProtocolWorkers.begin();
+                it != mProtocolWorkers.end();
+                ++it) {
+            (*it)->Stop();
+        }
     }
     mAuthCtx.Clear();
     mProtocolWorkerAuthCtx.Clear();
@@ -1721,6 +1806,18 @@ int KfsClientImpl::Init(const string& metaServerHost, int metaServerPort,
         mFailShortReadsFlag = properties->getValue(
             "client.fullSparseFileSupport",
             mFailShortReadsFlag ? 0 : 1) == 0;
+        // File attribute and path cache parameters.
+        mFileAttributeRevalidateTime = properties->getValue(
+            "client.fileAttributeRevalidateTime",
+            mFileAttributeRevalidateTime);
+        mFileAttributeRevalidateScan = (unsigned int)max(0,
+            properties->getValue("client.fileAttributeRevalidateScan",
+                (int)mFileAttributeRevalidateScan));
+        const int fileAttributeCacheSize = properties->getValue(
+            "client.fileAttributeCacheSize", -1);
+        if (0 < fileAttributeCacheSize) {
+            mFileAttributeCacheSize = (size_t)fileAttributeCacheSize;
+        }
         // Target io and buffer size defaults.
         const int targetDiskIoSize = properties->getValue(
             "client.targetDiskIoSize", -1);
@@ -1748,6 +1845,13 @@ int KfsClientImpl::Init(const string& metaServerHost, int metaServerPort,
         } else if ((int)CHECKSUM_BLOCKSIZE <= defaultIoBufferSize) {
             mDefaultReadAheadSize = mDefaultIoBufferSize;
         }
+        mMaxAdaptiveReadAheadSize = max(0, properties->getValue(
+            "client.maxAdaptiveReadAheadSize", mMaxAdaptiveReadAheadSize));
+        mWriteParallelChunks = max(1, min(16, properties->getValue(
+            "client.writeParallelChunks", mWriteParallelChunks)));
+        // Server side recursive remove requires meta server support.
+        mServerRmdirsFlag = properties->getValue(
+            "client.serverSideRmdirs", mServerRmdirsFlag ? 1 : 0) != 0;
         mConfig.clear();
         properties->copyWithPrefix("client.", mConfig);
     }
@@ -1768,6 +1872,8 @@ int KfsClientImpl::Init(const string& metaServerHost, int metaServerPort,
     if (! mIsInitialized) {
         mInitLookupRootFlag = true;
         ShutdownSelf();
+    } else {
+        UpdateDelegationCache();
     }
     // setup the client monitor specific parameters
     char* monitorPluginPath = 0;
@@ -2158,6 +2264,21 @@ KfsClientImpl::RmdirsFast(const char *pathname,
         assert(! "internal error: invalid path name");
         return -EFAULT;
     }
+    if (mServerRmdirsFlag && ! (pos == 0 && dirname == "/")) {
+        RmdirsOp op(0, parentFid, dirname.c_str(), path.c_str());
+        DoMetaOpWithRetry(&op);
+        InvalidateAllCachedAttrs();
+        KFS_LOG_STREAM_DEBUG << path <<
+            " removed: files: " << op.filesRemoved <<
+            " dirs: "           << op.dirsRemoved <<
+            " status: "         << op.status <<
+        KFS_LOG_EOM;
+        if (op.status < 0) {
+            ret = GetOpStatus(op);
+            return (errHandler ? (*errHandler)(path, ret) : ret);
+        }
+        return 0;
+    }
     DefaultErrHandler errorHandler;
     ret = RmdirsSelf(
         path.substr(0, pos),
@@ -2266,6 +2387,10 @@ public:
     }
     ~ReaddirResult()
         { Clear(); }
+    const char* GetBuf() const
+        { return mBuf; }
+    int GetLen() const
+        { return mLen; }
     ReaddirResult* Clear()
     {
         delete [] mBuf;
@@ -2527,7 +2652,8 @@ KfsClientImpl::Readdir(const char* pathname, vector<string>& result)
 /// @retval 0 if readdir is successful; -errno otherwise
 int
 KfsClientImpl::ReaddirPlus(const char* pathname, vector<KfsFileAttr>& result,
-    bool computeFilesize, bool updateClientCache, bool fileIdAndTypeOnly)
+    bool computeFilesize, bool updateClientCache, bool fileIdAndTypeOnly,
+    const char* fnamePattern)
 {
     QCStMutexLocker l(mMutex);
 
@@ -2542,7 +2668,7 @@ KfsClientImpl::ReaddirPlus(const char* pathname, vector<KfsFileAttr>& result,
         return -ENOTDIR;
     }
     return ReaddirPlus(path, attr.fileId, result,
-        computeFilesize, updateClientCache, fileIdAndTypeOnly);
+        computeFilesize, updateClientCache, fileIdAndTypeOnly, fnamePattern);
 }
 
 class ReaddirPlusParser
@@ -2982,7 +3108,7 @@ private:
 int
 KfsClientImpl::ReaddirPlus(const string& pathname, kfsFileId_t dirFid,
     vector<KfsFileAttr>& result, bool computeFilesize, bool updateClientCache,
-    bool fileIdAndTypeOnly)
+    bool fileIdAndTypeOnly, const char* fnamePattern)
 {
     assert(mMutex.IsOwned());
     if (pathname.empty() || pathname[0] != '/') {
@@ -3007,11 +3133,15 @@ KfsClientImpl::ReaddirPlus(const string& pathname, kfsFileId_t dirFid,
     ReaddirResult                     opResult;
     ReaddirResult*                    last  = &opResult;
     int                               count = 0;
+    if (fnamePattern) {
+        op.fnamePattern = fnamePattern;
+    }
     for (int retryCnt = kMaxReadDirRetries; ;) {
         op.seq                = 0;
         op.numEntries         = kMaxReaddirEntries;
         op.contentLength      = 0;
         op.hasMoreEntriesFlag = false;
+        op.fnameNext.clear();
 
         DoMetaOpWithRetry(&op);
 
@@ -3035,7 +3165,12 @@ KfsClientImpl::ReaddirPlus(const string& pathname, kfsFileId_t dirFid,
             continue;
         }
         if (op.numEntries <= 0) {
-            break;
+            if (! op.hasMoreEntriesFlag || op.fnameNext.empty()) {
+                break;
+            }
+            // No entries matched the pattern in this batch.
+            op.fnameStart = op.fnameNext;
+            continue;
         }
         if (op.contentLength <= 0) {
             op.status = -EIO;
@@ -3061,6 +3196,10 @@ KfsClientImpl::ReaddirPlus(const string& pathname, kfsFileId_t dirFid,
         if (! op.hasMoreEntriesFlag) {
             break;
         }
+        if (! op.fnameNext.empty()) {
+            op.fnameStart = op.fnameNext;
+            continue;
+        }
         if (! last->GetLast(*beginEntryToken, *nameEntryToken, op.fnameStart)) {
             op.status = -EIO;
             break;
@@ -3133,6 +3272,82 @@ KfsClientImpl::ReaddirPlus(const string& pathname, kfsFileId_t dirFid,
     return 0;
 }
 
+///
+/// Read one batch of directory entries and their attributes, starting after
+/// the cursor entry. Unlike ReaddirPlus() above, the directory content isn't
+/// buffered, and the entries are returned in the meta server order, which is
+/// not lexicographic.
+///
+int
+KfsClientImpl::ReaddirPlus(const char* pathname, string& cursor,
+    vector<KfsFileAttr>& result, bool& hasMoreEntries, int maxEntries,
+    bool computeFilesize, bool fileIdAndTypeOnly)
+{
+    QCStMutexLocker l(mMutex);
+
+    result.clear();
+    hasMoreEntries = false;
+    KfsFileAttr attr;
+    string      path;
+    const int   res = StatSelf(pathname, attr, false, &path);
+    if (res < 0) {
+        return res;
+    }
+    if (! attr.isDirectory) {
+        return -ENOTDIR;
+    }
+    time_t const              now = time(0);
+    ReadDirPlusResponseParser parser(
+        *this, result, computeFilesize && ! fileIdAndTypeOnly,
+        attr.fileId, now);
+    const bool                kGetLastChunkInfoIfSizeUnknown = true;
+    ReaddirPlusOp             op(
+        0, attr.fileId, kGetLastChunkInfoIfSizeUnknown, ! computeFilesize,
+        fileIdAndTypeOnly);
+    op.fnameStart = cursor;
+    op.numEntries = (0 < maxEntries && maxEntries < kMaxReaddirEntries) ?
+        maxEntries : kMaxReaddirEntries;
+    DoMetaOpWithRetry(&op);
+    if (op.status < 0) {
+        if (! cursor.empty() && op.status == -ENOENT) {
+            // The cursor entry was removed, the caller has to restart.
+            return -EAGAIN;
+        }
+        return GetOpStatus(op);
+    }
+    if (op.numEntries <= 0) {
+        return 0;
+    }
+    if (op.contentLength <= 0) {
+        return -EIO;
+    }
+    ReaddirResult opResult;
+    opResult.Set(op);
+    if (op.hasMoreEntriesFlag) {
+        PropertiesTokenizer tokenizer(
+            opResult.GetBuf(), opResult.GetLen(), false);
+        tokenizer.Next();
+        const bool shortFlag = tokenizer.GetKey() == parser.shortBeginEntry;
+        const PropertiesTokenizer::Token nameToken(shortFlag ? "N" : "Name");
+        if (! opResult.GetLast(
+                shortFlag ? parser.shortBeginEntry : parser.beginEntry,
+                nameToken, cursor)) {
+            return -EIO;
+        }
+        hasMoreEntries = true;
+    } else {
+        cursor.clear();
+    }
+    const int status = opResult.Parse(parser);
+    if (status != 0) {
+        result.clear();
+        hasMoreEntries = false;
+        return status;
+    }
+    ComputeFilesizes(result, parser.fileChunkInfo);
+    return 0;
+}
+
 int
 KfsClientImpl::Stat(const char *pathname, KfsFileAttr& kfsattr, bool computeFilesize)
 {
@@ -3304,6 +3519,97 @@ KfsClientImpl::Create(const char *pathname, int numReplicas, bool exclusive,
         mode, minSTier, maxSTier);
 }
 
+int
+KfsClientImpl::CreateFiles(const char* dirname, const vector<string>& names,
+    vector<int>& outStatus, int numReplicas, kfsMode_t mode,
+    kfsSTier_t minSTier, kfsSTier_t maxSTier)
+{
+    QCStMutexLocker l(mMutex);
+
+    outStatus.assign(names.size(), 0);
+    int res = KfsClient::ValidateCreateParams(numReplicas, 0, 0, 0,
+        KFS_STRIPED_FILE_TYPE_NONE, minSTier, maxSTier);
+    if (res < 0) {
+        return res;
+    }
+    kfsFileId_t parentFid;
+    string      name;
+    string      path;
+    const bool  kInvalidateSubCountsFlag = true;
+    if ((res = GetPathComponents(dirname, &parentFid, name, &path,
+            kInvalidateSubCountsFlag)) < 0) {
+        return res;
+    }
+    FAttr* fa = 0;
+    if ((res = Lookup(parentFid, name, fa, time(0), path)) < 0) {
+        return res;
+    }
+    if (! fa->isDirectory) {
+        return -ENOTDIR;
+    }
+    fa->staleSubCountsFlag = true;
+    const kfsFileId_t dirFid = fa->fileId;
+    // Leave room in the request header for the other fields.
+    const size_t kMaxNamesLength = MAX_RPC_HEADER_LEN / 2;
+    const size_t kMaxBatchNames  = 512;
+    vector<size_t> idx;
+    idx.reserve(names.size());
+    for (size_t i = 0; i < names.size(); i++) {
+        if ((outStatus[i] = ValidateName(names[i])) == 0) {
+            Delete(LookupFAttr(dirFid, names[i]));
+            idx.push_back(i);
+        }
+    }
+    const Permissions perms(
+        mUseOsUserAndGroupFlag ? mEUser  : kKfsUserNone,
+        mUseOsUserAndGroupFlag ? mEGroup : kKfsGroupNone,
+        mode != kKfsModeUndef ? (mode & ~mUMask) : mode
+    );
+    int    created = 0;
+    string batch;
+    for (size_t next = 0; next < idx.size(); ) {
+        batch.clear();
+        size_t end = next;
+        while (end < idx.size() && end - next < kMaxBatchNames &&
+                (end == next || batch.size() + names[idx[end]].size() <
+                    kMaxNamesLength)) {
+            if (end != next) {
+                batch += '/';
+            }
+            batch += names[idx[end]];
+            end++;
+        }
+        CreateBatchOp op(0, dirFid, batch, numReplicas, perms,
+            minSTier, maxSTier);
+        DoMetaOpWithRetry(&op);
+        if (op.status < 0) {
+            KFS_LOG_STREAM_ERROR <<
+                dirname << ": create batch: " << op.status <<
+                " " << op.statusMsg <<
+            KFS_LOG_EOM;
+            res = GetOpStatus(op);
+            for (size_t i = next; i < idx.size(); i++) {
+                outStatus[idx[i]] = res;
+            }
+            return res;
+        }
+        if (op.numCreated < 0 || (size_t)op.numCreated > end - next ||
+                (op.numCreated == 0 && op.failedStatus == 0)) {
+            for (size_t i = next; i < idx.size(); i++) {
+                outStatus[idx[i]] = -EIO;
+            }
+            return -EIO;
+        }
+        created += op.numCreated;
+        next    += op.numCreated;
+        if (op.failedStatus != 0 && next < end) {
+            outStatus[idx[next]] = op.failedStatus;
+            next++;
+        }
+    }
+    return created;
+}
+
 int
 KfsClientImpl::CreateSelf(const char *pathname, int numReplicas, bool exclusive,
     int numStripes, int numRecoveryStripes, int stripeSize, int stripedType,
@@ -4098,7 +4404,7 @@ KfsClientImpl::Close(int fd)
         ReleaseFileTableEntry(fd);
     }
     if (writeCloseFlag) {
-        const int ret = (int)mProtocolWorker->Execute(
+        const int ret = (int)GetProtocolWorker(fileId).Execute(
             closeType,
             fileInstance,
             fileId
@@ -4108,7 +4414,7 @@ KfsClientImpl::Close(int fd)
         }
     }
     if (readCloseFlag) {
-        const int ret = (int)mProtocolWorker->Execute(
+        const int ret = (int)GetProtocolWorker(fileId).Execute(
             KfsProtocolWorker::kRequestTypeReadShutdown,
             fileInstance + 1, // reader's instance always +1
             fileId
@@ -4157,7 +4463,8 @@ KfsClientImpl::Sync(int fd)
         const KfsProtocolWorker::FileInstance fileInstance = entry.instance;
         entry.pending = 0;
         l.Unlock();
-        return (int)mProtocolWorker->Execute(
+        KfsProtocolWorker& worker = GetProtocolWorker(fileId);
+        return (int)worker.Execute(
             (entry.openMode & O_APPEND) != 0 ?
                 KfsProtocolWorker::kRequestTypeWriteAppend :
                 KfsProtocolWorker::kRequestTypeWrite,
@@ -4440,6 +4747,121 @@ KfsClientImpl::GetDataLocationSelf(int fd, chunkOff_t start, chunkOff_t len,
     return 0;
 }
 
+int
+KfsClientImpl::GetDirDataLocation(const char* pathname, string& cursor,
+    KfsClient::DirDataLocation& result, bool& hasMoreEntries, int maxEntries)
+{
+    QCStMutexLocker l(mMutex);
+
+    hasMoreEntries = false;
+    KfsFileAttr attr;
+    string      path;
+    const int   res = StatSelf(pathname, attr, false, &path);
+    if (res < 0) {
+        return res;
+    }
+    if (! attr.isDirectory) {
+        return -ENOTDIR;
+    }
+    GetDirLayoutOp op(0, attr.fileId);
+    op.fnameStart = cursor;
+    op.numEntries = (0 < maxEntries && maxEntries < kMaxReaddirEntries) ?
+        maxEntries : kMaxReaddirEntries;
+    DoMetaOpWithRetry(&op);
+    if (op.status < 0) {
+        if (! cursor.empty() && op.status == -ENOENT) {
+            // The cursor entry was removed, the caller has to restart.
+            return -EAGAIN;
+        }
+        return GetOpStatus(op);
+    }
+    if (op.numEntries <= 0) {
+        cursor.clear();
+        return 0;
+    }
+    if (op.contentLength <= 0 || ! op.contentBuf || op.numServers < 0) {
+        return -EIO;
+    }
+    // Map the response server table indices into the result server table,
+    // in order to keep the indices valid across the batches.
+    typedef map<ServerLocation, int> ServerIndex;
+    ServerIndex serverIdx;
+    for (size_t i = 0; i < result.servers.size(); i++) {
+        serverIdx.insert(make_pair(result.servers[i], (int)i));
+    }
+    const size_t      serversCnt = result.servers.size();
+    const size_t      filesCnt   = result.files.size();
+    vector<int>       idxMap;
+    ServerLocation    loc;
+    BufferInputStream is(op.contentBuf, op.contentLength);
+    idxMap.reserve(op.numServers);
+    for (int i = 0; i < op.numServers; i++) {
+        if (! (is >> loc.hostname >> loc.port)) {
+            return -EIO;
+        }
+        pair<ServerIndex::iterator, bool> const ret = serverIdx.insert(
+            make_pair(loc, (int)result.servers.size()));
+        if (ret.second) {
+            result.servers.push_back(loc);
+        }
+        idxMap.push_back(ret.first->second);
+    }
+    string name;
+    bool   okFlag = true;
+    for (int i = 0; okFlag && i < op.numEntries; i++) {
+        result.files.push_back(KfsClient::FileDataLocation());
+        KfsClient::FileDataLocation& file      = result.files.back();
+        int                          dirFlag   = 0;
+        int                          numChunks = 0;
+        if (! (is >> file.fileId >> dirFlag >> file.fileSize >>
+                file.numStripes >> file.numRecoveryStripes >>
+                file.stripeSize >> file.numReplicas >> numChunks) ||
+                numChunks < 0) {
+            okFlag = false;
+            break;
+        }
+        file.chunks.resize(numChunks);
+        for (int k = 0; okFlag && k < numChunks; k++) {
+            KfsClient::ChunkDataLocation& chunk = file.chunks[k];
+            int                           cnt   = 0;
+            if (! (is >> chunk.offset >> cnt) || cnt < 0) {
+                okFlag = false;
+                break;
+            }
+            chunk.servers.reserve(cnt);
+            for (int n = 0; n < cnt; n++) {
+                int idx = -1;
+                if (! (is >> idx) || idx < 0 || op.numServers <= idx) {
+                    okFlag = false;
+                    break;
+                }
+                chunk.servers.push_back(idxMap[idx]);
+            }
+        }
+        if (! okFlag || is.get() != ' ' || ! getline(is, name)) {
+            okFlag = false;
+            break;
+        }
+        if (dirFlag) {
+            result.files.pop_back();
+        } else {
+            file.filename = name;
+        }
+    }
+    if (! okFlag) {
+        result.servers.resize(serversCnt);
+        result.files.resize(filesCnt);
+        return -EIO;
+    }
+    if (op.hasMoreEntriesFlag) {
+        cursor.swap(name);
+        hasMoreEntries = true;
+    } else {
+        cursor.clear();
+    }
+    return 0;
+}
+
 int
 KfsClientImpl::GetReplicationFactor(const char *pathname)
 {
@@ -4509,7 +4931,11 @@ KfsClientImpl::SetDefaultIOTimeout(int nsecs)
     }
     mDefaultOpTimeout = timeout;
     if (mProtocolWorker) {
-        mProtocolWorker->SetOpTimeoutSec(mDefaultOpTimeout);
+        for (ProtocolWorkers::const_iterator it = mProtocolWorkers.begin();
+                it != mProtocolWorkers.end();
+                ++it) {
+            (*it)->SetOpTimeoutSec(mDefaultOpTimeout);
+        }
     }
 }
 
@@ -4531,7 +4957,11 @@ KfsClientImpl::SetDefaultMetaOpTimeout(int nsecs)
     }
     mDefaultMetaOpTimeout = timeout;
     if (mProtocolWorker) {
-        mProtocolWorker->SetMetaOpTimeoutSec(mDefaultMetaOpTimeout);
+        for (ProtocolWorkers::const_iterator it = mProtocolWorkers.begin();
+                it != mProtocolWorkers.end();
+                ++it) {
+            (*it)->SetMetaOpTimeoutSec(mDefaultMetaOpTimeout);
+        }
     }
 }
 
@@ -4551,8 +4981,12 @@ KfsClientImpl::SetRetryDelay(int nsecs)
     }
     mRetryDelaySec = nsecs;
     if (mProtocolWorker) {
-        mProtocolWorker->SetTimeSecBetweenRetries(mRetryDelaySec);
-        mProtocolWorker->SetMetaTimeSecBetweenRetries(mRetryDelaySec);
+        for (ProtocolWorkers::const_iterator it = mProtocolWorkers.begin();
+                it != mProtocolWorkers.end();
+                ++it) {
+            (*it)->SetTimeSecBetweenRetries(mRetryDelaySec);
+            (*it)->SetMetaTimeSecBetweenRetries(mRetryDelaySec);
+        }
     }
 }
 
@@ -4572,8 +5006,12 @@ KfsClientImpl::SetMaxRetryPerOp(int retryCount)
     }
     mMaxNumRetriesPerOp = retryCount;
     if (mProtocolWorker) {
-        mProtocolWorker->SetMaxRetryCount(mMaxNumRetriesPerOp);
-        mProtocolWorker->SetMetaMaxRetryCount(mMaxNumRetriesPerOp);
+        for (ProtocolWorkers::const_iterator it = mProtocolWorkers.begin();
+                it != mProtocolWorkers.end();
+                ++it) {
+            (*it)->SetMaxRetryCount(mMaxNumRetriesPerOp);
+            (*it)->SetMetaMaxRetryCount(mMaxNumRetriesPerOp);
+        }
     }
 }
 
@@ -4618,18 +5056,35 @@ KfsClientImpl::StartProtocolWorker()
     }
     params.mUseClientPoolFlag = mConfig.getValue(
         "client.connectionPool", params.mUseClientPoolFlag ? 1 : 0) != 0;
-    mProtocolWorker = new KfsProtocolWorker(
-        mMetaServerLoc.hostname,
-        mMetaServerLoc.port,
-        &params
-    );
-    mProtocolWorker->SetOpTimeoutSec(mDefaultOpTimeout);
-    mProtocolWorker->SetMetaOpTimeoutSec(mDefaultMetaOpTimeout);
-    mProtocolWorker->SetMaxRetryCount(mMaxNumRetriesPerOp);
-    mProtocolWorker->SetMetaMaxRetryCount(mMaxNumRetriesPerOp);
-    mProtocolWorker->SetTimeSecBetweenRetries(mRetryDelaySec);
-    mProtocolWorker->SetMetaTimeSecBetweenRetries(mRetryDelaySec);
-    mProtocolWorker->Start();
+    params.mReadHedgeMinDelayMs = mConfig.getValue(
+        "client.readHedgeMinDelayMs", params.mReadHedgeMinDelayMs);
+    params.mWriteAlignPartialBlocksFlag = mConfig.getValue(
+        "client.writeAlignPartialBlocks",
+        params.mWriteAlignPartialBlocksFlag ? 1 : 0) != 0;
+    params.mPreAllocateFlag = mConfig.getValue(
+        "client.writeAppendPreAllocate",
+        params.mPreAllocateFlag ? 1 : 0) != 0;
+    params.mMaxAppendBatchSize = mConfig.getValue(
+        "client.writeAppendMaxBatchSize", params.mMaxAppendBatchSize);
+    const int workerCount = max(1, min(64, mConfig.getValue(
+        "client.protocolWorkerThreads", 1)));
+    mProtocolWorkers.reserve(workerCount);
+    for (int i = 0; i < workerCount; i++) {
+        KfsProtocolWorker* const worker = new KfsProtocolWorker(
+            mMetaServerLoc.hostname,
+            mMetaServerLoc.port,
+            &params
+        );
+        worker->SetOpTimeoutSec(mDefaultOpTimeout);
+        worker->SetMetaOpTimeoutSec(mDefaultMetaOpTimeout);
+        worker->SetMaxRetryCount(mMaxNumRetriesPerOp);
+        worker->SetMetaMaxRetryCount(mMaxNumRetriesPerOp);
+        worker->SetTimeSecBetweenRetries(mRetryDelaySec);
+        worker->SetMetaTimeSecBetweenRetries(mRetryDelaySec);
+        worker->Start();
+        mProtocolWorkers.push_back(worker);
+    }
+    mProtocolWorker = mProtocolWorkers.front();
 }
 
 int
@@ -4795,6 +5250,18 @@ KfsClientImpl::SetIoBufferSize(FileTableEntry& entry, size_t size, bool optimalF
         const int stride  = attr.stripeSize * stripes;
         bufSize = (max(optimalFlag ? mTargetDiskIoSize * stripes : 0, bufSize) +
             stride - 1) / stride * stride;
+    } else if (bufSize > 0 && optimalFlag && 1 < mWriteParallelChunks &&
+            attr.striperType == KFS_STRIPED_FILE_TYPE_NONE &&
+            0 < attr.numReplicas &&
+            (entry.openMode & (O_WRONLY | O_RDWR)) != 0 &&
+            (entry.openMode & O_APPEND) == 0) {
+        // Buffer enough data to keep the specified number of chunks written
+        // in parallel by the writer, each chunk with its own chunk server
+        // replication chain.
+        bufSize = max(bufSize, (int)min(
+            (int64_t)numeric_limits<int>::max() /
+                CHECKSUM_BLOCKSIZE * CHECKSUM_BLOCKSIZE,
+            (int64_t)mWriteParallelChunks * (int64_t)CHUNKSIZE));
     }
     entry.ioBufferSize = max(0, bufSize);
     return entry.ioBufferSize;
@@ -4851,6 +5318,13 @@ KfsClientImpl::SetFileAttributeRevalidateTime(int secs)
     mFileAttributeRevalidateTime = secs;
 }
 
+int
+KfsClientImpl::GetFileAttributeRevalidateTime() const
+{
+    QCStMutexLocker lock(const_cast<KfsClientImpl*>(this)->mMutex);
+    return mFileAttributeRevalidateTime;
+}
+
 ///
 /// To compute the size of a file, determine what the last chunk in
 /// the file happens to be (from the meta server); then, for the last
@@ -5272,6 +5746,7 @@ KfsClientImpl::DoMetaOpWithRetry(KfsOp* op)
 void
 KfsClientImpl::ExecuteMeta(KfsOp& op)
 {
+    const int64_t startUsec = mIsMonitored ? microseconds() : int64_t(0);
     if (mMetaServer) {
         mMetaServer->GetNetManager().UpdateTimeNow();
         if (! mMetaServer->Enqueue(&op, this)) {
@@ -5292,6 +5767,10 @@ KfsClientImpl::ExecuteMeta(KfsOp& op)
         StartProtocolWorker();
         mProtocolWorker->ExecuteMeta(op);
     }
+    if (mIsMonitored) {
+        Monitor::ReportLatency(Monitor::kMetaOpLatency, mMetaServerLoc,
+            ServerLocation(), microseconds() - startUsec);
+    }
     KFS_LOG_STREAM_DEBUG <<
         "meta op done:" <<
         " seq: "    << op.seq <<
@@ -5407,9 +5886,8 @@ KfsClientImpl::NewFAttr(kfsFileId_t parentFid, const string& name,
         mFattrCacheSkipValidateCnt = 0;
         ValidateFAttrCache(time(0), mFileAttributeRevalidateScan);
     }
-    const size_t kMaxInodeCacheSize = 16 << 10;
     for (size_t sz = mFidNameToFAttrMap.size();
-            kMaxInodeCacheSize <= sz;
+            mFileAttributeCacheSize <= sz;
             sz--) {
         Delete(FAttrLru::Front(mFAttrLru));
     }
@@ -5847,6 +6325,37 @@ HandleDelegationResponse(
     return 0;
 }
 
+void
+KfsClientImpl::UpdateDelegationCache()
+{
+    if (! mAuthCtx.IsDelegationCacheUpdateNeeded()) {
+        return;
+    }
+    // Obtain delegation token with the current, presumably kerberos,
+    // authentication, in order to use the token with subsequent connections
+    // and client instances, instead of kerberos.
+    DelegateOp delegateOp(0);
+    delegateOp.allowDelegationFlag   = false;
+    delegateOp.requestedValidForTime =
+        (uint32_t)mAuthCtx.GetDelegationCacheValidForSec();
+    DoMetaOpWithRetry(&delegateOp);
+    DelegationToken token;
+    string          tokenStr;
+    string          keyStr;
+    string          errMsg;
+    int             status = HandleDelegationResponse(
+        delegateOp, token, tokenStr, keyStr, &errMsg);
+    if (status == 0) {
+        status = mAuthCtx.SetDelegation(tokenStr, keyStr, &errMsg);
+    }
+    KFS_LOG_STREAM(status == 0 ?
+            MsgLogger::kLogLevelDEBUG : MsgLogger::kLogLevelERROR) <<
+        "delegation cache update: " << delegateOp.Show() <<
+        " status: " << status <<
+        " "         << errMsg <<
+    KFS_LOG_EOM;
+}
+
     int
 KfsClientImpl::CreateDelegationToken(
     bool      allowDelegationFlag,
@@ -7452,6 +7961,20 @@ KfsClientImpl::GetStats()
     QCStMutexLocker l(mMutex);
     StartProtocolWorker();
     Properties stats = mProtocolWorker->GetStats();
+    for (size_t i = 1; i < mProtocolWorkers.size(); i++) {
+        const Properties workerStats = mProtocolWorkers[i]->GetStats();
+        string           prefix("Worker");
+        AppendDecIntToString(prefix, i);
+        prefix += '.';
+        const size_t     prefixLen   = prefix.size();
+        for (Properties::iterator it = workerStats.begin();
+                it != workerStats.end();
+                ++it) {
+            prefix.resize(prefixLen);
+            prefix.append(it->first.GetPtr(), it->first.GetSize());
+            stats.setValue(Properties::String(prefix), it->second);
+        }
+    }
     if (stats.empty()) {
         return 0;
     }
@@ -73,6 +73,37 @@ public:
         ErrorHandler(const ErrorHandler&) {}
         ErrorHandler& operator=(const ErrorHandler&) { return *this; }
     };
+    class ReadCompletion
+    {
+    public:
+        /// Invoked once the read is complete, and the buffer is no longer
+        /// used, with the number of bytes read or -errno.
+        virtual void Done(int64_t status) = 0;
+    protected:
+        ReadCompletion()  {}
+        virtual ~ReadCompletion() {}
+        ReadCompletion(const ReadCompletion&) {}
+        ReadCompletion& operator=(const ReadCompletion&) { return *this; }
+    };
+    class WriteCompletion
+    {
+    public:
+        /// Invoked once the buffer is no longer used, and can be re-used or
+        /// freed, with the number of bytes written or -errno.
+        virtual void Done(int64_t status) = 0;
+    protected:
+        WriteCompletion()  {}
+        virtual ~WriteCompletion() {}
+        WriteCompletion(const WriteCompletion&) {}
+        WriteCompletion& operator=(const WriteCompletion&) { return *this; }
+    };
+    struct ReadRange
+    {
+        chunkOff_t pos;    // [in] file position
+        size_t     size;   // [in] number of bytes to read
+        char*      buf;    // [in] buffer to read into
+        ssize_t    status; // [out] number of bytes read, or -errno
+    };
 
     KfsClient(client::KfsNetClient* metaServer = 0);
     ~KfsClient();
@@ -142,10 +173,36 @@ public:
     /// Read a directory's contents and retrieve the attributes
     /// @param[in] pathname The full pathname such as /.../dir
     /// @param[out] result  The files in the directory and their attributes.
+    /// @param[in] fnamePattern  If not null or empty, the meta server returns
+    /// only the entries with names matching the pattern with fnmatch() rules,
+    /// with no flags. The older meta servers ignore the pattern.
     /// @retval 0 if readdirplus is successful; -errno otherwise
     ///
     int ReaddirPlus(const char *pathname, vector<KfsFileAttr> &result,
         bool computeFilesize = true, bool updateClientCache = true,
+        bool fileIdAndTypeOnly = false, const char* fnamePattern = 0);
+
+    ///
+    /// Read the next batch of a directory's entries and their attributes.
+    /// Use to iterate over large directories without buffering the whole
+    /// directory content. The entries are returned in the meta server
+    /// order, not sorted. If the directory is modified while it is being
+    /// listed, the entries might be returned more than once.
+    /// @param[in] pathname The full pathname such as /.../dir
+    /// @param[in,out] cursor  Empty string to start from the beginning; on
+    /// return set to the restart point of the next batch
+    /// @param[out] result  The next batch of files and their attributes
+    /// @param[out] hasMoreEntries  Set to true if the listing isn't complete
+    /// @param[in] maxEntries  Max. number of entries to return, the server
+    /// might further limit the number of entries to bound the response size
+    /// @param[in] computeFilesize  If not set, the file sizes are not
+    /// computed, and no chunk locations lookups are performed
+    /// @retval 0 if readdirplus is successful; -EAGAIN if the cursor entry
+    /// was removed, and the listing has to be restarted; -errno otherwise
+    ///
+    int ReaddirPlus(const char* pathname, string& cursor,
+        vector<KfsFileAttr>& result, bool& hasMoreEntries,
+        int maxEntries = -1, bool computeFilesize = false,
         bool fileIdAndTypeOnly = false);
 
     ///
@@ -337,6 +394,27 @@ public:
     ///
     int Create(const char *pathname, bool exclusive, const char* params);
 
+    ///
+    /// Create empty files in a directory with one meta server round trip,
+    /// and one transaction log record, per batch of files, for small file
+    /// ingestion. The files are created exclusively (O_EXCL), and are not
+    /// opened. The names are submitted in batches that fit into the request
+    /// header. If a request is retried, for example due to a meta server
+    /// connection failure, the files created by the first attempt might be
+    /// reported as already existing.
+    /// @param[in] dirname  The directory such as /.../dir
+    /// @param[in] names  The file names
+    /// @param[out] outStatus  Per name status: 0 if the file was created,
+    /// -errno otherwise
+    /// @param[in] numReplicas  Replication, 0 for object store files
+    /// @retval number of files created on success; -errno if a request
+    /// as whole failed, in such case the names that were not processed
+    /// have the status set to the error code
+    ///
+    int CreateFiles(const char* dirname, const vector<string>& names,
+        vector<int>& outStatus, int numReplicas = 3, kfsMode_t mode = 0666,
+        kfsSTier_t minSTier = kKfsSTierMax, kfsSTier_t maxSTier = kKfsSTierMax);
+
     ///
     /// Remove a file which is specified by a complete path.
     /// @param[in] pathname that has to be removed
@@ -437,6 +515,47 @@ public:
     ///
     int ReadPrefetch(int fd, char *buf, size_t numBytes);
 
+    ///
+    /// Queue non-blocking read of up to numBytes at position pos, and
+    /// invoke completion.Done() when the read finishes. Unlike prefetch,
+    /// the request is independent of the file position and any number of
+    /// requests can be outstanding at the same time, including requests
+    /// spanning chunk boundaries. The completion is invoked from the
+    /// client protocol worker thread, or possibly from the calling thread
+    /// before this method returns, and must not block or call blocking
+    /// KfsClient methods. Close does not cancel outstanding requests, the
+    /// buffer must remain valid until the completion is invoked.
+    ///
+    /// @param[in] fd that corresponds to a previously opened file
+    /// table entry.
+    /// @param[in] pos        The file position to read from.
+    /// @param buf            The buffer to be filled with data.
+    /// @param[in] numBytes   The # of bytes of I/O to be done.
+    /// @param[in] completion Completion callback.
+    /// @retval The # of bytes queued, possibly less than numBytes if the
+    /// read extends past the end of file; 0 if nothing was queued and the
+    /// completion will not be invoked; -errno on failure.
+    ///
+    ssize_t ReadAsync(int fd, chunkOff_t pos, char *buf, size_t numBytes,
+        ReadCompletion& completion);
+
+    ///
+    /// Vectored read: read a list of possibly scattered file ranges, such
+    /// as columnar format column chunks. The ranges that are close to each
+    /// other are coalesced, and all resulting reads are issued in parallel.
+    /// The call blocks until all reads complete. The file position is not
+    /// modified. Each range status is set to the number of bytes read, which
+    /// can be less than the range size at the end of file, or to -errno.
+    ///
+    /// @param[in] fd that corresponds to a previously opened file
+    /// table entry.
+    /// @param ranges        The ranges to read.
+    /// @param[in] count     The number of ranges.
+    /// @retval The total number of bytes read; -errno if any of the reads
+    /// failed.
+    ///
+    ssize_t ReadV(int fd, ReadRange* ranges, int count);
+
     ///
     /// Similar to read prefetch, queue a write to a chunk.  In
     /// contrast to the read case, there are several differences:
@@ -456,6 +575,30 @@ public:
     ///
     int WriteAsync(int fd, const char *buf, size_t numBytes);
 
+    ///
+    /// Queue zero copy write of numBytes at position pos. The data is not
+    /// copied, the client references the caller's buffer until the data is
+    /// written to the chunk servers, then invokes completion.Done(). The
+    /// buffer must not be modified or freed until then. The completion is
+    /// invoked from the client protocol worker thread, or possibly from the
+    /// calling thread before this method returns, and must not block or
+    /// call blocking KfsClient methods. Write failures that occur after the
+    /// data was queued are reported by Sync() and Close(), like with the
+    /// buffered writes. Append mode is not supported.
+    ///
+    /// @param[in] fd that corresponds to a previously opened file
+    /// table entry.
+    /// @param[in] pos        The file position to write at.
+    /// @param buf            The buffer containing data to be written.
+    /// @param[in] numBytes   The # of bytes of I/O to be done.
+    /// @param[in] completion Completion callback.
+    /// @retval The # of bytes queued, possibly less than numBytes if it
+    /// exceeds 2GB; 0 if nothing was queued and the completion will not be
+    /// invoked; -errno on failure.
+    ///
+    ssize_t WriteAsync(int fd, chunkOff_t pos, const char *buf,
+        size_t numBytes, WriteCompletion& completion);
+
     ///
     /// A set of async writes were issued to a file.  Call this method
     /// to do completion handling.  If any of the async writes had
@@ -496,6 +639,17 @@ public:
     ///
     int Sync(int fd);
 
+    ///
+    /// Flush all pending writes of the specified files. The flushes of all
+    /// files are issued concurrently, and the method waits for all of them
+    /// to complete. This takes about one chunk server write round trip,
+    /// instead of one round trip per file with sequential Sync() calls.
+    /// @param[in] fds    Array of file descriptors.
+    /// @param[in] count  The number of file descriptors in the array.
+    /// @retval 0 on success; the first error encountered otherwise.
+    ///
+    int Sync(const int* fds, int count);
+
     /// \brief Adjust the current position of the file pointer similar
     /// to the seek() system call.
     /// @param[in] fd that corresponds to a previously opened file
@@ -555,6 +709,66 @@ public:
     int GetDataLocation(int fd, chunkOff_t start, chunkOff_t len,
         vector< vector <string> >& locations, chunkOff_t* outBlkSize);
 
+    struct ChunkDataLocation
+    {
+        chunkOff_t  offset;  // chunk position in the file layout
+        vector<int> servers; // indices in DirDataLocation::servers
+
+        ChunkDataLocation()
+            : offset(-1),
+              servers()
+            {}
+    };
+    struct FileDataLocation
+    {
+        string                    filename;
+        kfsFileId_t               fileId;
+        chunkOff_t                fileSize; // -1 if not known
+        int                       numStripes; // 0 if not striped
+        int                       numRecoveryStripes;
+        int                       stripeSize;
+        int                       numReplicas;
+        vector<ChunkDataLocation> chunks;
+
+        FileDataLocation()
+            : filename(),
+              fileId(-1),
+              fileSize(-1),
+              numStripes(0),
+              numRecoveryStripes(0),
+              stripeSize(0),
+              numReplicas(0),
+              chunks()
+            {}
+    };
+    struct DirDataLocation
+    {
+        vector<ServerLocation>   servers;
+        vector<FileDataLocation> files;
+    };
+
+    ///
+    /// Get the chunk locations of all files in a directory with one meta
+    /// server round trip per batch of files, for job planning. The
+    /// sub-directories are not included. The files and the servers are
+    /// appended to the result, the server indices remain valid across the
+    /// batches, therefore the caller can iterate until hasMoreEntries is
+    /// false, while accumulating the result. For striped files the chunk
+    /// position is the physical position in the striped file layout.
+    /// @param[in] pathname The full pathname such as /.../dir
+    /// @param[in,out] cursor  Empty string to start from the beginning; on
+    /// return set to the restart point of the next batch
+    /// @param[out] result  Files and chunk locations
+    /// @param[out] hasMoreEntries  Set to true if the listing isn't complete
+    /// @param[in] maxEntries  Max. number of directory entries to list, the
+    /// server might further limit the number of entries to bound the
+    /// response size
+    /// @retval 0 on success; -EAGAIN if the cursor entry was removed, and
+    /// the listing has to be restarted; -errno otherwise
+    ///
+    int GetDirDataLocation(const char* pathname, string& cursor,
+        DirDataLocation& result, bool& hasMoreEntries, int maxEntries = -1);
+
     ///
     /// Get the degree of replication for the pathname.
     /// @param[in] pathname The full pathname of the file such as /../foo
@@ -596,6 +810,18 @@ public:
     void SetMaxRetryPerOp(int retryCount);
     int  GetMaxRetryPerOp() const;
 
+    ///
+    /// Set request trace id of the calling thread, 0 -- no trace id.
+    /// The trace id is sent with the meta and chunk server requests, and
+    /// is logged by the servers along with the slow requests. The files
+    /// read or written by the calling thread use the trace id set at the
+    /// time of the first read or write for all subsequent reads and writes,
+    /// until the file is closed.
+    /// @param[in] trace id
+    ///
+    void    SetTraceId(int64_t traceId);
+    int64_t GetTraceId() const;
+
     ///
     /// Set default io buffer size.
     /// This has no effect on already opened files.
@@ -665,6 +891,7 @@ public:
     // Must be invoked before issuing the first read.
     int SetFullSparseFileSupport(int fd, bool flag);
     void SetFileAttributeRevalidateTime(int secs);
+    int GetFileAttributeRevalidateTime() const;
     int Chmod(const char* pathname, kfsMode_t mode);
     int Chmod(int fd, kfsMode_t mode);
     int Chown(const char* pathname, kfsUid_t user, kfsGid_t group);
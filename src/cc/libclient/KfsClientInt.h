@@ -210,6 +210,12 @@ struct FileTableEntry {
     int                  ioBufferSize;
     ReadBuffer           buffer;
     ReadRequest*         mReadQueue[1];
+    // Adaptive read ahead state: the size set by SetReadAheadSize(), the
+    // expected position of the next sequential read, and the number of
+    // consecutive sequential (positive) or random (negative) reads.
+    int                  readAheadBaseSize;
+    chunkOff_t           readAheadNextPos;
+    int                  readAheadSeqCount;
 
     FileTableEntry(kfsFileId_t p, const string& n, unsigned int instance):
         parentFid(p),
@@ -228,7 +234,10 @@ struct FileTableEntry {
         pending(0),
         dirEntries(0),
         ioBufferSize(0),
-        buffer()
+        buffer(),
+        readAheadBaseSize(0),
+        readAheadNextPos(0),
+        readAheadSeqCount(0)
         { mReadQueue[0] = 0; }
     ~FileTableEntry()
     {
@@ -321,6 +330,29 @@ public:
     ///
     int ReaddirPlus(const char *pathname, vector<KfsFileAttr> &result,
         bool computeFilesize = true, bool updateClientCache = true,
+        bool fileIdAndTypeOnly = false, const char* fnamePattern = 0);
+
+    ///
+    /// Read the next batch of a directory's entries and their attributes.
+    /// Use to iterate over large directories without buffering the whole
+    /// directory content. The entries are returned in the meta server
+    /// order, not sorted. If the directory is modified while it is being
+    /// listed, the entries might be returned more than once.
+    /// @param[in] pathname The full pathname such as /.../dir
+    /// @param[in,out] cursor  Empty string to start from the beginning; on
+    /// return set to the restart point of the next batch
+    /// @param[out] result  The next batch of files and their attributes
+    /// @param[out] hasMoreEntries  Set to true if the listing isn't complete
+    /// @param[in] maxEntries  Max. number of entries to return, the server
+    /// might further limit the number of entries to bound the response size
+    /// @param[in] computeFilesize  If not set, the file sizes are not
+    /// computed, and no chunk locations lookups are performed
+    /// @retval 0 if readdirplus is successful; -EAGAIN if the cursor entry
+    /// was removed, and the listing has to be restarted; -errno otherwise
+    ///
+    int ReaddirPlus(const char* pathname, string& cursor,
+        vector<KfsFileAttr>& result, bool& hasMoreEntries,
+        int maxEntries = -1, bool computeFilesize = false,
         bool fileIdAndTypeOnly = false);
 
     ///
@@ -393,6 +425,10 @@ public:
         kfsMode_t mode = kKfsModeUndef,
         kfsSTier_t minSTier = kKfsSTierMax, kfsSTier_t maxSTier = kKfsSTierMax);
 
+    int CreateFiles(const char* dirname, const vector<string>& names,
+        vector<int>& outStatus, int numReplicas, kfsMode_t mode,
+        kfsSTier_t minSTier, kfsSTier_t maxSTier);
+
     ///
     /// Remove a file which is specified by a complete path.
     /// @param[in] pathname that has to be removed
@@ -456,7 +492,14 @@ public:
     /// See the comments in KfsClient.h
     int ReadPrefetch(int fd, char *buf, size_t numBytes);
 
+    ssize_t ReadAsync(int fd, chunkOff_t pos, char *buf, size_t numBytes,
+        KfsClient::ReadCompletion& completion);
+
+    ssize_t ReadV(int fd, KfsClient::ReadRange* ranges, int count);
+
     int WriteAsync(int fd, const char *buf, size_t numBytes);
+    ssize_t WriteAsync(int fd, chunkOff_t pos, const char *buf,
+        size_t numBytes, KfsClient::WriteCompletion& completion);
     int WriteAsyncCompletionHandler(int fd);
 
     ///
@@ -483,6 +526,7 @@ public:
     /// opened for writing.
     ///
     int Sync(int fd);
+    int Sync(const int* fds, int count);
 
     /// \brief Adjust the current position of the file pointer similar
     /// to the seek() system call.
@@ -537,6 +581,10 @@ public:
     int GetDataLocation(int fd, chunkOff_t start, chunkOff_t len,
         vector<vector<string> > &locations, chunkOff_t* outBlkSize);
 
+    int GetDirDataLocation(const char* pathname, string& cursor,
+        KfsClient::DirDataLocation& result, bool& hasMoreEntries,
+        int maxEntries);
+
     ///
     /// Get the degree of replication for the pathname.
     /// @param[in] pathname The full pathname of the file such as /../foo
@@ -588,6 +636,7 @@ public:
     // Must be invoked before issuing the first read.
     int SetFullSparseFileSupport(int fd, bool flag);
     void SetFileAttributeRevalidateTime(int secs);
+    int GetFileAttributeRevalidateTime() const;
     int Chmod(const char* pathname, kfsMode_t mode);
     int Chmod(int fd, kfsMode_t mode);
     int Chown(const char* pathname, kfsUid_t user, kfsGid_t group);
@@ -718,6 +767,7 @@ private:
         true
     > FAttrPool;
     typedef vector<int>                        FreeFileTableEntires;
+    typedef vector<KfsProtocolWorker*>         ProtocolWorkers;
     typedef vector<pair<kfsFileId_t, size_t> > TmpPath;
 
     typedef map<kfsUid_t, pair<string, time_t>,
@@ -771,6 +821,7 @@ private:
     int                            mFileAttributeRevalidateTime;
     unsigned int                   mFileAttributeRevalidateScan;
     unsigned int                   mFAttrCacheGeneration;
+    size_t                         mFileAttributeCacheSize;
     TmpPath                        mTmpPath;
     string                         mTmpAbsPathStr;
     Path                           mTmpAbsPath;
@@ -779,9 +830,13 @@ private:
     const string                   mSlash;
     size_t                         mDefaultIoBufferSize;
     size_t                         mDefaultReadAheadSize;
+    int                            mMaxAdaptiveReadAheadSize;
+    int                            mWriteParallelChunks;
     bool                           mFailShortReadsFlag;
+    bool                           mServerRmdirsFlag;
     unsigned int                   mFileInstance;
     KfsProtocolWorker*             mProtocolWorker;
+    ProtocolWorkers                mProtocolWorkers;
     int                            mMaxNumRetriesPerOp;
     int                            mRetryDelaySec;
     int                            mDefaultOpTimeout;
@@ -869,6 +924,7 @@ private:
         int numStripes, int numRecoveryStripes, int stripeSize, int stripedType,
         bool forceTypeFlag, kfsMode_t mode, kfsSTier_t minSTier, kfsSTier_t maxSTier);
     ssize_t SetReadAheadSize(FileTableEntry& inEntry, size_t inSize, bool optimalFlag = false);
+    bool AdaptReadAhead(FileTableEntry& inEntry, chunkOff_t inPos, int inSize);
     ssize_t SetIoBufferSize(FileTableEntry& entry, size_t size, bool optimalFlag = false);
     ssize_t SetOptimalIoBufferSize(FileTableEntry& entry, size_t size) {
         return SetIoBufferSize(entry, size, true);
@@ -979,7 +1035,7 @@ private:
     int ReaddirPlus(const string& pathname, kfsFileId_t dirFid,
         vector<KfsFileAttr> &result,
         bool computeFilesize = true, bool updateClientCache = true,
-        bool fileIdAndTypeOnly = false);
+        bool fileIdAndTypeOnly = false, const char* fnamePattern = 0);
 
     int Rmdirs(const string &parentDir, kfsFileId_t parentFid, const string &dirname, kfsFileId_t dirFid);
     int Remove(const string &parentDir, kfsFileId_t parentFid, const string &entryName);
@@ -993,6 +1049,15 @@ private:
     int RmdirsSelf(const string& path, const string& dirname,
         kfsFileId_t parentFid, kfsFileId_t dirFid, ErrorHandler& errHandler);
     void StartProtocolWorker();
+    // Files are sharded across the protocol workers by file id, in order to
+    // spread the protocol and checksum / erasure code computation load across
+    // multiple threads. The first worker is also used for meta server ops.
+    KfsProtocolWorker& GetProtocolWorker(kfsFileId_t fileId) const
+    {
+        assert(mProtocolWorker && ! mProtocolWorkers.empty());
+        return *mProtocolWorkers[
+            (size_t)fileId % mProtocolWorkers.size()];
+    }
     void InvalidateAllCachedAttrs();
     int GetUserAndGroup(const char* user, const char* group, kfsUid_t& uid, kfsGid_t& gid);
     template<typename T> int RecursivelyApply(
@@ -1095,6 +1160,7 @@ private:
         bool                     inNewEntryFlag,
         vector<vector<string> >& inLocations);
     int InitUserAndGroupMode();
+    void UpdateDelegationCache();
     friend struct RespondingServer;
     friend struct RespondingServer2;
     friend class ChmodFunc;
@@ -622,7 +622,7 @@ public:
             case EVENT_NET_ERROR:
                 if (mConnPtr) {
                     if (mSslShutdownInProgressFlag && mConnPtr->IsGood()) {
-                        KFS_LOG_STREAM(mConnPtr->GetFilter() ?
+                        KFS_LOG_STREAM(mConnPtr->IsEncrypted() ?
                                 MsgLogger::kLogLevelERROR :
                                 MsgLogger::kLogLevelDEBUG) << mLogPrefix <<
                             "ssl shutdown completion:"
@@ -630,7 +630,7 @@ public:
                                 mConnPtr->GetFilter()) <<
                         KFS_LOG_EOM;
                         mSslShutdownInProgressFlag = false;
-                        if (! mConnPtr->GetFilter()) {
+                        if (! mConnPtr->IsEncrypted()) {
                             mConnPtr->StartFlush();
                             break;
                         }
@@ -638,6 +638,13 @@ public:
                     if (mAuthContextPtr && mConnPtr->IsAuthFailure()) {
                         mAuthFailureCount++;
                         theError = -EPERM;
+                        if (mAuthOp.chosenAuthType == kAuthenticationTypePSK) {
+                            // Fall back to kerberos if the cached delegation
+                            // token was rejected, e.g. canceled or meta
+                            // server keys have changed.
+                            mAuthContextPtr->InvalidateDelegation(
+                                mAuthContextPtr->GetPskId());
+                        }
                     } else {
                         mAuthFailureCount = 0;
                         if (0 == theError) {
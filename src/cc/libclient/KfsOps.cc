@@ -63,6 +63,7 @@ static const char* InitHostName()
 static const char* const sHostName(InitHostName());
 
 string KfsOp::sExtraHeaders;
+__thread int64_t KfsOp::sCurrentTraceId = 0;
 
 class KfsOp::ReqHeaders
 {
@@ -81,6 +82,9 @@ public:
         if (op.maxWaitMillisec > 0) {
             os << "Max-wait-ms: " << op.maxWaitMillisec << "\r\n";
         }
+        if (op.traceId != 0) {
+            os << "Trace-id: " << op.traceId << "\r\n";
+        }
         return os;
     }
 private:
@@ -212,6 +216,24 @@ CreateOp::Request(ostream &os)
     os << "\r\n";
 }
 
+void
+CreateBatchOp::Request(ostream &os)
+{
+    os <<
+        "CREATE_BATCH\r\n"     << ReqHeaders(*this) <<
+        "Parent File-handle: " << parentFid         << "\r\n"
+        "Filenames: "          << names             << "\r\n"
+        "Num-replicas: "       << numReplicas       << "\r\n"
+    ;
+    PutPermissions(os, permissions);
+    if (minSTier < kKfsSTierMax) {
+        os <<
+            "Min-tier: " << (int)minSTier << "\r\n"
+            "Max-tier: " << (int)maxSTier << "\r\n";
+    }
+    os << "\r\n";
+}
+
 void
 MkdirOp::Request(ostream &os)
 {
@@ -238,6 +260,17 @@ RmdirOp::Request(ostream &os)
     "\r\n";
 }
 
+void
+RmdirsOp::Request(ostream &os)
+{
+    os <<
+        "RMDIRS \r\n"          << ReqHeaders(*this) <<
+        "Parent File-handle: " << parentFid         << "\r\n"
+        "Pathname: "           << pathname          << "\r\n"
+        "Directory: "          << dirname           << "\r\n"
+    "\r\n";
+}
+
 void
 RenameOp::Request(ostream &os)
 {
@@ -318,6 +351,23 @@ ReaddirPlusOp::Request(ostream &os)
     if (! fnameStart.empty()) {
         os << "Fname-start: " << fnameStart << "\r\n";
     }
+    if (! fnamePattern.empty()) {
+        os << "Fname-pattern: " << fnamePattern << "\r\n";
+    }
+    os << "\r\n";
+}
+
+void
+GetDirLayoutOp::Request(ostream &os)
+{
+    os <<
+        "GETDIRLAYOUT\r\n"        << ReqHeaders(*this) <<
+        "Directory File-handle: " << fid               << "\r\n"
+        "Max-entries: "           << numEntries        << "\r\n"
+    ;
+    if (! fnameStart.empty()) {
+        os << "Fname-start: " << fnameStart << "\r\n";
+    }
     os << "\r\n";
 }
 
@@ -723,6 +773,9 @@ LeaseRenewOp::Request(ostream &os)
     if (getCSAccessFlag) {
         os << "CS-access: 1\r\n";
     }
+    if (! chunkLeases.empty()) {
+        os << "Chunk-leases: " << chunkLeases << "\r\n";
+    }
     os << "\r\n";
 }
 
@@ -902,6 +955,17 @@ CreateOp::ParseResponseHeaderSelf(const Properties &prop)
     }
 }
 
+void
+CreateBatchOp::ParseResponseHeaderSelf(const Properties &prop)
+{
+    fileId       = prop.getValue("File-handle",   (kfsFileId_t) -1);
+    numCreated   = prop.getValue("Num-created",   0);
+    failedStatus = prop.getValue("Failed-status", 0);
+    if (failedStatus < 0) {
+        failedStatus = -KfsToSysErrno(-failedStatus);
+    }
+}
+
 void
 ReaddirOp::ParseResponseHeaderSelf(const Properties &prop)
 {
@@ -909,6 +973,13 @@ ReaddirOp::ParseResponseHeaderSelf(const Properties &prop)
     hasMoreEntriesFlag = prop.getValue("Has-more-entries", 0) != 0;
 }
 
+void
+RmdirsOp::ParseResponseHeaderSelf(const Properties &prop)
+{
+    filesRemoved = prop.getValue("Files-removed", (int64_t)0);
+    dirsRemoved  = prop.getValue("Dirs-removed",  (int64_t)0);
+}
+
 void
 DumpChunkServerMapOp::ParseResponseHeaderSelf(const Properties &prop)
 {
@@ -929,6 +1000,15 @@ ReaddirPlusOp::ParseResponseHeaderSelf(const Properties &prop)
 {
     numEntries         = prop.getValue("Num-Entries", 0);
     hasMoreEntriesFlag = prop.getValue("Has-more-entries", 0) != 0;
+    fnameNext          = prop.getValue("Fname-next", string());
+}
+
+void
+GetDirLayoutOp::ParseResponseHeaderSelf(const Properties &prop)
+{
+    numEntries         = prop.getValue("Num-Entries", 0);
+    numServers         = prop.getValue("Num-servers", 0);
+    hasMoreEntriesFlag = prop.getValue("Has-more-entries", 0) != 0;
 }
 
 void
@@ -1138,6 +1218,20 @@ GetAllocOp::ParseResponseHeaderSelf(const Properties &prop)
             chunkServers.push_back(loc);
         }
     }
+    chunkServersLoad.clear();
+    const Properties::String* const load = prop.getValue("Replicas-load");
+    if (load) {
+        const char*       p = load->GetPtr();
+        const char* const e = p + load->GetSize();
+        int               v = 0;
+        while (p < e && (int)chunkServersLoad.size() < numReplicas &&
+                ValueParser::ParseInt(p, e - p, v)) {
+            chunkServersLoad.push_back(v);
+        }
+        if ((int)chunkServersLoad.size() != numReplicas) {
+            chunkServersLoad.clear();
+        }
+    }
 }
 
 void
@@ -1146,6 +1240,7 @@ ChunkAccessOp::ParseResponseHeaderSelf(const Properties& prop)
     accessResponseIssued      = prop.getValue("Acess-issued", int64_t(0));
     accessResponseValidForSec = prop.getValue("Acess-time",   int64_t(0));
     chunkAccessResponse       = prop.getValue("C-access",     string());
+    buffersWaitUsecs          = prop.getValue("Buffers-wait-usec", int64_t(0));
     chunkServerAccessId.clear();
     ParseChunkServerAccess(
         *this,
@@ -1252,7 +1347,8 @@ WriteIdAllocOp::ParseResponseHeaderSelf(const Properties& prop)
 void
 LeaseAcquireOp::ParseResponseHeaderSelf(const Properties& prop)
 {
-    leaseId = prop.getValue("Lease-id", int64_t(-1));
+    leaseId       = prop.getValue("Lease-id", int64_t(-1));
+    leaseDuration = prop.getValue("Lease-timeout", -1);
     if (leaseIds) {
         leaseIds[0] = -1;
     }
@@ -1290,6 +1386,7 @@ LeaseRenewOp::ParseResponseHeaderSelf(const Properties& prop)
     chunkServerAccessValidForTime = prop.getValue("CS-acess-time",   0);
     chunkServerAccessIssuedTime   = prop.getValue("CS-acess-issued", 0);
     allowCSClearTextFlag          = prop.getValue("CS-clear-text", 0) != 0;
+    failedLeases                  = prop.getValue("Failed-leases", string());
 }
 
 void
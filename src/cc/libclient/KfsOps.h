@@ -62,15 +62,18 @@ enum KfsOp_t {
     // Meta-data server RPCs
     CMD_GETALLOC,
     CMD_GETLAYOUT,
+    CMD_GETDIRLAYOUT,
     CMD_ALLOCATE,
     CMD_TRUNCATE,
     CMD_LOOKUP,
     CMD_MKDIR,
     CMD_RMDIR,
+    CMD_RMDIRS,
     CMD_READDIR,
     CMD_READDIRPLUS,
     CMD_GETDIRSUMMARY,
     CMD_CREATE,
+    CMD_CREATE_BATCH,
     CMD_REMOVE,
     CMD_RENAME,
     CMD_SETMTIME,
@@ -143,6 +146,7 @@ struct KfsOp {
     int      lastError;
     uint32_t checksum; // a checksum over the data
     int64_t  maxWaitMillisec;
+    int64_t  traceId; // optional request trace id, 0 -- none
     size_t   contentLength;
     size_t   contentBufLen;
     char*    contentBuf;
@@ -155,6 +159,7 @@ struct KfsOp {
           lastError(0),
           checksum(0),
           maxWaitMillisec(-1),
+          traceId(sCurrentTraceId),
           contentLength(0),
           contentBufLen(0),
           contentBuf(0),
@@ -229,11 +234,21 @@ struct KfsOp {
     }
     static void AddDefaultRequestHeaders(
         kfsUid_t euser = kKfsUserNone, kfsGid_t egroup = kKfsGroupNone);
+    // The trace id is per thread: the ops created by the calling thread
+    // inherit the current trace id, which is sent with the requests as
+    // "Trace-id" header, and logged by the meta and chunk servers.
+    static void SetCurrentTraceId(int64_t id) {
+        sCurrentTraceId = id;
+    }
+    static int64_t GetCurrentTraceId() {
+        return sCurrentTraceId;
+    }
     class ReqHeaders;
     friend class OpsHeaders;
 private:
-    bool          contentBufOwnerFlag;
-    static string sExtraHeaders;
+    bool                   contentBufOwnerFlag;
+    static string          sExtraHeaders;
+    static __thread int64_t sCurrentTraceId;
 };
 
 struct KfsNullOp : public KfsOp
@@ -305,6 +320,52 @@ struct CreateOp : public KfsOp {
     }
 };
 
+// Create files in one directory. The names are '/' separated. The meta server
+// creates the files in the order of the names until the first failure, and
+// returns the number of files created, the id of the first one (the ids are
+// consecutive), and the status of the name that failed.
+struct CreateBatchOp : public KfsOp {
+    kfsFileId_t   parentFid;    // input parent file-id
+    const string& names;
+    int           numReplicas;
+    Permissions   permissions;
+    kfsSTier_t    minSTier;
+    kfsSTier_t    maxSTier;
+    kfsFileId_t   fileId;       // first file created
+    int           numCreated;
+    int           failedStatus;
+    CreateBatchOp(kfsSeq_t s,
+            kfsFileId_t        p,
+            const string&      n,
+            int                r,
+            const Permissions& perms   = Permissions(),
+            kfsSTier_t         minTier = kKfsSTierMax,
+            kfsSTier_t         maxTier = kKfsSTierMax)
+        : KfsOp(CMD_CREATE_BATCH, s),
+          parentFid(p),
+          names(n),
+          numReplicas(r),
+          permissions(perms),
+          minSTier(minTier),
+          maxSTier(maxTier),
+          fileId(-1),
+          numCreated(0),
+          failedStatus(0)
+        {}
+    void Request(ostream& os);
+    virtual void ParseResponseHeaderSelf(const Properties& prop);
+    virtual ostream& ShowSelf(ostream& os) const {
+        os <<
+            "create batch:"
+            " parent: "  << parentFid <<
+            " created: " << numCreated <<
+            " first: "   << fileId <<
+            " failed: "  << failedStatus
+        ;
+        return os;
+    }
+};
+
 struct RemoveOp : public KfsOp {
     kfsFileId_t parentFid; // input parent file-id
     const char *filename;
@@ -366,6 +427,25 @@ struct RmdirOp : public KfsOp {
     }
 };
 
+// Server side recursive directory removal.
+struct RmdirsOp : public KfsOp {
+    kfsFileId_t parentFid; // input parent file-id
+    const char* dirname;
+    const char* pathname; // input: full pathname
+    int64_t     filesRemoved; // output
+    int64_t     dirsRemoved;  // output
+    RmdirsOp(kfsSeq_t s, kfsFileId_t p, const char* d, const char* pn)
+        : KfsOp(CMD_RMDIRS, s), parentFid(p), dirname(d), pathname(pn),
+          filesRemoved(0), dirsRemoved(0)
+        {}
+    void Request(ostream& os);
+    virtual void ParseResponseHeaderSelf(const Properties& prop);
+    virtual ostream& ShowSelf(ostream& os) const {
+        os << "rmdirs: " << dirname << " (parentfid = " << parentFid << ")";
+        return os;
+    }
+};
+
 struct RenameOp : public KfsOp {
     kfsFileId_t parentFid; // input parent file-id
     const char *oldname;  // old file name/dir
@@ -478,6 +558,8 @@ struct ReaddirPlusOp : public KfsOp {
     bool        hasMoreEntriesFlag;
     int         numEntries; // # of entries in the directory
     string      fnameStart;
+    string      fnamePattern; // return only entries matching the pattern
+    string      fnameNext;    // restart point returned with the pattern
     ReaddirPlusOp(kfsSeq_t s, kfsFileId_t f, bool cif, bool olcif, bool fidtof)
         : KfsOp(CMD_READDIRPLUS, s),
           fid(f),
@@ -486,7 +568,9 @@ struct ReaddirPlusOp : public KfsOp {
           fileIdAndTypeOnlyFlag(fidtof),
           hasMoreEntriesFlag(false),
           numEntries(0),
-          fnameStart()
+          fnameStart(),
+          fnamePattern(),
+          fnameNext()
         {}
     void Request(ostream& os);
     // This will only extract out the default+num-entries.  The actual
@@ -594,6 +678,8 @@ struct GetAllocOp: public KfsOp {
                                                // by its preference / load -- try the servers in this order.
     bool                   objectStoreFlag;
     vector<ServerLocation> chunkServers; // result: where the chunk is hosted name/port
+    vector<int>            chunkServersLoad; // result: load hints, 100 or greater
+                                             // means that the server is overloaded
     string                 filename;     // input
 
     GetAllocOp(kfsSeq_t s, kfsFileId_t f, chunkOff_t o)
@@ -605,6 +691,7 @@ struct GetAllocOp: public KfsOp {
           serversOrderedFlag(false),
           objectStoreFlag(false),
           chunkServers(),
+          chunkServersLoad(),
           filename()
         {}
     void Request(ostream& os);
@@ -681,6 +768,36 @@ struct GetLayoutOp: public KfsOp {
     }
 };
 
+// Get the layout and chunk locations of all files in a directory. The content
+// starts with the chunk servers table, followed by the directory entries.
+struct GetDirLayoutOp: public KfsOp {
+    kfsFileId_t fid;        // fid of the directory
+    int         numEntries; // in: max entries, out: entries returned
+    int         numServers;
+    bool        hasMoreEntriesFlag;
+    string      fnameStart;
+    GetDirLayoutOp(kfsSeq_t s, kfsFileId_t f)
+        : KfsOp(CMD_GETDIRLAYOUT, s),
+          fid(f),
+          numEntries(0),
+          numServers(0),
+          hasMoreEntriesFlag(false),
+          fnameStart()
+        {}
+    void Request(ostream& os);
+    virtual void ParseResponseHeaderSelf(const Properties& prop);
+    virtual ostream& ShowSelf(ostream& os) const {
+        os <<
+            "getdirlayout:"
+            " fid: "     << fid <<
+            " start: "   << fnameStart <<
+            " entries: " << numEntries <<
+            " servers: " << numServers <<
+            " hasmore: " << hasMoreEntriesFlag;
+        return os;
+    }
+};
+
 class ChunkServerAccess
 {
 public:
@@ -827,6 +944,7 @@ struct ChunkAccessOp: public KfsOp {
     string          chunkServerAccessId;
     CryptoKeys::Key chunkServerAccessKey;
     const string*   decryptKey;
+    int64_t         buffersWaitUsecs; // Chunk server back pressure hint.
 
     ChunkAccessOp(KfsOp_t o, kfsSeq_t s, kfsChunkId_t c)
         : KfsOp(o, s),
@@ -842,7 +960,8 @@ struct ChunkAccessOp: public KfsOp {
           chunkAccessResponse(),
           chunkServerAccessId(),
           chunkServerAccessKey(),
-          decryptKey(0)
+          decryptKey(0),
+          buffersWaitUsecs(0)
         {}
     AccessReq Access() const
         { return AccessReq(*this); }
@@ -1212,6 +1331,7 @@ struct LeaseAcquireOp : public KfsOp {
     bool                   flushFlag;    // input
     int                    leaseTimeout; // input
     int64_t                leaseId;      // output
+    int                    leaseDuration; // output
     int                    chunkAccessCount;
     int64_t                chunkServerAccessValidForTime;
     int64_t                chunkServerAccessIssuedTime;
@@ -1231,6 +1351,7 @@ struct LeaseAcquireOp : public KfsOp {
           flushFlag(false),
           leaseTimeout(-1),
           leaseId(-1),
+          leaseDuration(-1),
           chunkAccessCount(0),
           chunkServerAccessValidForTime(0),
           chunkServerAccessIssuedTime(0),
@@ -1265,6 +1386,9 @@ struct LeaseRenewOp : public KfsOp {
     int64_t        chunkServerAccessValidForTime;
     int64_t        chunkServerAccessIssuedTime;
     bool           allowCSClearTextFlag;
+    string         chunkLeases;  // input: additional "chunkId leaseId" pairs,
+                                 // must fit into MAX_RPC_HEADER_LEN
+    string         failedLeases; // output: "chunkId status" pairs
 
     LeaseRenewOp(kfsSeq_t s, kfsChunkId_t c, int64_t l, const char* p)
         : KfsOp(CMD_LEASE_RENEW, s),
@@ -1277,7 +1401,9 @@ struct LeaseRenewOp : public KfsOp {
           chunkAccessCount(0),
           chunkServerAccessValidForTime(0),
           chunkServerAccessIssuedTime(0),
-          allowCSClearTextFlag(false)
+          allowCSClearTextFlag(false),
+          chunkLeases(),
+          failedLeases()
         {}
     void Request(ostream& os);
     virtual void ParseResponseHeaderSelf(const Properties& prop);
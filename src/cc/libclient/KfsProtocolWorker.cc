@@ -88,7 +88,7 @@ public:
         const Parameters& inParameters)
         : QCRunnable(),
           ITimeout(),
-          mNetManager(),
+          mNetManager(GetPollTimeoutMs(inParameters)),
           mMetaServer(
             mNetManager,
             inMetaHost,
@@ -128,6 +128,10 @@ public:
           mMaxReadSize(inParameters.mMaxReadSize),
           mReadLeaseRetryTimeout(inParameters.mReadLeaseRetryTimeout),
           mLeaseWaitTimeout(inParameters.mLeaseWaitTimeout),
+          mReadHedgeMinDelayMs(inParameters.mReadHedgeMinDelayMs),
+          mWriteAlignPartialBlocksFlag(
+            inParameters.mWriteAlignPartialBlocksFlag),
+          mMaxAppendBatchSize(inParameters.mMaxAppendBatchSize),
           mChunkServerInitialSeqNum(
             inParameters.mChunkServerInitialSeqNum > 0 ?
                 inParameters.mChunkServerInitialSeqNum :
@@ -890,7 +894,10 @@ private:
               mDonePos(0),
               mLastSyncReqPtr(0),
               mCloseReqPtr(0)
-            { WorkQueue::Init(mWorkQueue); }
+        {
+            WorkQueue::Init(mWorkQueue);
+            mWAppender.SetMaxAppendBatchSize(inOwner.mMaxAppendBatchSize);
+        }
         virtual ~Appender()
         {
             mWAppender.Shutdown();
@@ -910,7 +917,10 @@ private:
         virtual int Open(
             FileId                 inFileId,
             const Request::Params& inParams)
-            { return mWAppender.Open(inFileId, inParams.mPathName.c_str()); }
+        {
+            mWAppender.SetTraceId(inParams.mTraceId);
+            return mWAppender.Open(inFileId, inParams.mPathName.c_str());
+        }
         virtual void Done(
             WriteAppender& inAppender,
             int            inStatusCode)
@@ -1113,7 +1123,9 @@ private:
                 min(max(4 << 20, inOwner.mMaxWriteSize),
                     max(inOwner.mMaxWriteSize, inMaxWriteSize)),
                 inLogPrefixPtr,
-                inOwner.mChunkServerInitialSeqNum
+                inOwner.mChunkServerInitialSeqNum,
+                inOwner.mClientPoolPtr,
+                inOwner.mWriteAlignPartialBlocksFlag
               ),
               mCurRequestPtr(0)
             { WorkQueue::Init(mWorkQueue); }
@@ -1138,6 +1150,7 @@ private:
             FileId                 inFileId,
             const Request::Params& inParams)
         {
+            mWriter.SetTraceId(inParams.mTraceId);
             return mWriter.Open(
                 inFileId,
                 inParams.mPathName.c_str(),
@@ -1163,6 +1176,7 @@ private:
             }
             switch (inRequest.mRequestType) {
                 case kRequestTypeWriteAsync:
+                case kRequestTypeWriteAsyncNoCopy:
                     if (inRequest.mSize <= 0) {
                         Impl::Done(inRequest, 0);
                         return;
@@ -1412,7 +1426,8 @@ private:
                 inOwner.mLeaseWaitTimeout,
                 inLogPrefixPtr,
                 inOwner.mChunkServerInitialSeqNum,
-                inOwner.mClientPoolPtr),
+                inOwner.mClientPoolPtr,
+                inOwner.mReadHedgeMinDelayMs),
               mCurRequestPtr(0),
               mAsyncReadStatus(0),
               mAsyncReadDoneCount(0)
@@ -1440,6 +1455,7 @@ private:
         {
             const bool   kUseDefaultBufferAllocatorFlag = false;
             const Offset kRecoverChunkPos               = -1;
+            mReader.SetTraceId(inParams.mTraceId);
             return mReader.Open(
                 inFileId,
                 inParams.mPathName.c_str(),
@@ -1655,6 +1671,9 @@ private:
     const int            mMaxReadSize;
     const int            mReadLeaseRetryTimeout;
     const int            mLeaseWaitTimeout;
+    const int            mReadHedgeMinDelayMs;
+    const bool           mWriteAlignPartialBlocksFlag;
+    const int            mMaxAppendBatchSize;
     int64_t              mChunkServerInitialSeqNum;
     DoNotDeallocate      mDoNotDeallocate;
     StopRequest          mStopRequest;
@@ -1770,6 +1789,19 @@ private:
         QCStMutexLocker lock(mMutex);
         FreeSyncRequests::PushFront(mFreeSyncRequests, inRequest);
     }
+    static int GetPollTimeoutMs(
+        const Parameters& inParameters)
+    {
+        // Hedged reads need timer resolution finer than the default net
+        // manager poll timeout.
+        const int kDefaultPollTimeoutMs = 1000;
+        const int kMinPollTimeoutMs     = 10;
+        return (0 < inParameters.mReadHedgeMinDelayMs ?
+            max(kMinPollTimeoutMs, min(kDefaultPollTimeoutMs,
+                inParameters.mReadHedgeMinDelayMs / 4)) :
+            kDefaultPollTimeoutMs
+        );
+    }
     static int64_t GetInitalSeqNum()
     {
         int64_t theRet = 0;
@@ -108,7 +108,9 @@ public:
                   mReplicaCount(inReplicaCount),
                   mSkipHolesFlag(inSkipHolesFlag),
                   mMsgLogId(inMsgLogId),
-                  mFailShortReadsFlag(inFailShortReadsFlag)
+                  mFailShortReadsFlag(inFailShortReadsFlag),
+                  mDiskIoSize(0),
+                  mTraceId(0)
                 {}
 
             string  mPathName;
@@ -122,6 +124,7 @@ public:
             int     mMsgLogId;
             bool    mFailShortReadsFlag;
             int     mDiskIoSize;
+            int64_t mTraceId;
         };
         Request(
             RequestType   inOpType       = kRequestTypeUnknown,
@@ -208,7 +211,10 @@ public:
             int                inLeaseWaitTimeout            = 900,
             int                inMaxMetaServerContentLength  = 1 << 20,
             ClientAuthContext* inAuthContextPtr              = 0,
-            bool               inUseClientPoolFlag           = false)
+            bool               inUseClientPoolFlag           = false,
+            int                inReadHedgeMinDelayMs         = 0,
+            bool               inWriteAlignPartialBlocksFlag = false,
+            int                inMaxAppendBatchSize          = 0)
             : mMetaMaxRetryCount(inMetaMaxRetryCount),
               mMetaTimeSecBetweenRetries(inMetaTimeSecBetweenRetries),
               mMetaOpTimeoutSec(inMetaOpTimeoutSec),
@@ -232,7 +238,10 @@ public:
               mLeaseWaitTimeout(inLeaseWaitTimeout),
               mMaxMetaServerContentLength(inMaxMetaServerContentLength),
               mAuthContextPtr(inAuthContextPtr),
-              mUseClientPoolFlag(inUseClientPoolFlag)
+              mUseClientPoolFlag(inUseClientPoolFlag),
+              mReadHedgeMinDelayMs(inReadHedgeMinDelayMs),
+              mWriteAlignPartialBlocksFlag(inWriteAlignPartialBlocksFlag),
+              mMaxAppendBatchSize(inMaxAppendBatchSize)
             {}
             int                 mMetaMaxRetryCount;
             int                 mMetaTimeSecBetweenRetries;
@@ -258,6 +267,9 @@ public:
             int                 mMaxMetaServerContentLength;
             ClientAuthContext*  mAuthContextPtr;
             bool                mUseClientPoolFlag;
+            int                 mReadHedgeMinDelayMs;
+            bool                mWriteAlignPartialBlocksFlag;
+            int                 mMaxAppendBatchSize;
     };
     KfsProtocolWorker(
         std::string       inMetaHost,
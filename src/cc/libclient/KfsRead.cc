@@ -35,6 +35,9 @@
 #include <cerrno>
 #include <string>
 #include <limits>
+#include <algorithm>
+#include <deque>
+#include <vector>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -48,6 +51,9 @@ using std::string;
 using std::max;
 using std::min;
 using std::numeric_limits;
+using std::deque;
+using std::vector;
+using std::sort;
 
 // Blocking read conditional variables with free/unused list "next" pointer.
 class ReadRequestCondVar : public QCCondVar
@@ -329,6 +335,23 @@ public:
         }
         return theSize;
     }
+    static void SetOpenParams(
+        const FileTableEntry& inEntry,
+        int                   inMsgLogId,
+        Params&               outParams)
+    {
+        outParams.mPathName            = inEntry.pathname;
+        outParams.mFileSize            = inEntry.fattr.fileSize;
+        outParams.mStriperType         = inEntry.fattr.striperType;
+        outParams.mStripeSize          = inEntry.fattr.stripeSize;
+        outParams.mStripeCount         = inEntry.fattr.numStripes;
+        outParams.mRecoveryStripeCount = inEntry.fattr.numRecoveryStripes;
+        outParams.mReplicaCount        = inEntry.fattr.numReplicas;
+        outParams.mSkipHolesFlag       = inEntry.skipHoles;
+        outParams.mFailShortReadsFlag  = inEntry.failShortReadsFlag;
+        outParams.mMsgLogId            = inMsgLogId;
+        outParams.mTraceId             = KfsOp::GetCurrentTraceId();
+    }
     static ReadRequest* InitReadAhead(
         QCMutex&             inMutex,
         FileTableEntry&      inEntry,
@@ -422,16 +445,7 @@ private:
         if (GetSize() <= 0) {
             return 0;
         }
-        mOpenParams.mPathName            = inEntry.pathname;
-        mOpenParams.mFileSize            = inEntry.fattr.fileSize;
-        mOpenParams.mStriperType         = inEntry.fattr.striperType;
-        mOpenParams.mStripeSize          = inEntry.fattr.stripeSize;
-        mOpenParams.mStripeCount         = inEntry.fattr.numStripes;
-        mOpenParams.mRecoveryStripeCount = inEntry.fattr.numRecoveryStripes;
-        mOpenParams.mReplicaCount        = inEntry.fattr.numReplicas;
-        mOpenParams.mSkipHolesFlag       = inEntry.skipHoles;
-        mOpenParams.mFailShortReadsFlag  = inEntry.failShortReadsFlag;
-        mOpenParams.mMsgLogId            = inMsgLogId;
+        SetOpenParams(inEntry, inMsgLogId, mOpenParams);
         mWaitingCount = 0;
         mDoneFlag     = false;
         mCanceledFlag = false;
@@ -474,6 +488,76 @@ private:
         const ReadRequest& inReq);
 };
 
+// Non-blocking read request with the application completion callback. The
+// request is not associated with the file table entry read queue, and is
+// not canceled by close, as the application owns the buffer, and must be
+// notified when the protocol worker no longer uses it.
+class AsyncReadRequest : public KfsProtocolWorker::Request
+{
+public:
+    static AsyncReadRequest* Create(
+        const FileTableEntry&       inEntry,
+        void*                       inBufPtr,
+        int                         inSize,
+        int64_t                     inOffset,
+        int                         inMsgLogId,
+        KfsClient::ReadCompletion& inCompletion)
+    {
+        const int theSize =
+            ReadRequest::MaxRequestSize(inEntry, inSize, inOffset);
+        if (theSize <= 0) {
+            return 0;
+        }
+        AsyncReadRequest& theReq = *(new AsyncReadRequest(
+            inCompletion, inEntry.skipHoles));
+        theReq.Reset(
+            KfsProtocolWorker::kRequestTypeReadAsync,
+            inEntry.instance + 1,
+            inEntry.fattr.fileId,
+            &theReq.mOpenParams,
+            inBufPtr,
+            theSize,
+            0, // inMaxPending,
+            inOffset
+        );
+        if (theReq.GetSize() <= 0) {
+            delete &theReq;
+            return 0;
+        }
+        ReadRequest::SetOpenParams(inEntry, inMsgLogId, theReq.mOpenParams);
+        return &theReq;
+    }
+    virtual void Done(
+        int64_t inStatus)
+    {
+        KfsClient::ReadCompletion& theCompletion = mCompletion;
+        const int64_t theStatus =
+            (inStatus == -ENOENT && mSkipHolesFlag) ? 0 : inStatus;
+        delete this;
+        theCompletion.Done(theStatus);
+    }
+private:
+    Params                     mOpenParams;
+    KfsClient::ReadCompletion& mCompletion;
+    const bool                 mSkipHolesFlag;
+
+    AsyncReadRequest(
+        KfsClient::ReadCompletion& inCompletion,
+        bool                       inSkipHolesFlag)
+        : Request(),
+          mOpenParams(),
+          mCompletion(inCompletion),
+          mSkipHolesFlag(inSkipHolesFlag)
+        {}
+    virtual ~AsyncReadRequest()
+        {}
+private:
+    AsyncReadRequest(
+        const AsyncReadRequest& inReq);
+    AsyncReadRequest& operator=(
+        const AsyncReadRequest& inReq);
+};
+
 void
 KfsClientImpl::InitPendingRead(
     FileTableEntry& inEntry)
@@ -548,14 +632,346 @@ KfsClientImpl::ReadPrefetch(
         return 0;
     }
     theEntry.readUsedProtocolWorkerFlag = true;
-    const int theRet = theReqPtr->GetSize();
+    const int          theRet    = theReqPtr->GetSize();
+    KfsProtocolWorker& theWorker = GetProtocolWorker(theEntry.fattr.fileId);
+    theLocker.Unlock();
+    QCASSERT(! mMutex.IsOwned());
+
+    theWorker.Enqueue(*theReqPtr);
+    return theRet;
+}
+
+ssize_t
+KfsClientImpl::ReadAsync(
+    int                        inFd,
+    chunkOff_t                 inPos,
+    char*                      inBufPtr,
+    size_t                     inSize,
+    KfsClient::ReadCompletion& inCompletion)
+{
+    if (! inBufPtr || inPos < 0) {
+        return -EINVAL;
+    }
+
+    QCStMutexLocker theLocker(mMutex);
+
+    if (! valid_fd(inFd)) {
+        KFS_LOG_STREAM_ERROR <<
+            "read async error invalid fd: " << inFd <<
+        KFS_LOG_EOM;
+        return -EBADF;
+    }
+    FileTableEntry& theEntry = *mFileTable[inFd];
+    if (theEntry.openMode == O_WRONLY || theEntry.cachedAttrFlag) {
+        return -EINVAL;
+    }
+    if (theEntry.fattr.isDirectory) {
+        return -EISDIR;
+    }
+    if (inSize <= 0 || inPos >= ReadRequest::GetEof(theEntry)) {
+        return 0;
+    }
+    StartProtocolWorker();
+    AsyncReadRequest* const theReqPtr = AsyncReadRequest::Create(
+        theEntry,
+        inBufPtr,
+        (int)min(inSize, (size_t)numeric_limits<int>::max()),
+        inPos,
+        inFd,
+        inCompletion
+    );
+    if (! theReqPtr) {
+        return 0;
+    }
+    theEntry.readUsedProtocolWorkerFlag = true;
+    const int          theRet    = theReqPtr->GetSize();
+    KfsProtocolWorker& theWorker = GetProtocolWorker(theEntry.fattr.fileId);
     theLocker.Unlock();
     QCASSERT(! mMutex.IsOwned());
 
-    mProtocolWorker->Enqueue(*theReqPtr);
+    // Completion can be invoked before Enqueue() returns.
+    theWorker.Enqueue(*theReqPtr);
     return theRet;
 }
 
+// Vectored read state. The ranges that are close to each other are coalesced
+// into a single read, then all reads are issued in parallel with ReadAsync(),
+// and the calling thread waits for all of the reads to complete.
+class ReadVRequest
+{
+public:
+    class Piece : public KfsClient::ReadCompletion
+    {
+    public:
+        Piece(
+            ReadVRequest& inOwner,
+            int64_t       inOffset,
+            int           inSize)
+            : KfsClient::ReadCompletion(),
+              mOwnerPtr(&inOwner),
+              mOffset(inOffset),
+              mSize(inSize),
+              mStatus(0)
+            {}
+        virtual void Done(
+            int64_t inStatus)
+            { mOwnerPtr->Done(*this, inStatus); }
+        ReadVRequest* mOwnerPtr;
+        int64_t       mOffset; // Offset in the group buffer.
+        int           mSize;
+        int64_t       mStatus;
+    };
+    struct Group
+    {
+        Group(
+            size_t  inFirst,
+            int64_t inPos,
+            int64_t inEnd)
+            : mFirst(inFirst),
+              mLast(inFirst + 1),
+              mPos(inPos),
+              mEnd(inEnd),
+              mBufPtr(0),
+              mScratchFlag(false),
+              mFirstPiece(0),
+              mLastPiece(0)
+            {}
+        size_t  mFirst;
+        size_t  mLast;
+        int64_t mPos;
+        int64_t mEnd;
+        char*   mBufPtr;
+        bool    mScratchFlag;
+        size_t  mFirstPiece;
+        size_t  mLastPiece;
+    };
+    class PosLess
+    {
+    public:
+        PosLess(
+            const KfsClient::ReadRange* inRangesPtr)
+            : mRangesPtr(inRangesPtr)
+            {}
+        bool operator()(
+            size_t inLhs,
+            size_t inRhs) const
+        {
+            return (mRangesPtr[inLhs].pos < mRangesPtr[inRhs].pos ||
+                (mRangesPtr[inLhs].pos == mRangesPtr[inRhs].pos &&
+                    inLhs < inRhs));
+        }
+    private:
+        const KfsClient::ReadRange* mRangesPtr;
+    };
+    typedef deque<Piece>   Pieces;
+    typedef vector<Group>  Groups;
+    typedef vector<size_t> Order;
+
+    ReadVRequest()
+        : mMutex(),
+          mCondVar(),
+          mPendingCount(0),
+          mPieces(),
+          mGroups(),
+          mOrder()
+        {}
+    ~ReadVRequest()
+    {
+        for (Groups::iterator theIt = mGroups.begin();
+                theIt != mGroups.end();
+                ++theIt) {
+            if (theIt->mScratchFlag) {
+                delete [] theIt->mBufPtr;
+            }
+        }
+    }
+    void Done(
+        Piece&  inPiece,
+        int64_t inStatus)
+    {
+        QCStMutexLocker theLocker(mMutex);
+        inPiece.mStatus = inStatus;
+        QCASSERT(0 < mPendingCount);
+        if (--mPendingCount <= 0) {
+            mCondVar.Notify();
+        }
+    }
+    void Wait()
+    {
+        QCStMutexLocker theLocker(mMutex);
+        while (0 < mPendingCount) {
+            mCondVar.Wait(mMutex);
+        }
+    }
+    void AddPending()
+    {
+        QCStMutexLocker theLocker(mMutex);
+        mPendingCount++;
+    }
+    void RemovePending()
+    {
+        QCStMutexLocker theLocker(mMutex);
+        QCASSERT(0 < mPendingCount);
+        mPendingCount--;
+    }
+
+    QCMutex   mMutex;
+    QCCondVar mCondVar;
+    int       mPendingCount;
+    Pieces    mPieces;
+    Groups    mGroups;
+    Order     mOrder;
+private:
+    ReadVRequest(
+        const ReadVRequest& inReq);
+    ReadVRequest& operator=(
+        const ReadVRequest& inReq);
+};
+
+ssize_t
+KfsClientImpl::ReadV(
+    int                   inFd,
+    KfsClient::ReadRange* inRangesPtr,
+    int                   inCount)
+{
+    if (inCount <= 0) {
+        return 0;
+    }
+    if (! inRangesPtr) {
+        return -EINVAL;
+    }
+    // Ranges separated by no more than the checksum block size are coalesced,
+    // as the chunk server reads and verifies the whole checksum block anyway.
+    const int64_t kMaxGap       = (int64_t)CHECKSUM_BLOCKSIZE;
+    const int64_t kMaxGroupSize = (int64_t)max(
+        mTargetDiskIoSize, (int)CHECKSUM_BLOCKSIZE);
+    ReadVRequest theReq;
+    theReq.mOrder.reserve(inCount);
+    for (int i = 0; i < inCount; i++) {
+        KfsClient::ReadRange& theRange = inRangesPtr[i];
+        if (theRange.pos < 0 || (! theRange.buf && 0 < theRange.size) ||
+                (size_t)numeric_limits<int>::max() < theRange.size) {
+            return -EINVAL;
+        }
+        theRange.status = 0;
+        if (0 < theRange.size) {
+            theReq.mOrder.push_back((size_t)i);
+        }
+    }
+    sort(theReq.mOrder.begin(), theReq.mOrder.end(),
+        ReadVRequest::PosLess(inRangesPtr));
+    for (ReadVRequest::Order::const_iterator theIt = theReq.mOrder.begin();
+            theIt != theReq.mOrder.end();
+            ++theIt) {
+        const KfsClient::ReadRange& theRange = inRangesPtr[*theIt];
+        const int64_t theEnd = theRange.pos + (int64_t)theRange.size;
+        if (! theReq.mGroups.empty()) {
+            ReadVRequest::Group& theGroup = theReq.mGroups.back();
+            if (theRange.pos <= theGroup.mEnd + kMaxGap &&
+                    max(theGroup.mEnd, theEnd) - theGroup.mPos <=
+                        kMaxGroupSize) {
+                theGroup.mEnd = max(theGroup.mEnd, theEnd);
+                theGroup.mLast++;
+                continue;
+            }
+        }
+        theReq.mGroups.push_back(ReadVRequest::Group(
+            (size_t)(theIt - theReq.mOrder.begin()), theRange.pos, theEnd));
+    }
+    int64_t theStatus = 0;
+    for (ReadVRequest::Groups::iterator theIt = theReq.mGroups.begin();
+            theIt != theReq.mGroups.end();
+            ++theIt) {
+        ReadVRequest::Group& theGroup = *theIt;
+        // Read directly into the application buffers, if the ranges are
+        // adjacent in both the file and the memory.
+        char* theBufPtr = inRangesPtr[theReq.mOrder[theGroup.mFirst]].buf;
+        int64_t thePos  = theGroup.mPos;
+        for (size_t i = theGroup.mFirst; i < theGroup.mLast; i++) {
+            const KfsClient::ReadRange& theRange =
+                inRangesPtr[theReq.mOrder[i]];
+            if (theRange.pos != thePos ||
+                    theRange.buf != theBufPtr + (thePos - theGroup.mPos)) {
+                theGroup.mScratchFlag = true;
+                break;
+            }
+            thePos += (int64_t)theRange.size;
+        }
+        theGroup.mBufPtr = theGroup.mScratchFlag ?
+            new char[(size_t)(theGroup.mEnd - theGroup.mPos)] : theBufPtr;
+        theGroup.mFirstPiece = theReq.mPieces.size();
+        thePos = theGroup.mPos;
+        while (thePos < theGroup.mEnd) {
+            theReq.mPieces.push_back(ReadVRequest::Piece(theReq,
+                thePos - theGroup.mPos, (int)(theGroup.mEnd - thePos)));
+            ReadVRequest::Piece& thePiece = theReq.mPieces.back();
+            theReq.AddPending();
+            const ssize_t theRet = ReadAsync(
+                inFd,
+                thePos,
+                theGroup.mBufPtr + thePiece.mOffset,
+                (size_t)thePiece.mSize,
+                thePiece
+            );
+            if (theRet <= 0) {
+                theReq.RemovePending();
+                thePiece.mSize   = 0;
+                thePiece.mStatus = theRet;
+                if (theRet < 0 && theStatus == 0) {
+                    theStatus = theRet;
+                }
+                break;
+            }
+            // Completion does not access the piece size, and the size is
+            // only accessed by this thread after wait.
+            thePiece.mSize = (int)theRet;
+            thePos += theRet;
+        }
+        theGroup.mLastPiece = theReq.mPieces.size();
+    }
+    theReq.Wait();
+    int64_t theTotal = 0;
+    for (ReadVRequest::Groups::const_iterator theIt = theReq.mGroups.begin();
+            theIt != theReq.mGroups.end();
+            ++theIt) {
+        const ReadVRequest::Group& theGroup = *theIt;
+        // Find the length of the successfully read group prefix.
+        int64_t theValidEnd = 0;
+        int64_t theError    = 0;
+        for (size_t i = theGroup.mFirstPiece; i < theGroup.mLastPiece; i++) {
+            const ReadVRequest::Piece& thePiece = theReq.mPieces[i];
+            if (thePiece.mStatus < 0) {
+                theError = thePiece.mStatus;
+                break;
+            }
+            theValidEnd = thePiece.mOffset + thePiece.mStatus;
+            if (thePiece.mSize <= 0 || thePiece.mStatus < thePiece.mSize) {
+                break;
+            }
+        }
+        if (theError < 0 && theStatus == 0) {
+            theStatus = theError;
+        }
+        for (size_t i = theGroup.mFirst; i < theGroup.mLast; i++) {
+            KfsClient::ReadRange& theRange = inRangesPtr[theReq.mOrder[i]];
+            const int64_t theStart = theRange.pos - theGroup.mPos;
+            if (theStart < theValidEnd) {
+                const int64_t theLen =
+                    min((int64_t)theRange.size, theValidEnd - theStart);
+                if (theGroup.mScratchFlag) {
+                    memcpy(theRange.buf, theGroup.mBufPtr + theStart,
+                        (size_t)theLen);
+                }
+                theRange.status = (ssize_t)theLen;
+                theTotal += theLen;
+            } else {
+                theRange.status = (ssize_t)theError;
+            }
+        }
+    }
+    return (ssize_t)(theStatus < 0 ? theStatus : theTotal);
+}
+
 inline static int64_t
 SkipChunkTail(
     int64_t inPos,
@@ -661,6 +1077,8 @@ KfsClientImpl::Read(
     if (theEof <= thePos) {
         return theRet;
     }
+    const bool theReadAheadFlag =
+        AdaptReadAhead(theEntry, thePos, theSize - theRet);
     // Do not return if nothing more to read -- start the read ahead.
     StartProtocolWorker();
     theEntry.readUsedProtocolWorkerFlag = true;
@@ -691,17 +1109,18 @@ KfsClientImpl::Read(
     // Use read ahead to get the remainder of the request if the remainder is
     // small enough.
     if (theSize <= theRet ||
-            (theFdPos == theFilePos &&
+            (theReadAheadFlag && theFdPos == theFilePos &&
                 (theSize - theRet) <=
                     ReadRequest::GetReadAheadSize(theEntry, thePos) / 2)) {
         if (theFdPos == theFilePos) {
             theFilePos = thePos;
             theFdPos   = thePos;
         }
-        ReadRequest* const theReqPtr = ReadRequest::InitReadAhead(
-            mReadCompletionMutex, theEntry, inFd, theFilePos);
+        ReadRequest* const theReqPtr = theReadAheadFlag ?
+            ReadRequest::InitReadAhead(
+                mReadCompletionMutex, theEntry, inFd, theFilePos) : 0;
         if (theReqPtr) {
-            mProtocolWorker->Enqueue(*theReqPtr);
+            GetProtocolWorker(theFileId).Enqueue(*theReqPtr);
             if (theSize <= theRet) {
                 return theRet;
             }
@@ -749,6 +1168,7 @@ KfsClientImpl::Read(
     theOpenParams.mSkipHolesFlag       = theSkipHolesFlag;
     theOpenParams.mFailShortReadsFlag  = theEntry.failShortReadsFlag;
     theOpenParams.mMsgLogId            = inFd;
+    theOpenParams.mTraceId             = KfsOp::GetCurrentTraceId();
 
     theLocker.Unlock();
     QCASSERT(! mMutex.IsOwned());
@@ -761,7 +1181,7 @@ KfsClientImpl::Read(
         if (theRdSize <= 0) {
             break;
         }
-        int theStatus = (int)mProtocolWorker->Execute(
+        int theStatus = (int)GetProtocolWorker(theFileId).Execute(
             KfsProtocolWorker::kRequestTypeRead,
             theInstance,
             theFileId,
@@ -800,7 +1220,8 @@ KfsClientImpl::Read(
         if (! valid_fd(inFd) || mFileTable[inFd] != &theEntry) {
             return theRet;
         }
-        if (theEntry.instance + 1 == theInstance && theFilePos == theFdPos) {
+        if (theReadAheadFlag && theEntry.instance + 1 == theInstance &&
+                theFilePos == theFdPos) {
             QCASSERT(mProtocolWorker);
             theFilePos = thePos;
             theReadAheadReqPtr = ReadRequest::InitReadAhead(
@@ -808,7 +1229,7 @@ KfsClientImpl::Read(
         }
     }
     if (theReadAheadReqPtr) {
-        mProtocolWorker->Enqueue(*theReadAheadReqPtr);
+        GetProtocolWorker(theFileId).Enqueue(*theReadAheadReqPtr);
     }
     return theRet;
 }
@@ -851,9 +1272,60 @@ KfsClientImpl::SetReadAheadSize(
             theStride - 1) / theStride * theStride;
     }
     inEntry.buffer.SetBufSize(theSize);
+    inEntry.readAheadBaseSize = inEntry.buffer.GetBufSize();
+    inEntry.readAheadSeqCount = 0;
     return inEntry.buffer.GetBufSize();
 }
 
+// Adjust read ahead to the access pattern, if enabled. Sequential reads, or
+// forward reads with the gaps smaller than the read ahead, double the read
+// ahead size with each consecutive read, up to the configured maximum. The
+// larger read ahead requests span more chunks and stripes, and are therefore
+// executed with more parallelism. Consecutive random reads turn off read
+// ahead, in order not to read data that will not be used. Returns false if
+// read ahead should not be issued.
+bool
+KfsClientImpl::AdaptReadAhead(
+    FileTableEntry& inEntry,
+    chunkOff_t      inPos,
+    int             inSize)
+{
+    QCASSERT(mMutex.IsOwned());
+
+    const int kRandomThreshold = 2;
+    const int kMaxSeqCount     = 30;
+    const int theBaseSize      = inEntry.readAheadBaseSize;
+    if (mMaxAdaptiveReadAheadSize <= 0 || theBaseSize <= 0) {
+        return true;
+    }
+    const int        theCurSize = inEntry.buffer.GetBufSize();
+    const chunkOff_t theNextPos = inEntry.readAheadNextPos;
+    inEntry.readAheadNextPos = inPos + max(0, inSize);
+    if (theNextPos <= inPos && inPos - theNextPos <= theCurSize) {
+        inEntry.readAheadSeqCount =
+            min(kMaxSeqCount, max(0, inEntry.readAheadSeqCount) + 1);
+    } else {
+        inEntry.readAheadSeqCount =
+            max(-kRandomThreshold, min(0, inEntry.readAheadSeqCount) - 1);
+    }
+    if (inEntry.readAheadSeqCount <= -kRandomThreshold) {
+        inEntry.buffer.SetBufSize(theBaseSize);
+        return false;
+    }
+    // Keep the size multiple of the base size, as the base size is stripe
+    // aligned.
+    const int theMaxSize = max(theBaseSize,
+        mMaxAdaptiveReadAheadSize / theBaseSize * theBaseSize);
+    int       theSize    = theBaseSize;
+    for (int i = 1;
+            i < inEntry.readAheadSeqCount && theSize <= theMaxSize / 2;
+            i++) {
+        theSize *= 2;
+    }
+    inEntry.buffer.SetBufSize(theSize);
+    return true;
+}
+
 ssize_t
 KfsClientImpl::GetReadAheadSize(
     int inFd) const
@@ -31,6 +31,9 @@
 
 #include <cerrno>
 #include <string>
+#include <limits>
+#include <algorithm>
+#include <vector>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -38,6 +41,84 @@
 namespace KFS {
 namespace client {
 
+using std::min;
+using std::max;
+using std::numeric_limits;
+using std::vector;
+
+static void
+SetWriteOpenParams(const FileTableEntry& entry, int fd,
+    KfsProtocolWorker::Request::Params& openParams)
+{
+    openParams.mPathName            = entry.pathname;
+    openParams.mFileSize            = entry.fattr.fileSize;
+    openParams.mStriperType         = entry.fattr.striperType;
+    openParams.mStripeSize          = entry.fattr.stripeSize;
+    openParams.mStripeCount         = entry.fattr.numStripes;
+    openParams.mRecoveryStripeCount = entry.fattr.numRecoveryStripes;
+    openParams.mReplicaCount        = entry.fattr.numReplicas;
+    openParams.mMsgLogId            = fd;
+    openParams.mTraceId             = KfsOp::GetCurrentTraceId();
+    if(entry.fattr.striperType == KFS_STRIPED_FILE_TYPE_NONE) {
+        openParams.mDiskIoSize = entry.ioBufferSize;
+    } else {
+        const int kChecksumBlockSize = (int)CHECKSUM_BLOCKSIZE;
+        const int totalStripeCount   =
+           entry.fattr.numStripes + entry.fattr.numRecoveryStripes;
+        openParams.mDiskIoSize = (entry.ioBufferSize / totalStripeCount
+           + kChecksumBlockSize - 1) /
+           kChecksumBlockSize * kChecksumBlockSize;
+    }
+}
+
+// Zero copy positional write request. The protocol worker references the
+// caller's buffer, and completes the request when the buffer is released.
+class AsyncWriteRequest : public KfsProtocolWorker::Request
+{
+public:
+    AsyncWriteRequest(
+        const FileTableEntry&       entry,
+        int                         fd,
+        const char*                 buf,
+        int                         numBytes,
+        chunkOff_t                  pos,
+        KfsClient::WriteCompletion& completion)
+        : Request(),
+          mOpenParams(),
+          mCompletion(completion)
+    {
+        SetWriteOpenParams(entry, fd, mOpenParams);
+        Reset(
+            KfsProtocolWorker::kRequestTypeWriteAsyncNoCopy,
+            entry.instance,
+            entry.fattr.fileId,
+            entry.usedProtocolWorkerFlag ? 0 : &mOpenParams,
+            const_cast<char*>(buf),
+            numBytes,
+            max(0, entry.ioBufferSize), // write threshold
+            pos
+        );
+    }
+    virtual void Done(
+        int64_t status)
+    {
+        KfsClient::WriteCompletion& completion = mCompletion;
+        const int64_t               ret        =
+            status == 0 ? (int64_t)GetSize() : status;
+        delete this;
+        completion.Done(ret);
+    }
+private:
+    Params                      mOpenParams;
+    KfsClient::WriteCompletion& mCompletion;
+
+    virtual ~AsyncWriteRequest()
+        {}
+private:
+    AsyncWriteRequest(const AsyncWriteRequest&);
+    AsyncWriteRequest& operator=(const AsyncWriteRequest&);
+};
+
 using std::string;
 
 int
@@ -72,6 +153,182 @@ KfsClientImpl::WriteAsync(int fd, const char *buf, size_t numBytes)
     return Write(fd, buf, numBytes, asyncFlag, appendOnlyFlag);
 }
 
+ssize_t
+KfsClientImpl::WriteAsync(int fd, chunkOff_t pos, const char *buf,
+    size_t numBytes, KfsClient::WriteCompletion& completion)
+{
+    if (! buf || pos < 0) {
+        return -EINVAL;
+    }
+
+    QCStMutexLocker lock(mMutex);
+
+    if (! valid_fd(fd)) {
+        KFS_LOG_STREAM_ERROR <<
+            "write async error invalid fd: " << fd <<
+        KFS_LOG_EOM;
+        return -EBADF;
+    }
+    FileTableEntry& entry = *mFileTable[fd];
+    if (entry.openMode == O_RDONLY || (entry.openMode & O_APPEND) != 0) {
+        return -EINVAL;
+    }
+    if (entry.fattr.fileId <= 0) {
+        return -EBADF;
+    }
+    if (entry.fattr.isDirectory) {
+        return -EISDIR;
+    }
+    if (numBytes <= 0) {
+        return 0;
+    }
+    const int size = (int)min(numBytes, (size_t)numeric_limits<int>::max());
+    if (pos + (chunkOff_t)size < 0) {
+        return -EFBIG;
+    }
+    StartProtocolWorker();
+    AsyncWriteRequest& req =
+        *(new AsyncWriteRequest(entry, fd, buf, size, pos, completion));
+    entry.usedProtocolWorkerFlag = true;
+    KfsProtocolWorker& worker = GetProtocolWorker(entry.fattr.fileId);
+    lock.Unlock();
+
+    // Completion can be invoked before Enqueue() returns.
+    worker.Enqueue(req);
+    return size;
+}
+
+// Flush request of one file of a group sync. The caller waits for all
+// requests of the group to complete.
+class GroupSyncRequest : public KfsProtocolWorker::Request
+{
+public:
+    class Group
+    {
+    public:
+        Group()
+            : mMutex(),
+              mCondVar(),
+              mPendingCount(0),
+              mStatus(0)
+            {}
+        void Done(
+            int64_t status)
+        {
+            QCStMutexLocker lock(mMutex);
+            if (status < 0 && mStatus == 0) {
+                mStatus = (int)status;
+            }
+            QCASSERT(0 < mPendingCount);
+            if (--mPendingCount <= 0) {
+                mCondVar.Notify();
+            }
+        }
+        int Wait()
+        {
+            QCStMutexLocker lock(mMutex);
+            while (0 < mPendingCount) {
+                mCondVar.Wait(mMutex);
+            }
+            return mStatus;
+        }
+        void AddPending()
+        {
+            QCStMutexLocker lock(mMutex);
+            mPendingCount++;
+        }
+    private:
+        QCMutex   mMutex;
+        QCCondVar mCondVar;
+        int       mPendingCount;
+        int       mStatus;
+    private:
+        Group(const Group&);
+        Group& operator=(const Group&);
+    };
+
+    GroupSyncRequest(
+        Group&                          group,
+        KfsProtocolWorker&              worker,
+        KfsProtocolWorker::RequestType  type,
+        KfsProtocolWorker::FileInstance fileInstance,
+        KfsProtocolWorker::FileId       fileId)
+        : Request(type, fileInstance, fileId),
+          mGroup(group),
+          mWorker(worker)
+        {}
+    virtual ~GroupSyncRequest()
+        {}
+    virtual void Done(
+        int64_t status)
+        { mGroup.Done(status); }
+    KfsProtocolWorker& GetWorker() const
+        { return mWorker; }
+private:
+    Group&             mGroup;
+    KfsProtocolWorker& mWorker;
+private:
+    GroupSyncRequest(const GroupSyncRequest&);
+    GroupSyncRequest& operator=(const GroupSyncRequest&);
+};
+
+int
+KfsClientImpl::Sync(const int* fds, int count)
+{
+    if (count <= 0) {
+        return 0;
+    }
+    if (! fds) {
+        return -EINVAL;
+    }
+    typedef vector<GroupSyncRequest*> Requests;
+    GroupSyncRequest::Group group;
+    Requests                requests;
+
+    QCStMutexLocker lock(mMutex);
+
+    for (int i = 0; i < count; i++) {
+        if (! valid_fd(fds[i])) {
+            return -EBADF;
+        }
+    }
+    requests.reserve(count);
+    for (int i = 0; i < count; i++) {
+        FileTableEntry& entry = *mFileTable[fds[i]];
+        if (entry.pending <= 0 ||
+                ! mProtocolWorker || ! entry.usedProtocolWorkerFlag) {
+            continue;
+        }
+        entry.pending = 0;
+        requests.push_back(new GroupSyncRequest(
+            group,
+            GetProtocolWorker(entry.fattr.fileId),
+            (entry.openMode & O_APPEND) != 0 ?
+                KfsProtocolWorker::kRequestTypeWriteAppend :
+                KfsProtocolWorker::kRequestTypeWrite,
+            entry.instance,
+            entry.fattr.fileId
+        ));
+        group.AddPending();
+    }
+    lock.Unlock();
+
+    // Issue all flushes before waiting, in order to overlap the chunk server
+    // round trips of all files.
+    for (Requests::const_iterator it = requests.begin();
+            it != requests.end();
+            ++it) {
+        (*it)->GetWorker().Enqueue(**it);
+    }
+    const int status = group.Wait();
+    for (Requests::const_iterator it = requests.begin();
+            it != requests.end();
+            ++it) {
+        delete *it;
+    }
+    return status;
+}
+
 int
 KfsClientImpl::WriteAsyncCompletionHandler(int fd)
 {
@@ -131,24 +388,7 @@ KfsClientImpl::Write(int fd, const char *buf, size_t numBytes,
     KfsProtocolWorker::Request::Params* const openParamsPtr =
         entry.usedProtocolWorkerFlag ? 0 : &openParams;
     if (openParamsPtr) {
-        openParams.mPathName            = entry.pathname;
-        openParams.mFileSize            = entry.fattr.fileSize;
-        openParams.mStriperType         = entry.fattr.striperType;
-        openParams.mStripeSize          = entry.fattr.stripeSize;
-        openParams.mStripeCount         = entry.fattr.numStripes;
-        openParams.mRecoveryStripeCount = entry.fattr.numRecoveryStripes;
-        openParams.mReplicaCount        = entry.fattr.numReplicas;
-        openParams.mMsgLogId            = fd;
-        if(entry.fattr.striperType == KFS_STRIPED_FILE_TYPE_NONE) {
-            openParams.mDiskIoSize = entry.ioBufferSize;
-        } else {
-            const int kChecksumBlockSize = (int)CHECKSUM_BLOCKSIZE;
-            const int totalStripeCount   =
-               entry.fattr.numStripes + entry.fattr.numRecoveryStripes;
-            openParams.mDiskIoSize = (entry.ioBufferSize / totalStripeCount
-               + kChecksumBlockSize - 1) /
-               kChecksumBlockSize * kChecksumBlockSize;
-        }
+        SetWriteOpenParams(entry, fd, openParams);
     }
     entry.usedProtocolWorkerFlag = true;
     entry.pending += numBytes;
@@ -174,7 +414,7 @@ KfsClientImpl::Write(int fd, const char *buf, size_t numBytes,
         " bufsz: "    << bufsz <<
     KFS_LOG_EOM;
 
-    const int64_t status = mProtocolWorker->Execute(
+    const int64_t status = GetProtocolWorker(fileId).Execute(
         asyncFlag ?
             (appendFlag ?
                 KfsProtocolWorker::kRequestTypeWriteAppendAsyncNoCopy :
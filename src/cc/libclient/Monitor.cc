@@ -58,6 +58,7 @@ public:
         mNumClientsMonitored(0),
         mPluginInitFuncHandle(0),
         mPluginReportFuncHandle(0),
+        mPluginReportLatencyFuncHandle(0),
         mPluginHandle(0),
         mNumDroppedErrors(0)
     {
@@ -138,6 +139,15 @@ public:
         // To limit the memory usage, we drop the incoming incident records
         // after some point, if a limit is specified.
         QCStMutexLocker theDoubleBuffLock(mDoubleBuffMutex);
+        LatencyCounters& latency = mLatency[metaserverLocation];
+        ChunkserverLatencyCounters& chunkserverLatency =
+                latency.chunkserverLatencyMap[chunkserverLocation];
+        if (errSource == Monitor::kReadOpError) {
+            ++chunkserverLatency.readLatency.mRetryCount;
+        }
+        else if (errSource == Monitor::kWriteOpError) {
+            ++chunkserverLatency.writeLatency.mRetryCount;
+        }
         if(mMonitorMaxErrorRecords < 0 || mErrorRecords.GetSize() <
                 (unsigned int) mMonitorMaxErrorRecords) {
             mErrorRecords.PushBack(new ErrorRecord(errSource,
@@ -152,6 +162,32 @@ public:
             mCondVar.Notify();
         }
     }
+    void RecordLatency(
+            int opType,
+            const ServerLocation& metaserverLocation,
+            const ServerLocation& chunkserverLocation,
+            int64_t latencyUsec)
+    {
+        if (!mPluginLoaded || !mPluginReportLatencyFuncHandle) {
+            return;
+        }
+        // Histograms are updated in place, with no per op allocation, the
+        // lock is held only for the map lookup and the histogram update.
+        QCStMutexLocker theDoubleBuffLock(mDoubleBuffMutex);
+        LatencyCounters& latency = mLatency[metaserverLocation];
+        if (opType == Monitor::kMetaOpLatency) {
+            latency.metaLatency.Update(latencyUsec);
+            return;
+        }
+        ChunkserverLatencyCounters& chunkserverLatency =
+                latency.chunkserverLatencyMap[chunkserverLocation];
+        if (opType == Monitor::kReadOpLatency) {
+            chunkserverLatency.readLatency.Update(latencyUsec);
+        }
+        else if (opType == Monitor::kWriteOpLatency) {
+            chunkserverLatency.writeLatency.Update(latencyUsec);
+        }
+    }
 private:
     void LoadPlugin(
             char* pluginPath,
@@ -193,6 +229,20 @@ private:
             return;
         }
 
+        // The latency report function is optional, in order to work with
+        // the existing plugins.
+        dlerror();
+        mPluginReportLatencyFuncHandle = (reportLatency_t) dlsym(mPluginHandle,
+                "reportLatency");
+        err_msg = dlerror();
+        if (err_msg) {
+            KFS_LOG_STREAM_INFO
+                << "Monitor: plugin has no \"reportLatency\" symbol,"
+                << " latency histograms will not be reported: "
+                << err_msg << KFS_LOG_EOM;
+            mPluginReportLatencyFuncHandle = 0;
+        }
+
         int ret = mPluginInitFuncHandle();
         if (ret == -1) {
             KFS_LOG_STREAM_ERROR <<
@@ -222,6 +272,8 @@ private:
                     << " errors have been dropped " << KFS_LOG_EOM;
         }
         mNumDroppedErrors = 0;
+        mLatencyTmp.clear();
+        mLatencyTmp.swap(mLatency);
         theDoubleBuffLock.Unlock();
 
         // Setup metrics structures for recently added clients.
@@ -375,6 +427,18 @@ private:
                 }
             }
         }
+
+        // Report the latency histograms collected since the last report.
+        if (mPluginReportLatencyFuncHandle) {
+            for (LatencyMap::iterator latencyIt = mLatencyTmp.begin();
+                    latencyIt != mLatencyTmp.end(); ++latencyIt) {
+                const ServerLocation& fsLoc = latencyIt->first;
+                mPluginReportLatencyFuncHandle(fsLoc.hostname, fsLoc.port,
+                        latencyIt->second.metaLatency,
+                        latencyIt->second.chunkserverLatencyMap);
+            }
+        }
+        mLatencyTmp.clear();
     }
     void AggregateCounters(
             Properties& countersAsProp,
@@ -408,6 +472,7 @@ private:
         mPluginHandle = 0;
         mPluginInitFuncHandle = 0;
         mPluginReportFuncHandle = 0;
+        mPluginReportLatencyFuncHandle = 0;
         KFS_LOG_STREAM_INFO << "Monitor: Monitor plugin closed!" << KFS_LOG_EOM;
      }
     void Start()
@@ -573,8 +638,11 @@ private:
     typedef int (*init_t)();
     typedef void (*reportStatus_t)(string, int, ClientCounters&,
             ChunkServerErrorMap&);
+    typedef void (*reportLatency_t)(string, int, LatencyHistogram&,
+            ChunkServerLatencyMap&);
     init_t mPluginInitFuncHandle;
     reportStatus_t mPluginReportFuncHandle;
+    reportLatency_t mPluginReportLatencyFuncHandle;
     void* mPluginHandle;
     // Use message queue and double buffering for error records.
     DynamicArray<ErrorRecord*> mErrorRecordsTmp;
@@ -588,6 +656,15 @@ private:
     // store the last collected stats from them.
     typedef map<ClientId, Properties*> RemovedClients;
     RemovedClients mRemovedClients;
+    // Latency histograms for every filesystem, double buffered the same way
+    // as the error records.
+    struct LatencyCounters {
+        LatencyHistogram metaLatency;
+        ChunkServerLatencyMap chunkserverLatencyMap;
+    };
+    typedef map<ServerLocation, LatencyCounters> LatencyMap;
+    LatencyMap mLatency;
+    LatencyMap mLatencyTmp;
 };
 
 Monitor::Monitor()
@@ -607,6 +684,16 @@ bool Monitor::AddClientSelf(KfsClientImpl* client, char* pluginPath,
             reportInterval, maxErrorsToRecord);
 }
 
+void Monitor::ReportLatencySelf(
+        int opType,
+        const ServerLocation& metaserverLocation,
+        const ServerLocation& chunkserverLocation,
+        int64_t latencyUsec)
+{
+    mImpl->RecordLatency(opType, metaserverLocation,
+            chunkserverLocation, latencyUsec);
+}
+
 void Monitor::RemoveClientSelf(KfsClientImpl* client)
 {
     mImpl->RemoveClient(client);
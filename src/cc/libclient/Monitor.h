@@ -1,6 +1,8 @@
 #ifndef SRC_CC_LIBCLIENT_MONITOR_H_
 #define SRC_CC_LIBCLIENT_MONITOR_H_
 
+#include <stdint.h>
+
 namespace KFS
 {
 namespace client
@@ -35,9 +37,16 @@ struct ServerLocation;
 ///    Monitor class is responsible for recording the total number of
 ///    occurrences of each error type for each chunk-server.
 ///
+///    * Set 3: Op latency histograms: meta server ops, and chunk-server level
+///    read and write ops, along with the number of failed and retried ops.
+///    A client instance reports each completed op latency with static
+///    function Monitor::ReportLatency. The histograms are reported to the
+///    plugin's optional "reportLatency" function, if the plugin has one.
+///
 ///    Note that for each counter in set 1 and set 2, we report the difference
 ///    between new and old value. The only exception
 ///    currently is the number of network sockets; Network.Sockets.
+///    Set 3 histograms are reset after each report.
 ///
 /// Collection and report of metrics from all client instances in a process
 /// is orchestrated by a static Monitor class instance. Static Monitor instance
@@ -60,6 +69,12 @@ public:
         kReadOpError,
         kWriteOpError
     };
+    enum
+    {
+        kReadOpLatency,
+        kWriteOpLatency,
+        kMetaOpLatency
+    };
     // tells Monitor to start monitoring a client instance.
     // returns 0 on success, -1 otherwise.
     static bool AddClient(
@@ -87,6 +102,17 @@ public:
         Instance().ReportErrorSelf(errSource, metaserverLocation,
                 chunkserverLocation, errCode);
     }
+    // reports a completed op latency to Monitor. chunkserverLocation is
+    // ignored for meta server ops.
+    static void ReportLatency(
+            int opType,
+            const ServerLocation& metaserverLocation,
+            const ServerLocation& chunkserverLocation,
+            int64_t latencyUsec)
+    {
+        Instance().ReportLatencySelf(opType, metaserverLocation,
+                chunkserverLocation, latencyUsec);
+    }
     static Monitor& Instance()
     {
         static Monitor sInstance;
@@ -106,6 +132,11 @@ private:
             metaserverLocation,
             const ServerLocation& chunkserverLocation,
             int errCode);
+    void ReportLatencySelf(
+            int opType,
+            const ServerLocation& metaserverLocation,
+            const ServerLocation& chunkserverLocation,
+            int64_t latencyUsec);
     void RemoveClientSelf(
             KfsClientImpl* client);
     Impl* mImpl;
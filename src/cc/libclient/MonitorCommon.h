@@ -65,6 +65,63 @@ struct ChunkserverErrorCounters {
 };
 
 typedef map<ServerLocation, ChunkserverErrorCounters> ChunkServerErrorMap;
+
+// Op latency histogram with power of two millisecond buckets: bucket i counts
+// the ops with latency less than 2^i milliseconds, and not counted by the
+// preceding bucket. The last bucket counts the remaining ops.
+struct LatencyHistogram
+{
+    enum { kBucketCount = 20 };
+
+    LatencyHistogram()
+        : mCount(0),
+          mTotalUsec(0),
+          mRetryCount(0)
+    {
+        for (int i = 0; i < kBucketCount; i++) {
+            mBuckets[i] = 0;
+        }
+    }
+    void Clear()
+    {
+        *this = LatencyHistogram();
+    }
+    void Update(
+        int64_t inLatencyUsec)
+    {
+        const int64_t theMs = inLatencyUsec / 1000;
+        int i = 0;
+        while (i < kBucketCount - 1 && (int64_t(1) << i) <= theMs) {
+            i++;
+        }
+        mBuckets[i]++;
+        mCount++;
+        mTotalUsec += inLatencyUsec < 0 ? int64_t(0) : inLatencyUsec;
+    }
+    // Returns the bucket upper bound in milliseconds, or -1 for the last
+    // bucket.
+    static int64_t GetBucketBoundMs(
+        int inIdx)
+    {
+        return (inIdx < kBucketCount - 1 ? int64_t(1) << inIdx : int64_t(-1));
+    }
+    Counter mBuckets[kBucketCount];
+    Counter mCount;
+    Counter mTotalUsec;
+    // Ops failed and retried, or failed after reaching max retry count.
+    Counter mRetryCount;
+};
+
+struct ChunkserverLatencyCounters {
+    LatencyHistogram readLatency;
+    LatencyHistogram writeLatency;
+    void Clear() {
+        readLatency.Clear();
+        writeLatency.Clear();
+    }
+};
+
+typedef map<ServerLocation, ChunkserverLatencyCounters> ChunkServerLatencyMap;
 typedef map<string, Counter> ClientCounters;
 
 }
@@ -0,0 +1,301 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/14
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \file PartitionAppender.cc
+// \brief Atomic record append into a set of partition files.
+//
+//----------------------------------------------------------------------------
+
+#include "PartitionAppender.h"
+#include "KfsClient.h"
+
+#include "common/MsgLogger.h"
+#include "common/kfstypes.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+
+#include <algorithm>
+
+namespace KFS
+{
+using std::max;
+using std::min;
+
+PartitionAppender::PartitionAppender(
+    KfsClient& inClient)
+    : mClient(inClient),
+      mPartitions(),
+      mFreeBuffers(),
+      mInFlightBuffers(),
+      mInFlightPartitions(),
+      mBatchSize(0),
+      mMaxBufferCount(0),
+      mBufferCount(0),
+      mStatus(0)
+    {}
+
+PartitionAppender::~PartitionAppender()
+{
+    PartitionAppender::Close();
+}
+
+    int
+PartitionAppender::Open(
+    const vector<string>& inPathNames,
+    int                   inReplicaCount,
+    int                   inBatchSize,
+    int64_t               inMaxBufferSize)
+{
+    if (! mPartitions.empty()) {
+        return -EINVAL;
+    }
+    if (inPathNames.empty() || inBatchSize <= 0 || inMaxBufferSize <= 0) {
+        return -EINVAL;
+    }
+    mStatus         = 0;
+    mBatchSize      = min((int)CHUNKSIZE, inBatchSize);
+    mMaxBufferCount = (int)max(int64_t(1), min(
+        (int64_t)((unsigned int)~0 >> 1), inMaxBufferSize / mBatchSize));
+    mPartitions.reserve(inPathNames.size());
+    for (vector<string>::const_iterator theIt = inPathNames.begin();
+            theIt != inPathNames.end();
+            ++theIt) {
+        const int theFd = mClient.Open(theIt->c_str(),
+            O_CREAT | O_WRONLY | O_APPEND, inReplicaCount);
+        if (theFd < 0) {
+            KFS_LOG_STREAM_ERROR <<
+                *theIt << ": " << ErrorCodeToStr(theFd) <<
+            KFS_LOG_EOM;
+            Close();
+            return theFd;
+        }
+        mPartitions.push_back(Partition(theFd));
+    }
+    return 0;
+}
+
+    int
+PartitionAppender::Append(
+    int         inPartition,
+    const char* inPtr,
+    int         inLength)
+{
+    if (inPartition < 0 || GetPartitionCount() <= inPartition ||
+            (! inPtr && 0 < inLength)) {
+        return -EINVAL;
+    }
+    if (mStatus != 0) {
+        return mStatus;
+    }
+    if (inLength <= 0) {
+        return 0;
+    }
+    Partition& thePartition = mPartitions[inPartition];
+    if (mBatchSize < inLength) {
+        // Do not split the record, append it on its own. The client copies
+        // the record into the write behind buffer.
+        if (0 < thePartition.mLength) {
+            const int theStatus = Submit(thePartition);
+            if (theStatus != 0) {
+                return theStatus;
+            }
+        }
+        const int theRet = mClient.AtomicRecordAppend(
+            thePartition.mFd, inPtr, inLength);
+        if (theRet < 0) {
+            mStatus = theRet;
+        }
+        return theRet;
+    }
+    if (mBatchSize < thePartition.mLength + inLength) {
+        const int theStatus = Submit(thePartition);
+        if (theStatus != 0) {
+            return theStatus;
+        }
+    }
+    if (! thePartition.mBufPtr && ! (thePartition.mBufPtr = GetBuffer())) {
+        return (mStatus != 0 ? mStatus : -ENOMEM);
+    }
+    memcpy(thePartition.mBufPtr + thePartition.mLength, inPtr, inLength);
+    thePartition.mLength += inLength;
+    if (mBatchSize <= thePartition.mLength) {
+        const int theStatus = Submit(thePartition);
+        if (theStatus != 0) {
+            return theStatus;
+        }
+    }
+    return inLength;
+}
+
+    int
+PartitionAppender::Flush()
+{
+    const int theStatus = SubmitAll();
+    const int theRet    = SyncInFlight();
+    return (theStatus != 0 ? theStatus : theRet);
+}
+
+    int
+PartitionAppender::Close()
+{
+    if (mPartitions.empty()) {
+        FreeBuffers();
+        return mStatus;
+    }
+    int theRet = Flush();
+    for (Partitions::iterator theIt = mPartitions.begin();
+            theIt != mPartitions.end();
+            ++theIt) {
+        const int theStatus = mClient.Close(theIt->mFd);
+        if (theStatus < 0 && theRet == 0) {
+            theRet = theStatus;
+        }
+    }
+    mPartitions.clear();
+    FreeBuffers();
+    if (mStatus == 0) {
+        mStatus = theRet;
+    }
+    return theRet;
+}
+
+    char*
+PartitionAppender::GetBuffer()
+{
+    if (mFreeBuffers.empty() && mMaxBufferCount <= mBufferCount) {
+        // Pool exhausted, wait for appends in flight. If nothing is in
+        // flight, then all buffers are held by partially filled batches,
+        // append all of them.
+        if (mInFlightBuffers.empty() && SubmitAll() != 0) {
+            return 0;
+        }
+        if (SyncInFlight() != 0) {
+            return 0;
+        }
+    }
+    if (! mFreeBuffers.empty()) {
+        char* const theRetPtr = mFreeBuffers.back();
+        mFreeBuffers.pop_back();
+        return theRetPtr;
+    }
+    mBufferCount++;
+    return new char[mBatchSize];
+}
+
+    int
+PartitionAppender::Submit(
+    Partition& inPartition)
+{
+    if (inPartition.mLength <= 0) {
+        return mStatus;
+    }
+    // Zero copy write, the buffer is referenced by the client until the
+    // subsequent sync completes.
+    const int theRet = mClient.WriteAsync(
+        inPartition.mFd, inPartition.mBufPtr, (size_t)inPartition.mLength);
+    mInFlightBuffers.push_back(inPartition.mBufPtr);
+    inPartition.mBufPtr = 0;
+    inPartition.mLength = 0;
+    if (! inPartition.mInFlightFlag) {
+        inPartition.mInFlightFlag = true;
+        mInFlightPartitions.push_back(inPartition.mFd);
+    }
+    if (theRet < 0) {
+        KFS_LOG_STREAM_ERROR <<
+            "partition fd: " << inPartition.mFd <<
+            " append: "      << ErrorCodeToStr(theRet) <<
+        KFS_LOG_EOM;
+        if (mStatus == 0) {
+            mStatus = theRet;
+        }
+    }
+    return mStatus;
+}
+
+    int
+PartitionAppender::SubmitAll()
+{
+    int theRet = 0;
+    for (Partitions::iterator theIt = mPartitions.begin();
+            theIt != mPartitions.end();
+            ++theIt) {
+        const int theStatus = Submit(*theIt);
+        if (theStatus != 0 && theRet == 0) {
+            theRet = theStatus;
+        }
+    }
+    return theRet;
+}
+
+    int
+PartitionAppender::SyncInFlight()
+{
+    if (! mInFlightPartitions.empty()) {
+        const int theStatus = mClient.Sync(
+            &mInFlightPartitions[0], (int)mInFlightPartitions.size());
+        if (theStatus < 0) {
+            KFS_LOG_STREAM_ERROR <<
+                "partitions: " << mInFlightPartitions.size() <<
+                " sync: "      << ErrorCodeToStr(theStatus) <<
+            KFS_LOG_EOM;
+            if (mStatus == 0) {
+                mStatus = theStatus;
+            }
+        }
+        mInFlightPartitions.clear();
+        for (Partitions::iterator theIt = mPartitions.begin();
+                theIt != mPartitions.end();
+                ++theIt) {
+            theIt->mInFlightFlag = false;
+        }
+    }
+    // The client no longer references the buffers after sync, even if it
+    // has failed.
+    mFreeBuffers.insert(mFreeBuffers.end(),
+        mInFlightBuffers.begin(), mInFlightBuffers.end());
+    mInFlightBuffers.clear();
+    return mStatus;
+}
+
+    void
+PartitionAppender::FreeBuffers()
+{
+    for (Partitions::iterator theIt = mPartitions.begin();
+            theIt != mPartitions.end();
+            ++theIt) {
+        if (theIt->mBufPtr) {
+            mFreeBuffers.push_back(theIt->mBufPtr);
+            theIt->mBufPtr = 0;
+            theIt->mLength = 0;
+        }
+    }
+    for (Buffers::const_iterator theIt = mFreeBuffers.begin();
+            theIt != mFreeBuffers.end();
+            ++theIt) {
+        delete [] *theIt;
+    }
+    mFreeBuffers.clear();
+    mBufferCount = 0;
+}
+
+} // namespace KFS
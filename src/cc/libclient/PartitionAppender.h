@@ -0,0 +1,153 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/14
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \file PartitionAppender.h
+// \brief Atomic record append into a set of partition files.
+//
+//----------------------------------------------------------------------------
+
+#ifndef LIBKFSCLIENT_PARTITION_APPENDER_H
+#define LIBKFSCLIENT_PARTITION_APPENDER_H
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+namespace KFS
+{
+using std::string;
+using std::vector;
+
+class KfsClient;
+
+// Appends records to a set of partition files, for example the map output
+// partitions of a shuffle, with atomic record append.
+//
+// The records of each partition are batched in the partition's buffer, and
+// a full batch is appended as a single atomic record append with zero copy
+// asynchronous write. The buffers are allocated from a pool shared by all
+// partitions: only the partitions that have data pending hold buffers, thus
+// the memory use is bounded by the pool size, and not by the number of
+// partitions. When the pool is exhausted, all the partitions with appends
+// in flight are flushed with a single group Sync(), which takes about one
+// append round trip, and the buffers are returned to the pool.
+//
+// The appends of all partition files are executed concurrently by the client
+// protocol worker thread event loop, or by the protocol worker threads, if
+// more than one is configured with client.protocolWorkerThreads.
+//
+// The records of one batch are appended contiguously, and records never
+// straddle batches, but, as with any atomic record append, the order of the
+// batches in the file is not defined, and the same batch might appear more
+// than once in the case of append failure recovery. The records, therefore,
+// must be self describing, i.e. framed, and idempotent.
+//
+// The methods are not thread safe.
+class PartitionAppender
+{
+public:
+    PartitionAppender(
+        KfsClient& inClient);
+    ~PartitionAppender();
+    // Opens, and creates if needed, the partition files for atomic record
+    // append.
+    // inBatchSize is the partition buffer size, the records larger than the
+    // batch size are appended individually with KfsClient::AtomicRecordAppend.
+    // inMaxBufferSize is the buffer pool size.
+    int Open(
+        const vector<string>& inPathNames,
+        int                   inReplicaCount  = 3,
+        int                   inBatchSize     = 64 << 10,
+        int64_t               inMaxBufferSize = 64 << 20);
+    // Returns inLength on success, or negative error code.
+    int Append(
+        int         inPartition,
+        const char* inPtr,
+        int         inLength);
+    // Appends all partially filled batches, and waits for the all appends
+    // to complete.
+    int Flush();
+    // Flushes, and closes all partition files.
+    int Close();
+    int GetPartitionCount() const
+        { return (int)mPartitions.size(); }
+    int GetFd(
+        int inPartition) const
+    {
+        return ((0 <= inPartition && inPartition < GetPartitionCount()) ?
+            mPartitions[inPartition].mFd : -1);
+    }
+    // Pool buffers allocated, and in use by partitions or appends in flight.
+    int64_t GetBufferSize() const
+        { return ((int64_t)mBufferCount * mBatchSize); }
+    int64_t GetBufferInUseSize() const
+    {
+        return ((int64_t)(mBufferCount - (int)mFreeBuffers.size()) *
+            mBatchSize);
+    }
+    int GetErrorCode() const
+        { return mStatus; }
+private:
+    struct Partition
+    {
+        Partition(
+            int inFd = -1)
+            : mFd(inFd),
+              mBufPtr(0),
+              mLength(0),
+              mInFlightFlag(false)
+            {}
+        int   mFd;
+        char* mBufPtr;
+        int   mLength;
+        bool  mInFlightFlag;
+    };
+    typedef vector<Partition> Partitions;
+    typedef vector<char*>     Buffers;
+    typedef vector<int>       Fds;
+
+    KfsClient& mClient;
+    Partitions mPartitions;
+    Buffers    mFreeBuffers;
+    Buffers    mInFlightBuffers;
+    Fds        mInFlightPartitions;
+    int        mBatchSize;
+    int        mMaxBufferCount;
+    int        mBufferCount;
+    int        mStatus;
+
+    char* GetBuffer();
+    int Submit(
+        Partition& inPartition);
+    int SubmitAll();
+    int SyncInFlight();
+    void FreeBuffers();
+private:
+    PartitionAppender(
+        const PartitionAppender& inAppender);
+    PartitionAppender& operator=(
+        const PartitionAppender& inAppender);
+};
+
+} // namespace KFS
+
+#endif /* LIBKFSCLIENT_PARTITION_APPENDER_H */
@@ -1265,6 +1265,29 @@ private:
             mDoneFlag = true;
             return mSize;
         }
+        int CopyIn(
+            const IOBuffer& inBuffer)
+        {
+            QCASSERT(! mInFlightFlag && ! mDoneFlag &&
+                mBuffer.IsEmpty() && inBuffer.BytesConsumable() == mSize);
+            // Copy into the available space, the space is normally the
+            // caller's buffer.
+            for (IOBuffer::iterator theIt = inBuffer.begin();
+                    theIt != inBuffer.end();
+                    ++theIt) {
+                mBuffer.CopyIn(theIt->Consumer(), theIt->BytesConsumable());
+            }
+            mStatus   = 0;
+            mDoneFlag = true;
+            return mSize;
+        }
+        int Uncache()
+        {
+            QCASSERT(! mInFlightFlag && mDoneFlag && ! IsFailed());
+            mBuffer.TrimAndConvertRemainderToAvailableSpace(0);
+            mStatus = kErrorIO;
+            return mSize;
+        }
         void ReadDone(
             Outer&       inOuter,
             int          inStatus,
@@ -1796,6 +1819,7 @@ private:
         int       mRecursionCount;
         int       mRecoverySize;
         int       mBadStripeCount;
+        int       mCachedStripeIdx;
 
         static Request& Create(
             Outer&    inOuter,
@@ -1860,6 +1884,7 @@ private:
             mRecursionCount = 0;
             mRecoverySize   = 0;
             mBadStripeCount = 0;
+            mCachedStripeIdx = -1;
             const int theBufCount = inOuter.GetBufferCount();
             for (int i = 0; i < theBufCount; i++) {
                 GetBuffer(i).Clear();
@@ -1933,9 +1958,15 @@ private:
         void Read(
             Outer& inOuter)
         {
-            if (mRecursionCount > 0 ||
-                    mPendingCount <= 0 ||
-                    mInFlightCount >= mPendingCount) {
+            if (mRecursionCount > 0) {
+                return;
+            }
+            if (mPendingCount <= 0) {
+                // All data was copied from the recovery buffer.
+                Done(inOuter);
+                return;
+            }
+            if (mInFlightCount >= mPendingCount) {
                 return;
             }
             mRecursionCount++;
@@ -1971,6 +2002,10 @@ private:
                     "failed to start recovery: invalid request");
                 return;
             }
+            if (inOuter.mRecoverStripeIdx < 0) {
+                mRecoverySize = inOuter.mRecoveryInfo.GetRecoverySize(
+                    inOuter, mRecoveryPos, mRecoverySize);
+            }
             KFS_LOG_STREAM_INFO << inOuter.mLogPrefix <<
                 "init recovery:"
                 " req: "  << mPos                 <<
@@ -2007,25 +2042,41 @@ private:
               mRecoveryRound(0),
               mRecursionCount(0),
               mRecoverySize(0),
-              mBadStripeCount(0)
+              mBadStripeCount(0),
+              mCachedStripeIdx(-1)
             { Requests::Init(*this); }
         ~Request()
             {}
         bool Recovery(
             Outer& inOuter)
         {
+            const int thePrevBadStripeCount = mBadStripeCount;
+            if (0 <= mCachedStripeIdx) {
+                // Run recovery with the stripe data that was copied from the
+                // recovery buffer declared missing, as the missing chunk size
+                // is not known, and the chunk sizes are validated by the
+                // recovery.
+                if (0 < GetBuffer(mCachedStripeIdx).mBuf.Uncache()) {
+                    mBadStripeCount++;
+                }
+                mCachedStripeIdx = -1;
+            }
             if (++mBadStripeCount > inOuter.mRecoveryStripeCount) {
                 return false;
             }
-            if (mBadStripeCount <= 1 && mRecoverySize <= 0) {
+            if (thePrevBadStripeCount <= 0 && mRecoverySize <= 0) {
                 InitRecovery(inOuter);
             }
             if (mRecoverySize <= 0) {
                 return false;
             }
-            const int i = inOuter.mStripeCount + mBadStripeCount - 1;
-            mPendingCount += GetBuffer(i).InitRecoveryRead(
-                inOuter, mRecoveryPos + i * (Offset)CHUNKSIZE, mRecoverySize);
+            for (int i = inOuter.mStripeCount + thePrevBadStripeCount;
+                    i < inOuter.mStripeCount + mBadStripeCount;
+                    i++) {
+                mPendingCount += GetBuffer(i).InitRecoveryRead(
+                    inOuter, mRecoveryPos + i * (Offset)CHUNKSIZE,
+                    mRecoverySize);
+            }
             Read(inOuter);
             return true;
         }
@@ -2319,6 +2370,8 @@ private:
         IOBuffer  mBuffer;
         Offset    mPos;
         Offset    mChunkBlockStartPos;
+        Offset    mBufferPos;
+        int       mBufferStripeIdx;
         int       mSize;
         int       mMissingCnt;
         StripeIdx mMissingIdx[kMaxRecoveryStripes];
@@ -2327,14 +2380,18 @@ private:
             : mBuffer(),
               mPos(-1),
               mChunkBlockStartPos(-1),
+              mBufferPos(-1),
+              mBufferStripeIdx(-1),
               mSize(0),
               mMissingCnt(0)
             {}
         void ClearBuffer()
         {
             mBuffer.Clear();
-            mSize = 0;
-            mPos  = -1;
+            mSize            = 0;
+            mPos             = -1;
+            mBufferPos       = -1;
+            mBufferStripeIdx = -1;
         }
         void Clear()
         {
@@ -2368,8 +2425,103 @@ private:
             if (mMissingCnt <= 0) {
                 Clear();
             }
-            // TODO: use mBuffer to save recovery result if request is not
-            // aligned.
+        }
+        void SetBuffer(
+            Outer&          inOuter,
+            const Request&  inRequest,
+            int             inStripeIdx,
+            const IOBuffer& inBuffer)
+        {
+            // Save the recovered data stripe, in order to serve subsequent
+            // reads of the same region of the missing stripe with no chunk
+            // reads and no decoding.
+            mBuffer.Clear();
+            mSize            = 0;
+            mBufferPos       = -1;
+            mBufferStripeIdx = -1;
+            if (mChunkBlockStartPos < 0 ||
+                    inOuter.mRecoverStripeIdx >= 0 ||
+                    inStripeIdx < 0 ||
+                    inOuter.mStripeCount <= inStripeIdx ||
+                    inRequest.mRecoverySize <= 0 ||
+                    inBuffer.BytesConsumable() != inRequest.mRecoverySize) {
+                return;
+            }
+            // Copy, as the buffer space is normally the caller's buffer.
+            for (IOBuffer::iterator theIt = inBuffer.begin();
+                    theIt != inBuffer.end();
+                    ++theIt) {
+                mBuffer.CopyIn(theIt->Consumer(), theIt->BytesConsumable());
+            }
+            mSize            = inRequest.mRecoverySize;
+            mBufferPos       = inRequest.mRecoveryPos;
+            mBufferStripeIdx = inStripeIdx;
+        }
+        int GetRecoverySize(
+            Outer& inOuter,
+            Offset inRecoveryPos,
+            int    inSize) const
+        {
+            // Recover up to max atomic read size if the recovery starts
+            // within or at the end of the saved recovery buffer, i.e. if the
+            // missing stripe is being read sequentially.
+            const int theChunkPos = GetChunkPos(inRecoveryPos);
+            if (mSize <= 0 ||
+                    inRecoveryPos < mBufferPos ||
+                    mBufferPos + mSize < inRecoveryPos ||
+                    mBufferPos - GetChunkPos(mBufferPos) !=
+                        inRecoveryPos - theChunkPos) {
+                return inSize;
+            }
+            return max(inSize, min(inOuter.mMaxReadSize,
+                (int)CHUNKSIZE - theChunkPos));
+        }
+        bool UseBuffer(
+            Outer&   inOuter,
+            Request& inRequest)
+        {
+            // The buffer can only be used if it has the only missing data
+            // stripe.
+            if (mSize <= 0 ||
+                    mMissingCnt <= 0 ||
+                    mMissingIdx[0] != mBufferStripeIdx ||
+                    (1 < mMissingCnt &&
+                        mMissingIdx[1] < inOuter.mStripeCount) ||
+                    inRequest.mRecoverySize > 0 ||
+                    inRequest.mBadStripeCount > 0 ||
+                    inRequest.mCachedStripeIdx >= 0) {
+                return false;
+            }
+            Buffer& theBuf = inRequest.GetBuffer(mBufferStripeIdx);
+            if (theBuf.mBuf.mSize <= 0) {
+                return true; // Nothing to read from the missing stripe.
+            }
+            const Offset theOffset = theBuf.mPos -
+                (mBufferPos + mBufferStripeIdx * (Offset)CHUNKSIZE);
+            if (theBuf.mBufL.mSize > 0 ||
+                    theBuf.mBufR.mSize > 0 ||
+                    theOffset < 0 ||
+                    mSize < theOffset + theBuf.mBuf.mSize) {
+                return false;
+            }
+            IOBuffer theBuffer;
+            theBuffer.Copy(&mBuffer, (int)theOffset + theBuf.mBuf.mSize);
+            theBuffer.Consume((int)theOffset);
+            const int theSize = theBuf.mBuf.CopyIn(theBuffer);
+            QCASSERT(inRequest.mPendingCount >= theSize);
+            inRequest.mPendingCount    -= theSize;
+            inRequest.mCachedStripeIdx  = mBufferStripeIdx;
+            KFS_LOG_STREAM_DEBUG << inOuter.mLogPrefix <<
+                "read recovery buffer:"
+                " req: "     << inRequest.mPos          <<
+                ","          << inRequest.mSize         <<
+                " block: "   << mChunkBlockStartPos     <<
+                " stripe: "  << mBufferStripeIdx        <<
+                " pos: "     << theBuf.mPos             <<
+                " size: "    << theSize                 <<
+                " pending: " << inRequest.mPendingCount <<
+            KFS_LOG_EOM;
+            return true;
         }
         void SetIfEmpty(
             Outer& inOuter,
@@ -2464,6 +2616,9 @@ private:
                 inRequest.mBadStripeCount == 0 &&
                 inRequest.mInFlightCount == 0
             );
+            if (UseBuffer(inOuter, inRequest)) {
+                return;
+            }
             const int theBufCount = inOuter.GetBufferCount();
             int i;
             for (i = 0; ; i++) {
@@ -3516,6 +3671,25 @@ private:
             thePrevLen = theLen;
         }
         mRecoveryInfo.Set(*this, inRequest);
+        int theRecoveredIdx = -1;
+        if (theEndPosHead < 0 && theSize == inRequest.mRecoverySize &&
+                mRecoverStripeIdx < 0) {
+            for (int i = 0; i < mStripeCount; i++) {
+                if (mBufIteratorsPtr[i].IsFailure()) {
+                    if (0 <= theRecoveredIdx) {
+                        theRecoveredIdx = -1;
+                        break;
+                    }
+                    theRecoveredIdx = i;
+                }
+            }
+        }
+        if (0 <= theRecoveredIdx) {
+            mRecoveryInfo.SetBuffer(*this, inRequest, theRecoveredIdx,
+                mBufIteratorsPtr[theRecoveredIdx].GetBuffer());
+        } else {
+            mRecoveryInfo.ClearBuffer();
+        }
         for (int i = 0; i < mStripeCount; i++) {
             mBufIteratorsPtr[i].SetRecoveryResult(inRequest.GetBuffer(i));
         }
@@ -88,6 +88,8 @@ public:
         kErrorInvalChunkSize = -EINVALCHUNKSIZE,
         kErrorPermissions    = -EPERM
     };
+    // Max read lease time to request, the meta server limits it further.
+    enum { kMaxReadLeaseTimeout = 60 * 60 };
 
     Impl(
         Reader&     inOuter,
@@ -102,7 +104,8 @@ public:
         int         inLeaseWaitTimeout,
         string      inLogPrefix,
         int64_t     inChunkServerInitialSeqNum,
-        ClientPool* inClientPoolPtr)
+        ClientPool* inClientPoolPtr,
+        int         inHedgeMinDelayMs)
         : QCRefCountedObj(),
           mOuter(inOuter),
           mMetaServer(inMetaServer),
@@ -131,8 +134,14 @@ public:
           mNetManager(mMetaServer.GetNetManager()),
           mStriperPtr(0),
           mCompletionDepthCount(0),
-          mReplicaCount(-1)
+          mReplicaCount(-1),
+          mHedgeMinDelayMs(inHedgeMinDelayMs),
+          mReadLatencyP95Ms(-1),
+          mTraceId(0)
         { Readers::Init(mReaders); }
+    void SetTraceId(
+        int64_t inTraceId)
+        { mTraceId = inTraceId; }
     int Open(
         kfsFileId_t inFileId,
         const char* inFileNamePtr,
@@ -335,6 +344,7 @@ private:
             typedef vector<RequestEntry> Requests;
 
             time_t    mOpStartTime;
+            int64_t   mOpStartTimeMs;
             IOBuffer  mBuffer;
             IOBuffer  mTmpBuffer;
             RequestId mRequestId;
@@ -343,6 +353,7 @@ private:
             bool      mRetryIfFailsFlag;
             bool      mFailShortReadFlag;
             bool      mCancelFlag;
+            bool      mHedgedFlag;
 
             ReadOp(
                 int       inOpSize,
@@ -353,6 +364,7 @@ private:
                 bool      inFailShortReadFlag)
                 : KFS::client::ReadOp(-1, -1, -1),
                   mOpStartTime(0),
+                  mOpStartTimeMs(0),
                   mBuffer(),
                   mTmpBuffer(),
                   mRequestId(inRequestId),
@@ -360,7 +372,8 @@ private:
                   mRequests(),
                   mRetryIfFailsFlag(inRetryIfFailsFlag),
                   mFailShortReadFlag(inFailShortReadFlag),
-                  mCancelFlag(false)
+                  mCancelFlag(false),
+                  mHedgedFlag(false)
             {
                 Queue::Init(*this);
                 numBytes                   = inOpSize;
@@ -445,7 +458,8 @@ private:
               mLogPrefix(inLogPrefix),
               mOpsNoRetryCount(0),
               mDeletedFlagPtr(0),
-              mRunningCompletionPtr(0)
+              mRunningCompletionPtr(0),
+              mHedgeTimer(*this)
         {
             Queue::Init(mPendingQueue);
             Queue::Init(mInFlightQueue);
@@ -464,6 +478,7 @@ private:
         ~ChunkReader()
         {
             ChunkReader::Shutdown();
+            StopHedgeTimer();
             ChunkServer::Stats theStats;
             mChunkServer.GetStats(theStats);
             mOuter.mChunkServersStats.Add(theStats);
@@ -698,6 +713,27 @@ private:
                 mGetAllocOp.chunkVersion : int64_t(-1));
         }
     private:
+        class HedgeTimer : public ITimeout
+        {
+        public:
+            HedgeTimer(
+                ChunkReader& inReader)
+                : ITimeout(),
+                  mReader(inReader),
+                  mRegisteredFlag(false)
+                {}
+            virtual void Timeout()
+                { mReader.HedgeTimeout(); }
+            ChunkReader& mReader;
+            bool         mRegisteredFlag;
+        private:
+            HedgeTimer(
+                const HedgeTimer& inTimer);
+            HedgeTimer& operator=(
+                const HedgeTimer& inTimer);
+        };
+        friend class HedgeTimer;
+
         class StRunningCompletion
         {
         public:
@@ -801,6 +837,7 @@ private:
         int                  mOpsNoRetryCount;
         bool*                mDeletedFlagPtr;
         StRunningCompletion* mRunningCompletionPtr;
+        HedgeTimer           mHedgeTimer;
         ReadOp*              mPendingQueue[1];
         ReadOp*              mInFlightQueue[1];
         ReadOp*              mCompletionQueue[1];
@@ -1011,6 +1048,7 @@ private:
             QCASSERT(mGetAllocOp.fileOffset >= 0 && mGetAllocOp.fid > 0);
             Reset(mGetAllocOp);
             mGetAllocOp.chunkServers.clear();
+            mGetAllocOp.chunkServersLoad.clear();
             mGetAllocOp.serversOrderedFlag = false;
             EnqueueMeta(mGetAllocOp);
         }
@@ -1034,15 +1072,57 @@ private:
                 HandleError(inOp);
                 return;
             }
+            vector<ServerLocation> theOverloaded;
+            GetOverloadedServers(theOverloaded);
             if (! mGetAllocOp.serversOrderedFlag) {
                 random_shuffle(
                     mGetAllocOp.chunkServers.begin(),
                     mGetAllocOp.chunkServers.end()
                 );
+                if (mOuter.mClientPoolPtr) {
+                    mOuter.mClientPoolPtr->OrderServers(
+                        mGetAllocOp.chunkServers, ITimeout::NowMs());
+                }
+            }
+            if (! theOverloaded.empty()) {
+                // Try overloaded servers last, in order to avoid waiting for
+                // the time out if other replicas are available.
+                vector<ServerLocation> theServers;
+                theServers.reserve(mGetAllocOp.chunkServers.size());
+                for (int thePass = 0; thePass < 2; thePass++) {
+                    for (vector<ServerLocation>::const_iterator theIt =
+                                mGetAllocOp.chunkServers.begin();
+                            theIt != mGetAllocOp.chunkServers.end();
+                            ++theIt) {
+                        if ((find(theOverloaded.begin(), theOverloaded.end(),
+                                *theIt) == theOverloaded.end()) ==
+                                (thePass == 0)) {
+                            theServers.push_back(*theIt);
+                        }
+                    }
+                }
+                mGetAllocOp.chunkServers.swap(theServers);
             }
             mChunkServerIdx = 0;
             StartRead();
         }
+        void GetOverloadedServers(
+            vector<ServerLocation>& outServers) const
+        {
+            const int kOverloadedLoadHint = 100;
+            if (mGetAllocOp.chunkServersLoad.size() !=
+                    mGetAllocOp.chunkServers.size()) {
+                return;
+            }
+            for (size_t i = 0; i < mGetAllocOp.chunkServers.size(); i++) {
+                if (kOverloadedLoadHint <= mGetAllocOp.chunkServersLoad[i]) {
+                    outServers.push_back(mGetAllocOp.chunkServers[i]);
+                }
+            }
+            if (outServers.size() == mGetAllocOp.chunkServers.size()) {
+                outServers.clear();
+            }
+        }
         void GetLease()
         {
             QCASSERT(mGetAllocOp.fileOffset >= 0 && mGetAllocOp.fid > 0);
@@ -1056,6 +1136,10 @@ private:
             mLeaseAcquireOp.chunkId  = mGetAllocOp.chunkId;
             mLeaseAcquireOp.pathname = mGetAllocOp.filename.c_str();
             mLeaseAcquireOp.leaseId  = -1;
+            // Ask for long read lease, the meta server only grants it for
+            // stable chunks if configured to do so.
+            mLeaseAcquireOp.leaseTimeout  = kMaxReadLeaseTimeout;
+            mLeaseAcquireOp.leaseDuration = -1;
             mLeaseAcquireOp.chunkAccessCount              = 0;
             mLeaseAcquireOp.chunkServerAccessValidForTime = 0;
             mLeaseAcquireOp.chunkServerAccessIssuedTime   = 0;
@@ -1128,6 +1212,11 @@ private:
                 HandleError(inOp);
                 return;
             }
+            if (LEASE_INTERVAL_SECS < inOp.leaseDuration) {
+                mLeaseExpireTime += inOp.leaseDuration - LEASE_INTERVAL_SECS;
+                mLeaseRenewTime  = mLeaseExpireTime -
+                    (LEASE_INTERVAL_SECS + 1) / 2;
+            }
             if (0 <= mLeaseToRelinquish && 0 <= mLeaseAcquireOp.chunkId) {
                 mOuter.mStats.mMetaOpsQueuedCount++;
                 const int64_t theLeaseId = mLeaseToRelinquish;
@@ -1294,8 +1383,107 @@ private:
             }
             inReadOp.access = mSizeOp.access;
             mOuter.mStats.mOpsReadCount++;
+            inReadOp.mOpStartTimeMs = ITimeout::NowMs();
+            StartHedgeTimer();
             Enqueue(inReadOp, &inReadOp.mTmpBuffer);
         }
+        void StartHedgeTimer()
+        {
+            if (mHedgeTimer.mRegisteredFlag) {
+                return;
+            }
+            const int64_t theDelayMs = mOuter.GetHedgeDelayMs();
+            if (theDelayMs <= 0) {
+                return;
+            }
+            mHedgeTimer.mRegisteredFlag = true;
+            const bool kResetTimerFlag = true;
+            mHedgeTimer.SetTimeoutInterval(
+                (int)min(theDelayMs, int64_t(mOuter.mOpTimeoutSec) * 1000),
+                kResetTimerFlag);
+            mOuter.mNetManager.RegisterTimeoutHandler(&mHedgeTimer);
+        }
+        void StopHedgeTimer()
+        {
+            if (! mHedgeTimer.mRegisteredFlag) {
+                return;
+            }
+            mHedgeTimer.mRegisteredFlag = false;
+            mOuter.mNetManager.UnRegisterTimeoutHandler(&mHedgeTimer);
+        }
+        void HedgeTimeout()
+        {
+            ReadOp* const theOpPtr   = Queue::Front(mInFlightQueue);
+            const int64_t theDelayMs = mOuter.GetHedgeDelayMs();
+            if (! theOpPtr || theDelayMs <= 0 || mSleepingFlag ||
+                    mErrorCode != 0 || ! mChunkServerSetFlag) {
+                StopHedgeTimer();
+                return;
+            }
+            // The in flight queue is in the op start time order.
+            const int64_t theElapsedMs =
+                ITimeout::NowMs() - theOpPtr->mOpStartTimeMs;
+            if (theElapsedMs < theDelayMs) {
+                const bool kResetTimerFlag = true;
+                mHedgeTimer.SetTimeoutInterval(
+                    (int)(theDelayMs - theElapsedMs), kResetTimerFlag);
+                return;
+            }
+            StopHedgeTimer();
+            Hedge(*theOpPtr, theElapsedMs);
+        }
+        void Hedge(
+            ReadOp& inOp,
+            int64_t inElapsedMs)
+        {
+            if (mChunkServerIdx + 1 < mGetAllocOp.chunkServers.size()) {
+                KFS_LOG_STREAM_INFO << mLogPrefix <<
+                    "hedging read:"
+                    " chunk: "   << mGetAllocOp.chunkId <<
+                    " server: "  << GetChunkServer().GetServerLocation() <<
+                    " elapsed: " << inElapsedMs << " ms." <<
+                    " next: "    <<
+                        mGetAllocOp.chunkServers[mChunkServerIdx + 1] <<
+                    " op: "      << inOp.Show() <<
+                KFS_LOG_EOM;
+                mOuter.mStats.mReadHedgeCount++;
+                Queue::Iterator theIt(mInFlightQueue);
+                ReadOp*         theOpPtr;
+                while ((theOpPtr = theIt.Next())) {
+                    theOpPtr->mHedgedFlag = true;
+                }
+                // Move all in flight ops to the next replica. Canceled ops are
+                // put back into the pending queue by Done().
+                StopChunkServer();
+                QCASSERT(Queue::IsEmpty(mInFlightQueue));
+                mChunkServerIdx++;
+                mChunkServerSetFlag = false;
+                StartRead();
+                return;
+            }
+            if (inOp.mRetryIfFailsFlag) {
+                return;
+            }
+            // No other replica, and the striper can recover the data from the
+            // other stripes -- fail the read in order to start recovery now.
+            KFS_LOG_STREAM_INFO << mLogPrefix <<
+                "hedging read with recovery:"
+                " chunk: "   << mGetAllocOp.chunkId <<
+                " server: "  << GetChunkServer().GetServerLocation() <<
+                " elapsed: " << inElapsedMs << " ms." <<
+                " op: "      << inOp.Show() <<
+            KFS_LOG_EOM;
+            mOuter.mStats.mReadHedgeRecoveryCount++;
+            if (! GetChunkServer().Cancel(&inOp, this) ||
+                    ! Queue::IsInList(mPendingQueue, inOp)) {
+                mOuter.InternalError("failed to cancel read op");
+            }
+            inOp.status    = kErrorIO;
+            inOp.statusMsg = "read hedge timeout";
+            if (ReportCompletion(inOp, mPendingQueue)) {
+                StartRead();
+            }
+        }
         void Done(
             ReadOp&   inOp,
             bool      inCanceledFlag,
@@ -1322,6 +1510,11 @@ private:
                         mOuter.mMetaServer.GetServerLocation(),
                         mChunkServer.GetServerLocation(),
                         inOp.status);
+                if (mOuter.mClientPoolPtr) {
+                    mOuter.mClientPoolPtr->ReportServerError(
+                        GetChunkServer().GetServerLocation(),
+                        ITimeout::NowMs());
+                }
                 mOpStartTime = inOp.mOpStartTime;
                 if (! inOp.mRetryIfFailsFlag && inOp.status != kErrorChecksum &&
                         mChunkServerIdx + 1 >=
@@ -1342,6 +1535,21 @@ private:
             );
             mOuter.mStats.mReadCount++;
             mOuter.mStats.mReadByteCount += theDoneCount;
+            const int64_t theNowMs = ITimeout::NowMs();
+            mOuter.UpdateReadLatency(theNowMs - inOp.mOpStartTimeMs);
+            Monitor::ReportLatency(
+                    Monitor::kReadOpLatency,
+                    mOuter.mMetaServer.GetServerLocation(),
+                    GetChunkServer().GetServerLocation(),
+                    (theNowMs - inOp.mOpStartTimeMs) * 1000);
+            if (inOp.mHedgedFlag) {
+                mOuter.mStats.mReadHedgeDoneCount++;
+            } else if (mOuter.mClientPoolPtr) {
+                mOuter.mClientPoolPtr->UpdateServerLatency(
+                    GetChunkServer().GetServerLocation(),
+                    theNowMs - inOp.mOpStartTimeMs,
+                    theNowMs);
+            }
             if (theDoneCount < inOp.mTmpBuffer.BytesConsumable()) {
                 // Move available space, if any, to the end of the short read.
                 IOBuffer theBuf;
@@ -1715,6 +1923,7 @@ private:
             CancelMetaOps();
             mLastOpPtr = 0;
             StopChunkServer();
+            StopHedgeTimer();
             mChunkServerSetFlag = false;
             QCASSERT(Queue::IsEmpty(mInFlightQueue));
             if (mSleepingFlag) {
@@ -2031,6 +2240,7 @@ private:
                 mLastMetaOpPtr = &inOp;
                 mOuter.mStats.mMetaOpsQueuedCount++;
             }
+            inOp.traceId = mOuter.mTraceId;
             if (! (inServerPtr ? *inServerPtr : mOuter.mMetaServer).Enqueue(
                     &inOp, this, inBufferPtr)) {
                 mOuter.InternalError(inServerPtr ?
@@ -2228,8 +2438,40 @@ private:
     Striper*            mStriperPtr;
     int                 mCompletionDepthCount;
     int                 mReplicaCount;
+    const int           mHedgeMinDelayMs;
+    int64_t             mReadLatencyP95Ms;
+    int64_t             mTraceId;
     ChunkReader*        mReaders[1];
 
+    // Returns the time after which an outstanding read is hedged, or -1 if
+    // hedging is disabled.
+    int64_t GetHedgeDelayMs() const
+    {
+        return (mHedgeMinDelayMs <= 0 ? int64_t(-1) :
+            max(int64_t(mHedgeMinDelayMs), mReadLatencyP95Ms));
+    }
+    // Track 95 percentile of the read latency with stochastic approximation:
+    // the estimate moves up by 19 steps when the sample is above it, and down
+    // by one step otherwise, and converges to the value that is exceeded by 5%
+    // of the samples.
+    void UpdateReadLatency(
+        int64_t inLatencyMs)
+    {
+        if (mHedgeMinDelayMs <= 0) {
+            return;
+        }
+        if (mReadLatencyP95Ms < 0) {
+            mReadLatencyP95Ms = inLatencyMs;
+            return;
+        }
+        const int64_t theStep = max(int64_t(1), mReadLatencyP95Ms / 64);
+        if (mReadLatencyP95Ms < inLatencyMs) {
+            mReadLatencyP95Ms += 19 * theStep;
+        } else {
+            mReadLatencyP95Ms = max(int64_t(0), mReadLatencyP95Ms - theStep);
+        }
+    }
+
     void InternalError(
             const char* inMsgPtr = 0)
     {
@@ -2697,7 +2939,8 @@ Reader::Reader(
     int                 inLeaseWaitTimeout         /* = 900 */,
     const char*         inLogPrefixPtr             /* = 0 */,
     int64_t             inChunkServerInitialSeqNum /* = 1 */,
-    ClientPool*         inClientPoolPtr            /* = 0 */)
+    ClientPool*         inClientPoolPtr            /* = 0 */,
+    int                 inHedgeMinDelayMs          /* = 0 */)
     : mImpl(*new Reader::Impl(
         *this,
         inMetaServer,
@@ -2712,7 +2955,8 @@ Reader::Reader(
         (inLogPrefixPtr && inLogPrefixPtr[0]) ?
             (inLogPrefixPtr + string(" ")) : string(),
         inChunkServerInitialSeqNum,
-        inClientPoolPtr
+        inClientPoolPtr,
+        inHedgeMinDelayMs
     ))
 {
     mImpl.Ref();
@@ -2817,6 +3061,13 @@ Reader::GetErrorCode() const
     return mImpl.GetErrorCode();
 }
 
+void
+Reader::SetTraceId(
+    int64_t inTraceId)
+{
+    mImpl.SetTraceId(inTraceId);
+}
+
 void
 Reader::Register(
     Reader::Completion* inCompletionPtr)
@@ -93,7 +93,10 @@ public:
               mReadByteCount(0),
               mReadErrorsCount(0),
               mReadChecksumErrorsCount(0),
-              mReadRecoveriesCount(0)
+              mReadRecoveriesCount(0),
+              mReadHedgeCount(0),
+              mReadHedgeDoneCount(0),
+              mReadHedgeRecoveryCount(0)
             {}
         void Clear()
             { *this = Stats(); }
@@ -113,6 +116,9 @@ public:
             mReadErrorsCount         += inStats.mReadErrorsCount;
             mReadChecksumErrorsCount += inStats.mReadChecksumErrorsCount;
             mReadRecoveriesCount     += inStats.mReadRecoveriesCount;
+            mReadHedgeCount          += inStats.mReadHedgeCount;
+            mReadHedgeDoneCount      += inStats.mReadHedgeDoneCount;
+            mReadHedgeRecoveryCount  += inStats.mReadHedgeRecoveryCount;
             return *this;
         }
         template<typename T>
@@ -129,6 +135,9 @@ public:
             inFunctor("ReadErrors",         mReadErrorsCount);
             inFunctor("ReadChecksumErrors", mReadChecksumErrorsCount);
             inFunctor("ReadRecoveries",     mReadRecoveriesCount);
+            inFunctor("ReadHedges",         mReadHedgeCount);
+            inFunctor("ReadHedgesDone",     mReadHedgeDoneCount);
+            inFunctor("ReadHedgeRecovery",  mReadHedgeRecoveryCount);
             inFunctor("Reads",              mReadCount);
             inFunctor("ReadBytes",          mReadByteCount);
         }
@@ -145,6 +154,9 @@ public:
         Counter mReadErrorsCount;
         Counter mReadChecksumErrorsCount;
         Counter mReadRecoveriesCount;
+        Counter mReadHedgeCount;
+        Counter mReadHedgeDoneCount;
+        Counter mReadHedgeRecoveryCount;
     };
     class Striper
     {
@@ -237,7 +249,8 @@ public:
         int         inLeaseWaitTimeout         = 900,
         const char* inLogPrefixPtr             = 0,
         int64_t     inChunkServerInitialSeqNum = 1,
-        ClientPool* inClientPoolPtr            = 0);
+        ClientPool* inClientPoolPtr            = 0,
+        int         inHedgeMinDelayMs          = 0);
     virtual ~Reader();
     int Open(
         kfsFileId_t inFileId,
@@ -264,6 +277,9 @@ public:
     bool IsClosing() const;
     bool IsActive()  const;
     int GetErrorCode() const;
+    // Trace id sent with all subsequent requests, 0 -- none.
+    void SetTraceId(
+        int64_t inTraceId);
     void Register(
         Completion* inCompletionPtr);
     bool Unregister(
@@ -39,6 +39,7 @@
 #include "kfsio/ClientAuthContext.h"
 #include "common/kfsdecls.h"
 #include "common/MsgLogger.h"
+#include "common/time.h"
 #include "qcdio/QCUtils.h"
 #include "qcdio/qcdebug.h"
 #include "KfsOps.h"
@@ -123,6 +124,9 @@ public:
             min((int)KFS::CHUNKSIZE, inDefaultSpaceReservationSize)),
           mMaxPartialBuffersCount(inMaxPartialBuffersCount),
           mPreferredAppendSize(min((int)KFS::CHUNKSIZE, inPreferredAppendSize)),
+          mMaxAppendBatchSize(0),
+          mAppendBatchSize(mPreferredAppendSize),
+          mAppendStartTime(0),
           mPathNamePos(0),
           mOpStartTime(0),
           mCurOpPtr(0),
@@ -154,7 +158,8 @@ public:
           mNoCSAccessCount(0),
           mClientPoolPtr(inClientPoolPtr),
           mChunkServerPtr(0),
-          mNetManager(mMetaServer.GetNetManager())
+          mNetManager(mMetaServer.GetNetManager()),
+          mTraceId(0)
     {
         Impl::Reset();
         mChunkServer.SetRetryConnectOnly(true);
@@ -410,6 +415,16 @@ public:
     void SetForcedAllocationInterval(
         int inInterval)
         { mForcedAllocationInterval = inInterval; }
+    void SetTraceId(
+        int64_t inTraceId)
+        { mTraceId = inTraceId; }
+    void SetMaxAppendBatchSize(
+        int inSize)
+    {
+        mMaxAppendBatchSize = min(int(kMaxAppendBatchSize), inSize);
+        mAppendBatchSize    = max(mPreferredAppendSize,
+            min(mAppendBatchSize, mMaxAppendBatchSize));
+    }
 
 protected:
     virtual void OpDone(
@@ -468,6 +483,7 @@ private:
     enum { kAgainRetryMinTime            = 4      };
     enum { kGetStatusOpMinTime           = 16     };
     enum { kAppendInactivityCheckTimeout = 3 * 60 };
+    enum { kMaxAppendBatchSize           = 4 << 20 };
 
     typedef KfsNetClient      ChunkServer;
     typedef vector<WriteInfo> WriteIds;
@@ -512,6 +528,9 @@ private:
     const int               mDefaultSpaceReservationSize;
     const int               mMaxPartialBuffersCount;
     const int               mPreferredAppendSize;
+    int                     mMaxAppendBatchSize;
+    int                     mAppendBatchSize;
+    int64_t                 mAppendStartTime;
     StringPos               mPathNamePos;
     time_t                  mOpStartTime;
     KfsOp*                  mCurOpPtr;
@@ -545,6 +564,7 @@ private:
     ClientPool*             mClientPoolPtr;
     ChunkServer*            mChunkServerPtr;
     NetManager&             mNetManager;
+    int64_t                 mTraceId;
 
     template<typename T> bool Dispatch(
         T&        inObj,
@@ -978,7 +998,7 @@ private:
             size_t(max(
                 mClosingFlag ? 0 : mDefaultSpaceReservationSize,
                 max(theSpaceNeeded, min(
-                    max(mPreferredAppendSize, mDefaultSpaceReservationSize),
+                    max(mAppendBatchSize, mDefaultSpaceReservationSize),
                     mBuffer.BytesConsumable()))) -
                 mSpaceAvailable
             );
@@ -1265,10 +1285,10 @@ private:
         }
         const int theTotal               = mBuffer.BytesConsumable();
         const int thePreferredAppendSize = min(mSpaceAvailable,
-            (mPreferredAppendSize < theTotal &&
-            (theTotal >> 1) < mPreferredAppendSize &&
-            theTotal - mPreferredAppendSize >= mWriteThreshold) ?
-            theTotal : mPreferredAppendSize
+            (mAppendBatchSize < theTotal &&
+            (theTotal >> 1) < mAppendBatchSize &&
+            theTotal - mAppendBatchSize >= mWriteThreshold) ?
+            theTotal : mAppendBatchSize
         );
         int theSum;
         while (mWriteQueue.size() > 1 &&
@@ -1283,6 +1303,7 @@ private:
             " pending: queue: " << mWriteQueue.size() <<
             " bytes: "          << theTotal <<
             " wthresh: "        << mWriteThreshold <<
+            " batch: "          << mAppendBatchSize <<
         KFS_LOG_EOM;
         QCASSERT(mBuffer.BytesConsumable() >= mAppendLength);
         Reset(mRecAppendOp);
@@ -1294,6 +1315,7 @@ private:
         mRecAppendOp.checksum      =
             ComputeBlockChecksum(&mBuffer, mAppendLength);
         mStats.mOpsRecAppendCount++;
+        mAppendStartTime = microseconds();
         SetAccessAndRequstAccessUpdate(mRecAppendOp);
         Enqueue(mRecAppendOp, &mBuffer);
     }
@@ -1338,6 +1360,10 @@ private:
         mPrevRecordAppendOpSeq  = inOp.seq;
         mStats.mAppendCount++;
         mStats.mAppendByteCount += theConsumed;
+        if (! inResetFlag) {
+            mStats.mAppendLatencyUsec += microseconds() - mAppendStartTime;
+            UpdateAppendBatchSize();
+        }
         ReportCompletion();
         if (inResetFlag || (mForcedAllocationInterval > 0 &&
                 (mStats.mOpsRecAppendCount % mForcedAllocationInterval) == 0)) {
@@ -1345,6 +1371,23 @@ private:
         }
         StartAppend();
     }
+    void UpdateAppendBatchSize()
+    {
+        if (mMaxAppendBatchSize <= mPreferredAppendSize) {
+            return;
+        }
+        // With one record append in flight, the data that arrived during the
+        // last append round trip is a measure of the arrival rate times the
+        // append latency. Sending it with the next append allows to keep up
+        // with the arrival rate, while the "preferred" size is used when the
+        // latency is low relative to the arrival rate. Grow right away in
+        // order to drain the backlog, and shrink gradually to avoid
+        // oscillations.
+        const int theTarget = max(mPreferredAppendSize,
+            min(mMaxAppendBatchSize, mBuffer.BytesConsumable()));
+        mAppendBatchSize = mAppendBatchSize <= theTarget ? theTarget :
+            max(theTarget, (mAppendBatchSize + theTarget) / 2);
+    }
     void SpaceRelease()
     {
         UpdateSpaceAvailable();
@@ -1676,6 +1719,7 @@ private:
     {
         mCurOpPtr    = &inOp;
         mOpStartTime = Now();
+        inOp.traceId = mTraceId;
         KFS_LOG_STREAM_DEBUG << mLogPrefix <<
             "+> " << (inMetaOpFlag ? "meta" : "" ) <<
             " " << inOp.Show() <<
@@ -2161,5 +2205,19 @@ WriteAppender::SetForcedAllocationInterval(
     return mImpl.SetForcedAllocationInterval(inInterval);
 }
 
+void
+WriteAppender::SetMaxAppendBatchSize(
+    int inSize)
+{
+    mImpl.SetMaxAppendBatchSize(inSize);
+}
+
+void
+WriteAppender::SetTraceId(
+    int64_t inTraceId)
+{
+    mImpl.SetTraceId(inTraceId);
+}
+
 }
 }
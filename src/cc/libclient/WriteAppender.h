@@ -78,7 +78,8 @@ public:
               mRetriesCount(0),
               mBufferCompactionCount(0),
               mAppendCount(0),
-              mAppendByteCount(0)
+              mAppendByteCount(0),
+              mAppendLatencyUsec(0)
             {}
         void Clear()
             { *this = Stats(); }
@@ -97,6 +98,7 @@ public:
             mBufferCompactionCount   += inStats.mBufferCompactionCount;
             mAppendCount             += inStats.mAppendCount;
             mAppendByteCount         += inStats.mAppendByteCount;
+            mAppendLatencyUsec       += inStats.mAppendLatencyUsec;
             return *this;
         }
         template<typename T>
@@ -115,6 +117,7 @@ public:
             inFunctor("BufferCompaction",   mBufferCompactionCount);
             inFunctor("AppendCount",        mAppendCount);
             inFunctor("AppendByteCount",    mAppendByteCount);
+            inFunctor("AppendLatencyUsec",  mAppendLatencyUsec);
         }
         Counter mMetaOpsQueuedCount;
         Counter mMetaOpsCancelledCount;
@@ -128,6 +131,7 @@ public:
         Counter mBufferCompactionCount;
         Counter mAppendCount;
         Counter mAppendByteCount;
+        Counter mAppendLatencyUsec;
     };
     typedef KfsNetClient MetaServer;
     WriteAppender(
@@ -184,6 +188,16 @@ public:
     bool GetPreAllocation() const;
     void SetForcedAllocationInterval(
         int inInterval);
+    // Upper limit of the adaptive record append batch size. When appends
+    // cannot keep up, the batch size grows with the data that accumulates
+    // during the append round trip, and shrinks back to the preferred
+    // append size as the backlog drains. Values less than or equal to the
+    // preferred append size disable adaptive batching (default).
+    void SetMaxAppendBatchSize(
+        int inSize);
+    // Trace id sent with all subsequent requests, 0 -- none.
+    void SetTraceId(
+        int64_t inTraceId);
 private:
     class Impl;
     Impl& mImpl;
@@ -48,6 +48,7 @@
 #include "utils.h"
 #include "KfsClient.h"
 #include "Monitor.h"
+#include "ClientPool.h"
 
 namespace KFS
 {
@@ -94,7 +95,9 @@ public:
         int           inIdleTimeoutSec,
         int           inMaxWriteSize,
         const string& inLogPrefix,
-        int64_t       inChunkServerInitialSeqNum)
+        int64_t       inChunkServerInitialSeqNum,
+        ClientPool*   inClientPoolPtr,
+        bool          inAlignPartialBlocksFlag)
         : QCRefCountedObj(),
           ITimeout(),
           KfsNetClient::OpOwner(),
@@ -122,6 +125,8 @@ public:
           mOffset(0),
           mOpenChunkBlockSize(CHUNKSIZE),
           mChunkServerInitialSeqNum(inChunkServerInitialSeqNum),
+          mClientPoolPtr(inClientPoolPtr),
+          mAlignPartialBlocksFlag(inAlignPartialBlocksFlag),
           mCompletionPtr(inCompletionPtr),
           mBuffer(),
           mLogPrefix(inLogPrefix),
@@ -131,8 +136,12 @@ public:
           mOpStartTime(0),
           mCompletionDepthCount(0),
           mStriperProcessCount(0),
-          mStriperPtr(0)
+          mStriperPtr(0),
+          mTraceId(0)
         { Writers::Init(mWriters); }
+    void SetTraceId(
+        int64_t inTraceId)
+        { mTraceId = inTraceId; }
     int Open(
         kfsFileId_t inFileId,
         const char* inFileNamePtr,
@@ -380,6 +389,8 @@ private:
             size_t         mBeginBlock;
             size_t         mEndBlock;
             time_t         mOpStartTime;
+            int64_t        mOpStartTimeUsec;
+            int            mPrefixSize;
             bool           mChecksumValidFlag;
             WriteOp*       mPrevPtr[1];
             WriteOp*       mNextPtr[1];
@@ -392,6 +403,8 @@ private:
                   mBeginBlock(0),
                   mEndBlock(0),
                   mOpStartTime(0),
+                  mOpStartTimeUsec(0),
+                  mPrefixSize(0),
                   mChecksumValidFlag(false)
                 { Queue::Init(*this); }
             void Delete(
@@ -496,6 +509,7 @@ private:
                 // cancel all pending ops by calling Stop()
                 false // inResetConnectionOnOpTimeoutFlag
               ),
+              mChunkServerPtr(0),
               mErrorCode(0),
               mRetryCount(0),
               mPendingCount(0),
@@ -520,6 +534,9 @@ private:
               mLeaseExpireTime(0),
               mChunkAccessExpireTime(0),
               mCSAccessExpireTime(0),
+              mBuffersWaitUsecs(0),
+              mTailPos(-1),
+              mTailBuffer(),
               mUpdateLeaseOp(0, -1, 0),
               mSleepTimer(inOuter.mNetManager, *this)
         {
@@ -573,6 +590,11 @@ private:
                 QCRTASSERT(mAllocOp.fileOffset == inOffset - theChunkOffset);
             }
             theSize = min(theSize, (int)(kChunkSize - theChunkOffset));
+            if (0 <= mTailPos && theChunkOffset <
+                    mTailPos + mTailBuffer.BytesConsumable() &&
+                    mTailPos < theChunkOffset + theSize) {
+                ClearTail(); // Overwrite.
+            }
             mOuter.mStats.mWriteCount++;
             mOuter.mStats.mWriteByteCount += theSize;
             QCASSERT(theSize > 0);
@@ -690,7 +712,7 @@ private:
                     }
                     return;
                 }
-                mChunkServer.Stop();
+                StopChunkServer();
                 if (mLastOpPtr == &mAllocOp) {
                     mOuter.mMetaServer.Cancel(mLastOpPtr, this);
                 }
@@ -710,7 +732,7 @@ private:
                 // Start from the beginning -- chunk allocation.
                 KFS_LOG_STREAM_DEBUG << mLogPrefix <<
                     "write lease expired: " <<
-                        mChunkServer.GetServerLocation() <<
+                        GetChunkServer().GetServerLocation() <<
                     " starting from chunk allocation, pending:" <<
                     " queue: " << (Queue::IsEmpty(mPendingQueue) ? "" : "not") <<
                         " empty" <<
@@ -755,6 +777,7 @@ private:
             mClosingFlag  = false;
             mErrorCode    = 0;
             mPendingCount = 0;
+            ClearTail();
         }
         Offset GetFileOffset() const
         {
@@ -798,6 +821,7 @@ private:
 
         Impl&          mOuter;
         ChunkServer    mChunkServer;
+        ChunkServer*   mChunkServerPtr;
         int            mErrorCode;
         int            mRetryCount;
         Offset         mPendingCount;
@@ -822,6 +846,9 @@ private:
         time_t         mLeaseExpireTime;
         time_t         mChunkAccessExpireTime;
         time_t         mCSAccessExpireTime;
+        int64_t        mBuffersWaitUsecs;
+        Offset         mTailPos;
+        IOBuffer       mTailBuffer;
         WritePrepareOp mUpdateLeaseOp;
         Timer          mSleepTimer;
         WriteOp*       mPendingQueue[1];
@@ -962,14 +989,26 @@ private:
 
             const bool theCSClearTextAllowedFlag =
                 mOuter.IsChunkServerClearTextAllowed();
-            mChunkServer.SetShutdownSsl(
+            // Object store block close might need longer op timeout, see
+            // CloseChunk(), therefore do not use shared connections.
+            ChunkServer* const thePrevPtr = mChunkServerPtr;
+            mChunkServerPtr = (mOuter.mClientPoolPtr &&
+                    0 <= mAllocOp.chunkVersion) ?
+                &mOuter.mClientPoolPtr->Get(mAllocOp.chunkServers[0]) :
+                &mChunkServer;
+            if (thePrevPtr && thePrevPtr != mChunkServerPtr &&
+                    thePrevPtr != &mChunkServer) {
+                thePrevPtr->CancelAllWithOwner(this);
+            }
+            ChunkServer& theChunkServer = *mChunkServerPtr;
+            theChunkServer.SetShutdownSsl(
                 mAllocOp.allowCSClearTextFlag &&
                 theCSClearTextAllowedFlag
             );
             if (mAllocOp.chunkServerAccessToken.empty() ||
                     mAllocOp.chunkAccess.empty()) {
-                mChunkServer.SetKey(0, 0, 0, 0);
-                mChunkServer.SetAuthContext(0);
+                theChunkServer.SetKey(0, 0, 0, 0);
+                theChunkServer.SetAuthContext(0);
                 if (! mAllocOp.chunkServerAccessToken.empty()) {
                     mWriteIdAllocOp.status    = -EINVAL;
                     mWriteIdAllocOp.statusMsg = "no chunk access";
@@ -985,7 +1024,7 @@ private:
                     mCSAccessExpireTime    = mChunkAccessExpireTime;
                 }
             } else {
-                mChunkServer.SetKey(
+                theChunkServer.SetKey(
                     mAllocOp.chunkServerAccessToken.data(),
                     mAllocOp.chunkServerAccessToken.size(),
                     mAllocOp.chunkServerAccessKey.GetPtr(),
@@ -1009,19 +1048,21 @@ private:
                 if (mAllocOp.allowCSClearTextFlag &&
                         theCSClearTextAllowedFlag &&
                         mWriteIdAllocOp.createChunkServerAccessFlag) {
-                    mWriteIdAllocOp.decryptKey = &mChunkServer.GetSessionKey();
+                    mWriteIdAllocOp.decryptKey =
+                        &theChunkServer.GetSessionKey();
                 }
-                if (! mChunkServer.GetAuthContext()) {
-                    mChunkServer.SetAuthContext(
+                if (! theChunkServer.GetAuthContext()) {
+                    theChunkServer.SetAuthContext(
                         mOuter.mMetaServer.GetAuthContext());
                 }
             }
             if (mWriteIdAllocOp.status == 0) {
                 const bool kCancelPendingOpsFlag = true;
-                if (mChunkServer.SetServer(
-                        mAllocOp.chunkServers[0],
-                        kCancelPendingOpsFlag,
-                        &mWriteIdAllocOp.statusMsg)) {
+                if (&theChunkServer != &mChunkServer ||
+                        mChunkServer.SetServer(
+                            mAllocOp.chunkServers[0],
+                            kCancelPendingOpsFlag,
+                            &mWriteIdAllocOp.statusMsg)) {
                     Enqueue(mWriteIdAllocOp);
                     return;
                 }
@@ -1058,7 +1099,7 @@ private:
             }
             if (0 < inOp.accessResponseValidForSec &&
                     ! inOp.chunkServerAccessId.empty()) {
-                mChunkServer.SetKey(
+                GetChunkServer().SetKey(
                     inOp.chunkServerAccessId.data(),
                     inOp.chunkServerAccessId.size(),
                     inOp.chunkServerAccessKey.GetPtr(),
@@ -1091,8 +1132,8 @@ private:
                 inOp.subjectId = mWriteIds.front().writeId;
             }
             if (inOp.createChunkServerAccessFlag &&
-                    mChunkServer.IsShutdownSsl()) {
-                inOp.decryptKey = &mChunkServer.GetSessionKey();
+                    GetChunkServer().IsShutdownSsl()) {
+                inOp.decryptKey = &GetChunkServer().GetSessionKey();
             }
             // Roll forward access time to indicate the request is in flight.
             // If op fails or times out, then write restarts from write id
@@ -1165,6 +1206,7 @@ private:
             while (! mSleepingFlag &&
                     mErrorCode == 0 &&
                     mAllocOp.chunkId > 0 &&
+                    ! IsBackPressure() &&
                     (theOpPtr = theIt.Next())) {
                 Write(*theOpPtr);
                 if (theOpDoneFlag) {
@@ -1176,6 +1218,9 @@ private:
         void Write(
             WriteOp& inWriteOp)
         {
+            if (mOuter.mAlignPartialBlocksFlag) {
+                AlignToTail(inWriteOp);
+            }
             while (inWriteOp.mBeginBlock < inWriteOp.mEndBlock) {
                 if (mInFlightBlocks.test(inWriteOp.mBeginBlock)) {
                     return; // Wait until the in flight write done.
@@ -1233,7 +1278,8 @@ private:
                     inWriteOp.mWritePrepareOp.checksums;
                 SetAccess(inWriteOp.mWriteSyncOp);
             }
-            inWriteOp.mOpStartTime = Now();
+            inWriteOp.mOpStartTime     = Now();
+            inWriteOp.mOpStartTimeUsec = microseconds();
             Queue::Remove(mPendingQueue, inWriteOp);
             Queue::PushBack(mInFlightQueue, inWriteOp);
             mOuter.mStats.mOpsWriteCount++;
@@ -1259,15 +1305,25 @@ private:
                     Monitor::ReportError(
                             Monitor::kWriteOpError,
                             mOuter.mMetaServer.GetServerLocation(),
-                            mChunkServer.GetServerLocation(),
+                            GetChunkServer().GetServerLocation(),
                             inOp.status);
                     mOpStartTime = inOp.mOpStartTime;
                     HandleError(inOp);
                 }
                 return;
             }
-            const Offset theOffset    = inOp.mWritePrepareOp.offset;
-            const Offset theDoneCount = inOp.mBuffer.BytesConsumable();
+            Monitor::ReportLatency(
+                    Monitor::kWriteOpLatency,
+                    mOuter.mMetaServer.GetServerLocation(),
+                    GetChunkServer().GetServerLocation(),
+                    microseconds() - inOp.mOpStartTimeUsec);
+            if (mOuter.mAlignPartialBlocksFlag) {
+                UpdateTail(inOp);
+            }
+            const Offset theOffset    =
+                inOp.mWritePrepareOp.offset + inOp.mPrefixSize;
+            const Offset theDoneCount =
+                inOp.mBuffer.BytesConsumable() - inOp.mPrefixSize;
             QCASSERT(
                 theDoneCount >= 0 &&
                 mPendingCount >= theDoneCount
@@ -1275,8 +1331,10 @@ private:
             mPendingCount -= theDoneCount;
             if (inOp.mWritePrepareOp.replyRequestedFlag) {
                 UpdateAccess(inOp.mWritePrepareOp);
+                mBuffersWaitUsecs = inOp.mWritePrepareOp.buffersWaitUsecs;
             } else {
                 UpdateAccess(inOp.mWriteSyncOp);
+                mBuffersWaitUsecs = inOp.mWriteSyncOp.buffersWaitUsecs;
             }
             inOp.Delete(mInFlightQueue);
             if (! ReportCompletion(theOffset, theDoneCount)) {
@@ -1442,7 +1500,7 @@ private:
         void Enqueue(
             KfsOp&    inOp,
             IOBuffer* inBufferPtr = 0)
-            { EnqueueSelf(inOp, inBufferPtr, &mChunkServer); }
+            { EnqueueSelf(inOp, inBufferPtr, &GetChunkServer()); }
         void EnqueueMeta(
             KfsOp&    inOp,
             IOBuffer* inBufferPtr = 0)
@@ -1456,13 +1514,100 @@ private:
             mWriteIds.clear();
             mAllocOp.chunkId = 0;
             mLastOpPtr       = 0;
-            mChunkServer.Stop();
+            StopChunkServer();
             QCASSERT(Queue::IsEmpty(mInFlightQueue));
             if (mSleepingFlag) {
                 mSleepTimer.RemoveTimeout();
                 mSleepingFlag = false;
             }
             mLeaseUpdatePendingFlag = false;
+            mBuffersWaitUsecs       = 0;
+        }
+        ChunkServer& GetChunkServer()
+        {
+            return (mChunkServerPtr ? *mChunkServerPtr : mChunkServer);
+        }
+        // Shared connection must not be reset, cancel only this writer's ops.
+        void StopChunkServer()
+        {
+            if (! mChunkServerPtr || &mChunkServer == mChunkServerPtr) {
+                mChunkServer.Stop();
+            } else {
+                mChunkServerPtr->CancelAllWithOwner(this);
+            }
+        }
+        // Small writes followed by flush result in writes that start in the
+        // middle of the checksum block. Prepend such writes with the already
+        // written head of the block, if available, in order to make the
+        // chunk server write the whole block, instead of reading and merging
+        // the partial block. The re-sent data is identical to the data already
+        // acknowledged by the chunk servers.
+        void ClearTail()
+        {
+            mTailPos = -1;
+            mTailBuffer.Clear();
+        }
+        void UpdateTail(
+            const WriteOp& inOp)
+        {
+            const int    kChecksumBlockSize = (int)CHECKSUM_BLOCKSIZE;
+            const int    theSize = inOp.mBuffer.BytesConsumable();
+            const Offset thePos  = inOp.mWritePrepareOp.offset;
+            const Offset theEnd  = thePos + theSize;
+            const int    theTail = (int)(theEnd % kChecksumBlockSize);
+            if (theTail <= 0 || theEnd - thePos < theTail) {
+                ClearTail();
+                return;
+            }
+            // Copy the data, in order not to hold references to the op
+            // buffers, which might be the caller's buffers.
+            IOBuffer theBuf;
+            theBuf.Copy(&inOp.mBuffer, theSize);
+            theBuf.Consume(theSize - theTail);
+            mTailBuffer.Clear();
+            for (IOBuffer::iterator theIt = theBuf.begin();
+                    theIt != theBuf.end();
+                    ++theIt) {
+                mTailBuffer.CopyIn(theIt->Consumer(), theIt->BytesConsumable());
+            }
+            mTailPos = theEnd - theTail;
+        }
+        void AlignToTail(
+            WriteOp& inWriteOp)
+        {
+            const int    kChecksumBlockSize = (int)CHECKSUM_BLOCKSIZE;
+            const Offset thePos      = inWriteOp.mWritePrepareOp.offset;
+            const int    theBlockOff = (int)(thePos % kChecksumBlockSize);
+            // Object store blocks do not support re-write.
+            if (theBlockOff <= 0 || mAllocOp.chunkVersion < 0 ||
+                    mTailPos != thePos - theBlockOff ||
+                    mTailBuffer.BytesConsumable() != theBlockOff ||
+                    mOuter.mMaxWriteSize <
+                        theBlockOff + inWriteOp.mBuffer.BytesConsumable()) {
+                return;
+            }
+            IOBuffer theBuf;
+            theBuf.Copy(&mTailBuffer, theBlockOff);
+            theBuf.Move(&inWriteOp.mBuffer);
+            inWriteOp.mBuffer.Move(&theBuf);
+            inWriteOp.mWritePrepareOp.offset = mTailPos;
+            inWriteOp.mPrefixSize += theBlockOff;
+            inWriteOp.mChecksumValidFlag = false;
+            inWriteOp.mWritePrepareOp.checksums.clear();
+            inWriteOp.InitBlockRange();
+            mOuter.mStats.mAlignedWriteCount++;
+        }
+        bool IsBackPressure() const
+        {
+            // Keep only one write in flight while chunk server reports
+            // buffer wait time larger than quarter of the op timeout, in
+            // order to avoid piling up writes that would likely time out.
+            return (
+                0 < mOuter.mOpTimeoutSec &&
+                int64_t(mOuter.mOpTimeoutSec) * (1000 * 1000 / 4) <
+                    mBuffersWaitUsecs &&
+                ! Queue::IsEmpty(mInFlightQueue)
+            );
         }
         static void Reset(
             KfsOp& inOp)
@@ -1507,9 +1652,10 @@ private:
                 " status: "               << inOp.status    <<
                 " msg: "                  << inOp.statusMsg <<
                 " op: "                   << inOp.Show()    <<
-                " current chunk server: " << mChunkServer.GetServerLocation() <<
-                " chunkserver: "          << (mChunkServer.IsDataSent() ?
-                    (mChunkServer.IsAllDataSent() ? "all" : "partial") :
+                " current chunk server: " <<
+                    GetChunkServer().GetServerLocation() <<
+                " chunkserver: "          << (GetChunkServer().IsDataSent() ?
+                    (GetChunkServer().IsAllDataSent() ? "all" : "partial") :
                     "no") << " data sent" <<
                 "\nRequest:\n"            << theOStream.str() <<
             KFS_LOG_EOM;
@@ -1680,6 +1826,7 @@ private:
             } else {
                 mOuter.mStats.mMetaOpsQueuedCount++;
             }
+            inOp.traceId = mOuter.mTraceId;
             if (! (inServerPtr ? *inServerPtr : mOuter.mMetaServer).Enqueue(
                     &inOp, this, inBufferPtr)) {
                 mOuter.InternalError(inServerPtr ?
@@ -1723,6 +1870,8 @@ private:
     Offset              mOffset;
     Offset              mOpenChunkBlockSize;
     int64_t             mChunkServerInitialSeqNum;
+    ClientPool* const   mClientPoolPtr;
+    const bool          mAlignPartialBlocksFlag;
     Completion*         mCompletionPtr;
     IOBuffer            mBuffer;
     string const        mLogPrefix;
@@ -1734,6 +1883,7 @@ private:
     int                 mCompletionDepthCount;
     int                 mStriperProcessCount;
     Striper*            mStriperPtr;
+    int64_t             mTraceId;
     ChunkWriter*        mWriters[1];
 
     void InternalError(
@@ -1832,6 +1982,7 @@ private:
         mTruncateOp.fid        = mFileId;
         mTruncateOp.fileOffset = theSize;
         mTruncateOp.status     = 0;
+        mTruncateOp.traceId    = mTraceId;
         KFS_LOG_STREAM_DEBUG << mLogPrefix <<
             "meta +> " << mTruncateOp.Show() <<
         KFS_LOG_EOM;
@@ -2174,7 +2325,9 @@ Writer::Writer(
     int                 inIdleTimeoutSec              /* = 5 * 30 */,
     int                 inMaxWriteSize                /* = 1 << 20 */,
     const char*         inLogPrefixPtr                /* = 0 */,
-    int64_t             inChunkServerInitialSeqNum    /* = 1 */)
+    int64_t             inChunkServerInitialSeqNum    /* = 1 */,
+    ClientPool*         inClientPoolPtr               /* = 0 */,
+    bool                inAlignPartialBlocksFlag      /* = false */)
     : mImpl(*new Writer::Impl(
         *this,
         inMetaServer,
@@ -2188,7 +2341,9 @@ Writer::Writer(
         inMaxWriteSize,
         (inLogPrefixPtr && inLogPrefixPtr[0]) ?
             (inLogPrefixPtr + string(" ")) : string(),
-        inChunkServerInitialSeqNum
+        inChunkServerInitialSeqNum,
+        inClientPoolPtr,
+        inAlignPartialBlocksFlag
     ))
 {
     mImpl.Ref();
@@ -2280,6 +2435,13 @@ Writer::GetErrorCode() const
     return mImpl.GetErrorCode();
 }
 
+void
+Writer::SetTraceId(
+    int64_t inTraceId)
+{
+    mImpl.SetTraceId(inTraceId);
+}
+
 int
 Writer::SetWriteThreshold(
     int inThreshold)
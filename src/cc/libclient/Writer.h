@@ -40,6 +40,8 @@ namespace client
 {
 using std::string;
 
+class ClientPool;
+
 // Kfs client write protocol state machine.
 class Writer
 {
@@ -84,7 +86,8 @@ public:
               mRetriesCount(0),
               mWriteCount(0),
               mWriteByteCount(0),
-              mBufferCompactionCount(0)
+              mBufferCompactionCount(0),
+              mAlignedWriteCount(0)
             {}
         void Clear()
             { *this = Stats(); }
@@ -102,6 +105,7 @@ public:
             mWriteCount            += inStats.mWriteCount;
             mWriteByteCount        += inStats.mWriteByteCount;
             mBufferCompactionCount += inStats.mBufferCompactionCount;
+            mAlignedWriteCount     += inStats.mAlignedWriteCount;
             return *this;
         }
         template<typename T>
@@ -119,6 +123,7 @@ public:
             inFunctor("Retries",          mRetriesCount);
             inFunctor("Writes" ,          mWriteCount);
             inFunctor("WriteBytes",       mWriteByteCount);
+            inFunctor("AlignedWrites",    mAlignedWriteCount);
         }
         Counter mMetaOpsQueuedCount;
         Counter mMetaOpsCancelledCount;
@@ -131,6 +136,7 @@ public:
         Counter mWriteCount;
         Counter mWriteByteCount;
         Counter mBufferCompactionCount;
+        Counter mAlignedWriteCount;
     };
     class Striper
     {
@@ -196,7 +202,9 @@ public:
         int         inIdleTimeoutSec           = 5 * 30,
         int         inMaxWriteSize             = 1 << 20,
         const char* inLogPrefixPtr             = 0,
-        int64_t     inChunkServerInitialSeqNum = 1);
+        int64_t     inChunkServerInitialSeqNum = 1,
+        ClientPool* inClientPoolPtr            = 0,
+        bool        inAlignPartialBlocksFlag   = false);
     virtual ~Writer();
     int Open(
         kfsFileId_t inFileId,
@@ -224,6 +232,9 @@ public:
     bool IsActive()  const;
     Offset GetPendingSize() const;
     int GetErrorCode() const;
+    // Trace id sent with all subsequent requests, 0 -- none.
+    void SetTraceId(
+        int64_t inTraceId);
     void Register(
         Completion* inCompletionPtr);
     bool Unregister(
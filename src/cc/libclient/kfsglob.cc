@@ -36,6 +36,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <glob.h>
+#include <fnmatch.h>
 #include <dirent.h>
 #include <errno.h>
 #include <sys/stat.h>
@@ -110,8 +111,12 @@ public:
               mDirToReusePtr(0),
               mOpenDirs(),
               mError(0),
+              mGlobFlags(0),
               mCwd(),
-              mTmpName()
+              mTmpName(),
+              mGlobPattern(),
+              mNamePattern(),
+              mDirComponent()
         {
             // Insure that the mutex constructor is invoked.
             GetMutexPtr();
@@ -153,6 +158,7 @@ public:
             if (*mCwd.rbegin() != '/') {
                 mCwd += "/";
             }
+            SetGlobPattern(inGlobPtr, inGlobFlags);
             inResultPtr->gl_closedir = &Glob::CloseDir;
             inResultPtr->gl_readdir  = &Glob::ReadDir;
             inResultPtr->gl_opendir  = &Glob::OpenDir;
@@ -202,7 +208,8 @@ public:
                 theDir.mDirContent,
                 kComputeFileSizeFlag,
                 kUpdateClientCacheFlag,
-                kFileIdAndTypeOnlyFalg
+                kFileIdAndTypeOnlyFalg,
+                GetNamePattern(theDirNamePtr)
             );
             if (mError != 0) {
                 mDirToReusePtr = &(theDir.Clear());
@@ -283,8 +290,12 @@ public:
         KfsOpenDir* mDirToReusePtr;
         OpenDirs    mOpenDirs;
         int         mError;
+        int         mGlobFlags;
         string      mCwd;
         string      mTmpName;
+        string      mGlobPattern;
+        string      mNamePattern;
+        string      mDirComponent;
 
 #ifdef KFS_GLOB_USE_THREAD_LOCAL
         static __thread Glob* sInstancePtr;
@@ -307,11 +318,108 @@ public:
                 delete *theIt;
             }
             mOpenDirs.clear();
-            mError = 0;
+            mError     = 0;
+            mGlobFlags = 0;
             mCwd.clear();
             mTmpName.clear();
+            mGlobPattern.clear();
+            mNamePattern.clear();
+            mDirComponent.clear();
             mClientPtr = 0;
         }
+        void SetGlobPattern(
+            const char* inGlobPtr,
+            int         inGlobFlags)
+        {
+            const int kTildeFlags = GLOB_TILDE
+#ifdef GLOB_TILDE_CHECK
+                | GLOB_TILDE_CHECK
+#endif
+            ;
+            mGlobFlags = inGlobFlags;
+            mGlobPattern.clear();
+            if (! inGlobPtr || ! *inGlobPtr ||
+                    ((inGlobFlags & GLOB_BRACE) != 0 &&
+                        strchr(inGlobPtr, '{')) ||
+                    ((inGlobFlags & kTildeFlags) != 0 && *inGlobPtr == '~')) {
+                // No server side filtering, the path names are not known.
+                return;
+            }
+            if (*inGlobPtr != '/') {
+                mGlobPattern = mCwd;
+                if (! strchr(inGlobPtr, '/')) {
+                    // glob() opens "." in this case.
+                    mGlobPattern += "./";
+                }
+            }
+            mGlobPattern += inGlobPtr;
+        }
+        static const char* NextComponent(
+            const char*& ioPtr,
+            size_t&      outLen)
+        {
+            while (*ioPtr == '/') {
+                ++ioPtr;
+            }
+            if (! *ioPtr) {
+                outLen = 0;
+                return 0;
+            }
+            const char* const theRetPtr = ioPtr;
+            while (*ioPtr && *ioPtr != '/') {
+                ++ioPtr;
+            }
+            outLen = ioPtr - theRetPtr;
+            return theRetPtr;
+        }
+        // Returns the glob pattern component that glob() matches against the
+        // entries of the directory being opened, in order to let the meta
+        // server return only the entries that can match. The directory path
+        // name components must match the preceding pattern components,
+        // otherwise, or if in doubt, no pattern is returned, and the meta
+        // server returns all entries. The server side filtering has to
+        // return a superset of the glob() matches, as glob() matches the
+        // returned entries again.
+        const char* GetNamePattern(
+            const char* inDirNamePtr)
+        {
+            if (mGlobPattern.empty()) {
+                return 0;
+            }
+            const int   theFlags   =
+                (mGlobFlags & GLOB_NOESCAPE) != 0 ? FNM_NOESCAPE : 0;
+            const char* thePatPtr  = mGlobPattern.c_str();
+            const char* theDirPtr  = inDirNamePtr;
+            size_t      thePatLen  = 0;
+            size_t      theDirLen  = 0;
+            for (; ;) {
+                const char* const theDirCompPtr =
+                    NextComponent(theDirPtr, theDirLen);
+                const char* const thePatCompPtr =
+                    NextComponent(thePatPtr, thePatLen);
+                if (! thePatCompPtr) {
+                    return 0;
+                }
+                mNamePattern.assign(thePatCompPtr, thePatLen);
+                if (mNamePattern == "..") {
+                    return 0;
+                }
+                if (! theDirCompPtr) {
+                    break;
+                }
+                mDirComponent.assign(theDirCompPtr, theDirLen);
+                if (mDirComponent == ".." || fnmatch(mNamePattern.c_str(),
+                        mDirComponent.c_str(), theFlags) != 0) {
+                    return 0;
+                }
+            }
+            if (mNamePattern == "." || *mNamePattern.rbegin() == '\\' ||
+                    (theFlags != 0 &&
+                        mNamePattern.find('\\') != string::npos)) {
+                return 0;
+            }
+            return mNamePattern.c_str();
+        }
         const char* GetAbsPathName(
             const char* inPathNamePtr)
         {
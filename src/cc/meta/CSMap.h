@@ -48,6 +48,11 @@ namespace KFS
 using std::vector;
 
 // chunkid to server(s) map
+// The map is not thread safe, including the const methods: Find() updates the
+// single entry lookup cache, and GetServers() / ServerCount() purge stale
+// server slots while a server removal scan is in progress. All access must be
+// serialized by the caller, i.e. done by the main thread or with the network
+// dispatch mutex held.
 class CSMap
 {
 public:
@@ -533,6 +538,7 @@ public:
           mServers(),
           mPendingRemove(),
           mNullSlots(),
+          mHibernatedChunkCounts(),
           mServerCount(0),
           mHibernatedCount(0),
           mRemoveServerScanPtr(0),
@@ -617,6 +623,10 @@ public:
         }
         mServers[server->GetIndex()].reset();
         idx = server->GetIndex();
+        if (mHibernatedChunkCounts.size() <= idx) {
+            mHibernatedChunkCounts.resize(idx + 1, 0);
+        }
+        mHibernatedChunkCounts[idx] = server->GetChunkCount();
         server->SetIndex(-1, mDebugValidateFlag);
         Validate();
         return true;
@@ -630,12 +640,40 @@ public:
             return false;
         }
         assert(! mServers[idx] && mServerCount > 0);
-        mPendingRemove.push_back(idx);
         mServerCount--;
+        if (mHibernatedChunkCounts[idx] <= 0) {
+            // No entries reference the slot, all chunks were either
+            // deleted, or removed with RemoveHibernated(), typically by
+            // the returned server chunk inventory processing. Re-use the
+            // slot right away, without full scan.
+            mNullSlots.push_back(idx);
+            Validate();
+            return true;
+        }
+        mHibernatedChunkCounts[idx] = 0;
+        mPendingRemove.push_back(idx);
         // Start or restart full scan.
         RemoveServerScanFirst();
         return true;
     }
+    // Removes hibernated server slot from the entry, if present.
+    bool RemoveHibernated(size_t idx, Entry& entry) {
+        if (/* idx < 0 ||*/ idx >= Entry::kMaxServers ||
+                ! IsHibernated(idx) || mServers[idx]) {
+            return false;
+        }
+        ValidateHosted(entry);
+        if (! entry.RemoveIndex(idx)) {
+            return false;
+        }
+        RemoveHibernatedHosted(idx);
+        return true;
+    }
+    // Returns number of chunks that still reference hibernated server slot.
+    size_t GetHibernatedChunkCount(size_t idx) const {
+        return ((idx < mHibernatedChunkCounts.size() && IsHibernated(idx)) ?
+            mHibernatedChunkCounts[idx] : size_t(0));
+    }
     size_t GetServerCount() const {
         return mServerCount;
     }
@@ -807,11 +845,13 @@ public:
         Entry* const entry = Find(chunkId);
         return (entry && SetState(*entry, state));
     }
-    bool SetState(Entry& entry, Entry::State state) {
+    // With front flag set the entry is inserted at the front of the state
+    // list, in order to process it ahead of the entries already in the list.
+    bool SetState(Entry& entry, Entry::State state, bool frontFlag = false) {
         if (! Validate(entry) || ! Validate(state)) {
             return false;
         }
-        SetStateSelf(entry, state);
+        SetStateSelf(entry, state, frontFlag);
         if (mRemoveServerScanPtr) {
             // The entry can potentially be missed by the
             // lazy full scan due to its list position change.
@@ -1047,6 +1087,7 @@ private:
     Servers        mServers;
     SlotIndexes    mPendingRemove;
     SlotIndexes    mNullSlots;
+    vector<size_t> mHibernatedChunkCounts;
     size_t         mServerCount;
     size_t         mHibernatedCount;
     Entry*         mRemoveServerScanPtr;
@@ -1162,9 +1203,19 @@ private:
                 } else {
                     srv->RemoveHosted();
                 }
+            } else if (IsHibernated(idx)) {
+                RemoveHibernatedHosted(idx);
             }
         }
     }
+    void RemoveHibernatedHosted(size_t idx) const {
+        size_t& count = const_cast<CSMap*>(this)->mHibernatedChunkCounts[idx];
+        if (count <= 0) {
+            InternalError("no hibernated hosted chunks");
+            return;
+        }
+        count--;
+    }
     void AddHosted(const ChunkServerPtr& server, const Entry& entry) const {
         if (mDebugValidateFlag) {
             server->AddHosted(
@@ -1247,9 +1298,10 @@ private:
             i++;
         }
         ValidateServersNoScan(entry);
-        // Enqueue replication check if servers were removed.
+        // Enqueue replication check if servers were removed. Chunks with at
+        // most one replica left go first.
         if (prev != cnt && entry.GetState() == Entry::kStateNone) {
-            SetStateSelf(entry, Entry::kStateCheckReplication);
+            SetStateSelf(entry, Entry::kStateCheckReplication, cnt <= 1);
         }
         return ret;
     }
@@ -1291,7 +1343,8 @@ private:
             RemoveServerScanNext();
         }
     }
-    void SetStateSelf(Entry& entry, Entry::State state) {
+    void SetStateSelf(Entry& entry, Entry::State state,
+            bool frontFlag = false) {
         const Entry::State prev = entry.GetState();
         assert(mCounts[prev] > 0);
         mCounts[prev]--;
@@ -1309,7 +1362,10 @@ private:
         entry.SetState(state);
         mCounts[state]++;
         assert(mCounts[state] > 0);
-        EList::Insert(entry, EList::GetPrev(mLists[state + 1]));
+        // Inserting at the front, before the current iteration position,
+        // does not affect the iteration in progress, if any.
+        EList::Insert(entry,
+            frontFlag ? mLists[state] : EList::GetPrev(mLists[state + 1]));
     }
     bool IsHibernated(size_t idx) const {
         return (mHibernatedIndexes[idx >> kHibernatedBitShift] &
@@ -41,6 +41,8 @@
 #include "LayoutManager.h"
 #include "common/MdStream.h"
 #include "common/FdWriter.h"
+#include "kfsio/checksum.h"
+#include "CheckpointRecord.h"
 
 #include <iostream>
 #include <iomanip>
@@ -60,9 +62,93 @@ string LASTCP(CPDIR + "/latest");   //!< most recent CP file (link)
 
 Checkpoint cp(CPDIR);
 
+/*
+ * Append binary record for the leaf, see CheckpointRecord.h.
+ */
+static void
+write_binary_record(CheckpointRecord::Writer& wr, const Meta& m,
+    fid_t& lastFid, chunkId_t& lastChunkId)
+{
+    switch (m.metaType()) {
+        case KFS_FATTR: {
+            const MetaFattr& fa = *refine<MetaFattr>(&m);
+            const int flags =
+                (fa.IsStriped() ? CheckpointRecord::kFattrStriped : 0) |
+                (fa.minSTier < kKfsSTierMax ?
+                    CheckpointRecord::kFattrTiers : 0) |
+                ((KFS_FILE == fa.type && 0 == fa.numReplicas) ?
+                    CheckpointRecord::kFattrNextChunkOffset : 0);
+            wr.Byte(CheckpointRecord::kTypeFattr)
+                .Byte(fa.type)
+                .Signed(fa.id() - lastFid)
+                .Signed(fa.type == KFS_DIR ? 0 : fa.chunkcount())
+                .Signed(fa.numReplicas)
+                .Signed(fa.mtime)
+                .Signed(fa.ctime - fa.mtime)
+                .Signed(fa.crtime - fa.mtime)
+                .Signed(fa.filesize)
+                .Byte(flags);
+            if (fa.IsStriped()) {
+                wr.Signed(fa.striperType)
+                    .Signed(fa.numStripes)
+                    .Signed(fa.numRecoveryStripes)
+                    .Signed(fa.stripeSize);
+            }
+            wr.Signed(fa.user)
+                .Signed(fa.group)
+                .Signed(fa.mode);
+            if ((flags & CheckpointRecord::kFattrTiers) != 0) {
+                wr.Signed(fa.minSTier)
+                    .Signed(fa.maxSTier);
+            }
+            if ((flags & CheckpointRecord::kFattrNextChunkOffset) != 0) {
+                wr.Signed(fa.nextChunkOffset());
+            }
+            lastFid = fa.id();
+            break;
+        }
+        case KFS_CHUNKINFO: {
+            const MetaChunkInfo& ci = *refine<MetaChunkInfo>(&m);
+            wr.Byte(CheckpointRecord::kTypeChunkInfo)
+                .Signed(ci.id() - lastFid)
+                .Signed(ci.chunkId - lastChunkId)
+                .Signed(ci.offset)
+                .Signed(ci.chunkVersion);
+            lastFid     = ci.id();
+            lastChunkId = ci.chunkId;
+            break;
+        }
+        case KFS_DENTRY: {
+            const MetaDentry& de = *refine<MetaDentry>(&m);
+            wr.Byte(CheckpointRecord::kTypeDentry)
+                .Signed(de.getDir() - lastFid)
+                .Signed(de.id())
+                .String(de.getName());
+            lastFid = de.getDir();
+            break;
+        }
+        default:
+            panic("checkpoint: invalid leaf type");
+            break;
+    }
+}
+
+int
+Checkpoint::write_binary_block(ostream& os, const string& buf)
+{
+    os << "bblock/" << (int)CheckpointRecord::kVersion << "/" <<
+        buf.size() << "/" <<
+        ComputeBlockChecksum(buf.data(), buf.size()) << "\n";
+    os.write(buf.data(), buf.size());
+    return (os.fail() ? -EIO : 0);
+}
+
 int
 Checkpoint::write_leaves(ostream& os)
 {
+    if (binaryformat) {
+        return write_binary_leaves(os);
+    }
     LeafIter li(metatree.firstLeaf(), 0);
     Meta *m = li.current();
     int status = 0;
@@ -75,6 +161,38 @@ Checkpoint::write_leaves(ostream& os)
     return status;
 }
 
+/*
+ * Write the leaves as blocks of binary records. The file and chunk id
+ * deltas are reset at the beginning of each block, so that each block can
+ * be decoded independently.
+ */
+int
+Checkpoint::write_binary_leaves(ostream& os)
+{
+    const size_t kBlockSize = 64 << 10;
+    string       buf;
+    buf.reserve(kBlockSize + (8 << 10));
+    fid_t        lastFid     = 0;
+    chunkId_t    lastChunkId = 0;
+    int          status      = 0;
+    for (LeafIter li(metatree.firstLeaf(), 0);
+            status == 0 && li.parent() && li.current();
+            li.next()) {
+        CheckpointRecord::Writer wr(buf);
+        write_binary_record(wr, *li.current(), lastFid, lastChunkId);
+        if (kBlockSize <= buf.size()) {
+            status      = write_binary_block(os, buf);
+            lastFid     = 0;
+            lastChunkId = 0;
+            buf.clear();
+        }
+    }
+    if (status == 0 && ! buf.empty()) {
+        status = write_binary_block(os, buf);
+    }
+    return status;
+}
+
 /*
  * At system startup, take a CP if the file that corresponds to the
  * latest CP doesn't exist.
@@ -60,7 +60,8 @@ public:
           mutations(0),
           cpcount(0),
           writesync(true),
-          writebuffersize(16 << 20)
+          writebuffersize(16 << 20),
+          binaryformat(false)
         {}
     void setCPDir(const string& d)
         { cpdir = d; }
@@ -75,6 +76,9 @@ public:
     void setWriteSyncFlag(bool flag) { writesync = flag; }
     size_t getWriteBufferSize() const { return writebuffersize; }
     void setWriteBufferSize(size_t size) { writebuffersize = size; }
+    //!< write meta tree leaves as binary records, see CheckpointRecord.h
+    bool getBinaryFormatFlag() const { return binaryformat; }
+    void setBinaryFormatFlag(bool flag) { binaryformat = flag; }
 private:
     string  cpdir;       //!< dir for CP files
     string  cpname;      //!< name of CP file
@@ -82,10 +86,13 @@ private:
     int64_t cpcount;     //!< number of CP's since startup
     bool    writesync;
     size_t  writebuffersize;
+    bool    binaryformat;
 
     string cpfile(seq_t highest)    //!< generate the next file name
         { return makename(cpdir, "chkpt", highest); }
     int write_leaves(ostream& os);
+    int write_binary_leaves(ostream& os);
+    int write_binary_block(ostream& os, const string& buf);
 private:
     // No copy.
     Checkpoint(const Checkpoint&);
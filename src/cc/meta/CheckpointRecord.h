@@ -0,0 +1,160 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Binary checkpoint record encoding.
+//
+// With binary checkpoint format the meta tree leaves are written as blocks of
+// binary records. Each block is preceded by the text entry
+// bblock/<version>/<length>/<crc32>
+// followed by <length> bytes of records. Each record starts with one byte
+// record type, followed by the fields encoded as variable length integers:
+// 7 bits per byte, least significant group first, high bit set on all but
+// the last byte. Signed values are zig zag encoded, strings are length
+// prefixed. File ids are encoded as the difference with the file id of the
+// previous record in the block, and chunk ids as the difference with the
+// previous chunk id in the block, as both mostly increase in tree order.
+//
+//----------------------------------------------------------------------------
+
+#ifndef META_CHECKPOINTRECORD_H
+#define META_CHECKPOINTRECORD_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+
+namespace KFS
+{
+using std::string;
+
+class CheckpointRecord
+{
+public:
+    enum { kVersion = 1 };
+    enum Type
+    {
+        kTypeFattr     = 'a',
+        kTypeChunkInfo = 'c',
+        kTypeDentry    = 'd'
+    };
+    enum
+    {
+        kFattrStriped         = 1,
+        kFattrTiers           = 2,
+        kFattrNextChunkOffset = 4
+    };
+    static uint64_t ToUnsigned(int64_t val)
+        { return (((uint64_t)val << 1) ^ (uint64_t)(val >> 63)); }
+    static int64_t ToSigned(uint64_t val)
+        { return (int64_t)((val >> 1) ^ (~(val & 1) + 1)); }
+
+    class Writer
+    {
+    public:
+        Writer(string& buf)
+            : mBuf(buf)
+            {}
+        Writer& Byte(int val)
+        {
+            mBuf.push_back((char)val);
+            return *this;
+        }
+        Writer& Unsigned(uint64_t val)
+        {
+            char  tmp[10];
+            char* p = tmp;
+            while (0x80 <= val) {
+                *p++ = (char)(val | 0x80);
+                val >>= 7;
+            }
+            *p++ = (char)val;
+            mBuf.append(tmp, p - tmp);
+            return *this;
+        }
+        Writer& Signed(int64_t val)
+            { return Unsigned(ToUnsigned(val)); }
+        Writer& String(const string& str)
+        {
+            Unsigned(str.size());
+            mBuf.append(str);
+            return *this;
+        }
+    private:
+        string& mBuf;
+    };
+
+    class Reader
+    {
+    public:
+        Reader(const char* ptr, const char* end)
+            : mPtr(reinterpret_cast<const unsigned char*>(ptr)),
+              mEnd(reinterpret_cast<const unsigned char*>(end)),
+              mOkFlag(true)
+            {}
+        bool IsOk() const
+            { return mOkFlag; }
+        bool IsEmpty() const
+            { return (mEnd <= mPtr); }
+        int Byte()
+        {
+            if (mEnd <= mPtr) {
+                mOkFlag = false;
+                return -1;
+            }
+            return *mPtr++;
+        }
+        uint64_t Unsigned()
+        {
+            uint64_t ret   = 0;
+            int      shift = 0;
+            while (mPtr < mEnd && shift < 64) {
+                const unsigned int c = *mPtr++;
+                ret |= (uint64_t)(c & 0x7F) << shift;
+                if ((c & 0x80) == 0) {
+                    return ret;
+                }
+                shift += 7;
+            }
+            mOkFlag = false;
+            return 0;
+        }
+        int64_t Signed()
+            { return ToSigned(Unsigned()); }
+        bool String(string& str)
+        {
+            const uint64_t len = Unsigned();
+            if (! mOkFlag || (uint64_t)(mEnd - mPtr) < len) {
+                mOkFlag = false;
+                return false;
+            }
+            str.assign(reinterpret_cast<const char*>(mPtr), (size_t)len);
+            mPtr += len;
+            return true;
+        }
+    private:
+        const unsigned char*       mPtr;
+        const unsigned char* const mEnd;
+        bool                       mOkFlag;
+    };
+};
+
+} // namespace KFS
+
+#endif /* META_CHECKPOINTRECORD_H */
@@ -106,6 +106,7 @@ public:
           mCurRackId(-1),
           mCandidatesInRacksCount(0),
           mMaxReplicationsPerNode(0),
+          mSlavePlacementScale(int64_t(1) << kSlaveScaleFracBits),
           mMaxSpaceUtilizationThreshold(0),
           mCurSTierMaxSpaceUtilizationThreshold(0),
           mForReplicationFlag(false),
@@ -731,6 +732,7 @@ private:
     RackId           mCurRackId;
     int64_t          mCandidatesInRacksCount;
     int              mMaxReplicationsPerNode;
+    int64_t          mSlavePlacementScale;
     double           mMaxSpaceUtilizationThreshold;
     double           mCurSTierMaxSpaceUtilizationThreshold;
     bool             mForReplicationFlag;
@@ -826,8 +828,7 @@ private:
         if (mSortCandidatesByLoadAvgFlag) {
             int64_t load = srv.GetLoadAvg();
             if (! srv.CanBeChunkMaster()) {
-                load = (load * mLayoutManager.GetSlavePlacementScale()
-                ) >> kSlaveScaleFracBits;
+                load = (load * mSlavePlacementScale) >> kSlaveScaleFracBits;
             }
             return (load + kLoadAvgFloor);
         }
@@ -857,7 +858,15 @@ private:
         mLoadAvgSum   = 0;
         mCandidatePos = 0;
         mCandidates.clear();
-        int cnt = 0;
+        if (candidatesCount <= 0) {
+            return;
+        }
+        // Get the slave scale once per scan, instead of once per server.
+        if (! mSortBySpaceUtilizationFlag && mSortCandidatesByLoadAvgFlag) {
+            mSlavePlacementScale = mLayoutManager.GetSlavePlacementScale();
+        }
+        const bool excludesFlag = ! mServerExcludes.IsEmpty();
+        int        cnt          = 0;
         for (typename Servers::const_iterator it = sources.begin();
                 cnt < candidatesCount && it != sources.end();
                 ++it) {
@@ -866,7 +875,7 @@ private:
                 continue;
             }
             cnt++;
-            if (mServerExcludes.Find(&srv)) {
+            if (excludesFlag && mServerExcludes.Find(&srv)) {
                 continue;
             }
             const int64_t load = GetLoad(srv);
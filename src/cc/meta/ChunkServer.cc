@@ -196,6 +196,7 @@ int ChunkServer::sReplicationTimeout   = 510;
 int ChunkServer::sRequestTimeout       = 600;
 int ChunkServer::sMetaClientPort       = 0;
 size_t ChunkServer::sMaxChunksToEvacuate  = 2 << 10; // Max queue size
+int ChunkServer::sMaxChunkDeletesInFlight = 256;
 // sHeartbeatInterval * sSrvLoadSamplerSampleCount -- boxcar FIR filter
 // if sSrvLoadSamplerSampleCount > 0
 int ChunkServer::sSrvLoadSamplerSampleCount = 0;
@@ -212,6 +213,8 @@ int64_t ChunkServer::sHelloBytesInFlight  = 0;
 int64_t ChunkServer::sMaxHelloBufferBytes = 256 << 20;
 int ChunkServer::sEvacuateRateUpdateInterval = 120;
 size_t ChunkServer::sChunkDirsCount = 0;
+int ChunkServer::sFlushBatchDepth = 0;
+ChunkServer::FlushPendingList ChunkServer::sFlushPending;
 
 const int kMaxReadAhead             = 4 << 10;
 // Bigger than the default MAX_RPC_HEADER_LEN: max heartbeat size.
@@ -252,6 +255,9 @@ void ChunkServer::SetParameters(const Properties& prop, int clientPort)
     sMaxChunksToEvacuate = max(size_t(1), prop.getValue(
         "metaServer.chunkServer.maxChunksToEvacuate",
         sMaxChunksToEvacuate));
+    sMaxChunkDeletesInFlight = prop.getValue(
+        "metaServer.chunkServer.maxChunkDeletesInFlight",
+        sMaxChunkDeletesInFlight);
     if (clientPort > 0) {
         sMetaClientPort = clientPort;
     }
@@ -305,6 +311,7 @@ ChunkServer::NewChunkInTier(kfsSTier_t tier)
     mAllocSpace += CHUNKSIZE;
     UpdateChunkWritesPerDrive(mNumChunkWrites + 1, mNumWritableDrives);
     gLayoutManager.UpdateSrvLoadAvg(*this, 0, mStorageTiersInfoDelta);
+    gLayoutManager.ChunkPlaced(*this);
 }
 
 /* static */ KfsCallbackObj*
@@ -341,6 +348,7 @@ ChunkServer::ChunkServer(const NetConnectionPtr& conn, const string& peerName)
       mCanBeChunkMaster(false),
       mIsRetiring(false),
       mRetireStartTime(0),
+      mRetireStartChunkCount(0),
       mLastHeard(),
       mChunksToMove(),
       mChunksToEvacuate(),
@@ -356,6 +364,9 @@ ChunkServer::ChunkServer(const NetConnectionPtr& conn, const string& peerName)
       mOneOverTotalFsSpace(0),
       mUsedSpace(0),
       mAllocSpace(0),
+      mPlacementWindowStart(0),
+      mPlacedCount(0),
+      mPrevPlacedCount(0),
       mNumChunks(0),
       mNumDrives(0),
       mNumWritableDrives(0),
@@ -412,7 +423,10 @@ ChunkServer::ChunkServer(const NetConnectionPtr& conn, const string& peerName)
       mPendingResponseOpsHeadPtr(0),
       mPendingResponseOpsTailPtr(0),
       mStorageTiersInfo(),
-      mStorageTiersInfoDelta()
+      mStorageTiersInfoDelta(),
+      mFlushPendingFlag(false),
+      mChunkDeletesInFlight(0),
+      mPendingChunkDeletes()
 {
     assert(mNetConnection);
     ChunkServersList::Init(*this);
@@ -854,6 +868,10 @@ ChunkServer::ForceDown()
     gLayoutManager.UpdateSrvLoadAvg(*this, delta, mStorageTiersInfoDelta);
     gLayoutManager.UpdateObjectsCount(*this, objDelta, wrObjDelta);
     UpdateChunkWritesPerDrive(0, 0);
+    // Discard queued deletes prior to failing the deletes in flight. The
+    // chunks that remain on the chunk server will be deleted as stale when
+    // it reconnects.
+    PendingChunkDeletes().swap(mPendingChunkDeletes);
     FailDispatchedOps("chunk server down");
     assert(sChunkDirsCount >= mChunkDirInfos.size());
     sChunkDirsCount -= min(sChunkDirsCount, mChunkDirInfos.size());
@@ -922,6 +940,10 @@ ChunkServer::Error(const char* errorMsg)
     gLayoutManager.UpdateSrvLoadAvg(*this, delta, mStorageTiersInfoDelta);
     gLayoutManager.UpdateObjectsCount(*this, objDelta, wrObjDelta);
     UpdateChunkWritesPerDrive(0, 0);
+    // Discard queued deletes prior to failing the deletes in flight. The
+    // chunks that remain on the chunk server will be deleted as stale when
+    // it reconnects.
+    PendingChunkDeletes().swap(mPendingChunkDeletes);
     FailDispatchedOps(errorMsg);
     assert(sChunkDirsCount >= mChunkDirInfos.size());
     sChunkDirsCount -= min(sChunkDirsCount, mChunkDirInfos.size());
@@ -1551,16 +1573,13 @@ ChunkServer::HandleReply(IOBuffer* iobuf, int msgLen)
     // We got a response for a command we previously
     // sent.  So, match the response to its request and
     // resume request processing.
-    Properties prop;
-    const bool ok = ParseResponse(mIStream.Set(iobuf, msgLen), prop);
-    mIStream.Reset();
-    if (! ok) {
+    // The response view references the io buffer or the parse buffer, the
+    // header must not be consumed until the view is no longer used.
+    PropertiesView view;
+    if (! ParseResponse(*iobuf, msgLen, view)) {
         return -1;
     }
-    // Message is ready to be pushed down.  So remove it.
-    iobuf->Consume(msgLen);
-
-    const seq_t             cseq = prop.getValue("Cseq", (seq_t) -1);
+    const seq_t             cseq = view.GetValue("Cseq", (seq_t) -1);
     MetaChunkRequest* const op   = FindMatchingRequest(cseq);
     if (! op) {
         // Most likely op was timed out, or chunk server sent response
@@ -1568,37 +1587,51 @@ ChunkServer::HandleReply(IOBuffer* iobuf, int msgLen)
         KFS_LOG_STREAM_INFO << GetServerLocation() <<
             " unable to find command for response cseq: " << cseq <<
         KFS_LOG_EOM;
+        view.Clear();
+        iobuf->Consume(msgLen);
         return 0;
     }
 
     mLastHeard = TimeNow();
-    op->statusMsg = prop.getValue("Status-message", "");
-    op->status    = prop.getValue("Status",         -1);
+    op->statusMsg = view.GetValue("Status-message", string());
+    op->status    = view.GetValue("Status",         -1);
     if (op->status < 0) {
         op->status = -KfsToSysErrno(-op->status);
     }
-    op->handleReply(prop);
-    if (op->op == META_CHUNK_HEARTBEAT) {
-        mTotalSpace        = prop.getValue("Total-space",           int64_t(0));
-        mTotalFsSpace      = prop.getValue("Total-fs-space",       int64_t(-1));
-        mUsedSpace         = prop.getValue("Used-space",            int64_t(0));
-        mNumChunks         = prop.getValue("Num-chunks",                     0);
-        mNumDrives         = prop.getValue("Num-drives",                     0);
-        mUptime            = prop.getValue("Uptime",                int64_t(0));
-        mLostChunks        = prop.getValue("Chunk-lost",            int64_t(0));
+    Properties prop;
+    view.CopyTo(prop);
+    if (op->op != META_CHUNK_HEARTBEAT) {
+        view.Clear();
+        // Message is ready to be pushed down.  So remove it.
+        iobuf->Consume(msgLen);
+        op->handleReply(prop);
+    } else {
+        mTotalSpace        = view.GetValue("Total-space",           int64_t(0));
+        mTotalFsSpace      = view.GetValue("Total-fs-space",       int64_t(-1));
+        mUsedSpace         = view.GetValue("Used-space",            int64_t(0));
+        mNumChunks         = view.GetValue("Num-chunks",                     0);
+        mNumDrives         = view.GetValue("Num-drives",                     0);
+        mUptime            = view.GetValue("Uptime",                int64_t(0));
+        mLostChunks        = view.GetValue("Chunk-lost",            int64_t(0));
         mNumCorruptChunks  = max(mNumCorruptChunks,
-            prop.getValue("Chunk-corrupted", int64_t(0)));
-        mNumAppendsWithWid = prop.getValue("Num-appends-with-wids", int64_t(0));
-        mEvacuateCnt       = prop.getValue("Evacuate",              int64_t(-1));
-        mEvacuateBytes     = prop.getValue("Evacuate-bytes",        int64_t(-1));
-        mEvacuateDoneCnt   = prop.getValue("Evacuate-done",         int64_t(-1));
-        mEvacuateDoneBytes = prop.getValue("Evacuate-done-bytes",   int64_t(-1));
-        mEvacuateInFlight  = prop.getValue("Evacuate-in-flight",    int64_t(-1));
-        const int     numWrChunks = prop.getValue("Num-writable-chunks", 0);
-        const int     numWrDrives = prop.getValue("Num-wr-drives", mNumDrives);
-        const int64_t numObjs     = prop.getValue("Num-objs", int64_t(0));
+            view.GetValue("Chunk-corrupted", int64_t(0)));
+        mNumAppendsWithWid = view.GetValue("Num-appends-with-wids", int64_t(0));
+        mEvacuateCnt       = view.GetValue("Evacuate",              int64_t(-1));
+        mEvacuateBytes     = view.GetValue("Evacuate-bytes",        int64_t(-1));
+        mEvacuateDoneCnt   = view.GetValue("Evacuate-done",         int64_t(-1));
+        mEvacuateDoneBytes = view.GetValue("Evacuate-done-bytes",   int64_t(-1));
+        mEvacuateInFlight  = view.GetValue("Evacuate-in-flight",    int64_t(-1));
+        const int     numWrChunks = view.GetValue("Num-writable-chunks", 0);
+        const int     numWrDrives = view.GetValue("Num-wr-drives", mNumDrives);
+        const int64_t numObjs     = view.GetValue("Num-objs", int64_t(0));
         const int64_t numWrObjs   =
-            min(numObjs, prop.getValue("Num-wr-objs", int64_t(0)));
+            min(numObjs, view.GetValue("Num-wr-objs", int64_t(0)));
+        const int64_t srvLoad     = view.GetValue(
+            PropertiesView::Token(sSrvLoadPropName.data(),
+                sSrvLoadPropName.size()), int64_t(0));
+        view.Clear();
+        iobuf->Consume(msgLen);
+        op->handleReply(prop);
         if (mNumWrObjects != numWrObjs || numObjs != mNumObjects) {
             gLayoutManager.UpdateObjectsCount(*this,
                 numObjs - mNumObjects, numWrObjs - mNumWrObjects);
@@ -1648,7 +1681,6 @@ ChunkServer::HandleReply(IOBuffer* iobuf, int msgLen)
             mPrevEvacuateDoneCnt        = mEvacuateDoneCnt;
             mPrevEvacuateDoneBytes      = mEvacuateDoneBytes;
         }
-        const int64_t srvLoad = prop.getValue(sSrvLoadPropName, int64_t(0));
         int64_t loadAvg;
         if (sSrvLoadSamplerSampleCount > 0) {
             if (mSrvLoadSampler.GetMaxSamples() != sSrvLoadSamplerSampleCount) {
@@ -1717,27 +1749,48 @@ ChunkServer::HandleReply(IOBuffer* iobuf, int msgLen)
 /// Status: <status> \r\n
 /// {<other header/value pair>\r\n}*\r\n
 ///
-/// @param[in] buf Buffer containing the response
-/// @param[in] bufLen length of buf
+/// @param[in] iobuf Buffer containing the response
+/// @param[in] msgLen length of the response header
 /// @param[out] prop  Properties object with the response header/values
 ///
 bool
-ChunkServer::ParseResponse(istream& is, Properties &prop)
+ChunkServer::ParseResponse(const IOBuffer& iobuf, int msgLen,
+    PropertiesView& view)
 {
-    string token;
-    is >> token;
+    // Main thread's buffer.
+    static char sTmpBuf[kMaxRequestResponseHeader];
+
+    if (msgLen <= 0 || kMaxRequestResponseHeader < msgLen) {
+        KFS_LOG_STREAM_ERROR << GetServerLocation() <<
+            " invalid response header length: " << msgLen <<
+        KFS_LOG_EOM;
+        return false;
+    }
+    // Heartbeat responses are the bulk of the chunk server replies, and
+    // carry a few dozen fields each. Parse directly from the contiguous
+    // buffer into the properties view, instead of going through istream
+    // and getline per line. Copy only if the header spans more than one io
+    // buffer.
+    int               len = msgLen;
+    const char*       ptr = iobuf.CopyOutOrGetBufPtr(sTmpBuf, len);
+    const char* const end = ptr + len;
+    assert(len == msgLen);
+    while (ptr < end && (*ptr & 0xFF) <= ' ') {
+        ++ptr;
+    }
     // Response better start with OK
-    if (token.compare("OK") != 0) {
-        int maxLines = 32;
-        do {
-            KFS_LOG_STREAM_ERROR << GetServerLocation() <<
-                " bad response header: " << token <<
-            KFS_LOG_EOM;
-        } while (--maxLines > 0 && getline(is, token));
+    if (end - ptr < 2 || ptr[0] != 'O' || ptr[1] != 'K' ||
+            (ptr + 2 < end && ' ' < (ptr[2] & 0xFF))) {
+        const char* const hdrEnd = min(end, ptr + 32 * 80);
+        KFS_LOG_STREAM_ERROR << GetServerLocation() <<
+            " bad response header: " <<
+                string(ptr, hdrEnd - ptr) <<
+        KFS_LOG_EOM;
         return false;
     }
+    ptr += 2;
     const char separator = ':';
-    prop.loadProperties(is, separator);
+    view.Load(ptr, end - ptr, separator);
     return true;
 }
 
@@ -1811,8 +1864,43 @@ ChunkServer::EnqueueSelf(MetaChunkRequest* r)
     IOBuffer& buf = mNetConnection->GetOutBuffer();
     ChunkServerRequest(*r, mOstream.Set(buf), buf);
     mOstream.Reset();
-    if (mRecursionCount <= 0) {
+    StartFlush();
+}
+
+void
+ChunkServer::StartFlush()
+{
+    if (0 < mRecursionCount) {
+        return; // Flush at the end of HandleRequest().
+    }
+    if (sFlushBatchDepth <= 0) {
         mNetConnection->StartFlush();
+        return;
+    }
+    if (! mFlushPendingFlag && mNetConnection->CanStartFlush()) {
+        mFlushPendingFlag = true;
+        sFlushPending.push_back(shared_from_this());
+    }
+}
+
+/* static */ void
+ChunkServer::FlushPending()
+{
+    if (sFlushPending.empty()) {
+        return;
+    }
+    // Flush can invoke the error handler, that might schedule more RPCs, and
+    // put the server down, thus iterate over a copy.
+    FlushPendingList servers;
+    servers.swap(sFlushPending);
+    for (FlushPendingList::const_iterator it = servers.begin();
+            it != servers.end();
+            ++it) {
+        ChunkServer& srv = **it;
+        srv.mFlushPendingFlag = false;
+        if (! srv.mDown && srv.mNetConnection) {
+            srv.StartFlush();
+        }
     }
 }
 
@@ -1902,11 +1990,45 @@ ChunkServer::DeleteChunkVers(chunkId_t chunkId, seq_t chunkVersion)
     if (0 <= chunkVersion) {
         mChunksToEvacuate.Erase(chunkId);
     }
+    if (0 <= chunkVersion) {
+        // Limit the number of chunk deletes in flight, in order to spread
+        // large directory removal over time, and not to flood the chunk
+        // server with delete RPCs, which would delay all other RPCs.
+        if (0 < sMaxChunkDeletesInFlight &&
+                sMaxChunkDeletesInFlight <= mChunkDeletesInFlight &&
+                ! mDown) {
+            mPendingChunkDeletes.push_back(make_pair(chunkId, chunkVersion));
+            return 0;
+        }
+        mChunkDeletesInFlight++;
+    }
     Enqueue(new MetaChunkDelete(
         NextSeq(), shared_from_this(), chunkId, chunkVersion));
     return 0;
 }
 
+void
+ChunkServer::ChunkDeleteDone(const MetaChunkDelete& req)
+{
+    if (req.chunkVersion < 0) {
+        return;
+    }
+    assert(0 < mChunkDeletesInFlight);
+    mChunkDeletesInFlight--;
+    if (mDown || ! mNetConnection || ! mNetConnection->IsGood()) {
+        return;
+    }
+    while (! mPendingChunkDeletes.empty() &&
+            (sMaxChunkDeletesInFlight <= 0 ||
+                mChunkDeletesInFlight < sMaxChunkDeletesInFlight)) {
+        const pair<chunkId_t, seq_t> del = mPendingChunkDeletes.front();
+        mPendingChunkDeletes.pop_front();
+        mChunkDeletesInFlight++;
+        Enqueue(new MetaChunkDelete(
+            NextSeq(), shared_from_this(), del.first, del.second));
+    }
+}
+
 int
 ChunkServer::GetChunkSize(fid_t fid, chunkId_t chunkId, seq_t chunkVersion,
     const string &pathname, bool retryFlag)
@@ -2073,6 +2195,7 @@ ChunkServer::SetRetiring()
 {
     mIsRetiring = true;
     mRetireStartTime = TimeNow();
+    mRetireStartChunkCount = GetChunkCount();
     mChunksToEvacuate.Clear();
     KFS_LOG_STREAM_INFO << GetServerLocation() <<
         " initiation of retire for " << mNumChunks << " chunks" <<
@@ -2257,13 +2380,19 @@ ChunkServer::GetRetiringStatus(ostream &os)
     if (! mIsRetiring) {
         return;
     }
+    const size_t numLeft = GetChunkCount();
+    const time_t elapsed = TimeNow() - mRetireStartTime;
+    const double cntRate = (elapsed > 0 && numLeft < mRetireStartChunkCount) ?
+        (mRetireStartChunkCount - numLeft) / double(elapsed) : double(0);
     os <<
     "s="         << mLocation.hostname <<
     ", p="       << mLocation.port <<
     ", started=" << DisplayDateTime(
         int64_t(mRetireStartTime) * 1000 * 1000) <<
-    ", numLeft=" << GetChunkCount() <<
-    ", numDone=" << (mNumChunks - GetChunkCount()) <<
+    ", numLeft=" << numLeft <<
+    ", numDone=" << (mNumChunks - numLeft) <<
+    ", cSec="    << cntRate <<
+    ", eta="     << (cntRate > 0 ? numLeft / cntRate : double(0)) <<
     "\t";
 }
 
@@ -2377,9 +2506,7 @@ ChunkServer::SendResponse(MetaRequest* op)
     IOBuffer& buf = mNetConnection->GetOutBuffer();
     op->response(mOstream.Set(buf), buf);
     mOstream.Reset();
-    if (mRecursionCount <= 0) {
-        mNetConnection->StartFlush();
-    }
+    StartFlush();
     return true;
 }
 
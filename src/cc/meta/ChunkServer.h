@@ -45,6 +45,7 @@
 #include "qcdio/QCDLList.h"
 #include "common/kfstypes.h"
 #include "common/Properties.h"
+#include "common/PropertiesView.h"
 #include "common/ValueSampler.h"
 #include "common/StdAllocator.h"
 #include "common/MsgLogger.h"
@@ -55,6 +56,8 @@
 #include <istream>
 #include <map>
 #include <set>
+#include <vector>
+#include <deque>
 
 #include <boost/shared_ptr.hpp>
 #include <boost/enable_shared_from_this.hpp>
@@ -71,6 +74,8 @@ using std::multimap;
 using std::pair;
 using std::less;
 using std::set;
+using std::vector;
+using std::deque;
 
 /// Chunk server connects to the meta server, sends a HELLO
 /// message to configure its state with the meta server,  and
@@ -403,6 +408,7 @@ public:
         return DeleteChunkVers(chunkId, 0);
     }
     int DeleteChunkVers(chunkId_t chunkId, seq_t chunkVersion);
+    void ChunkDeleteDone(const MetaChunkDelete& req);
 
     ///
     /// Send a message to the server asking it to go down.
@@ -703,10 +709,32 @@ public:
     static int GetChunkServerCount() {
         return sChunkServerCount;
     }
+    // While at least one flush batch is active, the chunk server connection
+    // flushes are deferred until the outermost batch ends, in order to send
+    // all RPCs queued to the same chunk server, for example make chunk stable
+    // and chunk version change RPCs issued by a mass file close, with a single
+    // write system call, instead of one write per RPC.
+    static void BeginFlushBatch() {
+        sFlushBatchDepth++;
+    }
+    static void EndFlushBatch() {
+        assert(0 < sFlushBatchDepth);
+        if (--sFlushBatchDepth <= 0) {
+            FlushPending();
+        }
+    }
     void UpdateSpace(MetaChunkEvacuate& op);
     size_t GetChunksToEvacuateCount() const {
         return mChunksToEvacuate.Size();
     }
+    int GetRecentPlacedCount(time_t windowStart, int windowSec) const {
+        Mutable(*this).UpdatePlacementWindow(windowStart, windowSec);
+        return (mPlacedCount + mPrevPlacedCount);
+    }
+    void AddPlaced(time_t windowStart, int windowSec) {
+        UpdatePlacementWindow(windowStart, windowSec);
+        mPlacedCount++;
+    }
     bool GetCanBeCandidateServerFlag() const {
         return mCanBeCandidateServerFlag;
     }
@@ -853,6 +881,7 @@ protected:
     static int    sSrvLoadSamplerSampleCount;
     static string sSrvLoadPropName;
     static size_t sMaxChunksToEvacuate;
+    static int    sMaxChunkDeletesInFlight;
 
     /// For record append's, can this node be a chunk master
     bool mCanBeChunkMaster;
@@ -861,6 +890,8 @@ protected:
     bool mIsRetiring;
     /// when we did we get the retire request
     time_t mRetireStartTime;
+    /// chunk count at the retire start, used to estimate retire rate
+    size_t mRetireStartChunkCount;
 
     /// when did we get the last heartbeat reply
     time_t mLastHeard;
@@ -903,6 +934,12 @@ protected:
     /// but that space hasn't been fully used up.
     int64_t mAllocSpace;
 
+    /// # of chunks placed onto this server, allocations and replications,
+    /// in the current and previous placement rate windows
+    time_t mPlacementWindowStart;
+    int    mPlacedCount;
+    int    mPrevPlacedCount;
+
     /// # of chunks hosted on this server; useful for
     /// reporting purposes
     long mNumChunks;
@@ -963,6 +1000,8 @@ protected:
         less<string>,
         StdFastAllocator<string>
     > LostChunkDirs;
+    typedef vector<ChunkServerPtr> FlushPendingList;
+    typedef deque<pair<chunkId_t, seq_t> > PendingChunkDeletes;
 
     enum { kChunkSrvListsCount = 2 };
     /// RPCs that we have sent to this chunk server.
@@ -1017,6 +1056,9 @@ protected:
     StorageTierInfo    mStorageTiersInfoDelta[kKfsSTierCount];
     ChunkServer*       mPrevPtr[kChunkSrvListsCount];
     ChunkServer*       mNextPtr[kChunkSrvListsCount];
+    bool               mFlushPendingFlag;
+    int                mChunkDeletesInFlight;
+    PendingChunkDeletes mPendingChunkDeletes;
 
     static ChunkOpsInFlight sChunkOpsInFlight;
     static ChunkServer*     sChunkServersPtr[kChunkSrvListsCount];
@@ -1029,6 +1071,8 @@ protected:
     static int64_t          sHelloBytesInFlight;
     static int              sEvacuateRateUpdateInterval;
     static size_t           sChunkDirsCount;
+    static int              sFlushBatchDepth;
+    static FlushPendingList sFlushPending;
 
     friend class QCDLListOp<ChunkServer, 0>;
     friend class QCDLListOp<ChunkServer, 1>;
@@ -1037,6 +1081,8 @@ protected:
 
     void AddToPendingHelloList();
     void RemoveFromPendingHelloList();
+    void StartFlush();
+    static void FlushPending();
     static int64_t GetHelloBytes(MetaHello* req = 0);
     static void PutHelloBytes(MetaHello* req);
 
@@ -1089,7 +1135,8 @@ protected:
     /// @param[in] bufLen length of buf
     /// @param[out] prop  Properties object with the response header/values
     ///
-    bool ParseResponse(istream& is, Properties &prop);
+    bool ParseResponse(const IOBuffer& iobuf, int msgLen,
+        PropertiesView& view);
     ///
     /// The chunk server went down.  So, stop the network timer event;
     /// also, fail all the dispatched ops.
@@ -1103,6 +1150,15 @@ protected:
         int  numChunkWrites,
         int  numWritableDrives);
     inline void NewChunkInTier(kfsSTier_t tier);
+    void UpdatePlacementWindow(time_t windowStart, int windowSec) {
+        if (mPlacementWindowStart == windowStart) {
+            return;
+        }
+        mPrevPlacedCount = mPlacementWindowStart + windowSec == windowStart ?
+            mPlacedCount : 0;
+        mPlacedCount          = 0;
+        mPlacementWindowStart = windowStart;
+    }
     void ShowLines(MsgLogger::LogLevel logLevel, const string& prefix,
         IOBuffer& iobuf, int len, int linesToShow = 64,
         const char* truncatePrefix = "CKey:");
@@ -41,6 +41,7 @@
 #include "kfsio/DelegationToken.h"
 #include "common/MsgLogger.h"
 #include "common/Properties.h"
+#include "common/kfsatomic.h"
 #include "AuditLog.h"
 #include "AuthContext.h"
 
@@ -77,6 +78,7 @@ PeerIp(const NetConnectionPtr& conn)
 }
 
 int  ClientSM::sMaxPendingOps             = 1;
+int  ClientSM::sMaxPendingAllocations     = 16;
 int  ClientSM::sMaxPendingBytes           = 3 << 10;
 int  ClientSM::sMaxReadAhead              = 3 << 10;
 int  ClientSM::sInactivityTimeout         = 8 * 60;
@@ -84,6 +86,8 @@ int  ClientSM::sMaxWriteBehind            = 3 << 10;
 int  ClientSM::sBufCompactionThreshold    = 1 << 10;
 int  ClientSM::sOutBufCompactionThreshold = 8 << 10;
 int  ClientSM::sClientCount               = 0;
+int  ClientSM::sMaxOpsPerSec              = 0;
+volatile int64_t ClientSM::sThrottledCount = 0;
 bool ClientSM::sAuditLoggingFlag          = false;
 int  ClientSM::sAuthMaxTimeSkew           = 2 * 60;
 ClientSM* ClientSM::sClientSMPtr[1]       = {0};
@@ -101,6 +105,9 @@ ClientSM::SetParameters(const Properties& prop)
             prop.getValue("metaServer.clientThreadCount", -1) > 0) {
         sMaxPendingOps = 16;
     }
+    sMaxPendingAllocations = max(1, prop.getValue(
+        "metaServer.clientSM.maxPendingAllocations",
+        sMaxPendingAllocations));
     sMaxPendingBytes = max(1, prop.getValue(
         "metaServer.clientSM.maxPendingBytes",
         sMaxPendingBytes));
@@ -125,6 +132,9 @@ ClientSM::SetParameters(const Properties& prop)
     sAuthMaxTimeSkew = prop.getValue(
         "metaServer.clientSM.authMaxTimeSkew",
         sAuthMaxTimeSkew);
+    sMaxOpsPerSec = prop.getValue(
+        "metaServer.clientSM.maxOpsPerSec",
+        sMaxOpsPerSec);
     AuditLog::SetParameters(prop);
 }
 
@@ -139,13 +149,17 @@ ClientSM::ClientSM(
       mNetConnection(conn),
       mClientIp(PeerIp(conn)),
       mPendingOpsCount(0),
+      mPendingAllocationsCount(0),
       mOstream(wostr ? *wostr : sWOStream),
       mParseBuffer(parseBuffer),
       mRecursionCnt(0),
       mClientProtoVers(KFS_CLIENT_PROTO_VERS),
       mDisconnectFlag(false),
       mDelegationValidFlag(false),
+      mThrottledFlag(false),
       mLastReadLeft(0),
+      mOpsRateWindowStart(0),
+      mOpsRateWindowCount(0),
       mAuthenticateOp(0),
       mAuthUid(kKfsUserNone),
       mAuthGid(kKfsGroupNone),
@@ -277,6 +291,7 @@ ClientSM::HandleRequestSelf(int code, void *data)
             int cmdLen;
             if (overWriteBehindFlag ||
                     IsOverPendingOpsLimit() ||
+                    IsOverOpsRateLimit() ||
                     ! IsMsgAvail(&iobuf, &cmdLen)) {
                 break;
             }
@@ -315,6 +330,10 @@ ClientSM::HandleRequestSelf(int code, void *data)
             AuditLog::Log(*op);
         }
         const bool deleteOpFlag = op != mAuthenticateOp;
+        if (op->op == META_ALLOCATE) {
+            assert(mPendingAllocationsCount > 0);
+            mPendingAllocationsCount--;
+        }
         SendResponse(op);
         if (deleteOpFlag) {
             delete op;
@@ -418,6 +437,24 @@ ClientSM::HandleRequestSelf(int code, void *data)
         }
         // Fall through.
     case EVENT_INACTIVITY_TIMEOUT:
+        if (EVENT_INACTIVITY_TIMEOUT == code && mThrottledFlag &&
+                mNetConnection->IsGood()) {
+            // Ops rate limit "timer" fired, resume reading requests.
+            mThrottledFlag      = false;
+            mOpsRateWindowCount = 0;
+            mNetConnection->SetInactivityTimeout(sInactivityTimeout);
+            if (! IsOverPendingOpsLimit() && mRecursionCnt <= 1 &&
+                    ! mAuthenticateOp &&
+                    mNetConnection->GetNumBytesToWrite() < sMaxWriteBehind) {
+                if (mNetConnection->GetNumBytesToRead() > mLastReadLeft) {
+                    HandleRequest(EVENT_NET_READ,
+                        &mNetConnection->GetInBuffer());
+                } else {
+                    mNetConnection->SetMaxReadAhead(sMaxReadAhead);
+                }
+            }
+            break;
+        }
         if (EVENT_INACTIVITY_TIMEOUT == code && 0 < mPendingOpsCount &&
                 ! mNetConnection->IsWriteReady()) {
             // Ops pending, do not close connection, unless the client
@@ -494,6 +531,33 @@ ClientSM::HandleRequestSelf(int code, void *data)
     return 0;
 }
 
+bool
+ClientSM::IsOverOpsRateLimit()
+{
+    if (sMaxOpsPerSec <= 0 || mThrottledFlag) {
+        return mThrottledFlag;
+    }
+    const time_t now = mNetConnection->TimeNow();
+    if (mOpsRateWindowStart != now) {
+        mOpsRateWindowStart = now;
+        mOpsRateWindowCount = 0;
+        return false;
+    }
+    if (mOpsRateWindowCount < sMaxOpsPerSec) {
+        return false;
+    }
+    // Stop reading, and use inactivity timeout as timer to resume.
+    KFS_LOG_STREAM_DEBUG << PeerName(mNetConnection) <<
+        " ops rate limit reached: " << mOpsRateWindowCount <<
+        " pending: " << mPendingOpsCount <<
+    KFS_LOG_EOM;
+    mThrottledFlag = true;
+    SyncAddAndFetch(sThrottledCount, int64_t(1));
+    mNetConnection->SetMaxReadAhead(0);
+    mNetConnection->SetInactivityTimeout(1);
+    return true;
+}
+
 void
 ClientSM::CloseConnection(const char* msg /* = 0 */)
 {
@@ -626,7 +690,13 @@ ClientSM::HandleClientCmd(IOBuffer& iobuf, int cmdLen)
         op->euser   = mAuthEUid;
         op->egroup  = mAuthEGid;
     }
+    if (op->op != META_LEASE_RENEW) {
+        mOpsRateWindowCount++;
+    }
     mPendingOpsCount++;
+    if (op->op == META_ALLOCATE) {
+        mPendingAllocationsCount++;
+    }
     if (op->dispatch(*this)) {
         return;
     }
@@ -98,6 +98,7 @@ public:
 
     static void SetParameters(const Properties& prop);
     static int GetClientCount() { return sClientCount; }
+    static int64_t GetThrottledCount() { return sThrottledCount; }
     bool Handle(MetaAuthenticate& op);
     bool Handle(MetaDelegate& op);
     bool Handle(MetaLookup& op);
@@ -108,6 +109,7 @@ private:
     NetConnectionPtr                   mNetConnection;
     const string                       mClientIp;
     int                                mPendingOpsCount;
+    int                                mPendingAllocationsCount;
     IOBuffer::WOStream&                mOstream;
     char* const                        mParseBuffer;
     int                                mRecursionCnt;
@@ -115,7 +117,10 @@ private:
     int                                mClientProtoVers;
     bool                               mDisconnectFlag:1;
     bool                               mDelegationValidFlag:1;
+    bool                               mThrottledFlag:1;
     int                                mLastReadLeft;
+    time_t                             mOpsRateWindowStart;
+    int                                mOpsRateWindowCount;
     MetaAuthenticate*                  mAuthenticateOp;
     kfsUid_t                           mAuthUid;
     kfsGid_t                           mAuthGid;
@@ -146,13 +151,22 @@ private:
     /// Op has finished execution.  Send a response to the client.
     void SendResponse(MetaRequest *op);
     void CmdDone(MetaRequest& op);
+    // Chunk allocations are accounted separately, in order to let the
+    // allocations of a striped file chunk group proceed concurrently, instead
+    // of waiting for each chunk server allocation round trip in turn.
     bool IsOverPendingOpsLimit() const
-        { return (mPendingOpsCount >= sMaxPendingOps); }
+    {
+        return (mThrottledFlag ||
+            mPendingOpsCount - mPendingAllocationsCount >= sMaxPendingOps ||
+            mPendingAllocationsCount >= sMaxPendingAllocations);
+    }
+    bool IsOverOpsRateLimit();
     void HandleAuthenticate(IOBuffer& iobuf);
     void HandleDelegation(MetaDelegate& op);
     void CloseConnection(const char* msg = 0);
 
     static int  sMaxPendingOps;
+    static int  sMaxPendingAllocations;
     static int  sMaxPendingBytes;
     static int  sMaxReadAhead;
     static int  sInactivityTimeout;
@@ -161,6 +175,8 @@ private:
     static int  sOutBufCompactionThreshold;
     static int  sAuthMaxTimeSkew;
     static int  sClientCount;
+    static int  sMaxOpsPerSec;
+    static volatile int64_t sThrottledCount;
     static bool sAuditLoggingFlag;
     static ClientSM* sClientSMPtr[1];
     static IOBuffer::WOStream sWOStream;
@@ -49,6 +49,7 @@ DETokenizer::next(ostream* os)
     Token* const tend = tokens + kMaxEntryTokens;
     cur = tokens;
     end = tokens;
+    mdStream = os;
     if (os && prevStart < nextEnt) {
         os->write(prevStart, nextEnt - prevStart);
         prevStart = nextEnt;
@@ -114,6 +115,44 @@ DETokenizer::next(ostream* os)
     return true;
 }
 
+const char*
+DETokenizer::readRaw(size_t len)
+{
+    if (kMaxEntrySize < len) {
+        return 0;
+    }
+    size_t size = nextEnt < bend ? bend - nextEnt : 0;
+    if (size < len) {
+        if (mdStream && prevStart < nextEnt) {
+            const size_t sz =
+                (nextEnt < bend ? nextEnt : bend) - prevStart;
+            if (sz > 0) {
+                mdStream->write(prevStart, sz);
+            }
+        }
+        memmove(buffer, nextEnt, size);
+        nextEnt   = buffer;
+        prevStart = nextEnt;
+        bend      = buffer + size;
+        if (! is.read(bend, kMaxEntrySize - size)) {
+            const streamsize cnt = is.eof() ? is.gcount() : 0;
+            if (cnt > 0) {
+                bend += cnt;
+            }
+        } else {
+            bend = buffer + kMaxEntrySize;
+        }
+        MarkEnd();
+        size = bend - nextEnt;
+        if (size < len) {
+            return 0;
+        }
+    }
+    const char* const ret = nextEnt;
+    nextEnt += len;
+    return ret;
+}
+
 const unsigned char* const DETokenizer::c2hex = char2HexTable();
 
 /*!
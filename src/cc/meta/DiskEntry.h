@@ -110,7 +110,8 @@ public:
           nextEnt(bend),
           prevStart(nextEnt),
           base(10),
-          lastOk(true)
+          lastOk(true),
+          mdStream(0)
         { MarkEnd(); }
     ~DETokenizer() {
         delete [] tokens;
@@ -131,6 +132,9 @@ public:
         return (cur >= end);
     }
     bool next(ostream* os = 0);
+    //!< return pointer to len raw bytes following the current entry, and
+    //!< advance past them, or 0 on error or end of input
+    const char* readRaw(size_t len);
     size_t getEntryCount() const {
         return entryCount;
     }
@@ -185,6 +189,7 @@ private:
     const char* prevStart;
     int         base;
     bool        lastOk;
+    ostream*    mdStream;
     static const unsigned char* const c2hex;
 
     void MarkEnd() {
@@ -31,6 +31,7 @@
 #include "kfstree.h"
 #include "ClientSM.h"
 #include "NetDispatch.h"
+#include "TrashEmptier.h"
 
 #include "kfsio/Globals.h"
 #include "kfsio/IOBuffer.h"
@@ -45,6 +46,11 @@
 #include "common/StdAllocator.h"
 #include "common/rusage.h"
 
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <errno.h>
+
 #include <algorithm>
 #include <functional>
 #include <sstream>
@@ -338,7 +344,11 @@ ChunkLeases::ChunkLeases()
       mReadLeaseTimer(TimeNow()),
       mWriteLeaseTimer(TimeNow()),
       mWAllocationInFlightList()
-{}
+{
+    for (int i = 0; i < kExpirationLagBucketCount; i++) {
+        mExpirationLagHistogram[i] = 0;
+    }
+}
 
 inline void
 ChunkLeases::Erase(
@@ -628,6 +638,9 @@ ChunkLeases::ExpiredCleanup(
             break;
         }
         n = &RLEntry::List::GetNext(c);
+        if (mTimerRunningFlag) {
+            UpdateExpirationLag(now - c.GetExpiration());
+        }
         rl.mLeases.Erase(c.leaseId);
         updateFlag = true;
     }
@@ -679,6 +692,9 @@ ChunkLeases::ExpiredCleanup(
     const string         pathname         = wl.pathname;
     const bool           appendFlag       = wl.appendFlag;
     const bool           stripedFileFlag  = wl.stripedFileFlag;
+    if (mTimerRunningFlag) {
+        UpdateExpirationLag(now - exp);
+    }
     Erase(we);
     if (relinquishedFlag) {
         UpdateReplicationState(csmap, *ci);
@@ -1334,7 +1350,7 @@ LayoutManager::UpdateReplicationState(CSMap::Entry& entry)
 
 inline void
 LayoutManager::SetReplicationState(CSMap::Entry& entry,
-    CSMap::Entry::State state)
+    CSMap::Entry::State state, bool frontFlag /* = false */)
 {
     CSMap::Entry::State const curState = mChunkToServerMap.GetState(entry);
     if (curState == state) {
@@ -1344,13 +1360,67 @@ LayoutManager::SetReplicationState(CSMap::Entry& entry,
         // Re-schedule replication check if needed.
         UpdatePendingRecovery(entry);
     }
-    mChunkToServerMap.SetState(entry, state);
+    mChunkToServerMap.SetState(entry, state, frontFlag);
 }
 
 inline void
 LayoutManager::CheckReplication(CSMap::Entry& entry)
 {
-    SetReplicationState(entry, CSMap::Entry::kStateCheckReplication);
+    // Check the chunks at the higher risk of data loss first: no replicas, or
+    // single replica left with more than one replica required.
+    const size_t cnt = mChunkToServerMap.ServerCount(entry);
+    SetReplicationState(entry, CSMap::Entry::kStateCheckReplication,
+        cnt <= 0 || (cnt <= 1 && 1 < entry.GetFattr()->numReplicas));
+}
+
+inline bool
+LayoutManager::CanEvacuateReplicationRead(const ChunkServer& srv) const
+{
+    return (srv.GetReplicationReadLoad() <
+        (mMaxConcurrentEvacuationReadReplicationsPerNode < 0 ?
+            mMaxConcurrentReadReplicationsPerNode :
+            mMaxConcurrentEvacuationReadReplicationsPerNode));
+}
+
+inline bool
+LayoutManager::IsCrossRackReplicationAllowed(
+    const ChunkServer& src, const ChunkServer& dst) const
+{
+    if (mMaxConcurrentCrossRackReplicationsPerRack <= 0 ||
+            src.GetRack() < 0 || dst.GetRack() < 0 ||
+            src.GetRack() == dst.GetRack()) {
+        return true;
+    }
+    CrossRackReplications::const_iterator it =
+        mCrossRackReplications.find(src.GetRack());
+    if (it != mCrossRackReplications.end() &&
+            mMaxConcurrentCrossRackReplicationsPerRack <= it->second) {
+        return false;
+    }
+    it = mCrossRackReplications.find(dst.GetRack());
+    return (it == mCrossRackReplications.end() ||
+        it->second < mMaxConcurrentCrossRackReplicationsPerRack);
+}
+
+inline void
+LayoutManager::UpdateCrossRackReplications(
+    const ChunkServer& src, const ChunkServer& dst, int delta)
+{
+    // Count regardless of the limit, in order to keep the counters valid
+    // when the limit parameter changes.
+    if (src.GetRack() < 0 || dst.GetRack() < 0 ||
+            src.GetRack() == dst.GetRack()) {
+        return;
+    }
+    const RackId racks[] = { src.GetRack(), dst.GetRack() };
+    for (size_t i = 0; i < sizeof(racks) / sizeof(racks[0]); i++) {
+        CrossRackReplications::iterator const it =
+            mCrossRackReplications.insert(make_pair(racks[i], 0)).first;
+        if ((it->second += delta) <= 0) {
+            assert(it->second == 0);
+            mCrossRackReplications.erase(it);
+        }
+    }
 }
 
 inline seq_t
@@ -1465,6 +1535,20 @@ LayoutManager::LayoutManager() :
     mRecomputeDirSizesIntervalSec(60 * 60 * 24 * 3650),
     mMaxConcurrentWriteReplicationsPerNode(5),
     mMaxConcurrentReadReplicationsPerNode(10),
+    mMaxConcurrentEvacuationReadReplicationsPerNode(-1),
+    mMaxConcurrentCrossRackReplicationsPerRack(0),
+    mCrossRackReplications(),
+    mHotChunks(),
+    mHotChunkReadThreshold(0),
+    mHotChunkIntervalSec(60),
+    mHotChunkMaxExtraReplicas(3),
+    mHotChunkColdTimeoutSec(10 * 60),
+    mHotChunkNextCheckTime(0),
+    mHotChunkBoostCount(0),
+    mReplicationsDoneCount(0),
+    mReplicationRateSampleTime(0),
+    mReplicationRateSampleCount(0),
+    mReplicationRate(0),
     mUseEvacuationRecoveryFlag(true),
     mReplicationFindWorkTimeouts(0),
     // Replication check 30ms/.20-30ms = 120 -- 20% cpu when idle
@@ -1485,6 +1569,7 @@ LayoutManager::LayoutManager() :
         microseconds() - mCompleteReplicationCheckInterval),
     mPastEofRecoveryDelay(int64_t(60) * 6 * 60 * kSecs2MicroSecs),
     mMaxServerCleanupScan(2 << 10),
+    mMaxHelloChunksPerIteration(32 << 10),
     mMaxRebalanceScan(1024),
     mRebalanceReplicationsThreshold(0.5),
     mRebalanceReplicationsThresholdCount(0),
@@ -1496,6 +1581,7 @@ LayoutManager::LayoutManager() :
     mRebalanceCtrs(),
     mRebalancePlan(),
     mCleanupScheduledFlag(false),
+    mPendingHellos(),
     mCSCountersUpdateInterval(2),
     mCSCountersUpdateTime(0),
     mCSCountersResponse(),
@@ -1504,7 +1590,13 @@ LayoutManager::LayoutManager() :
     mCSDirCountersResponse(),
     mPingUpdateInterval(2),
     mPingUpdateTime(0),
+    mPingGeneration(0),
     mPingResponse(),
+    mPingServersUpdateInterval(10),
+    mPingServersUpdateTime(0),
+    mPingServersResponse(),
+    mPingServersTotals(),
+    mChunkMapDumpShards(1),
     mWOstream(),
     mBufferPool(0),
     mMightHaveRetiringServersFlag(false),
@@ -1555,6 +1647,7 @@ LayoutManager::LayoutManager() :
     mMaxReplicasPerFile(MAX_REPLICAS_PER_FILE),
     mMaxReplicasPerRSFile(MAX_REPLICAS_PER_FILE),
     mGetAllocOrderServersByLoadFlag(true),
+    mGetAllocLoadHintsFlag(true),
     mMinChunkAllocClientProtoVersion(-1),
     mMaxResponseSize(256 << 20),
     mMinIoBufferBytesToProcessRequest(mMaxResponseSize + (10 << 20)),
@@ -1570,6 +1663,11 @@ LayoutManager::LayoutManager() :
     mMaxWritesPerDriveRatio(1.5),
     mMaxLocalPlacementWeight(1.0),
     mTotalWritableDrivesMult(0.),
+    mPlacementRateWindowSec(60),
+    mMaxPlacementRatePerDriveRatio(0),
+    mPlacementWindowStart(0),
+    mPlacedCount(0),
+    mPrevPlacedCount(0),
     mConfig(),
     mConfigParameters(),
     mDefaultUser(kKfsUserNone),      // Request defaults
@@ -1597,6 +1695,7 @@ LayoutManager::LayoutManager() :
     mClientCSAuthRequiredFlag(false),
     mClientCSAllowClearTextFlag(false),
     mCSAccessValidForTimeSec(2 * 60 * 60),
+    mStableChunkReadLeaseTimeout(0),
     mMinWriteLeaseTimeSec(LEASE_INTERVAL_SECS),
     mFileSystemIdRequiredFlag(false),
     mDeleteChunkOnFsIdMismatchFlag(false),
@@ -1617,6 +1716,9 @@ LayoutManager::LayoutManager() :
     mObjStoreFilesDeleteQueue(),
     mObjBlocksDeleteRequeue(),
     mObjBlocksDeleteInFlight(),
+    mObjStoreDeletesScheduledCount(0),
+    mObjStoreDeletesDoneCount(0),
+    mObjStoreDeletesRetryCount(0),
     mTmpParseStream(),
     mChunkInfosTmp(),
     mChunkInfos2Tmp(),
@@ -1747,9 +1849,27 @@ LayoutManager::SetParameters(const Properties& props, int clientPort)
     mMaxConcurrentReadReplicationsPerNode = props.getValue(
         "metaServer.maxConcurrentReadReplicationsPerNode",
         mMaxConcurrentReadReplicationsPerNode);
+    mMaxConcurrentEvacuationReadReplicationsPerNode = props.getValue(
+        "metaServer.maxConcurrentEvacuationReadReplicationsPerNode",
+        mMaxConcurrentEvacuationReadReplicationsPerNode);
     mMaxConcurrentWriteReplicationsPerNode = props.getValue(
         "metaServer.maxConcurrentWriteReplicationsPerNode",
         mMaxConcurrentWriteReplicationsPerNode);
+    mMaxConcurrentCrossRackReplicationsPerRack = props.getValue(
+        "metaServer.maxConcurrentCrossRackReplicationsPerRack",
+        mMaxConcurrentCrossRackReplicationsPerRack);
+    mHotChunkReadThreshold = max(0, props.getValue(
+        "metaServer.hotChunk.readThreshold",
+        mHotChunkReadThreshold));
+    mHotChunkIntervalSec = max(1, props.getValue(
+        "metaServer.hotChunk.intervalSec",
+        mHotChunkIntervalSec));
+    mHotChunkMaxExtraReplicas = max(0, props.getValue(
+        "metaServer.hotChunk.maxExtraReplicas",
+        mHotChunkMaxExtraReplicas));
+    mHotChunkColdTimeoutSec = max(0, props.getValue(
+        "metaServer.hotChunk.coldTimeoutSec",
+        mHotChunkColdTimeoutSec));
     mUseEvacuationRecoveryFlag = props.getValue(
         "metaServer.useEvacuationRecoveryFlag",
         mUseEvacuationRecoveryFlag ? 1 : 0) != 0;
@@ -1783,6 +1903,9 @@ LayoutManager::SetParameters(const Properties& props, int clientPort)
     mMaxServerCleanupScan = max(0, props.getValue(
         "metaServer.maxServerCleanupScan",
         (int)mMaxServerCleanupScan));
+    mMaxHelloChunksPerIteration = max(0, props.getValue(
+        "metaServer.maxHelloChunksPerIteration",
+        (int)mMaxHelloChunksPerIteration));
 
     mMaxRebalanceScan = max(0, props.getValue(
         "metaServer.maxRebalanceScan",
@@ -1860,6 +1983,12 @@ LayoutManager::SetParameters(const Properties& props, int clientPort)
     mPingUpdateInterval = props.getValue(
         "metaServer.pingUpdateInterval",
         mPingUpdateInterval);
+    mPingServersUpdateInterval = props.getValue(
+        "metaServer.pingServersUpdateInterval",
+        mPingServersUpdateInterval);
+    mChunkMapDumpShards = max(1, props.getValue(
+        "metaServer.chunkMapDumpShards",
+        mChunkMapDumpShards));
 
     /// On startup, the # of secs to wait before we are open for reads/writes
     mRecoveryIntervalSec = props.getValue(
@@ -1947,6 +2076,9 @@ LayoutManager::SetParameters(const Properties& props, int clientPort)
     mGetAllocOrderServersByLoadFlag = props.getValue(
         "metaServer.getAllocOrderServersByLoad",
         mGetAllocOrderServersByLoadFlag ? 1 : 0) != 0;
+    mGetAllocLoadHintsFlag = props.getValue(
+        "metaServer.getAllocLoadHints",
+        mGetAllocLoadHintsFlag ? 1 : 0) != 0;
     mMinChunkAllocClientProtoVersion = props.getValue(
         "metaServer.minChunkAllocClientProtoVersion",
         mMinChunkAllocClientProtoVersion);
@@ -2073,6 +2205,8 @@ LayoutManager::SetParameters(const Properties& props, int clientPort)
             mDownServers.size() - mMaxDownServersHistorySize);
     }
     MetaFsck::SetParameters(props);
+    MetaRmdirs::SetParameters(props);
+    gTrashEmptier.SetParameters(props);
     SetRequestParameters(props);
     CSMapUnitTest(props);
     mChunkToServerMap.SetDebugValidate(props.getValue(
@@ -2101,6 +2235,12 @@ LayoutManager::SetParameters(const Properties& props, int clientPort)
         mMinWritesPerDrive));
     mMaxWritesPerDriveThreshold =
         max(mMinWritesPerDrive, mMaxWritesPerDriveThreshold);
+    mPlacementRateWindowSec = max(1, props.getValue(
+        "metaServer.placementRateWindowSec",
+        mPlacementRateWindowSec));
+    mMaxPlacementRatePerDriveRatio = props.getValue(
+        "metaServer.maxPlacementRatePerDriveRatio",
+        mMaxPlacementRatePerDriveRatio);
     mDefaultUser = props.getValue(
         "metaServer.defaultUser",
         mDefaultUser);
@@ -2232,6 +2372,9 @@ LayoutManager::SetParameters(const Properties& props, int clientPort)
         mClientCSAllowClearTextFlag ? 1 : 0) != 0;
     mCSAccessValidForTimeSec = max(LEASE_INTERVAL_SECS, props.getValue(
         "metaServer.CSAccessValidForTimeSec", mCSAccessValidForTimeSec));
+    mStableChunkReadLeaseTimeout = props.getValue(
+        "metaServer.stableChunkReadLeaseTimeout",
+        mStableChunkReadLeaseTimeout);
     mMinWriteLeaseTimeSec = props.getValue(
         "metaServer.minWriteLeaseTimeSec", mMinWriteLeaseTimeSec);
     mFileSystemIdRequiredFlag = props.getValue(
@@ -2900,6 +3043,11 @@ LayoutManager::AddNewServer(MetaHello *r)
     if (r->server->IsDown()) {
         return;
     }
+    if (0 < r->chunksPos) {
+        // Resume chunk inventory processing.
+        AddHelloChunks(*r);
+        return;
+    }
     ChunkServer&          srv   = *r->server.get();
     const ServerLocation& srvId = srv.GetServerLocation();
     if (srvId != r->location || ! srvId.IsValid()) {
@@ -3017,10 +3165,39 @@ LayoutManager::AddNewServer(MetaHello *r)
     if (! mChunkServersProps.empty() && ! srv.IsDown()) {
         srv.SetProperties(mChunkServersProps);
     }
-    int maxLogInfoCnt = 32;
+    AddHelloChunks(*r);
+}
+
+void
+LayoutManager::AddHelloChunks(MetaHello& hello)
+{
+    MetaHello* const r   = &hello;
+    ChunkServer&     srv = *r->server;
+    if (srv.IsDown()) {
+        return;
+    }
+    const ServerLocation& srvId = srv.GetServerLocation();
+    // Process stable chunk inventory in batches, in order to let the event
+    // loop run between batches, and avoid stalling request processing for
+    // the duration of processing of the large inventory.
+    // Each chunk is validated against the current chunk state, therefore
+    // processing at a later time has the same effect as processing all
+    // chunks at once.
+    const size_t endPos = mMaxHelloChunksPerIteration <= 0 ? r->chunks.size() :
+        min(r->chunks.size(), r->chunksPos + mMaxHelloChunksPerIteration);
+    int maxLogInfoCnt = 0 < r->chunksPos ? 0 : 32;
+    // If the server returns from hibernation, remove its hibernated slot
+    // from the chunks in the inventory as these are processed. The chunks
+    // that are present on the server are added back with the new slot, and
+    // the chunks that were deleted while the server was hibernated have
+    // already released the slot. Once all chunks are accounted for, the
+    // hibernated slot can be re-used without full chunk to server map scan.
+    const HibernatingServerInfo_t* const hs = FindHibernatingServer(srvId);
+    const size_t hibernatedIdx = hs ? hs->csmapIdx : ~size_t(0);
     ChunkIdQueue staleChunkIds;
-    for (MetaHello::ChunkInfos::const_iterator it = r->chunks.begin();
-            it != r->chunks.end() && ! srv.IsDown();
+    for (MetaHello::ChunkInfos::const_iterator
+                it = r->chunks.begin() + r->chunksPos;
+            it != r->chunks.begin() + endPos && ! srv.IsDown();
             ++it) {
         const chunkId_t     chunkId      = it->chunkId;
         const char*         staleReason  = 0;
@@ -3028,6 +3205,8 @@ LayoutManager::AddNewServer(MetaHello *r)
         seq_t               chunkVersion = -1;
         if (cmi) {
             CSMap::Entry&        c      = *cmi;
+            const bool           hibernatedFlag =
+                mChunkToServerMap.RemoveHibernated(hibernatedIdx, c);
             const fid_t          fileId = c.GetFileId();
             const ChunkServerPtr cs     = c.GetServer(
                 mChunkToServerMap, srv.GetServerLocation());
@@ -3073,6 +3252,9 @@ LayoutManager::AddNewServer(MetaHello *r)
                         kMakeStableFlag,
                         kPendingAddFlag
                     );
+                    if (hibernatedFlag) {
+                        CheckReplication(c);
+                    }
                     continue;
                 }
                 const ChunkLeases::WriteLease* const wl =
@@ -3087,6 +3269,9 @@ LayoutManager::AddNewServer(MetaHello *r)
                     AddServer(c, r->server);
                 }
             }
+            if (staleReason && hibernatedFlag) {
+                CheckReplication(c);
+            }
         } else {
             staleReason = "no chunk mapping exists";
         }
@@ -3107,6 +3292,21 @@ LayoutManager::AddNewServer(MetaHello *r)
         }
     }
 
+    r->chunksPos = endPos;
+    r->staleChunksCount += staleChunkIds.GetSize();
+    if (r->chunksPos < r->chunks.size() && ! srv.IsDown()) {
+        if (! staleChunkIds.IsEmpty()) {
+            srv.NotifyStaleChunks(staleChunkIds);
+        }
+        if (! srv.IsDown()) {
+            // Resume with the next batch on the next event loop iteration.
+            r->suspended = true;
+            mPendingHellos.push_back(r);
+            ScheduleCleanup();
+            return;
+        }
+    }
+
     for (int i = 0; i < 2; i++) {
         const MetaHello::ChunkInfos& chunks = i == 0 ?
             r->notStableAppendChunks : r->notStableChunks;
@@ -3114,6 +3314,10 @@ LayoutManager::AddNewServer(MetaHello *r)
         for (MetaHello::ChunkInfos::const_iterator it = chunks.begin();
                 it != chunks.end() && ! srv.IsDown();
                 ++it) {
+            CSMap::Entry* cmi            = mChunkToServerMap.Find(
+                it->chunkId);
+            const bool    hibernatedFlag = cmi &&
+                mChunkToServerMap.RemoveHibernated(hibernatedIdx, *cmi);
             const char* const staleReason = AddNotStableChunk(
                 r->server,
                 it->chunkId,
@@ -3121,6 +3325,10 @@ LayoutManager::AddNewServer(MetaHello *r)
                 i == 0,
                 srvId
             );
+            if (hibernatedFlag &&
+                    (cmi = mChunkToServerMap.Find(it->chunkId))) {
+                CheckReplication(*cmi);
+            }
             maxLogInfoCnt--;
             KFS_LOG_STREAM((maxLogInfoCnt > 0) ?
                     MsgLogger::kLogLevelINFO :
@@ -3135,12 +3343,12 @@ LayoutManager::AddNewServer(MetaHello *r)
             KFS_LOG_EOM;
             if (staleReason) {
                 staleChunkIds.PushBack(it->chunkId);
+                r->staleChunksCount++;
                 mStaleChunkCount->Update(1);
             }
             // MakeChunkStableDone will process pending recovery.
         }
     }
-    const size_t staleCnt = staleChunkIds.GetSize();
     if (! staleChunkIds.IsEmpty() && ! srv.IsDown()) {
         srv.NotifyStaleChunks(staleChunkIds);
     }
@@ -3183,14 +3391,14 @@ LayoutManager::AddNewServer(MetaHello *r)
         msg << " chunk server: " << r->peerName << "/" <<
             srv.GetServerLocation() <<
         (srv.CanBeChunkMaster() ? " master" : " slave") <<
-        " rack: "            << r->rackId << " => " << rackId <<
+        " rack: "            << r->rackId << " => " << srv.GetRack() <<
         " chunks: stable: "  << r->chunks.size() <<
         " not stable: "      << r->notStableChunks.size() <<
         " append: "          << r->notStableAppendChunks.size() <<
         " +wid: "            << r->numAppendsWithWid <<
         " writes: "          << srv.GetNumChunkWrites() <<
         " +wid: "            << srv.GetNumAppendsWithWid() <<
-        " stale: "           << staleCnt <<
+        " stale: "           << r->staleChunksCount <<
         " masters: "         << mMastersCount <<
         " slaves: "          << mSlavesCount <<
         " total: "           << mChunkServers.size() <<
@@ -3550,15 +3758,76 @@ LayoutManager::DumpChunkToServerMap(const string& dirToUse)
     }
 
     fn = dirToUse + "/chunkmap.txt";
-    ofs.open(fn.c_str(), ofstream::out | ofstream::trunc);
-    if (ofs) {
-        DumpChunkToServerMap(ofs);
-        ofs.close();
-    }
-    if (! ofs) {
-        unlink(fn.c_str());
+    if (mChunkMapDumpShards <= 1) {
+        ofs.open(fn.c_str(), ofstream::out | ofstream::trunc);
+        if (ofs) {
+            DumpChunkToServerMap(ofs);
+            ofs.close();
+        }
+        if (! ofs) {
+            unlink(fn.c_str());
+            return;
+        }
+        RemoveChunkToServerMapShards(fn, 0);
         return;
     }
+    // Write the shards concurrently, one process per shard. Each shard
+    // process walks the entire map, and formats only the entries that belong
+    // to its shard, the formatting dominates the walk cost.
+    unlink(fn.c_str());
+    vector<pid_t> pids;
+    int           shard = 1;
+    bool          okFlag = true;
+    for (; shard < mChunkMapDumpShards; shard++) {
+        const pid_t pid = fork();
+        if (pid == 0) {
+            break;
+        }
+        if (pid < 0) {
+            okFlag = false;
+            shard  = mChunkMapDumpShards;
+            break;
+        }
+        pids.push_back(pid);
+    }
+    const bool childFlag = shard < mChunkMapDumpShards;
+    if (! childFlag) {
+        shard = 0;
+    }
+    if (okFlag) {
+        const string sfn = fn + "." + toString(shard);
+        ofstream     sofs(sfn.c_str(), ofstream::out | ofstream::trunc);
+        if (sofs) {
+            DumpChunkToServerMap(sofs, shard, mChunkMapDumpShards);
+            sofs.close();
+        }
+        okFlag = ! sofs.fail();
+    }
+    if (childFlag) {
+        _exit(okFlag ? 0 : 1);
+    }
+    for (vector<pid_t>::const_iterator it = pids.begin();
+            it != pids.end();
+            ++it) {
+        int status = 0;
+        while (waitpid(*it, &status, 0) < 0 && errno == EINTR)
+            {}
+        if (! WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            okFlag = false;
+        }
+    }
+    RemoveChunkToServerMapShards(fn, okFlag ? mChunkMapDumpShards : 0);
+}
+
+void
+LayoutManager::RemoveChunkToServerMapShards(const string& fn, int start)
+{
+    for (int i = start; ; i++) {
+        const string sfn = fn + "." + toString(i);
+        if (unlink(sfn.c_str()) != 0) {
+            break;
+        }
+    }
 }
 
 void
@@ -4308,11 +4577,15 @@ LayoutManager::Fsck(ostream** os, bool reportAbandonedFilesFlag)
 }
 
 void
-LayoutManager::DumpChunkToServerMap(ostream& os)
+LayoutManager::DumpChunkToServerMap(ostream& os, int shard, int shardCount)
 {
     mChunkToServerMap.First();
     StTmp<Servers> serversTmp(mServersTmp);
+    size_t         idx = 0;
     for (const CSMap::Entry* p; (p = mChunkToServerMap.Next()); ) {
+        if (1 < shardCount && (int)(idx++ % shardCount) != shard) {
+            continue;
+        }
         Servers& cs = serversTmp.Get();
         mChunkToServerMap.GetServers(*p, cs);
         os << p->GetChunkId() <<
@@ -4611,10 +4884,55 @@ LayoutManager::IsCandidateServer(
             c.GetNotStableOpenCount(tier) < c.GetDeviceCount(tier) *
                 mTiersMaxWritesPerDriveThreshold[tier] *
                 writableChunksThresholdRatio
-        )
+        ) &&
+        IsPlacementRateOk(c)
+    );
+}
+
+inline void
+LayoutManager::UpdatePlacementWindow()
+{
+    const time_t now = TimeNow();
+    if (mPlacementWindowStart <= now &&
+            now < mPlacementWindowStart + mPlacementRateWindowSec) {
+        return;
+    }
+    const time_t start = now - now % mPlacementRateWindowSec;
+    mPrevPlacedCount = start == mPlacementWindowStart +
+        mPlacementRateWindowSec ? mPlacedCount : 0;
+    mPlacedCount          = 0;
+    mPlacementWindowStart = start;
+}
+
+inline bool
+LayoutManager::IsPlacementRateOk(const ChunkServer& srv)
+{
+    if (mMaxPlacementRatePerDriveRatio <= 0 || mTotalWritableDrives <= 0) {
+        return true;
+    }
+    UpdatePlacementWindow();
+    // Compare the number of chunks placed onto the server in the last one
+    // to two windows with the average across all writable drives.
+    return (srv.GetRecentPlacedCount(
+            mPlacementWindowStart, mPlacementRateWindowSec) <
+        max(double(mMinWritesPerDrive),
+            (mPlacedCount + mPrevPlacedCount) *
+            mMaxPlacementRatePerDriveRatio / mTotalWritableDrives) *
+        srv.GetNumWritableDrives()
     );
 }
 
+void
+LayoutManager::ChunkPlaced(ChunkServer& srv)
+{
+    if (mMaxPlacementRatePerDriveRatio <= 0) {
+        return;
+    }
+    UpdatePlacementWindow();
+    mPlacedCount++;
+    srv.AddPlaced(mPlacementWindowStart, mPlacementRateWindowSec);
+}
+
 void
 LayoutManager::UpdateSrvLoadAvg(ChunkServer& srv, int64_t delta,
     const LayoutManager::StorageTierInfo* tiersDelta,
@@ -6003,8 +6321,20 @@ LayoutManager::GetChunkReadLease(MetaLeaseAcquire* req)
         req->statusMsg = "invalid lease type";
         return -EINVAL;
     }
-    if (LEASE_INTERVAL_SECS < req->leaseTimeout) {
-        req->leaseTimeout = LEASE_INTERVAL_SECS;
+    // Stable chunk read lease can only be longer than the default if no
+    // chunk access tokens need to be issued with lease renew. The chunk
+    // stability is checked below, with non stable chunk the request suspended
+    // until the chunk becomes stable.
+    const int maxLeaseTimeout = (
+            mClientCSAuthRequiredFlag ||
+            0 <= req->chunkPos ||
+            ! req->chunkIds.empty() ||
+            req->appendRecoveryFlag ||
+            req->fromChunkServerFlag ||
+            mStableChunkReadLeaseTimeout <= LEASE_INTERVAL_SECS) ?
+        LEASE_INTERVAL_SECS : mStableChunkReadLeaseTimeout;
+    if (maxLeaseTimeout < req->leaseTimeout) {
+        req->leaseTimeout = maxLeaseTimeout;
     }
     req->clientCSAllowClearTextFlag = mClientCSAuthRequiredFlag &&
         mClientCSAllowClearTextFlag;
@@ -6184,6 +6514,9 @@ LayoutManager::GetChunkReadLease(MetaLeaseAcquire* req)
                  ChunkLeases::EntryKey(req->chunkId),
                 TimeNow() + req->leaseTimeout,
                 req->leaseId))) {
+        if (0 < req->leaseTimeout && ! req->fromChunkServerFlag) {
+            UpdateHotChunk(*cs->GetChunkInfo());
+        }
         if (mClientCSAuthRequiredFlag && req->authUid != kKfsUserNone) {
             MakeChunkAccess(*cs, req->authUid, req->chunkAccess, 0);
             if (req->chunkAccess.IsEmpty()) {
@@ -6812,6 +7145,24 @@ LayoutManager::GetChunkToServerMapping(MetaChunkInfo& chunkInfo,
     return 0;
 }
 
+void
+LayoutManager::GetServersLoadHints(
+    const LayoutManager::Servers& c, vector<int>& hints)
+{
+    hints.clear();
+    if (! mGetAllocLoadHintsFlag || c.empty()) {
+        return;
+    }
+    UpdateGoodCandidateLoadAvg();
+    const int64_t kMaxLoadHint = 1000;
+    const int64_t maxLoad      = max(int64_t(1), mCSMaxGoodCandidateLoadAvg);
+    hints.reserve(c.size());
+    for (Servers::const_iterator it = c.begin(); it != c.end(); ++it) {
+        hints.push_back((int)min(kMaxLoadHint,
+            max(int64_t(0), (*it)->GetLoadAvg()) * 100 / maxLoad));
+    }
+}
+
 int64_t
 LayoutManager::GetFreeIoBufferByteCount() const
 {
@@ -6823,31 +7174,18 @@ LayoutManager::GetFreeIoBufferByteCount() const
     );
 }
 
-class Pinger
+class Pinger : public LayoutManager::PingServersTotals
 {
     ostream&   os;
     const bool useFsTotalSpaceFlag;
 public:
-    uint64_t               totalSpace;
-    uint64_t               usedSpace;
-    uint64_t               freeFsSpace;
-    uint64_t               goodMasters;
-    uint64_t               goodSlaves;
-    uint64_t               writableDrives;
-    uint64_t               totalDrives;
     LayoutManager::Servers retiring;
     LayoutManager::Servers evacuating;
 
     Pinger(ostream& s, bool f)
-        : os(s),
+        : LayoutManager::PingServersTotals(),
+          os(s),
           useFsTotalSpaceFlag(f),
-          totalSpace(0),
-          usedSpace(0),
-          freeFsSpace(0),
-          goodMasters(0),
-          goodSlaves(0),
-          writableDrives(0),
-          totalDrives(0),
           retiring(),
           evacuating()
         {}
@@ -6908,17 +7246,34 @@ ShowTiersInfo(
 }
 
 void
-LayoutManager::Ping(IOBuffer& buf, bool wormModeFlag)
-{
-    if (! mPingResponse.IsEmpty() &&
-            TimeNow() < mPingUpdateTime + mPingUpdateInterval) {
-        buf.Copy(&mPingResponse, mPingResponse.BytesConsumable());
+LayoutManager::Ping(IOBuffer& buf, bool wormModeFlag,
+    int64_t notModifiedGeneration)
+{
+    if (mPingResponse.IsEmpty() ||
+            mPingUpdateTime + mPingUpdateInterval <= TimeNow()) {
+        UpdatePingResponse(wormModeFlag);
+    }
+    if (0 <= notModifiedGeneration &&
+            notModifiedGeneration == mPingGeneration) {
+        // The caller already has this snapshot, return the headers only.
+        mWOstream.Set(buf) <<
+            "Ping-generation: " << mPingGeneration << "\r\n"
+            "Not-modified: 1\r\n"
+            "\r\n"
+        ;
+        mWOstream.flush();
+        mWOstream.Reset();
         return;
     }
-    UpdateGoodCandidateLoadAvg();
-    mPingResponse.Clear();
-    IOBuffer tmpbuf;
-    mWOstream.Set(tmpbuf);
+    buf.Copy(&mPingResponse, mPingResponse.BytesConsumable());
+}
+
+void
+LayoutManager::UpdatePingServersResponse()
+{
+    mPingServersResponse.Clear();
+    mWOstream.Set(mPingServersResponse);
+    mPingServersUpdateTime = TimeNow();
     mWOstream <<
         "\r\n"
         "Servers: ";
@@ -6935,6 +7290,29 @@ LayoutManager::Ping(IOBuffer& buf, bool wormModeFlag)
         "Evacuating Servers: ";
     for_each(pinger.evacuating.begin(), pinger.evacuating.end(),
         bind(&ChunkServer::GetEvacuateStatus, _1, boost::ref(mWOstream)));
+    mWOstream.flush();
+    mWOstream.Reset();
+    mPingServersTotals = pinger;
+}
+
+void
+LayoutManager::UpdatePingResponse(bool wormModeFlag)
+{
+    UpdateGoodCandidateLoadAvg();
+    // The chunk server list walk and formatting cost is proportional to the
+    // number of chunk servers, therefore the server lists, and the totals
+    // computed by the walk, are updated less frequently than the rest of
+    // the status, which is formatted from the incrementally maintained
+    // counters.
+    if (mPingServersResponse.IsEmpty() ||
+            mPingServersUpdateTime + mPingServersUpdateInterval <=
+                TimeNow()) {
+        UpdatePingServersResponse();
+    }
+    const PingServersTotals& pinger = mPingServersTotals;
+    mPingResponse.Clear();
+    IOBuffer tmpbuf;
+    mWOstream.Set(tmpbuf);
     mWOstream <<
         "\r\n"
         "Down Servers: ";
@@ -6975,7 +7353,10 @@ LayoutManager::Ping(IOBuffer& buf, bool wormModeFlag)
     // Initial headers.
     mWOstream.Set(mPingResponse);
     mPingUpdateTime = TimeNow();
+    // Use time to make the generation unique across restarts.
+    mPingGeneration = max(mPingGeneration + 1, microseconds());
     mWOstream <<
+        "Ping-generation: "     << mPingGeneration << "\r\n"
         "Build-version: "       << KFS_BUILD_VERSION_STRING << "\r\n"
         "Source-version: "      << KFS_SOURCE_REVISION_STRING << "\r\n"
         "WORM: "                << (wormModeFlag ? "1" : "0") << "\r\n"
@@ -6989,18 +7370,32 @@ LayoutManager::Ping(IOBuffer& buf, bool wormModeFlag)
         "Pending recovery= "    << mChunkToServerMap.GetCount(
             CSMap::Entry::kStatePendingRecovery) << "\t"
         "Repl check timeouts= " << mReplicationCheckTimeouts << "\t"
+        "Repl rate= "           << mReplicationRate << "\t"
+        "Repl ETA= "            << GetReplicationEta() << "\t"
+        "Hot chunk boosts= "    << mHotChunkBoostCount << "\t"
         "Find repl timemoust= " << mReplicationFindWorkTimeouts << "\t"
         "Update time= "         << DisplayDateTime(kSecs2MicroSecs * mPingUpdateTime) << "\t"
         "Uptime= "              << (mPingUpdateTime - mStartTime) << "\t"
         "Buffers= "             <<
             (mBufferPool ? mBufferPool->GetUsedBufferCount() : 0) << "\t"
         "Clients= "             << ClientSM::GetClientCount() << "\t"
+        "Clients throttled= "   << ClientSM::GetThrottledCount() << "\t"
         "Chunk srvs= "          << ChunkServer::GetChunkServerCount() << "\t"
         "Requests= "            << MetaRequest::GetRequestCount() << "\t"
         "Sockets= "             << globals().ctrOpenNetFds.GetValue() << "\t"
         "Chunks= "              << mChunkToServerMap.Size() << "\t"
         "Pending replication= " << mChunkToServerMap.GetCount(
             CSMap::Entry::kStatePendingReplication) << "\t"
+        "Read lease chunks= "   <<
+            mChunkLeases.GetReadLeasesChunkCount() << "\t"
+        "Write leases= "        << mChunkLeases.GetWriteLeasesCount() << "\t"
+        "Lease expiration lag= ";
+    const int64_t* const lagHistogram =
+        mChunkLeases.GetExpirationLagHistogram();
+    for (int i = 0; i < ChunkLeases::kExpirationLagBucketCount; i++) {
+        mWOstream << (i == 0 ? "" : ",") << lagHistogram[i];
+    }
+    mWOstream << "\t"
         "Internal nodes= "      <<
             MetaNode::getPoolAllocator<Node>().GetInUseCount() << "\t"
         "Internal node size= "  <<
@@ -7019,6 +7414,8 @@ LayoutManager::Ping(IOBuffer& buf, bool wormModeFlag)
             MetaNode::getPoolAllocator<MetaFattr>().GetItemSize() << "\t"
         "Fattr nodes storage= "  <<
             MetaNode::getPoolAllocator<MetaFattr>().GetStorageSize() << "\t"
+        "Dentry name bytes= "  << MetaDentry::getNameBytes() << "\t"
+        "Bytes per i-node= "   << Tree::getBytesPerInode() << "\t"
         "ChunkInfo nodes= "      <<
             CSMap::Entry::GetAllocBlockCount() << "\t"
         "ChunkInfo node size= "  <<
@@ -7066,14 +7463,28 @@ LayoutManager::Ping(IOBuffer& buf, bool wormModeFlag)
             mObjBlocksDeleteInFlight.GetSize() << "\t"
         "Object store block retry deletes= " <<
             mObjBlocksDeleteRequeue.GetSize() << "\t"
+        "Object store scheduled deletes= " <<
+            mObjStoreDeletesScheduledCount << "\t"
+        "Object store done deletes= " << mObjStoreDeletesDoneCount << "\t"
+        "Object store retried deletes= " <<
+            mObjStoreDeletesRetryCount << "\t"
         "Object store first delete time= " <<
             (mObjStoreFilesDeleteQueue.IsEmpty() ? time_t(0) :
-                TimeNow() - mObjStoreFilesDeleteQueue.Front()->mTime)
+                TimeNow() - mObjStoreFilesDeleteQueue.Front()->mTime) << "\t"
+        "Checkpoint log compactor= " <<
+            mCheckpoint.GetOp().IsUsingLogCompactor() << "\t"
+        "Checkpoints= "            << mCheckpoint.GetOp().GetCount() << "\t"
+        "Checkpoint start usec= "  <<
+            mCheckpoint.GetOp().GetLastStallUsec() << "\t"
+        "Checkpoint time usec= "   <<
+            mCheckpoint.GetOp().GetLastDurationUsec() << "\t"
+        "Checkpoint size= "        << mCheckpoint.GetOp().GetLastSize()
     ;
     mWOstream.flush();
     mWOstream.Reset();
+    mPingResponse.Copy(&mPingServersResponse,
+        mPingServersResponse.BytesConsumable());
     mPingResponse.Move(&tmpbuf);
-    buf.Copy(&mPingResponse, mPingResponse.BytesConsumable());
 }
 
 class UpServersList
@@ -7118,8 +7529,11 @@ LayoutManager::LeaseCleanup()
 {
     const time_t now = TimeNow();
 
+    // Expired write leases issue make chunk stable RPCs, batch the flushes.
+    ChunkServer::BeginFlushBatch();
     mChunkLeases.Timer(now, mLeaseOwnerDownExpireDelay,
         mARAChunkCache, mChunkToServerMap);
+    ChunkServer::EndFlushBatch();
     if (now < mLeaseCleanerOtherNextRunTime) {
         return;
     }
@@ -8639,10 +9053,10 @@ LayoutManager::ReplicateChunk(
             if (recoveryInfo.HasRecovery()) {
                 reason     = "evacuation recovery";
                 dataServer = c;
-            } else if (ds.GetReplicationReadLoad() <
-                    mMaxConcurrentReadReplicationsPerNode &&
+            } else if (CanEvacuateReplicationRead(ds) &&
                     (ds.IsResponsiveServer() ||
-                        servers.size() <= 1)) {
+                        servers.size() <= 1) &&
+                    IsCrossRackReplicationAllowed(ds, cs)) {
                 dataServer = *iter;
             }
         } else if (recoveryInfo.HasRecovery()) {
@@ -8652,17 +9066,25 @@ LayoutManager::ReplicateChunk(
             reason = "re-replication";
         }
         // if we can't find a retiring server, pick a server that
-        // has read b/w available
-        for (Servers::const_iterator si = servers.begin();
-                ! dataServer && si != servers.end();
-                ++si) {
-            ChunkServer& ss = **si;
-            if (ss.GetReplicationReadLoad() >=
-                    mMaxConcurrentReadReplicationsPerNode ||
-                    ! ss.IsResponsiveServer()) {
-                continue;
+        // has read b/w available, prefer the servers in the same rack
+        // as the destination to keep the replication traffic off the
+        // inter rack links.
+        for (int pass = 0; ! dataServer && pass < 2; pass++) {
+            for (Servers::const_iterator si = servers.begin();
+                    ! dataServer && si != servers.end();
+                    ++si) {
+                ChunkServer& ss = **si;
+                if (ss.GetReplicationReadLoad() >=
+                        mMaxConcurrentReadReplicationsPerNode ||
+                        ! ss.IsResponsiveServer() ||
+                        (pass == 0 ?
+                            (ss.GetRack() < 0 ||
+                                ss.GetRack() != cs.GetRack()) :
+                            ! IsCrossRackReplicationAllowed(ss, cs))) {
+                    continue;
+                }
+                dataServer = *si;
             }
-            dataServer = *si;
         }
         if (! dataServer) {
             continue;
@@ -8693,6 +9115,7 @@ LayoutManager::ReplicateChunk(
             }
         } else {
             dataServer->UpdateReplicationReadLoad(1);
+            UpdateCrossRackReplications(*dataServer, cs, 1);
         }
         assert(mNumOngoingReplications >= 0);
         // Bump counters here, completion can be invoked
@@ -8848,8 +9271,7 @@ LayoutManager::CanReplicateChunkNow(
             (mUseEvacuationRecoveryFlag &&
                 recoveryInfo &&
                 servers.size() == 1 &&
-                servers.front()->GetReplicationReadLoad() >=
-                    mMaxConcurrentReadReplicationsPerNode &&
+                ! CanEvacuateReplicationRead(*servers.front()) &&
                 servers.front()->IsEvacuationScheduled(chunkId) &&
                 fa->numReplicas == 1 &&
                 fa->HasRecovery())) {
@@ -9048,7 +9470,8 @@ LayoutManager::CanReplicateChunkNow(
     // now, determine if we have sufficient copies
     // we need to make this many copies: # of servers that are
     // retiring plus the # this chunk is under-replicated
-    extraReplicas = fa->numReplicas + numRetiringServers -
+    const int hotExtraReplicas = GetHotChunkExtraReplicas(chunkId);
+    extraReplicas = fa->numReplicas + hotExtraReplicas + numRetiringServers -
         (int)servers.size();
     // Do not delete evacuated / retired replicas until there is sufficient
     // number of replicas, then delete all extra copies at once.
@@ -9079,6 +9502,7 @@ LayoutManager::CanReplicateChunkNow(
         " replicas: "   << servers.size() <<
         " retiring: "   << numRetiringServers <<
         " target: "     << fa->numReplicas <<
+        " hot: "        << hotExtraReplicas <<
         " rlease: "     << readLeaseWaitFlag <<
         " hibernated: " << hibernatedCount <<
         " needed: "     << extraReplicas <<
@@ -9121,9 +9545,20 @@ LayoutManager::CheckHibernatingServersStatus()
                 }
                 continue;
             }
+            if (find_if(mPendingHellos.begin(), mPendingHellos.end(),
+                    bind(&MetaHello::server, _1) == *i) !=
+                    mPendingHellos.end()) {
+                // Wait for the chunk inventory processing to complete,
+                // in order to release the hibernated slot references.
+                ++iter;
+                continue;
+            }
             KFS_LOG_STREAM_INFO <<
                 "hibernated server: " << iter->location  <<
-                " is back as promised" <<
+                " is back as promised"
+                " unaccounted chunks: " <<
+                    mChunkToServerMap.GetHibernatedChunkCount(
+                        iter->csmapIdx) <<
             KFS_LOG_EOM;
         } else {
             // server hasn't come back as promised...so, check
@@ -9333,12 +9768,25 @@ LayoutManager::HandoutChunkReplicationWork()
 
 void LayoutManager::Timeout()
 {
+    RunPendingHellos();
     ScheduleCleanup(mMaxServerCleanupScan);
 }
 
+void LayoutManager::RunPendingHellos()
+{
+    // Process one batch of each pending hello, in round robin order.
+    for (size_t cnt = mPendingHellos.size(); 0 < cnt; cnt--) {
+        MetaHello* const r = mPendingHellos.front();
+        mPendingHellos.pop_front();
+        r->suspended = false;
+        submit_request(r);
+    }
+}
+
 void LayoutManager::ScheduleCleanup(size_t maxScanCount /* = 1 */)
 {
-    if (mChunkToServerMap.RemoveServerCleanup(maxScanCount)) {
+    if (mChunkToServerMap.RemoveServerCleanup(maxScanCount) ||
+            ! mPendingHellos.empty()) {
         if (! mCleanupScheduledFlag) {
             mCleanupScheduledFlag = true;
             globalNetManager().RegisterTimeoutHandler(this);
@@ -9394,8 +9842,12 @@ LayoutManager::ChunkReplicationChecker()
         InitCheckAllChunks();
         mLastReplicationCheckTime = now;
     }
+    // Do not schedule replication or rebalance while chunk inventory of
+    // (re)connected servers is partially processed, as the chunks that
+    // aren't processed yet would appear under replicated.
     const bool runRebalanceFlag =
         ! recoveryFlag &&
+        mPendingHellos.empty() &&
         ! HandoutChunkReplicationWork() &&
         ! mCheckAllChunksInProgressFlag;
     if (fullCheckFlag) {
@@ -9416,9 +9868,138 @@ LayoutManager::ChunkReplicationChecker()
     }
     mReplicationTodoStats->Set(mChunkToServerMap.GetCount(
         CSMap::Entry::kStateCheckReplication));
+    UpdateReplicationRate(now);
+    CheckHotChunks(TimeNow());
     ScheduleCleanup(mMaxServerCleanupScan);
 }
 
+int
+LayoutManager::GetHotChunkExtraReplicas(chunkId_t chunkId) const
+{
+    if (mHotChunks.empty()) {
+        return 0;
+    }
+    HotChunks::const_iterator const it = mHotChunks.find(chunkId);
+    return (it == mHotChunks.end() ? 0 : it->second.extraReplicas);
+}
+
+void
+LayoutManager::UpdateHotChunk(MetaChunkInfo& chunkInfo)
+{
+    if (mHotChunkReadThreshold <= 0 || mHotChunkMaxExtraReplicas <= 0) {
+        return;
+    }
+    const CSMap::Entry&    entry = GetCsEntry(chunkInfo);
+    const MetaFattr* const fa    = entry.GetFattr();
+    if (fa->numReplicas <= 0 || fa->HasRecovery()) {
+        // Object store blocks have no replicas, and replicas of the chunks
+        // with recovery are sufficient to serve reads with the recovery.
+        return;
+    }
+    HotChunk& hot = mHotChunks[chunkInfo.chunkId];
+    if (++hot.readCount != mHotChunkReadThreshold) {
+        return;
+    }
+    // Add at most one replica per interval, in order to give the already
+    // added replicas a chance to take the load, and bound the number of
+    // replications in flight.
+    hot.hotTime = TimeNow();
+    const int maxExtra = min(mHotChunkMaxExtraReplicas,
+        (int)mMaxReplicasPerFile - (int)fa->numReplicas);
+    if (maxExtra <= hot.extraReplicas) {
+        return;
+    }
+    hot.extraReplicas++;
+    mHotChunkBoostCount++;
+    KFS_LOG_STREAM_INFO <<
+        "hot chunk:"
+        " <" << entry.GetFileId() << "," << chunkInfo.chunkId << ">"
+        " reads: "       << hot.readCount <<
+        " interval: "    << mHotChunkIntervalSec <<
+        " replication: " << fa->numReplicas <<
+        " extra: "       << hot.extraReplicas <<
+    KFS_LOG_EOM;
+    ChangeChunkReplication(chunkInfo.chunkId);
+}
+
+void
+LayoutManager::CheckHotChunks(time_t now)
+{
+    if (now < mHotChunkNextCheckTime) {
+        return;
+    }
+    mHotChunkNextCheckTime = now + mHotChunkIntervalSec;
+    const bool disabledFlag =
+        mHotChunkReadThreshold <= 0 || mHotChunkMaxExtraReplicas <= 0;
+    HotChunks::iterator it = mHotChunks.begin();
+    while (it != mHotChunks.end()) {
+        HotChunk& hot = it->second;
+        if (! disabledFlag && mHotChunkReadThreshold <= hot.readCount) {
+            hot.readCount = 0;
+            ++it;
+            continue;
+        }
+        hot.readCount = 0;
+        if (! disabledFlag && 0 < hot.extraReplicas &&
+                now < hot.hotTime + mHotChunkColdTimeoutSec) {
+            ++it;
+            continue;
+        }
+        const chunkId_t chunkId       = it->first;
+        const int       extraReplicas = hot.extraReplicas;
+        mHotChunks.erase(it++);
+        if (0 < extraReplicas) {
+            KFS_LOG_STREAM_INFO <<
+                "cold chunk: " << chunkId <<
+                " removing extra replicas: " << extraReplicas <<
+            KFS_LOG_EOM;
+            ChangeChunkReplication(chunkId);
+        }
+    }
+}
+
+void
+LayoutManager::UpdateReplicationRate(int64_t now)
+{
+    const int64_t kSampleInterval = 10 * kSecs2MicroSecs;
+    if (mReplicationRateSampleTime <= 0) {
+        mReplicationRateSampleTime  = now;
+        mReplicationRateSampleCount = mReplicationsDoneCount;
+        return;
+    }
+    if (now < mReplicationRateSampleTime + kSampleInterval) {
+        return;
+    }
+    const double rate = (double)(mReplicationsDoneCount -
+        mReplicationRateSampleCount) * kSecs2MicroSecs /
+        (double)(now - mReplicationRateSampleTime);
+    // Exponential moving average, with the weight of the last sample 1/4.
+    mReplicationRate = mReplicationRate * 0.75 + rate * 0.25;
+    mReplicationRateSampleTime  = now;
+    mReplicationRateSampleCount = mReplicationsDoneCount;
+}
+
+int64_t
+LayoutManager::GetReplicationEta() const
+{
+    // Projected time in seconds to complete the present re-replication and
+    // recovery backlog at the recent completion rate, or -1 if unknown.
+    const int64_t backlog = (int64_t)mNumOngoingReplications +
+        (int64_t)mChunkToServerMap.GetCount(
+            CSMap::Entry::kStateCheckReplication) +
+        (int64_t)mChunkToServerMap.GetCount(
+            CSMap::Entry::kStateNoDestination) +
+        (int64_t)mChunkToServerMap.GetCount(
+            CSMap::Entry::kStatePendingRecovery);
+    if (backlog <= 0) {
+        return 0;
+    }
+    if (mReplicationRate < 1e-3) {
+        return -1;
+    }
+    return (int64_t)(backlog / mReplicationRate);
+}
+
 void
 LayoutManager::ChunkReplicationDone(MetaChunkReplicate* req)
 {
@@ -9464,6 +10045,7 @@ LayoutManager::ChunkReplicationDone(MetaChunkReplicate* req)
         req->server->ReplicateChunkDone(req->chunkId);
         if (replicationFlag && req->dataServer) {
             req->dataServer->UpdateReplicationReadLoad(-1);
+            UpdateCrossRackReplications(*req->dataServer, *req->server, -1);
         }
         req->dataServer.reset();
     }
@@ -9609,6 +10191,7 @@ LayoutManager::ChunkReplicationDone(MetaChunkReplicate* req)
         return;
     }
     UpdateReplicationState(*ci);
+    mReplicationsDoneCount++;
     // Yaeee...all good...
     KFS_LOG_STREAM_DEBUG <<
         req->server->GetServerLocation() <<
@@ -11293,6 +11876,7 @@ LayoutManager::DeleteFileBlocks(fid_t fid, chunkOff_t first, chunkOff_t last,
             mObjBlocksDeleteInFlight.Insert(
                 entry.GetKey(), entry.GetVal(), insertedFlag);
             if (insertedFlag) {
+                mObjStoreDeletesScheduledCount++;
                 mChunkServers[mObjStoreDeleteSrvIdx++
                     ]->DeleteChunkVers(fid, chunkVersion);
             }
@@ -11322,16 +11906,21 @@ struct MetaClearObjStoreDelete : public MetaRequest
 void
 LayoutManager::Done(MetaChunkDelete& req)
 {
+    if (req.server) {
+        req.server->ChunkDeleteDone(req);
+    }
     if (0 <= req.chunkVersion ||
             mObjBlocksDeleteInFlight.Erase(ObjBlocksDeleteInFlightEntry::Key(
                 req.chunkId, req.chunkVersion)) <= 0) {
         return;
     }
     if (0 != req.status && -ENOENT != req.status) {
+        mObjStoreDeletesRetryCount++;
         mObjBlocksDeleteRequeue.PushBack(
             make_pair(req.chunkId, -req.chunkVersion - 1));
         return; // Do not re-queue it immediately.
     }
+    mObjStoreDeletesDoneCount++;
     if (mObjBlocksDeleteInFlight.IsEmpty() &&
             mObjBlocksDeleteRequeue.IsEmpty() &&
                 mObjStoreFilesDeleteQueue.IsEmpty()) {
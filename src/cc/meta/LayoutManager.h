@@ -121,6 +121,9 @@ public:
             { return (second < 0); }
     };
     enum { kLeaseTimerResolutionSec = 4 }; // Power of two to optimize division.
+    // Lease expiration lag histogram buckets: [0, 1), [1, 2), [2, 4) ...
+    // seconds, with the last bucket counting all larger lags.
+    enum { kExpirationLagBucketCount = 8 };
     typedef int64_t LeaseId;
     typedef DelegationToken::TokenSeq TokenSeq;
     struct ReadLease
@@ -300,6 +303,12 @@ public:
         LeaseId leaseId);
     bool IsEmpty() const
         { return (mReadLeases.IsEmpty() && mWriteLeases.IsEmpty()); }
+    size_t GetReadLeasesChunkCount() const
+        { return mReadLeases.GetSize(); }
+    size_t GetWriteLeasesCount() const
+        { return mWriteLeases.GetSize(); }
+    const int64_t* GetExpirationLagHistogram() const
+        { return mExpirationLagHistogram; }
 
 private:
     class EntryKeyHash
@@ -499,7 +508,18 @@ private:
     ReadLeaseTimer  mReadLeaseTimer;
     WriteLeaseTimer mWriteLeaseTimer;
     WEntry          mWAllocationInFlightList;
+    int64_t         mExpirationLagHistogram[kExpirationLagBucketCount];
 
+    void UpdateExpirationLag(
+        time_t lag)
+    {
+        int i = 0;
+        for (time_t t = lag; 0 < t && i < kExpirationLagBucketCount - 1;
+                t >>= 1) {
+            i++;
+        }
+        mExpirationLagHistogram[i]++;
+    }
     void PutInExpirationList(
         WEntry& entry)
     {
@@ -1117,6 +1137,7 @@ public:
     void CancelPendingMakeStable(fid_t fid, chunkId_t chunkId);
     int GetChunkSizeDone(MetaChunkSize* req);
     bool IsChunkStable(chunkId_t chunkId);
+    void AddHelloChunks(MetaHello& hello);
     const char* AddNotStableChunk(
         const ChunkServerPtr& server,
         chunkId_t             chunkId,
@@ -1151,6 +1172,14 @@ public:
     int GetChunkToServerMapping(MetaChunkInfo& chunkInfo, Servers &c,
         MetaFattr*& fa, bool* orderReplicasFlag = 0);
 
+    /// Get the chunk servers load hints for the clients.
+    /// @param[in] c   chunk servers
+    /// @param[out] hints  server load in percents of the max. "good" placement
+    /// candidate load, the value 100 or greater means that the server is
+    /// overloaded; empty if load hints are disabled
+    ///
+    void GetServersLoadHints(const Servers& c, vector<int>& hints);
+
     /// Get the mapping from chunkId -> file id.
     /// @param[in] chunkId  chunkId
     /// @param[out] fileId  file id the chunk belongs to
@@ -1167,7 +1196,9 @@ public:
     void DumpChunkToServerMap(const string &dir);
 
     /// Dump out the chunk location map to a string stream.
-    void DumpChunkToServerMap(ostream &os);
+    /// With shardCount greater than 1, only every shardCount map entry
+    /// starting from shard is written.
+    void DumpChunkToServerMap(ostream &os, int shard = 0, int shardCount = 1);
 
     /// Dump out the list of chunks that are currently replication
     /// candidates.
@@ -1181,7 +1212,31 @@ public:
 
     /// For monitoring purposes, dump out state of all the
     /// connected chunk servers.
-    void Ping(IOBuffer& buf, bool wormModeFlag);
+    // If notModifiedGeneration matches the current status snapshot
+    // generation, then only the generation and "Not-modified" headers are
+    // returned.
+    void Ping(IOBuffer& buf, bool wormModeFlag,
+        int64_t notModifiedGeneration = -1);
+    // Chunk servers totals computed by the ping server list walk.
+    struct PingServersTotals
+    {
+        PingServersTotals()
+            : totalSpace(0),
+              usedSpace(0),
+              freeFsSpace(0),
+              goodMasters(0),
+              goodSlaves(0),
+              writableDrives(0),
+              totalDrives(0)
+            {}
+        uint64_t totalSpace;
+        uint64_t usedSpace;
+        uint64_t freeFsSpace;
+        uint64_t goodMasters;
+        uint64_t goodSlaves;
+        uint64_t writableDrives;
+        uint64_t totalDrives;
+    };
 
     /// Return a list of alive chunk servers
     void UpServers(ostream &os);
@@ -1230,6 +1285,10 @@ public:
     ///
     void ChangeChunkReplication(chunkId_t chunkId);
 
+    /// Count chunk read lease / get alloc, and schedule extra replicas
+    /// creation if the chunk becomes "hot".
+    void UpdateHotChunk(MetaChunkInfo& chunkInfo);
+
     /// Get all the fid's for which there is an open lease (read/write).
     /// This is useful for reporting purposes.
     /// @param[out] openForRead, openForWrite: the pathnames of files
@@ -1351,6 +1410,8 @@ public:
         int                    deltaNumChunkWrites,
         int                    deltaNumWritableDrives,
         const StorageTierInfo* tiersDelta);
+    // Count chunk allocation or replication placed onto the server.
+    void ChunkPlaced(ChunkServer& srv);
 
     // Unix style permissions
     kfsUid_t GetDefaultUser() const
@@ -1382,7 +1443,10 @@ public:
         if (mForceEUserToRootFlag) {
             req.euser = kKfsUserRoot;
         }
-        if (req.euser != kKfsUserRoot || mRootHosts.empty()) {
+        if (req.euser != kKfsUserRoot || mRootHosts.empty() ||
+                (! req.fromClientSMFlag && req.clientIp.empty())) {
+            // Internal requests, for example the trash emptier requests,
+            // aren't subject to the root hosts restriction.
             return;
         }
         if (mRootHosts.find(req.clientIp) == mRootHosts.end()) {
@@ -2051,6 +2115,56 @@ protected:
     ///
     int     mMaxConcurrentWriteReplicationsPerNode;
     int     mMaxConcurrentReadReplicationsPerNode;
+    /// Max # of evacuation chunks that retiring or evacuating node is
+    /// allowed to send out, in order to drain the node at near disk
+    /// bandwidth to multiple destinations in parallel.
+    /// Negative -- same as mMaxConcurrentReadReplicationsPerNode.
+    int     mMaxConcurrentEvacuationReadReplicationsPerNode;
+    /// Max # of concurrent re-replications crossing rack boundary per rack,
+    /// counted for both source and destination racks. 0 -- no limit.
+    int     mMaxConcurrentCrossRackReplicationsPerRack;
+    typedef map<
+        RackId,
+        int,
+        less<RackId>,
+        StdFastAllocator<pair<const RackId, int> >
+    > CrossRackReplications;
+    CrossRackReplications mCrossRackReplications;
+    /// Hot chunk read replica scaling. The chunks with the read lease and
+    /// get alloc rate at or above the threshold (per interval) get extra
+    /// replicas, one more for each interval the chunk stays hot, up to the
+    /// max. The extra replicas are deleted once the chunk stays cold for
+    /// the cold timeout. 0 threshold -- disabled.
+    struct HotChunk
+    {
+        HotChunk()
+            : readCount(0),
+              extraReplicas(0),
+              hotTime(0)
+            {}
+        int    readCount;
+        int    extraReplicas;
+        time_t hotTime;
+    };
+    typedef map<
+        chunkId_t,
+        HotChunk,
+        less<chunkId_t>,
+        StdFastAllocator<pair<const chunkId_t, HotChunk> >
+    > HotChunks;
+    HotChunks mHotChunks;
+    int       mHotChunkReadThreshold;
+    int       mHotChunkIntervalSec;
+    int       mHotChunkMaxExtraReplicas;
+    int       mHotChunkColdTimeoutSec;
+    time_t    mHotChunkNextCheckTime;
+    int64_t   mHotChunkBoostCount;
+    /// Re-replication / recovery completion rate, used to report the
+    /// projected time to full redundancy.
+    int64_t mReplicationsDoneCount;
+    int64_t mReplicationRateSampleTime;
+    int64_t mReplicationRateSampleCount;
+    double  mReplicationRate;
     bool    mUseEvacuationRecoveryFlag;
     int64_t mReplicationFindWorkTimeouts;
     /// How much do we spend on each internal RPC in chunk-replication-check to handout
@@ -2081,6 +2195,7 @@ protected:
     int64_t       mCompleteReplicationCheckTime;
     int64_t       mPastEofRecoveryDelay;
     size_t        mMaxServerCleanupScan;
+    size_t        mMaxHelloChunksPerIteration;
     int           mMaxRebalanceScan;
     double        mRebalanceReplicationsThreshold;
     int64_t       mRebalanceReplicationsThresholdCount;
@@ -2092,6 +2207,9 @@ protected:
     RebalanceCtrs mRebalanceCtrs;
     ifstream      mRebalancePlan;
     bool          mCleanupScheduledFlag;
+    // Hello requests with partially processed chunk inventory.
+    typedef deque<MetaHello*> PendingHellos;
+    PendingHellos mPendingHellos;
 
     int                mCSCountersUpdateInterval;
     time_t             mCSCountersUpdateTime;
@@ -2101,7 +2219,13 @@ protected:
     IOBuffer           mCSDirCountersResponse;
     int                mPingUpdateInterval;
     time_t             mPingUpdateTime;
+    int64_t            mPingGeneration;
     IOBuffer           mPingResponse;
+    int                mPingServersUpdateInterval;
+    time_t             mPingServersUpdateTime;
+    IOBuffer           mPingServersResponse;
+    PingServersTotals  mPingServersTotals;
+    int                mChunkMapDumpShards;
     IOBuffer::WOStream mWOstream;
     QCIoBufferPool*    mBufferPool;
     bool               mMightHaveRetiringServersFlag;
@@ -2158,6 +2282,7 @@ protected:
     int16_t mMaxReplicasPerFile;
     int16_t mMaxReplicasPerRSFile;
     bool    mGetAllocOrderServersByLoadFlag;
+    bool    mGetAllocLoadHintsFlag;
     int     mMinChunkAllocClientProtoVersion;
 
     int     mMaxResponseSize;
@@ -2174,6 +2299,15 @@ protected:
     double  mMaxWritesPerDriveRatio;
     double  mMaxLocalPlacementWeight;
     double  mTotalWritableDrivesMult;
+    // Chunks placed per drive rate limit, in order to spread writes across
+    // servers: the chunks opened for write limit alone does not prevent
+    // newly added empty servers from receiving most of the short lived
+    // writes, if the placement prefers servers with lower utilization.
+    int     mPlacementRateWindowSec;
+    double  mMaxPlacementRatePerDriveRatio;
+    time_t  mPlacementWindowStart;
+    int64_t mPlacedCount;
+    int64_t mPrevPlacedCount;
     string  mConfig;
     Properties mConfigParameters;
 
@@ -2232,6 +2366,7 @@ protected:
     bool              mClientCSAuthRequiredFlag;
     bool              mClientCSAllowClearTextFlag;
     int               mCSAccessValidForTimeSec;
+    int               mStableChunkReadLeaseTimeout;
     int               mMinWriteLeaseTimeSec;
     bool              mFileSystemIdRequiredFlag;
     bool              mDeleteChunkOnFsIdMismatchFlag;
@@ -2258,6 +2393,9 @@ protected:
     ObjStoreFilesDeleteQueue mObjStoreFilesDeleteQueue;
     ObjBlocksDeleteRequeue   mObjBlocksDeleteRequeue;
     ObjBlocksDeleteInFlight  mObjBlocksDeleteInFlight;
+    int64_t                  mObjStoreDeletesScheduledCount;
+    int64_t                  mObjStoreDeletesDoneCount;
+    int64_t                  mObjStoreDeletesRetryCount;
 
     BufferInputStream                   mTmpParseStream;
     StTmp<vector<MetaChunkInfo*> >::Tmp mChunkInfosTmp;
@@ -2370,12 +2508,24 @@ protected:
     bool AddReplica(CSMap::Entry& entry, const ChunkServerPtr& c);
     void CheckChunkReplication(CSMap::Entry& entry);
     inline void UpdateReplicationState(CSMap::Entry& entry);
-    inline void SetReplicationState(CSMap::Entry& entry, CSMap::Entry::State state);
+    inline void SetReplicationState(CSMap::Entry& entry, CSMap::Entry::State state,
+        bool frontFlag = false);
 
     inline seq_t GetChunkVersionRollBack(chunkId_t chunkId);
     inline seq_t IncrementChunkVersionRollBack(chunkId_t chunkId);
     inline void UpdatePendingRecovery(CSMap::Entry& entry);
     inline void CheckReplication(CSMap::Entry& entry);
+    inline void UpdatePlacementWindow();
+    inline bool IsPlacementRateOk(const ChunkServer& srv);
+    inline bool CanEvacuateReplicationRead(const ChunkServer& srv) const;
+    inline bool IsCrossRackReplicationAllowed(
+        const ChunkServer& src, const ChunkServer& dst) const;
+    inline void UpdateCrossRackReplications(
+        const ChunkServer& src, const ChunkServer& dst, int delta);
+    void UpdateReplicationRate(int64_t now);
+    int GetHotChunkExtraReplicas(chunkId_t chunkId) const;
+    void CheckHotChunks(time_t now);
+    int64_t GetReplicationEta() const;
     bool GetPlacementExcludes(const CSMap::Entry& entry, ChunkPlacement& placement,
         bool includeThisChunkFlag = true,
         bool stopIfHasAnyReplicationsInFlight = false,
@@ -2384,10 +2534,14 @@ protected:
     RackId GetRackId(const ServerLocation& loc) const;
     RackId GetRackId(const string& loc) const;
     void ScheduleCleanup(size_t maxScanCount = 1);
+    void RunPendingHellos();
     void RemoveRetiring(CSMap::Entry& ci, Servers& servers, int numReplicas,
         bool deleteRetiringFlag = false);
     void DeleteChunk(fid_t fid, chunkId_t chunkId, const Servers& servers);
     void UpdateGoodCandidateLoadAvg();
+    void UpdatePingResponse(bool wormModeFlag);
+    void UpdatePingServersResponse();
+    void RemoveChunkToServerMapShards(const string& fn, int start);
     inline static CSMap::Entry& GetCsEntry(MetaChunkInfo& chunkInfo);
     inline static CSMap::Entry* GetCsEntry(MetaChunkInfo* chunkInfo);
     bool CanBeRecovered(
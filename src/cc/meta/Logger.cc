@@ -31,8 +31,20 @@
 #include "common/MsgLogger.h"
 #include "kfsio/Globals.h"
 #include "NetDispatch.h"
+#include "ChunkServer.h"
+#include "common/Properties.h"
+#include "qcdio/QCMutex.h"
+#include "qcdio/QCThread.h"
+#include "qcdio/QCUtils.h"
+#include "qcdio/qcstutils.h"
 
 #include <iomanip>
+#include <algorithm>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/uio.h>
 
 namespace KFS
 {
@@ -40,14 +52,300 @@ using std::hex;
 using std::dec;
 using std::ofstream;
 using std::ifstream;
+using std::max;
+using std::make_pair;
 using libkfsio::globalNetManager;
+using libkfsio::globals;
 
 // default values
 string LOGDIR("./kfslog");
 string LASTLOG(LOGDIR + "/last");
 
+/*!
+ * \brief log writer.
+ *
+ * Without the writer thread the log records are written synchronously by the
+ * caller, which is equivalent to flushing the log stream after each record.
+ * With the thread started, the records are queued, and the thread writes all
+ * records queued since its last write with a single writev(), followed by
+ * optional fdatasync(). The thread then wakes up the main net manager, and
+ * the logger dispatches requests with the records on disk. The writer can
+ * optionally delay the write up to the max wait time, unless the max batch
+ * size is reached, in order to increase the group size.
+ */
+class Logger::Writer : public QCRunnable
+{
+public:
+    Writer()
+        : QCRunnable(),
+          mMutex(),
+          mWorkCond(),
+          mDoneCond(),
+          mThread(),
+          mQueue(),
+          mQueuedSeq(0),
+          mWrittenSeq(0),
+          mQueueStartTime(0),
+          mFd(-1),
+          mError(0),
+          mMaxBatchBytes(4 << 20),
+          mMaxWaitUsec(0),
+          mSyncFlag(false),
+          mStopFlag(false),
+          mBusyFlag(false),
+          mWriteCounter("Log writes"),
+          mWriteBytesCounter("Log bytes written")
+    {
+        globals().counterManager.AddCounter(&mWriteCounter);
+        globals().counterManager.AddCounter(&mWriteBytesCounter);
+    }
+    ~Writer()
+    {
+        Writer::Stop();
+        globals().counterManager.RemoveCounter(&mWriteCounter);
+        globals().counterManager.RemoveCounter(&mWriteBytesCounter);
+    }
+    bool Start()
+    {
+        if (mThread.IsStarted()) {
+            return true;
+        }
+        mStopFlag = false;
+        const int kStackSize = 64 << 10;
+        const int err = mThread.TryToStart(this, kStackSize, "LogWriter");
+        if (err) {
+            KFS_LOG_STREAM_ERROR << QCUtils::SysError(
+                err, "failed to start log writer thread") <<
+            KFS_LOG_EOM;
+        }
+        return (err == 0);
+    }
+    void Stop()
+    {
+        if (! mThread.IsStarted()) {
+            return;
+        }
+        QCStMutexLocker locker(mMutex);
+        mStopFlag = true;
+        mWorkCond.Notify();
+        locker.Unlock();
+        mThread.Join();
+    }
+    bool IsRunning() const
+        { return mThread.IsStarted(); }
+    void SetParameters(int maxBatchBytes, int maxWaitUsec, bool syncFlag)
+    {
+        QCStMutexLocker locker(mMutex);
+        mMaxBatchBytes = max(1, maxBatchBytes);
+        mMaxWaitUsec   = max(0, maxWaitUsec);
+        mSyncFlag      = syncFlag;
+        mWorkCond.Notify();
+    }
+    //!< queue records, and return error if any
+    int Submit(IOBuffer& buf, seq_t seq)
+    {
+        if (! mThread.IsStarted()) {
+            // No group commit, write right away.
+            int ret = mError;
+            if (ret == 0) {
+                const int64_t start = microseconds();
+                const int     bytes = buf.BytesConsumable();
+                ret = WriteAndSync(mFd, buf, mSyncFlag);
+                UpdateStats(bytes, microseconds() - start);
+                if (ret == 0) {
+                    mWrittenSeq = seq;
+                } else {
+                    mError = ret;
+                }
+            }
+            buf.Clear();
+            return ret;
+        }
+        QCStMutexLocker locker(mMutex);
+        if (mQueue.IsEmpty()) {
+            mQueueStartTime = microseconds();
+        }
+        mQueue.Move(&buf);
+        mQueuedSeq = seq;
+        if (! mBusyFlag) {
+            mWorkCond.Notify();
+        }
+        return mError;
+    }
+    //!< get highest seq. number on disk
+    int GetWritten(seq_t& seq)
+    {
+        QCStMutexLocker locker(mMutex);
+        seq = mWrittenSeq;
+        return mError;
+    }
+    //!< wait for all queued records to be written
+    int Drain(seq_t& seq)
+    {
+        QCStMutexLocker locker(mMutex);
+        while (mError == 0 && (mBusyFlag || ! mQueue.IsEmpty()) &&
+                mThread.IsStarted()) {
+            mWorkCond.Notify();
+            mDoneCond.Wait(mMutex);
+        }
+        seq = mWrittenSeq;
+        return mError;
+    }
+    //!< set file descriptor, the queue must be drained prior to this call
+    void SetFd(int fd)
+    {
+        QCStMutexLocker locker(mMutex);
+        assert(! mBusyFlag && mQueue.IsEmpty());
+        mFd = fd;
+    }
+    virtual void Run()
+    {
+        QCStMutexLocker locker(mMutex);
+        for (; ;) {
+            while (! mStopFlag && mQueue.IsEmpty()) {
+                mWorkCond.Wait(mMutex);
+            }
+            // Delay the write to gather a larger batch, if configured.
+            while (! mStopFlag && 0 < mMaxWaitUsec &&
+                    mQueue.BytesConsumable() < mMaxBatchBytes) {
+                const int64_t wait =
+                    mQueueStartTime + mMaxWaitUsec - microseconds();
+                if (wait <= 0) {
+                    break;
+                }
+                mWorkCond.Wait(mMutex, QCCondVar::Time(wait) * 1000);
+            }
+            if (mQueue.IsEmpty()) {
+                if (mStopFlag) {
+                    break;
+                }
+                continue;
+            }
+            IOBuffer   batch;
+            batch.Move(&mQueue);
+            const seq_t seq      = mQueuedSeq;
+            const int   fd       = mFd;
+            const bool  syncFlag = mSyncFlag;
+            const int   bytes    = batch.BytesConsumable();
+            mBusyFlag = true;
+            locker.Unlock();
+            const int64_t start = microseconds();
+            const int     err   = WriteAndSync(fd, batch, syncFlag);
+            const int64_t end   = microseconds();
+            batch.Clear();
+            locker.Lock();
+            mBusyFlag = false;
+            UpdateStats(bytes, end - start);
+            if (err == 0) {
+                mWrittenSeq = seq;
+            } else if (mError == 0) {
+                mError = err;
+            }
+            mDoneCond.NotifyAll();
+            locker.Unlock();
+            globalNetManager().Wakeup();
+            locker.Lock();
+        }
+        mDoneCond.NotifyAll();
+    }
+private:
+    QCMutex   mMutex;
+    QCCondVar mWorkCond;
+    QCCondVar mDoneCond;
+    QCThread  mThread;
+    IOBuffer  mQueue;
+    seq_t     mQueuedSeq;
+    seq_t     mWrittenSeq;
+    int64_t   mQueueStartTime;
+    int       mFd;
+    int       mError;
+    int       mMaxBatchBytes;
+    int       mMaxWaitUsec;
+    bool      mSyncFlag;
+    bool      mStopFlag;
+    bool      mBusyFlag;
+    Counter   mWriteCounter;
+    Counter   mWriteBytesCounter;
+
+    void UpdateStats(int bytes, int64_t timeUsec)
+    {
+        // Counter updates are atomic.
+        mWriteCounter.Update(1);
+        mWriteCounter.UpdateTime(timeUsec);
+        mWriteBytesCounter.Update(bytes);
+    }
+    static int WriteAndSync(int fd, IOBuffer& buf, bool syncFlag)
+    {
+        if (fd < 0) {
+            return (buf.IsEmpty() ? 0 : -EBADF);
+        }
+        // Do not use IOBuffer::Write(), as it updates global network
+        // counters, which aren't thread safe.
+        const int    kMaxWriteVecs = 64;
+        struct iovec writeVec[kMaxWriteVecs];
+        while (! buf.IsEmpty()) {
+            int cnt = 0;
+            for (IOBuffer::iterator it = buf.begin();
+                    it != buf.end() && cnt < kMaxWriteVecs;
+                    ++it) {
+                const int nBytes = it->BytesConsumable();
+                if (nBytes <= 0) {
+                    continue;
+                }
+                writeVec[cnt].iov_base = const_cast<char*>(it->Consumer());
+                writeVec[cnt].iov_len  = (size_t)nBytes;
+                cnt++;
+            }
+            const ssize_t nWr = writev(fd, writeVec, cnt);
+            if (nWr < 0) {
+                const int err = errno;
+                if (err == EINTR) {
+                    continue;
+                }
+                return (err > 0 ? -err : -EIO);
+            }
+            buf.Consume((int)nWr);
+        }
+        if (syncFlag && fdatasync(fd)) {
+            const int err = errno;
+            return (err > 0 ? -err : -EIO);
+        }
+        return 0;
+    }
+private:
+    Writer(const Writer&);
+    Writer& operator=(const Writer&);
+};
+
 Logger oplog(LOGDIR);
 
+Logger::Logger(string d)
+    : ITimeout(),
+      logdir(d),
+      lognum(-1),
+      logname(),
+      logfd(-1),
+      logerr(0),
+      mPending(),
+      mPendingStream(),
+      md(),
+      logstream(md),
+      nextseq(0),
+      committed(0),
+      incp(0),
+      mLastLogged(0),
+      mPendingDispatch(),
+      mWriter(*(new Writer()))
+{
+    mPendingStream.Set(mPending);
+}
+
+Logger::~Logger()
+{
+    shutdown();
+    delete &mWriter;
+}
+
 void
 Logger::dispatch(MetaRequest *r)
 {
@@ -58,7 +356,13 @@ Logger::dispatch(MetaRequest *r)
         }
         cp.note_mutation();
     }
-    gNetDispatch.Dispatch(r);
+    if (mPendingDispatch.empty() && mLastLogged <= committed) {
+        gNetDispatch.Dispatch(r);
+    } else {
+        // Preserve the dispatch order, the request can depend on the
+        // mutations which are not on disk yet.
+        mPendingDispatch.push_back(make_pair(mLastLogged, r));
+    }
 }
 
 /*!
@@ -69,11 +373,111 @@ Logger::log(MetaRequest *r)
 {
     const int res = r->log(logstream);
     if (res >= 0) {
-        flushResult(r);
+        mLastLogged = r->seqno;
+        submitPending();
     }
     return res;
 }
 
+/*!
+ * \brief hand off the log records to the writer.
+ */
+void
+Logger::submitPending()
+{
+    logstream.flush();
+    if (logfd < 0) {
+        // The log isn't open yet, for example during the startup dumpster
+        // cleanup: nothing to write.
+        mPending.Clear();
+        committed = max(committed, mLastLogged);
+        return;
+    }
+    if (mPending.IsEmpty()) {
+        return;
+    }
+    const int err = mWriter.Submit(mPending, mLastLogged);
+    if (err != 0 && logerr == 0) {
+        logerr = err;
+    }
+    if (fail()) {
+        panic("Logger::submitPending " + QCUtils::SysError(-logerr), false);
+    }
+    updateCommitted();
+}
+
+/*!
+ * \brief update the highest sequence number on disk, and dispatch the
+ * requests waiting for their log records to be written.
+ */
+void
+Logger::updateCommitted()
+{
+    seq_t     written = committed;
+    const int err     = mWriter.GetWritten(written);
+    if (err != 0) {
+        logerr = err;
+        panic("Logger::updateCommitted " + QCUtils::SysError(-err), false);
+        return;
+    }
+    if (committed < written) {
+        committed = written;
+    }
+    if (mPendingDispatch.empty() ||
+            committed < mPendingDispatch.front().first) {
+        return;
+    }
+    // Batch chunk server RPCs, such as make chunk stable, issued by the
+    // committed requests.
+    ChunkServer::BeginFlushBatch();
+    while (! mPendingDispatch.empty() &&
+            mPendingDispatch.front().first <= committed) {
+        MetaRequest* const req = mPendingDispatch.front().second;
+        mPendingDispatch.pop_front();
+        gNetDispatch.Dispatch(req);
+    }
+    ChunkServer::EndFlushBatch();
+}
+
+/*!
+ * \brief invoked from the net manager event loop, with the global mutex
+ * held, in order to dispatch requests committed by the writer thread.
+ */
+void
+Logger::Timeout()
+{
+    if (mPendingDispatch.empty()) {
+        return;
+    }
+    updateCommitted();
+}
+
+/*!
+ * \brief write all pending log records and wait for the writes to complete.
+ * \return      0 if successful, negative on I/O error
+ */
+int
+Logger::writePending()
+{
+    logstream.flush();
+    if (! mPending.IsEmpty()) {
+        const int err = mWriter.Submit(mPending, mLastLogged);
+        if (err != 0 && logerr == 0) {
+            logerr = err;
+        }
+    }
+    seq_t     written = committed;
+    const int err     = mWriter.Drain(written);
+    if (err != 0 && logerr == 0) {
+        logerr = err;
+    }
+    if (fail()) {
+        return (logerr != 0 ? logerr : -EIO);
+    }
+    updateCommitted();
+    return 0;
+}
+
 /*!
  * \brief flush log entries to disk
  *
@@ -83,13 +487,92 @@ Logger::log(MetaRequest *r)
 void
 Logger::flushLog()
 {
-    seq_t last = nextseq;
-
-    logstream.flush();
-    if (fail()) {
+    if (writePending() != 0) {
         panic("Logger::flushLog", true);
     }
-    committed = last;
+}
+
+/*!
+ * \brief open the log file and pass it to the writer
+ */
+int
+Logger::openLog(bool appendFlag)
+{
+    closeLog();
+    logfd = open(logname.c_str(), O_WRONLY | O_CREAT |
+        (appendFlag ? O_APPEND : O_TRUNC), 0666);
+    if (logfd < 0) {
+        const int err = errno;
+        logerr = err > 0 ? -err : -EIO;
+        KFS_LOG_STREAM_ERROR << logname << ": " <<
+            QCUtils::SysError(err) <<
+        KFS_LOG_EOM;
+        return logerr;
+    }
+    logerr = 0;
+    mWriter.SetFd(logfd);
+    return 0;
+}
+
+/*!
+ * \brief close the current log file, the pending records must be flushed
+ * prior to this call
+ */
+void
+Logger::closeLog()
+{
+    mWriter.SetFd(-1);
+    if (logfd < 0) {
+        return;
+    }
+    if (close(logfd) && logerr == 0) {
+        const int err = errno;
+        logerr = err > 0 ? -err : -EIO;
+    }
+    logfd = -1;
+}
+
+void
+Logger::setParameters(const Properties& props)
+{
+    const int maxBatchBytes = props.getValue(
+        "metaServer.log.groupCommit.maxBatchBytes", 4 << 20);
+    const int maxWaitUsec   = props.getValue(
+        "metaServer.log.groupCommit.maxWaitMicroSec", 0);
+    const bool syncFlag     = props.getValue(
+        "metaServer.log.sync", 0) != 0;
+    const bool threadFlag   = props.getValue(
+        "metaServer.log.groupCommit.enabled",
+        mWriter.IsRunning() ? 1 : 0) != 0;
+    mWriter.SetParameters(maxBatchBytes, maxWaitUsec, syncFlag);
+    if (threadFlag == mWriter.IsRunning()) {
+        return;
+    }
+    if (threadFlag) {
+        if (mWriter.Start()) {
+            globalNetManager().RegisterTimeoutHandler(this);
+        }
+        KFS_LOG_STREAM_INFO << "log writer thread:"
+            " started: "     << mWriter.IsRunning() <<
+            " max batch: "   << maxBatchBytes <<
+            " max wait: "    << maxWaitUsec <<
+            " sync: "        << syncFlag <<
+        KFS_LOG_EOM;
+    } else {
+        shutdown();
+    }
+}
+
+void
+Logger::shutdown()
+{
+    if (! mWriter.IsRunning()) {
+        return;
+    }
+    flushLog();
+    globalNetManager().UnRegisterTimeoutHandler(this);
+    mWriter.Stop();
+    KFS_LOG_STREAM_INFO << "log writer thread stopped" << KFS_LOG_EOM;
 }
 
 /*!
@@ -126,23 +609,26 @@ Logger::startLog(int seqno, bool appendFlag /* = false */,
             " int base: " << logAppendIntBase <<
             " file: "     << logname <<
         KFS_LOG_EOM;
-        logf.open(logname.c_str(), ofstream::app | ofstream::binary);
-        md.SetStream(&logf);
+        if (openLog(appendFlag) != 0) {
+            return logerr;
+        }
+        md.SetStream(&mPendingStream);
         md.SetWriteTrough(false);
         switch (logAppendIntBase) {
             case 10: logstream << dec; break;
             case 16: logstream << hex; break;
             default:
                 panic("invalid int base parameter", false);
-                logf.close();
+                closeLog();
                 return -EINVAL;
         }
         return (fail() ? -EIO : 0);
     }
-    logf.open(logname.c_str(),
-        ofstream::out | ofstream::binary | ofstream::trunc);
+    if (openLog(appendFlag) != 0) {
+        return logerr;
+    }
     md.SetWriteTrough(false);
-    md.Reset(&logf);
+    md.Reset(&mPendingStream);
     logstream <<
         "version/" << VERSION << "\n"
         "checksum/last-line\n"
@@ -150,8 +636,7 @@ Logger::startLog(int seqno, bool appendFlag /* = false */,
     ;
     logstream << "time/" << DisplayIsoDateTime() << '\n';
     logstream << hex;
-    logstream.flush();
-    return (fail() ? -EIO : 0);
+    return writePending();
 }
 
 /*!
@@ -160,6 +645,9 @@ Logger::startLog(int seqno, bool appendFlag /* = false */,
 int
 Logger::finishLog()
 {
+    // All records must be on disk prior to roll over, and in order to
+    // determine the highest sequence number logged.
+    flushLog();
     // if there has been no update to the log since the last roll, don't
     // roll the file over; otherwise, we'll have a file every N mins
     if (incp == committed) {
@@ -168,8 +656,12 @@ Logger::finishLog()
     logstream << "time/" << DisplayIsoDateTime() << '\n';
     logstream.flush();
     const string checksum = md.GetMd();
-    logf << "checksum/" << checksum << '\n';
-    logf.close();
+    // The checksum line itself isn't part of the checksum, thus bypass md.
+    mPendingStream << "checksum/" << checksum << '\n';
+    if (writePending() != 0) {
+        panic("Logger::finishLog, write", true);
+    }
+    closeLog();
     if (fail()) {
         panic("Logger::finishLog, close", true);
     }
@@ -185,22 +677,6 @@ Logger::finishLog()
     return status;
 }
 
-/*!
- * \brief make sure result is on disk
- * \param[in] r the result of interest
- *
- * If this result has a higher sequence number than what is
- * currently known to be on disk, flush the log to disk.
- */
-void
-Logger::flushResult(MetaRequest *r)
-{
-    if (r->seqno > committed) {
-        flushLog();
-        assert(r->seqno <= committed);
-    }
-}
-
 void
 logger_setup_paths(const string& logdir)
 {
@@ -278,4 +754,16 @@ logger_init(int rotateIntervalSec)
     LogRotater::Instance().Start();
 }
 
+void
+logger_set_parameters(const Properties& props)
+{
+    oplog.setParameters(props);
+}
+
+void
+logger_shutdown()
+{
+    oplog.shutdown();
+}
+
 } // namespace KFS.
@@ -28,6 +28,8 @@
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <deque>
+#include <utility>
 
 #include "kfstypes.h"
 #include "MetaRequest.h"
@@ -35,12 +37,17 @@
 #include "common/MdStream.h"
 
 #include "kfsio/ITimeout.h"
+#include "kfsio/IOBuffer.h"
 
 namespace KFS
 {
 using std::string;
 using std::ostringstream;
 using std::ofstream;
+using std::deque;
+using std::pair;
+
+class Properties;
 
 /*!
  * \brief Class for logging metadata updates
@@ -51,28 +58,18 @@ using std::ofstream;
  *  the log rollover occurs, after we close the log file, we create a link from
  *  "LAST" to the recently closed log file.  This is used by the log compactor
  *  to determine the set of files that can be compacted.
+ *  - with the log writer thread enabled the log records are group committed:
+ *  the writer thread writes (and optionally syncs) all records appended
+ *  since its last write with a single system call, and the requests are
+ *  dispatched in the original order once their records are on disk.
  */
 
-class Logger
+class Logger : private ITimeout
 {
 public:
     static const int VERSION = 1;
-    Logger(string d)
-        : logdir(d),
-          lognum(-1),
-          logname(),
-          logf(),
-          md(),
-          logstream(md),
-          nextseq(0),
-          committed(0),
-          incp(0)
-        {}
-    ~Logger()
-    {
-        logstream.flush();
-        logf.close();
-    }
+    Logger(string d);
+    ~Logger();
     void setLogDir(const string &d)
     {
         logdir = d;
@@ -110,25 +107,44 @@ public:
         incp = committed = nextseq = last;
     }
     MdStream& getMdStream() { return md; }
+    //!< set log writer (group commit) parameters
+    void setParameters(const Properties& props);
+    //!< write all pending log records, and stop log writer thread
+    void shutdown();
 private:
+    class Writer;
+    typedef deque<pair<seq_t, MetaRequest*> > PendingDispatch;
+
     string   logdir;      //!< directory where logs are kept
     int      lognum;      //!< for generating log file names
     string   logname;     //!< name of current log file
-    ofstream logf;        //!< the current log file
+    int      logfd;       //!< the current log file
+    int      logerr;      //!< last log write error
+    IOBuffer mPending;    //!< records not yet handed to the writer
+    IOBuffer::WOStream mPendingStream;
     MdStream md;
     ostream& logstream;
     seq_t    nextseq;     //!< next request sequence no.
     seq_t    committed;   //!< highest request known to be on disk
     seq_t    incp;        //!< highest request in a checkpoint
+    seq_t    mLastLogged; //!< highest request with record in the log
+    //!< requests waiting for the log records to be written
+    PendingDispatch mPendingDispatch;
+    Writer&         mWriter;
     string genfile(int n) //!< generate a log file name
     {
         ostringstream f(ostringstream::out);
         f << n;
         return logdir + "/log." + f.str();
     }
-    bool fail() const { return (logf.fail() || md.fail()); }
+    bool fail() const { return (logerr != 0 || md.fail()); }
     void flushLog();
-    void flushResult(MetaRequest *r);
+    int  writePending();
+    void submitPending();
+    void updateCommitted();
+    int  openLog(bool appendFlag);
+    void closeLog();
+    virtual void Timeout();
 private:
     // No copy.
     Logger(const Logger&);
@@ -141,6 +157,8 @@ extern Logger oplog;
 extern void logger_setup_paths(const string& logdir);
 extern void logger_init(int rotateIntervalSec);
 extern void logger_set_rotate_interval(int rotateIntervalSec);
+extern void logger_set_parameters(const Properties& props);
+extern void logger_shutdown();
 
 }
 #endif // !defined(KFS_LOGGER_H)
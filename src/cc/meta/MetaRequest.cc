@@ -54,6 +54,7 @@
 #include <signal.h>
 #include <unistd.h>
 #include <string.h>
+#include <fnmatch.h>
 
 #include <map>
 #include <iomanip>
@@ -138,36 +139,30 @@ setChunkmapDumpDir(string d)
 inline static bool
 OkHeader(const MetaRequest* op, ostream &os, bool checkStatus = true)
 {
-    os <<
-        "OK\r\n"
-        "Cseq: " << op->opSeqno
-    ;
+    IOBufferHeaderWriter writer(os);
+    writer.Write("OK\r\nCseq: ");
+    writer.WriteInt(op->opSeqno);
     if (op->status == 0 && op->statusMsg.empty()) {
-        os <<
-            "\r\n"
-            "Status: 0\r\n"
-        ;
+        writer.Write("\r\nStatus: 0\r\n");
         return true;
     }
-    os <<
-        "\r\n"
-        "Status: " << (op->status >= 0 ? op->status :
-            -SysToKfsErrno(-op->status)) << "\r\n"
-    ;
+    writer.Write("\r\nStatus: ");
+    writer.WriteInt(op->status >= 0 ? op->status :
+        -SysToKfsErrno(-op->status));
+    writer.Write("\r\n");
     if (! op->statusMsg.empty()) {
         const size_t p = op->statusMsg.find('\r');
         assert(
             string::npos == p &&
             op->statusMsg.find('\n') == string::npos
         );
-        os << "Status-message: " <<
-            (p == string::npos ?
-                op->statusMsg :
-                op->statusMsg.substr(0, p)) <<
-        "\r\n";
+        writer.Write("Status-message: ");
+        writer.Write(op->statusMsg.data(),
+            p == string::npos ? op->statusMsg.size() : p);
+        writer.Write("\r\n");
     }
     if (checkStatus && op->status < 0) {
-        os << "\r\n";
+        writer.Write("\r\n");
     }
     return (op->status >= 0);
 }
@@ -842,6 +837,93 @@ MetaCreate::handle()
     }
 }
 
+/* virtual */ void
+MetaCreateBatch::handle()
+{
+    if (! SetUserAndGroup(*this)) {
+        return;
+    }
+    const bool kDirFlag = false;
+    if (! CheckCreatePerms(*this, kDirFlag)) {
+        return;
+    }
+    fid          = -1;
+    numCreated   = 0;
+    failedStatus = 0;
+    createdLen   = 0;
+    numReplicas  = min(numReplicas, gLayoutManager.GetMaxReplicasPerFile());
+    if (0 == numReplicas) {
+        if (! gLayoutManager.IsObjectStoreEnabled()) {
+            status    = -EINVAL;
+            statusMsg = "object store is not enabled";
+            return;
+        }
+        if (minSTier < kKfsSTierMax) {
+            maxSTier = minSTier; // No storage tier range.
+        }
+    }
+    if (maxSTier < minSTier ||
+            minSTier < kKfsSTierMin || minSTier > kKfsSTierMax ||
+            maxSTier < kKfsSTierMin || maxSTier > kKfsSTierMax) {
+        status    = -EINVAL;
+        statusMsg = "invalid storage tier range";
+        return;
+    }
+    mtime = microseconds();
+    string name;
+    for (size_t pos = 0; pos < names.size() && numCreated < kMaxNames; ) {
+        const size_t end = min(names.find('/', pos), names.size());
+        name.assign(names, pos, end - pos);
+        if (gWormMode && ! IsWormMutationAllowed(name)) {
+            failedStatus = -EPERM;
+            break;
+        }
+        // Exclusive create, as with O_EXCL: an existing file is never
+        // replaced, and the dumpster isn't involved.
+        const bool kExclusiveFlag = true;
+        fid_t      id             = 0;
+        fid_t      todumpster     = -1;
+        MetaFattr* fa             = 0;
+        if ((failedStatus = metatree.create(
+                dir,
+                name,
+                &id,
+                numReplicas,
+                kExclusiveFlag,
+                KFS_STRIPED_FILE_TYPE_NONE,
+                0,
+                0,
+                0,
+                todumpster,
+                user,
+                group,
+                mode,
+                euser,
+                egroup,
+                &fa,
+                mtime)) != 0) {
+            break;
+        }
+        if (numCreated <= 0) {
+            fid = id;
+        } else if (id != fid + numCreated) {
+            // The log record relies on the ids being consecutive.
+            panic("create batch: non sequential file id");
+        }
+        if (minSTier < kKfsSTierMax) {
+            fa->minSTier = minSTier;
+            fa->maxSTier = maxSTier;
+        }
+        numCreated++;
+        createdLen = end;
+        pos        = end + 1;
+    }
+    // The request succeeds even if no files were created, the failed name
+    // status is returned separately, in order to let the client distinguish
+    // it from the request failure.
+    status = 0;
+}
+
 /* virtual */ void
 MetaMkdir::handle()
 {
@@ -936,6 +1018,250 @@ MetaRmdir::handle()
     status = metatree.rmdir(dir, name, pathname, euser, egroup, mtime);
 }
 
+/*!
+ * \brief internal step of the directory tree removal: handle() performs the
+ * mutations, and log() emits the corresponding remove and rmdir records.
+ */
+struct MetaRmdirsStep: public MetaRequest {
+    MetaRmdirs&   owner;
+    ostringstream logs;
+    MetaRmdirsStep(MetaRmdirs& o)
+        : MetaRequest(META_RMDIRS_STEP, true),
+          owner(o),
+          logs()
+        { clnt = &o; }
+    virtual void handle()
+    {
+        status = 0;
+        owner.Step(logs);
+    }
+    virtual int log(ostream &file) const
+    {
+        file << logs.str();
+        return file.fail() ? -EIO : 0;
+    }
+    virtual ostream& ShowSelf(ostream& os) const
+    {
+        return os <<
+            "rmdirs-step:"
+            " path: "   << owner.pathname <<
+            " name: "   << owner.name <<
+            " parent: " << owner.dir
+        ;
+    }
+};
+
+MetaRmdirs::~MetaRmdirs()
+{
+    setTimer(false);
+}
+
+/* virtual */ void
+MetaRmdirs::handle()
+{
+    if (startedFlag) {
+        // Resubmitted on completion, the status is already set.
+        return;
+    }
+    startedFlag = true;
+    if (gWormMode && ! IsWormMutationAllowed(name)) {
+        // deletes are disabled in WORM mode
+        statusMsg = "worm mode";
+        status    = -EPERM;
+        return;
+    }
+    SetEUserAndEGroup(*this);
+    if ((status = LookupAbsPath(dir, name, euser, egroup)) != 0) {
+        return;
+    }
+    if (name == "." || name == "..") {
+        status = -EINVAL;
+        return;
+    }
+    if (dir == ROOTFID && (name == DUMPSTERDIR || name == "/")) {
+        status = -EPERM;
+        return;
+    }
+    MetaFattr* fa = 0;
+    if ((status = metatree.lookup(dir, name, euser, egroup, fa)) != 0) {
+        return;
+    }
+    if (! fa || fa->type != KFS_DIR) {
+        status = -ENOTDIR;
+        return;
+    }
+    stack.push_back(Frame(fa->id(), dir, name, pathname));
+    suspended = true;
+    setTimer(true);
+}
+
+/* virtual */ void
+MetaRmdirs::Timeout()
+{
+    if (stepInFlightFlag) {
+        return;
+    }
+    stepInFlightFlag = true;
+    // The step completion might delete this request.
+    submit_request(new MetaRmdirsStep(*this));
+}
+
+int
+MetaRmdirs::stepDone(int code, void* data)
+{
+    MetaRequest* const step = reinterpret_cast<MetaRequest*>(data);
+    if (code != EVENT_CMD_DONE || ! step || step->op != META_RMDIRS_STEP ||
+            ! stepInFlightFlag) {
+        panic("MetaRmdirs::stepDone invalid invocation");
+        return 1;
+    }
+    delete step;
+    stepInFlightFlag = false;
+    if (status == 0 && ! stack.empty()) {
+        // Do not wait in poll for network activity, run the next step on the
+        // next net manager loop iteration.
+        globalNetManager().Wakeup();
+        return 0;
+    }
+    setTimer(false);
+    suspended = false;
+    submit_request(this);
+    return 0;
+}
+
+void
+MetaRmdirs::setTimer(bool flag)
+{
+    if (timerFlag == flag) {
+        return;
+    }
+    timerFlag = flag;
+    if (flag) {
+        globalNetManager().RegisterTimeoutHandler(this);
+    } else {
+        globalNetManager().UnRegisterTimeoutHandler(this);
+    }
+}
+
+int
+MetaRmdirs::list(MetaRmdirs::Frame& frame)
+{
+    const MetaFattr* const fa = metatree.getFattr(frame.fid);
+    if (! fa) {
+        status = -ENOENT;
+        return 1;
+    }
+    if (! fa->CanRead(euser, egroup) || ! fa->CanSearch(euser, egroup)) {
+        status = -EACCES;
+        return 1;
+    }
+    vector<MetaDentry*> entries;
+    bool                more = false;
+    if ((status = metatree.readdir(frame.fid, entries,
+            sMaxEntriesPerStep, &more)) != 0) {
+        return 1;
+    }
+    frame.listedFlag = true;
+    size_t count = 0;
+    for (vector<MetaDentry*>::const_iterator it = entries.begin();
+            it != entries.end();
+            ++it) {
+        const string& ename = (*it)->getName();
+        if (ename == "." || ename == "..") {
+            continue;
+        }
+        const MetaFattr* const efa = metatree.getFattr(*it);
+        if (! efa) {
+            continue;
+        }
+        (efa->type == KFS_DIR ? frame.dirs : frame.files).push_back(ename);
+        count++;
+    }
+    // Re-list after the listed entries are removed, unless nothing can be
+    // removed, in which case let rmdir fail.
+    frame.moreFlag = more && 0 < count;
+    return max(1, (int)entries.size());
+}
+
+void
+MetaRmdirs::Step(ostream& logs)
+{
+    int budget = sMaxEntriesPerStep;
+    while (0 < budget && status == 0 && ! stack.empty()) {
+        Frame& frame = stack.back();
+        if (! frame.files.empty()) {
+            const string& fname = frame.files.back();
+            const string  path  = frame.path.empty() ?
+                frame.path : frame.path + "/" + fname;
+            fid_t         todumpster = -1;
+            const int64_t mtime      = microseconds();
+            const int     ret        = metatree.remove(frame.fid, fname, path,
+                todumpster, euser, egroup, mtime);
+            if (ret == 0) {
+                logs << "remove/dir/" << frame.fid << "/name/" << fname;
+                if (todumpster > 0) {
+                    logs << "/todumpster/" << todumpster;
+                }
+                logs << "/mtime/" << ShowTime(mtime) << '\n';
+                filesRemoved++;
+            } else if (ret != -ENOENT) {
+                status = ret;
+            }
+            frame.files.pop_back();
+            budget--;
+            continue;
+        }
+        if (! frame.dirs.empty()) {
+            const string dname = frame.dirs.back();
+            frame.dirs.pop_back();
+            budget--;
+            MetaFattr* fa  = 0;
+            const int  ret = metatree.lookup(
+                frame.fid, dname, euser, egroup, fa);
+            if (ret == 0 && fa && fa->type == KFS_DIR) {
+                const fid_t  parent = frame.fid;
+                const string path   = frame.path.empty() ?
+                    frame.path : frame.path + "/" + dname;
+                // The frame reference is invalid after push_back().
+                stack.push_back(Frame(fa->id(), parent, dname, path));
+            } else if (ret == 0) {
+                frame.files.push_back(dname);
+            } else if (ret != -ENOENT) {
+                status = ret;
+            }
+            continue;
+        }
+        if (! frame.listedFlag || frame.moreFlag) {
+            budget -= list(frame);
+            continue;
+        }
+        const int64_t mtime = microseconds();
+        const int     ret   = metatree.rmdir(frame.parent, frame.name,
+            frame.path, euser, egroup, mtime);
+        if (ret == 0) {
+            logs << "rmdir/dir/" << frame.parent << "/name/" << frame.name <<
+                "/mtime/" << ShowTime(mtime) << '\n';
+            dirsRemoved++;
+        } else if (ret != -ENOENT) {
+            status = ret;
+        }
+        stack.pop_back();
+        budget--;
+    }
+    if (status != 0) {
+        stack.clear();
+    }
+}
+
+/* static */ void
+MetaRmdirs::SetParameters(const Properties& props)
+{
+    sMaxEntriesPerStep = max(16, props.getValue(
+        "metaServer.rmdirs.maxEntriesPerStep", sMaxEntriesPerStep));
+}
+
+int MetaRmdirs::sMaxEntriesPerStep(256);
+
 static vector<MetaDentry*>&
 GetReadDirTmpVec()
 {
@@ -1048,19 +1374,6 @@ public:
     }
 };
 
-class ListServerLocations
-{
-    ostream& os;
-public:
-    ListServerLocations(ostream &out)
-        : os(out)
-        {}
-    void operator()(const ServerLocation& s) const
-    {
-        os << " " << s;
-    }
-};
-
 template<bool ShortFormatFlag>
 class ReaddirPlusWriter
 {
@@ -1477,6 +1790,7 @@ MetaReaddirPlus::handle()
     }
     dentries.clear();
     lastChunkInfos.clear();
+    fnameNext.clear();
     if (ioBufPending > 0) {
         gLayoutManager.ChangeIoBufPending(-ioBufPending);
     }
@@ -1547,6 +1861,12 @@ MetaReaddirPlus::handle()
         if (fa->id() == ROOTFID && name == "/") {
             continue;
         }
+        // Filter by the pattern, with the fnmatch() rules, in order to let
+        // the client glob() to fetch only the entries that can match.
+        if (! fnamePattern.empty() &&
+                fnmatch(fnamePattern.c_str(), name.c_str(), 0) != 0) {
+            continue;
+        }
         responseSize += name.length() + (fa->type == KFS_DIR ?
             avgDirExtraSize : avgFileExtraSize);
         dentries.push_back(DEntry(*fa, name));
@@ -1598,6 +1918,12 @@ MetaReaddirPlus::handle()
             hasMoreEntriesFlag = true;
         }
     }
+    if (! fnamePattern.empty() && hasMoreEntriesFlag && it != res.begin()) {
+        // The last returned entry can not be used as the restart point, as
+        // the entries that follow it might not match. Return the last
+        // entry examined.
+        fnameNext = (*(it - 1))->getName();
+    }
     ioBufPending = (int64_t)responseSize;
     if (ioBufPending > 0) {
         gLayoutManager.ChangeIoBufPending(ioBufPending);
@@ -1617,9 +1943,10 @@ MetaGetalloc::handle()
         statusMsg = "negative offset";
         return;
     }
-    MetaFattr* fa  = 0;
-    int        err = 0;
-    Servers    c;
+    MetaFattr*     fa        = 0;
+    MetaChunkInfo* chunkInfo = 0;
+    int            err       = 0;
+    Servers        c;
     replicasOrderedFlag = false;
     if (objectStoreFlag) {
         if (! (fa = metatree.getFattr(fid))) {
@@ -1652,7 +1979,6 @@ MetaGetalloc::handle()
         chunkVersion =
             -(seq_t)(chunkStartOffset(offset) + fa->maxSTier) - 1;
     } else {
-        MetaChunkInfo* chunkInfo = 0;
         status = metatree.getalloc(fid, offset, &chunkInfo);
         if (status != 0) {
             KFS_LOG_STREAM_DEBUG <<
@@ -1690,8 +2016,12 @@ MetaGetalloc::handle()
         KFS_LOG_EOM;
         return;
     }
+    if (chunkInfo && ! fromChunkServerFlag) {
+        gLayoutManager.UpdateHotChunk(*chunkInfo);
+    }
     locations.reserve(c.size());
     for_each(c.begin(), c.end(), EnumerateLocations(locations));
+    gLayoutManager.GetServersLoadHints(c, loadHints);
     status = 0;
 }
 
@@ -1793,6 +2123,133 @@ MetaGetlayout::handle()
     sWOStream.Reset();
 }
 
+/*!
+ * \brief Get the layout of all files in a directory.
+ * Entry format: file id, directory flag, file size, number of stripes,
+ * recovery stripes, stripe size, replication, number of chunks followed by
+ * the chunk position, number of replicas, and replicas server table indices
+ * for each chunk, then the entry name till the end of the line.
+ */
+/* virtual */ void
+MetaGetDirLayout::handle()
+{
+    if (! HasEnoughIoBuffersForResponse(*this)) {
+        return;
+    }
+    servers.Clear();
+    resp.Clear();
+    numServers = 0;
+    int maxEntries = gLayoutManager.GetReadDirLimit();
+    if (numEntries > 0 &&
+            (maxEntries <= 0 || numEntries < maxEntries)) {
+        maxEntries = numEntries;
+    }
+    numEntries = 0;
+    vector<MetaDentry*>& res = GetReadDirTmpVec();
+    if ((status = fnameStart.empty() ?
+            metatree.readdir(dir, res,
+                maxEntries, &hasMoreEntriesFlag) :
+            metatree.readdir(dir, fnameStart, res,
+                maxEntries, hasMoreEntriesFlag)
+            ) != 0) {
+        if (status == -ENOENT) {
+            MetaFattr * const fa = metatree.getFattr(dir);
+            if (fa && fa->type != KFS_DIR) {
+                status = -ENOTDIR;
+            }
+        }
+        return;
+    }
+    const MetaFattr* const dfa = GetDirAttr(dir, res);
+    SetEUserAndEGroup(*this);
+    if (! dfa || ! dfa->CanRead(euser, egroup) ||
+            ! dfa->CanSearch(euser, egroup)) {
+        status = -EACCES;
+        return;
+    }
+    const bool verifyFlag = gLayoutManager.VerifyAllOpsPermissions();
+    const int  maxSize    = max(0, gLayoutManager.GetMaxResponseSize() -
+        IOBufferData::GetDefaultBufferSize());
+    typedef map<const ChunkServer*, int> ServerIndex;
+    ServerIndex            serverIdx;
+    ResponseWOStream       serversStream;
+    ostream&               sos = serversStream.Set(servers);
+    ostream&               os  = sWOStream.Set(resp);
+    vector<MetaChunkInfo*> chunks;
+    Servers                c;
+    for (vector<MetaDentry*>::const_iterator it = res.begin();
+            it != res.end();
+            ++it) {
+        if (0 < numEntries && maxSize <
+                resp.BytesConsumable() + servers.BytesConsumable()) {
+            hasMoreEntriesFlag = true;
+            break;
+        }
+        const MetaDentry* const entry = *it;
+        MetaFattr* const        fa    = metatree.getFattr(entry);
+        if (! fa) {
+            continue;
+        }
+        const string& name = entry->getName();
+        if (fa->id() == ROOTFID && name == "/") {
+            continue;
+        }
+        chunks.clear();
+        if (fa->type == KFS_FILE &&
+                (! verifyFlag || fa->CanRead(euser, egroup))) {
+            MetaFattr* cfa = 0;
+            if (metatree.getalloc(fa->id(), cfa, chunks, -1) != 0) {
+                chunks.clear();
+            }
+        }
+        os << fa->id() <<
+            " " << (fa->type == KFS_DIR ? 1 : 0) <<
+            " " << fa->filesize <<
+            " " << (fa->IsStriped() ? fa->numStripes         : 0) <<
+            " " << (fa->IsStriped() ? fa->numRecoveryStripes : 0) <<
+            " " << (fa->IsStriped() ? fa->stripeSize         : 0) <<
+            " " << fa->numReplicas <<
+            " " << chunks.size();
+        for (vector<MetaChunkInfo*>::const_iterator ci = chunks.begin();
+                ci != chunks.end();
+                ++ci) {
+            MetaFattr* cfa = 0;
+            if (gLayoutManager.GetChunkToServerMapping(**ci, c, cfa) != 0) {
+                c.clear();
+            }
+            os << " " << (*ci)->offset << " " << c.size();
+            for (Servers::const_iterator si = c.begin();
+                    si != c.end();
+                    ++si) {
+                pair<ServerIndex::iterator, bool> const ret =
+                    serverIdx.insert(make_pair(si->get(), numServers));
+                if (ret.second) {
+                    const ServerLocation& loc = (*si)->GetServerLocation();
+                    sos << loc.hostname << " " << loc.port << "\n";
+                    numServers++;
+                }
+                os << " " << ret.first->second;
+            }
+        }
+        os << " " << name << "\n";
+        os.flush();
+        sos.flush();
+        numEntries++;
+    }
+    os.flush();
+    sos.flush();
+    if (! os || ! sos) {
+        servers.Clear();
+        resp.Clear();
+        numServers = 0;
+        numEntries = 0;
+        status     = -ENOMEM;
+        statusMsg  = "response exceeds max. size";
+    }
+    serversStream.Reset();
+    sWOStream.Reset();
+}
+
 /* virtual */ bool
 MetaAllocate::dispatch(ClientSM& sm)
 {
@@ -2582,7 +3039,66 @@ MetaLeaseRenew::handle()
     if (gLayoutManager.VerifyAllOpsPermissions()) {
         SetEUserAndEGroup(*this);
     }
+    // Chunk servers batch write lease renewals in order to reduce the
+    // number of renew requests.
+    if (! chunkLeases.empty() && (
+            (leaseType != READ_LEASE && (fromClientSMFlag || ! chunkServer)) ||
+            0 <= chunkPos || emitCSAccessFlag ||
+            gLayoutManager.IsClientCSAuthRequired())) {
+        status    = -EINVAL;
+        statusMsg = "multiple leases renew is supported only for chunk read"
+            " and chunk server write leases without chunk server access";
+        return;
+    }
     status = gLayoutManager.LeaseRenew(this);
+    if (status == 0 && ! chunkLeases.empty()) {
+        RenewChunkLeases();
+    }
+}
+
+void
+MetaLeaseRenew::RenewChunkLeases()
+{
+    // Renew the remaining leases, and report the ones that failed. The
+    // leases are renewed one by one the same way as the first lease, in
+    // order to enforce the same permission checks.
+    const chunkId_t   firstChunkId = chunkId;
+    const int64_t     firstLeaseId = leaseId;
+    const char*       ptr          = chunkLeases.c_str();
+    const char* const end          = ptr + chunkLeases.size();
+    failedLeases.clear();
+    while (ptr < end) {
+        chunkId_t cid = -1;
+        int64_t   lid = -1;
+        if (! DecIntParser::Parse(ptr, end - ptr, cid) ||
+                ! DecIntParser::Parse(ptr, end - ptr, lid)) {
+            while (ptr < end && (*ptr & 0xFF) <= ' ') {
+                ++ptr;
+            }
+            if (ptr < end) {
+                status    = -EINVAL;
+                statusMsg = "invalid chunk leases list";
+                failedLeases.clear();
+            }
+            break;
+        }
+        chunkId = cid;
+        leaseId = lid;
+        const int ret = gLayoutManager.LeaseRenew(this);
+        if (ret != 0) {
+            if (! failedLeases.empty()) {
+                failedLeases += ' ';
+            }
+            AppendDecIntToString(failedLeases, cid);
+            failedLeases += ' ';
+            AppendDecIntToString(failedLeases, ret);
+        }
+    }
+    chunkId = firstChunkId;
+    leaseId = firstLeaseId;
+    if (status == 0) {
+        statusMsg.clear();
+    }
 }
 
 /* virtual */ void
@@ -2879,7 +3395,7 @@ MetaPing::handle()
         return;
     }
     status = 0;
-    gLayoutManager.Ping(resp, gWormMode);
+    gLayoutManager.Ping(resp, gWormMode, notModifiedGeneration);
 
 }
 
@@ -3140,6 +3656,14 @@ MetaFsck::handle()
     }
     if ((pid = DoFork((int)(gLayoutManager.GetMaxFsckTime() /
                     (1000 * 1000)))) == 0) {
+        // Lower the child priority, in order to let the parent process
+        // (and its client threads) run with no cpu contention.
+        if (0 < sChildNice) {
+            errno = 0;
+            if (nice(sChildNice) == -1 && errno != 0) {
+                QCUtils::SetLastIgnoredError(errno);
+            }
+        }
         StBufferT<ostream*, 8> streamsPtrBuf;
         ostream** const ptr        = streamsPtrBuf.Resize(cnt + 1);
         ofstream* const streams    = new ofstream[cnt];
@@ -3200,10 +3724,13 @@ MetaFsck::SetParameters(const Properties& props)
         "metaServer.fsck.tmpfile",             sTmpName);
     sMaxFsckResponseSize = props.getValue(
         "metaServer.fsck.maxFsckResponseSize", sMaxFsckResponseSize);
+    sChildNice = props.getValue(
+        "metaServer.fsck.childNice",           sChildNice);
 }
 
 string MetaFsck::sTmpName("/tmp/kfsfsck.tmp");
 int    MetaFsck::sMaxFsckResponseSize(20 << 20);
+int    MetaFsck::sChildNice(10);
 
 /* virtual */ void
 MetaCheckLeases::handle()
@@ -3224,6 +3751,7 @@ MetaStats::handle()
     ostringstream& os = GetTmpOStringStream();
     status = 0;
     globals().counterManager.Show(os);
+    globalNetManager().ShowProfile(os);
     stats = os.str();
 }
 
@@ -3347,11 +3875,18 @@ MetaCheckpoint::handle()
             " done; status: " << status <<
             " failures: "     << failedCount <<
         KFS_LOG_EOM;
-        if (status < 0) {
+        // Exit status is non negative with the log compactor child.
+        if (status < 0 || (useLogCompactorFlag && status != 0)) {
             failedCount++;
         } else {
             failedCount = 0;
             lastCheckpointId = runningCheckpointId;
+            lastDurationUsec = microseconds() - startTime;
+            checkpointCount++;
+            struct stat st;
+            if (stat(LASTCP.c_str(), &st) == 0) {
+                lastSize = (int64_t)st.st_size;
+            }
         }
         if (lockFd >= 0) {
             close(lockFd);
@@ -3383,8 +3918,10 @@ MetaCheckpoint::handle()
     }
     if (lockFd >= 0) {
         close(lockFd);
+        lockFd = -1;
     }
-    if (! lockFileName.empty() &&
+    // The log compactor acquires the lock file itself.
+    if (! useLogCompactorFlag && ! lockFileName.empty() &&
             (lockFd = try_to_acquire_lockfile(lockFileName)) < 0) {
         KFS_LOG_STREAM_INFO << "checkpoint: " <<
             " failed to acquire lock: " << lockFileName <<
@@ -3419,6 +3956,31 @@ MetaCheckpoint::handle()
         return;
     }
     runningCheckpointId = oplog.checkpointed();
+    startTime = microseconds();
+    if (useLogCompactorFlag) {
+        // The log compactor restores the last checkpoint, replays the logs
+        // up to and including the log that was just closed, and writes the
+        // new checkpoint. The child is created with vfork() in order to
+        // avoid copying the page tables, and doesn't share the meta data
+        // memory with the parent.
+        pid = SpawnLogCompactor();
+        lastStallUsec = microseconds() - startTime;
+        KFS_LOG_STREAM(pid > 0 ?
+                MsgLogger::kLogLevelINFO :
+                MsgLogger::kLogLevelERROR) <<
+            "checkpoint: "     << lastCheckpointId <<
+            " log compactor: " << logCompactorPath <<
+            " pid: "           << pid <<
+            " start: "         << lastStallUsec << " usec." <<
+        KFS_LOG_EOM;
+        if (pid < 0) {
+            status = -1;
+            return;
+        }
+        suspended = true;
+        gChildProcessTracker.Track(pid, this);
+        return;
+    }
     // DoFork() / PrepareCurrentThreadToFork() releases and re-acquires the
     // global mutex by waiting on condition with this mutex, but must ensure
     // that no other RPC gets processed. If checkpoint mutation count isn't
@@ -3433,11 +3995,13 @@ MetaCheckpoint::handle()
             metatree.recomputeDirSize();
             cp.setWriteSyncFlag(checkpointWriteSyncFlag);
             cp.setWriteBufferSize(checkpointWriteBufferSize);
+            cp.setBinaryFormatFlag(checkpointBinaryFormatFlag);
             status = cp.do_CP();
         }
         // Child does not attempt graceful exit.
         _exit(status == 0 ? 0 : 1);
     }
+    lastStallUsec = microseconds() - startTime;
     if (cp.isCPNeeded()) {
         panic("checkpoint: meta data changed after prepare to fork");
     }
@@ -3455,6 +4019,41 @@ MetaCheckpoint::handle()
     gChildProcessTracker.Track(pid, this);
 }
 
+int
+MetaCheckpoint::SpawnLogCompactor()
+{
+    // Prepare the arguments prior to vfork(), the child must only invoke
+    // exec or _exit.
+    const char* args[16];
+    int         cnt = 0;
+    args[cnt++] = logCompactorPath.c_str();
+    args[cnt++] = "-l";
+    args[cnt++] = LOGDIR.c_str();
+    args[cnt++] = "-c";
+    args[cnt++] = CPDIR.c_str();
+    if (! lockFileName.empty()) {
+        args[cnt++] = "-L";
+        args[cnt++] = lockFileName.c_str();
+    }
+    if (checkpointBinaryFormatFlag) {
+        args[cnt++] = "-b";
+        args[cnt++] = "1";
+    }
+    args[cnt] = 0;
+    const int maxFd = (int)sysconf(_SC_OPEN_MAX);
+    const pid_t ret = vfork();
+    if (ret == 0) {
+        // Do not pass file descriptors, and in particular listening
+        // sockets, to the child.
+        for (int fd = 3; fd < maxFd; fd++) {
+            close(fd);
+        }
+        execvp(args[0], const_cast<char* const*>(args));
+        _exit(127);
+    }
+    return (int)ret;
+}
+
 void
 MetaCheckpoint::ScheduleNow()
 {
@@ -3479,6 +4078,14 @@ MetaCheckpoint::SetParameters(const Properties& props)
     checkpointWriteBufferSize = props.getValue(
         "metaServer.checkpoint.writeBufferSize",
         checkpointWriteBufferSize);
+    checkpointBinaryFormatFlag = props.getValue(
+        "metaServer.checkpoint.binaryFormat",
+        checkpointBinaryFormatFlag ? 1 : 0) != 0;
+    useLogCompactorFlag = props.getValue(
+        "metaServer.checkpoint.useLogCompactor",
+        useLogCompactorFlag ? 1 : 0) != 0;
+    logCompactorPath = props.getValue(
+        "metaServer.checkpoint.logCompactorPath", logCompactorPath);
 }
 
 /*!
@@ -3570,6 +4177,33 @@ MetaCreate::log(ostream& file) const
     return file.fail() ? -EIO : 0;
 }
 
+/*!
+ * \brief log a batch of file creates, the ids are consecutive
+ */
+int
+MetaCreateBatch::log(ostream& file) const
+{
+    if (numCreated <= 0) {
+        return 0;
+    }
+    file << "createbatch"
+        "/dir/"         << dir <<
+        "/id/"          << fid <<
+        "/numReplicas/" << numReplicas <<
+        "/ctime/"       << ShowTime(mtime) <<
+        "/user/"        << user <<
+        "/group/"       << group <<
+        "/mode/"        << mode
+    ;
+    if (minSTier < kKfsSTierMax) {
+        file << "/minTier/" << (int)minSTier << "/maxTier/" << (int)maxSTier;
+    }
+    file << "/names/";
+    file.write(names.data(), createdLen);
+    file << '\n';
+    return file.fail() ? -EIO : 0;
+}
+
 /*!
  * \brief log a directory create
  */
@@ -3615,6 +4249,15 @@ MetaRmdir::log(ostream &file) const
     return file.fail() ? -EIO : 0;
 }
 
+/*!
+ * \brief log recursive directory removal (nop), the steps log the mutations
+ */
+int
+MetaRmdirs::log(ostream& /* file */) const
+{
+    return 0;
+}
+
 /*!
  * \brief log directory read (nop)
  */
@@ -3651,6 +4294,15 @@ MetaGetlayout::log(ostream &file) const
     return 0;
 }
 
+/*!
+ * \brief log getdirlayout (nop)
+ */
+int
+MetaGetDirLayout::log(ostream &file) const
+{
+    return 0;
+}
+
 /*!
  * \brief log a chunk allocation
  */
@@ -4137,6 +4789,32 @@ MetaCreate::response(ostream &os)
     "\r\n";
 }
 
+void
+MetaCreateBatch::response(ostream &os)
+{
+    if (! OkHeader(this, os)) {
+        return;
+    }
+    os <<
+    "File-handle: "  << fid         << "\r\n"
+    "Num-created: "  << numCreated  << "\r\n"
+    "Num-replicas: " << numReplicas << "\r\n"
+    "User: "         << user        << "\r\n"
+    "Group: "        << group       << "\r\n"
+    "Mode: "         << mode        << "\r\n"
+    ;
+    if (failedStatus != 0) {
+        os << "Failed-status: " << -SysToKfsErrno(-failedStatus) << "\r\n";
+    }
+    if (minSTier < kKfsSTierMax) {
+        os <<
+        "Min-tier: " << (int)minSTier << "\r\n"
+        "Max-tier: " << (int)maxSTier << "\r\n";
+    }
+    UserAndGroupNamesReply(os, GetUserAndGroupNames(*this), user, group) <<
+    "\r\n";
+}
+
 void
 MetaRemove::response(ostream &os)
 {
@@ -4170,6 +4848,15 @@ MetaRmdir::response(ostream &os)
     PutHeader(this, os) << "\r\n";
 }
 
+void
+MetaRmdirs::response(ostream &os)
+{
+    PutHeader(this, os) <<
+        "Files-removed: " << filesRemoved << "\r\n"
+        "Dirs-removed: "  << dirsRemoved  << "\r\n"
+    "\r\n";
+}
+
 void
 MetaReaddir::response(ostream& os, IOBuffer& buf)
 {
@@ -4212,7 +4899,13 @@ MetaReaddirPlus::response(ostream& os, IOBuffer& buf)
         entryCount = writer.Write(dentries, lastChunkInfos,
             noAttrsFlag, GetUserAndGroupNames(*this));
     }
-    hasMoreEntriesFlag = hasMoreEntriesFlag || entryCount < dentries.size();
+    if (entryCount < dentries.size()) {
+        hasMoreEntriesFlag = true;
+        if (! fnamePattern.empty()) {
+            fnameNext = 0 < entryCount ?
+                dentries[entryCount - 1].name : string();
+        }
+    }
     dentries.clear();
     lastChunkInfos.clear();
     if (ioBufPending > 0) {
@@ -4228,7 +4921,11 @@ MetaReaddirPlus::response(ostream& os, IOBuffer& buf)
     }
     os <<
         "Num-Entries: "      << entryCount << "\r\n"
-        "Has-more-entries: " << (hasMoreEntriesFlag ? 1 : 0) << "\r\n"
+        "Has-more-entries: " << (hasMoreEntriesFlag ? 1 : 0) << "\r\n";
+    if (hasMoreEntriesFlag && ! fnameNext.empty()) {
+        os << "Fname-next: " << fnameNext << "\r\n";
+    }
+    os <<
         "Content-length: "   << resp.BytesConsumable() << "\r\n"
     "\r\n";
     os.flush();
@@ -4253,19 +4950,40 @@ MetaGetalloc::response(ostream& os)
     if (! OkHeader(this, os)) {
         return;
     }
-    os <<
-        "Chunk-handle: "  << chunkId << "\r\n"
-        "Chunk-version: " << chunkVersion << "\r\n";
+    IOBufferHeaderWriter writer(os);
+    writer.Write("Chunk-handle: ");
+    writer.WriteInt(chunkId);
+    writer.Write("\r\nChunk-version: ");
+    writer.WriteInt(chunkVersion);
+    writer.Write("\r\n");
     if (replicasOrderedFlag) {
-        os << "Replicas-ordered: 1\r\n";
+        writer.Write("Replicas-ordered: 1\r\n");
     }
-    os << "Num-replicas: " << locations.size() << "\r\n";
+    writer.Write("Num-replicas: ");
+    writer.WriteInt(locations.size());
+    writer.Write("\r\n");
 
     assert(locations.size() > 0);
 
-    os << "Replicas:";
-    for_each(locations.begin(), locations.end(), ListServerLocations(os));
-    os << "\r\n\r\n";
+    writer.Write("Replicas:");
+    for (ServerLocations::const_iterator it = locations.begin();
+            it != locations.end();
+            ++it) {
+        writer.Write(" ");
+        writer.Write(it->hostname);
+        writer.Write(" ");
+        writer.WriteInt(it->port);
+    }
+    if (loadHints.size() == locations.size()) {
+        writer.Write("\r\nReplicas-load:");
+        for (vector<int>::const_iterator it = loadHints.begin();
+                it != loadHints.end();
+                ++it) {
+            writer.Write(" ");
+            writer.WriteInt(*it);
+        }
+    }
+    writer.Write("\r\n\r\n");
 }
 
 void
@@ -4288,6 +5006,24 @@ MetaGetlayout::response(ostream& os, IOBuffer& buf)
     buf.Move(&resp);
 }
 
+void
+MetaGetDirLayout::response(ostream& os, IOBuffer& buf)
+{
+    if (! OkHeader(this, os)) {
+        return;
+    }
+    os <<
+        "Num-Entries: "      << numEntries << "\r\n"
+        "Num-servers: "      << numServers << "\r\n"
+        "Has-more-entries: " << (hasMoreEntriesFlag ? 1 : 0) << "\r\n"
+        "Content-length: "   <<
+            (servers.BytesConsumable() + resp.BytesConsumable()) << "\r\n"
+    "\r\n";
+    os.flush();
+    buf.Move(&servers);
+    buf.Move(&resp);
+}
+
 void
 MetaAllocate::response(ostream& os)
 {
@@ -4399,6 +5135,9 @@ MetaLeaseAcquire::response(ostream& os, IOBuffer& buf)
     }
     if (leaseId >= 0) {
         os << "Lease-id: " << leaseId << "\r\n";
+        if (LEASE_INTERVAL_SECS < leaseTimeout) {
+            os << "Lease-timeout: " << leaseTimeout << "\r\n";
+        }
     }
     if (clientCSAllowClearTextFlag) {
         os << "CS-clear-text: 1\r\n";
@@ -4500,6 +5239,9 @@ MetaLeaseRenew::response(ostream& os, IOBuffer& buf)
     if (clientCSAllowClearTextFlag) {
         os << "CS-clear-text: 1\r\n";
     }
+    if (! failedLeases.empty()) {
+        os << "Failed-leases: " << failedLeases << "\r\n";
+    }
     const size_t count = chunkAccess.GetSize();
     if (count <= 0) {
         os << "\r\n";
@@ -4959,6 +5701,9 @@ MetaChunkAllocate::request(ostream& os)
         "Min-tier: "      << (int)minSTier     << "\r\n"
         "Max-tier: "      << (int)maxSTier     << "\r\n"
     ;
+    if (req->traceId != 0) {
+        os << "Trace-id: " << req->traceId << "\r\n";
+    }
     if (0 <= leaseId) {
         os << "Lease-id: " << leaseId << "\r\n";
         if (req->clientCSAllowClearTextFlag) {
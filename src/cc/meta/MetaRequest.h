@@ -38,6 +38,7 @@
 #include "util.h"
 
 #include "kfsio/KfsCallbackObj.h"
+#include "kfsio/ITimeout.h"
 #include "kfsio/IOBuffer.h"
 #include "kfsio/NetConnection.h"
 #include "kfsio/CryptoKeys.h"
@@ -146,7 +147,11 @@ using std::less;
     f(DELEGATE_CANCEL) \
     f(SET_FILE_SYSTEM_INFO) \
     f(FORCE_CHUNK_REPLICATION) \
-    f(CLEAR_OBJ_STORE_DELETE)
+    f(CLEAR_OBJ_STORE_DELETE) \
+    f(RMDIRS) \
+    f(RMDIRS_STEP) \
+    f(GETDIRLAYOUT) \
+    f(CREATE_BATCH)
 
 enum MetaOp {
 #define KfsMakeMetaOpEnumEntry(name) META_##name,
@@ -206,6 +211,7 @@ struct MetaRequest {
     kfsUid_t        euser;
     kfsGid_t        egroup;
     int64_t         maxWaitMillisec;
+    int64_t         traceId;         //!< optional client request trace id
     int64_t         sessionEndTime;
     MetaRequest*    next;
     KfsCallbackObj* clnt;            //!< a handle to the client that generated this request.
@@ -231,6 +237,7 @@ struct MetaRequest {
           euser(kKfsUserNone),
           egroup(kKfsGroupNone),
           maxWaitMillisec(-1),
+          traceId(0),
           sessionEndTime(),
           next(0),
           clnt(0)
@@ -272,6 +279,7 @@ struct MetaRequest {
         .Def("UserId",                  &MetaRequest::euser,  kKfsUserNone)
         .Def("GroupId",                 &MetaRequest::egroup, kKfsGroupNone)
         .Def("Max-wait-ms",             &MetaRequest::maxWaitMillisec, int64_t(-1))
+        .Def("Trace-id",                &MetaRequest::traceId,        int64_t(0))
         ;
     }
     virtual ostream& ShowSelf(ostream& os) const = 0;
@@ -485,6 +493,87 @@ struct MetaCreate: public MetaRequest {
     }
 };
 
+/*!
+ * \brief create a batch of files in one directory with a single log record.
+ * The files are created in the order of the names, until the first failure;
+ * the ids of the files created are consecutive, starting from fid.
+ * At most kMaxNames files are created, in order to keep the log record
+ * within the log entry token limit; the client resubmits the remaining names.
+ */
+struct MetaCreateBatch: public MetaRequest {
+    enum { kMaxNames = 512 };
+    fid_t      dir;          //!< parent directory fid
+    fid_t      fid;          //!< file ID of the first file created
+    int16_t    numReplicas;  //!< desired degree of replication
+    kfsUid_t   user;
+    kfsGid_t   group;
+    kfsMode_t  mode;
+    kfsSTier_t minSTier;
+    kfsSTier_t maxSTier;
+    int        numCreated;   //!< number of files created
+    int        failedStatus; //!< status of the first name not created
+    size_t     createdLen;   //!< length of the created names prefix
+    string     names;        //!< '/' separated names to create
+    string     ownerName;
+    string     groupName;
+    int64_t    mtime;
+    MetaCreateBatch()
+        : MetaRequest(META_CREATE_BATCH, true),
+          dir(-1),
+          fid(-1),
+          numReplicas(1),
+          user(kKfsUserNone),
+          group(kKfsGroupNone),
+          mode(kKfsModeUndef),
+          minSTier(kKfsSTierMax),
+          maxSTier(kKfsSTierMax),
+          numCreated(0),
+          failedStatus(0),
+          createdLen(0),
+          names(),
+          ownerName(),
+          groupName(),
+          mtime()
+        {}
+    virtual void handle();
+    virtual int log(ostream &file) const;
+    virtual void response(ostream &os);
+    virtual ostream& ShowSelf(ostream& os) const
+    {
+        return os <<
+            "create batch:"
+            " parent: "      << dir <<
+            " replication: " << numReplicas <<
+            " created: "     << numCreated <<
+            " first: "       << fid <<
+            " failed: "      << failedStatus <<
+            " user: "        << user <<
+            " group: "       << group <<
+            " mode: "        << oct << mode << dec <<
+            " names: "       << names.size()
+        ;
+    }
+    bool Validate()
+    {
+        return (dir >= 0 && ! names.empty() && 0 <= numReplicas);
+    }
+    template<typename T> static T& ParserDef(T& parser)
+    {
+        return MetaRequest::ParserDef(parser)
+        .Def("Parent File-handle", &MetaCreateBatch::dir,         fid_t(-1))
+        .Def("Num-replicas",       &MetaCreateBatch::numReplicas, int16_t( 1))
+        .Def("Filenames",          &MetaCreateBatch::names             )
+        .Def("Owner",              &MetaCreateBatch::user,        kKfsUserNone)
+        .Def("Group",              &MetaCreateBatch::group,       kKfsGroupNone)
+        .Def("Mode",               &MetaCreateBatch::mode,        kKfsModeUndef)
+        .Def("Min-tier",           &MetaCreateBatch::minSTier,    kKfsSTierMax)
+        .Def("Max-tier",           &MetaCreateBatch::maxSTier,    kKfsSTierMax)
+        .Def("OName",              &MetaCreateBatch::ownerName)
+        .Def("GName",              &MetaCreateBatch::groupName)
+        ;
+    }
+};
+
 /*!
  * \brief create a directory
  */
@@ -636,6 +725,100 @@ struct MetaRmdir: public MetaRequest {
     }
 };
 
+/*!
+ * \brief remove directory tree. The tree is removed incrementally by a
+ * sequence of internal mutation steps, scheduled from the net manager timer,
+ * with each step bounded by the configured number of entries, in order to let
+ * other requests run in between. The steps emit the regular remove and rmdir
+ * log records, therefore the log replay doesn't need to know about this
+ * request.
+ */
+struct MetaRmdirs: public MetaRequest, public KfsCallbackObj, public ITimeout {
+    fid_t   dir;          //!< parent directory fid
+    string  name;         //!< name to remove
+    string  pathname;     //!< full pathname to remove
+    int64_t filesRemoved; //!< output
+    int64_t dirsRemoved;  //!< output
+    MetaRmdirs()
+        : MetaRequest(META_RMDIRS, false),
+          KfsCallbackObj(),
+          ITimeout(),
+          dir(-1),
+          name(),
+          pathname(),
+          filesRemoved(0),
+          dirsRemoved(0),
+          stack(),
+          startedFlag(false),
+          stepInFlightFlag(false),
+          timerFlag(false)
+        { SET_HANDLER(this, &MetaRmdirs::stepDone); }
+    virtual ~MetaRmdirs();
+    virtual void handle();
+    virtual int log(ostream &file) const;
+    virtual void response(ostream &os);
+    virtual void Timeout();
+    virtual ostream& ShowSelf(ostream& os) const
+    {
+        return os <<
+            "rmdirs:"
+            " path: "   << pathname <<
+            " name: "   << name <<
+            " parent: " << dir <<
+            " files: "  << filesRemoved <<
+            " dirs: "   << dirsRemoved
+        ;
+    }
+    bool Validate()
+    {
+        return (dir >= 0 && ! name.empty());
+    }
+    template<typename T> static T& ParserDef(T& parser)
+    {
+        return MetaRequest::ParserDef(parser)
+        .Def("Parent File-handle", &MetaRmdirs::dir, fid_t(-1))
+        .Def("Directory",          &MetaRmdirs::name          )
+        .Def("Pathname",           &MetaRmdirs::pathname      )
+        ;
+    }
+    // Invoked by the step request, appends the log records of the performed
+    // mutations to the stream.
+    void Step(ostream& logs);
+    static void SetParameters(const Properties& props);
+private:
+    struct Frame
+    {
+        Frame(fid_t id = -1, fid_t p = -1,
+                const string& n = string(), const string& pn = string())
+            : fid(id),
+              parent(p),
+              name(n),
+              path(pn),
+              files(),
+              dirs(),
+              listedFlag(false),
+              moreFlag(false)
+            {}
+        fid_t          fid;
+        fid_t          parent;
+        string         name;
+        string         path;
+        vector<string> files;
+        vector<string> dirs;
+        bool           listedFlag;
+        bool           moreFlag;
+    };
+    vector<Frame> stack;
+    bool          startedFlag;
+    bool          stepInFlightFlag;
+    bool          timerFlag;
+
+    int stepDone(int code, void* data);
+    int list(Frame& frame);
+    void setTimer(bool flag);
+    static int sMaxEntriesPerStep;
+};
+
 /*!
  * \brief read directory contents
  */
@@ -737,6 +920,8 @@ struct MetaReaddirPlus: public MetaRequest {
     bool     noAttrsFlag;
     int64_t  ioBufPending;
     string   fnameStart;
+    string   fnamePattern; //!< if set, return only the matching names
+    string   fnameNext;    //!< restart point, if filtered by pattern
     DEntries dentries;
     CInfos   lastChunkInfos;
 
@@ -752,6 +937,8 @@ struct MetaReaddirPlus: public MetaRequest {
           noAttrsFlag(false),
           ioBufPending(0),
           fnameStart(),
+          fnamePattern(),
+          fnameNext(),
           dentries(),
           lastChunkInfos()
         {}
@@ -779,6 +966,7 @@ struct MetaReaddirPlus: public MetaRequest {
             &MetaReaddirPlus::omitLastChunkInfoFlag, false)
         .Def("FidT-only",
             &MetaReaddirPlus::fileIdAndTypeOnlyFlag, false)
+        .Def("Fname-pattern",         &MetaReaddirPlus::fnamePattern)
         ;
     }
 };
@@ -795,6 +983,7 @@ struct MetaGetalloc: public MetaRequest {
     ServerLocations locations;    //!< where the copies of the chunks are
     StringBufT<256> pathname;     //!< pathname of the file (useful to print in debug msgs)
     bool            replicasOrderedFlag;
+    vector<int>     loadHints;    //!< load hints of the locations
     MetaGetalloc()
         : MetaRequest(META_GETALLOC, false),
           fid(-1),
@@ -804,7 +993,8 @@ struct MetaGetalloc: public MetaRequest {
           chunkVersion(-1),
           locations(),
           pathname(),
-          replicasOrderedFlag(false)
+          replicasOrderedFlag(false),
+          loadHints()
         {}
     virtual void handle();
     virtual int log(ostream &file) const;
@@ -884,6 +1074,53 @@ struct MetaGetlayout: public MetaRequest {
     }
 };
 
+/*!
+ * \brief Get the chunk layout and locations of all files in a directory, in
+ * order to let the job planners avoid a round trip per file or chunk. The
+ * response starts with the table of the chunk servers, and the chunk
+ * locations are indices into the table. The directory is listed in batches
+ * of at most max entries, and max response size.
+ */
+struct MetaGetDirLayout: public MetaRequest {
+    fid_t    dir;         //!< directory to list
+    int      numEntries;  //!< max number of entries to return
+    string   fnameStart;  //!< start listing after this name
+    bool     hasMoreEntriesFlag;
+    int      numServers;
+    IOBuffer servers;     //!< server table
+    IOBuffer resp;        //!< entries
+    MetaGetDirLayout()
+        : MetaRequest(META_GETDIRLAYOUT, false),
+          dir(-1),
+          numEntries(0),
+          fnameStart(),
+          hasMoreEntriesFlag(false),
+          numServers(0),
+          servers(),
+          resp()
+        {}
+    virtual void handle();
+    virtual int log(ostream &file) const;
+    virtual void response(ostream &os, IOBuffer& buf);
+    virtual ostream& ShowSelf(ostream& os) const
+    {
+        return os << "getdirlayout: dir: " << dir <<
+            " start: " << fnameStart;
+    }
+    bool Validate()
+    {
+        return (dir >= 0);
+    }
+    template<typename T> static T& ParserDef(T& parser)
+    {
+        return MetaRequest::ParserDef(parser)
+        .Def("Directory File-handle", &MetaGetDirLayout::dir,        fid_t(-1))
+        .Def("Max-entries",           &MetaGetDirLayout::numEntries, 0)
+        .Def("Fname-start",           &MetaGetDirLayout::fnameStart)
+        ;
+    }
+};
+
 /*!
  * \brief Op for relinquishing a lease on a chunk of a file.
  */
@@ -1416,6 +1653,8 @@ struct MetaHello : public MetaRequest, public ServerLocation {
     int64_t            fileSystemId;
     int64_t            metaFileSystemId;
     bool               noFidsFlag;
+    size_t             chunksPos;                //!< # of stable chunks processed
+    int64_t            staleChunksCount;
 
     MetaHello()
         : MetaRequest(META_HELLO, false),
@@ -1447,7 +1686,9 @@ struct MetaHello : public MetaRequest, public ServerLocation {
           deleteAllChunksFlag(false),
           fileSystemId(-1),
           metaFileSystemId(-1),
-          noFidsFlag(false)
+          noFidsFlag(false),
+          chunksPos(0),
+          staleChunksCount(0)
         {}
     virtual void handle();
     virtual int log(ostream &file) const;
@@ -2091,9 +2332,11 @@ struct MetaChunkServerRestart : public MetaChunkRequest {
  */
 struct MetaPing : public MetaRequest {
     IOBuffer resp;
+    int64_t  notModifiedGeneration;
     MetaPing()
         : MetaRequest(META_PING, false),
-          resp()
+          resp(),
+          notModifiedGeneration(-1)
     {
         // Suppress warning with requests with no version filed.
         clientProtoVers = KFS_CLIENT_PROTO_VERS;
@@ -2112,6 +2355,7 @@ struct MetaPing : public MetaRequest {
     template<typename T> static T& ParserDef(T& parser)
     {
         return MetaRequest::ParserDef(parser)
+        .Def("If-not-generation", &MetaPing::notModifiedGeneration, int64_t(-1))
         ;
     }
 };
@@ -2355,6 +2599,7 @@ private:
     IOBuffer      resp;
     static string sTmpName;
     static int    sMaxFsckResponseSize;
+    static int    sChildNice;
 };
 
 /*!
@@ -2542,9 +2787,17 @@ struct MetaCheckpoint : public MetaRequest {
           checkpointWriteTimeoutSec(60 * 60),
           checkpointWriteSyncFlag(true),
           checkpointWriteBufferSize(16 << 20),
+          checkpointBinaryFormatFlag(false),
           lastCheckpointId(-1),
           runningCheckpointId(-1),
-          lastRun(0)
+          lastRun(0),
+          useLogCompactorFlag(false),
+          logCompactorPath("logcompactor"),
+          startTime(0),
+          lastStallUsec(0),
+          lastDurationUsec(0),
+          lastSize(0),
+          checkpointCount(0)
         { clnt = c; }
     virtual void handle();
     virtual int log(ostream &file) const
@@ -2557,6 +2810,12 @@ struct MetaCheckpoint : public MetaRequest {
     }
     void SetParameters(const Properties& props);
     void ScheduleNow();
+    //!< time the main thread spent starting the last checkpoint
+    int64_t GetLastStallUsec() const    { return lastStallUsec; }
+    int64_t GetLastDurationUsec() const { return lastDurationUsec; }
+    int64_t GetLastSize() const         { return lastSize; }
+    int64_t GetCount() const            { return checkpointCount; }
+    bool IsUsingLogCompactor() const    { return useLogCompactorFlag; }
 private:
     string lockFileName;
     int    lockFd;
@@ -2567,9 +2826,19 @@ private:
     int    checkpointWriteTimeoutSec;
     bool   checkpointWriteSyncFlag;
     size_t checkpointWriteBufferSize;
+    bool   checkpointBinaryFormatFlag;
     seq_t  lastCheckpointId;
     seq_t  runningCheckpointId;
     time_t lastRun;
+    bool    useLogCompactorFlag;
+    string  logCompactorPath;
+    int64_t startTime;
+    int64_t lastStallUsec;
+    int64_t lastDurationUsec;
+    int64_t lastSize;
+    int64_t checkpointCount;
+
+    int SpawnLogCompactor();
 };
 
 /*!
@@ -3032,6 +3301,9 @@ struct MetaLeaseRenew: public MetaRequest {
     const ChunkServer* chunkServer;
     int                validForTime;
     TokenSeq           tokenSeq;
+    string             chunkLeases;  //!< additional "chunk lease" id
+                                     //!< pairs to renew
+    string             failedLeases; //!< "chunk status" pairs
     MetaLeaseRenew()
         : MetaRequest(META_LEASE_RENEW, false),
           leaseType(READ_LEASE),
@@ -3047,6 +3319,8 @@ struct MetaLeaseRenew: public MetaRequest {
           chunkServer(0),
           validForTime(0),
           tokenSeq(0),
+          chunkLeases(),
+          failedLeases(),
           leaseTypeStr()
         {}
     virtual void handle();
@@ -3080,10 +3354,12 @@ struct MetaLeaseRenew: public MetaRequest {
         .Def("Chunk-pos",    &MetaLeaseRenew::chunkPos, chunkOff_t(-1))
         .Def("CS-access",    &MetaLeaseRenew::emitCSAccessFlag)
         .Def("Chunk-server", &MetaLeaseRenew::chunkServerName)
+        .Def("Chunk-leases", &MetaLeaseRenew::chunkLeases)
         ;
     }
 private:
     StringBufT<32> leaseTypeStr;
+    void RenewChunkLeases();
 };
 
 /*!
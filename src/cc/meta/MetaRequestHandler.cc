@@ -13,13 +13,16 @@ static const MetaRequestHandler& MakeMetaRequestHandler()
     .MakeParser<MetaLookup               >("LOOKUP")
     .MakeParser<MetaLookupPath           >("LOOKUP_PATH")
     .MakeParser<MetaCreate               >("CREATE")
+    .MakeParser<MetaCreateBatch          >("CREATE_BATCH")
     .MakeParser<MetaMkdir                >("MKDIR")
     .MakeParser<MetaRemove               >("REMOVE")
     .MakeParser<MetaRmdir                >("RMDIR")
+    .MakeParser<MetaRmdirs               >("RMDIRS")
     .MakeParser<MetaReaddir              >("READDIR")
     .MakeParser<MetaReaddirPlus          >("READDIRPLUS")
     .MakeParser<MetaGetalloc             >("GETALLOC")
     .MakeParser<MetaGetlayout            >("GETLAYOUT")
+    .MakeParser<MetaGetDirLayout         >("GETDIRLAYOUT")
     .MakeParser<MetaAllocate             >("ALLOCATE")
     .MakeParser<MetaTruncate             >("TRUNCATE")
     .MakeParser<MetaRename               >("RENAME")
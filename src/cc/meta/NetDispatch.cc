@@ -39,6 +39,7 @@
 #include "kfsio/IOBuffer.h"
 #include "kfsio/SslFilter.h"
 #include "kfsio/CryptoKeys.h"
+#include "kfsio/MetricsServer.h"
 #include "common/Properties.h"
 #include "common/MsgLogger.h"
 #include "common/time.h"
@@ -49,14 +50,17 @@
 #include "qcdio/qcstutils.h"
 
 #include <inttypes.h>
+#include <stdio.h>
 #include <algorithm>
 #include <vector>
 #include <set>
+#include <sstream>
 
 namespace KFS
 {
 using std::max;
 using std::vector;
+using std::ostringstream;
 
 using KFS::libkfsio::globalNetManager;
 using KFS::libkfsio::globals;
@@ -314,6 +318,80 @@ NetDispatch::GetCanceledTokensUpdateCount() const
     return mCanceledTokens.GetUpdateCount();
 }
 
+static void WriteRequestMetrics(MetricsServer::Writer& writer);
+
+// Exports the "System Info" part of the ping response, the counter manager
+// counters, and the request counters and latency histograms.
+class NetDispatch::Metrics : public MetricsServer::Source
+{
+public:
+    Metrics()
+        : MetricsServer::Source(),
+          mServer(*this),
+          mBuf(),
+          mStr(),
+          mStream()
+        {}
+    virtual ~Metrics()
+        { mServer.Shutdown(); }
+    void SetParameters(
+        const Properties& props)
+    {
+        const int err = mServer.SetParameters(
+            props, "metaServer.metrics.", globalNetManager());
+        if (err) {
+            KFS_LOG_STREAM_ERROR <<
+                "failed to start metrics server: " <<
+                    QCUtils::SysError(-err) <<
+            KFS_LOG_EOM;
+        }
+    }
+    void Shutdown()
+        { mServer.Shutdown(); }
+    virtual void GetMetrics(
+        MetricsServer::Writer& writer)
+    {
+        const char* const kPrefix = "qfs_meta_";
+        mBuf.Clear();
+        gLayoutManager.Ping(mBuf, false);
+        const char* const kSysInfo = "\r\nSystem Info: ";
+        const int         pos      = mBuf.IndexOf(0, kSysInfo);
+        if (0 <= pos) {
+            const int start = pos + (int)strlen(kSysInfo);
+            const int end   = mBuf.IndexOf(start, "\r\n");
+            if (start < end) {
+                mStr.resize(end);
+                mStr.resize(mBuf.CopyOut(&mStr[0], end));
+                if (start < (int)mStr.size()) {
+                    writer.Records(kPrefix, mStr.data() + start,
+                        mStr.data() + mStr.size(), '=', "\t");
+                }
+            }
+        }
+        mBuf.Clear();
+        mStream.str(string());
+        globals().counterManager.Show(mStream);
+        const bool kTraceFlag = false;
+        globalNetManager().ShowProfile(mStream, kTraceFlag);
+        mStr = mStream.str();
+        mStream.str(string());
+        writer.Records(kPrefix, mStr.data(), mStr.data() + mStr.size(),
+            ':', "\r\n");
+        mStr.clear();
+        WriteRequestMetrics(writer);
+    }
+private:
+    MetricsServer mServer;
+    IOBuffer      mBuf;
+    string        mStr;
+    ostringstream mStream;
+private:
+    Metrics(
+        const Metrics&);
+    Metrics& operator=(
+        const Metrics&);
+};
+
 NetDispatch::NetDispatch()
     : mClientManager(),
       mChunkServerFactory(),
@@ -321,6 +399,7 @@ NetDispatch::NetDispatch()
       mClientManagerMutex(0),
       mCryptoKeys(0),
       mCanceledTokens(*(new CanceledTokens())),
+      mMetrics(*(new Metrics())),
       mRunningFlag(false),
       mClientThreadCount(0),
       mClientThreadsStartCpuAffinity(-1)
@@ -329,6 +408,7 @@ NetDispatch::NetDispatch()
 
 NetDispatch::~NetDispatch()
 {
+    delete &mMetrics;
     delete &mCanceledTokens;
 }
 
@@ -436,6 +516,7 @@ NetDispatch::Start()
     }
     mClientManager.Shutdown();
     mCanceledTokens.Set(0, 0);
+    mMetrics.Shutdown();
     mRunningFlag = false;
     mCryptoKeys = 0;
     mClientManagerMutex = 0;
@@ -581,16 +662,19 @@ private:
     {
         AddCounter("Get alloc", META_GETALLOC);
         AddCounter("Get layout", META_GETLAYOUT);
+        AddCounter("Get dir layout", META_GETDIRLAYOUT);
         AddCounter("Lookup", META_LOOKUP);
         AddCounter("Lookup Path", META_LOOKUP_PATH);
         AddCounter("Allocate", META_ALLOCATE);
         AddCounter("Truncate", META_TRUNCATE);
         AddCounter("Create", META_CREATE);
+        AddCounter("Create batch", META_CREATE_BATCH);
         AddCounter("Remove", META_REMOVE);
         AddCounter("Rename", META_RENAME);
         AddCounter("Set Mtime", META_SETMTIME);
         AddCounter("Mkdir", META_MKDIR);
         AddCounter("Rmdir", META_RMDIR);
+        AddCounter("Rmdirs", META_RMDIRS);
         AddCounter("Change File Replication", META_CHANGE_FILE_REPLICATION);
         AddCounter("Lease Acquire", META_LEASE_ACQUIRE);
         AddCounter("Lease Renew", META_LEASE_RENEW);
@@ -634,6 +718,7 @@ public:
                 " is: "            << (reqProcTimeUsec * 1e-6) <<
                 " total: "         << (reqTimeUsec * 1e-6) <<
                 " was submitted: " << op.submitCount <<
+                " trace: "         << op.traceId <<
             KFS_LOG_EOM;
         }
         const int idx =
@@ -645,12 +730,8 @@ public:
         const int64_t reqTime     = reqTimeUsec > 0 ? reqTimeUsec : 0;
         const int64_t reqProcTime =
             reqProcTimeUsec > 0 ? reqProcTimeUsec : 0;
-        mRequest[  0].mCnt++;
-        mRequest[  0].mTime     += reqTime;
-        mRequest[  0].mProcTime += reqProcTime;
-        mRequest[idx].mCnt++;
-        mRequest[idx].mTime     += reqTime;
-        mRequest[idx].mProcTime += reqProcTime;
+        mRequest[  0].Update(reqTime, reqProcTime);
+        mRequest[idx].Update(reqTime, reqProcTime);
         if (op.status < 0) {
             mRequest[  0].mErr++;
             mRequest[idx].mErr++;
@@ -720,7 +801,9 @@ public:
             mRequest[kCpuUser].mProcTime = mUserCpuMicroSec;
             mRequest[kCpuSys ].mProcTime = mSystemCpuMicroSec;
         }
-        os << "Name,Total,%-total,Errors,%-errors,Time-total,Time-CPU\n";
+        os << "Name,Total,%-total,Errors,%-errors,Time-total,Time-CPU"
+            ",Time-p50,Time-p99,Time-wait-p50,Time-wait-p99"
+            ",Time-CPU-p50,Time-CPU-p99\n";
         const double ptotal  =
             100. / (double)max(int64_t(1), mRequest[0].mCnt);
         const double perrors =
@@ -735,6 +818,12 @@ public:
                 kDelim << (mRequest[i].mErr * perrors) <<
                 kDelim << mRequest[i].mTime <<
                 kDelim << mRequest[i].mProcTime <<
+                kDelim << mRequest[i].mTimeHist.Percentile(50) <<
+                kDelim << mRequest[i].mTimeHist.Percentile(99) <<
+                kDelim << mRequest[i].mWaitTimeHist.Percentile(50) <<
+                kDelim << mRequest[i].mWaitTimeHist.Percentile(99) <<
+                kDelim << mRequest[i].mProcTimeHist.Percentile(50) <<
+                kDelim << mRequest[i].mProcTimeHist.Percentile(99) <<
                 "\n"
             ;
         }
@@ -745,6 +834,58 @@ public:
         GetStatsCsv(mWOStream.Set(buf));
         mWOStream.Reset();
     }
+    void WriteMetrics(
+        MetricsServer::Writer& writer)
+    {
+        const char* const kPrefix = "qfs_meta_";
+        ostream&          os      = writer.GetStream();
+        // Skip the TOTAL row, the per request type rows add up to it.
+        if (writer.Family(kPrefix, "requests", "counter")) {
+            for (int i = 1; i <= kReqTypeAllocNoLog; i++) {
+                if (0 < mRequest[i].mCnt) {
+                    os << writer.GetName() << "_total{op=\"" <<
+                        GetRowName(i) << "\"} " << mRequest[i].mCnt << "\n";
+                }
+            }
+        }
+        if (writer.Family(kPrefix, "request_errors", "counter")) {
+            for (int i = 1; i <= kReqTypeAllocNoLog; i++) {
+                if (0 < mRequest[i].mCnt) {
+                    os << writer.GetName() << "_total{op=\"" <<
+                        GetRowName(i) << "\"} " << mRequest[i].mErr << "\n";
+                }
+            }
+        }
+        if (writer.Family(kPrefix, "request_time_seconds", "histogram")) {
+            for (int i = 1; i <= kReqTypeAllocNoLog; i++) {
+                if (0 < mRequest[i].mCnt) {
+                    WriteHistogram(os, writer.GetName(), GetRowName(i),
+                        mRequest[i].mTimeHist, mRequest[i].mTime);
+                }
+            }
+        }
+        if (writer.Family(kPrefix, "request_processing_time_seconds",
+                "histogram")) {
+            for (int i = 1; i <= kReqTypeAllocNoLog; i++) {
+                if (0 < mRequest[i].mCnt) {
+                    WriteHistogram(os, writer.GetName(), GetRowName(i),
+                        mRequest[i].mProcTimeHist, mRequest[i].mProcTime);
+                }
+            }
+        }
+        int64_t userCpuMicroSec   = 0;
+        int64_t systemCpuMicroSec = 0;
+        if (0 <= cputime(&userCpuMicroSec, &systemCpuMicroSec)) {
+            if (writer.Family(kPrefix, "cpu_user_seconds", "counter")) {
+                os << writer.GetName() << "_total " <<
+                    userCpuMicroSec * 1e-6 << "\n";
+            }
+            if (writer.Family(kPrefix, "cpu_system_seconds", "counter")) {
+                os << writer.GetName() << "_total " <<
+                    systemCpuMicroSec * 1e-6 << "\n";
+            }
+        }
+    }
     int64_t GetUserCpuMicroSec() const
         { return mUserCpuMicroSec; }
     int64_t GetSystemCpuMicroSec() const
@@ -758,17 +899,86 @@ private:
         kCpuSys            = kCpuUser + 1,
         kReqTypesCnt       = kCpuSys + 1
     };
+    // Log2 micro seconds buckets histogram, the percentiles reported are
+    // the upper bounds of the buckets, i.e. within factor of 2 of the actual
+    // values.
+    class Histogram
+    {
+    public:
+        enum { kBucketsCount = 40 };
+        Histogram()
+            : mTotal(0)
+        {
+            for (int i = 0; i < kBucketsCount; i++) {
+                mBuckets[i] = 0;
+            }
+        }
+        void Update(
+            int64_t inTime)
+        {
+            int     idx = 0;
+            int64_t val = inTime;
+            while (0 < val && idx < kBucketsCount - 1) {
+                val >>= 1;
+                idx++;
+            }
+            mBuckets[idx]++;
+            mTotal++;
+        }
+        int64_t Percentile(
+            int inPercent) const
+        {
+            if (mTotal <= 0) {
+                return 0;
+            }
+            const int64_t thresh = (mTotal * inPercent + 99) / 100;
+            int64_t       cnt    = 0;
+            for (int i = 0; i < kBucketsCount; i++) {
+                cnt += mBuckets[i];
+                if (thresh <= cnt) {
+                    return (i <= 0 ? int64_t(0) : (int64_t(1) << i) - 1);
+                }
+            }
+            return ((int64_t(1) << (kBucketsCount - 1)) - 1);
+        }
+        int64_t GetTotal() const
+            { return mTotal; }
+        int64_t GetBucket(
+            int inIdx) const
+            { return mBuckets[inIdx]; }
+    private:
+        int64_t mTotal;
+        int64_t mBuckets[kBucketsCount];
+    };
     struct Counter {
         Counter()
             : mCnt(0),
               mErr(0),
               mTime(0),
-              mProcTime(0)
+              mProcTime(0),
+              mTimeHist(),
+              mWaitTimeHist(),
+              mProcTimeHist()
             {}
-        int64_t mCnt;
-        int64_t mErr;
-        int64_t mTime;
-        int64_t mProcTime;
+        void Update(
+            int64_t inTime,
+            int64_t inProcTime)
+        {
+            mCnt++;
+            mTime     += inTime;
+            mProcTime += inProcTime;
+            mTimeHist.Update(inTime);
+            mWaitTimeHist.Update(
+                inProcTime < inTime ? inTime - inProcTime : int64_t(0));
+            mProcTimeHist.Update(inProcTime);
+        }
+        int64_t   mCnt;
+        int64_t   mErr;
+        int64_t   mTime;
+        int64_t   mProcTime;
+        Histogram mTimeHist;
+        Histogram mWaitTimeHist;
+        Histogram mProcTimeHist;
     };
     int64_t            mNextTime;
     int64_t            mStatsIntervalMicroSec;
@@ -778,6 +988,35 @@ private:
     Counter            mRequest[kReqTypesCnt];
     IOBuffer::WOStream mWOStream;
 
+    // Bucket i upper bound is 2^i - 1 micro seconds, the last bucket has no
+    // upper bound. Trailing empty buckets are omitted.
+    static void WriteHistogram(
+        ostream&         os,
+        const string&    name,
+        const char*      op,
+        const Histogram& hist,
+        int64_t          sumMicroSec)
+    {
+        int last = Histogram::kBucketsCount - 2;
+        while (0 < last && hist.GetBucket(last) <= 0) {
+            last--;
+        }
+        char    buf[32];
+        int64_t cnt = 0;
+        for (int i = 0; i <= last; i++) {
+            cnt += hist.GetBucket(i);
+            snprintf(buf, sizeof(buf), "%.12g",
+                (double)((int64_t(1) << i) - 1) * 1e-6);
+            os << name << "_bucket{op=\"" << op << "\",le=\"" << buf <<
+                "\"} " << cnt << "\n";
+        }
+        os << name << "_bucket{op=\"" << op << "\",le=\"+Inf\"} " <<
+            hist.GetTotal() << "\n";
+        os << name << "_count{op=\"" << op << "\"} " <<
+            hist.GetTotal() << "\n";
+        snprintf(buf, sizeof(buf), "%.6f", sumMicroSec * 1e-6);
+        os << name << "_sum{op=\"" << op << "\"} " << buf << "\n";
+    }
     static const char* GetRowName(
         int idx)
     {
@@ -796,6 +1035,12 @@ private:
     }
 } sReqStatsGatherer;
 
+static void
+WriteRequestMetrics(MetricsServer::Writer& writer)
+{
+    sReqStatsGatherer.WriteMetrics(writer);
+}
+
 
 void NetDispatch::SetParameters(const Properties& props)
 {
@@ -819,9 +1064,12 @@ void NetDispatch::SetParameters(const Properties& props)
     globalNetManager().SetMaxAcceptsPerRead(props.getValue(
         "metaServer.net.maxAcceptsPerRead",
         globalNetManager().GetMaxAcceptsPerRead()));
+    globalNetManager().SetProfileParameters(
+        props, "metaServer.netManager.profile.");
 
     sReqStatsGatherer.SetParameters(props);
     mClientManager.SetParameters(props);
+    mMetrics.SetParameters(props);
 
     string errMsg;
     int    err;
@@ -1154,13 +1402,17 @@ public:
             mAuthContext.SetUserAndGroup(gLayoutManager.GetUserAndGroup());
         }
         assert(! mReqPendingHead && ! mReqPendingTail);
-        // Dispatch requests.
+        // Dispatch requests. Batch chunk server RPCs flushes, as a batch of
+        // close / lease relinquish requests can issue a number of RPCs to
+        // the same chunk server.
+        ChunkServer::BeginFlushBatch();
         while (nextReq) {
             MetaRequest& op = *nextReq;
             nextReq = op.next;
             op.next = 0;
             submit_request(&op);
         }
+        ChunkServer::EndFlushBatch();
         gNetDispatch.ForkDone();
         dispatchLocker.Unlock();
 
@@ -97,6 +97,7 @@ public:
     uint64_t GetCanceledTokensUpdateCount() const;
 private:
     class CanceledTokens;
+    class Metrics;
 
     ClientManager      mClientManager; //!< tracks the connected clients
     ChunkServerFactory mChunkServerFactory; //!< creates chunk servers when they connect
@@ -104,6 +105,7 @@ private:
     QCMutex*           mClientManagerMutex;
     CryptoKeys*        mCryptoKeys;
     CanceledTokens&    mCanceledTokens;
+    Metrics&           mMetrics;
     bool               mRunningFlag;
     int                mClientThreadCount;
     int                mClientThreadsStartCpuAffinity;
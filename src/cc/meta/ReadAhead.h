@@ -0,0 +1,251 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Read ahead stream buffer used by checkpoint load and log replay.
+//
+//----------------------------------------------------------------------------
+
+#ifndef META_READAHEAD_H
+#define META_READAHEAD_H
+
+#include "common/MsgLogger.h"
+#include "qcdio/QCThread.h"
+#include "qcdio/QCMutex.h"
+#include "qcdio/qcstutils.h"
+#include "qcdio/QCUtils.h"
+
+#include <unistd.h>
+#include <errno.h>
+
+#include <streambuf>
+#include <vector>
+#include <algorithm>
+
+namespace KFS
+{
+
+using std::streambuf;
+using std::vector;
+using std::max;
+
+/*!
+ * \brief fixed size ring of buffers passed between a producer and a
+ * consumer thread.
+ */
+class ReadAheadRing
+{
+public:
+    ReadAheadRing(int count, size_t size)
+        : mMutex(),
+          mCond(),
+          mBlocks(max(1, count)),
+          mLengths(max(1, count), size_t(0)),
+          mBlockSize(max(size_t(4) << 10, size)),
+          mStorage(new char[mBlocks.size() * mBlockSize]),
+          mFilled(0),
+          mRead(0),
+          mWrite(0),
+          mClosedFlag(false)
+    {
+        for (size_t i = 0; i < mBlocks.size(); i++) {
+            mBlocks[i] = mStorage + i * mBlockSize;
+        }
+    }
+    ~ReadAheadRing()
+        { delete [] mStorage; }
+    size_t GetBlockSize() const
+        { return mBlockSize; }
+    //!< wait for an empty block, returns 0 if closed
+    char* GetFree()
+    {
+        QCStMutexLocker locker(mMutex);
+        while (! mClosedFlag && mBlocks.size() <= mFilled) {
+            mCond.Wait(mMutex);
+        }
+        return (mClosedFlag ? 0 : mBlocks[mWrite]);
+    }
+    void PutFilled(size_t len)
+    {
+        QCStMutexLocker locker(mMutex);
+        mLengths[mWrite] = len;
+        mWrite = (mWrite + 1) % mBlocks.size();
+        mFilled++;
+        mCond.NotifyAll();
+    }
+    //!< wait for the next filled block, returns 0 if closed and empty
+    char* GetFilled(size_t& len)
+    {
+        QCStMutexLocker locker(mMutex);
+        while (! mClosedFlag && mFilled <= 0) {
+            mCond.Wait(mMutex);
+        }
+        if (mFilled <= 0) {
+            len = 0;
+            return 0;
+        }
+        len = mLengths[mRead];
+        return mBlocks[mRead];
+    }
+    void Release()
+    {
+        QCStMutexLocker locker(mMutex);
+        mRead = (mRead + 1) % mBlocks.size();
+        mFilled--;
+        mCond.NotifyAll();
+    }
+    void Close()
+    {
+        QCStMutexLocker locker(mMutex);
+        mClosedFlag = true;
+        mCond.NotifyAll();
+    }
+private:
+    QCMutex        mMutex;
+    QCCondVar      mCond;
+    vector<char*>  mBlocks;
+    vector<size_t> mLengths;
+    const size_t   mBlockSize;
+    char* const    mStorage;
+    size_t         mFilled;
+    size_t         mRead;
+    size_t         mWrite;
+    bool           mClosedFlag;
+private:
+    ReadAheadRing(const ReadAheadRing&);
+    ReadAheadRing& operator=(const ReadAheadRing&);
+};
+
+/*!
+ * \brief read ahead input stream buffer filled by a separate thread, in order
+ * to overlap disk io with checkpoint load and transaction log replay.
+ */
+class ReadAheadBuf : public QCRunnable, public streambuf
+{
+public:
+    ReadAheadBuf(int fd, int blockCount, size_t blockSize,
+            const char* name = "ReadAhead")
+        : QCRunnable(),
+          streambuf(),
+          mFd(fd),
+          mError(0),
+          mRing(blockCount, blockSize),
+          mThread(),
+          mName(name),
+          mCurFlag(false)
+        {}
+    ~ReadAheadBuf()
+        { ReadAheadBuf::Stop(); }
+    bool Start()
+    {
+        const int kStackSize = 64 << 10;
+        const int err = mThread.TryToStart(this, kStackSize, mName);
+        if (err) {
+            KFS_LOG_STREAM_ERROR << mName << ": " << QCUtils::SysError(
+                err, "failed to start read ahead thread") <<
+            KFS_LOG_EOM;
+        }
+        return (err == 0);
+    }
+    void Stop()
+    {
+        if (! mThread.IsStarted()) {
+            return;
+        }
+        mRing.Close();
+        mThread.Join();
+    }
+    int GetError() const
+        { return mError; }
+    virtual void Run()
+    {
+        char* buf;
+        while ((buf = mRing.GetFree())) {
+            const ssize_t len = Read(buf, mRing.GetBlockSize());
+            if (len <= 0) {
+                mRing.Close();
+                break;
+            }
+            mRing.PutFilled((size_t)len);
+        }
+    }
+protected:
+    virtual int_type underflow()
+    {
+        if (gptr() < egptr()) {
+            return traits_type::to_int_type(*gptr());
+        }
+        if (! mThread.IsStarted()) {
+            // No thread, read synchronously.
+            char* const buf = mRing.GetFree();
+            const ssize_t len = buf ? Read(buf, mRing.GetBlockSize()) : 0;
+            if (len <= 0) {
+                return traits_type::eof();
+            }
+            setg(buf, buf, buf + len);
+            return traits_type::to_int_type(*gptr());
+        }
+        if (mCurFlag) {
+            setg(0, 0, 0);
+            mRing.Release();
+            mCurFlag = false;
+        }
+        size_t      len = 0;
+        char* const buf = mRing.GetFilled(len);
+        if (! buf) {
+            return traits_type::eof();
+        }
+        mCurFlag = true;
+        setg(buf, buf, buf + len);
+        return traits_type::to_int_type(*gptr());
+    }
+private:
+    const int     mFd;
+    volatile int  mError;
+    ReadAheadRing mRing;
+    QCThread      mThread;
+    const char*   mName;
+    bool          mCurFlag;
+
+    ssize_t Read(char* buf, size_t size)
+    {
+        size_t pos = 0;
+        while (pos < size) {
+            const ssize_t nrd = read(mFd, buf + pos, size - pos);
+            if (nrd < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                mError = errno > 0 ? errno : EIO;
+                return -1;
+            }
+            if (nrd == 0) {
+                break;
+            }
+            pos += nrd;
+        }
+        return (ssize_t)pos;
+    }
+private:
+    ReadAheadBuf(const ReadAheadBuf&);
+    ReadAheadBuf& operator=(const ReadAheadBuf&);
+};
+
+} // namespace KFS
+
+#endif /* META_READAHEAD_H */
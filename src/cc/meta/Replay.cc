@@ -32,6 +32,7 @@
 #include "NetDispatch.h"
 #include "kfstree.h"
 #include "LayoutManager.h"
+#include "ReadAhead.h"
 #include "common/MdStream.h"
 #include "common/MsgLogger.h"
 #include "common/RequestParser.h"
@@ -40,16 +41,19 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <unistd.h>
 
 #include <cassert>
 #include <cstdlib>
 #include <iostream>
+#include <istream>
 #include <sstream>
 
 namespace KFS
 {
 using std::ostringstream;
+using std::istream;
 using std::atoi;
 
 inline void
@@ -67,9 +71,7 @@ Replay replayer;
 int
 Replay::openlog(const string &p)
 {
-    if (file.is_open()) {
-        file.close();
-    }
+    closelog();
     KFS_LOG_STREAM_INFO <<
         "open log file: " << p.c_str() <<
     KFS_LOG_EOM;
@@ -92,8 +94,8 @@ Replay::openlog(const string &p)
         KFS_LOG_EOM;
         return -EINVAL;
     }
-    file.open(p.c_str());
-    if (file.fail()) {
+    fd = open(p.c_str(), O_RDONLY);
+    if (fd < 0) {
         const int err = errno;
         KFS_LOG_STREAM_FATAL <<
             p << ": " << QCUtils::SysError(err) <<
@@ -105,6 +107,15 @@ Replay::openlog(const string &p)
     return 0;
 }
 
+void
+Replay::closelog()
+{
+    if (0 <= fd) {
+        close(fd);
+        fd = -1;
+    }
+}
+
 static int64_t sLogSegmentTimeUsec = 0;
 
 /*!
@@ -258,6 +269,88 @@ replay_create(DETokenizer& c)
     return (status == 0);
 }
 
+/*!
+ * \brief replay a batch of file creates
+ * format: createbatch/dir/<parentID>/id/<first ID>/numReplicas/<n>
+ * /ctime/<time>/user/<user>/group/<group>/mode/<mode>
+ * {/minTier/<tier>/maxTier/<tier>}/names/<name>{/<name>}
+ */
+static bool
+replay_create_batch(DETokenizer& c)
+{
+    fid_t   parent      = -1;
+    fid_t   first       = -1;
+    int16_t numReplicas = -1;
+    int64_t ctime       = 0;
+    bool ok = pop_parent(parent, c);
+    ok = pop_fid(first, "id", c, ok);
+    ok = pop_short(numReplicas, "numReplicas", c, ok);
+    ok = pop_time(ctime, "ctime", c, ok);
+    int64_t k = kKfsUserNone;
+    ok = pop_num(k, "user", c, ok);
+    const kfsUid_t user = (kfsUid_t)k;
+    k = kKfsGroupNone;
+    ok = pop_num(k, "group", c, ok);
+    const kfsGid_t group = (kfsGid_t)k;
+    k = kKfsModeUndef;
+    ok = pop_num(k, "mode", c, ok);
+    const kfsMode_t mode = (kfsMode_t)k;
+    if (! ok || user == kKfsUserNone || group == kKfsGroupNone ||
+            mode == kKfsModeUndef || c.empty()) {
+        return false;
+    }
+    kfsSTier_t minSTier = kKfsSTierMax;
+    kfsSTier_t maxSTier = kKfsSTierMax;
+    if (c.front() == "minTier") {
+        if (! pop_num(k, "minTier", c, ok)) {
+            return false;
+        }
+        minSTier = (kfsSTier_t)k;
+        if (! pop_num(k, "maxTier", c, ok)) {
+            return false;
+        }
+        maxSTier = (kfsSTier_t)k;
+        if (maxSTier < minSTier ||
+                minSTier < kKfsSTierMin || minSTier > kKfsSTierMax ||
+                maxSTier < kKfsSTierMin || maxSTier > kKfsSTierMax) {
+            return false;
+        }
+    }
+    if (c.size() < 2 || c.front() != "names") {
+        return false;
+    }
+    c.pop_front();
+    fid_t  me = first;
+    string name;
+    while (! c.empty()) {
+        name = c.front();
+        c.pop_front();
+        const bool kExclusiveFlag = false;
+        fid_t      todumpster     = -1;
+        MetaFattr* fa             = 0;
+        const int  status         = metatree.create(parent, name, &me,
+            numReplicas, kExclusiveFlag, KFS_STRIPED_FILE_TYPE_NONE, 0, 0, 0,
+            todumpster, user, group, mode, kKfsUserRoot, kKfsGroupRoot, &fa,
+            ctime);
+        if (status != 0) {
+            KFS_LOG_STREAM_ERROR << "replay create batch:"
+                " name: "   << name <<
+                " id: "     << me <<
+                " status: " << status <<
+            KFS_LOG_EOM;
+            return false;
+        }
+        updateSeed(fileID, me);
+        fa->mtime = fa->ctime = fa->crtime = ctime;
+        if (minSTier < kKfsSTierMax) {
+            fa->minSTier = minSTier;
+            fa->maxSTier = maxSTier;
+        }
+        me++;
+    }
+    return true;
+}
+
 /*!
  * \brief replay mkdir
  * format: mkdir/dir/<parentID>/name/<name>/id/<myID>{/ctime/<time>}
@@ -962,6 +1055,7 @@ get_entry_map()
     e.add_parser("setintbase",              &restore_setintbase);
     e.add_parser("version",                 &replay_version);
     e.add_parser("create",                  &replay_create);
+    e.add_parser("createbatch",             &replay_create_batch);
     e.add_parser("mkdir",                   &replay_mkdir);
     e.add_parser("remove",                  &replay_remove);
     e.add_parser("rmdir",                   &replay_rmdir);
@@ -1003,12 +1097,21 @@ Replay::playlog(bool& lastEntryChecksumFlag)
     mds.Reset();
     mds.SetWriteTrough(true);
 
-    if (! file.is_open()) {
+    if (fd < 0) {
         //!< no log...so, reset the # to 0.
         number = 0;
         return 0;
     }
 
+    // Read the log in a separate thread, while this thread parses and applies
+    // log entries.
+    const bool   useThreadsFlag = 1 < readAheadBlockCount;
+    ReadAheadBuf readAhead(fd, useThreadsFlag ? readAheadBlockCount : 1,
+        (size_t)max(0, readAheadBlockSize), "LogReadAhead");
+    if (useThreadsFlag) {
+        readAhead.Start();
+    }
+    istream file(&readAhead);
     DiskEntry& entrymap = get_entry_map();
     DETokenizer tokenizer(file);
 
@@ -1044,6 +1147,12 @@ Replay::playlog(bool& lastEntryChecksumFlag)
     }
     opcount += tokenizer.getEntryCount();
     oplog.set_seqno(opcount);
+    if (status == 0 && readAhead.GetError() != 0) {
+        KFS_LOG_STREAM_FATAL <<
+            path << ": " << QCUtils::SysError(readAhead.GetError()) <<
+        KFS_LOG_EOM;
+        status = -EIO;
+    }
     if (status == 0 && ! file.eof()) {
         KFS_LOG_STREAM_FATAL <<
             "error " << path <<
@@ -1055,7 +1164,8 @@ Replay::playlog(bool& lastEntryChecksumFlag)
     if (status == 0) {
         lastLogIntBase = tokenizer.getIntBase();
     }
-    file.close();
+    readAhead.Stop();
+    closelog();
     return status;
 }
 
@@ -1077,6 +1187,22 @@ Replay::playLogs(bool includeLastLogFlag)
     return (status == 0 ? playLogs(lastLogNum, includeLastLogFlag) : status);
 }
 
+int
+Replay::playNewLogs()
+{
+    // The last log replayed is lastLogNum, and playLogs() leaves number
+    // pointing to it, which is where getLastLog() starts the search from.
+    const int prev = lastLogNum;
+    int       last = -1;
+    const int status = getLastLog(last);
+    if (status != 0 || last <= prev) {
+        return status;
+    }
+    number     = prev + 1;
+    lastLogNum = last;
+    return playLogs(last, false);
+}
+
 int
 Replay::playLogs(int last, bool includeLastLogFlag)
 {
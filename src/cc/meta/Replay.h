@@ -26,27 +26,27 @@
 #define KFS_REPLAY_H
 
 #include <string>
-#include <fstream>
 
 namespace KFS
 {
 using std::string;
-using std::ifstream;
 
 class Replay
 {
 public:
     Replay()
-        : file(),
+        : fd(-1),
           path(),
           number(-1),
           lastLogNum(-1),
           lastLogIntBase(-1),
           appendToLastLogFlag(false),
-          rollSeeds(0)
+          rollSeeds(0),
+          readAheadBlockCount(4),
+          readAheadBlockSize(1 << 20)
         {}
     ~Replay()
-        {}
+        { closelog(); }
     bool verifyLogSegmentsPresent()
     {
         lastLogNum = -1;
@@ -60,19 +60,32 @@ public:
     //!< starting from log for logno(),
     //!< replay all logs we have in the logdir.
     int playAllLogs() { return playLogs(true); }
+    //!< replay logs completed since the last playLogs() or playNewLogs()
+    //!< invocation; used to follow the logs written by the running meta
+    //!< server.
+    int playNewLogs();
     bool getAppendToLastLogFlag() const { return appendToLastLogFlag; }
     int getLastLogIntBase() const { return lastLogIntBase; }
     inline void setRollSeeds(int64_t roll);
     int64_t getRollSeeds() const { return rollSeeds; }
+    //!< log read ahead, block count less than 2 turns off read ahead thread
+    void setReadAhead(int blockCount, int blockSize)
+    {
+        readAheadBlockCount = blockCount;
+        readAheadBlockSize  = blockSize;
+    }
 private:
-    ifstream file;   //!< the log file being replayed
+    int      fd;     //!< the log file being replayed
     string   path;   //!< path name for log file
     int      number; //!< sequence number for log file
     int      lastLogNum;
     int      lastLogIntBase;
     bool     appendToLastLogFlag;
     int64_t  rollSeeds;
+    int      readAheadBlockCount;
+    int      readAheadBlockSize;
 
+    void closelog();
     int playLogs(int lastlog, bool includeLastLogFlag);
     int playlog(bool& lastEntryChecksumFlag);
     int getLastLog(int& lastlog);
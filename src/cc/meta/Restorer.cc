@@ -25,8 +25,16 @@
  */
 
 #include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <cerrno>
 #include <cstring>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+#include <algorithm>
 #include "Restorer.h"
 #include "util.h"
 #include "Logger.h"
@@ -40,14 +48,27 @@
 #include "NetDispatch.h"
 #include "common/MdStream.h"
 #include "common/MsgLogger.h"
+#include "kfsio/checksum.h"
 #include "qcdio/QCUtils.h"
+#include "qcdio/QCThread.h"
+#include "qcdio/qcstutils.h"
+#include "ReadAhead.h"
+#include "CheckpointRecord.h"
 
 namespace KFS
 {
 using std::cerr;
 using std::string;
+using std::istream;
+using std::ostream;
+using std::streambuf;
+using std::streamsize;
+using std::vector;
+using std::min;
+using std::max;
 
 static int16_t minReplicasPerFile = 0;
+static MetaFattr* sCurrFa = 0; //!< last restored file attribute
 
 static bool
 checkpoint_seq(DETokenizer& c)
@@ -124,6 +145,13 @@ restore_chunkVersionInc(DETokenizer& c)
     return (! c.empty() && c.toNumber() >= 1);
 }
 
+static bool
+restore_dentry_add(fid_t parent, const string& name, fid_t id)
+{
+    MetaDentry* const d = MetaDentry::create(parent, name, id, 0);
+    return (metatree.bulkInsert(d) == 0);
+}
+
 static bool
 restore_dentry(DETokenizer& c)
 {
@@ -136,8 +164,7 @@ restore_dentry(DETokenizer& c)
     if (!ok)
         return false;
 
-    MetaDentry* const d = MetaDentry::create(parent, name, id, 0);
-    return (metatree.insert(d) == 0);
+    return restore_dentry_add(parent, name, id);
 }
 
 static bool
@@ -160,6 +187,26 @@ restore_striped_file_params(DETokenizer& c, MetaFattr& f)
     );
 }
 
+static bool
+restore_fattr_add(MetaFattr* f)
+{
+    if (f->user == kKfsUserNone || f->group == kKfsGroupNone ||
+            f->mode == kKfsModeUndef) {
+        f->destroy();
+        return false;
+    }
+    if (metatree.bulkInsert(f) != 0) {
+        return false;
+    }
+    sCurrFa = f;
+    if (f->type == KFS_DIR) {
+        UpdateNumDirs(1);
+    } else {
+        UpdateNumFiles(1);
+    }
+    return true;
+}
+
 static bool
 restore_fattr(DETokenizer& c)
 {
@@ -252,19 +299,44 @@ restore_fattr(DETokenizer& c)
             gLayoutManager.GetDefaultLoadDirMode() :
             gLayoutManager.GetDefaultLoadFileMode();
     }
-    if (f->user == kKfsUserNone || f->group == kKfsGroupNone ||
-            f->mode == kKfsModeUndef) {
-        f->destroy();
+    return restore_fattr_add(f);
+}
+
+static bool
+restore_chunkinfo_add(fid_t fid, chunkId_t cid, chunkOff_t offset,
+    seq_t chunkVersion)
+{
+    // The chunks of a file are stored next to each other in the tree and
+    // are written out contigously.  Use this property when restoring the
+    // chunkinfo: stash the fileattr for the the file we are currently
+    // working on; as long as this doesn't change, we avoid tree lookups.
+    // The file attribute precedes its chunks in the checkpoint, therefore
+    // with the bulk load, the lookup should only be needed if the checkpoint
+    // is not in key order.
+    MetaFattr* fa = sCurrFa;
+    if (! fa || fa->id() != fid) {
+        metatree.bulkLoadFinish();
+        fa = metatree.getFattr(fid);
+        sCurrFa = fa;
+    }
+    if (! fa) {
         return false;
     }
-    if (metatree.insert(f) != 0) {
+        const chunkOff_t boundary = chunkStartOffset(offset);
+    bool newEntryFlag = false;
+    MetaChunkInfo* const ch = gLayoutManager.AddChunkToServerMapping(
+        fa, boundary, cid, chunkVersion, newEntryFlag);
+    if (! ch || ! newEntryFlag) {
         return false;
     }
-    if (type == KFS_DIR) {
-        UpdateNumDirs(1);
-    } else {
-        UpdateNumFiles(1);
+    if (metatree.bulkInsert(ch) != 0) {
+        return false;
     }
+    if (boundary >= fa->nextChunkOffset()) {
+        fa->nextChunkOffset() = boundary + CHUNKSIZE;
+    }
+    fa->chunkcount()++;
+    UpdateNumChunks(1);
     return true;
 }
 
@@ -284,41 +356,156 @@ restore_chunkinfo(DETokenizer& c)
     if (!ok) {
         return false;
     }
+    return restore_chunkinfo_add(fid, cid, offset, chunkVersion);
+}
 
-    // The chunks of a file are stored next to each other in the tree and
-    // are written out contigously.  Use this property when restoring the
-    // chunkinfo: stash the fileattr for the the file we are currently
-    // working on; as long as this doesn't change, we avoid tree lookups.
-    static MetaFattr* sCurrFa = 0;
-    MetaFattr* fa = sCurrFa;
-    if (! fa || fa->id() != fid) {
-        fa = metatree.getFattr(fid);
-        sCurrFa = fa;
+static bool
+restore_binary_fattr(CheckpointRecord::Reader& rd, fid_t& lastFid)
+{
+    const int        type        = rd.Byte();
+    const fid_t      fid         = lastFid + rd.Signed();
+    rd.Signed(); // chunk count is recomputed as chunks are added.
+    const int64_t    replicas    = rd.Signed();
+    const int64_t    mtime       = rd.Signed();
+    const int64_t    ctime       = mtime + rd.Signed();
+    const int64_t    crtime      = mtime + rd.Signed();
+    const chunkOff_t filesize    = rd.Signed();
+    const int        flags       = rd.Byte();
+    if (! rd.IsOk() || (type != KFS_FILE && type != KFS_DIR) ||
+            replicas < 0 || (int64_t)(int16_t)replicas != replicas) {
+        return false;
     }
-    if (! fa) {
+    int16_t numReplicas = (int16_t)replicas;
+    if (0 != numReplicas && numReplicas < minReplicasPerFile) {
+        numReplicas = minReplicasPerFile;
+    }
+    MetaFattr* const f = MetaFattr::create((FileType)type, fid,
+        mtime, ctime, crtime, 0, numReplicas,
+        kKfsUserNone, kKfsGroupNone, kKfsModeUndef);
+    if (type != KFS_DIR) {
+        f->filesize = (filesize >= 0 || 0 == numReplicas) ?
+            filesize : chunkOff_t(-1);
+    }
+    if ((flags & CheckpointRecord::kFattrStriped) != 0) {
+        const int64_t t  = rd.Signed();
+        const int64_t n  = rd.Signed();
+        const int64_t nr = rd.Signed();
+        const int64_t ss = rd.Signed();
+        if (! rd.IsOk() || type == KFS_DIR ||
+                ! f->SetStriped((int32_t)t, n, nr, ss) || f->filesize < 0) {
+            f->destroy();
+            return false;
+        }
+    }
+    f->user  = (kfsUid_t)rd.Signed();
+    f->group = (kfsGid_t)rd.Signed();
+    f->mode  = (kfsMode_t)rd.Signed();
+    if ((flags & CheckpointRecord::kFattrTiers) != 0) {
+        f->minSTier = (kfsSTier_t)rd.Signed();
+        f->maxSTier = (kfsSTier_t)rd.Signed();
+        if (f->maxSTier < f->minSTier ||
+                f->minSTier < kKfsSTierMin || f->minSTier > kKfsSTierMax ||
+                f->maxSTier < kKfsSTierMin || f->maxSTier > kKfsSTierMax) {
+            f->destroy();
+            return false;
+        }
+    }
+    if ((flags & CheckpointRecord::kFattrNextChunkOffset) != 0) {
+        const int64_t n = rd.Signed();
+        if (n < 0 || n % CHUNKSIZE != 0) {
+            f->destroy();
+            return false;
+        }
+        if (0 == numReplicas) {
+            f->nextChunkOffset() = (chunkOff_t)n;
+        }
+    }
+    if (! rd.IsOk()) {
+        f->destroy();
         return false;
     }
-        const chunkOff_t boundary = chunkStartOffset(offset);
-    bool newEntryFlag = false;
-    MetaChunkInfo* const ch = gLayoutManager.AddChunkToServerMapping(
-        fa, boundary, cid, chunkVersion, newEntryFlag);
-    if (! ch || ! newEntryFlag) {
+    lastFid = fid;
+    return restore_fattr_add(f);
+}
+
+/*!
+ * \brief restore block of binary records, see CheckpointRecord.h
+ * format: bblock/<version>/<length>/<crc32>
+ */
+static bool
+restore_binary_block(DETokenizer& c)
+{
+    c.pop_front();
+    if (c.size() < 3) {
         return false;
     }
-    if (metatree.insert(ch) != 0) {
+    const int64_t version = c.toNumber();
+    c.pop_front();
+    const int64_t len = c.toNumber();
+    c.pop_front();
+    const int64_t crc = c.toNumber();
+    c.pop_front();
+    if (version != CheckpointRecord::kVersion || len <= 0 || crc < 0 ||
+            ! c.empty()) {
         return false;
     }
-    if (boundary >= fa->nextChunkOffset()) {
-        fa->nextChunkOffset() = boundary + CHUNKSIZE;
+    const char* const blk = c.readRaw((size_t)len);
+    if (! blk) {
+        return false;
+    }
+    if (ComputeBlockChecksum(blk, (size_t)len) != (uint32_t)crc) {
+        KFS_LOG_STREAM_ERROR <<
+            "binary record block checksum mismatch" <<
+            " length: " << len <<
+        KFS_LOG_EOM;
+        return false;
+    }
+    CheckpointRecord::Reader rd(blk, blk + len);
+    fid_t     lastFid     = 0;
+    chunkId_t lastChunkId = 0;
+    string    name;
+    while (! rd.IsEmpty()) {
+        bool ok;
+        switch (rd.Byte()) {
+            case CheckpointRecord::kTypeFattr:
+                ok = restore_binary_fattr(rd, lastFid);
+                break;
+            case CheckpointRecord::kTypeChunkInfo: {
+                const fid_t      fid     = lastFid + rd.Signed();
+                const chunkId_t  cid     = lastChunkId + rd.Signed();
+                const chunkOff_t offset  = rd.Signed();
+                const seq_t      version = rd.Signed();
+                ok = rd.IsOk() &&
+                    restore_chunkinfo_add(fid, cid, offset, version);
+                lastFid     = fid;
+                lastChunkId = cid;
+                break;
+            }
+            case CheckpointRecord::kTypeDentry: {
+                const fid_t parent = lastFid + rd.Signed();
+                const fid_t id     = rd.Signed();
+                ok = rd.String(name) && ! name.empty() &&
+                    restore_dentry_add(parent, name, id);
+                lastFid = parent;
+                break;
+            }
+            default:
+                ok = false;
+                break;
+        }
+        if (! ok) {
+            return false;
+        }
     }
-    fa->chunkcount()++;
-    UpdateNumChunks(1);
     return true;
 }
 
 static bool
 restore_makestable(DETokenizer& c)
 {
+    // Pending chunk operations follow the meta tree entries, and require
+    // meta tree lookups.
+    metatree.bulkLoadFinish();
     chunkId_t  chunkId;
     seq_t      chunkVersion;
     chunkOff_t chunkSize;
@@ -346,6 +533,7 @@ restore_makestable(DETokenizer& c)
 static bool
 restore_beginchunkversionchange(DETokenizer& c)
 {
+    metatree.bulkLoadFinish();
     fid_t     fid;
     chunkId_t chunkId;
     seq_t     chunkVersion;
@@ -439,6 +627,7 @@ restore_filesystem_info(DETokenizer& c)
 static bool
 restore_objstore_delete(DETokenizer& c)
 {
+    metatree.bulkLoadFinish();
     const bool osdFlag = c.front() == DETokenizer::Token("osd", 3);
     c.pop_front();
     if (c.empty()) {
@@ -479,6 +668,7 @@ get_entry_map()
     e.add_parser("dentry",                  &restore_dentry);
     e.add_parser("fattr",                   &restore_fattr);
     e.add_parser("chunkinfo",               &restore_chunkinfo);
+    e.add_parser("bblock",                  &restore_binary_block);
     e.add_parser("mkstable",                &restore_makestable);
     e.add_parser("beginchunkversionchange", &restore_beginchunkversionchange);
     e.add_parser("checksum",                &restore_checksum);
@@ -500,6 +690,211 @@ lookupFattr(fid_t dir, const string& name)
     return 0;
 }
 
+/*!
+ * \brief checkpoint checksum: output stream buffer that passes the data to a
+ * separate thread that computes md5.
+ */
+class RestoreDigest : public QCRunnable, public streambuf
+{
+public:
+    RestoreDigest(int blockCount, size_t blockSize)
+        : QCRunnable(),
+          streambuf(),
+          mMds(0, false, string(), 0),
+          mRing(blockCount, blockSize),
+          mThread()
+        {}
+    ~RestoreDigest()
+    {
+        if (mThread.IsStarted()) {
+            mRing.Close();
+            mThread.Join();
+        }
+    }
+    bool Start()
+    {
+        const int kStackSize = 64 << 10;
+        const int err = mThread.TryToStart(
+            this, kStackSize, "CPDigest");
+        if (err) {
+            KFS_LOG_STREAM_ERROR << QCUtils::SysError(
+                err, "failed to start checkpoint checksum thread") <<
+            KFS_LOG_EOM;
+        }
+        return (err == 0);
+    }
+    //!< flush pending data, stop the thread, and return md5
+    string GetMd()
+    {
+        if (mThread.IsStarted()) {
+            Submit();
+            mRing.Close();
+            mThread.Join();
+        }
+        return mMds.GetMd();
+    }
+    virtual void Run()
+    {
+        size_t len = 0;
+        char*  buf;
+        while ((buf = mRing.GetFilled(len))) {
+            mMds.write(buf, len);
+            mRing.Release();
+        }
+    }
+protected:
+    virtual int_type overflow(int_type c)
+    {
+        if (! mThread.IsStarted()) {
+            if (! traits_type::eq_int_type(c, traits_type::eof())) {
+                mMds.put(traits_type::to_char_type(c));
+            }
+            return traits_type::not_eof(c);
+        }
+        Submit();
+        char* const buf = mRing.GetFree();
+        if (! buf) {
+            return traits_type::eof();
+        }
+        setp(buf, buf + mRing.GetBlockSize());
+        if (! traits_type::eq_int_type(c, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+    virtual streamsize xsputn(const char* s, streamsize n)
+    {
+        if (! mThread.IsStarted()) {
+            mMds.write(s, n);
+            return n;
+        }
+        streamsize rem = n;
+        while (rem > 0) {
+            if (epptr() <= pptr() &&
+                    traits_type::eq_int_type(
+                        overflow(traits_type::eof()), traits_type::eof())) {
+                break;
+            }
+            const streamsize cnt = min(rem, (streamsize)(epptr() - pptr()));
+            memcpy(pptr(), s, cnt);
+            pbump((int)cnt);
+            s   += cnt;
+            rem -= cnt;
+        }
+        return (n - rem);
+    }
+private:
+    MdStream      mMds;
+    ReadAheadRing mRing;
+    QCThread      mThread;
+
+    void Submit()
+    {
+        if (pbase() && pbase() < pptr()) {
+            mRing.PutFilled(pptr() - pbase());
+        }
+        setp(0, 0);
+    }
+private:
+    RestoreDigest(const RestoreDigest&);
+    RestoreDigest& operator=(const RestoreDigest&);
+};
+
+/*!
+ * \brief zero copy checkpoint input stream buffer: the checkpoint file is
+ * memory mapped read only, and the parser reads directly from the mapping.
+ * The mapping is exposed in windows; the kernel is asked to read ahead the
+ * next window, and to drop the pages of the window already parsed, in order
+ * to keep the resident set size bounded by the window size.
+ */
+class RestoreMmapBuf : public streambuf
+{
+public:
+    RestoreMmapBuf(size_t windowSize)
+        : streambuf(),
+          mPtr(0),
+          mSize(0),
+          mPos(0),
+          mWindowSize(max(size_t(1) << 20, windowSize))
+        {}
+    ~RestoreMmapBuf()
+        { RestoreMmapBuf::Unmap(); }
+    int Map(int fd)
+    {
+        Unmap();
+        struct stat st;
+        if (fstat(fd, &st)) {
+            return (errno > 0 ? errno : EIO);
+        }
+        if (st.st_size <= 0 || (off_t)(size_t)st.st_size != st.st_size) {
+            return EINVAL;
+        }
+        void* const ptr = mmap(0, (size_t)st.st_size, PROT_READ, MAP_PRIVATE,
+            fd, 0);
+        if (ptr == MAP_FAILED) {
+            return (errno > 0 ? errno : EIO);
+        }
+        mPtr  = static_cast<char*>(ptr);
+        mSize = (size_t)st.st_size;
+        mPos  = 0;
+        madvise(mPtr, mSize, MADV_SEQUENTIAL);
+        Advise(0, MADV_WILLNEED);
+        return 0;
+    }
+    void Unmap()
+    {
+        if (! mPtr) {
+            return;
+        }
+        setg(0, 0, 0);
+        munmap(mPtr, mSize);
+        mPtr  = 0;
+        mSize = 0;
+        mPos  = 0;
+    }
+protected:
+    virtual int_type underflow()
+    {
+        if (gptr() < egptr()) {
+            return traits_type::to_int_type(*gptr());
+        }
+        if (mSize <= mPos) {
+            return traits_type::eof();
+        }
+        // The tokenizer copies entries into its own buffer, the window
+        // consumed is no longer referenced.
+        const size_t pos = mPos;
+        if (0 < pos) {
+            Advise(pos - mWindowSize, MADV_DONTNEED);
+        }
+        const size_t end = min(mSize, pos + mWindowSize);
+        mPos = end;
+        Advise(end, MADV_WILLNEED);
+        setg(mPtr + pos, mPtr + pos, mPtr + end);
+        return traits_type::to_int_type(*gptr());
+    }
+private:
+    char*        mPtr;
+    size_t       mSize;
+    size_t       mPos;
+    const size_t mWindowSize;
+
+    void Advise(size_t pos, int advice)
+    {
+        if (mSize <= pos) {
+            return;
+        }
+        // madvise requires page aligned address.
+        static const size_t pageSize = max(long(1), sysconf(_SC_PAGESIZE));
+        const size_t start = pos - pos % pageSize;
+        madvise(mPtr + start, min(mSize - start, mWindowSize), advice);
+    }
+private:
+    RestoreMmapBuf(const RestoreMmapBuf&);
+    RestoreMmapBuf& operator=(const RestoreMmapBuf&);
+};
+
 /*!
  * \brief rebuild metadata tree from CP file cpname
  * \param[in] cpname    the CP file
@@ -518,21 +913,55 @@ Restorer::rebuild(const string cpname, int16_t minReplicas)
         return false;
     }
     minReplicasPerFile = minReplicas;
-    file.open(cpname.c_str(), ofstream::binary | ofstream::in);
-    if (file.fail()) {
+    sCurrFa = 0;
+    const int fd = open(cpname.c_str(), O_RDONLY);
+    if (fd < 0) {
         const int err = errno;
         KFS_LOG_STREAM_FATAL <<
             cpname << ": " << QCUtils::SysError(err) <<
         KFS_LOG_EOM;
         return false;
     }
+    const bool   useThreadsFlag = 1 < readAheadBlockCount;
+    const int    blockCount     = useThreadsFlag ? readAheadBlockCount : 1;
+    const size_t blockSize      = (size_t)max(0, readAheadBlockSize);
+    RestoreMmapBuf mmapBuf((size_t)blockCount * blockSize);
+    bool           mmapFlag = useMmapFlag;
+    if (mmapFlag) {
+        const int err = mmapBuf.Map(fd);
+        if (err) {
+            KFS_LOG_STREAM_ERROR <<
+                cpname << ": " << QCUtils::SysError(err, "mmap") <<
+                " using read" <<
+            KFS_LOG_EOM;
+            mmapFlag = false;
+        }
+    }
+    ReadAheadBuf  readAhead(fd, mmapFlag ? 1 : blockCount,
+        mmapFlag ? size_t(0) : blockSize, "CPReadAhead");
+    RestoreDigest digest(blockCount, blockSize);
+    if (useThreadsFlag) {
+        // Overlap checkpoint read and checksum computation with parsing. The
+        // parsing and meta tree insertion remain in the calling thread, as
+        // the meta node allocators and layout manager are not thread safe.
+        if (! mmapFlag) {
+            readAhead.Start();
+        }
+        digest.Start();
+    }
+    istream file(mmapFlag ?
+        static_cast<streambuf*>(&mmapBuf) :
+        static_cast<streambuf*>(&readAhead));
+    ostream mds(&digest);
+    // The checkpoint is written in the meta tree key order, build the tree
+    // bottom up.
+    metatree.bulkLoadStart();
 
     DiskEntry& entrymap = get_entry_map();
         DETokenizer tokenizer(file);
 
     restoreChecksum.clear();
     lastLineChecksumFlag = false;
-    MdStream mds(0, false, string(), 0);
     bool is_ok = true;
     while (tokenizer.next(&mds)) {
         if (! entrymap.parse(tokenizer)) {
@@ -553,6 +982,12 @@ Restorer::rebuild(const string cpname, int16_t minReplicas)
             break;
         }
     }
+    if (is_ok && readAhead.GetError() != 0) {
+        KFS_LOG_STREAM_FATAL <<
+            cpname << ": " << QCUtils::SysError(readAhead.GetError()) <<
+        KFS_LOG_EOM;
+        is_ok = false;
+    }
     if (is_ok && ! file.eof()) {
         KFS_LOG_STREAM_FATAL <<
             "error " << cpname << ":" << tokenizer.getEntryCount() <<
@@ -560,9 +995,13 @@ Restorer::rebuild(const string cpname, int16_t minReplicas)
         KFS_LOG_EOM;
         is_ok = false;
     }
-    file.close();
+    readAhead.Stop();
+    mmapBuf.Unmap();
+    close(fd);
+    metatree.bulkLoadFinish();
     if (is_ok && lastLineChecksumFlag) {
-        const string md = mds.GetMd();
+        mds.flush();
+        const string md = digest.GetMd();
         if (restoreChecksum != md) {
             KFS_LOG_STREAM_FATAL <<
                 cpname <<
@@ -25,13 +25,11 @@
 #if !defined(KFS_RESTORE_H)
 #define KFS_RESTORE_H
 
-#include <fstream>
 #include <string>
 #include "util.h"
 
 namespace KFS
 {
-using std::ifstream;
 using std::string;
 
 /*!
@@ -41,7 +39,9 @@ class Restorer
 {
 public:
     Restorer()
-        : file()
+        : readAheadBlockCount(4),
+          readAheadBlockSize(4 << 20),
+          useMmapFlag(false)
         {}
     ~Restorer()
         {}
@@ -51,8 +51,27 @@ public:
      * the filesystem wide degree of replication in a simple manner.
      */
     bool rebuild(string cpname, int16_t minNumReplicasPerFile = 1);
+    /*
+     * the checkpoint is read ahead, and its checksum is computed, by two
+     * helper threads while the calling thread parses it. block count less
+     * than 2 turns off the helper threads.
+     */
+    void setReadAhead(int blockCount, int blockSize)
+    {
+        readAheadBlockCount = blockCount;
+        readAheadBlockSize  = blockSize;
+    }
+    /*
+     * memory map the checkpoint, and parse it directly from the mapping,
+     * instead of copying it into the read ahead buffers. the read ahead
+     * block count times block size is used as the mapping window size.
+     */
+    void setUseMmap(bool flag)
+        { useMmapFlag = flag; }
 private:
-    ifstream file;          //!< the CP file
+    int  readAheadBlockCount; //!< # of CP read ahead buffers
+    int  readAheadBlockSize;  //!< CP read ahead buffer size
+    bool useMmapFlag;         //!< parse CP from memory mapping
 private:
     // No copy.
     Restorer(const Restorer&);
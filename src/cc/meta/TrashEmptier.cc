@@ -0,0 +1,392 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/14
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \file TrashEmptier.cc
+// \brief Meta server side trash emptier.
+//
+//----------------------------------------------------------------------------
+
+#include "TrashEmptier.h"
+#include "MetaRequest.h"
+#include "kfstree.h"
+#include "kfsio/Globals.h"
+#include "common/MsgLogger.h"
+#include "common/Properties.h"
+
+#include <string.h>
+#include <time.h>
+
+#include <vector>
+#include <sstream>
+#include <algorithm>
+
+namespace KFS
+{
+using std::vector;
+using std::ostringstream;
+using std::max;
+using libkfsio::globalNetManager;
+
+// Must match the qfs tool trash checkpoint name format.
+static const char* const kTrashCheckpointFormatPtr = "%y%m%d%H%M";
+static const size_t      kTrashCheckpointNameLen   = 10;
+static const int         kIdleTimerIntervalMs      = 1000;
+static const int         kMaxRenameRetries         = 8;
+
+TrashEmptier gTrashEmptier;
+
+TrashEmptier::TrashEmptier()
+    : ITimeout(),
+      KfsCallbackObj(),
+      intervalSec(0),
+      maxEntriesPerStep(256),
+      homesPrefix("/user"),
+      trash(".Trash"),
+      current("Current"),
+      registeredFlag(false),
+      scanFlag(false),
+      opInFlightFlag(false),
+      cycleStartTime(0),
+      nextCycleTime(0),
+      homeCursor(),
+      tasks(),
+      checkpointsCount(0),
+      expungedCount(0),
+      filesRemoved(0),
+      dirsRemoved(0)
+{
+    SET_HANDLER(this, &TrashEmptier::opDone);
+    SetTimeoutInterval(kIdleTimerIntervalMs);
+}
+
+TrashEmptier::~TrashEmptier()
+{
+    if (registeredFlag) {
+        globalNetManager().UnRegisterTimeoutHandler(this);
+    }
+}
+
+void
+TrashEmptier::SetParameters(const Properties& props)
+{
+    intervalSec = props.getValue(
+        "metaServer.trash.emptierIntervalSec", intervalSec);
+    maxEntriesPerStep = max(16, props.getValue(
+        "metaServer.trash.maxEntriesPerStep", maxEntriesPerStep));
+    const string prevHomesPrefix = homesPrefix;
+    homesPrefix = props.getValue("metaServer.trash.homesPrefix", homesPrefix);
+    while (1 < homesPrefix.length() && *homesPrefix.rbegin() == '/') {
+        homesPrefix.erase(homesPrefix.length() - 1);
+    }
+    trash   = props.getValue("metaServer.trash.trash",   trash);
+    current = props.getValue("metaServer.trash.current", current);
+    if (homesPrefix.empty() || homesPrefix[0] != '/' ||
+            trash.empty() || trash.find('/') != string::npos ||
+            trash == "." || trash == ".." ||
+            current.empty() || current.find('/') != string::npos ||
+            current == "." || current == "..") {
+        KFS_LOG_STREAM_ERROR <<
+            "invalid trash parameters:"
+            " homes: "   << homesPrefix <<
+            " trash: "   << trash <<
+            " current: " << current <<
+            " trash emptier disabled" <<
+        KFS_LOG_EOM;
+        intervalSec = 0;
+    }
+    if (prevHomesPrefix != homesPrefix) {
+        homeCursor.clear();
+        scanFlag = false;
+    }
+    if (intervalSec <= 0) {
+        if (! opInFlightFlag) {
+            tasks.clear();
+        }
+        scanFlag = false;
+        return;
+    }
+    if (! registeredFlag) {
+        registeredFlag = true;
+        globalNetManager().RegisterTimeoutHandler(this);
+    }
+}
+
+void
+TrashEmptier::Timeout()
+{
+    if (intervalSec <= 0 || opInFlightFlag) {
+        return;
+    }
+    if (! tasks.empty()) {
+        startTask();
+        return;
+    }
+    const time_t now = globalNetManager().Now();
+    if (! scanFlag) {
+        if (now < nextCycleTime) {
+            updateTimer();
+            return;
+        }
+        scanFlag       = true;
+        cycleStartTime = now;
+        homeCursor.clear();
+        KFS_LOG_STREAM_INFO <<
+            "trash emptier: start: " << homesPrefix <<
+        KFS_LOG_EOM;
+    }
+    scan();
+    if (! scanFlag) {
+        nextCycleTime = cycleStartTime + intervalSec;
+        KFS_LOG_STREAM_INFO <<
+            "trash emptier: scan done:"
+            " pending: "     << tasks.size() <<
+            " checkpoints: " << checkpointsCount <<
+            " expunged: "    << expungedCount <<
+            " files: "       << filesRemoved <<
+            " dirs: "        << dirsRemoved <<
+        KFS_LOG_EOM;
+    }
+    if (! tasks.empty()) {
+        startTask();
+    }
+    updateTimer();
+}
+
+void
+TrashEmptier::updateTimer()
+{
+    // Run the next step on every net manager loop iteration while the scan
+    // or removal is in progress, each step is bounded.
+    SetTimeoutInterval((scanFlag || ! tasks.empty()) ?
+        0 : kIdleTimerIntervalMs);
+}
+
+void
+TrashEmptier::scan()
+{
+    MetaFattr* fa = 0;
+    if (metatree.lookupPath(ROOTFID, homesPrefix,
+            kKfsUserRoot, kKfsGroupRoot, fa) != 0 ||
+            ! fa || fa->type != KFS_DIR) {
+        scanFlag = false;
+        return;
+    }
+    vector<MetaDentry*> entries;
+    bool                more   = false;
+    const int           status = homeCursor.empty() ?
+        metatree.readdir(fa->id(), entries, maxEntriesPerStep, &more) :
+        metatree.readdir(fa->id(), homeCursor, entries,
+            maxEntriesPerStep, more);
+    if (status != 0) {
+        KFS_LOG_STREAM_ERROR <<
+            "trash emptier: " << homesPrefix <<
+            " cursor: "       << homeCursor <<
+            " readdir: "      << status <<
+        KFS_LOG_EOM;
+        scanFlag = false;
+        return;
+    }
+    string path;
+    for (vector<MetaDentry*>::const_iterator it = entries.begin();
+            it != entries.end();
+            ++it) {
+        const string& name = (*it)->getName();
+        if (name == "." || name == "..") {
+            continue;
+        }
+        const MetaFattr* const hfa = metatree.getFattr(*it);
+        MetaFattr*             tfa = 0;
+        if (! hfa || hfa->type != KFS_DIR ||
+                metatree.lookup(hfa->id(), trash,
+                    kKfsUserRoot, kKfsGroupRoot, tfa) != 0 ||
+                ! tfa || tfa->type != KFS_DIR) {
+            continue;
+        }
+        path = homesPrefix;
+        if (*path.rbegin() != '/') {
+            path += "/";
+        }
+        path += name;
+        path += "/";
+        path += trash;
+        scanTrash(tfa->id(), path);
+    }
+    if (more && ! entries.empty()) {
+        homeCursor = entries.back()->getName();
+    } else {
+        homeCursor.clear();
+        scanFlag = false;
+    }
+}
+
+void
+TrashEmptier::scanTrash(fid_t dir, const string& path)
+{
+    vector<MetaDentry*> entries;
+    bool                more = false;
+    if (metatree.readdir(dir, entries, maxEntriesPerStep, &more) != 0) {
+        return;
+    }
+    const time_t expTime     = cycleStartTime - intervalSec;
+    bool         currentFlag = false;
+    for (vector<MetaDentry*>::const_iterator it = entries.begin();
+            it != entries.end();
+            ++it) {
+        const string&          name = (*it)->getName();
+        const MetaFattr* const efa  = metatree.getFattr(*it);
+        if (! efa || efa->type != KFS_DIR) {
+            continue;
+        }
+        if (name == current) {
+            currentFlag = true;
+        } else if (isExpired(name, expTime)) {
+            tasks.push_back(Task(dir, name, path + "/" + name));
+        }
+    }
+    if (! currentFlag && more) {
+        MetaFattr* cfa = 0;
+        currentFlag = metatree.lookup(dir, current,
+            kKfsUserRoot, kKfsGroupRoot, cfa) == 0 &&
+            cfa && cfa->type == KFS_DIR;
+    }
+    if (currentFlag) {
+        // Checkpoint after the expired checkpoints removal, like the qfs
+        // tool does.
+        tasks.push_back(Task(dir, current, path + "/" + current,
+            path + "/" + checkpointName(cycleStartTime)));
+    }
+}
+
+bool
+TrashEmptier::isExpired(const string& name, time_t expTime) const
+{
+    if (name.length() != kTrashCheckpointNameLen &&
+            (name.length() < kTrashCheckpointNameLen ||
+            name[kTrashCheckpointNameLen] != '.')) {
+        return false;
+    }
+    struct tm         localTime;
+    const char* const namePtr = name.c_str();
+    memset(&localTime, 0, sizeof(localTime));
+    const char* const ptr     = strptime(
+        namePtr, kTrashCheckpointFormatPtr, &localTime);
+    if (! ptr || ptr != namePtr + kTrashCheckpointNameLen) {
+        return false;
+    }
+    localTime.tm_isdst = -1;
+    const time_t t = mktime(&localTime);
+    return (t != time_t(-1) && t <= expTime);
+}
+
+string
+TrashEmptier::checkpointName(time_t t) const
+{
+    char      buf[64];
+    struct tm localTime;
+    if (! localtime_r(&t, &localTime) ||
+            strftime(buf, sizeof(buf), kTrashCheckpointFormatPtr,
+                &localTime) <= 0) {
+        return string("0000000000");
+    }
+    return string(buf);
+}
+
+void
+TrashEmptier::startTask()
+{
+    if (tasks.empty() || opInFlightFlag) {
+        return;
+    }
+    const Task&  task = tasks.front();
+    MetaRequest* req;
+    if (task.newPath.empty()) {
+        MetaRmdirs* const op = new MetaRmdirs();
+        op->dir      = task.dir;
+        op->name     = task.name;
+        op->pathname = task.path;
+        req = op;
+    } else {
+        MetaRename* const op = new MetaRename();
+        op->dir       = task.dir;
+        op->oldname   = task.name;
+        op->oldpath   = task.path;
+        op->newname   = task.newPath;
+        op->overwrite = false;
+        if (0 < task.retry) {
+            ostringstream os;
+            os << "." << task.retry;
+            op->newname += os.str();
+        }
+        req = op;
+    }
+    req->euser     = kKfsUserRoot;
+    req->egroup    = kKfsGroupRoot;
+    req->clnt      = this;
+    opInFlightFlag = true;
+    // The completion might be invoked before submit_request() returns.
+    submit_request(req);
+}
+
+int
+TrashEmptier::opDone(int code, void* data)
+{
+    MetaRequest* const req = reinterpret_cast<MetaRequest*>(data);
+    if (code != EVENT_CMD_DONE || ! req || ! opInFlightFlag ||
+            tasks.empty() ||
+            (req->op != META_RMDIRS && req->op != META_RENAME)) {
+        panic("TrashEmptier::opDone invalid invocation");
+        return 1;
+    }
+    opInFlightFlag = false;
+    Task& task = tasks.front();
+    if (req->op == META_RENAME && req->status == -EEXIST &&
+            ++task.retry < kMaxRenameRetries) {
+        // Checkpoint already exists, retry with the next name suffix.
+        delete req;
+        globalNetManager().Wakeup();
+        return 0;
+    }
+    if (req->op == META_RMDIRS) {
+        const MetaRmdirs& op = *static_cast<const MetaRmdirs*>(req);
+        filesRemoved += op.filesRemoved;
+        dirsRemoved  += op.dirsRemoved;
+        if (req->status == 0) {
+            expungedCount++;
+        }
+    } else if (req->status == 0) {
+        checkpointsCount++;
+    }
+    KFS_LOG_STREAM(req->status == 0 ?
+            MsgLogger::kLogLevelDEBUG : MsgLogger::kLogLevelERROR) <<
+        "trash emptier: " << req->Show() <<
+        " status: "       << req->status <<
+        " "               << req->statusMsg <<
+    KFS_LOG_EOM;
+    delete req;
+    tasks.pop_front();
+    if (! tasks.empty() || scanFlag) {
+        globalNetManager().Wakeup();
+    }
+    updateTimer();
+    return 0;
+}
+
+} // namespace KFS
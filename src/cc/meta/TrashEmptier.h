@@ -0,0 +1,112 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Created 2026/10/14
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Meta server side trash emptier. Periodically checkpoints the users
+// "current" trash directories, and removes expired trash checkpoints, with
+// the same trash layout and policy as the qfs tool trash emptier.
+//
+//----------------------------------------------------------------------------
+
+#ifndef META_TRASHEMPTIER_H
+#define META_TRASHEMPTIER_H
+
+#include "kfstypes.h"
+#include "kfsio/ITimeout.h"
+#include "kfsio/KfsCallbackObj.h"
+
+#include <time.h>
+
+#include <string>
+#include <deque>
+
+namespace KFS
+{
+using std::string;
+using std::deque;
+
+class Properties;
+
+// The home directories are listed incrementally, with bounded number of
+// entries per step. Each trash checkpoint is removed with the incremental
+// recursive directory removal (RMDIRS), one directory at a time, and the
+// removed files chunks are deleted by the regular chunk deletion pipeline,
+// therefore the emptier does not compete with the other requests for the
+// meta server and chunk servers resources.
+class TrashEmptier : public ITimeout, public KfsCallbackObj
+{
+public:
+    TrashEmptier();
+    virtual ~TrashEmptier();
+    virtual void Timeout();
+    void SetParameters(const Properties& props);
+private:
+    struct Task
+    {
+        Task(fid_t d = -1, const string& n = string(),
+                const string& p = string(), const string& np = string())
+            : dir(d),
+              name(n),
+              path(p),
+              newPath(np),
+              retry(0)
+            {}
+        fid_t  dir;
+        string name;
+        string path;
+        string newPath; // Empty for removal, checkpoint name for rename.
+        int    retry;
+    };
+    typedef deque<Task> Tasks;
+
+    int     intervalSec;
+    int     maxEntriesPerStep;
+    string  homesPrefix;
+    string  trash;
+    string  current;
+    bool    registeredFlag;
+    bool    scanFlag;
+    bool    opInFlightFlag;
+    time_t  cycleStartTime;
+    time_t  nextCycleTime;
+    string  homeCursor;
+    Tasks   tasks;
+    int64_t checkpointsCount;
+    int64_t expungedCount;
+    int64_t filesRemoved;
+    int64_t dirsRemoved;
+
+    int opDone(int code, void* data);
+    void scan();
+    void scanTrash(fid_t dir, const string& path);
+    void startTask();
+    void updateTimer();
+    bool isExpired(const string& name, time_t expTime) const;
+    string checkpointName(time_t t) const;
+private:
+    TrashEmptier(const TrashEmptier&);
+    TrashEmptier& operator=(const TrashEmptier&);
+};
+
+extern TrashEmptier gTrashEmptier;
+
+}
+
+#endif // META_TRASHEMPTIER_H
@@ -95,6 +95,9 @@ public:
           mUserExcludes(),
           mGroupExcludes(),
           mParametersReadCount(0),
+          mPublishedParametersReadCount(0),
+          mPublishedDigest(0),
+          mPublishedDigestValidFlag(false),
           mUidNameMapPtr(new UidNameMap()),
           mUidNamePtr(mUidNameMapPtr),
           mNameUidMapPtr(new NameUidMap()),
@@ -324,6 +327,7 @@ private:
 
         const uint64_t theParametersReadCount = mParametersReadCount;
         bool           theOverflowFlag        = false;
+        uint64_t       theDigest              = 0;
         const int      theError               = UpdateSelf(
             theUserExcludes,
             theGroupExcludes,
@@ -335,9 +339,19 @@ private:
             theMetaStatsGroupNames,
             theDelegationGroupNames,
             theDelegationUserNames,
-            theOverflowFlag
+            theOverflowFlag,
+            theDigest
         );
-        if (theError == 0) {
+        // Do not publish new tables if neither the user and group databases
+        // nor the parameters have changed since the last update, in order to
+        // keep the current tables, and the client threads caches, intact.
+        if (theError == 0 && (! mPublishedDigestValidFlag ||
+                mPublishedDigest != theDigest ||
+                mPublishedParametersReadCount != theParametersReadCount ||
+                mOverflowFlag != theOverflowFlag)) {
+            mPublishedDigest               = theDigest;
+            mPublishedParametersReadCount  = theParametersReadCount;
+            mPublishedDigestValidFlag      = true;
             mPendingUidNameMap.Swap(mTmpUidNameMap);
             mPendingGidNameMap.Swap(mTmpGidNameMap);
             mPendingNameUidMap.Swap(mTmpNameUidMap);
@@ -408,6 +422,24 @@ private:
         mDelegationRenewAndCancelUsersPtr.reset(
             theDelegationRenewAndCancelUsersPtr);
     }
+    static uint64_t Digest(
+        uint64_t      inDigest,
+        const string& inName,
+        uint64_t      inId)
+    {
+        // FNV-1a like mix of the name and id, used only to detect changes.
+        const uint64_t kPrime  = 1099511628211ULL;
+        uint64_t       theHash = inDigest ^ 14695981039346656037ULL;
+        for (string::const_iterator theIt = inName.begin();
+                theIt != inName.end();
+                ++theIt) {
+            theHash = (theHash ^ (unsigned char)*theIt) * kPrime;
+        }
+        for (int i = 0; i < 8; i++) {
+            theHash = (theHash ^ ((inId >> (i * 8)) & 0xFF)) * kPrime;
+        }
+        return theHash;
+    }
     static bool StartsWith(
         const string& inString,
         const string& inPrefix)
@@ -449,7 +481,8 @@ private:
         const MetaStatsGroupNames&  inMetaStatsGroupNames,
         const DelegationUserNames&  inDelegationUserNames,
         const DelegationGroupNames& inDelegationGroupNames,
-        bool&                       outOverflowFlag)
+        bool&                       outOverflowFlag,
+        uint64_t&                   outDigest)
     {
         kfsUid_t const theMinUserId       = mMinUserId;
         kfsUid_t const theMaxUserId       = mMaxUserId;
@@ -491,6 +524,12 @@ private:
             }
             const string   theName = theEntryPtr->gr_name;
             kfsGid_t const theGid  = (kfsGid_t)theEntryPtr->gr_gid;
+            outDigest = Digest(outDigest, theName, theGid);
+            for (char** thePtr = theEntryPtr->gr_mem;
+                    thePtr && *thePtr;
+                    ++thePtr) {
+                outDigest = Digest(outDigest, *thePtr, theGid);
+            }
             if (! IsValidName(theName)) {
                 KFS_LOG_STREAM_ERROR <<
                     "ignoring malformed group"
@@ -597,6 +636,8 @@ private:
             }
             const string   theName = theEntryPtr->pw_name;
             kfsUid_t const theUid  = (kfsUid_t)theEntryPtr->pw_uid;
+            outDigest = Digest(Digest(outDigest, theName, theUid),
+                string(), (kfsGid_t)theEntryPtr->pw_gid);
             if (! IsValidName(theName)) {
                 KFS_LOG_STREAM_ERROR <<
                     "ignoring malformed user"
@@ -850,6 +891,9 @@ private:
     UserExcludes                     mUserExcludes;
     GroupExcludes                    mGroupExcludes;
     uint64_t                         mParametersReadCount;
+    uint64_t                         mPublishedParametersReadCount;
+    uint64_t                         mPublishedDigest;
+    bool                             mPublishedDigestValidFlag;
     UidNameMap*                      mUidNameMapPtr;
     UidNamePtr                       mUidNamePtr;
     GidNameMap                       mGidNameMap;
@@ -70,10 +70,11 @@ FileListerMain(int argc, char **argv)
     // the various tools that load the checkpoint file.
     string     lockfn;
     bool       allowEmptyCheckpointFlag = false;
+    bool       memoryUsageFlag          = false;
     int        status = 0;
     set<fid_t> ids;
 
-    while ((optchar = getopt(argc, argv, "hl:c:f:L:i:e:")) != -1) {
+    while ((optchar = getopt(argc, argv, "hl:c:f:L:i:e:m")) != -1) {
         switch (optchar) {
             case 'L':
                 lockfn = optarg;
@@ -93,6 +94,9 @@ FileListerMain(int argc, char **argv)
             case 'e':
                 allowEmptyCheckpointFlag = atoi(optarg) != 0;
                 break;
+            case 'm':
+                memoryUsageFlag = true;
+                break;
             case 'i': {
                     istringstream is(optarg);
                     fid_t id;
@@ -115,6 +119,7 @@ FileListerMain(int argc, char **argv)
             "[-f <output fn>]\n"
             "[-i fid]\n"
             "[-e {0|1} allow empty checkpoint]\n"
+            "[-m report meta data memory usage to stderr]\n"
         ;
         return status;
     }
@@ -126,6 +131,18 @@ FileListerMain(int argc, char **argv)
     checkpointer_setup_paths(cpdir);
     if ((status = RestoreCheckpoint(lockfn, allowEmptyCheckpointFlag)) == 0 &&
             (status = replayer.playLogs()) == 0) {
+        if (memoryUsageFlag) {
+            cerr <<
+                "i-nodes: " <<
+                MetaNode::getPoolAllocator<MetaFattr>().GetInUseCount() <<
+                " dentries: " <<
+                MetaNode::getPoolAllocator<MetaDentry>().GetInUseCount() <<
+                " internal nodes: " <<
+                MetaNode::getPoolAllocator<Node>().GetInUseCount() <<
+                " name bytes: " << MetaDentry::getNameBytes() <<
+                " bytes per i-node: " << Tree::getBytesPerInode() <<
+            "\n";
+        }
         if (pathFn == "-") {
             metatree.listPaths(cout, ids);
             return 0;
@@ -617,7 +617,12 @@ Tree::getFattr(fid_t fid)
 MetaDentry *
 Tree::getDentry(fid_t dir, const string& fname)
 {
-    const KeyData hash = MetaDentry::nameHash(fname);
+    const KeyData           hash = MetaDentry::nameHash(fname);
+    DentryCacheEntry* const ce   = dentryCacheEntry(dir, hash);
+    if (ce && ce->dentry && ce->dir == dir && ce->hash == hash &&
+            ce->dentry->getName() == fname) {
+        return ce->dentry;
+    }
     const Key     key(KFS_DENTRY, dir, hash);
     int           p;
     const Node*   n = findLeaf(key, p);
@@ -627,6 +632,11 @@ Tree::getDentry(fid_t dir, const string& fname)
     while (n && key == n->getkey(p)) {
         MetaDentry* const de = refine<MetaDentry>(n->leaf(p));
         if (de->getHash() == hash && de->getName() == fname) {
+            if (ce) {
+                ce->dir    = dir;
+                ce->hash   = hash;
+                ce->dentry = de;
+            }
             return de;
         }
         if (++p == n->children()) {
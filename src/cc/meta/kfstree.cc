@@ -26,6 +26,7 @@
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
+#include <limits>
 #include "kfstree.h"
 #include "Checkpoint.h"
 
@@ -337,6 +338,157 @@ Tree::insert(Meta *item)
     return 0;
 }
 
+/*!
+ * \brief bulk load: create the next peer node at the same level
+ * \return  pointer to the new node
+ */
+Node *
+Node::bulkNewPeer()
+{
+    Node *brother = Node::create(flags());
+
+    brother->linkToPeer(next);
+    linkToPeer(brother);
+    return brother;
+}
+
+/*!
+ * \brief bulk load: fix underfull rightmost node
+ * \param[in] right the rightmost node at this level, this is its left peer
+ * \return  true if the right node was absorbed and can be destroyed
+ *
+ * If both nodes fit into one, this node absorbs its right peer,
+ * otherwise children are moved to the right to even out the counts.
+ */
+bool
+Node::bulkBalance(Node *right)
+{
+    assert(next == right);
+    const int total = count + right->children();
+    if (total <= NKEY) {
+        right->absorb(this);
+        return true;
+    }
+    const int nshift = (total + 1) / 2 - right->children();
+    if (nshift > 0) {
+        shiftRight(right, nshift);
+    }
+    return false;
+}
+
+/*!
+ * \brief Start bulk load.
+ * \param[in] fillPercent   target node fill percentage
+ * \return  true if the tree is empty, and bulk load has started
+ */
+bool
+Tree::bulkLoadStart(int fillPercent)
+{
+    if (mBulkLoadFlag) {
+        return true;
+    }
+    if (! root->hasleaves() || root->children() != 1 ||
+            root->getkey(0) != Key(KFS_SENTINEL, 0)) {
+        return false;
+    }
+    root->destroy();
+    root = 0;
+    first = Node::create(META_LEVEL1);
+    hgt = 0;
+    mBulkLevels.clear();
+    mBulkLevels.push_back(BulkLevel(first));
+    mBulkLastKey = Key(KFS_UNINIT,
+        std::numeric_limits<KeyData>::min(),
+        std::numeric_limits<KeyData>::min());
+    mBulkFill = Node::bulkFillCount(fillPercent);
+    mBulkLoadFlag = true;
+    return true;
+}
+
+/*
+ * Append child to the rightmost node at the specified level. When the node
+ * has reached the target fill, the previous complete node is added to the
+ * level above, and a new node is started. The last two nodes at each level
+ * are kept out of the level above, in order to let bulkLoadFinish() even
+ * them out.
+ */
+void
+Tree::bulkAppend(size_t level, const Key& k, MetaNode *n)
+{
+    if (mBulkLevels.size() <= level) {
+        mBulkLevels.push_back(BulkLevel(Node::create(0)));
+    }
+    Node *cur = mBulkLevels[level].cur;
+    if (cur->children() >= mBulkFill) {
+        Node *const pending = mBulkLevels[level].pending;
+        mBulkLevels[level].pending = cur;
+        cur = cur->bulkNewPeer();
+        mBulkLevels[level].cur = cur;
+        if (pending) {
+            bulkAppend(level + 1, pending->key(), pending);
+        }
+    }
+    cur->bulkAppend(k, n);
+}
+
+/*!
+ * \brief Add the item to the tree being bulk loaded.
+ * \param m the item to be added
+ * \return  status code
+ */
+int
+Tree::bulkInsert(Meta *m)
+{
+    if (! mBulkLoadFlag) {
+        return insert(m);
+    }
+    const Key k = m->key();
+    if (k < mBulkLastKey) {
+        bulkLoadFinish();
+        return insert(m);
+    }
+    mBulkLastKey = k;
+    bulkAppend(0, k, m);
+    return 0;
+}
+
+/*!
+ * \brief Finish bulk load.
+ *
+ * Add the sentinel, then going up from the leaves, even out the last two
+ * nodes at each level and add them to the level above. The level with a
+ * single node becomes the root.
+ */
+void
+Tree::bulkLoadFinish()
+{
+    if (! mBulkLoadFlag) {
+        return;
+    }
+    mBulkLoadFlag = false;
+    bulkAppend(0, Key(KFS_SENTINEL, 0), NULL);
+    for (size_t i = 0; ; i++) {
+        Node *const pending = mBulkLevels[i].pending;
+        Node *cur = mBulkLevels[i].cur;
+        if (! pending) {
+            assert(i + 1 == mBulkLevels.size());
+            root = cur;
+            hgt = (int)i + 1;
+            break;
+        }
+        if (cur->isdepleted() && pending->bulkBalance(cur)) {
+            cur->destroy();
+            cur = 0;
+        }
+        bulkAppend(i + 1, pending->key(), pending);
+        if (cur) {
+            bulkAppend(i + 1, cur->key(), cur);
+        }
+    }
+    root->setflag(META_ROOT);
+    mBulkLevels.clear();
+}
+
 /*
  * If searching carries us into a new level-1 node below, shift the
  * next level of the descent path over by one, repeating as necessary
@@ -397,6 +549,14 @@ Tree::del(Meta *m)
     LeafIter li(n, pos);
     while (!removed && mkey == n->getkey(pos)) {
         if (m->match(n->leaf(pos))) {
+            if (m->metaType() == KFS_DENTRY) {
+                MetaDentry* const de = refine<MetaDentry>(n->leaf(pos));
+                DentryCacheEntry* const ce =
+                    dentryCacheEntry(de->getDir(), de->getHash());
+                if (ce && ce->dentry == de) {
+                    ce->dentry = 0;
+                }
+            }
             n->remove(pos);
             removed = true;
         } else {
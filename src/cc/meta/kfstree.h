@@ -120,12 +120,21 @@ public:
     * \param[in] test   the key that we are looking for
     * \return       the position of first key >= test;
     *           can be off the end of the array
+    *
+    * The keys are sorted, therefore the number of keys less than test is
+    * the lower bound position. Counting all keys has no data dependent
+    * branches and no dependent loads, so the node cache lines are fetched
+    * in parallel instead of one binary search step at a time; with at most
+    * NKEY children this is faster than binary search.
     */
     template<typename MATCH>
     int findplace(const MATCH &test) const
     {
-        const Key* const p = lower_bound(childKey, childKey + count, test);
-        return p - childKey;
+        int n = 0;
+        for (int i = 0; i < count; i++) {
+            n += childKey[i] < test ? 1 : 0;
+        }
+        return n;
     }
     //! \brief rightmost (largest) key in node
     Key keySelf() const { return childKey[count - 1]; }
@@ -163,6 +172,20 @@ public:
     }
     ostream& showSelf(ostream& os) const;
     void showChildren() const;
+    //! \brief bulk load: # of children per node for given fill percentage
+    static int bulkFillCount(int fillPercent)
+    {
+        const int cnt = NKEY * fillPercent / 100;
+        return (cnt < NFEWEST ? NFEWEST : (cnt > NKEY ? NKEY : cnt));
+    }
+    //! \brief bulk load: append child, the node must not be full
+    void bulkAppend(const Key& k, MetaNode *n)
+    {
+        assert(! isfull());
+        appendChild(k, n);
+    }
+    Node *bulkNewPeer();            //!< bulk load: add next peer
+    bool bulkBalance(Node *right);  //!< bulk load: fix underfull last node
 };
 
 /*!
@@ -329,10 +352,39 @@ class Tree {
     //entries.
     PathToFidCacheMap mPathToFidCache;
     time_t mLastPathToFidCacheCleanupTime;
+    //!< direct mapped (parent dir, name) -> dentry cache, to skip tree
+    //search for repeated lookups of the same path components. Entries are
+    //invalidated when dentry is deleted from the tree.
+    struct DentryCacheEntry {
+        fid_t       dir;
+        KeyData     hash;
+        MetaDentry* dentry;
+        DentryCacheEntry(): dir(-1), hash(0), dentry(0) {}
+    };
+    vector<DentryCacheEntry> mDentryCache;
     StTmp<vector<MetaChunkInfo*> >::Tmp mChunkInfosTmp;
     StTmp<vector<MetaDentry*> >::Tmp    mDentriesTmp;
     int64_t mFileSystemId;
     int64_t mCrTime;
+    struct BulkLevel {      //!< bulk load state for one tree level
+        Node *pending;      //!< complete node, not yet added to parent
+        Node *cur;          //!< rightmost node being filled
+        BulkLevel(Node *n = 0): pending(0), cur(n) {}
+    };
+    DentryCacheEntry* dentryCacheEntry(fid_t dir, KeyData hash)
+    {
+        if (mDentryCache.empty()) {
+            return 0;
+        }
+        const uint64_t h = ((uint64_t)dir * 0x9E3779B97F4A7C15ull) ^
+            ((uint64_t)hash >> 4);
+        return &mDentryCache[(size_t)(h ^ (h >> 32)) &
+            (mDentryCache.size() - 1)];
+    }
+    vector<BulkLevel> mBulkLevels;
+    Key mBulkLastKey;
+    int mBulkFill;
+    bool mBulkLoadFlag;
 
 
     template<typename MATCH>
@@ -400,6 +452,7 @@ class Tree {
         ChunkIterator& cit, MetaChunkInfo*& ci) const;
     void setFileSize(MetaFattr* fa, chunkOff_t size,
         int64_t nfiles, int64_t ndirs);
+    void bulkAppend(size_t level, const Key& k, MetaNode *n);
 public:
     Tree()
         : root(0),
@@ -410,10 +463,15 @@ public:
           mUpdatePathSpaceUsage(false),
           mPathToFidCache(),
           mLastPathToFidCacheCleanupTime(0),
+          mDentryCache(size_t(1) << 16),
           mChunkInfosTmp(),
           mDentriesTmp(),
           mFileSystemId(-1),
-          mCrTime()
+          mCrTime(),
+          mBulkLevels(),
+          mBulkLastKey(),
+          mBulkFill(0),
+          mBulkLoadFlag(false)
     {
         root = Node::create(META_ROOT|META_LEVEL1);
         root->insertData(new Key(KFS_SENTINEL, 0), NULL, 0);
@@ -441,6 +499,19 @@ public:
     {
         mIsPathToFidCacheEnabled = true;
     }
+    //!< set dentry cache size, rounded down to power of 2, 0 -- disable
+    void setDentryCacheSize(size_t size)
+    {
+        size_t sz = size > 0 ? 1 : 0;
+        while (sz > 0 && sz <= size / 2) {
+            sz <<= 1;
+        }
+        if (sz != mDentryCache.size()) {
+            vector<DentryCacheEntry>(sz).swap(mDentryCache);
+        }
+    }
+    size_t getDentryCacheSize() const
+        { return mDentryCache.size(); }
     void setUpdatePathSpaceUsage(bool flag)
     {
         const bool recomputeFlag = ! mUpdatePathSpaceUsage && flag;
@@ -451,7 +522,30 @@ public:
     }
     bool getUpdatePathSpaceUsageFlag() const
         { return mUpdatePathSpaceUsage; }
+    //!< average meta data memory per i-node: tree nodes, dentries, file
+    //attributes, and names
+    static int64_t getBytesPerInode()
+    {
+        const int64_t cnt =
+            (int64_t)MetaNode::getPoolAllocator<MetaFattr>().GetInUseCount();
+        return (cnt <= 0 ? int64_t(0) : (int64_t)(
+            MetaNode::getPoolAllocator<Node>().GetStorageSize() +
+            MetaNode::getPoolAllocator<MetaDentry>().GetStorageSize() +
+            MetaNode::getPoolAllocator<MetaFattr>().GetStorageSize() +
+            MetaDentry::getNameBytes()) / cnt);
+    }
     int insert(Meta *m);            //!< add data item
+    /*
+     * Bulk load: build the tree bottom up from the items added in key
+     * order, filling the nodes to the specified percentage. Only an empty
+     * tree can be bulk loaded. The tree cannot be searched until the bulk
+     * load is finished. An item that is out of key order ends the bulk load,
+     * and is inserted, along with all subsequent items, with insert().
+     */
+    bool bulkLoadStart(int fillPercent = 90);
+    int bulkInsert(Meta *m);        //!< add data item in key order
+    void bulkLoadFinish();          //!< build upper levels, set root
+    bool isBulkLoading() const { return mBulkLoadFlag; }
     int del(Meta *m);           //!< remove data item
     Node *getroot() { return root; }    //!< return root node
     Node *firstLeaf() { return first; } //!< leftmost leaf
@@ -687,6 +781,7 @@ extractAll(Node *n, int kp, const MATCH &k, vector <T *> &result)
 }
 
 extern Tree metatree;
+extern const string DUMPSTERDIR;
 extern void makeDumpsterDir();
 extern void emptyDumpsterDir();
 }
@@ -30,6 +30,12 @@
 // and produces a new checkpoint file.  When the metaserver rolls over the log
 // files, it creates a symlink to point the "LAST" closed log file; when log
 // compaction is done, we only compact upto the last closed log file.
+// In follow mode (-f) the tool keeps the meta tree in memory, periodically
+// replays the log segments closed by the running meta server since the last
+// pass, and writes new checkpoint. Running the log compactor in follow mode
+// alongside the meta server with checkpoint disabled
+// (metaServer.checkpoint.interval = -1) removes checkpoint work from the meta
+// server entirely.
 //
 //----------------------------------------------------------------------------
 
@@ -42,6 +48,8 @@
 #include "common/MsgLogger.h"
 #include "common/MdStream.h"
 
+#include <unistd.h>
+
 #include <iostream>
 #include <cassert>
 
@@ -64,6 +72,34 @@ RestoreCheckpoint(const string& lockfn, bool allowEmptyCheckpointFlag)
     }
 }
 
+static int
+FollowLogs(int intervalSec)
+{
+    KFS_LOG_STREAM_INFO <<
+        "following logs in: " << LOGDIR <<
+        " interval: "         << intervalSec << " sec." <<
+    KFS_LOG_EOM;
+    for (; ;) {
+        sleep(intervalSec);
+        const seq_t lastcp = oplog.checkpointed();
+        int         status = replayer.playNewLogs();
+        if (status == 0 && lastcp != oplog.checkpointed()) {
+            metatree.recomputeDirSize();
+            status = cp.do_CP();
+            KFS_LOG_STREAM(status == 0 ?
+                    MsgLogger::kLogLevelINFO :
+                    MsgLogger::kLogLevelERROR) <<
+                "checkpoint: " << oplog.checkpointed() <<
+                " log: "       << oplog.name() <<
+                " status: "    << status <<
+            KFS_LOG_EOM;
+        }
+        if (status != 0) {
+            return status;
+        }
+    }
+}
+
 static int
 LogCompactorMain(int argc, char** argv)
 {
@@ -75,9 +111,11 @@ LogCompactorMain(int argc, char** argv)
     string  cpdir;
     string  lockFn;
     bool    allowEmptyCheckpointFlag = false;
+    int     binaryFormat = -1;
+    int     followIntervalSec = -1;
     int     status = 0;
 
-    while ((optchar = getopt(argc, argv, "hpl:c:r:L:e:")) != -1) {
+    while ((optchar = getopt(argc, argv, "hpl:c:r:L:e:b:f:")) != -1) {
         switch (optchar) {
             case 'L':
                 lockFn = optarg;
@@ -100,6 +138,15 @@ LogCompactorMain(int argc, char** argv)
             case 'e':
                 allowEmptyCheckpointFlag = atoi(optarg) != 0;
                 break;
+            case 'b':
+                binaryFormat = atoi(optarg) != 0 ? 1 : 0;
+                break;
+            case 'f':
+                followIntervalSec = atoi(optarg);
+                if (followIntervalSec <= 0) {
+                    status = 1;
+                }
+                break;
             default:
                 status = 1;
                 break;
@@ -113,6 +160,12 @@ LogCompactorMain(int argc, char** argv)
             "[-c <cpdir>]\n"
             "[-r <# of replicas> set replication to this value for all files]\n"
             "[-e {0|1} allow empty checkpoint]\n"
+            "[-b {0|1} write checkpoint in binary (1) or text (0) format;"
+            " write checkpoint even if no log entries were applied, in order"
+            " to convert checkpoint format]\n"
+            "[-f <sec> follow mode: replay the logs closed by the running"
+            " meta server every <sec> seconds, and write new checkpoint"
+            " if any log entries were applied]\n"
         ;
         return status;
     }
@@ -130,11 +183,18 @@ LogCompactorMain(int argc, char** argv)
                 metatree.changePathReplication(ROOTFID, numReplicasPerFile,
                     kKfsSTierUndef, kKfsSTierUndef);
         }
-            if (numReplicasPerFile > 0 || lastcp != oplog.checkpointed()) {
+            if (0 <= binaryFormat) {
+                cp.setBinaryFormatFlag(binaryFormat != 0);
+            }
+            if (numReplicasPerFile > 0 || lastcp != oplog.checkpointed() ||
+                    0 <= binaryFormat) {
                 status = cp.do_CP();
             }
         }
     }
+    if (status == 0 && 0 < followIntervalSec) {
+        status = FollowLogs(followIntervalSec);
+    }
     MdStream::Cleanup();
     return (status == 0 ? 0 : 1);
 }
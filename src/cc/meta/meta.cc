@@ -42,6 +42,8 @@ using std::ostringstream;
 UniqueID fileID(0, ROOTFID);
 UniqueID chunkID(1, ROOTFID);
 
+int64_t MetaDentry::sNameBytes = 0;
+
 inline ostream&
 MetaDentry::showSelf(ostream& os) const
 {
@@ -117,7 +117,7 @@ protected:
           hash(nameHash(fname)),
           fattr(fa),
           name(fname)
-          {}
+          { sNameBytes += name.size(); }
 
     MetaDentry(const MetaDentry *other)
         : Meta(KFS_DENTRY),
@@ -126,9 +126,12 @@ protected:
           hash(other->hash),
           fattr(other->fattr),
           name(other->name)
-          {}
-    ~MetaDentry() {}
+          { sNameBytes += name.size(); }
+    ~MetaDentry() { sNameBytes -= name.size(); }
 public:
+    //!< total length of the names, does not include the string
+    //representation and allocator overhead
+    static int64_t getNameBytes() { return sNameBytes; }
     static inline KeyData nameHash(const string& name)
     {
         // Key(t,d1,d2) discards d2 low order bits.
@@ -167,6 +170,8 @@ public:
     bool matchSelf(const Meta *test) const;
     MetaFattr* getFattr() const { return fattr; }
     void setFattr(MetaFattr* fa) { fattr = fa; }
+private:
+    static int64_t sNameBytes;
 };
 
 class BaseFattr {
@@ -371,12 +371,18 @@ MetaServer::SetParameters(const Properties& props)
             mLogRotateIntervalSec));
 
     logger_set_rotate_interval(mLogRotateIntervalSec);
+    logger_set_parameters(props);
 
     string chunkmapDumpDir = props.getValue("metaServer.chunkmapDumpDir", ".");
     setChunkmapDumpDir(chunkmapDumpDir);
     metatree.setUpdatePathSpaceUsage(props.getValue(
         "metaServer.updateDirSizes",
         metatree.getUpdatePathSpaceUsageFlag() ? 1 : 0) != 0);
+    const int dentryCacheSize = props.getValue(
+        "metaServer.dentryCacheSize",
+        (int)metatree.getDentryCacheSize());
+    metatree.setDentryCacheSize(
+        dentryCacheSize < 0 ? size_t(0) : (size_t)dentryCacheSize);
 }
 
 ///
@@ -549,6 +555,7 @@ MetaServer::Startup(const Properties& props, bool createEmptyFsFlag)
                     // The following only returns after receiving SIGQUIT.
                     okFlag = gNetDispatch.Start();
                 }
+                logger_shutdown();
             }
         } else {
             KFS_LOG_STREAM_FATAL <<
@@ -700,6 +707,13 @@ MetaServer::Startup(bool createEmptyFsFlag, bool createEmptyFsIfNoCpExistsFlag)
         // Init fs id if needed, leave create time 0, restorer will set these
         // unless fsinfo entry doesn't exit.
         Restorer r;
+        r.setReadAhead(
+            mStartupProperties.getValue(
+                "metaServer.checkpoint.restoreReadAheadBlockCount", 4),
+            mStartupProperties.getValue(
+                "metaServer.checkpoint.restoreReadAheadBlockSize", 4 << 20));
+        r.setUseMmap(mStartupProperties.getValue(
+            "metaServer.checkpoint.restoreMmap", 0) != 0);
         status = r.rebuild(LASTCP, mMinReplicasPerFile) ? 0 : -EIO;
         rollChunkIdSeedFlag = true;
     } else {
@@ -727,6 +741,11 @@ MetaServer::Startup(bool createEmptyFsFlag, bool createEmptyFsIfNoCpExistsFlag)
         return false;
     }
     KFS_LOG_STREAM_INFO << "replaying logs" << KFS_LOG_EOM;
+    replayer.setReadAhead(
+        mStartupProperties.getValue(
+            "metaServer.log.replayReadAheadBlockCount", 4),
+        mStartupProperties.getValue(
+            "metaServer.log.replayReadAheadBlockSize", 1 << 20));
     status = replayer.playAllLogs();
     if (status != 0) {
         KFS_LOG_STREAM_FATAL << "log replay failed: " <<
@@ -80,6 +80,9 @@ public:
           mTotalCount(0),
           mThreadCount(0),
           mRequestQueueCount(0),
+          mIoQueueCount(0),
+          mLowPriorityWeight(0),
+          mLowPriorityDispatchCountPtr(0),
           mRequestBufferCount(0),
           mCompletionRunningCount(0),
           mFileCount(0),
@@ -138,7 +141,8 @@ public:
         int            inBufferCount,
         IoCompletion*  inIoCompletionPtr,
         Time           inTimeWaitNanoSec,
-        int64_t        inEofHint);
+        int64_t        inEofHint,
+        bool           inLowPriorityFlag);
     bool Cancel(
         RequestId inRequestId);
     IoCompletion* CancelOrSetCompletionIfInFlight(
@@ -156,6 +160,12 @@ public:
         outReadBlockCount   = mPendingReadBlockCount;
         outWriteBlockCount  = mPendingWriteBlockCount;
     }
+    void GetMutexCounters(
+        QCMutex::Counters& outCounters)
+    {
+        QCStMutexLocker theLocker(mMutex);
+        mMutex.GetCounters(outCounters);
+    }
     OpenFileStatus OpenFile(
         const char* inFileNamePtr,
         int64_t     inMaxFileSize,
@@ -169,6 +179,12 @@ public:
     void CloseAllFiles();
     int GetBlockSize() const
         { return mBlockSize; }
+    void SetLowPriorityWeight(
+        int inWeight)
+    {
+        QCStMutexLocker theLocker(mMutex);
+        mLowPriorityWeight = inWeight < 0 ? 0 : inWeight;
+    }
     EnqueueStatus CheckOpenStatus(
         FileIdx       inFileIdx,
         IoCompletion* inIoCompletionPtr,
@@ -254,6 +270,7 @@ private:
               mReqType(kReqTypeNone),
               mInFlightFlag(false),
               mFreeBuffersIfNoIoCompletionFlag(false),
+              mLowPriorityFlag(false),
               mBufferCount(0),
               mFileIdx(0),
               mBlockIdx(0),
@@ -270,6 +287,7 @@ private:
         ReqType       mReqType:8;
         bool          mInFlightFlag:1;
         bool          mFreeBuffersIfNoIoCompletionFlag:1;
+        bool          mLowPriorityFlag:1;
         int           mBufferCount;
         uint64_t      mFileIdx:16;
         uint64_t      mBlockIdx:48;
@@ -459,6 +477,9 @@ private:
     int                mTotalCount;
     int                mThreadCount;
     int                mRequestQueueCount;
+    int                mIoQueueCount;
+    int                mLowPriorityWeight;
+    int*               mLowPriorityDispatchCountPtr;
     int                mRequestBufferCount;
     int                mCompletionRunningCount;
     int                mFileCount;
@@ -573,7 +594,10 @@ private:
         { return (mRequestsPtr[inIdx].mNextIdx == inIdx); }
     bool HasPendingReq(
         int inThreadIdx) const
-        { return (! Empty(kIoQueueIdx + inThreadIdx)); }
+    {
+        return (! Empty(kIoQueueIdx + inThreadIdx) ||
+            ! Empty(kIoQueueIdx + mIoQueueCount + inThreadIdx));
+    }
     bool HasPendingNonBarrierReq(
         int inThreadIdx) const
     {
@@ -610,6 +634,7 @@ private:
         mFreeCount += GetReqListSize(inReq);
         inReq.mReqType         = kReqTypeNone;
         inReq.mInFlightFlag    = false;
+        inReq.mLowPriorityFlag = false;
         inReq.mIoCompletionPtr = 0;
         inReq.mBufferCount     = 0;
         Insert(mRequestsPtr[kFreeQueueIdx], inReq);
@@ -663,7 +688,10 @@ private:
         int      inThreadIdx)
     {
         Trace("enqueue", inReq);
-        Insert(mRequestsPtr[kIoQueueIdx + inThreadIdx], inReq);
+        // Low priority requests have their own list heads, following the
+        // normal priority ones.
+        Insert(mRequestsPtr[kIoQueueIdx + inThreadIdx +
+            (inReq.mLowPriorityFlag ? mIoQueueCount : 0)], inReq);
         mPendingCount++;
         mFilePendingReqCountPtr[inReq.mFileIdx]++;
         if (inReq.mReqType == kReqTypeRead) {
@@ -678,7 +706,18 @@ private:
     Request* Dequeue(
         int inThreadIdx)
     {
-        Request* const theReqPtr = Front(kIoQueueIdx + inThreadIdx);
+        Request*       theReqPtr    = Front(kIoQueueIdx + inThreadIdx);
+        Request* const theLowReqPtr =
+            Front(kIoQueueIdx + mIoQueueCount + inThreadIdx);
+        if (theLowReqPtr) {
+            // Do not let low priority requests starve: dispatch one after
+            // mLowPriorityWeight normal priority requests.
+            int& theCount = mLowPriorityDispatchCountPtr[inThreadIdx];
+            if (! theReqPtr || mLowPriorityWeight <= ++theCount) {
+                theReqPtr = theLowReqPtr;
+                theCount  = 0;
+            }
+        }
         if (theReqPtr) {
             RemoveWithSubRequests(*theReqPtr);
         }
@@ -1029,6 +1068,9 @@ QCDiskQueue::Queue::StopSelf()
     mRequestBufferCount = 0;
     delete [] mRequestsPtr;
     mRequestsPtr = 0;
+    delete [] mLowPriorityDispatchCountPtr;
+    mLowPriorityDispatchCountPtr = 0;
+    mIoQueueCount = 0;
     delete [] mPendingCloseHeadPtr;
     mPendingCloseHeadPtr = 0;
     mPendingCloseTailPtr = 0;
@@ -1176,11 +1218,16 @@ QCDiskQueue::Queue::Start(
     }
     mBuffersPtr = new char*[inMaxQueueDepth * inMaxBuffersPerRequestCount];
     mRequestBufferCount = inMaxBuffersPerRequestCount;
-    mRequestQueueCount  = kRequestQueueCount +
-        (mRequestAffinityFlag ? inThreadCount - 1 : 0);
+    mIoQueueCount       = mRequestAffinityFlag ? inThreadCount : 1;
+    // Free list head, followed by normal, and low priority io lists heads.
+    mRequestQueueCount  = kIoQueueIdx + 2 * mIoQueueCount;
+    mLowPriorityDispatchCountPtr = new int[mIoQueueCount];
+    for (int i = 0; i < mIoQueueCount; i++) {
+        mLowPriorityDispatchCountPtr[i] = 0;
+    }
     const int theReqCnt = mRequestQueueCount + inMaxQueueDepth;
     mRequestsPtr = new Request[theReqCnt];
-    // Init list heads: kFreeQueueIdx kIoQueueIdx.
+    // Init list heads: kFreeQueueIdx kIoQueueIdx and low priority.
     for (mTotalCount = 0; mTotalCount < mRequestQueueCount; mTotalCount++) {
         Init(mRequestsPtr[mTotalCount]);
     }
@@ -1214,7 +1261,8 @@ QCDiskQueue::Queue::Enqueue(
     int                         inBufferCount,
     QCDiskQueue::IoCompletion*  inIoCompletionPtr,
     QCDiskQueue::Time           inTimeWaitNanoSec,
-    int64_t                     inEofHint)
+    int64_t                     inEofHint,
+    bool                        inLowPriorityFlag)
 {
     if ((inReqType != kReqTypeRead && ! IsWriteReqType(inReqType)) ||
             inBufferCount <= 0 ||
@@ -1286,6 +1334,10 @@ QCDiskQueue::Queue::Enqueue(
     if (kReqTypeWriteSync == inReqType && 0 <= inEofHint) {
         mFileInfoPtr[inFileIdx].mCloseFileSize = inEofHint;
     }
+    // Keep requests in order with respect to pending open, as open is
+    // queued with normal priority.
+    theReq.mLowPriorityFlag = inLowPriorityFlag && 0 < mLowPriorityWeight &&
+        ! mFileInfoPtr[inFileIdx].mOpenPendingFlag;
     const int theThreadIdx = mFileInfoPtr[inFileIdx].mThreadIdx;
     Enqueue(theReq, theThreadIdx);
     if (! mBarrierFlag) {
@@ -2521,7 +2573,8 @@ QCDiskQueue::Enqueue(
     int                         inBufferCount,
     QCDiskQueue::IoCompletion*  inIoCompletionPtr,
     QCDiskQueue::Time           inTimeWaitNanoSec,
-    int64_t                     inEofHint)
+    int64_t                     inEofHint,
+    bool                        inLowPriorityFlag)
 {
     if (! mQueuePtr) {
         return EnqueueStatus(kRequestIdNone, kErrorParameter);
@@ -2534,7 +2587,8 @@ QCDiskQueue::Enqueue(
         inBufferCount,
         inIoCompletionPtr,
         inTimeWaitNanoSec,
-        inEofHint);
+        inEofHint,
+        inLowPriorityFlag);
 }
 
     bool
@@ -2571,6 +2625,17 @@ QCDiskQueue::GetPendingCount(
     }
 }
 
+    void
+QCDiskQueue::GetMutexCounters(
+    QCMutex::Counters& outCounters)
+{
+    if (mQueuePtr) {
+        mQueuePtr->GetMutexCounters(outCounters);
+    } else {
+        outCounters.Clear();
+    }
+}
+
     QCDiskQueue::CompletionStatus
 QCDiskQueue::SyncIo(
     QCDiskQueue::ReqType         inReqType,
@@ -2723,6 +2788,15 @@ QCDiskQueue::GetBlockSize() const
     return (mQueuePtr ? mQueuePtr->GetBlockSize() : 0);
 }
 
+    void
+QCDiskQueue::SetLowPriorityWeight(
+    int inWeight)
+{
+    if (mQueuePtr) {
+        mQueuePtr->SetLowPriorityWeight(inWeight);
+    }
+}
+
     QCDiskQueue::Status
 QCDiskQueue::AllocateFileSpace(
     QCDiskQueue::FileIdx inFileIdx)
@@ -328,7 +328,8 @@ public:
         int            inBufferCount,
         IoCompletion*  inIoCompletionPtr,
         Time           inTimeWaitNanoSec = -1,
-        int64_t        inEofHint         = -1);
+        int64_t        inEofHint         = -1,
+        bool           inLowPriorityFlag = false);
 
     EnqueueStatus Read(
         FileIdx        inFileIdx,
@@ -336,7 +337,8 @@ public:
         InputIterator* inBufferIteratorPtr,
         int            inBufferCount,
         IoCompletion*  inIoCompletionPtr,
-        Time           inTimeWaitNanoSec = -1)
+        Time           inTimeWaitNanoSec = -1,
+        bool           inLowPriorityFlag = false)
     {
         return Enqueue(
             kReqTypeRead,
@@ -345,7 +347,9 @@ public:
             inBufferIteratorPtr,
             inBufferCount,
             inIoCompletionPtr,
-            inTimeWaitNanoSec);
+            inTimeWaitNanoSec,
+            -1,
+            inLowPriorityFlag);
     }
 
     EnqueueStatus Write(
@@ -356,7 +360,8 @@ public:
         IoCompletion*  inIoCompletionPtr,
         Time           inTimeWaitNanoSec = -1,
         bool           inSyncFlag        = false,
-        int64_t        inEofHint         = -1)
+        int64_t        inEofHint         = -1,
+        bool           inLowPriorityFlag = false)
     {
         return Enqueue(
             inSyncFlag ? kReqTypeWriteSync : kReqTypeWrite,
@@ -366,7 +371,8 @@ public:
             inBufferCount,
             inIoCompletionPtr,
             inTimeWaitNanoSec,
-            inEofHint);
+            inEofHint,
+            inLowPriorityFlag);
     }
 
     CompletionStatus SyncIo(
@@ -428,6 +434,9 @@ public:
         int64_t& outReadBlockCount,
         int64_t& outWriteBlockCount);
 
+    void GetMutexCounters(
+        QCMutex::Counters& outCounters);
+
     OpenFileStatus OpenFile(
         const char* inFileNamePtr,
         int64_t     inMaxFileSize           = -1,
@@ -473,6 +482,13 @@ public:
 
     int GetBlockSize() const;
 
+    // Low priority read and write requests are queued separately, and
+    // dispatched only when no other requests are pending, or after
+    // inWeight other requests were dispatched ahead of them. 0 -- disables
+    // low priority queuing, all requests are dispatched in order.
+    void SetLowPriorityWeight(
+        int inWeight);
+
     Status AllocateFileSpace(
         FileIdx inFileIdx);
 
@@ -305,6 +305,18 @@ private:
 #include <pthread.h>
 #include <sys/epoll.h>
 
+#include <vector>
+
+// Interest changes of the file descriptors in the epoll set are deferred until
+// the next Poll() invocation, and only the resulting change for each file
+// descriptor is applied. This eliminates epoll_ctl() system calls for the
+// common "enable out, write, disable out" sequence within one event loop
+// iteration. If the deferred change fails, then the error event is reported
+// by Next(). Add() and Remove() are not deferred, as the caller might close
+// the file descriptor right after Remove().
+// Edge triggered and one shot modes are not used, as the net manager relies
+// on level triggered semantics: it might not consume all available data or
+// buffer space when handling an event.
 class QCFdPoll::Impl : public QCFdPollImplBase
 {
 public:
@@ -317,7 +329,11 @@ public:
           mEpollEventCount(0),
           mMaxEventCount(0),
           mNextEventIdx(0),
-          mEventsPtr(0)
+          mEventsPtr(0),
+          mFdStates(),
+          mPendingFds(),
+          mErrorEvents(),
+          mNextErrorEventIdx(0)
     {
         if (mEpollFd < 0 && errno != 0 && (mEpollFd = -errno) > 0) {
             mEpollFd = -mEpollFd;
@@ -344,29 +360,66 @@ public:
         mNextEventIdx    = 0;
         delete [] mEventsPtr;
         mEventsPtr = 0;
+        FdStates().swap(mFdStates);
+        Fds().swap(mPendingFds);
+        mErrorEvents.clear();
+        mNextErrorEventIdx = 0;
         return theRet;
     }
     int Add(
         Fd    inFd,
         int   inOpType,
         void* inUserDataPtr)
-        { return Ctl(EPOLL_CTL_ADD, inFd, inOpType, inUserDataPtr); }
+    {
+        FdState* const theStatePtr = GetFdState(inFd, true);
+        if (theStatePtr) {
+            theStatePtr->Reset();
+        }
+        const int theRet = Ctl(EPOLL_CTL_ADD, inFd, inOpType, inUserDataPtr);
+        if (theRet == 0 && theStatePtr) {
+            theStatePtr->mAddedFlag   = true;
+            theStatePtr->mOpType      = inOpType;
+            theStatePtr->mUserDataPtr = inUserDataPtr;
+        }
+        return theRet;
+    }
     int Set(
         Fd    inFd,
         int   inOpType,
         void* inUserDataPtr)
-        { return Ctl(EPOLL_CTL_MOD, inFd, inOpType, inUserDataPtr); }
+    {
+        FdState* const theStatePtr = GetFdState(inFd, false);
+        if (! theStatePtr || ! theStatePtr->mAddedFlag) {
+            return Ctl(EPOLL_CTL_MOD, inFd, inOpType, inUserDataPtr);
+        }
+        theStatePtr->mPendingOpType      = inOpType;
+        theStatePtr->mPendingUserDataPtr = inUserDataPtr;
+        if (! theStatePtr->mPendingFlag) {
+            theStatePtr->mPendingFlag = true;
+            mPendingFds.push_back(inFd);
+        }
+        return 0;
+    }
     int Remove(
         Fd inFd)
-        { return Ctl(EPOLL_CTL_DEL, inFd, 0, 0); }
+    {
+        FdState* const theStatePtr = GetFdState(inFd, false);
+        if (theStatePtr) {
+            theStatePtr->Reset();
+        }
+        return Ctl(EPOLL_CTL_DEL, inFd, 0, 0);
+    }
     int Poll(
         int inMaxEventCountHint,
         int inWaitMilliSec)
     {
         mNextEventIdx = mEpollEventCount;
+        mErrorEvents.clear();
+        mNextErrorEventIdx = 0;
         if (mEpollFd < 0) {
             return mEpollFd;
         }
+        ApplyPendingChanges();
         const int theEventCount =
             inMaxEventCountHint > 1 ? inMaxEventCountHint : 1;
         if (! mEventsPtr || theEventCount > mMaxEventCount) {
@@ -376,10 +429,15 @@ public:
             mMaxEventCount = theAllocCount;
         }
         mEpollEventCount = epoll_wait(
-            mEpollFd, mEventsPtr, theEventCount, inWaitMilliSec);
+            mEpollFd, mEventsPtr, theEventCount,
+            mErrorEvents.empty() ? inWaitMilliSec : 0);
         mNextEventIdx = 0;
         QCASSERT(mEpollEventCount <= theEventCount);
-        return (mEpollEventCount >= 0 ? mEpollEventCount :
+        if (mEpollEventCount < 0 && ! mErrorEvents.empty()) {
+            mEpollEventCount = 0;
+        }
+        return (mEpollEventCount >= 0 ?
+            mEpollEventCount + (int)mErrorEvents.size() :
             (errno > 0 ? -errno : (errno == 0 ? mEpollEventCount : errno)));
     }
     bool Next(
@@ -387,6 +445,11 @@ public:
         void*& outUserDataPtr)
     {
         if (mNextEventIdx >= mEpollEventCount) {
+            if (mNextErrorEventIdx < mErrorEvents.size()) {
+                outOpType      = kOpTypeError;
+                outUserDataPtr = mErrorEvents[mNextErrorEventIdx++];
+                return true;
+            }
             return false;
         }
         QCASSERT(mEventsPtr);
@@ -397,16 +460,83 @@ public:
     }
 
 private:
+    struct FdState
+    {
+        FdState()
+            : mUserDataPtr(0),
+              mPendingUserDataPtr(0),
+              mOpType(0),
+              mPendingOpType(0),
+              mAddedFlag(false),
+              mPendingFlag(false)
+            {}
+        void Reset()
+            { *this = FdState(); }
+        void* mUserDataPtr;
+        void* mPendingUserDataPtr;
+        int   mOpType;
+        int   mPendingOpType;
+        bool  mAddedFlag;
+        bool  mPendingFlag;
+    };
+    typedef std::vector<FdState> FdStates;
+    typedef std::vector<Fd>      Fds;
+    typedef std::vector<void*>   ErrorEvents;
+
     int                 mEpollFd;
     int                 mEpollEventCount;
     int                 mMaxEventCount;
     int                 mNextEventIdx;
     struct epoll_event* mEventsPtr;
+    FdStates            mFdStates;
+    Fds                 mPendingFds;
+    ErrorEvents         mErrorEvents;
+    size_t              mNextErrorEventIdx;
     static bool         sForkedFlag;
     static int          sCtlErrors;
     static int          sLastCtlOp;
     static int          sLastCtlError;
 
+    FdState* GetFdState(
+        Fd   inFd,
+        bool inCreateFlag)
+    {
+        if (inFd < 0) {
+            return 0;
+        }
+        if (mFdStates.size() <= (size_t)inFd) {
+            if (! inCreateFlag) {
+                return 0;
+            }
+            mFdStates.resize(((size_t)inFd + 1) +
+                min(((size_t)inFd + 1) / 2, (size_t)kFdCountHint));
+        }
+        return &mFdStates[inFd];
+    }
+    void ApplyPendingChanges()
+    {
+        for (Fds::const_iterator theIt = mPendingFds.begin();
+                theIt != mPendingFds.end();
+                ++theIt) {
+            FdState& theState = mFdStates[*theIt];
+            if (! theState.mPendingFlag) {
+                continue; // Removed or added again.
+            }
+            theState.mPendingFlag = false;
+            if (theState.mPendingOpType == theState.mOpType &&
+                    theState.mPendingUserDataPtr == theState.mUserDataPtr) {
+                continue;
+            }
+            if (Ctl(EPOLL_CTL_MOD, *theIt, theState.mPendingOpType,
+                    theState.mPendingUserDataPtr) == 0) {
+                theState.mOpType      = theState.mPendingOpType;
+                theState.mUserDataPtr = theState.mPendingUserDataPtr;
+            } else {
+                mErrorEvents.push_back(theState.mPendingUserDataPtr);
+            }
+        }
+        mPendingFds.clear();
+    }
     int EPollEventMask(
         int inOpType)
     {
@@ -51,9 +51,10 @@ public:
         { Partition::Destroy(); }
 
     int Create(
-        int  inNumBuffers,
-        int  inBufferSize,
-        bool inLockMemoryFlag)
+        int     inNumBuffers,
+        int     inBufferSize,
+        bool    inLockMemoryFlag,
+        int64_t inHugePageSize)
     {
         int theBufSizeShift = -1;
         for (int i = inBufferSize; i > 0; i >>= 1, theBufSizeShift++)
@@ -72,8 +73,21 @@ public:
             kPageSize : size_t(inBufferSize);
         mAllocSize = size_t(inNumBuffers) * inBufferSize + kAlign;
         mAllocSize = (mAllocSize + kPageSize - 1) / kPageSize * kPageSize;
-        mAllocPtr = mmap(0, mAllocSize,
-            PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+        mAllocPtr = MAP_FAILED;
+        if (size_t(kPageSize) < size_t(inHugePageSize)) {
+            mAllocPtr = MapHugePages(size_t(inHugePageSize));
+        }
+        if (mAllocPtr == MAP_FAILED) {
+            mAllocPtr = mmap(0, mAllocSize,
+                PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+#ifdef MADV_HUGEPAGE
+            // Ask for transparent huge pages, if explicit huge pages are not
+            // available, the advice is ignored if not supported.
+            if (mAllocPtr != MAP_FAILED && 0 < inHugePageSize) {
+                madvise(mAllocPtr, mAllocSize, MADV_HUGEPAGE);
+            }
+#endif
+        }
         if (mAllocPtr == MAP_FAILED) {
             const int theRet = errno;
             mAllocPtr = 0;
@@ -98,6 +112,30 @@ public:
         return 0;
     }
 
+    void* MapHugePages(
+        size_t inHugePageSize)
+    {
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+        int theShift = 0;
+        while ((size_t(1) << theShift) < inHugePageSize) {
+            theShift++;
+        }
+        if ((size_t(1) << theShift) != inHugePageSize) {
+            return MAP_FAILED;
+        }
+        const size_t theSize =
+            (mAllocSize + inHugePageSize - 1) / inHugePageSize * inHugePageSize;
+        void* const  thePtr  = mmap(0, theSize, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANON | MAP_HUGETLB | (theShift << MAP_HUGE_SHIFT),
+            -1, 0);
+        if (thePtr != MAP_FAILED) {
+            mAllocSize = theSize;
+        }
+        return thePtr;
+#else
+        return MAP_FAILED;
+#endif
+    }
     void Destroy()
     {
         delete [] mFreeListPtr;
@@ -215,7 +253,8 @@ QCIoBufferPool::Create(
     int          inPartitionCount,
     int          inPartitionBufferCount,
     int          inBufferSize,
-    bool         inLockMemoryFlag)
+    bool         inLockMemoryFlag,
+    int64_t      inHugePageSize /* = 0 */)
 {
     QCStMutexLocker theLock(mMutex);
     Destroy();
@@ -224,8 +263,8 @@ QCIoBufferPool::Create(
     for (int i = 0; i < inPartitionCount; i++) {
         Partition& thePart = *(new Partition());
         Partition::List::PushBack(mPartitionListPtr, thePart);
-        theErr = thePart.Create(
-            inPartitionBufferCount, inBufferSize, inLockMemoryFlag);
+        theErr = thePart.Create(inPartitionBufferCount, inBufferSize,
+            inLockMemoryFlag, inHugePageSize);
         if (theErr) {
             Destroy();
             break;
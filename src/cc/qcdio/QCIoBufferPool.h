@@ -99,11 +99,16 @@ public:
 
     QCIoBufferPool();
     ~QCIoBufferPool();
+    // If huge page size is greater than the system page size, then an attempt
+    // is made to allocate the buffers from explicit huge pages of this size,
+    // and, if this fails, from regular pages with transparent huge pages
+    // advice.
     int Create(
         int          inPartitionCount,
         int          inPartitionBufferCount,
         int          inBufferSize,
-        bool         inLockMemoryFlag);
+        bool         inLockMemoryFlag,
+        int64_t      inHugePageSize = 0);
     void Destroy();
     char* Get(
         RefillReqId inRefillReqId = kRefillReqIdUndefined);
@@ -33,6 +33,39 @@
 #   define pthread_mutex_timedlock(m, l) pthread_mutex_lock(m)
 #endif
 
+volatile int  QCMutex::sSpinCount(0);
+volatile bool QCMutex::sProfilingFlag(false);
+
+    static inline void
+CpuRelax()
+{
+#if defined(__i386__) || defined(__x86_64__)
+    __asm__ __volatile__ ("pause" ::: "memory");
+#elif defined(__aarch64__)
+    __asm__ __volatile__ ("yield" ::: "memory");
+#endif
+}
+
+    static inline QCMutex::Time
+NowNanoSec()
+{
+#if defined(_POSIX_TIMERS) && ! defined(QC_OS_NAME_DARWIN)
+    struct timespec theTime;
+    if (clock_gettime(CLOCK_MONOTONIC, &theTime)) {
+        return 0;
+    }
+    return ((QCMutex::Time)theTime.tv_sec * 1000 * 1000 * 1000 +
+        theTime.tv_nsec);
+#else
+    struct timeval theTime;
+    if (gettimeofday(&theTime, 0)) {
+        return 0;
+    }
+    return ((QCMutex::Time)theTime.tv_sec * 1000 * 1000 * 1000 +
+        (QCMutex::Time)theTime.tv_usec * 1000);
+#endif
+}
+
     static int
 GetAbsTimeout(
     QCMutex::Time    inTimeoutNanoSec,
@@ -62,7 +95,8 @@ GetAbsTimeout(
 QCMutex::QCMutex()
     : mLockCnt(0),
       mOwner(),
-      mMutex()
+      mMutex(),
+      mCounters()
 {
     int theErr;
     pthread_mutexattr_t theAttr;
@@ -108,6 +142,35 @@ QCMutex::Lock(
     return true;
 }
 
+bool
+QCMutex::LockContended()
+{
+    const int  theSpinCount   = sSpinCount;
+    const bool theProfileFlag = sProfilingFlag;
+    for (int i = 0; i < theSpinCount; i++) {
+        CpuRelax();
+        const int theErr = pthread_mutex_trylock(&mMutex);
+        if (theErr != EBUSY) {
+            Locked(theErr);
+            if (theProfileFlag) {
+                mCounters.mContendedCount++;
+                mCounters.mSpinAcquiredCount++;
+            }
+            return true;
+        }
+    }
+    const Time theStart = theProfileFlag ? NowNanoSec() : Time(0);
+    Locked(pthread_mutex_lock(&mMutex));
+    if (theProfileFlag) {
+        mCounters.mContendedCount++;
+        const Time theEnd = NowNanoSec();
+        if (theStart < theEnd) {
+            mCounters.mWaitNanoSec += theEnd - theStart;
+        }
+    }
+    return true;
+}
+
 void
 QCMutex::RaiseError(
     const char* inMsgPtr,
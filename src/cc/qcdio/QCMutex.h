@@ -37,11 +37,43 @@ class QCMutex
 {
 public:
     typedef int64_t Time;
+    // Contention counters, updated with the mutex held, and only if the
+    // contention profiling is enabled.
+    struct Counters
+    {
+        typedef int64_t Counter;
+
+        Counter mContendedCount;
+        Counter mSpinAcquiredCount;
+        Counter mWaitNanoSec;
+
+        Counters()
+            : mContendedCount(0),
+              mSpinAcquiredCount(0),
+              mWaitNanoSec(0)
+            {}
+        void Clear()
+            { *this = Counters(); }
+        Counters& Add(
+            const Counters& inCounters)
+        {
+            mContendedCount    += inCounters.mContendedCount;
+            mSpinAcquiredCount += inCounters.mSpinAcquiredCount;
+            mWaitNanoSec       += inCounters.mWaitNanoSec;
+            return *this;
+        }
+    };
 
     QCMutex();
     ~QCMutex();
     bool Lock()
-        { return Locked(pthread_mutex_lock(&mMutex)); }
+    {
+        if (sSpinCount <= 0 && ! sProfilingFlag) {
+            return Locked(pthread_mutex_lock(&mMutex));
+        }
+        const int theErr = pthread_mutex_trylock(&mMutex);
+        return (theErr == EBUSY ? LockContended() : Locked(theErr));
+    }
 
     bool Lock(
         Time inTimeoutNanoSec);
@@ -65,10 +97,35 @@ public:
     bool IsOwned() const
         { return (::pthread_equal(mOwner, ::pthread_self()) != 0); }
 
+    // The counters are consistent only if the mutex is owned by the caller.
+    void GetCounters(
+        Counters& outCounters) const
+        { outCounters = mCounters; }
+
+    // The following settings are global, and affect all mutexes. With spin
+    // count greater than 0, Lock() re-tries to acquire contended mutex the
+    // specified number of times, before blocking in the kernel.
+    static void SetSpinCount(
+        int inSpinCount)
+        { sSpinCount = inSpinCount; }
+    static int GetSpinCount()
+        { return sSpinCount; }
+    static void SetProfilingEnabled(
+        bool inFlag)
+        { sProfilingFlag = inFlag; }
+    static bool IsProfilingEnabled()
+        { return sProfilingFlag; }
+
 private:
     int             mLockCnt;
     pthread_t       mOwner;
     pthread_mutex_t mMutex;
+    Counters        mCounters;
+
+    static volatile int  sSpinCount;
+    static volatile bool sProfilingFlag;
+
+    bool LockContended();
 
     void RaiseError(
         const char* inMsgPtr,
@@ -27,28 +27,41 @@
  */
 
 #include <assert.h>
+#include <string.h>
 #include "rs.h"
 #include "prim.h"
 
 /*
- * Reed-Solomon n+3 encoder.
- * nblocks is `n' data blocks plus 3 syndrome blocks.  blocksize _must_
- * be a multiple of 16.  data contains pointers to blocks.  The first
- * n are input data blocks.  The last 3 are the P, Q, and R syndromes.
+ * On x86 wider vector encoders are compiled with the target function
+ * attribute, and selected at run time based on the cpu features, thus the
+ * same binary can use avx2 or avx512 if available. The encoder only needs
+ * xor and multiplication by 2, which are expressed with gcc generic vector
+ * operations.
  */
-void
-rs_encode(int nblocks, int blocksize, void **idata)
+#if (defined(__x86_64__) || defined(__i386__)) && \
+        ! defined(LIBRS_NO_RUNTIME_DISPATCH) && \
+        (defined(__clang__) || (defined(__GNUC__) && \
+        (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define LIBRS_USE_RUNTIME_DISPATCH
+#if defined(__clang__) || __GNUC__ >= 5
+#define LIBRS_USE_AVX512
+#endif
+#endif
+
+/*
+ * Reed-Solomon n+3 encoder for the 16 byte vectors in the [start, end)
+ * range.
+ */
+static void
+rs_encode16(int n, int start, int end, v16 **data)
 {
-    int i, j, n;
-    v16 *p, *q, *r, **data = (v16**)idata;
+    int i, j;
+    v16 *p, *q, *r;
 
-    assert(nblocks > 3);
-    assert(blocksize % 16 == 0);
-    n = nblocks - 3;  // # data blocks
     p = data[n];
     q = data[n+1];
     r = data[n+2];
-    for (i = 0; i < blocksize/sizeof(v16); i++) {
+    for (i = start; i < end; i++) {
         p[i] = q[i] = r[i] = data[n-1][i];
         for (j = n-2; j >= 0; j--) {
             p[i] ^= data[j][i];
@@ -57,3 +70,156 @@ rs_encode(int nblocks, int blocksize, void **idata)
         }
     }
 }
+
+static void
+rs_encode_default(int n, int blocksize, void **data)
+{
+    rs_encode16(n, 0, blocksize/sizeof(v16), (v16**)data);
+}
+
+#ifdef LIBRS_USE_RUNTIME_DISPATCH
+
+/*
+ * The blocks are only required to be 16 byte aligned, therefore the wide
+ * vector types alignment is reduced to 16 in order to use unaligned loads
+ * and stores.
+ */
+#define RS_DEFINE_WIDE_ENCODER(name, width, isa)                              \
+typedef uint8_t name##_v __attribute__ ((vector_size (width), aligned (16))); \
+typedef int8_t  name##_s __attribute__ ((vector_size (width), aligned (16))); \
+                                                                              \
+static inline __attribute__ ((target (isa))) name##_v                         \
+name##_mul2(name##_v v)                                                       \
+{                                                                             \
+    const name##_s zero = {0};                                                \
+    name##_v       vv   = v + v;                                              \
+    vv ^= (name##_v)((name##_s)v < zero) & (uint8_t)0x1d;                     \
+    return vv;                                                                \
+}                                                                             \
+                                                                              \
+static __attribute__ ((target (isa))) void                                    \
+name(int n, int blocksize, void **idata)                                      \
+{                                                                             \
+    name##_v   **data = (name##_v**)idata;                                    \
+    name##_v   *p, *q, *r;                                                    \
+    const int  cnt    = blocksize / width;                                    \
+    int        i, j;                                                          \
+                                                                              \
+    p = data[n];                                                              \
+    q = data[n+1];                                                            \
+    r = data[n+2];                                                            \
+    for (i = 0; i < cnt; i++) {                                               \
+        name##_v pp, qq, rr;                                                  \
+        pp = qq = rr = data[n-1][i];                                          \
+        for (j = n-2; j >= 0; j--) {                                          \
+            const name##_v d = data[j][i];                                    \
+            pp ^= d;                                                          \
+            qq = name##_mul2(qq) ^ d;                                         \
+            rr = name##_mul2(name##_mul2(rr)) ^ d;                            \
+        }                                                                     \
+        p[i] = pp;                                                            \
+        q[i] = qq;                                                            \
+        r[i] = rr;                                                            \
+    }                                                                         \
+    /* Encode the remaining tail with 16 byte vectors. */                     \
+    rs_encode16(n, cnt * (width / sizeof(v16)), blocksize / sizeof(v16),      \
+        (v16**)idata);                                                        \
+}
+
+RS_DEFINE_WIDE_ENCODER(rs_encode_avx2,     32, "avx2")
+#ifdef LIBRS_USE_AVX512
+RS_DEFINE_WIDE_ENCODER(rs_encode_avx512bw, 64, "avx512f,avx512bw")
+#endif
+
+#endif /* LIBRS_USE_RUNTIME_DISPATCH */
+
+typedef void (*rs_encode_kernel)(int n, int blocksize, void **data);
+
+static const struct
+{
+    const char*      name;
+    rs_encode_kernel kernel;
+} rs_encode_kernels[] = {
+#ifdef LIBRS_USE_AVX512
+    { "avx512bw", &rs_encode_avx512bw },
+#endif
+#ifdef LIBRS_USE_RUNTIME_DISPATCH
+    { "avx2",     &rs_encode_avx2     },
+#endif
+    { "default",  &rs_encode_default  }
+};
+
+#define RS_ENCODE_KERNEL_COUNT \
+    ((int)(sizeof(rs_encode_kernels) / sizeof(rs_encode_kernels[0])))
+
+/* Index into rs_encode_kernels, or -1 if not selected yet. */
+static volatile int rs_encode_kernel_idx = -1;
+
+static int
+rs_encode_kernel_supported(int idx)
+{
+#ifdef LIBRS_USE_RUNTIME_DISPATCH
+    const char* const name = rs_encode_kernels[idx].name;
+
+    __builtin_cpu_init();
+#ifdef LIBRS_USE_AVX512
+    if (strcmp(name, "avx512bw") == 0)
+        return (__builtin_cpu_supports("avx512f") &&
+            __builtin_cpu_supports("avx512bw"));
+#endif
+    if (strcmp(name, "avx2") == 0)
+        return __builtin_cpu_supports("avx2");
+#endif
+    return strcmp(rs_encode_kernels[idx].name, "default") == 0;
+}
+
+static int
+rs_encode_get_kernel_idx(void)
+{
+    int idx = rs_encode_kernel_idx;
+
+    if (idx < 0) {
+        /* The kernels are ordered by preference. */
+        for (idx = 0; idx < RS_ENCODE_KERNEL_COUNT - 1; idx++)
+            if (rs_encode_kernel_supported(idx))
+                break;
+        rs_encode_kernel_idx = idx;
+    }
+    return idx;
+}
+
+const char*
+rs_get_encode_kernel(void)
+{
+    return rs_encode_kernels[rs_encode_get_kernel_idx()].name;
+}
+
+int
+rs_set_encode_kernel(const char *name)
+{
+    int i;
+
+    for (i = 0; i < RS_ENCODE_KERNEL_COUNT; i++)
+        if (strcmp(rs_encode_kernels[i].name, name) == 0) {
+            if (! rs_encode_kernel_supported(i))
+                return -1;
+            rs_encode_kernel_idx = i;
+            return 0;
+        }
+    return -1;
+}
+
+/*
+ * Reed-Solomon n+3 encoder.
+ * nblocks is `n' data blocks plus 3 syndrome blocks.  blocksize _must_
+ * be a multiple of 16.  data contains pointers to blocks.  The first
+ * n are input data blocks.  The last 3 are the P, Q, and R syndromes.
+ */
+void
+rs_encode(int nblocks, int blocksize, void **data)
+{
+    assert(nblocks > 3);
+    assert(blocksize % 16 == 0);
+    rs_encode_kernels[rs_encode_get_kernel_idx()].kernel(
+        nblocks - 3, blocksize, data);
+}
@@ -41,6 +41,15 @@ void rs_decode1(int nblocks, int blocksize, int x, void **data);
 void rs_decode2(int nblocks, int blocksize, int x, int y, void **data);
 void rs_decode3(int nblocks, int blocksize, int x, int y, int z, void **data);
 
+/*
+ * The encoder implementation is selected at run time based on the cpu
+ * features. Returns the selected encoder name: "avx512bw", "avx2", or
+ * "default" for the implementation chosen at compile time.
+ */
+const char* rs_get_encode_kernel(void);
+/* Returns 0 on success, or -1 if not supported by the cpu or the build. */
+int rs_set_encode_kernel(const char *name);
+
 #ifdef __cplusplus
 }
 #endif
@@ -59,6 +59,9 @@ mkrand(void *buf, int size)
         p[i] = rand();
 }
 
+static const char* const kernels[] = { "default", "avx2", "avx512bw" };
+#define NKERNELS ((int)(sizeof(kernels) / sizeof(kernels[0])))
+
 void *data[RS_LIB_MAX_DATA_BLOCKS+3];
 void *orig[RS_LIB_MAX_DATA_BLOCKS+3];
 
@@ -82,6 +85,8 @@ int main(int argc, char **argv)
         printf("0 < data blocks <= %d\n", RS_LIB_MAX_DATA_BLOCKS);
         return 1;
     }
+    const char* const kernel = rs_get_encode_kernel();
+    printf("encoder: %s\n", kernel);
 
     for (i = 0; i < N+3; i++) {
         if ((err = posix_memalign(data + i, 16, BLOCKSIZE)) ||
@@ -99,14 +104,19 @@ int main(int argc, char **argv)
         n = atoi(argv[3]);
         for (i = 0; i < N+3; i++)
             mkrand(data[i], BLOCKSIZE);
-        clk = clock();
-        for (i = 0; i < n; i++)
-            rs_encode(N+3, BLOCKSIZE, data);
-        clk = clock() - clk;
-        printf("encode %.3e clocks %.3e sec %.3e bytes/sec\n",
-            (double)clk, (double)clk/CLOCKS_PER_SEC,
-            BLOCKSIZE * N * (double)CLOCKS_PER_SEC * n /
-                ((double)clk > 0 ? (double)clk : 1e-10));
+        for (k = 0; k < NKERNELS; k++) {
+            if (rs_set_encode_kernel(kernels[k]) != 0)
+                continue;
+            clk = clock();
+            for (i = 0; i < n; i++)
+                rs_encode(N+3, BLOCKSIZE, data);
+            clk = clock() - clk;
+            printf("encode %-8s %.3e clocks %.3e sec %.3e bytes/sec\n",
+                kernels[k], (double)clk, (double)clk/CLOCKS_PER_SEC,
+                BLOCKSIZE * N * (double)CLOCKS_PER_SEC * n /
+                    ((double)clk > 0 ? (double)clk : 1e-10));
+        }
+        rs_set_encode_kernel(kernel);
         for (i = N - (3 < N ? 3 : 0); i < N; i++) {
             for (j = i + 1; j < N + 3; j++) {
                 for (k = j + 1; k < N + 3; k++) {
@@ -157,6 +167,20 @@ int main(int argc, char **argv)
         for (i = 0; i < N+3; i++)
             memmove(orig[i], data[i], BLOCKSIZE);
 
+        // All supported encoders must produce the same syndromes.
+        for (k = 0; k < NKERNELS; k++) {
+            if (rs_set_encode_kernel(kernels[k]) != 0)
+                continue;
+            for (i = N; i < N+3; i++)
+                memset(data[i], 0, BLOCKSIZE);
+            rs_encode(N+3, BLOCKSIZE, data);
+            if (compare(N+3, BLOCKSIZE, data, orig) != 0) {
+                printf("FAILED: %d encoder %s\n", n, kernels[k]);
+                return 1;
+            }
+        }
+        rs_set_encode_kernel(kernel);
+
         // One missing block
         for (i = 0; i < N+3; i++) {
             memset(data[i], 0, BLOCKSIZE);
@@ -35,10 +35,11 @@ extern "C" {
   struct QFS;
 
   enum qfs_striper_type {
-      KFS_STRIPED_FILE_TYPE_UNKNOWN     = 0,
-      KFS_STRIPED_FILE_TYPE_NONE        = 1,
-      KFS_STRIPED_FILE_TYPE_RS          = 2,
-      KFS_STRIPED_FILE_TYPE_RS_JERASURE = 3
+      KFS_STRIPED_FILE_TYPE_UNKNOWN      = 0,
+      KFS_STRIPED_FILE_TYPE_NONE         = 1,
+      KFS_STRIPED_FILE_TYPE_RS           = 2,
+      KFS_STRIPED_FILE_TYPE_RS_JERASURE  = 3,
+      KFS_STRIPED_FILE_TYPE_LRC_JERASURE = 4
   };
 
 // From KfsClient.h
@@ -176,6 +177,12 @@ extern "C" {
   int qfs_stat(struct QFS* qfs, const char* path, struct qfs_attr* attr);
   int qfs_stat_fd(struct QFS* qfs, int fd, struct qfs_attr* attr);
 
+  // qfs_stat_batch provides the qfs_attr for each of count paths, and sets
+  // status[i] to 0 or -errno. Returns the number of paths that were
+  // successfully stat'ed, or -errno if the parameters are invalid.
+  int qfs_stat_batch(struct QFS* qfs, const char** paths, int count,
+    struct qfs_attr* attrs, int* status);
+
   // Omitted GetNumChunks in favor of call to Stat
 
   ssize_t qfs_get_chunksize(struct QFS* qfs, const char* path);
@@ -251,6 +258,63 @@ extern "C" {
   // file position.
   ssize_t qfs_pwrite(struct QFS* qfs, int fd, const void *buf, size_t len, off_t offset);
 
+  // qfs_read_range describes one range of a vectored read.
+  struct qfs_read_range {
+    off_t   offset;  // [in] file position
+    size_t  len;     // [in] number of bytes to read
+    void*   buf;     // [in] buffer to read into
+    ssize_t status;  // [out] number of bytes read, or -errno
+  };
+
+  // qfs_preadv reads count ranges from fd without updating the current file
+  // position. The adjacent ranges are coalesced, and all reads are issued in
+  // parallel. The call blocks until all reads complete, and returns the total
+  // number of bytes read, or -errno if any of the reads failed. The status of
+  // each range is set to the number of bytes read, which can be less than len
+  // at the end of file, or to -errno.
+  ssize_t qfs_preadv(struct QFS* qfs, int fd, struct qfs_read_range* ranges, int count);
+
+  // qfs_aio_queue is an opaque completion queue for asynchronous reads and
+  // writes. The queue allows a single thread to keep many requests in flight.
+  struct qfs_aio_queue;
+
+  // qfs_aio_completion is the result of an asynchronous request.
+  struct qfs_aio_completion {
+    void*   tag;     // tag passed to qfs_aread or qfs_awrite
+    ssize_t status;  // number of bytes read or written, or -errno
+  };
+
+  // qfs_aio_queue_create creates a completion queue, returning NULL on error.
+  struct qfs_aio_queue* qfs_aio_queue_create(struct QFS* qfs);
+
+  // qfs_aio_queue_destroy waits for all requests in flight to complete,
+  // discards all completions not yet returned by qfs_aio_wait, and frees
+  // the queue. The queue must be destroyed before the QFS handle is released.
+  void qfs_aio_queue_destroy(struct qfs_aio_queue* queue);
+
+  // qfs_aread/qfs_awrite queue a read or write of len bytes into or from buf
+  // at offset, without updating the current file position. The buffer must
+  // not be accessed, or for writes modified, until the request completion is
+  // returned by qfs_aio_wait. The return value is the number of bytes queued,
+  // which can be less than len at the end of file for reads, or 0 if nothing
+  // was queued, or -errno on failure. The completion is reported only if the
+  // return value is positive.
+  ssize_t qfs_aread(struct qfs_aio_queue* queue, int fd,
+    void* buf, size_t len, off_t offset, void* tag);
+  ssize_t qfs_awrite(struct qfs_aio_queue* queue, int fd,
+    const void* buf, size_t len, off_t offset, void* tag);
+
+  // qfs_aio_wait waits up to timeout_ms milliseconds, or indefinitely if
+  // negative, for at least one request to complete, and writes up to count
+  // completions. Returns the number of completions written, which is 0 on
+  // timeout, or if no requests are in flight.
+  int qfs_aio_wait(struct qfs_aio_queue* queue,
+    struct qfs_aio_completion* completions, int count, int timeout_ms);
+
+  // qfs_aio_inflight returns the number of requests that have been queued,
+  // but not yet returned by qfs_aio_wait.
+  int qfs_aio_inflight(struct qfs_aio_queue* queue);
+
   // qfs_set_skipholes instructs the client to skip holes when reading fd.
   void qfs_set_skipholes(struct QFS* qfs, int fd);
 
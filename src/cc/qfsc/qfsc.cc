@@ -1,5 +1,7 @@
 
 #include "libclient/KfsClient.h"
+#include "qcdio/QCMutex.h"
+#include "qcdio/qcstutils.h"
 #include "qfs.h"
 
 #include <vector>
@@ -280,6 +282,28 @@ int qfs_stat_fd(struct QFS* qfs, int fd, struct qfs_attr* attr) {
   return res;
 }
 
+int qfs_stat_batch(struct QFS* qfs, const char** paths, int count,
+    struct qfs_attr* attrs, int* status) {
+  if(count < 0 || (0 < count && (!paths || !attrs || !status))) {
+    return -EINVAL;
+  }
+
+  // The meta server requests issued by a client instance are serialized, the
+  // batch saves the per call overhead, and reports the per path status.
+  int ok = 0;
+  KfsFileAttr kfsAttrs;
+  for(int i = 0; i < count; i++) {
+    status[i] = qfs->client.Stat(paths[i], kfsAttrs);
+    if(status[i] < 0) {
+      memset(&attrs[i], 0, sizeof(attrs[i]));
+      continue;
+    }
+    qfs_attr_from_KfsFileAttr(&attrs[i], kfsAttrs);
+    ok++;
+  }
+  return ok;
+}
+
 ssize_t qfs_get_chunksize(struct QFS* qfs, const char* path) {
   return KFS::CHUNKSIZE;
 }
@@ -349,6 +373,186 @@ ssize_t qfs_pread(struct QFS* qfs, int fd, void *buf, size_t len, off_t offset)
 }
 
 
+ssize_t qfs_preadv(struct QFS* qfs, int fd, struct qfs_read_range* ranges, int count) {
+  if(count <= 0) {
+    return count < 0 ? -EINVAL : 0;
+  }
+  if(!ranges) {
+    return -EINVAL;
+  }
+
+  vector<KfsClient::ReadRange> kfsRanges(count);
+  for(int i = 0; i < count; i++) {
+    kfsRanges[i].pos    = ranges[i].offset;
+    kfsRanges[i].size   = ranges[i].len;
+    kfsRanges[i].buf    = (char*) ranges[i].buf;
+    kfsRanges[i].status = 0;
+  }
+
+  const ssize_t res = qfs->client.ReadV(fd, &kfsRanges[0], count);
+  for(int i = 0; i < count; i++) {
+    ranges[i].status = kfsRanges[i].status;
+  }
+  return res;
+}
+
+// qfs_aio_queue keeps the number of requests in flight, and the list of
+// completed requests. The completions are invoked by the client's io thread,
+// and must not block, therefore the completed requests are only queued there.
+struct qfs_aio_queue {
+  struct request :
+    public KfsClient::ReadCompletion,
+    public KfsClient::WriteCompletion {
+    request(qfs_aio_queue& q, void* t)
+      : queue(q), tag(t), status(0), next(NULL) {}
+
+    virtual void Done(int64_t s) {
+      queue.done(*this, s);
+    }
+
+    qfs_aio_queue& queue;
+    void*          tag;
+    int64_t        status;
+    request*       next;
+  };
+
+  qfs_aio_queue(struct QFS* q)
+    : qfs(q), mutex(), cond(), running(0), completed(0),
+      head(NULL), tail(NULL) {}
+
+  ~qfs_aio_queue() {
+    QCStMutexLocker lock(mutex);
+    while(0 < running) {
+      cond.Wait(mutex);
+    }
+    while(head) {
+      request* const req = head;
+      head = req->next;
+      delete req;
+    }
+    tail = NULL;
+  }
+
+  request* create(void* tag) {
+    QCStMutexLocker lock(mutex);
+    running++;
+    return new request(*this, tag);
+  }
+
+  // The request was not queued, and its completion will not be invoked.
+  void cancel(request* req) {
+    QCStMutexLocker lock(mutex);
+    running--;
+    delete req;
+  }
+
+  void done(request& req, int64_t s) {
+    QCStMutexLocker lock(mutex);
+    req.status = s;
+    if(tail) {
+      tail->next = &req;
+    } else {
+      head = &req;
+    }
+    tail = &req;
+    running--;
+    completed++;
+    cond.NotifyAll();
+  }
+
+  int wait(struct qfs_aio_completion* completions, int count, int timeout_ms) {
+    QCStMutexLocker lock(mutex);
+    if(!head && 0 < running && 0 < count && timeout_ms != 0) {
+      if(timeout_ms < 0) {
+        while(!head && 0 < running) {
+          cond.Wait(mutex);
+        }
+      } else {
+        cond.Wait(mutex, QCMutex::Time(timeout_ms) * 1000 * 1000);
+      }
+    }
+    int n = 0;
+    while(n < count && head) {
+      request* const req = head;
+      head = req->next;
+      if(!head) {
+        tail = NULL;
+      }
+      completions[n].tag    = req->tag;
+      completions[n].status = (ssize_t) req->status;
+      n++;
+      completed--;
+      delete req;
+    }
+    return n;
+  }
+
+  struct QFS* const qfs;
+  QCMutex           mutex;
+  QCCondVar         cond;
+  int               running;    // queued, but not yet completed
+  int               completed;  // completed, but not yet returned by wait
+  request*          head;
+  request*          tail;
+};
+
+struct qfs_aio_queue* qfs_aio_queue_create(struct QFS* qfs) {
+  if(!qfs) {
+    return NULL;
+  }
+  return new qfs_aio_queue(qfs);
+}
+
+void qfs_aio_queue_destroy(struct qfs_aio_queue* queue) {
+  if(queue) {
+    delete queue;
+  }
+}
+
+ssize_t qfs_aread(struct qfs_aio_queue* queue, int fd,
+    void* buf, size_t len, off_t offset, void* tag) {
+  if(!queue) {
+    return -EINVAL;
+  }
+  qfs_aio_queue::request* const req = queue->create(tag);
+  const ssize_t res = queue->qfs->client.ReadAsync(
+    fd, offset, (char*) buf, len, *req);
+  if(res <= 0) {
+    queue->cancel(req);
+  }
+  return res;
+}
+
+ssize_t qfs_awrite(struct qfs_aio_queue* queue, int fd,
+    const void* buf, size_t len, off_t offset, void* tag) {
+  if(!queue) {
+    return -EINVAL;
+  }
+  qfs_aio_queue::request* const req = queue->create(tag);
+  const ssize_t res = queue->qfs->client.WriteAsync(
+    fd, offset, (const char*) buf, len, *req);
+  if(res <= 0) {
+    queue->cancel(req);
+  }
+  return res;
+}
+
+int qfs_aio_wait(struct qfs_aio_queue* queue,
+    struct qfs_aio_completion* completions, int count, int timeout_ms) {
+  if(!queue || count < 0 || (0 < count && !completions)) {
+    return -EINVAL;
+  }
+  return queue->wait(completions, count, timeout_ms);
+}
+
+int qfs_aio_inflight(struct qfs_aio_queue* queue) {
+  if(!queue) {
+    return -EINVAL;
+  }
+  QCStMutexLocker lock(queue->mutex);
+  return queue->running + queue->completed;
+}
+
 ssize_t qfs_write(struct QFS* qfs, int fd, const void* buf, size_t len) {
     return qfs->client.Write(fd, (char*) buf, len);
 }
@@ -301,6 +301,80 @@ static char* test_qfs_pread() {
   return 0;
 }
 
+static char* test_qfs_preadv() {
+  ssize_t chunksize = qfs_get_chunksize(qfs, "/unit-test/file");
+  char head[16];
+  char tail[4096];
+  struct qfs_read_range ranges[2];
+  ssize_t res;
+  int i;
+
+  memset(tail, 0, sizeof(tail));
+  ranges[0].offset = 0;
+  ranges[0].len    = sizeof(head);
+  ranges[0].buf    = head;
+  ranges[1].offset = chunksize*2;
+  ranges[1].len    = sizeof(tail);
+  ranges[1].buf    = tail;
+  check_qfs_call(res = qfs_preadv(qfs, fd, ranges, 2));
+  check(res == (ssize_t)(sizeof(head) + strlen(testdata)),
+    "unexpected total bytes read: %ld", (long)res);
+  check(ranges[0].status == sizeof(head),
+    "unexpected first range status: %ld", (long)ranges[0].status);
+  for(i = 0; i < (int)sizeof(head); i++) {
+    check(head[i] == (char)i, "unexpected data at %d", i);
+  }
+  check(strcmp(tail, testdata) == 0,
+    "expected data should be read: %s != %s", tail, testdata);
+
+  return 0;
+}
+
+static char* test_qfs_aio() {
+  ssize_t chunksize = qfs_get_chunksize(qfs, "/unit-test/file");
+  struct qfs_aio_queue* queue = qfs_aio_queue_create(qfs);
+  struct qfs_aio_completion completion;
+  char buf[4096];
+  ssize_t res;
+  int n;
+
+  check(queue, "queue should be non null");
+  memset(buf, 0, sizeof(buf));
+  check_qfs_call(res = qfs_aread(queue, fd, buf, sizeof(buf), chunksize*2, buf));
+  check(res == (ssize_t)strlen(testdata), "unexpected bytes queued: %ld",
+    (long)res);
+  check(qfs_aio_inflight(queue) == 1, "one request should be in flight");
+  check_qfs_call(n = qfs_aio_wait(queue, &completion, 1, -1));
+  check(n == 1, "one request should complete: %d", n);
+  check(completion.tag == buf, "completion should have request tag");
+  check(completion.status == res, "unexpected bytes read: %ld",
+    (long)completion.status);
+  check(strcmp(buf, testdata) == 0,
+    "expected data should be read: %s != %s", buf, testdata);
+  check(qfs_aio_inflight(queue) == 0, "no requests should be in flight");
+  check(qfs_aio_wait(queue, &completion, 1, -1) == 0,
+    "wait with no requests in flight should not block");
+  qfs_aio_queue_destroy(queue);
+
+  return 0;
+}
+
+static char* test_qfs_stat_batch() {
+  const char* paths[] = { "/unit-test", "/unit-test/file", "/unit-test/none" };
+  struct qfs_attr attrs[3];
+  int status[3];
+  int res;
+
+  check_qfs_call(res = qfs_stat_batch(qfs, paths, 3, attrs, status));
+  check(res == 2, "two paths should exist: %d", res);
+  check(status[0] == 0 && attrs[0].directory, "first path should be directory");
+  check(status[1] == 0 && strcmp(attrs[1].filename, "file") == 0,
+    "second path should be file: %s", attrs[1].filename);
+  check(status[2] < 0, "third path should not exist");
+
+  return 0;
+}
+
 static char* test_qfs_get_data_locations() {
   check_qfs_call(qfs_close(qfs, fd)); // shut it down
   struct qfs_iter* iter = NULL;
@@ -366,6 +440,9 @@ static char * all_tests() {
   run(test_qfs_close);
   run(test_qfs_open);
   run(test_qfs_pread);
+  run(test_qfs_preadv);
+  run(test_qfs_aio);
+  run(test_qfs_stat_batch);
   run(test_qfs_get_data_locations);
   run(test_qfs_cleanup);
   run(test_qfs_release);
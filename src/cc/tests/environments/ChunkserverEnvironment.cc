@@ -19,19 +19,22 @@ using namespace std;
 using boost::lexical_cast;
 
 ChunkserverEnvironment::ChunkserverEnvironment(const MetaserverEnvironment* m)
-    : mMetaserverPort(m->GetChunkserverPort())
+    : mMetaserver(m)
     , mClientPort(-1)
 { }
 
 string
 ChunkserverEnvironment::GenerateConfig()
 {
+    // The metaserver environment selects its ports at start, which happens
+    // after all the environments are constructed, thus get the port here.
+    const uint16_t metaserverPort = mMetaserver->GetChunkserverPort();
     mClientPort = QFSTestUtils::GetRandomPort(SOCK_STREAM, "127.0.0.1");
     mChunkDir = QFSTestUtils::CreateTempDirectory();
 
     map<string, string> c;
     c["chunkServer.metaServer.hostname"] = "localhost";
-    c["chunkServer.metaServer.port"] = lexical_cast<string>(mMetaserverPort);
+    c["chunkServer.metaServer.port"] = lexical_cast<string>(metaserverPort);
     c["chunkServer.clientPort"] = lexical_cast<string>(mClientPort);
     c["chunkServer.chunkDir"] = mChunkDir;
     c["chunkServer.clusterKey"] = "some-random-unique-identifier";
@@ -50,7 +50,7 @@ protected:
     virtual bool Start();
 
 private:
-    uint16_t mMetaserverPort;
+    const MetaserverEnvironment* mMetaserver;
     uint16_t mClientPort;
     string mChunkDir;
 };
@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -75,10 +76,13 @@ main(int argc, char **argv)
     testing::InitGoogleTest(&argc, argv);
 
     static const int kNumChunkServers = 3;
-    QFSTest::Init(kNumChunkServers);
+    const char* numChunkServersStr = getenv("QFS_TEST_CHUNKSERVERS");
+    const int numChunkServers = numChunkServersStr != NULL ?
+        max(1, atoi(numChunkServersStr)) : kNumChunkServers;
+    QFSTest::Init(numChunkServers);
 
     testing::AddGlobalTestEnvironment(QFSTest::sMetaserver);
-    for (unsigned int i = 0; i < kNumChunkServers; i++) {
+    for (int i = 0; i < numChunkServers; i++) {
         testing::AddGlobalTestEnvironment(QFSTest::sChunkservers[i]);
     }
 
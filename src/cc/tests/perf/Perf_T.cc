@@ -0,0 +1,404 @@
+#include <gtest/gtest.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "common/Properties.h"
+#include "common/time.h"
+#include "libclient/KfsClient.h"
+#include "tests/environments/MetaserverEnvironment.h"
+#include "tests/integtest.h"
+
+namespace KFS {
+namespace Test {
+
+using namespace std;
+
+/**
+ * The workloads below are fixed, in order for their results to be comparable
+ * with the stored baseline. Changing any of these invalidates the baseline.
+ */
+static const int     kIoSize             = 1 << 20;
+static const int     kFileCount          = 8;
+static const int64_t kFileSize           = int64_t(16) << 20;
+static const int     kAppendRecordSize   = 64 << 10;
+static const int     kAppendRecordCount  = 512;
+static const int     kMetaOpCount        = 1000;
+static const int     kChunkserverWaitSec = 60;
+static const double  kDefaultTolerance   = 0.25;
+static const string  kPerfDir            = "/perf";
+
+/**
+ * The baseline file path. The baseline is a "key = value" file, in the same
+ * format as the results file, i.e. the results of a known good run can be
+ * stored as the baseline as is. With no baseline the performance assertions
+ * are skipped, and only the functional checks are done.
+ */
+static const char* const kBaselineEnvironmentVariable = "QFS_PERF_BASELINE";
+
+/**
+ * The results file path. The results are written at the end of the test run.
+ */
+static const char* const kResultsEnvironmentVariable = "QFS_PERF_RESULTS";
+
+/**
+ * The allowed regression, as a fraction of the baseline value, e.g. 0.25
+ * fails the test if the throughput is 25% lower, or if the p99 latency is 25%
+ * higher than the baseline. Can also be set per workload in the baseline
+ * file with <workload>.tolerance key.
+ */
+static const char* const kToleranceEnvironmentVariable = "QFS_PERF_TOLERANCE";
+
+/**
+ * PerfStats accumulates the per op latencies and the number of bytes
+ * transferred by a single workload run.
+ */
+class PerfStats
+{
+public:
+    PerfStats(const string& name)
+        : mName(name)
+        , mLatencies()
+        , mBytes(0)
+        , mStartUsec(microseconds())
+        , mEndUsec(mStartUsec)
+    { }
+
+    void Add(int64_t latencyUsec, int64_t bytes)
+    {
+        mLatencies.push_back(latencyUsec);
+        mBytes += bytes;
+    }
+
+    void Stop() { mEndUsec = microseconds(); }
+
+    const string& GetName() const { return mName; }
+
+    size_t GetOpCount() const { return mLatencies.size(); }
+
+    int64_t GetBytes() const { return mBytes; }
+
+    /**
+     * @return MB/s for data workloads, and ops/s for metadata workloads
+     */
+    double GetThroughput() const
+    {
+        const double secs = max(int64_t(1), mEndUsec - mStartUsec) * 1e-6;
+        return (mBytes > 0 ? mBytes / (1024. * 1024.) : mLatencies.size())
+            / secs;
+    }
+
+    int64_t GetPercentileUsec(double percentile) const
+    {
+        if (mLatencies.empty()) {
+            return 0;
+        }
+
+        vector<int64_t> latencies(mLatencies);
+        const size_t idx = min(latencies.size() - 1,
+            size_t(latencies.size() * percentile / 100.));
+        nth_element(latencies.begin(), latencies.begin() + idx,
+            latencies.end());
+        return latencies[idx];
+    }
+
+private:
+    string mName;
+    vector<int64_t> mLatencies;
+    int64_t mBytes;
+    int64_t mStartUsec;
+    int64_t mEndUsec;
+};
+
+/**
+ * QFSPerfTest runs fixed read, write, record append, and metadata workloads
+ * against the metaserver and chunkservers started by the test environments,
+ * and fails if the throughput or the p99 latency regresses beyond the
+ * tolerance relative to the stored baseline.
+ */
+class QFSPerfTest : public QFSTest
+{
+public:
+    static void SetUpTestCase()
+    {
+        sClient = Connect(sMetaserver->GetHostname(),
+            sMetaserver->GetClientPort());
+        ASSERT_TRUE(sClient != NULL) << "Could not connect to the metaserver";
+        ASSERT_EQ(0, sClient->Mkdirs(kPerfDir.c_str()));
+
+        sReplicas = max(1, min(3, int(sChunkservers.size())));
+
+        const char* baseline = getenv(kBaselineEnvironmentVariable);
+        if (baseline != NULL && *baseline != 0) {
+            ASSERT_EQ(0, sBaseline.loadProperties(baseline, '='))
+                << "Could not load baseline: " << baseline;
+            cout << "perf baseline: " << baseline << endl;
+        }
+        else {
+            cout << "perf baseline is not set, performance assertions are"
+                " disabled" << endl;
+        }
+
+        const char* tolerance = getenv(kToleranceEnvironmentVariable);
+        sTolerance = tolerance != NULL ? atof(tolerance) : kDefaultTolerance;
+
+        WaitForChunkservers();
+    }
+
+    static void TearDownTestCase()
+    {
+        const char* results = getenv(kResultsEnvironmentVariable);
+        if (results != NULL && *results != 0) {
+            ofstream out(results);
+            for (map<string, double>::const_iterator itr = sResults.begin();
+                    itr != sResults.end(); ++itr) {
+                out << itr->first << " = " << itr->second << "\n";
+            }
+            EXPECT_TRUE(out.good()) << "Could not write results: " << results;
+        }
+
+        if (sClient != NULL) {
+            sClient->Rmdirs(kPerfDir.c_str());
+            delete sClient;
+            sClient = NULL;
+        }
+    }
+
+protected:
+    /**
+     * The chunkservers connect to the metaserver asynchronously after their
+     * start. Retry writing a small file until the write succeeds.
+     */
+    static void WaitForChunkservers()
+    {
+        const string path = kPerfDir + "/wait";
+        const time_t deadline = time(NULL) + kChunkserverWaitSec;
+        int status = -1;
+        while (status != 0 && time(NULL) < deadline) {
+            const int fd = sClient->Create(path.c_str(), sReplicas);
+            if (fd < 0) {
+                status = fd;
+            }
+            else {
+                status = sClient->Write(fd, "x", 1) == 1 ? 0 : -EIO;
+                const int closeStatus = sClient->Close(fd);
+                if (status == 0) {
+                    status = closeStatus;
+                }
+            }
+            if (status != 0) {
+                sleep(1);
+            }
+        }
+        sClient->Remove(path.c_str());
+        ASSERT_EQ(0, status) << "Chunkservers are not available: "
+            << ErrorCodeToStr(status);
+    }
+
+    static string GetFilePath(int i)
+    {
+        ostringstream oss;
+        oss << kPerfDir << "/file." << i;
+        return oss.str();
+    }
+
+    static void WriteFiles(PerfStats* stats)
+    {
+        const string buf(kIoSize, 'w');
+        for (int i = 0; i < kFileCount; i++) {
+            const string path = GetFilePath(i);
+            const int fd = sClient->Create(path.c_str(), sReplicas);
+            ASSERT_LE(0, fd) << path << ": " << ErrorCodeToStr(fd);
+            for (int64_t pos = 0; pos < kFileSize; pos += kIoSize) {
+                const int64_t start = microseconds();
+                const ssize_t ret = sClient->Write(fd, buf.data(), kIoSize);
+                ASSERT_EQ(ssize_t(kIoSize), ret)
+                    << path << ": " << ErrorCodeToStr((int)ret);
+                if (stats != NULL) {
+                    stats->Add(microseconds() - start, ret);
+                }
+            }
+            const int64_t start = microseconds();
+            const int status = sClient->Close(fd);
+            ASSERT_EQ(0, status) << path << ": " << ErrorCodeToStr(status);
+            if (stats != NULL) {
+                stats->Add(microseconds() - start, 0);
+            }
+        }
+        sFilesWritten = true;
+    }
+
+    /**
+     * Record the results, and compare these with the baseline, if one is set.
+     */
+    static void Check(PerfStats& stats)
+    {
+        stats.Stop();
+
+        const string& name = stats.GetName();
+        const double throughput = stats.GetThroughput();
+        const double p99 = (double)stats.GetPercentileUsec(99);
+
+        cout << "perf " << name
+            << ": ops: " << stats.GetOpCount()
+            << " bytes: " << stats.GetBytes()
+            << " throughput: " << throughput
+            << (stats.GetBytes() > 0 ? " MB/s" : " ops/s")
+            << " p50: " << stats.GetPercentileUsec(50) << " usec"
+            << " p99: " << p99 << " usec"
+            << endl;
+
+        sResults[name + ".throughput"] = throughput;
+        sResults[name + ".p99Usec"] = p99;
+
+        if (sBaseline.empty()) {
+            return;
+        }
+
+        const double tolerance =
+            sBaseline.getValue(name + ".tolerance", sTolerance);
+        const double baseThroughput =
+            sBaseline.getValue(name + ".throughput", -1.);
+        if (baseThroughput > 0) {
+            EXPECT_GE(throughput, baseThroughput * (1. - tolerance))
+                << name << ": throughput regression, baseline: "
+                << baseThroughput;
+        }
+        const double baseP99 = sBaseline.getValue(name + ".p99Usec", -1.);
+        if (baseP99 > 0) {
+            EXPECT_LE(p99, baseP99 * (1. + tolerance))
+                << name << ": p99 latency regression, baseline: "
+                << baseP99 << " usec";
+        }
+    }
+
+    static KfsClient* sClient;
+    static int sReplicas;
+    static bool sFilesWritten;
+    static double sTolerance;
+    static Properties sBaseline;
+    static map<string, double> sResults;
+};
+
+KfsClient* QFSPerfTest::sClient = NULL;
+int QFSPerfTest::sReplicas = 1;
+bool QFSPerfTest::sFilesWritten = false;
+double QFSPerfTest::sTolerance = kDefaultTolerance;
+Properties QFSPerfTest::sBaseline;
+map<string, double> QFSPerfTest::sResults;
+
+TEST_F(QFSPerfTest, Write)
+{
+    PerfStats stats("write");
+    WriteFiles(&stats);
+    Check(stats);
+}
+
+TEST_F(QFSPerfTest, Read)
+{
+    if (!sFilesWritten) {
+        WriteFiles(NULL);
+    }
+
+    PerfStats stats("read");
+    vector<char> buf(kIoSize);
+    for (int i = 0; i < kFileCount; i++) {
+        const string path = GetFilePath(i);
+        const int fd = sClient->Open(path.c_str(), O_RDONLY);
+        ASSERT_LE(0, fd) << path << ": " << ErrorCodeToStr(fd);
+        int64_t total = 0;
+        for (; ;) {
+            const int64_t start = microseconds();
+            const ssize_t ret = sClient->Read(fd, &buf[0], kIoSize);
+            ASSERT_LE(0, ret) << path << ": " << ErrorCodeToStr((int)ret);
+            if (ret == 0) {
+                break;
+            }
+            stats.Add(microseconds() - start, ret);
+            total += ret;
+        }
+        EXPECT_EQ(kFileSize, total) << path;
+        sClient->Close(fd);
+    }
+    Check(stats);
+}
+
+TEST_F(QFSPerfTest, RecordAppend)
+{
+    PerfStats stats("append");
+    const string path = kPerfDir + "/append";
+    const string buf(kAppendRecordSize, 'a');
+    const int fd = sClient->Open(path.c_str(),
+        O_CREAT | O_WRONLY | O_APPEND, sReplicas);
+    ASSERT_LE(0, fd) << path << ": " << ErrorCodeToStr(fd);
+    for (int i = 0; i < kAppendRecordCount; i++) {
+        const int64_t start = microseconds();
+        const int ret = sClient->AtomicRecordAppend(
+            fd, buf.data(), kAppendRecordSize);
+        ASSERT_EQ(kAppendRecordSize, ret) << path << ": "
+            << ErrorCodeToStr(ret);
+        stats.Add(microseconds() - start, ret);
+    }
+    const int64_t start = microseconds();
+    const int status = sClient->Close(fd);
+    ASSERT_EQ(0, status) << path << ": " << ErrorCodeToStr(status);
+    stats.Add(microseconds() - start, 0);
+    Check(stats);
+}
+
+TEST_F(QFSPerfTest, Metadata)
+{
+    const string dir = kPerfDir + "/meta";
+    ASSERT_EQ(0, sClient->Mkdirs(dir.c_str()));
+
+    vector<string> paths;
+    for (int i = 0; i < kMetaOpCount; i++) {
+        ostringstream oss;
+        oss << dir << "/" << i;
+        paths.push_back(oss.str());
+    }
+
+    PerfStats create("create");
+    for (int i = 0; i < kMetaOpCount; i++) {
+        const int64_t start = microseconds();
+        const int fd = sClient->Create(paths[i].c_str(), sReplicas);
+        ASSERT_LE(0, fd) << paths[i] << ": " << ErrorCodeToStr(fd);
+        sClient->Close(fd);
+        create.Add(microseconds() - start, 0);
+    }
+    Check(create);
+
+    PerfStats stat("stat");
+    for (int i = 0; i < kMetaOpCount; i++) {
+        KfsFileAttr attr;
+        const int64_t start = microseconds();
+        const int status = sClient->Stat(paths[i].c_str(), attr);
+        ASSERT_EQ(0, status) << paths[i] << ": " << ErrorCodeToStr(status);
+        stat.Add(microseconds() - start, 0);
+    }
+    Check(stat);
+
+    PerfStats remove("remove");
+    for (int i = 0; i < kMetaOpCount; i++) {
+        const int64_t start = microseconds();
+        const int status = sClient->Remove(paths[i].c_str());
+        ASSERT_EQ(0, status) << paths[i] << ": " << ErrorCodeToStr(status);
+        remove.Add(microseconds() - start, 0);
+    }
+    Check(remove);
+}
+
+} // namespace Test
+} // namespace KFS
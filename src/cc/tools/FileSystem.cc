@@ -1452,6 +1452,41 @@ public:
     }
 };
 
+    static int
+CreateFs(
+    const string&     inScheme,
+    const string&     inAuthority,
+    const string&     inFsUri,
+    const Properties* inPropertiesPtr,
+    FileSystemImpl*&  outImplPtr)
+{
+    outImplPtr = 0;
+    int theRet = 0;
+    // Set user and group for all kfs clients: SetEUserAndEGroup() only has
+    // effect only when only one kfs client with no open files exists.
+    GetKfsClient(inPropertiesPtr);
+    if (inScheme == "qfs") {
+        KfsFileSystem* const theFsPtr = new KfsFileSystem(
+            inFsUri,
+            inPropertiesPtr && inPropertiesPtr->getValue(
+                "fs.readSkipHoles", 0) != 0,
+            inPropertiesPtr && inPropertiesPtr->getValue(
+                "fs.readFullSparseFileSupport", 0) != 0
+        );
+        if ((theRet = theFsPtr->Init(inAuthority, inPropertiesPtr)) == 0) {
+            outImplPtr = theFsPtr;
+        } else {
+            delete theFsPtr;
+        }
+    } else if (inScheme == "file") {
+        outImplPtr = new LocalFileSystem(inFsUri);
+    }
+    if (theRet == 0 && ! outImplPtr) {
+        theRet = -EINVAL;
+    }
+    return theRet;
+}
+
     static string&
 GetDefaultFsUri()
 {
@@ -1533,29 +1568,8 @@ FileSystem::Get(
         return 0;
     }
     FileSystemImpl* theImplPtr = 0;
-    int             theRet     = 0;
-    // Set user and group for all kfs clients: SetEUserAndEGroup() only has
-    // effect only when only one kfs client with no open files exists.
-    GetKfsClient(inPropertiesPtr);
-    if (theScheme == "qfs") {
-        KfsFileSystem* const theFsPtr = new KfsFileSystem(
-            theFsUri,
-            inPropertiesPtr && inPropertiesPtr->getValue(
-                "fs.readSkipHoles", 0) != 0,
-            inPropertiesPtr && inPropertiesPtr->getValue(
-                "fs.readFullSparseFileSupport", 0) != 0
-        );
-        if ((theRet = theFsPtr->Init(theAuthority, inPropertiesPtr)) == 0) {
-            theImplPtr = theFsPtr;
-        } else {
-            delete theFsPtr;
-        }
-    } else if (theScheme == "file") {
-        theImplPtr = new LocalFileSystem(theFsUri);
-    }
-    if (theRet == 0 && ! theImplPtr) {
-        theRet = -EINVAL;
-    }
+    const int       theRet     = CreateFs(
+        theScheme, theAuthority, theFsUri, inPropertiesPtr, theImplPtr);
     if (theRet == 0 &&
             ! sFSMap.insert(make_pair(theFsUri, theImplPtr)).second) {
         QCRTASSERT(! "fs map insertion: duplicate entry");
@@ -1564,6 +1578,39 @@ FileSystem::Get(
     return theRet;
 }
 
+    /* static */ int
+FileSystem::Create(
+    const string&     inUri,
+    FileSystem*&      outFsPtr,
+    const Properties* inPropertiesPtr /* = 0 */)
+{
+    outFsPtr = 0;
+    FileSystem* theFsPtr = 0;
+    int         theRet   = Get(inUri, theFsPtr, 0, inPropertiesPtr);
+    if (theRet != 0) {
+        return theRet;
+    }
+    QCStMutexLocker theLock(GetFsMutex());
+    // Get() returns canonical uri: <scheme>://<authority>
+    const string& theFsUri = theFsPtr->GetUri();
+    const size_t  thePos   = theFsUri.find("://");
+    if (thePos == string::npos) {
+        return -EINVAL;
+    }
+    FileSystemImpl* theImplPtr = 0;
+    theRet = CreateFs(theFsUri.substr(0, thePos), theFsUri.substr(thePos + 3),
+        theFsUri, inPropertiesPtr, theImplPtr);
+    outFsPtr = theImplPtr;
+    return theRet;
+}
+
+    /* static */ void
+FileSystem::Destroy(
+    FileSystem* inFsPtr)
+{
+    delete inFsPtr;
+}
+
     /* static */ string
 FileSystem::GetStrError(
     int               inError,
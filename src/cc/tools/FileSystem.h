@@ -94,6 +94,15 @@ public:
         FileSystem*&      outFsPtr,
         string*           outPathPtr      = 0,
         const Properties* inPropertiesPtr = 0);
+    // Create new file system instance, not shared with Get(), in order to
+    // issue requests concurrently from multiple threads. The instance must be
+    // deleted with Destroy().
+    static int Create(
+        const string&     inUri,
+        FileSystem*&      outFsPtr,
+        const Properties* inPropertiesPtr = 0);
+    static void Destroy(
+        FileSystem* inFsPtr);
     static string GetStrError(
         int               inErr,
         const FileSystem* inFsPtr = 0);
@@ -0,0 +1,342 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Parallel file copy work queue with manifest and progress reporting,
+// used by cptoqfs and cpfromqfs.
+//
+//----------------------------------------------------------------------------
+
+#include "ParallelCopy.h"
+
+#include "common/time.h"
+#include "qcdio/QCThread.h"
+#include "qcdio/qcstutils.h"
+
+#include <iomanip>
+
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+
+namespace KFS
+{
+namespace tools
+{
+using std::ifstream;
+using std::ios_base;
+using std::fixed;
+using std::setprecision;
+
+class ParallelCopy::Worker : public QCRunnable
+{
+public:
+    Worker(
+        ParallelCopy& inOuter)
+        : QCRunnable(),
+          mOuter(inOuter),
+          mThread()
+        {}
+    virtual ~Worker()
+        {}
+    int Start()
+        { return mThread.TryToStart(this, -1, "ParallelCopy"); }
+    void Join()
+        { mThread.Join(); }
+    virtual void Run()
+        { mOuter.Run(); }
+private:
+    ParallelCopy& mOuter;
+    QCThread      mThread;
+private:
+    Worker(
+        const Worker& inWorker);
+    Worker& operator=(
+        const Worker& inWorker);
+};
+
+ParallelCopy::ParallelCopy(
+    Copier&       inCopier,
+    std::ostream& inReportStream)
+    : mCopier(inCopier),
+      mReportStream(inReportStream),
+      mMutex(),
+      mWorkCond(),
+      mSpaceCond(),
+      mQueue(),
+      mManifest(),
+      mManifestStream(),
+      mManifestFileName(),
+      mWorkers(),
+      mMaxQueueSize(0),
+      mInFlightCount(0),
+      mStatus(0),
+      mDoneFlag(false),
+      mProgressInterval(0),
+      mStartTime(microseconds()),
+      mNextReportTime(0),
+      mByteCount(0),
+      mDoneCount(0),
+      mSkippedCount(0),
+      mFailedCount(0)
+{}
+
+ParallelCopy::~ParallelCopy()
+{
+    ParallelCopy::Finish();
+}
+
+    int
+ParallelCopy::Start(
+    int         inThreadCount,
+    int         inProgressIntervalSec,
+    const char* inManifestFileNamePtr)
+{
+    if (! mWorkers.empty()) {
+        return -EINVAL;
+    }
+    mStartTime        = microseconds();
+    mProgressInterval = inProgressIntervalSec > 0 ?
+        int64_t(inProgressIntervalSec) * 1000 * 1000 : int64_t(0);
+    mNextReportTime   = mStartTime + mProgressInterval;
+    if (inManifestFileNamePtr && *inManifestFileNamePtr) {
+        mManifestFileName = inManifestFileNamePtr;
+        const int theStatus = LoadManifest();
+        if (theStatus != 0) {
+            return theStatus;
+        }
+        mManifestStream.open(mManifestFileName.c_str(),
+            ios_base::out | ios_base::app);
+        if (! mManifestStream) {
+            const int theErr = errno;
+            mReportStream << mManifestFileName << ": " <<
+                strerror(theErr) << "\n";
+            return (theErr > 0 ? -theErr : -EIO);
+        }
+    }
+    if (inThreadCount <= 1) {
+        return 0;
+    }
+    mMaxQueueSize = (size_t)inThreadCount * 4;
+    for (int i = 0; i < inThreadCount; i++) {
+        Worker* const theWorkerPtr = new Worker(*this);
+        const int     theErr       = theWorkerPtr->Start();
+        if (theErr != 0) {
+            delete theWorkerPtr;
+            mReportStream << "failed to start copy thread: " <<
+                QCThread::GetErrorMsg(theErr) << "\n";
+            Finish();
+            return (theErr > 0 ? -theErr : -EINVAL);
+        }
+        mWorkers.push_back(theWorkerPtr);
+    }
+    return 0;
+}
+
+// Manifest line format: <size> <checksum or -> <destination path>
+    int
+ParallelCopy::LoadManifest()
+{
+    ifstream theStream(mManifestFileName.c_str());
+    if (! theStream) {
+        return 0; // Nothing to resume.
+    }
+    string theLine;
+    while (getline(theStream, theLine)) {
+        const size_t theSizeEnd = theLine.find(' ');
+        const size_t theSumEnd  = theSizeEnd == string::npos ?
+            string::npos : theLine.find(' ', theSizeEnd + 1);
+        if (theSumEnd == string::npos || theLine.size() <= theSumEnd + 1) {
+            // Partially written last line, if the copy was interrupted.
+            continue;
+        }
+        mManifest.insert(theLine.substr(theSumEnd + 1));
+    }
+    if (theStream.bad()) {
+        const int theErr = errno;
+        mReportStream << mManifestFileName << ": " <<
+            strerror(theErr) << "\n";
+        return (theErr > 0 ? -theErr : -EIO);
+    }
+    return 0;
+}
+
+    int
+ParallelCopy::Add(
+    const string& inSrc,
+    const string& inDst)
+{
+    QCStMutexLocker theLock(mMutex);
+    if (mStatus != 0) {
+        return mStatus;
+    }
+    if (mManifest.find(inDst) != mManifest.end()) {
+        mSkippedCount++;
+        return 0;
+    }
+    if (mWorkers.empty()) {
+        mInFlightCount++;
+        QCStMutexUnlocker theUnlock(mMutex);
+        Copy(Entry(inSrc, inDst));
+    } else {
+        while (mMaxQueueSize <= mQueue.size() && mStatus == 0) {
+            mSpaceCond.Wait(mMutex);
+        }
+        if (mStatus == 0) {
+            mQueue.push_back(Entry(inSrc, inDst));
+            mWorkCond.Notify();
+        }
+    }
+    return mStatus;
+}
+
+    int
+ParallelCopy::Finish()
+{
+    QCStMutexLocker theLock(mMutex);
+    if (mDoneFlag) {
+        return mStatus;
+    }
+    mDoneFlag = true;
+    mWorkCond.NotifyAll();
+    if (! mWorkers.empty()) {
+        Workers theWorkers;
+        theWorkers.swap(mWorkers);
+        QCStMutexUnlocker theUnlock(mMutex);
+        for (Workers::const_iterator theIt = theWorkers.begin();
+                theIt != theWorkers.end();
+                ++theIt) {
+            (*theIt)->Join();
+            delete *theIt;
+        }
+    }
+    if (mManifestStream.is_open()) {
+        mManifestStream.close();
+    }
+    if (0 < mProgressInterval) {
+        Report(microseconds(), true);
+    }
+    return mStatus;
+}
+
+    void
+ParallelCopy::Run()
+{
+    QCStMutexLocker theLock(mMutex);
+    for (; ;) {
+        while (mQueue.empty() && ! mDoneFlag) {
+            mWorkCond.Wait(mMutex);
+        }
+        if (mQueue.empty()) {
+            break;
+        }
+        const Entry theEntry = mQueue.front();
+        mQueue.pop_front();
+        mSpaceCond.Notify();
+        if (mStatus != 0) {
+            continue; // Discard the remaining entries after failure.
+        }
+        mInFlightCount++;
+        QCStMutexUnlocker theUnlock(mMutex);
+        Copy(theEntry);
+    }
+}
+
+    void
+ParallelCopy::Copy(
+    const ParallelCopy::Entry& inEntry)
+{
+    Result    theResult;
+    const int theStatus = mCopier.Copy(
+        inEntry.mSrc, inEntry.mDst, *this, theResult);
+    QCStMutexLocker theLock(mMutex);
+    mInFlightCount--;
+    if (theStatus != 0) {
+        mFailedCount++;
+        if (mStatus == 0) {
+            mStatus = theStatus;
+            mSpaceCond.NotifyAll();
+        }
+        return;
+    }
+    mDoneCount++;
+    if (mManifestStream.is_open()) {
+        mManifestStream << theResult.mSize << " ";
+        if (theResult.mVerifiedFlag) {
+            mManifestStream << std::hex << theResult.mChecksum << std::dec;
+        } else {
+            mManifestStream << "-";
+        }
+        mManifestStream << " " << inEntry.mDst << "\n";
+        mManifestStream.flush();
+        if (! mManifestStream) {
+            mReportStream << mManifestFileName << ": write failure\n";
+            mManifestStream.close();
+            if (mStatus == 0) {
+                mStatus = -EIO;
+                mSpaceCond.NotifyAll();
+            }
+        }
+    }
+    if (0 < mProgressInterval) {
+        const int64_t theNow = microseconds();
+        if (mNextReportTime <= theNow) {
+            Report(theNow, false);
+        }
+    }
+}
+
+    void
+ParallelCopy::Progress(
+    int64_t inByteCount)
+{
+    QCStMutexLocker theLock(mMutex);
+    mByteCount += inByteCount;
+    if (mProgressInterval <= 0) {
+        return;
+    }
+    const int64_t theNow = microseconds();
+    if (mNextReportTime <= theNow) {
+        Report(theNow, false);
+    }
+}
+
+    void
+ParallelCopy::Report(
+    int64_t inNow,
+    bool    inFinalFlag)
+{
+    const double theSec =
+        (double)std::max(int64_t(1), inNow - mStartTime) * 1e-6;
+    mReportStream <<
+        (inFinalFlag ? "done:" : "progress:") <<
+        " files: "     << mDoneCount     <<
+        " skipped: "   << mSkippedCount  <<
+        " failed: "    << mFailedCount   <<
+        " in flight: " << mInFlightCount <<
+        " queued: "    << mQueue.size()  <<
+        " bytes: "     << mByteCount     <<
+        " time: "      << fixed << setprecision(1) << theSec <<
+        " sec. rate: " << (double)mByteCount / (theSec * (1 << 20)) <<
+        " MB/sec\n";
+    mReportStream.flush();
+    mNextReportTime = inNow + mProgressInterval;
+}
+
+}
+}
@@ -0,0 +1,154 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Parallel file copy work queue with manifest and progress reporting,
+// used by cptoqfs and cpfromqfs.
+//
+//----------------------------------------------------------------------------
+
+#ifndef TOOLS_PARALLEL_COPY_H
+#define TOOLS_PARALLEL_COPY_H
+
+#include "qcdio/QCMutex.h"
+
+#include <stdint.h>
+
+#include <string>
+#include <deque>
+#include <set>
+#include <vector>
+#include <fstream>
+#include <ostream>
+
+namespace KFS
+{
+namespace tools
+{
+using std::string;
+
+// Runs file copies in the worker threads. The completed copies are appended
+// to the manifest file, if configured, and the files listed in the manifest
+// are skipped, in order to resume interrupted copy. With no worker threads
+// the copies run in the caller's thread.
+class ParallelCopy
+{
+public:
+    struct Result
+    {
+        Result()
+            : mSize(0),
+              mChecksum(0),
+              mVerifiedFlag(false)
+            {}
+        int64_t  mSize;
+        uint32_t mChecksum;
+        bool     mVerifiedFlag;
+    };
+    class Copier
+    {
+    public:
+        // Invoked concurrently by the worker threads. Returns 0 on success,
+        // or error code.
+        virtual int Copy(
+            const string& inSrc,
+            const string& inDst,
+            ParallelCopy& inParallelCopy,
+            Result&       outResult) = 0;
+    protected:
+        Copier()
+            {}
+        virtual ~Copier()
+            {}
+    };
+
+    ParallelCopy(
+        Copier&       inCopier,
+        std::ostream& inReportStream);
+    ~ParallelCopy();
+    int Start(
+        int         inThreadCount,
+        int         inProgressIntervalSec,
+        const char* inManifestFileNamePtr);
+    // Returns the first copy error, if any, in order to stop the directory
+    // traversal.
+    int Add(
+        const string& inSrc,
+        const string& inDst);
+    // Waits for all queued copies to finish, returns the first copy error.
+    int Finish();
+    // Invoked by the copier to report the number of bytes copied.
+    void Progress(
+        int64_t inByteCount);
+private:
+    class Worker;
+    struct Entry
+    {
+        Entry(
+            const string& inSrc = string(),
+            const string& inDst = string())
+            : mSrc(inSrc),
+              mDst(inDst)
+            {}
+        string mSrc;
+        string mDst;
+    };
+    typedef std::deque<Entry>     Queue;
+    typedef std::set<string>      Manifest;
+    typedef std::vector<Worker*>  Workers;
+
+    Copier&       mCopier;
+    std::ostream& mReportStream;
+    QCMutex       mMutex;
+    QCCondVar     mWorkCond;
+    QCCondVar     mSpaceCond;
+    Queue         mQueue;
+    Manifest      mManifest;
+    std::ofstream mManifestStream;
+    string        mManifestFileName;
+    Workers       mWorkers;
+    size_t        mMaxQueueSize;
+    int           mInFlightCount;
+    int           mStatus;
+    bool          mDoneFlag;
+    int64_t       mProgressInterval;
+    int64_t       mStartTime;
+    int64_t       mNextReportTime;
+    int64_t       mByteCount;
+    int64_t       mDoneCount;
+    int64_t       mSkippedCount;
+    int64_t       mFailedCount;
+
+    void Run();
+    void Copy(
+        const Entry& inEntry);
+    void Report(
+        int64_t inNow,
+        bool    inFinalFlag);
+    int LoadManifest();
+private:
+    ParallelCopy(
+        const ParallelCopy& inCopy);
+    ParallelCopy& operator=(
+        const ParallelCopy& inCopy);
+};
+
+}
+}
+
+#endif /* TOOLS_PARALLEL_COPY_H */
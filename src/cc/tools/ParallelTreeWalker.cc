@@ -0,0 +1,337 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Concurrent directory tree walker.
+//
+//----------------------------------------------------------------------------
+
+#include "ParallelTreeWalker.h"
+
+#include "common/MsgLogger.h"
+#include "qcdio/QCThread.h"
+#include "qcdio/qcstutils.h"
+#include "qcdio/qcdebug.h"
+
+#include <errno.h>
+
+namespace KFS
+{
+namespace tools
+{
+
+struct ParallelTreeWalker::Dir
+{
+    Dir(
+        const string&              inPath,
+        const FileSystem::StatBuf& inStat,
+        Dir*                       inParentPtr)
+        : mPath(inPath),
+          mStat(inStat),
+          mParentPtr(inParentPtr),
+          mPendingCount(1)
+        {}
+    string              mPath;
+    FileSystem::StatBuf mStat;
+    Dir* const          mParentPtr;
+    // The directory listing itself, plus the number of not yet completed sub
+    // directories.
+    size_t              mPendingCount;
+};
+
+class ParallelTreeWalker::Worker : public QCRunnable
+{
+public:
+    Worker(
+        ParallelTreeWalker& inOuter,
+        FileSystem&         inFs)
+        : QCRunnable(),
+          mOuter(inOuter),
+          mFs(inFs),
+          mThread()
+        {}
+    virtual ~Worker()
+        {}
+    int Start()
+        { return mThread.TryToStart(this, -1, "TreeWalker"); }
+    void Join()
+        { mThread.Join(); }
+    virtual void Run()
+        { mOuter.Process(mFs); }
+private:
+    ParallelTreeWalker& mOuter;
+    FileSystem&         mFs;
+    QCThread            mThread;
+private:
+    Worker(
+        const Worker& inWorker);
+    Worker& operator=(
+        const Worker& inWorker);
+};
+
+ParallelTreeWalker::ParallelTreeWalker(
+    int               inThreadCount,
+    const Properties* inPropertiesPtr)
+    : mThreadCount(inThreadCount < 1 ? 1 : inThreadCount),
+      mPropertiesPtr(inPropertiesPtr),
+      mMutex(),
+      mCond(),
+      mQueue(),
+      mFileSystems(),
+      mFsUri(),
+      mVisitorPtr(0),
+      mStatus(0),
+      mDoneFlag(true)
+{}
+
+ParallelTreeWalker::~ParallelTreeWalker()
+{
+    DestroyFileSystems();
+}
+
+    void
+ParallelTreeWalker::DestroyFileSystems()
+{
+    for (FileSystems::const_iterator theIt = mFileSystems.begin();
+            theIt != mFileSystems.end();
+            ++theIt) {
+        FileSystem::Destroy(*theIt);
+    }
+    mFileSystems.clear();
+    mFsUri.clear();
+}
+
+    int
+ParallelTreeWalker::CreateFileSystems(
+    FileSystem& inFs)
+{
+    if (mFsUri != inFs.GetUri()) {
+        DestroyFileSystems();
+        mFsUri = inFs.GetUri();
+    }
+    string theCwd;
+    int    theRet = inFs.GetCwd(theCwd);
+    if (theRet != 0) {
+        return theRet;
+    }
+    while ((int)mFileSystems.size() + 1 < mThreadCount) {
+        FileSystem* theFsPtr = 0;
+        if ((theRet = FileSystem::Create(
+                mFsUri, theFsPtr, mPropertiesPtr)) != 0) {
+            break;
+        }
+        mFileSystems.push_back(theFsPtr);
+    }
+    for (FileSystems::const_iterator theIt = mFileSystems.begin();
+            theIt != mFileSystems.end();
+            ++theIt) {
+        string theFsCwd;
+        if ((*theIt)->GetCwd(theFsCwd) != 0 || theFsCwd != theCwd) {
+            const int theStatus = (*theIt)->Chdir(theCwd);
+            if (theStatus != 0) {
+                return theStatus;
+            }
+        }
+    }
+    if (theRet != 0) {
+        // Proceed with less threads.
+        KFS_LOG_STREAM_ERROR << mFsUri << ": " <<
+            inFs.StrError(theRet) <<
+            " failed to create file system instance,"
+            " threads: " << mFileSystems.size() + 1 <<
+        KFS_LOG_EOM;
+    }
+    return 0;
+}
+
+    int
+ParallelTreeWalker::Run(
+    FileSystem&   inFs,
+    const string& inPath,
+    Visitor&      inVisitor)
+{
+    FileSystem::StatBuf theStat;
+    int                 theStatus = inFs.Stat(inPath, theStat);
+    if (theStatus != 0) {
+        return theStatus;
+    }
+    if ((theStatus = inVisitor.Visit(inFs, inPath, theStat)) != 0 ||
+            ! S_ISDIR(theStat.st_mode)) {
+        return theStatus;
+    }
+    if (mThreadCount > 1 &&
+            (theStatus = CreateFileSystems(inFs)) != 0) {
+        return theStatus;
+    }
+    QCStMutexLocker theLock(mMutex);
+    QCASSERT(mDoneFlag && mQueue.empty());
+    mVisitorPtr = &inVisitor;
+    mStatus     = 0;
+    mDoneFlag   = false;
+    mQueue.push_back(new Dir(inPath, theStat, 0));
+    vector<Worker*> theWorkers;
+    theWorkers.reserve(mFileSystems.size());
+    for (FileSystems::const_iterator theIt = mFileSystems.begin();
+            theIt != mFileSystems.end();
+            ++theIt) {
+        Worker* const theWorkerPtr = new Worker(*this, **theIt);
+        const int     theErr       = theWorkerPtr->Start();
+        if (theErr != 0) {
+            KFS_LOG_STREAM_ERROR <<
+                "failed to start tree walker thread: " <<
+                QCThread::GetErrorMsg(theErr) <<
+            KFS_LOG_EOM;
+            delete theWorkerPtr;
+            break;
+        }
+        theWorkers.push_back(theWorkerPtr);
+    }
+    {
+        QCStMutexUnlocker theUnlock(mMutex);
+        Process(inFs);
+        for (vector<Worker*>::const_iterator theIt = theWorkers.begin();
+                theIt != theWorkers.end();
+                ++theIt) {
+            (*theIt)->Join();
+            delete *theIt;
+        }
+    }
+    mVisitorPtr = 0;
+    return mStatus;
+}
+
+    void
+ParallelTreeWalker::Process(
+    FileSystem& inFs)
+{
+    QCStMutexLocker theLock(mMutex);
+    vector<Dir*>    theDirs;
+    for (; ;) {
+        while (mQueue.empty() && ! mDoneFlag) {
+            mCond.Wait(mMutex);
+        }
+        if (mQueue.empty()) {
+            break;
+        }
+        // Depth first, in order to bound the queue size.
+        Dir* const theDirPtr = mQueue.back();
+        mQueue.pop_back();
+        if (mStatus == 0) {
+            int theStatus;
+            {
+                QCStMutexUnlocker theUnlock(mMutex);
+                theStatus = List(inFs, *theDirPtr, theDirs);
+            }
+            if (theStatus != 0 && mStatus == 0) {
+                mStatus = theStatus;
+            }
+            if (! theDirs.empty()) {
+                theDirPtr->mPendingCount += theDirs.size();
+                mQueue.insert(mQueue.end(), theDirs.begin(), theDirs.end());
+                theDirs.clear();
+                mCond.NotifyAll();
+            }
+        }
+        Complete(inFs, theDirPtr);
+    }
+}
+
+    int
+ParallelTreeWalker::List(
+    FileSystem&   inFs,
+    Dir&          inDir,
+    vector<Dir*>& outDirs)
+{
+    FileSystem::DirIterator* theItPtr             = 0;
+    const bool               kFetchAttributesFlag = true;
+    int                      theErr               = inFs.Open(
+        inDir.mPath, kFetchAttributesFlag, theItPtr);
+    if (theErr != 0) {
+        return mVisitorPtr->Error(inFs, inDir.mPath, theErr);
+    }
+    string thePath = inDir.mPath;
+    if (! thePath.empty() && *thePath.rbegin() != '/') {
+        thePath += "/";
+    }
+    const size_t theDirPathLen = thePath.length();
+    string       theName;
+    int          theStatus     = 0;
+    while (theStatus == 0) {
+        const FileSystem::StatBuf* theStatPtr = 0;
+        if ((theErr = inFs.Next(theItPtr, theName, theStatPtr)) != 0 &&
+                (theStatus = mVisitorPtr->Error(
+                    inFs, thePath + theName, theErr)) != 0) {
+            break;
+        }
+        if (theName.empty()) {
+            break;
+        }
+        if (theName == "." || theName == "..") {
+            continue;
+        }
+        thePath.resize(theDirPathLen);
+        thePath += theName;
+        if (! theStatPtr) {
+            if (theErr == 0) {
+                theStatus = mVisitorPtr->Error(inFs, thePath, -EINVAL);
+            }
+            continue;
+        }
+        if ((theStatus = mVisitorPtr->Visit(
+                inFs, thePath, *theStatPtr)) != 0) {
+            break;
+        }
+        if (S_ISDIR(theStatPtr->st_mode)) {
+            outDirs.push_back(new Dir(thePath, *theStatPtr, &inDir));
+        }
+    }
+    inFs.Close(theItPtr);
+    return theStatus;
+}
+
+    void
+ParallelTreeWalker::Complete(
+    FileSystem& inFs,
+    Dir*        inDirPtr)
+{
+    QCASSERT(mMutex.IsOwned());
+    Dir* theDirPtr = inDirPtr;
+    while (theDirPtr && --(theDirPtr->mPendingCount) <= 0) {
+        Dir* const theParentPtr = theDirPtr->mParentPtr;
+        if (mStatus == 0) {
+            int theStatus;
+            {
+                QCStMutexUnlocker theUnlock(mMutex);
+                theStatus = mVisitorPtr->Leave(
+                    inFs, theDirPtr->mPath, theDirPtr->mStat);
+            }
+            if (theStatus != 0 && mStatus == 0) {
+                mStatus = theStatus;
+            }
+        }
+        delete theDirPtr;
+        if (! theParentPtr) {
+            mDoneFlag = true;
+            mCond.NotifyAll();
+        }
+        theDirPtr = theParentPtr;
+    }
+}
+
+}
+}
@@ -0,0 +1,132 @@
+//---------------------------------------------------------- -*- Mode: C++ -*-
+// $Id$
+//
+// Copyright 2026 Quantcast Corp.
+//
+// This file is part of Kosmos File System (KFS).
+//
+// Licensed under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied. See the License for the specific language governing
+// permissions and limitations under the License.
+//
+// \brief Concurrent directory tree walker.
+//
+//----------------------------------------------------------------------------
+
+#ifndef TOOLS_PARALLEL_TREE_WALKER_H
+#define TOOLS_PARALLEL_TREE_WALKER_H
+
+#include "FileSystem.h"
+
+#include "qcdio/QCMutex.h"
+
+#include <string>
+#include <vector>
+
+namespace KFS
+{
+class Properties;
+
+namespace tools
+{
+using std::string;
+using std::vector;
+
+// Lists directories, and invokes the visitor concurrently from multiple
+// threads. Each thread uses its own file system instance, therefore the number
+// of threads bounds the number of the in flight requests, and with qfs the
+// requests are issued over separate meta server connections. The directories
+// of one subtree can be processed in any order, but the directory's Leave()
+// is always invoked after all of its entries, including the sub directories,
+// were visited.
+class ParallelTreeWalker
+{
+public:
+    class Visitor
+    {
+    public:
+        // Invoked for every entry, including the tree root, with the
+        // directory's own entry visited before its content. Returns 0 to
+        // continue, or error code to stop the traversal.
+        virtual int Visit(
+            FileSystem&                inFs,
+            const string&              inPath,
+            const FileSystem::StatBuf& inStat) = 0;
+        // Invoked for every directory after its content was visited.
+        virtual int Leave(
+            FileSystem&                /* inFs */,
+            const string&              /* inPath */,
+            const FileSystem::StatBuf& /* inStat */)
+            { return 0; }
+        // Invoked on directory read failure. Returns 0 to continue.
+        virtual int Error(
+            FileSystem&   inFs,
+            const string& inPath,
+            int           inStatus) = 0;
+    protected:
+        Visitor()
+            {}
+        virtual ~Visitor()
+            {}
+    };
+
+    ParallelTreeWalker(
+        int               inThreadCount,
+        const Properties* inPropertiesPtr);
+    ~ParallelTreeWalker();
+    int GetThreadCount() const
+        { return mThreadCount; }
+    // The calling thread participates in the traversal with inFs, the
+    // remaining threads use their own instances of the same file system.
+    int Run(
+        FileSystem&   inFs,
+        const string& inPath,
+        Visitor&      inVisitor);
+private:
+    class Worker;
+    struct Dir;
+    typedef vector<Dir*>        Queue;
+    typedef vector<FileSystem*> FileSystems;
+
+    const int               mThreadCount;
+    const Properties* const mPropertiesPtr;
+    QCMutex                 mMutex;
+    QCCondVar               mCond;
+    Queue                   mQueue;
+    FileSystems             mFileSystems;
+    string                  mFsUri;
+    Visitor*                mVisitorPtr;
+    int                     mStatus;
+    bool                    mDoneFlag;
+
+    int CreateFileSystems(
+        FileSystem& inFs);
+    void DestroyFileSystems();
+    void Process(
+        FileSystem& inFs);
+    int List(
+        FileSystem&   inFs,
+        Dir&          inDir,
+        vector<Dir*>& outDirs);
+    void Complete(
+        FileSystem& inFs,
+        Dir*        inDirPtr);
+private:
+    ParallelTreeWalker(
+        const ParallelTreeWalker& inWalker);
+    ParallelTreeWalker& operator=(
+        const ParallelTreeWalker& inWalker);
+};
+
+}
+}
+
+#endif /* TOOLS_PARALLEL_TREE_WALKER_H */
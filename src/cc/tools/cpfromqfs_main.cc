@@ -28,8 +28,11 @@
 //
 //----------------------------------------------------------------------------
 
+#include "ParallelCopy.h"
+
 #include "libclient/KfsClient.h"
 #include "common/MsgLogger.h"
+#include "kfsio/checksum.h"
 
 #include <unistd.h>
 #include <string.h>
@@ -52,12 +55,14 @@ using std::vector;
 using std::min;
 using std::max;
 using std::numeric_limits;
+using tools::ParallelCopy;
 
-class CpFromKfs
+class CpFromKfs : private ParallelCopy::Copier
 {
 public:
     CpFromKfs()
-        : mKfsClient(0),
+        : ParallelCopy::Copier(),
+          mKfsClient(0),
           mSkipHolesFlag(false),
           mFailShortReadsFlag(true),
           mStart(-1),
@@ -65,14 +70,14 @@ public:
           mMaxRead(numeric_limits<int64_t>::max()),
           mReadAhead(-1),
           mBufSize(0),
-          mAllocBufSize(0),
           mReadExitCount(-1),
-          mKfsBuf(0)
+          mVerifyFlag(false),
+          mParallelCopy(*this, cerr)
         {}
-    ~CpFromKfs()
+    virtual ~CpFromKfs()
     {
+        mParallelCopy.Finish();
         delete mKfsClient;
-        delete [] mKfsBuf;
     }
 
     int Run(int argc, char **argv);
@@ -86,9 +91,9 @@ private:
     chunkOff_t mMaxRead;
     int        mReadAhead;
     int        mBufSize;
-    int        mAllocBufSize;
     int        mReadExitCount;
-    char*      mKfsBuf;
+    bool       mVerifyFlag;
+    ParallelCopy mParallelCopy;
 
     // Given a kfsdirname, restore it to dirname.  Dirname will be created
     // if it doesn't exist.
@@ -100,7 +105,15 @@ private:
     int RestoreFile(string kfspath, string localpath);
 
     // does the guts of the work
-    int RestoreFile2(string kfsfilename, string localfilename);
+    int RestoreFile2(string kfsfilename, string localfilename,
+        ParallelCopy& parallelCopy, ParallelCopy::Result& result);
+
+    // Read back the local file, and compare its checksum with the checksum
+    // of the data read from qfs.
+    int Verify(const string& localfilename, ParallelCopy::Result& result);
+
+    virtual int Copy(const string& kfsfilename, const string& localfilename,
+        ParallelCopy& parallelCopy, ParallelCopy::Result& result);
 
     void AddDirSlash(string& dir)
     {
@@ -123,9 +136,13 @@ CpFromKfs::Run(int argc, char **argv)
     int                 retryDelay = -1;
     int                 opTimeout  = -1;
     const char*         config     = 0;
+    int                 threads    = 1;
+    int                 progress   = 0;
+    const char*         manifest   = 0;
     int                 optchar;
 
-    while ((optchar = getopt(argc, argv, "d:hp:s:k:a:b:w:r:R:D:T:X:F:Svf:M:")) != -1) {
+    while ((optchar = getopt(argc, argv,
+            "d:hp:s:k:a:b:w:r:R:D:T:X:F:Svf:M:j:co:P:")) != -1) {
         switch (optchar) {
             case 'd':
                 localPath = optarg;
@@ -181,6 +198,18 @@ CpFromKfs::Run(int argc, char **argv)
             case 'f':
                 config = optarg;
                 break;
+            case 'j':
+                threads = atoi(optarg);
+                break;
+            case 'c':
+                mVerifyFlag = true;
+                break;
+            case 'o':
+                manifest = optarg;
+                break;
+            case 'P':
+                progress = atoi(optarg);
+                break;
             default:
                 helpFlag = true;
                 break;
@@ -192,6 +221,7 @@ CpFromKfs::Run(int argc, char **argv)
             localPath.empty() ||
             serverHost.empty() ||
             port < 0 ||
+            threads < 1 ||
             (mStart >= 0 && mStop >= 0 && mStart >= mStop)) {
         cerr << "Usage: " << argv[0] << "\n"
             " -s -- meta server name\n"
@@ -213,6 +243,14 @@ CpFromKfs::Run(int argc, char **argv)
             " [-X n]     -- debugging: call exit(1) after n read calls\n"
             " [-f file]  -- configuration file name\n"
             " [-M ]      -- maximum number of bytes to read per file\n"
+            " [-j n]     -- number of files to copy in parallel, default 1\n"
+            " [-c]       -- verify: read back the local file and compare"
+                            " checksums\n"
+            " [-o file]  -- manifest file name: record copied files, and"
+                            " skip files already recorded, in order to"
+                            " resume copy\n"
+            " [-P sec]   -- progress report interval, default 0 -- no"
+                            " progress reports\n"
         ;
         return (1);
     }
@@ -244,6 +282,9 @@ CpFromKfs::Run(int argc, char **argv)
         return ret;
     }
 
+    if ((ret = mParallelCopy.Start(threads, progress, manifest)) != 0) {
+        return ret;
+    }
     if (attr.isDirectory) {
         if (localPath == "-") {
             ret = -EISDIR;
@@ -254,7 +295,8 @@ CpFromKfs::Run(int argc, char **argv)
     } else {
         ret = RestoreFile(kfsPath, localPath);
     }
-    return ret;
+    const int status = mParallelCopy.Finish();
+    return (ret != 0 ? ret : status);
 }
 
 int
@@ -274,9 +316,9 @@ CpFromKfs::RestoreFile(string kfsPath, string localPath)
         } else {
             filename = kfsPath;
         }
-        return RestoreFile2(kfsPath, localPath + "/" + filename);
+        return mParallelCopy.Add(kfsPath, localPath + "/" + filename);
     }
-    return RestoreFile2(kfsPath, localPath);
+    return mParallelCopy.Add(kfsPath, localPath);
 }
 
 int
@@ -316,15 +358,27 @@ CpFromKfs::RestoreDir(string kfsdirname, string dirname)
             res = RestoreDir(kfsdirname + fileInfo[i].filename,
                              dirname + fileInfo[i].filename);
         } else {
-            res = RestoreFile2(kfsdirname + fileInfo[i].filename,
-                               dirname + fileInfo[i].filename);
+            res = mParallelCopy.Add(kfsdirname + fileInfo[i].filename,
+                                    dirname + fileInfo[i].filename);
         }
     }
     return res;
 }
 
 int
-CpFromKfs::RestoreFile2(string kfsfilename, string localfilename)
+CpFromKfs::Copy(const string& kfsfilename, const string& localfilename,
+    ParallelCopy& parallelCopy, ParallelCopy::Result& result)
+{
+    int ret = RestoreFile2(kfsfilename, localfilename, parallelCopy, result);
+    if (ret == 0 && mVerifyFlag && localfilename != "-") {
+        ret = Verify(localfilename, result);
+    }
+    return ret;
+}
+
+int
+CpFromKfs::RestoreFile2(string kfsfilename, string localfilename,
+    ParallelCopy& parallelCopy, ParallelCopy::Result& result)
 {
     const int kfsfd = mKfsClient->Open(kfsfilename.c_str(), O_RDONLY);
     if (kfsfd < 0) {
@@ -354,11 +408,7 @@ CpFromKfs::RestoreFile2(string kfsfilename, string localfilename)
     if (theSize <= 0) {
         theSize = 1 << 20;
     }
-    if (theSize != mAllocBufSize || ! mKfsBuf) {
-        delete [] mKfsBuf;
-        mKfsBuf = new char[theSize];
-        mAllocBufSize = theSize;
-    }
+    vector<char> kfsBuf(theSize);
 
     chunkOff_t pos = max(chunkOff_t(0), mStart);
     if (pos > 0) {
@@ -377,11 +427,13 @@ CpFromKfs::RestoreFile2(string kfsfilename, string localfilename)
         mKfsClient->SetEOFMark(kfsfd, mStop);
     }
 
+    result.mSize     = 0;
+    result.mChecksum = kKfsNullChecksum;
     chunkOff_t rem = mMaxRead;
     int        err = 0;
     while (0 < rem) {
-        const int nRead = mKfsClient->Read(kfsfd, mKfsBuf,
-            (size_t)min(rem, (chunkOff_t)mAllocBufSize));
+        const int nRead = mKfsClient->Read(kfsfd, &kfsBuf[0],
+            (size_t)min(rem, (chunkOff_t)theSize));
         if (nRead <= 0) {
             if (nRead < 0) {
                 err = nRead;
@@ -397,7 +449,11 @@ CpFromKfs::RestoreFile2(string kfsfilename, string localfilename)
         }
         pos += nRead;
         rem -= nRead;
-        for (const char* p = mKfsBuf, * const e = p + nRead; p < e; ) {
+        if (mVerifyFlag) {
+            result.mChecksum = ComputeBlockChecksum(
+                result.mChecksum, &kfsBuf[0], (size_t)nRead);
+        }
+        for (const char* p = &kfsBuf[0], * const e = p + nRead; p < e; ) {
             const ssize_t n = write(localFd, p, e - p);
             if (n < 0) {
                 if (errno != EINTR && errno != EAGAIN) {
@@ -412,6 +468,8 @@ CpFromKfs::RestoreFile2(string kfsfilename, string localfilename)
             cerr << localfilename << ": " << strerror(err) << "\n";
             break;
         }
+        result.mSize += nRead;
+        parallelCopy.Progress(nRead);
         if (mStop > 0 && pos >= mStop) {
             KFS_LOG_STREAM_INFO <<
                 "stopping: pos: " << pos << " stop: " << mStop <<
@@ -426,11 +484,58 @@ CpFromKfs::RestoreFile2(string kfsfilename, string localfilename)
     }
 
     mKfsClient->Close(kfsfd);
-    close(localFd);
+    if (close(localFd) && err == 0) {
+        err = errno;
+        cerr << localfilename << ": " << strerror(err) << "\n";
+    }
     return err;
 
 }
 
+int
+CpFromKfs::Verify(const string& localfilename, ParallelCopy::Result& result)
+{
+    const int localFd = open(localfilename.c_str(), O_RDONLY);
+    if (localFd < 0) {
+        const int err = errno;
+        cerr << localfilename << ": " << strerror(err) << "\n";
+        return err;
+    }
+    vector<char> buf(
+        (size_t)min(max(int64_t(1), result.mSize), int64_t(1) << 20));
+    uint32_t     checksum = kKfsNullChecksum;
+    int64_t      rem      = result.mSize;
+    int          err      = 0;
+    while (0 < rem) {
+        const ssize_t nRead = read(localFd, &buf[0],
+            (size_t)min(rem, (int64_t)buf.size()));
+        if (nRead < 0) {
+            if (errno == EINTR || errno == EAGAIN) {
+                continue;
+            }
+            err = errno;
+            cerr << localfilename << ": " << strerror(err) << "\n";
+            break;
+        }
+        if (nRead == 0) {
+            break;
+        }
+        checksum = ComputeBlockChecksum(checksum, &buf[0], (size_t)nRead);
+        rem -= nRead;
+    }
+    close(localFd);
+    if (err != 0) {
+        return err;
+    }
+    if (rem != 0 || checksum != result.mChecksum) {
+        cerr << "verify " << localfilename << ":" <<
+            (rem != 0 ? " short read" : " checksum mismatch") << "\n";
+        return -EIO;
+    }
+    result.mVerifiedFlag = true;
+    return 0;
+}
+
 } // namespace KFS
 
 int
@@ -28,8 +28,11 @@
 //
 //----------------------------------------------------------------------------
 
+#include "ParallelCopy.h"
+
 #include "libclient/KfsClient.h"
 #include "common/MsgLogger.h"
+#include "kfsio/checksum.h"
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -40,18 +43,23 @@
 #include <dirent.h>
 
 #include <iostream>
+#include <algorithm>
 #include <cerrno>
 
 namespace KFS
 {
 using std::cout;
+using std::cerr;
 using std::string;
+using std::min;
+using tools::ParallelCopy;
 
-class CpToKfs
+class CpToKfs : private ParallelCopy::Copier
 {
 public:
     CpToKfs()
-        : mKfsClient(0),
+        : ParallelCopy::Copier(),
+          mKfsClient(0),
           mTestNumReWrites(-1),
           mNumReplicas(3),
           mDryRunFlag(false),
@@ -62,19 +70,20 @@ public:
           mTruncateFlag(false),
           mDeleteFlag(false),
           mCreateExclusiveFlag(false),
-          mReadBuf(0),
+          mVerifyFlag(false),
           mStriperType(KFS_STRIPED_FILE_TYPE_NONE),
           mStripeSize(0),
           mNumStripes(0),
           mNumRecoveryStripes(0),
           mMinSTier(kKfsSTierMax),
           mMaxSTier(kKfsSTierMax),
-          mStartPos(0)
+          mStartPos(0),
+          mParallelCopy(*this, cerr)
     {}
-    ~CpToKfs()
+    virtual ~CpToKfs()
     {
+        mParallelCopy.Finish();
         delete mKfsClient;
-        delete [] mReadBuf;
     }
 
     int Run(int argc, char **argv);
@@ -91,7 +100,7 @@ private:
     bool       mTruncateFlag;
     bool       mDeleteFlag;
     bool       mCreateExclusiveFlag;
-    char*      mReadBuf;
+    bool       mVerifyFlag;
     int        mStriperType;
     int        mStripeSize;
     int        mNumStripes;
@@ -99,6 +108,7 @@ private:
     kfsSTier_t mMinSTier;
     kfsSTier_t mMaxSTier;
     int64_t    mStartPos;
+    ParallelCopy mParallelCopy;
 
     bool Mkdirs(string path);
 
@@ -119,7 +129,19 @@ private:
     int BackupDir(string dirname, string kfsdirname);
 
     // Guts of the work
-    int BackupFile2(string srcfilename, string kfsfilename);
+    int BackupFile2(string srcfilename, string kfsfilename, char* readBuf,
+        ParallelCopy& parallelCopy, ParallelCopy::Result& result);
+
+    // Read back the written range, and compare its checksum with the source
+    // checksum.
+    int Verify(const string& kfsfilename, ParallelCopy::Result& result,
+        char* readBuf);
+
+    virtual int Copy(
+        const string&         srcfilename,
+        const string&         kfsfilename,
+        ParallelCopy&         parallelCopy,
+        ParallelCopy::Result& result);
 
     void ReportError(const char* what, string fname, int err)
     {
@@ -143,10 +165,13 @@ CpToKfs::Run(int argc, char **argv)
     int                 retryDelay = -1;
     int                 opTimeout  = -1;
     const char*         config     = 0;
+    int                 threads    = 1;
+    int                 progress   = 0;
+    const char*         manifest   = 0;
     int                 optchar;
 
     while ((optchar = getopt(argc, argv,
-            "d:hk:p:s:W:r:vniatxXb:w:u:y:z:R:D:T:Sm:l:B:f:F:")) != -1) {
+            "d:hk:p:s:W:r:vniatxXb:w:u:y:z:R:D:T:Sm:l:B:f:F:j:co:P:")) != -1) {
         switch (optchar) {
             case 'd':
                 sourcePath = optarg;
@@ -235,6 +260,18 @@ CpToKfs::Run(int argc, char **argv)
             case 'f':
                 config = optarg;
                 break;
+            case 'j':
+                threads = atoi(optarg);
+                break;
+            case 'c':
+                mVerifyFlag = true;
+                break;
+            case 'o':
+                manifest = optarg;
+                break;
+            case 'P':
+                progress = atoi(optarg);
+                break;
             default:
                 help = true;
                 break;
@@ -243,7 +280,8 @@ CpToKfs::Run(int argc, char **argv)
 
     if (help || sourcePath.empty() || kfsPath.empty() || serverHost.empty() ||
             port <= 0 || mBufSize < 1 ||
-                (mAppendMode && mBufSize > (64 << 20))) {
+                (mAppendMode && mBufSize > (64 << 20)) ||
+                (mAppendMode && mVerifyFlag) || threads < 1) {
         cout << "Usage: " << argv[0] << "\n"
             " -s   -- meta server name or ip\n"
             " -p   -- meta server port\n"
@@ -272,6 +310,13 @@ CpToKfs::Run(int argc, char **argv)
             " [-B] -- write from this position\n"
             " [-f] -- configuration file name\n"
             " [-F] -- file type -- default 1 or 2 if stripe count not 0\n"
+            " [-j] -- number of files to copy in parallel; default 1\n"
+            " [-c] -- verify: read back the written data and compare"
+                " checksums; not supported with append\n"
+            " [-o] -- manifest file name: record copied files, and skip"
+                " files already recorded, in order to resume copy\n"
+            " [-P] -- progress report interval in seconds; default 0 -- no"
+                " progress reports\n"
         ;
         return(-1);
     }
@@ -316,22 +361,27 @@ CpToKfs::Run(int argc, char **argv)
         return(-1);
     }
 
-    mReadBuf = new char[mBufSize];
+    if (mParallelCopy.Start(threads, progress, manifest) != 0) {
+        return(-1);
+    }
 
+    int ret;
     if (!S_ISDIR(statInfo.st_mode)) {
-        return BackupFile(sourcePath, kfsPath);
-    }
+        ret = BackupFile(sourcePath, kfsPath);
+    } else {
+        DIR* const dirp = opendir(sourcePath.c_str());
+        if (! dirp) {
+            ReportError("opendir", sourcePath, -errno);
+            return(-1);
+        }
 
-    DIR* const dirp = opendir(sourcePath.c_str());
-    if (! dirp) {
-        ReportError("opendir", sourcePath, -errno);
-        return(-1);
+        // when doing cp -r a/b kfs://c, we need to create c/b in KFS.
+        const bool ok = MakeKfsLeafDir(sourcePath, kfsPath);
+        closedir(dirp);
+        ret = ok ? BackupDir(sourcePath, kfsPath) : -1;
     }
-
-    // when doing cp -r a/b kfs://c, we need to create c/b in KFS.
-    const bool ok = MakeKfsLeafDir(sourcePath, kfsPath);
-    closedir(dirp);
-    return (ok ? BackupDir(sourcePath, kfsPath) : -1);
+    const int status = mParallelCopy.Finish();
+    return (ret != 0 ? ret : (status != 0 ? -1 : 0));
 }
 
 bool
@@ -375,12 +425,12 @@ CpToKfs::BackupFile(string sourcePath, string kfsPath)
         if (dst[kfsPath.size() - 1] != '/') {
             dst += "/";
         }
-        return BackupFile2(sourcePath, dst + filename);
+        return mParallelCopy.Add(sourcePath, dst + filename);
     }
 
     // kfsPath is the filename that is being specified for the cp
     // target.  try to copy to there...
-    return BackupFile2(sourcePath, kfsPath);
+    return mParallelCopy.Add(sourcePath, kfsPath);
 }
 
 int
@@ -422,7 +472,7 @@ CpToKfs::BackupDir(string dirname, string kfsdirname)
             kfssubdir = kfsdirname + "/" + fileInfo->d_name;
             BackupDir(subdir, kfssubdir);
         } else if (S_ISREG(buf.st_mode)) {
-            ret = BackupFile2(dirname + "/" + fileInfo->d_name, kfsdirname + "/" + fileInfo->d_name);
+            ret = mParallelCopy.Add(dirname + "/" + fileInfo->d_name, kfsdirname + "/" + fileInfo->d_name);
             if (ret) {
                 break;
             }
@@ -432,12 +482,36 @@ CpToKfs::BackupDir(string dirname, string kfsdirname)
     return ret;
 }
 
+int
+CpToKfs::Copy(
+    const string&         srcfilename,
+    const string&         kfsfilename,
+    ParallelCopy&         parallelCopy,
+    ParallelCopy::Result& result)
+{
+    char* const readBuf = new char[mBufSize];
+    int ret = BackupFile2(srcfilename, kfsfilename, readBuf, parallelCopy,
+        result);
+    if (ret == 0 && mVerifyFlag && 0 <= result.mSize) {
+        ret = Verify(kfsfilename, result, readBuf);
+    }
+    delete [] readBuf;
+    if (result.mSize < 0) {
+        result.mSize = 0;
+    }
+    return ret;
+}
+
 //
 // Guts of the work to copy the file.
 //
 int
-CpToKfs::BackupFile2(string srcfilename, string kfsfilename)
+CpToKfs::BackupFile2(string srcfilename, string kfsfilename, char* mReadBuf,
+    ParallelCopy& parallelCopy, ParallelCopy::Result& result)
 {
+    // Negative size means that nothing was copied.
+    result.mSize     = -1;
+    result.mChecksum = kKfsNullChecksum;
     const int srcFd = srcfilename == "-" ?
         dup(0) : open(srcfilename.c_str(), O_RDONLY);
     if (srcFd  < 0) {
@@ -509,6 +583,7 @@ CpToKfs::BackupFile2(string srcfilename, string kfsfilename)
         }
     }
 
+    result.mSize = 0;
     ssize_t nRead;
     while ((nRead = read(srcFd, mReadBuf, mBufSize)) > 0) {
         for (char* p = mReadBuf, * const e = p + nRead; p < e; ) {
@@ -531,6 +606,12 @@ CpToKfs::BackupFile2(string srcfilename, string kfsfilename)
                 mKfsClient->Seek(kfsfd, nw - res, SEEK_CUR);
             }
         }
+        if (mVerifyFlag) {
+            result.mChecksum = ComputeBlockChecksum(
+                result.mChecksum, mReadBuf, (size_t)nRead);
+        }
+        result.mSize += nRead;
+        parallelCopy.Progress(nRead);
     }
     if (nRead < 0) {
         ReportError("read", srcfilename, -errno);
@@ -547,6 +628,49 @@ CpToKfs::BackupFile2(string srcfilename, string kfsfilename)
     return (nRead < 0 ? -1 : 0);
 }
 
+int
+CpToKfs::Verify(const string& kfsfilename, ParallelCopy::Result& result,
+    char* readBuf)
+{
+    const int kfsfd = mKfsClient->Open(kfsfilename.c_str(), O_RDONLY);
+    if (kfsfd < 0) {
+        ReportError("verify open", kfsfilename, kfsfd);
+        return(-1);
+    }
+    if (0 < mStartPos) {
+        const int64_t pos = mKfsClient->Seek(kfsfd, mStartPos);
+        if (pos != mStartPos) {
+            ReportError("verify seek", kfsfilename, (int)pos);
+            mKfsClient->Close(kfsfd);
+            return(-1);
+        }
+    }
+    uint32_t checksum = kKfsNullChecksum;
+    int64_t  rem      = result.mSize;
+    while (0 < rem) {
+        const int nRead = mKfsClient->Read(
+            kfsfd, readBuf, (size_t)min(rem, (int64_t)mBufSize));
+        if (nRead < 0) {
+            ReportError("verify read", kfsfilename, nRead);
+            mKfsClient->Close(kfsfd);
+            return(-1);
+        }
+        if (nRead == 0) {
+            break;
+        }
+        checksum = ComputeBlockChecksum(checksum, readBuf, (size_t)nRead);
+        rem -= nRead;
+    }
+    mKfsClient->Close(kfsfd);
+    if (rem != 0 || checksum != result.mChecksum) {
+        cout << "verify " << kfsfilename << ":" <<
+            (rem != 0 ? " short read" : " checksum mismatch") << "\n";
+        return(-1);
+    }
+    result.mVerifiedFlag = true;
+    return 0;
+}
+
 bool
 CpToKfs::Mkdirs(string path)
 {
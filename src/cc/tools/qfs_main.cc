@@ -25,6 +25,7 @@
 //----------------------------------------------------------------------------
 
 #include "FileSystem.h"
+#include "ParallelTreeWalker.h"
 #include "Trash.h"
 
 #include "common/MsgLogger.h"
@@ -98,10 +99,12 @@ public:
           mIoBufferPtr(new char[mIoBufferSize]),
           mDefaultCreateParams("S"), // RS 6+3 64K stripe
           mDelimeter(' '),
-          mConfig()
+          mConfig(),
+          mTreeWalkerPtr(0)
         {}
     ~KfsTool()
     {
+        delete mTreeWalkerPtr;
         delete [] mIoBufferPtr;
     }
     int Run(
@@ -216,6 +219,12 @@ public:
         }
         mDefaultCreateParams = mConfig.getValue(
             "fs.createParams", mDefaultCreateParams);
+        const int theTreeWalkThreads = mConfig.getValue(
+            "fs.treeWalkThreads", 1);
+        if (1 < theTreeWalkThreads) {
+            mTreeWalkerPtr = new ParallelTreeWalker(
+                theTreeWalkThreads, &mConfig);
+        }
         const char* const theCmdPtr  = inArgsPtr[theArgIndex++] + 1;
         if (theCmdPtr[-1] != '-') {
             ShortHelp(cerr);
@@ -959,6 +968,88 @@ private:
         RecursiveApplicator operator=(
             const RecursiveApplicator& inApplicator);
     };
+    // Concurrent version of the recursive applicator, used with
+    // fs.treeWalkThreads > 1. The functor's Apply() is invoked by multiple
+    // threads, after the directory content in post order, or before the sub
+    // directory content in pre order.
+    template<typename T>
+    class ParallelApplicator : public ParallelTreeWalker::Visitor
+    {
+    public:
+        ParallelApplicator(
+            ParallelTreeWalker& inWalker,
+            FileSystem&         inFs,
+            const string&       inPath,
+            ErrorReporter&      inErrorReporter,
+            T&                  inFunctor,
+            bool                inPreOrderFlag = false)
+            : ParallelTreeWalker::Visitor(),
+              mWalker(inWalker),
+              mFs(inFs),
+              mPath(inPath),
+              mErrorReporter(inErrorReporter),
+              mFunctor(inFunctor),
+              mPreOrderFlag(inPreOrderFlag),
+              mMutex()
+            {}
+        int Run()
+            { return mWalker.Run(mFs, mPath, *this); }
+        virtual int Visit(
+            FileSystem&                inFs,
+            const string&              inPath,
+            const FileSystem::StatBuf& inStat)
+        {
+            if (S_ISDIR(inStat.st_mode) &&
+                    (! mPreOrderFlag || inPath == mPath)) {
+                return 0;
+            }
+            return Apply(inFs, inPath, inStat);
+        }
+        virtual int Leave(
+            FileSystem&                inFs,
+            const string&              inPath,
+            const FileSystem::StatBuf& inStat)
+        {
+            if (mPreOrderFlag && inPath != mPath) {
+                return 0;
+            }
+            return Apply(inFs, inPath, inStat);
+        }
+        virtual int Error(
+            FileSystem&   /* inFs */,
+            const string& inPath,
+            int           inStatus)
+        {
+            QCStMutexLocker theLock(mMutex);
+            return mErrorReporter(inPath, inStatus);
+        }
+    private:
+        ParallelTreeWalker& mWalker;
+        FileSystem&         mFs;
+        const string&       mPath;
+        ErrorReporter&      mErrorReporter;
+        T&                  mFunctor;
+        const bool          mPreOrderFlag;
+        QCMutex             mMutex;
+
+        int Apply(
+            FileSystem&                inFs,
+            const string&              inPath,
+            const FileSystem::StatBuf& inStat)
+        {
+            const int theStatus = mFunctor.Apply(inFs, inPath, inStat);
+            if (theStatus == 0) {
+                return 0;
+            }
+            QCStMutexLocker theLock(mMutex);
+            return mErrorReporter(inPath, theStatus);
+        }
+    private:
+        ParallelApplicator(
+            const ParallelApplicator& inApplicator);
+        ParallelApplicator operator=(
+            const ParallelApplicator& inApplicator);
+    };
     typedef vector<pair<FileSystem*, vector<string> > > GlobResult;
     int GetFs(
         const string& inUri,
@@ -1778,27 +1869,44 @@ private:
     {
     public:
         ChownFunctor(
-            const char* inUserNamePtr,
-            const char* inGroupNamePtr,
-            bool        inRecursiveFlag)
+            const char*         inUserNamePtr,
+            const char*         inGroupNamePtr,
+            bool                inRecursiveFlag,
+            ParallelTreeWalker* inTreeWalkerPtr)
             : mUserNamePtr (inUserNamePtr),
               mGroupNamePtr(inGroupNamePtr),
-              mRecursiveFlag(inRecursiveFlag)
+              mRecursiveFlag(inRecursiveFlag),
+              mTreeWalkerPtr(inTreeWalkerPtr)
             {}
         int operator()(
             FileSystem&    inFs,
             const string&  inPath,
             ErrorReporter& inErrorReporter)
         {
+            if (mRecursiveFlag && mTreeWalkerPtr) {
+                ParallelApplicator<ChownFunctor> theApplicator(
+                    *mTreeWalkerPtr, inFs, inPath, inErrorReporter, *this);
+                return theApplicator.Run();
+            }
             return (
                 inFs.Chown(inPath, mUserNamePtr, mGroupNamePtr,
                     mRecursiveFlag, &inErrorReporter)
             );
         }
+        int Apply(
+            FileSystem&                inFs,
+            const string&              inPath,
+            const FileSystem::StatBuf& /* inStat */)
+        {
+            const bool kRecursiveFlag = false;
+            return inFs.Chown(inPath, mUserNamePtr, mGroupNamePtr,
+                kRecursiveFlag, 0);
+        }
     private:
-        const char* const mUserNamePtr;
-        const char* const mGroupNamePtr;
-        const bool        mRecursiveFlag;
+        const char* const         mUserNamePtr;
+        const char* const         mGroupNamePtr;
+        const bool                mRecursiveFlag;
+        ParallelTreeWalker* const mTreeWalkerPtr;
 
     private:
         ChownFunctor(
@@ -1814,20 +1922,22 @@ private:
         bool        inRecursiveFlag)
     {
         ChownFunctor theChownFunc(
-            inUserNamePtr, inGroupNamePtr, inRecursiveFlag);
+            inUserNamePtr, inGroupNamePtr, inRecursiveFlag, mTreeWalkerPtr);
         return ApplyT(inArgsPtr, inArgCount, theChownFunc);
     }
     class ChmodFunctor
     {
     public:
         ChmodFunctor(
-            const char* inModePtr,
-            bool        inRecursiveFlag)
+            const char*         inModePtr,
+            bool                inRecursiveFlag,
+            ParallelTreeWalker* inTreeWalkerPtr)
             : mMode(inModePtr ? inModePtr : ""),
               mModeStatus(0),
               mSetModeFlag(false),
               mModeToSet(0),
               mRecursiveFlag(inRecursiveFlag),
+              mTreeWalkerPtr(inTreeWalkerPtr),
               mStat()
         {
             if (mMode.empty()) {
@@ -1851,6 +1961,14 @@ private:
             if (mModeStatus != 0) {
                 return mModeStatus;
             }
+            if (mRecursiveFlag && mTreeWalkerPtr) {
+                // Change directories mode before traversing them, with
+                // symbolic mode, in order to allow adding permissions.
+                ParallelApplicator<ChmodFunctor> theApplicator(
+                    *mTreeWalkerPtr, inFs, inPath, inErrorReporter, *this,
+                    ! mSetModeFlag);
+                return theApplicator.Run();
+            }
             if (mSetModeFlag) {
                 return inFs.Chmod(inPath, mModeToSet, mRecursiveFlag,
                     &inErrorReporter);
@@ -1884,15 +2002,26 @@ private:
             }
             return (theStatus == 0);
         }
+        int Apply(
+            FileSystem&                inFs,
+            const string&              inPath,
+            const FileSystem::StatBuf& inStat)
+        {
+            const bool kRecursiveFlag = false;
+            return inFs.Chmod(inPath,
+                mSetModeFlag ? mModeToSet : GetMode(inStat.st_mode),
+                kRecursiveFlag, 0);
+        }
         int GetModeStatus() const
             { return mModeStatus; }
     private:
-        const string        mMode;
-        int                 mModeStatus;
-        bool                mSetModeFlag;
-        kfsMode_t           mModeToSet;
-        const bool          mRecursiveFlag;
-        FileSystem::StatBuf mStat;
+        const string              mMode;
+        int                       mModeStatus;
+        bool                      mSetModeFlag;
+        kfsMode_t                 mModeToSet;
+        const bool                mRecursiveFlag;
+        ParallelTreeWalker* const mTreeWalkerPtr;
+        FileSystem::StatBuf       mStat;
 
         enum
         {
@@ -1903,7 +2032,7 @@ private:
         };
 
         kfsMode_t GetMode(
-            kfsMode_t inMode)
+            kfsMode_t inMode) const
         {
             kfsMode_t theMode     = inMode & (0777 | S_ISVTX);
             int       theDest     = 0;
@@ -2010,7 +2139,7 @@ private:
         const char* inModePtr,
         bool        inRecursiveFlag)
     {
-        ChmodFunctor theChmodFunc(inModePtr, inRecursiveFlag);
+        ChmodFunctor theChmodFunc(inModePtr, inRecursiveFlag, mTreeWalkerPtr);
         const int theStatus = theChmodFunc.GetModeStatus();
         if (theStatus != 0) {
             cerr << "invalid mode string: " <<
@@ -3617,22 +3746,42 @@ private:
     {
     public:
         SetReplicationFunctor(
-            int  inReplication,
-            bool inRecursiveFlag)
+            int                 inReplication,
+            bool                inRecursiveFlag,
+            ParallelTreeWalker* inTreeWalkerPtr)
             : mReplication(inReplication),
-              mRecursiveFlag(inRecursiveFlag)
+              mRecursiveFlag(inRecursiveFlag),
+              mTreeWalkerPtr(inTreeWalkerPtr)
             {}
         int operator()(
             FileSystem&    inFs,
             const string&  inPath,
             ErrorReporter& inErrorReporter)
         {
+            if (mRecursiveFlag && mTreeWalkerPtr) {
+                ParallelApplicator<SetReplicationFunctor> theApplicator(
+                    *mTreeWalkerPtr, inFs, inPath, inErrorReporter, *this);
+                return theApplicator.Run();
+            }
             return inFs.SetReplication(
                 inPath, mReplication, mRecursiveFlag, &inErrorReporter);
         }
+        int Apply(
+            FileSystem&                inFs,
+            const string&              inPath,
+            const FileSystem::StatBuf& inStat)
+        {
+            if (S_ISDIR(inStat.st_mode)) {
+                return 0;
+            }
+            const bool kRecursiveFlag = false;
+            return inFs.SetReplication(
+                inPath, mReplication, kRecursiveFlag, 0);
+        }
     private:
-        const int  mReplication;
-        const bool mRecursiveFlag;
+        const int                 mReplication;
+        const bool                mRecursiveFlag;
+        ParallelTreeWalker* const mTreeWalkerPtr;
 
         SetReplicationFunctor(
             const SetReplicationFunctor& inFunctor);
@@ -3747,7 +3896,8 @@ private:
             theResult,
             theMoreThanOneFsFlag
         );
-        SetReplicationFunctor theSetReplFunc(inReplication, inRecursiveFlag);
+        SetReplicationFunctor theSetReplFunc(
+            inReplication, inRecursiveFlag, mTreeWalkerPtr);
         FunctorT<SetReplicationFunctor> theFunc(theSetReplFunc, cerr);
         int theStatus = Apply(theResult, theMoreThanOneFsFlag, theErr, theFunc);
         if (theStatus != 0 || ! inWaitFlag) {
@@ -4006,14 +4156,16 @@ private:
     {
     public:
         RemoveFunctor(
-            bool              inSkipTrashFlag,
-            bool              inRecursiveFlag,
-            ostream*          inProgressStreamPtr,
-            const Properties& inConfig)
+            bool                inSkipTrashFlag,
+            bool                inRecursiveFlag,
+            ostream*            inProgressStreamPtr,
+            const Properties&   inConfig,
+            ParallelTreeWalker* inTreeWalkerPtr)
             : mSkipTrashFlag(inSkipTrashFlag),
               mRecursiveFlag(inRecursiveFlag),
               mProgressStreamPtr(inProgressStreamPtr),
               mConfig(inConfig),
+              mTreeWalkerPtr(inTreeWalkerPtr),
               mTrashPtr(0),
               mFsPtr(0),
               mStat(),
@@ -4029,6 +4181,11 @@ private:
             ErrorReporter& inErrorReporter)
         {
             if (mSkipTrashFlag) {
+                if (mRecursiveFlag && mTreeWalkerPtr) {
+                    ParallelApplicator<RemoveFunctor> theApplicator(
+                        *mTreeWalkerPtr, inFs, inPath, inErrorReporter, *this);
+                    return theApplicator.Run();
+                }
                 return inFs.Remove(inPath, mRecursiveFlag, &inErrorReporter);
             }
             if (! mRecursiveFlag) {
@@ -4060,12 +4217,25 @@ private:
             mMessage.clear();
             return theStatus;
         }
+        int Apply(
+            FileSystem&                inFs,
+            const string&              inPath,
+            const FileSystem::StatBuf& inStat)
+        {
+            if (S_ISDIR(inStat.st_mode)) {
+                // Remove root directory content only, like Rmdirs() does.
+                return (inPath == "/" ? 0 : inFs.Rmdir(inPath));
+            }
+            const bool kRecursiveFlag = false;
+            return inFs.Remove(inPath, kRecursiveFlag, 0);
+        }
     private:
-        const bool          mSkipTrashFlag;
-        const bool          mRecursiveFlag;
-        ostream* const      mProgressStreamPtr;
-        const Properties&   mConfig; 
-        Trash*              mTrashPtr;
+        const bool                mSkipTrashFlag;
+        const bool                mRecursiveFlag;
+        ostream* const            mProgressStreamPtr;
+        const Properties&         mConfig; 
+        ParallelTreeWalker* const mTreeWalkerPtr;
+        Trash*                    mTrashPtr;
         FileSystem*         mFsPtr;
         FileSystem::StatBuf mStat;
         string              mMessage;
@@ -4083,7 +4253,7 @@ private:
         bool   inRecursiveFlag)
     {
         RemoveFunctor theRemoveFunc(
-            inSkipTrashFlag, inRecursiveFlag, &cout, mConfig);
+            inSkipTrashFlag, inRecursiveFlag, &cout, mConfig, mTreeWalkerPtr);
         return ApplyT(inArgsPtr, inArgCount, theRemoveFunc);
     }
     int RunEmptier()
@@ -4527,6 +4697,7 @@ private:
     string       mDefaultCreateParams;
     char         mDelimeter;
     Properties   mConfig;
+    ParallelTreeWalker* mTreeWalkerPtr;
 private:
     KfsTool(const KfsTool& inTool);
     KfsTool& operator=(const KfsTool& inTool);
@@ -4589,6 +4760,10 @@ const char* const KfsTool::sHelpStrings[] =
     "fs.readFullSparseFileSupport = 0\n\t\t\t"
         "zero fill holes, instead of declaring an error.\n\t\t\t"
         "Only has effect with QFS.\n\t\t"
+    "fs.treeWalkThreads       = 1\n\t\t\t"
+        "number of threads, and file system instances, used to\n\t\t\t"
+        "traverse directory trees with -chmod -R, -chown -R,\n\t\t\t"
+        "-setrep -R, and -rmr -skipTrash\n\t\t"
     "fs.columnSeparator\n\t\t\t"
         "set -ls[rst]* and -count column delimiter (single character).\n\t\t\t"
         "C escape sequences can be used to specify character code.\n\t\t"
@@ -28,35 +28,130 @@
 // all.  When all values agree, we know that the data we wrote to KFS
 // matches what is in the source.
 //
+// Whole directory trees can be audited in parallel on multiple hosts: the plan
+// mode partitions the files by the location of their first chunk replicas
+// into the per host file lists, each host verifies its list, and the
+// aggregate mode combines the per host results.
+//
 //----------------------------------------------------------------------------
 
+#include "ParallelCopy.h"
+
 #include "common/MsgLogger.h"
 #include "libclient/KfsClient.h"
+#include "qcdio/QCMutex.h"
+#include "qcdio/qcstutils.h"
 
 #include <string>
+#include <vector>
 #include <iostream>
+#include <fstream>
+#include <algorithm>
 #include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+namespace KFS
+{
 
 using std::cout;
 using std::cerr;
 using std::string;
+using std::vector;
+using std::ifstream;
+using std::ofstream;
+using std::max;
+using tools::ParallelCopy;
+
+class QfsDataVerify : private ParallelCopy::Copier
+{
+public:
+    QfsDataVerify()
+        : ParallelCopy::Copier(),
+          mKfsClient(0),
+          mCheckCksumsFlag(false),
+          mCheckReplicasFlag(false),
+          mMutex(),
+          mOkCount(0),
+          mMismatchCount(0),
+          mErrorCount(0),
+          mParallelCopy(*this, cerr)
+        {}
+    virtual ~QfsDataVerify()
+    {
+        mParallelCopy.Finish();
+        delete mKfsClient;
+    }
+
+    int Run(int argc, char **argv);
+
+private:
+    struct Worker
+    {
+        Worker(const string& name = string())
+            : mName(name),
+              mFileCount(0),
+              mByteCount(0),
+              mList()
+            {}
+        string   mName;
+        int64_t  mFileCount;
+        int64_t  mByteCount;
+        ofstream mList;
+    };
+
+    KfsClient*   mKfsClient;
+    bool         mCheckCksumsFlag;
+    bool         mCheckReplicasFlag;
+    QCMutex      mMutex;
+    int64_t      mOkCount;
+    int64_t      mMismatchCount;
+    int64_t      mErrorCount;
+    ParallelCopy mParallelCopy;
+
+    // Verify single file, and report the result in the human readable form.
+    int VerifyFile(const char* kfsFilename);
+
+    // Queue all files in the directory tree for verification.
+    int VerifyTree(const string& kfsPath);
 
-using namespace KFS;
+    // Queue all files listed in the file list for verification.
+    int VerifyList(const char* listFileName);
+
+    // Invoked by parallel copy to verify a file. The mismatch and errors are
+    // reported in the results, and do not stop the verification.
+    virtual int Copy(const string& kfsfilename, const string& dst,
+        ParallelCopy& parallelCopy, ParallelCopy::Result& result);
+
+    // Partition the files in the directory tree between the workers, and
+    // write the per worker file lists.
+    int Plan(const string& kfsPath, const char* workers, const char* prefix);
+    int PlanTree(const string& kfsPath, vector<Worker*>& workers);
+
+    // Combine the per worker results.
+    int Aggregate(int count, char** fileNames);
+};
 
 int
-main(int argc, char **argv)
+QfsDataVerify::Run(int argc, char **argv)
 {
     int         optchar;
     bool        help           = false;
     int         port           = -1;
     const char* metaserver     = 0;
     const char* kfsFilename    = 0;
-    bool        checkCksums    = false;
     bool        verboseLogging = false;
-    bool        checkReplicas  = false;
     const char* config         = 0;
+    const char* listFileName   = 0;
+    const char* workers        = 0;
+    const char* planPrefix     = 0;
+    const char* manifest       = 0;
+    int         threads        = 1;
+    int         progress       = 0;
+    bool        aggregate      = false;
 
-    while ((optchar = getopt(argc, argv, "s:p:k:chdvf:")) != -1) {
+    while ((optchar = getopt(argc, argv, "s:p:k:chdvf:i:W:L:j:o:t:A")) != -1) {
         switch (optchar) {
             case 's':
                 metaserver = optarg;
@@ -68,10 +163,10 @@ main(int argc, char **argv)
                 kfsFilename = optarg;
                 break;
             case 'd':
-                checkReplicas = true;
+                mCheckReplicasFlag = true;
                 break;
             case 'c':
-                checkCksums = true;
+                mCheckCksumsFlag = true;
                 break;
             case 'v':
                 verboseLogging = true;
@@ -79,6 +174,27 @@ main(int argc, char **argv)
             case 'f':
                 config = optarg;
                 break;
+            case 'i':
+                listFileName = optarg;
+                break;
+            case 'W':
+                workers = optarg;
+                break;
+            case 'L':
+                planPrefix = optarg;
+                break;
+            case 'j':
+                threads = atoi(optarg);
+                break;
+            case 'o':
+                manifest = optarg;
+                break;
+            case 't':
+                progress = atoi(optarg);
+                break;
+            case 'A':
+                aggregate = true;
+                break;
             case 'h':
             default:
                 help = true;
@@ -86,30 +202,91 @@ main(int argc, char **argv)
         }
     }
 
-    help = help || (!metaserver) || (port < 0) || !kfsFilename;
+    if (aggregate && ! help) {
+        return Aggregate(argc - optind, argv + optind);
+    }
+
+    const bool plan = workers || planPrefix;
+    help = help || (!metaserver) || (port < 0) ||
+        (!kfsFilename && !listFileName) || threads < 1 ||
+        (plan && (!workers || !planPrefix || !kfsFilename)) ||
+        (listFileName && !mCheckCksumsFlag && !mCheckReplicasFlag);
 
     if (help) {
         cout << "Usage: " << argv[0] <<
-            " -s <metaserver> -p <port> -k <QFSfile> [-c|-d] [-v]"
-            " [-f <config file name>]\n"
+            " -s <metaserver> -p <port> {-k <QFS path>|-i <file list>}"
+            " [-c|-d] [-v] [-f <config file name>]\n"
+            " [-j <threads>] [-o <manifest>] [-t <progress interval>]\n"
             " -c: compare checksums on the replicas.\n"
-            " -d: compare the chunks and return md5 of the file.\n";
+            " -d: compare the chunks and return md5 of the file.\n"
+            " -k: file or directory; all files in the directory tree are"
+                " verified.\n"
+            " -i: verify files listed in the file, one path per line.\n"
+            " -j: number of files to verify in parallel, default 1.\n"
+            " -o: manifest file name: record verified files, and skip"
+                " files already recorded, in order to resume verification.\n"
+            " -t: progress report interval in seconds, default 0 -- none.\n"
+            "Plan: " << argv[0] <<
+            " -s <metaserver> -p <port> -k <QFS path> -W <host1,host2,...>"
+            " -L <list prefix>\n"
+            " assign each file to a host holding the replica of its first"
+                " chunk, and write\n"
+            " the <list prefix><host> file lists for use with -i. Host"
+                " names must match\n"
+            " the chunk server names reported by the meta server.\n"
+            "Aggregate: " << argv[0] << " -A <results file> ...\n"
+            " combine the results of -k directory or -i runs, and print the"
+                " files that\n"
+            " failed verification.\n";
         return -1;
     }
 
     MsgLogger::Init(0, verboseLogging ?
         MsgLogger::kLogLevelDEBUG : MsgLogger::kLogLevelINFO);
 
-    KfsClient* const kfsClient = KfsClient::Connect(metaserver, port, config);
-    if (! kfsClient) {
+    mKfsClient = KfsClient::Connect(metaserver, port, config);
+    if (! mKfsClient) {
         cout << "qfs client failed to initialize\n";
         return 1;
     }
 
+    if (plan) {
+        return (Plan(kfsFilename, workers, planPrefix) == 0 ? 0 : 1);
+    }
+    if (! listFileName) {
+        KfsFileAttr attr;
+        const int   ret = mKfsClient->Stat(kfsFilename, attr);
+        if (ret < 0) {
+            cerr << kfsFilename << ": " << ErrorCodeToStr(ret) << "\n";
+            return 1;
+        }
+        if (! attr.isDirectory) {
+            return (VerifyFile(kfsFilename) == 0 ? 0 : 1);
+        }
+        if (!mCheckCksumsFlag && !mCheckReplicasFlag) {
+            return 0;
+        }
+    }
+    if (mParallelCopy.Start(threads, progress, manifest) != 0) {
+        return 1;
+    }
+    const int ret = listFileName ?
+        VerifyList(listFileName) : VerifyTree(kfsFilename);
+    const int status = mParallelCopy.Finish();
+    cerr << "verified: " << mOkCount <<
+        " mismatch: " << mMismatchCount <<
+        " error: "    << mErrorCount << "\n";
+    return ((ret == 0 && status == 0 &&
+        mMismatchCount == 0 && mErrorCount == 0) ? 0 : 1);
+}
+
+int
+QfsDataVerify::VerifyFile(const char* kfsFilename)
+{
     int ret = 0;
-    if (checkReplicas) {
+    if (mCheckReplicasFlag) {
         string md5sum;
-        ret = kfsClient->CompareChunkReplicas(kfsFilename, md5sum);
+        ret = mKfsClient->CompareChunkReplicas(kfsFilename, md5sum);
         if (ret < 0) {
            cerr << kfsFilename << ": " << ErrorCodeToStr(ret) << "\n";
         } else if (ret == 0) {
@@ -118,8 +295,8 @@ main(int argc, char **argv)
         } else {
             cerr << kfsFilename << ": chunk replicas are not identical.\n";
         }
-    } else if (checkCksums) {
-        ret = kfsClient->VerifyDataChecksums(kfsFilename);
+    } else if (mCheckCksumsFlag) {
+        ret = mKfsClient->VerifyDataChecksums(kfsFilename);
         if (ret < 0) {
            cerr << kfsFilename << ": " << ErrorCodeToStr(ret) << "\n";
         } else if (ret == 0) {
@@ -130,8 +307,245 @@ main(int argc, char **argv)
                 ": chunk replicas checksums are not identical.\n";
         }
     }
-    delete kfsClient;
-    return (ret == 0 ? 0 : 1);
+    return ret;
+}
+
+int
+QfsDataVerify::VerifyTree(const string& kfsPath)
+{
+    vector<KfsFileAttr> fileInfo;
+    int ret = mKfsClient->ReaddirPlus(kfsPath.c_str(), fileInfo);
+    if (ret < 0) {
+        cerr << kfsPath << ": " << ErrorCodeToStr(ret) << "\n";
+        return ret;
+    }
+    const string dir = (kfsPath.empty() || kfsPath[kfsPath.size() - 1] != '/') ?
+        kfsPath + "/" : kfsPath;
+    for (vector<KfsFileAttr>::const_iterator it = fileInfo.begin();
+            it != fileInfo.end() && ret == 0;
+            ++it) {
+        if (it->isDirectory) {
+            if (it->filename == "." || it->filename == "..") {
+                continue;
+            }
+            ret = VerifyTree(dir + it->filename);
+        } else {
+            ret = mParallelCopy.Add(dir + it->filename, dir + it->filename);
+        }
+    }
+    return ret;
+}
+
+int
+QfsDataVerify::VerifyList(const char* listFileName)
+{
+    ifstream list(listFileName);
+    if (! list) {
+        const int err = errno;
+        cerr << listFileName << ": " << strerror(err) << "\n";
+        return -err;
+    }
+    string path;
+    int    ret = 0;
+    while (ret == 0 && getline(list, path)) {
+        if (! path.empty()) {
+            ret = mParallelCopy.Add(path, path);
+        }
+    }
+    if (ret == 0 && list.bad()) {
+        const int err = errno;
+        cerr << listFileName << ": " << strerror(err) << "\n";
+        ret = -err;
+    }
+    return ret;
+}
+
+int
+QfsDataVerify::Copy(const string& kfsfilename, const string& /* dst */,
+    ParallelCopy& /* parallelCopy */, ParallelCopy::Result& result)
+{
+    string md5sum;
+    const int ret = mCheckReplicasFlag ?
+        mKfsClient->CompareChunkReplicas(kfsfilename.c_str(), md5sum) :
+        mKfsClient->VerifyDataChecksums(kfsfilename.c_str());
+    QCStMutexLocker lock(mMutex);
+    // Results format: <status> [<error code>|<md5>] <path>
+    if (ret < 0) {
+        mErrorCount++;
+        cout << "error " << ret << " " << kfsfilename << "\n";
+    } else if (ret == 0) {
+        mOkCount++;
+        cout << "ok " << (md5sum.empty() ? string("-") : md5sum) << " " <<
+            kfsfilename << "\n";
+        result.mVerifiedFlag = true;
+    } else {
+        mMismatchCount++;
+        cout << "mismatch - " << kfsfilename << "\n";
+    }
+    cout.flush();
+    return 0;
+}
+
+int
+QfsDataVerify::Plan(const string& kfsPath, const char* workers,
+    const char* prefix)
+{
+    vector<Worker*> list;
+    for (const char* p = workers; *p; ) {
+        const char* e = strchr(p, ',');
+        if (! e) {
+            e = p + strlen(p);
+        }
+        if (p < e) {
+            list.push_back(new Worker(string(p, e - p)));
+        }
+        p = *e ? e + 1 : e;
+    }
+    int ret = list.empty() ? -EINVAL : 0;
+    for (vector<Worker*>::const_iterator it = list.begin();
+            it != list.end() && ret == 0;
+            ++it) {
+        const string name = prefix + (*it)->mName;
+        (*it)->mList.open(name.c_str());
+        if (! (*it)->mList) {
+            ret = -errno;
+            cerr << name << ": " << strerror(-ret) << "\n";
+        }
+    }
+    if (ret == 0) {
+        ret = PlanTree(kfsPath, list);
+    }
+    for (vector<Worker*>::const_iterator it = list.begin();
+            it != list.end();
+            ++it) {
+        if ((*it)->mList.is_open()) {
+            (*it)->mList.close();
+            if (! (*it)->mList && ret == 0) {
+                ret = -EIO;
+                cerr << prefix << (*it)->mName << ": write failure\n";
+            }
+        }
+        if (ret == 0) {
+            cerr << (*it)->mName <<
+                " files: " << (*it)->mFileCount <<
+                " bytes: " << (*it)->mByteCount << "\n";
+        }
+        delete *it;
+    }
+    return ret;
 }
 
+int
+QfsDataVerify::PlanTree(const string& kfsPath, vector<Worker*>& workers)
+{
+    vector<KfsFileAttr> fileInfo;
+    int ret = mKfsClient->ReaddirPlus(kfsPath.c_str(), fileInfo);
+    if (ret < 0) {
+        cerr << kfsPath << ": " << ErrorCodeToStr(ret) << "\n";
+        return ret;
+    }
+    const string dir = (kfsPath.empty() || kfsPath[kfsPath.size() - 1] != '/') ?
+        kfsPath + "/" : kfsPath;
+    vector<vector<string> > locations;
+    for (vector<KfsFileAttr>::const_iterator it = fileInfo.begin();
+            it != fileInfo.end() && ret == 0;
+            ++it) {
+        const string path = dir + it->filename;
+        if (it->isDirectory) {
+            if (it->filename == "." || it->filename == "..") {
+                continue;
+            }
+            ret = PlanTree(path, workers);
+            continue;
+        }
+        locations.clear();
+        if (0 < it->fileSize) {
+            const int res = mKfsClient->GetDataLocation(
+                path.c_str(), 0, 1, locations);
+            if (res < 0) {
+                // Verification will report the error, assign to any worker.
+                KFS_LOG_STREAM_ERROR << path << ": " << ErrorCodeToStr(res) <<
+                KFS_LOG_EOM;
+                locations.clear();
+            }
+        }
+        // Pick the least loaded worker holding the replica, or the least
+        // loaded worker if no worker has replica.
+        Worker* worker = 0;
+        for (int pass = 0; pass < 2 && ! worker; pass++) {
+            for (vector<Worker*>::const_iterator wi = workers.begin();
+                    wi != workers.end();
+                    ++wi) {
+                if (worker && worker->mByteCount <= (*wi)->mByteCount) {
+                    continue;
+                }
+                if (pass == 0) {
+                    if (locations.empty()) {
+                        break;
+                    }
+                    const vector<string>& hosts = locations.front();
+                    vector<string>::const_iterator hi = hosts.begin();
+                    while (hi != hosts.end() && *hi != (*wi)->mName) {
+                        ++hi;
+                    }
+                    if (hi == hosts.end()) {
+                        continue;
+                    }
+                }
+                worker = *wi;
+            }
+        }
+        worker->mFileCount++;
+        worker->mByteCount += max(chunkOff_t(0), it->fileSize);
+        worker->mList << path << "\n";
+    }
+    return ret;
+}
 
+int
+QfsDataVerify::Aggregate(int count, char** fileNames)
+{
+    int64_t ok       = 0;
+    int64_t mismatch = 0;
+    int64_t errors   = 0;
+    int     ret      = 0;
+    for (int i = 0; i < count; i++) {
+        ifstream results(fileNames[i]);
+        if (! results) {
+            const int err = errno;
+            cerr << fileNames[i] << ": " << strerror(err) << "\n";
+            ret = -err;
+            continue;
+        }
+        string line;
+        while (getline(results, line)) {
+            if (line.compare(0, 3, "ok ") == 0) {
+                ok++;
+            } else if (line.compare(0, 9, "mismatch ") == 0) {
+                mismatch++;
+                cout << line << "\n";
+            } else if (line.compare(0, 6, "error ") == 0) {
+                errors++;
+                cout << line << "\n";
+            }
+        }
+        if (results.bad()) {
+            const int err = errno;
+            cerr << fileNames[i] << ": " << strerror(err) << "\n";
+            ret = -err;
+        }
+    }
+    cerr << "verified: " << ok <<
+        " mismatch: " << mismatch <<
+        " error: "    << errors << "\n";
+    return ((ret == 0 && mismatch == 0 && errors == 0) ? 0 : 1);
+}
+
+} // namespace KFS
+
+int
+main(int argc, char **argv)
+{
+    KFS::QfsDataVerify qfsDataVerify;
+    return qfsDataVerify.Run(argc, argv);
+}
@@ -32,6 +32,7 @@
 
 #include <iostream>
 #include <string>
+#include <sstream>
 
 
 using namespace KFS;
@@ -40,6 +41,7 @@ using namespace KFS::client;
 
 using std::string;
 using std::cout;
+using std::ostringstream;
 
 static int
 StatsMetaServer(MonClient& client, const ServerLocation &location,
@@ -68,6 +70,12 @@ RpcStatsChunkServer(MonClient& client, const ServerLocation &location,
 static void
 PrintChunkBasicStatsHeader();
 
+static void
+PrintLatencyHistogram(const string &opName, Properties &prop);
+
+static void
+PrintClientIoStats(Properties &prop);
+
 static void
 PrintMetaBasicStatsHeader();
 
@@ -302,6 +310,11 @@ RpcStatsChunkServer(MonClient& client, const ServerLocation& loc, int numSecs)
         PrintRpcStat("Heartbeat", op.stats);
         PrintRpcStat("Change Chunk Vers", op.stats);
         PrintRpcStat("Num ops", op.stats);
+        PrintLatencyHistogram("Read", op.stats);
+        PrintLatencyHistogram("Write Prepare", op.stats);
+        PrintLatencyHistogram("Record append", op.stats);
+        PrintLatencyHistogram("Replicate", op.stats);
+        PrintClientIoStats(op.stats);
         cout << "----------------------------------" << "\n";
         if (numSecs == 0) {
             break;
@@ -311,6 +324,43 @@ RpcStatsChunkServer(MonClient& client, const ServerLocation& loc, int numSecs)
     return 0;
 }
 
+// The chunk server reports op latency histogram buckets as counters with the
+// bucket upper bound in ms in the counter name, with 4x bucket size increase.
+static void
+PrintLatencyHistogram(const string &opName, Properties &prop)
+{
+    const int kBucketCount = 8;
+    int64_t   maxMs        = 1;
+    for (int i = 0; i < kBucketCount; i++, maxMs <<= 2) {
+        ostringstream os;
+        os << opName << (i < kBucketCount - 1 ? " Latency Under " :
+            " Latency Over ") << (i < kBucketCount - 1 ? maxMs : maxMs >> 2) <<
+            "ms";
+        PrintRpcStat(os.str(), prop);
+    }
+}
+
+// The chunk server reports the heaviest clients, by bytes plus per op weight,
+// in "Client-io-<rank>" counters, heaviest first.
+static void
+PrintClientIoStats(Properties &prop)
+{
+    for (int i = 0; ; i++) {
+        ostringstream os;
+        os << "Client-io-" << i;
+        const string val = prop.getValue(os.str(), string());
+        if (val.empty()) {
+            break;
+        }
+        if (i == 0) {
+            cout << "Top clients:"
+                " client\tweight\terror\tread-bytes\twrite-bytes"
+                "\tops\terrors\n";
+        }
+        cout << val << "\n";
+    }
+}
+
 int
 BasicStatsChunkServer(MonClient& client, const ServerLocation& loc, int numSecs)
 {
@@ -90,6 +90,21 @@ class QFSInputStream extends FSInputStream {
     return res;
   }
 
+  // PositionedReadable read: does not change the stream position, and does
+  // not disturb the sequential read ahead, unlike seek and read.
+  public int read(long position, byte[] buffer, int offset, int length)
+    throws IOException {
+    if (length == 0) {
+      return 0;
+    }
+    final int res = kfsChannel.pread(position,
+        ByteBuffer.wrap(buffer, offset, length));
+    if (res > 0 && statistics != null) {
+      statistics.incrementBytesRead(res);
+    }
+    return res;
+  }
+
   public synchronized void close() throws IOException {
     kfsChannel.close();
   }
@@ -85,6 +85,10 @@ final public class KfsAccess
     private final static native
     String[][] getBlocksLocation(long ptr, String path, long start, long len);
 
+    private final static native
+    long getBlocksLocationPacked(long ptr, String path, long start, long len,
+        KfsBlocksLocation result);
+
     private final static native
     short getReplication(long ptr, String path);
 
@@ -720,6 +724,27 @@ final public class KfsAccess
         return ret;
     }
 
+    // Same as kfs_getBlocksLocation(), but returns the locations in packed
+    // form, in order to avoid per block array and string construction.
+    public KfsBlocksLocation kfs_getBlocksLocationPacked(
+        String path, long start, long len) throws IOException
+    {
+        final KfsBlocksLocation result = new KfsBlocksLocation();
+        final long ret = getBlocksLocationPacked(cPtr, path, start, len, result);
+        if (ret < 0) {
+            kfs_retToIOException((int)ret, path);
+        }
+        result.blockSize = ret;
+        return result;
+    }
+
+    // Create queue for asynchronous reads and writes of the files opened with
+    // this instance.
+    public KfsAsyncIoQueue kfs_createAsyncIoQueue()
+    {
+        return new KfsAsyncIoQueue(this);
+    }
+
     // Return the degree of replication for this file
     public short kfs_getReplication(String path)
     {
@@ -0,0 +1,119 @@
+/**
+ * $Id$
+ *
+ * Copyright 2026 Quantcast Corp.
+ *
+ * This file is part of Kosmos File System (KFS).
+ *
+ * Licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ *
+ * \brief Asynchronous positioned reads and writes into direct byte buffers.
+ * Multiple requests are submitted with a single JNI call, and the completions
+ * are polled in batches. The buffer content must not be accessed, and for
+ * writes must not be modified, until the request completion is returned by
+ * poll().
+ */
+
+package com.quantcast.qfs.access;
+
+import java.io.IOException;
+import java.nio.ByteBuffer;
+
+final public class KfsAsyncIoQueue
+{
+    private long      qPtr;
+    private KfsAccess kfsAccess;
+
+    private final static native
+    long create();
+
+    private final static native
+    void destroy(long qPtr);
+
+    private final static native
+    int submit(long cPtr, long qPtr, boolean write, int[] fds,
+        long[] positions, ByteBuffer[] bufs, int[] begins, int[] ends,
+        long[] tags, int count, int[] results);
+
+    private final static native
+    int poll(long qPtr, long[] tags, long[] statuses, int waitMs);
+
+    KfsAsyncIoQueue(KfsAccess ka)
+    {
+        kfsAccess = ka;
+        qPtr = create();
+        if (qPtr == 0) {
+            throw new OutOfMemoryError();
+        }
+    }
+
+    // Queues count reads or writes of buffer ranges [begins[i], ends[i]) at
+    // the file positions[i]. Returns the number of requests queued. The
+    // results[i] is set to the number of bytes queued, possibly less than
+    // requested at the end of file, or negative status code that can be
+    // converted into exception with KfsAccess.kfs_retToIOException(). The
+    // completion with the request tag is returned by poll() only for the
+    // requests with positive number of bytes queued.
+    public synchronized int submit(boolean write, int[] fds, long[] positions,
+        ByteBuffer[] bufs, int[] begins, int[] ends, long[] tags, int count,
+        int[] results) throws IOException
+    {
+        if (qPtr == 0) {
+            throw new IOException("Queue closed");
+        }
+        final int ret = submit(kfsAccess.getCPtr(), qPtr, write, fds,
+            positions, bufs, begins, ends, tags, count, results);
+        kfsAccess.kfs_retToIOException(ret);
+        return ret;
+    }
+
+    // Returns up to tags.length completions, with the tags and the number of
+    // bytes read or written, or negative status codes. Waits up to waitMs
+    // milliseconds for at least one completion, or indefinitely if negative,
+    // unless no requests are in flight.
+    public int poll(long[] tags, long[] statuses, int waitMs)
+        throws IOException
+    {
+        final long ptr;
+        synchronized (this) {
+            ptr = qPtr;
+        }
+        if (ptr == 0) {
+            throw new IOException("Queue closed");
+        }
+        final int ret = poll(ptr, tags, statuses, waitMs);
+        kfsAccess.kfs_retToIOException(ret);
+        return ret;
+    }
+
+    // Waits for all in flight requests to complete, and discards the
+    // completions. Must not be invoked concurrently with poll().
+    public synchronized void close()
+    {
+        if (qPtr == 0) {
+            return;
+        }
+        final long ptr = qPtr;
+        qPtr = 0;
+        destroy(ptr);
+    }
+
+    protected void finalize() throws Throwable
+    {
+        try {
+            close();
+        } finally {
+            super.finalize();
+        }
+    }
+}
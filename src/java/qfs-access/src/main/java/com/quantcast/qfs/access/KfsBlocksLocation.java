@@ -0,0 +1,56 @@
+/**
+ * $Id$
+ *
+ * Copyright 2026 Quantcast Corp.
+ *
+ * This file is part of Kosmos File System (KFS).
+ *
+ * Licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ *
+ * \brief "Chunk blocks" locations in packed form, returned by
+ * KfsAccess.kfs_getBlocksLocationPacked(). The host names are stored only
+ * once, and the block locations are represented as host name indexes, in
+ * order to avoid per block array and string construction.
+ */
+
+package com.quantcast.qfs.access;
+
+public class KfsBlocksLocation
+{
+    public KfsBlocksLocation() {}
+    // "Chunk block" size.
+    public long     blockSize;
+    // Host names with no port numbers.
+    public String[] hosts;
+    // The locations of block i are locations[blockStarts[i]] through
+    // locations[blockStarts[i + 1] - 1], blockStarts has getBlockCount() + 1
+    // entries.
+    public int[]    blockStarts;
+    // Host name indexes.
+    public int[]    locations;
+
+    public int getBlockCount()
+    {
+        return blockStarts == null ? 0 : blockStarts.length - 1;
+    }
+
+    public int getLocationCount(int block)
+    {
+        return blockStarts[block + 1] - blockStarts[block];
+    }
+
+    public String getLocation(int block, int idx)
+    {
+        return hosts[locations[blockStarts[block] + idx]];
+    }
+}
@@ -42,10 +42,21 @@ final public class KfsInputChannel implements ReadableByteChannel, Positionable
     private int kfsFd = -1;
     private KfsAccess kfsAccess;
     private boolean isReadAheadOff = false;
+    // Direct destination buffers of at least this size are read into
+    // directly, without staging the data in the channel buffer.
+    private final static int DIRECT_READ_MIN_SIZE = 64 << 10;
 
     private final static native
     int read(long cPtr, int fd, ByteBuffer buf, int begin, int end);
 
+    private final static native
+    long readv(long cPtr, int fd, ByteBuffer buf, long[] positions,
+        int[] begins, int[] ends, int[] results);
+
+    private final static native
+    int pread(long cPtr, int fd, long position, ByteBuffer buf, int begin,
+        int end);
+
     KfsInputChannel(KfsAccess ka, int fd) 
     {
         readBuffer = BufferPool.getInstance().getBuffer();
@@ -76,6 +87,17 @@ final public class KfsInputChannel implements ReadableByteChannel, Positionable
         while (dst.hasRemaining()) {
             // Fill input buffer if it's empty
             if (!readBuffer.hasRemaining()) {
+                if (dst.isDirect() &&
+                        DIRECT_READ_MIN_SIZE <= dst.remaining()) {
+                    // Read directly into the destination, this saves one
+                    // copy. The buffered data, if any, is already consumed.
+                    final int pos = dst.position();
+                    readDirect(dst, dst.remaining());
+                    if (dst.position() == pos) {
+                        break;
+                    }
+                    continue;
+                }
                 readBuffer.clear();
                 readDirect(readBuffer, dst.remaining());
                 readBuffer.flip();
@@ -133,6 +155,82 @@ final public class KfsInputChannel implements ReadableByteChannel, Positionable
         buf.position(pos + sz);
     }
 
+    // Reads the file ranges starting at positions[i] into the direct buffer
+    // ranges [begins[i], ends[i]) with a single JNI call. The ranges are read
+    // in parallel, and the channel position and buffer are not modified.
+    // Returns the total number of bytes read, and sets results[i] to the
+    // number of bytes read into the range i, which is less than requested at
+    // the end of file.
+    public synchronized long readv(ByteBuffer buf, long[] positions,
+        int[] begins, int[] ends, int[] results) throws IOException
+    {
+        if (kfsFd < 0) {
+            throw new IOException("File closed");
+        }
+        if (!buf.isDirect()) {
+            throw new IllegalArgumentException("need direct buffer");
+        }
+        final long ret = readv(kfsAccess.getCPtr(), kfsFd, buf, positions,
+            begins, ends, results);
+        if (ret < 0) {
+            kfsAccess.kfs_retToIOException((int)ret);
+        }
+        return ret;
+    }
+
+    // Positional read: reads up to dst.remaining() bytes starting at the
+    // file position into dst. The channel position, the buffered data, and
+    // the sequential read ahead state are not modified. A direct buffer is
+    // read with a single JNI call. Returns the number of bytes read, or -1 at
+    // the end of file.
+    public synchronized int pread(long position, ByteBuffer dst)
+        throws IOException
+    {
+        if (position < 0) {
+            throw new IllegalArgumentException(
+                "pread(" + kfsFd + "," + position + ")");
+        }
+        if (kfsFd < 0) {
+            throw new IOException("File closed");
+        }
+        final int r0 = dst.remaining();
+        if (r0 <= 0) {
+            return 0;
+        }
+        if (dst.isDirect()) {
+            final int pos = dst.position();
+            final int sz  = pread(kfsAccess.getCPtr(), kfsFd, position,
+                dst, pos, dst.limit());
+            kfsAccess.kfs_retToIOException(sz);
+            dst.position(pos + sz);
+            return (sz > 0 ? sz : -1);
+        }
+        final ByteBuffer buf = BufferPool.getInstance().getBuffer();
+        try {
+            long filePos = position;
+            while (dst.hasRemaining()) {
+                final int len = Math.min(buf.capacity(), dst.remaining());
+                final int sz  = pread(kfsAccess.getCPtr(), kfsFd, filePos,
+                    buf, 0, len);
+                kfsAccess.kfs_retToIOException(sz);
+                if (sz <= 0) {
+                    break;
+                }
+                buf.clear();
+                buf.limit(sz);
+                dst.put(buf);
+                filePos += sz;
+                if (sz < len) {
+                    break;
+                }
+            }
+        } finally {
+            BufferPool.getInstance().releaseBuffer(buf);
+        }
+        final int r1 = dst.remaining();
+        return (r1 < r0 ? r0 - r1 : -1);
+    }
+
     // is modeled after the seek of Java's RandomAccessFile; offset is
     // the offset from the beginning of the file.
     public synchronized long seek(long offset) throws IOException
@@ -42,6 +42,9 @@ public class KfsOutputChannel implements WritableByteChannel, Positionable
     private KfsAccess kfsAccess;
     private final boolean append;
     private boolean returnBufferToPool;
+    // Direct source buffers of at least this size are written directly,
+    // without staging the data in the channel buffer.
+    private final static int DIRECT_WRITE_MIN_SIZE = 64 << 10;
 
     private final static native
     int write(long ptr, int fd, ByteBuffer buf, int begin, int end);
@@ -78,6 +81,22 @@ public class KfsOutputChannel implements WritableByteChannel, Positionable
             throw new IOException("File closed");
         }
         final int r0 = src.remaining();
+        if (! append && src.isDirect() && DIRECT_WRITE_MIN_SIZE <= r0) {
+            // Write directly from the source buffer, this saves one copy.
+            // Flush the buffered data first, in order to preserve the write
+            // order.
+            syncSelf();
+            final int pos  = src.position();
+            final int last = src.limit();
+            final int sz   = write(kfsAccess.getCPtr(), kfsFd, src, pos, last);
+            kfsAccess.kfs_retToIOException(sz);
+            if (pos + sz != last) {
+                throw new RuntimeException("KFS internal error: write(" +
+                    (last - pos) + ") != " + sz);
+            }
+            src.position(last);
+            return r0;
+        }
         // While the src buffer has data, copy it in and flush
         while (src.hasRemaining()) {
             if (writeBuffer.remaining() < (append ? r0 : 1)) {
@@ -24,7 +24,7 @@
 #
 
 import os,sys,os.path,getopt
-import socket,threading,calendar,time
+import socket,threading,calendar,time,copy
 from datetime import datetime
 import SimpleHTTPServer
 import SocketServer
@@ -1114,18 +1114,52 @@ def splitServersByRack(status):
         updateServerState(status, rackId, s, u)
 
 
+# Last parsed ping status snapshot per meta server: (generation, status).
+# The meta server rebuilds the ping status at most once per
+# metaServer.pingUpdateInterval, and returns only the "Not-modified" header
+# when the snapshot generation matches, in which case the cached snapshot is
+# used instead of re-parsing the server lists.
+gPingCache = {}
+gPingCacheLock = threading.Lock()
+
 def ping(status, metaserver):
+    key = (metaserver.node, metaserver.port)
+    gPingCacheLock.acquire()
+    cached = gPingCache.get(key)
+    gPingCacheLock.release()
     sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
     sock.connect((metaserver.node, metaserver.port))
-    req = "PING\r\nVersion: KFS/1.0\r\nCseq: 1\r\nClient-Protocol-Version: 115\r\n\r\n"
+    req = "PING\r\nVersion: KFS/1.0\r\nCseq: 1\r\nClient-Protocol-Version: 115\r\n"
+    if cached:
+        req += "If-not-generation: %d\r\n" % cached[0]
+    req += "\r\n"
     sock.send(req)
     sockIn = sock.makefile('r')
-    status.tiersColumnNames = {}
-    status.tiersInfo = {}
+    lines = []
+    generation = -1
+    notModified = False
     for line in sockIn:
         line = line.lstrip()
         if line == '':
             break
+        if line.startswith('Ping-generation:'):
+            try:
+                generation = int(line[line.find(':') + 1:].strip())
+            except:
+                generation = -1
+            continue
+        if line.startswith('Not-modified:'):
+            notModified = True
+            continue
+        lines.append(line)
+    sock.close()
+    if notModified and cached and cached[0] == generation:
+        # Deep copy, as the callers modify the status.
+        status.__dict__.update(copy.deepcopy(cached[1]).__dict__)
+        return
+    status.tiersColumnNames = {}
+    status.tiersInfo = {}
+    for line in lines:
         if line.startswith('Down Servers:'):
             processDownNodes(status, line[line.find(':') + 1:].strip())
             continue
@@ -1176,7 +1210,11 @@ def ping(status, metaserver):
     mergeRetiringUpNodes(status)
     status.upServers.sort()
 
-    sock.close()
+    if 0 <= generation:
+        snapshot = copy.deepcopy(status)
+        gPingCacheLock.acquire()
+        gPingCache[key] = (generation, snapshot)
+        gPingCacheLock.release()
 
 def splitThousands( s, tSep=',', dSep='.'):
     '''Splits a general float on thousands. GIGO on general input'''